@@ -10,6 +10,7 @@
 #ifndef EMULATIONMODEL_H
 #define EMULATIONMODEL_H
 
+#include "util/Checkpoint.h"
 #include "util/TimerManager.h"
 #include "abi/Address.h"
 
@@ -109,8 +110,19 @@ namespace archsim
 
 			virtual bool PrepareBoot(System& system) = 0;
 
+			// Save or restore the state of the emulated machine, other than
+			// guest memory, while the cores are halted. Restoring takes the
+			// place of PrepareBoot. Returns false if the state could not be
+			// saved or restored, or the model does not support checkpoints.
+			virtual bool SaveState(util::Checkpoint &checkpoint);
+			virtual bool RestoreState(const util::Checkpoint &checkpoint);
+
 			virtual ExceptionAction HandleException(archsim::core::thread::ThreadInstance* thread, uint64_t category, uint64_t data) = 0;
 			virtual ExceptionAction HandleMemoryFault(archsim::core::thread::ThreadInstance &thread, archsim::MemoryInterface &interface, archsim::Address address);
+			// Called for host segmentation faults, which may be caused by guest
+			// memory accesses. host_pc is the faulting host instruction, if
+			// known. Returns false if the fault is not recognised.
+			virtual bool HandleSegFault(const void *host_addr, const void *host_pc);
 			virtual void HandleInterrupt(archsim::core::thread::ThreadInstance* thread, archsim::abi::devices::CPUIRQLine *irq);
 
 			virtual bool LookupSymbol(Address address, bool exact_match, const BinarySymbol *& symbol) const;
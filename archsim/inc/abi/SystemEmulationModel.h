@@ -52,6 +52,9 @@ namespace archsim
 
 			bool PrepareBoot(System& system) override;
 
+			bool SaveState(util::Checkpoint &checkpoint) override;
+			bool RestoreState(const util::Checkpoint &checkpoint) override;
+
 			virtual ExceptionAction HandleException(archsim::core::thread::ThreadInstance *cpu, uint64_t category, uint64_t data) override = 0;
 
 
@@ -12,6 +12,7 @@
 
 #include "abi/EmulationModel.h"
 #include "abi/memory/MemoryModel.h"
+#include "abi/memory/ShadowPageTable.h"
 #include "abi/user/SyscallHandler.h"
 #include "core/execution/ExecutionEngine.h"
 #include "core/thread/ThreadInstance.h"
@@ -88,6 +89,7 @@ namespace archsim
 			virtual bool InvokeSignal(int signum, uint32_t next_pc, SignalData* data) override;
 
 			virtual ExceptionAction HandleException(archsim::core::thread::ThreadInstance* cpu, uint64_t category, uint64_t data) override;
+			bool HandleSegFault(const void *host_addr, const void *host_pc) override;
 			void PrintStatistics(std::ostream& stream) override;
 
 			bool Is64BitBinary() const
@@ -111,6 +113,7 @@ namespace archsim
 			Address _program_break;
 
 			std::shared_ptr<archsim::core::MemoryMonitor> monitor_;
+			std::unique_ptr<archsim::abi::memory::ShadowPageTable> shadow_page_table_;
 
 			unsigned int _stack_size;
 
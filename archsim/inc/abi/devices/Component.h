@@ -12,6 +12,7 @@
 
 #include "abi/Address.h"
 #include "define.h"
+#include "util/Checkpoint.h"
 
 #include <map>
 #include <string>
@@ -218,6 +219,16 @@ namespace archsim
 
 				virtual bool Initialise() = 0;
 
+				// Checkpointing. Components which keep state outside of guest
+				// memory save it here, and by default a component is assumed to
+				// be stateless. Restoring must not have side effects such as
+				// raising interrupts: StateRestored is called once every
+				// component has been restored, to drive outputs which depend on
+				// the restored state.
+				virtual void SaveState(util::CheckpointWriter &writer);
+				virtual bool RestoreState(util::CheckpointReader &reader);
+				virtual void StateRestored();
+
 			private:
 				ComponentDescriptorInstance descriptor_;
 			};
@@ -383,6 +394,11 @@ namespace archsim
 				bool Read(uint32_t offset, uint8_t size, uint64_t& data) override;
 				bool Write(uint32_t offset, uint8_t size, uint64_t data) override;
 
+				// The value of every register is saved, so devices whose only
+				// state is in their registers need nothing more
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+
 				inline std::string GetName() const
 				{
 					return name;
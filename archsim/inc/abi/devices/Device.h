@@ -10,6 +10,7 @@
 #ifndef DEVICE_H
 #define	DEVICE_H
 
+#include "util/Checkpoint.h"
 #include "util/ComponentManager.h"
 
 #include <cstdint>
@@ -49,6 +50,14 @@ namespace archsim
 				virtual bool ReadBlock(uint32_t address, void *data, unsigned int length);
 				virtual bool WriteBlock(uint32_t address, const void *data, unsigned int length);
 
+				// Checkpointing. Devices which keep state outside of guest memory
+				// and the register file save it here, and by default a device is
+				// assumed to be stateless. StateRestored is called once every
+				// device has been restored, to rebuild anything derived from it.
+				virtual void SaveState(util::CheckpointWriter &writer);
+				virtual bool RestoreState(util::CheckpointReader &reader);
+				virtual void StateRestored();
+
 				bool SetManager(PeripheralManager*);
 				PeripheralManager *Manager;
 			};
@@ -40,10 +40,18 @@ namespace archsim
 					return device_bitmap.test(device_address.GetPageIndex());
 				}
 
+				typedef std::map<memory::guest_addr_t, MemoryComponent*> device_map_t;
+
+				// The installed devices by base address. A device which has been
+				// installed more than once appears at each of its addresses.
+				const device_map_t &GetDevices() const
+				{
+					return devices;
+				}
+
 			private:
 				memory::guest_addr_t min_device_address;
 
-				typedef std::map<memory::guest_addr_t, MemoryComponent*> device_map_t;
 				device_map_t devices;
 
 				//Keep also a set of registered devices, since some devices may be multiply registered
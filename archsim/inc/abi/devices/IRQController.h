@@ -97,6 +97,17 @@ namespace archsim
 				virtual void Assert();
 				virtual void Rescind();
 
+				// Set the level of the line when restoring a checkpoint, without
+				// telling the controller about it
+				void RestoreLevel(bool asserted)
+				{
+					if(asserted) {
+						SetAsserted();
+					} else {
+						ClearAsserted();
+					}
+				}
+
 			protected:
 				IRQController *Controller;
 			};
@@ -162,6 +173,11 @@ namespace archsim
 				virtual bool AssertLine(uint32_t line) = 0;
 				virtual bool RescindLine(uint32_t line) = 0;
 
+				// Save and restore the level of each input line, for use by the
+				// checkpoint hooks of the controllers
+				void SaveLineState(util::CheckpointWriter &writer) const;
+				bool RestoreLineState(util::CheckpointReader &reader);
+
 			private:
 				std::vector<IRQControllerLine*> _lines;
 			};
@@ -88,8 +88,21 @@ namespace archsim
 				virtual void FlushCaches();
 				virtual void Evict(Address virt_addr);
 
+				// The address space identifier which cached translations are tagged with
+				virtual uint32_t GetASID();
+
+				// The log2 size of the smallest region of memory which can be
+				// translated, or given permissions, separately
+				virtual uint32_t GetPageBits() const;
+
 				Address TranslateUnsafe(archsim::core::thread::ThreadInstance *cpu, Address virt_addr);
 
+				// Cached translations are not saved, and are flushed once the
+				// MMU state has been restored
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+				void StateRestored() override;
+
 				void set_enabled(bool enabled);
 				inline bool is_enabled() const
 				{
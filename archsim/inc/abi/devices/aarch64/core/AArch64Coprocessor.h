@@ -32,6 +32,9 @@ namespace archsim
 						bool Read64(uint32_t address, uint64_t& data) override;
 						bool Write64(uint32_t address, uint64_t data) override;
 
+						void SaveState(util::CheckpointWriter &writer) override;
+						bool RestoreState(util::CheckpointReader &reader) override;
+
 					private:
 						uint64_t tpidr_el0_;
 					};
@@ -104,6 +104,9 @@ namespace archsim
 
 				bool access_cp15(bool is_read, uint32_t &data) override;
 
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+
 			private:
 				arm::core::PMU pmu;
 
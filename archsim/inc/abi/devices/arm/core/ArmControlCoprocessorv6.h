@@ -93,6 +93,11 @@ namespace archsim
 					return cp1_R;
 				}
 
+				uint32_t get_contextidr() const
+				{
+					return contextidr;
+				}
+
 				bool access_cp0(bool is_read, uint32_t &data) override;
 				bool access_cp1(bool is_read, uint32_t &data) override;
 				bool access_cp2(bool is_read, uint32_t &data) override;
@@ -106,6 +111,9 @@ namespace archsim
 				bool access_cp13(bool is_read, uint32_t &data) override;
 				bool access_cp15(bool is_read, uint32_t &data) override;
 
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+
 			private:
 				arm::core::PMU pmu;
 
@@ -13,6 +13,9 @@
 #include "define.h"
 #include "util/Counter.h"
 
+#include <vector>
+#include <sys/uio.h>
+
 namespace archsim
 {
 	namespace abi
@@ -23,6 +26,26 @@ namespace archsim
 			{
 				namespace block
 				{
+					// A single contiguous transfer, scattered over (or gathered
+					// from) a list of host buffers. The buffer lengths must all be
+					// multiples of the block size of the device.
+					struct BlockRequest {
+						BlockRequest(bool is_write, uint64_t block_idx) : is_write(is_write), block_idx(block_idx), size(0), success(false) { }
+
+						inline void AddBuffer(void *data, size_t len)
+						{
+							buffers.push_back({data, len});
+							size += len;
+						}
+
+						bool is_write;
+						uint64_t block_idx;
+						uint64_t size;
+						std::vector<struct iovec> buffers;
+
+						bool success;
+					};
+
 					class BlockDevice
 					{
 					public:
@@ -34,6 +57,11 @@ namespace archsim
 						virtual bool WriteBlock(uint64_t block_idx, const uint8_t *buffer) = 0;
 						virtual bool WriteBlocks(uint64_t block_idx, uint32_t count, const uint8_t *buffer) = 0;
 
+						// Performs a batch of requests, returning once they have all
+						// completed. Devices which can overlap requests should override
+						// this, the default just performs each request in turn.
+						virtual void SubmitRequests(BlockRequest *requests, size_t count);
+
 						virtual uint64_t GetBlockSize() const = 0;
 						virtual uint64_t GetBlockCount() const = 0;
 
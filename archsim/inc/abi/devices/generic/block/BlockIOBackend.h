@@ -0,0 +1,143 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   BlockIOBackend.h
+ *
+ * Backends for performing batches of vectored block requests against a
+ * file descriptor. io_uring is used where the host kernel supports it,
+ * otherwise the requests in a batch are spread over a small pool of threads
+ * each doing blocking preadv/pwritev calls.
+ */
+
+#ifndef BLOCKIOBACKEND_H
+#define BLOCKIOBACKEND_H
+
+#include "abi/devices/generic/block/BlockDevice.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef CONFIG_IO_URING
+struct io_uring_sqe;
+struct io_uring_cqe;
+#endif
+
+namespace archsim
+{
+	namespace abi
+	{
+		namespace devices
+		{
+			namespace generic
+			{
+				namespace block
+				{
+					class BlockIOBackend
+					{
+					public:
+						virtual ~BlockIOBackend();
+
+						// Performs each of the requests against the file, with block
+						// 0 at offset 0. Returns once every request has completed.
+						virtual void Submit(int fd, uint64_t block_size, BlockRequest *requests, size_t count) = 0;
+
+						virtual std::string GetName() const = 0;
+
+						// Creates the best backend supported by the host.
+						static BlockIOBackend *Create();
+
+					protected:
+						// Performs a request with blocking calls, starting from the
+						// given number of bytes into it (e.g. to finish off a short
+						// transfer).
+						static bool PerformSync(int fd, uint64_t block_size, const BlockRequest &request, uint64_t done = 0);
+					};
+
+					class ThreadPoolBlockIOBackend : public BlockIOBackend
+					{
+					public:
+						ThreadPoolBlockIOBackend(unsigned int nr_threads = 4);
+						~ThreadPoolBlockIOBackend();
+
+						void Submit(int fd, uint64_t block_size, BlockRequest *requests, size_t count) override;
+
+						std::string GetName() const override
+						{
+							return "thread-pool";
+						}
+
+					private:
+						void WorkerProc();
+
+						std::vector<std::thread> workers_;
+
+						std::mutex submit_lock_;
+						std::mutex lock_;
+						std::condition_variable work_available_;
+						std::condition_variable work_complete_;
+
+						std::deque<BlockRequest *> pending_;
+						size_t outstanding_;
+						int fd_;
+						uint64_t block_size_;
+						bool terminate_;
+					};
+
+#ifdef CONFIG_IO_URING
+					class UringBlockIOBackend : public BlockIOBackend
+					{
+					public:
+						UringBlockIOBackend();
+						~UringBlockIOBackend();
+
+						// Returns false if the host kernel does not support io_uring.
+						bool Initialise(unsigned int entries = 64);
+
+						void Submit(int fd, uint64_t block_size, BlockRequest *requests, size_t count) override;
+
+						std::string GetName() const override
+						{
+							return "io_uring";
+						}
+
+					private:
+						// Handles every completion currently in the completion ring,
+						// marking their requests as completed. Returns how many there
+						// were.
+						unsigned ReapCompletions(int fd, uint64_t block_size, BlockRequest *requests, std::vector<bool> &completed);
+
+						// Gives up on the ring after io_uring_enter fails, once
+						// everything the kernel has taken from it has completed. The
+						// rest of the requests, and all later ones, are performed by a
+						// thread pool instead.
+						void Abandon(int fd, uint64_t block_size, BlockRequest *requests, size_t count, std::vector<bool> &completed, unsigned batch_start, unsigned reaped);
+
+						std::unique_ptr<ThreadPoolBlockIOBackend> fallback_;
+
+						int ring_fd_;
+
+						void *sq_ring_;
+						size_t sq_ring_size_;
+						void *cq_ring_;
+						size_t cq_ring_size_;
+						::io_uring_sqe *sqes_;
+						size_t sqes_size_;
+
+						unsigned *sq_head_, *sq_tail_, *sq_mask_, *sq_array_;
+						unsigned *cq_head_, *cq_tail_, *cq_mask_;
+						::io_uring_cqe *cqes_;
+						unsigned sq_entries_;
+					};
+#endif
+				}
+			}
+		}
+	}
+}
+
+#endif /* BLOCKIOBACKEND_H */
@@ -12,6 +12,7 @@
 
 #include "abi/devices/generic/block/BlockDevice.h"
 #include "abi/devices/generic/block/BlockCache.h"
+#include "abi/devices/generic/block/BlockIOBackend.h"
 
 #include <memory>
 #include <string>
@@ -40,6 +41,8 @@ namespace archsim
 						bool WriteBlock(uint64_t block_idx, const uint8_t* buffer) override;
 						bool WriteBlocks(uint64_t block_idx, uint32_t count, const uint8_t* buffer) override;
 
+						void SubmitRequests(BlockRequest *requests, size_t count) override;
+
 						bool Open(std::string filename, bool read_only = false);
 						void Close();
 
@@ -68,6 +71,7 @@ namespace archsim
 						bool read_only;
 
 						std::unique_ptr<BlockCache> cache;
+						std::unique_ptr<BlockIOBackend> io_backend;
 					};
 				}
 			}
@@ -10,6 +10,8 @@
 #ifndef TICKCONSUMER_H_
 #define TICKCONSUMER_H_
 
+#include <cstdint>
+
 namespace archsim
 {
 	namespace abi
@@ -21,9 +23,18 @@ namespace archsim
 				class TickConsumer
 				{
 				public:
+					static const uint64_t kNoDeadline = (uint64_t)-1;
+
 					virtual ~TickConsumer();
 
 					virtual void Tick(uint32_t tick_periods) = 0;
+
+					// The number of ticks until this consumer next does something
+					// the guest can see (e.g. raises an interrupt), or kNoDeadline.
+					virtual uint64_t GetTicksUntilDeadline()
+					{
+						return kNoDeadline;
+					}
 				};
 			}
 		}
@@ -10,11 +10,16 @@
 #ifndef TICKSOURCE_H_
 #define TICKSOURCE_H_
 
+#include "abi/devices/generic/timing/TimerWheel.h"
 #include "concurrent/Thread.h"
+#include "util/Checkpoint.h"
 #include "util/PubSubSync.h"
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace archsim
@@ -33,19 +38,47 @@ namespace archsim
 					TickSource();
 					virtual ~TickSource();
 
-					void AddConsumer(TickConsumer &consumer);
-					void RemoveConsumer(TickConsumer &consumer);
+					virtual void AddConsumer(TickConsumer &consumer);
+					virtual void RemoveConsumer(TickConsumer &consumer);
 
 					void Start();
 					void Stop();
 
+					// Deliver all of the ticks up to the earliest consumer deadline
+					// at once. Returns false if there is no deadline, or if the
+					// source follows real time and so cannot be skipped.
+					virtual bool SkipToNextDeadline();
+
+					// Sources which deliver ticks lazily only bring their
+					// consumers up to date when a deadline is due. Devices call
+					// Synchronise before the guest observes or changes their
+					// state, and Reschedule once their deadline has changed.
+					virtual void Synchronise() {}
+					virtual void Reschedule(TickConsumer &consumer) {}
+
 					inline uint64_t GetCounter()
 					{
 						return tick_count_;
 					}
 
+					// Save and restore the virtual time. Once every consumer
+					// has been restored, StateRestored is called so that
+					// sources which track deadlines can recompute them.
+					virtual void SaveState(util::CheckpointWriter &writer);
+					virtual bool RestoreState(util::CheckpointReader &reader);
+					virtual void StateRestored() {}
+
 				protected:
 					void Tick(uint32_t tick_periods);
+
+					// Deliver a number of whole ticks, without any scaling
+					void DeliverTicks(uint32_t ticks);
+
+					inline bool IsRunning() const
+					{
+						return running_;
+					}
+
 				private:
 					uint64_t tick_count_;
 					float microticks_;
@@ -63,6 +96,8 @@ namespace archsim
 					MicrosecondTickSource(uint32_t useconds);
 					~MicrosecondTickSource() override;
 
+					bool SkipToNextDeadline() override;
+
 				protected:
 					void tick() override;
 
@@ -99,6 +134,62 @@ namespace archsim
 					uint32_t _scale, _curr_scale;
 				};
 
+				/*
+				 * A virtual clock driven by the number of guest instructions
+				 * executed, so that runs are reproducible. The execution
+				 * engines add instructions a block at a time, and consumers
+				 * are only ticked when the earliest of their deadlines (kept
+				 * in a timer wheel, in instructions) has been reached, or
+				 * when a device synchronises because the guest is accessing
+				 * it.
+				 */
+				class InstructionCountTickSource : public TickSource
+				{
+				public:
+					InstructionCountTickSource(uint32_t instructions_per_tick);
+					~InstructionCountTickSource() override;
+
+					void AddConsumer(TickConsumer &consumer) override;
+					void RemoveConsumer(TickConsumer &consumer) override;
+
+					inline void AddInstructions(uint32_t count)
+					{
+						uint64_t now = instructions_.fetch_add(count, std::memory_order_relaxed) + count;
+						if(now >= next_deadline_.load(std::memory_order_relaxed)) {
+							Synchronise();
+						}
+					}
+
+					inline uint64_t GetInstructionCount() const
+					{
+						return instructions_.load(std::memory_order_relaxed);
+					}
+
+					void Synchronise() override;
+					void Reschedule(TickConsumer &consumer) override;
+					bool SkipToNextDeadline() override;
+
+					void SaveState(util::CheckpointWriter &writer) override;
+					bool RestoreState(util::CheckpointReader &reader) override;
+					void StateRestored() override;
+
+				private:
+					struct Deadline : public TimerWheel::Event {
+						TickConsumer *consumer;
+					};
+
+					void SynchroniseLocked();
+					void Arm(Deadline &deadline);
+
+					uint64_t instructions_per_tick_;
+					std::atomic<uint64_t> instructions_;
+					std::atomic<uint64_t> next_deadline_;
+
+					std::mutex lock_;
+					TimerWheel wheel_;
+					std::unordered_map<TickConsumer*, std::unique_ptr<Deadline>> deadlines_;
+				};
+
 			}
 		}
 	}
@@ -0,0 +1,112 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * TimerWheel.h
+ *
+ * A hierarchical timer wheel, which keeps track of deadlines on a virtual
+ * clock. Each level has 64 slots, and each slot in a level covers 64 times
+ * as much time as a slot in the level below, so scheduling and cancelling
+ * are constant time and finding the next deadline is a bit scan.
+ *
+ * An event is kept in the lowest level in which its deadline shares all of
+ * the higher bits with the current time. As time advances, the events in the
+ * slot which the current time has reached are moved down to lower levels
+ * (cascaded) until they reach level 0, where each slot is a single point in
+ * time. Events too far in the future for the top level wait in an overflow
+ * list.
+ */
+
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include <cstdint>
+#include <functional>
+
+namespace archsim
+{
+	namespace abi
+	{
+		namespace devices
+		{
+			namespace timing
+			{
+				class TimerWheel
+				{
+				public:
+					static const uint64_t kNever = (uint64_t)-1;
+
+					class Event
+					{
+					public:
+						Event() : deadline_(0), next_(nullptr), prev_(nullptr), list_(nullptr) {}
+
+						bool IsScheduled() const
+						{
+							return list_ != nullptr;
+						}
+
+						uint64_t GetDeadline() const
+						{
+							return deadline_;
+						}
+
+					private:
+						friend class TimerWheel;
+
+						uint64_t deadline_;
+						Event *next_, *prev_;
+						Event **list_;
+					};
+
+					typedef std::function<void(Event &)> expired_fn_t;
+
+					TimerWheel();
+
+					TimerWheel(const TimerWheel &) = delete;
+					TimerWheel &operator=(const TimerWheel &) = delete;
+
+					uint64_t GetTime() const
+					{
+						return now_;
+					}
+
+					// Schedule (or reschedule) an event. Deadlines which have
+					// already passed expire on the next call to Advance.
+					void Schedule(Event &event, uint64_t deadline);
+					void Cancel(Event &event);
+
+					// The earliest deadline of any scheduled event, or kNever
+					uint64_t GetNextDeadline() const;
+
+					// Move the clock forwards, calling expired for every event
+					// whose deadline is at or before the new time, in deadline
+					// order. Events are unscheduled before they are passed to
+					// expired, which may schedule them again.
+					void Advance(uint64_t time, const expired_fn_t &expired);
+
+				private:
+					static const unsigned kLevels = 6;
+					static const unsigned kSlotBits = 6;
+					static const unsigned kSlots = 1 << kSlotBits;
+
+					static inline unsigned SlotIndex(uint64_t time, unsigned level)
+					{
+						return (time >> (level * kSlotBits)) & (kSlots - 1);
+					}
+
+					void Insert(Event &event);
+					void Remove(Event &event);
+					void Cascade(Event *&list);
+					void SetTime(uint64_t time);
+
+					uint64_t now_;
+					uint64_t occupied_[kLevels];
+					Event *slots_[kLevels][kSlots];
+					Event *overflow_;
+				};
+			}
+		}
+	}
+}
+
+#endif /* TIMERWHEEL_H_ */
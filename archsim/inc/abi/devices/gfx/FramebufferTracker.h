@@ -0,0 +1,108 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   FramebufferTracker.h
+ *
+ * Works out which parts of a guest framebuffer have changed, so that screens
+ * only convert and send the tiles which are different.
+ *
+ * The framebuffer is compared against a shadow copy a tile at a time. When
+ * write protection is enabled, only the tiles on host pages which the guest
+ * has written to since the last update are compared: each page is write
+ * protected after it has been scanned, and the first write to it afterwards
+ * faults, marks the page as dirty and removes the protection again. An idle
+ * screen then costs nothing but a scan of the dirty bitmap.
+ */
+
+#ifndef FRAMEBUFFERTRACKER_H
+#define FRAMEBUFFERTRACKER_H
+
+#include "system.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace archsim
+{
+	namespace abi
+	{
+		namespace devices
+		{
+			namespace gfx
+			{
+				class FramebufferTracker
+				{
+				public:
+					// Called with the position and size (in pixels) of each run of
+					// changed tiles within a row of tiles
+					typedef std::function<void(uint32_t x, uint32_t y, uint32_t width, uint32_t height)> changed_fn_t;
+
+					static const uint32_t kTileSize = 16;
+
+					FramebufferTracker();
+					~FramebufferTracker();
+
+					FramebufferTracker(const FramebufferTracker &) = delete;
+					FramebufferTracker &operator=(const FramebufferTracker &) = delete;
+
+					/*
+					 * Start tracking the framebuffer at the given host address. The
+					 * first update reports every tile as changed.
+					 */
+					void Attach(const uint8_t *data, uint32_t width, uint32_t height, uint32_t bytes_per_pixel);
+
+					/*
+					 * Only compare the tiles on pages which have been written to,
+					 * by write protecting the framebuffer. Returns false if the
+					 * pages could not be protected, in which case every tile is
+					 * compared on each update.
+					 */
+					bool EnableWriteProtection(System &system);
+
+					void Detach();
+
+					bool IsAttached() const
+					{
+						return data_ != nullptr;
+					}
+
+					const uint8_t *GetData() const
+					{
+						return data_;
+					}
+
+					/*
+					 * Report the tiles which have changed since the last update, and
+					 * bring the shadow copy up to date. Returns the number of tiles
+					 * which changed.
+					 */
+					uint32_t Update(const changed_fn_t &changed);
+
+				private:
+					static bool HandleWriteFault(void *ctx, const System::segfault_data &data);
+
+					void ProtectPages(uint32_t first, uint32_t count, bool writable);
+					bool UpdateTile(uint32_t tile_x, uint32_t tile_y);
+
+					const uint8_t *data_;
+					uint32_t width_, height_, bytes_per_pixel_;
+					uint32_t tiles_x_, tiles_y_;
+					bool first_update_;
+
+					std::vector<uint8_t> shadow_;
+
+					// The page aligned host region which is write protected
+					System *system_;
+					uint8_t *protected_base_;
+					uint32_t protected_pages_;
+					std::unique_ptr<std::atomic<bool>[]> dirty_pages_;
+				};
+			}
+		}
+	}
+}
+
+#endif /* FRAMEBUFFERTRACKER_H */
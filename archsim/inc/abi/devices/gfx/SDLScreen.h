@@ -11,6 +11,7 @@
 #define SDLSCREEN_H_
 
 #include "abi/devices/SerialPort.h"
+#include "abi/devices/gfx/FramebufferTracker.h"
 #include "abi/devices/gfx/VirtualScreen.h"
 #include "abi/devices/gfx/VirtualScreenManager.h"
 #include "concurrent/Thread.h"
@@ -61,9 +62,12 @@ namespace archsim
 
 					void PerformKeyboardEvent(bool press, SDL_Scancode scancode);
 
+					// These return true if anything on the screen changed
 					bool draw_rgb();
 					bool draw_doom();
 
+					void track_framebuffer(host_addr_t fb, uint32_t pixel_size);
+
 					volatile bool terminated;
 					volatile bool running;
 
@@ -78,6 +82,13 @@ namespace archsim
 
 					bool hw_accelerated;
 
+					// Only the tiles which have changed are copied to the texture, and
+					// nothing is rendered unless something changed or the window needs
+					// to be redrawn
+					FramebufferTracker tracker;
+					std::vector<uint8_t> doom_palette;
+					bool needs_present;
+
 					static std::mutex _sdl_lock;
 					static bool _sdl_initialised;
 				};
@@ -10,11 +10,16 @@
 #ifndef VNCSCREEN_H
 #define VNCSCREEN_H
 
+#include "abi/devices/gfx/FramebufferTracker.h"
 #include "abi/devices/gfx/VirtualScreen.h"
 
 #include <libgvnc/Server.h>
 #include <libgvnc/Framebuffer.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 namespace archsim
 {
 	namespace abi
@@ -27,6 +32,7 @@ namespace archsim
 				{
 				public:
 					VNCScreen(std::string id, memory::MemoryModel *mem_model, System* sys);
+					~VNCScreen();
 
 					bool Initialise() override;
 					bool Reset() override;
@@ -36,6 +42,12 @@ namespace archsim
 					bool SetFramebufferPointer(Address guest_addr) override;
 
 				private:
+					// Periodically finds the tiles of the framebuffer which have
+					// changed, and marks them as damaged for the VNC server
+					void UpdateThread();
+					void TrackFramebuffer();
+
+					System *system_;
 					void *fb_ptr_;
 
 					libgvnc::Server *vnc_server_;
@@ -44,6 +56,11 @@ namespace archsim
 
 					generic::Keyboard *keyboard_;
 					generic::Mouse *mouse_;
+
+					FramebufferTracker tracker_;
+					std::mutex tracker_lock_;
+					std::thread *update_thread_;
+					std::atomic<bool> terminated_;
 				};
 			}
 		}
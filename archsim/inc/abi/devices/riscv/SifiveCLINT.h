@@ -37,9 +37,17 @@ namespace archsim
 					CLINTTimer(archsim::core::thread::ThreadInstance *hart, SifiveCLINT *clint);
 
 					void Tick(uint32_t tick_periods) override;
+					uint64_t GetTicksUntilDeadline() override;
 					void SetCmp(uint64_t cmp);
 					uint64_t GetCmp() const;
 
+					// Set mtimecmp without re-evaluating the interrupt, when
+					// restoring a checkpoint
+					void RestoreCmp(uint64_t cmp)
+					{
+						cmp_ = cmp;
+					}
+
 				private:
 					void CheckTick();
 
@@ -58,6 +66,10 @@ namespace archsim
 					bool Read(uint32_t offset, uint8_t size, uint64_t& data) override;
 					bool Write(uint32_t offset, uint8_t size, uint64_t data) override;
 
+					// mtime follows the tick source, so only mtimecmp is saved
+					void SaveState(util::CheckpointWriter &writer) override;
+					bool RestoreState(util::CheckpointReader &reader) override;
+
 					uint64_t GetTimer();
 					CLINTTimer *GetHartTimer(int i);
 
@@ -34,6 +34,10 @@ namespace archsim
 					bool AssertLine(uint32_t line) override;
 					bool RescindLine(uint32_t line) override;
 
+					void SaveState(util::CheckpointWriter &writer) override;
+					bool RestoreState(util::CheckpointReader &reader) override;
+					void StateRestored() override;
+
 				private:
 					archsim::core::thread::ThreadInstance *GetHart(int i);
 					int GetHartCount() const
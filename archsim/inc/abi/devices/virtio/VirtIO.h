@@ -16,6 +16,9 @@
 
 #include <vector>
 #include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #define VRING_DESC_F_INDIRECT 4
 
@@ -111,6 +114,7 @@ namespace archsim
 
 					inline void AssertInterrupt(uint32_t i)
 					{
+						std::lock_guard<std::mutex> l(irq_lock);
 						InterruptStatus.Set(InterruptStatus.Get() | i);
 
 						if(InterruptStatus.Get()) {
@@ -121,10 +125,37 @@ namespace archsim
 					MemoryRegister HostFeaturesSel;
 					MemoryRegister HostFeatures;
 
+					// Called with every descriptor chain popped from a queue in one
+					// go, so that devices can batch up requests. By default, each
+					// event is just processed in turn.
+					virtual void ProcessEvents(std::vector<VirtIOQueueEvent *> &events);
+
+					// Stops and joins the I/O thread. The I/O thread calls into the
+					// derived device, so derived devices must call this from their
+					// destructor, before their own members go away.
+					void StopIOThread();
+
 				private:
 					void ProcessQueue(VirtQueue *queue);
 					virtual void ProcessEvent(VirtIOQueueEvent* evt) = 0;
 
+					// Unless synchronous I/O is requested, queues are processed on a
+					// separate thread for each device, so that the CPU only has to
+					// post the notification.
+					void NotifyQueue(uint32_t index);
+					void WaitForIOIdle();
+					void IOThreadProc();
+
+					std::thread *io_thread;
+					std::mutex io_lock;
+					std::condition_variable io_work;
+					std::condition_variable io_idle;
+					uint32_t io_pending_queues;
+					bool io_busy;
+					bool io_terminate;
+
+					std::mutex irq_lock;
+
 					uint8_t guest_page_shift;
 
 					std::vector<VirtQueue *> queues;
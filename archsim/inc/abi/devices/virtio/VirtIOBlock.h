@@ -52,8 +52,8 @@ namespace archsim
 					};
 
 					void ProcessEvent(VirtIOQueueEvent* evt) override;
-					bool HandleRead(uint64_t sector, uint8_t *buffer, uint32_t len);
-					bool HandleWrite(uint64_t sector, uint8_t *buffer, uint32_t len);
+					void ProcessEvents(std::vector<VirtIOQueueEvent *> &events) override;
+					void CompleteEvent(VirtIOQueueEvent *evt, uint8_t status);
 
 					struct {
 						uint64_t capacity; // 0
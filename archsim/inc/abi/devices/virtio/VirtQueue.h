@@ -126,7 +126,9 @@ namespace archsim
 
 					inline const VirtRing::VirtRingDesc *PopDescriptorChainHead(uint16_t& out_idx)
 					{
-						uint16_t num_heads = ring.GetAvailable()->idx - last_avail_idx;
+						// The guest fills in the ring before publishing the new index,
+						// possibly from a different host thread.
+						uint16_t num_heads = __atomic_load_n(&ring.GetAvailable()->idx, __ATOMIC_ACQUIRE) - last_avail_idx;
 						assert(num_heads < size);
 
 						if (num_heads == 0)
@@ -154,7 +156,7 @@ namespace archsim
 						ring.GetUsed()->ring[idx].len = len;
 
 						uint16_t old = ring.GetUsed()->idx;
-						ring.GetUsed()->idx = old + 1;
+						__atomic_store_n(&ring.GetUsed()->idx, (uint16_t)(old + 1), __ATOMIC_RELEASE);
 					}
 
 					inline uint32_t Index()
@@ -0,0 +1,80 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   ShadowPageTable.h
+ *
+ * A flat guest-virtual to host page table for user mode emulation. The
+ * table is a single MAP_NORESERVE region with one host page pointer per
+ * guest page, so only the parts of the table which cover pages the guest
+ * actually touches are ever backed by host memory. Entries are filled
+ * lazily from the memory model, and a null entry means that the page has
+ * not been looked up yet.
+ *
+ * Entries are never invalidated, so this is only suitable for memory models
+ * where a guest page always maps to the same host page once it has been
+ * locked (e.g. the contiguous and sparse memory models).
+ */
+
+#ifndef SHADOWPAGETABLE_H
+#define SHADOWPAGETABLE_H
+
+#include "abi/Address.h"
+
+#include <mutex>
+
+namespace archsim
+{
+	namespace abi
+	{
+		namespace memory
+		{
+			class MemoryModel;
+
+			class ShadowPageTable
+			{
+			public:
+				ShadowPageTable(MemoryModel &mem_model, unsigned address_bits);
+				~ShadowPageTable();
+
+				bool Initialise();
+
+				// Returns the host address for the given guest address, or
+				// nullptr if the memory model could not provide one.
+				void *Translate(Address addr)
+				{
+					auto page = addr.GetPageIndex();
+					if(page < entry_count_) {
+						void *entry = table_[page];
+						if(entry != nullptr) {
+							return (char*)entry + addr.GetPageOffset();
+						}
+					}
+
+					return TranslateSlow(addr);
+				}
+
+				void Clear();
+
+				void **GetTable() const
+				{
+					return table_;
+				}
+				uint64_t GetEntryCount() const
+				{
+					return entry_count_;
+				}
+
+			private:
+				void *TranslateSlow(Address addr);
+
+				MemoryModel &mem_model_;
+				unsigned address_bits_;
+				uint64_t entry_count_;
+				void **table_;
+				std::mutex fill_lock_;
+			};
+		}
+	}
+}
+
+#endif /* SHADOWPAGETABLE_H */
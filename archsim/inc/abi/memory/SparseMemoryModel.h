@@ -13,8 +13,7 @@
 #include "abi/memory/MemoryModel.h"
 #include "abi/memory/MemoryTranslationModel.h"
 #include "concurrent/LWLock.h"
-#include "util/Cache.h"
-#include <map>
+#include <atomic>
 #include <mutex>
 #include <string>
 
@@ -68,19 +67,53 @@ namespace archsim
 				bool DeallocateVMA(GuestVMA &vma);
 				bool ResizeVMA(GuestVMA &vma, guest_size_t new_size);
 			private:
-				char *GetPage(Address addr);
-				char *GetPageUncached(Address addr);
-
-				archsim::util::Cache<Address::underlying_t, char*> cache_;
-
-				Address prev_page_base_;
-				char *prev_page_data_;
+				// Pages are found through a radix tree indexed by guest page
+				// number. Nodes and pages are only ever added (until the model
+				// is destroyed), and are fully initialised before they are
+				// published, so lookups need no lock.
+				static const unsigned kLevelBits = 13;
+				static const unsigned kLevels = 4;
+				static const uint64_t kLevelMask = (1ULL << kLevelBits) - 1;
+
+				struct PageTableNode {
+					PageTableNode();
+
+					std::atomic<void *> Entries[1 << kLevelBits];
+				};
+
+				char *GetPage(Address addr)
+				{
+					char *page = LookupPage(addr);
+					if(page == nullptr) {
+						page = AllocatePage(addr);
+					}
+					return page;
+				}
+
+				char *LookupPage(Address addr) const
+				{
+					uint64_t index = addr.GetPageIndex();
+
+					const PageTableNode *node = page_table_;
+					for(unsigned level = kLevels - 1; level > 0; --level) {
+						node = (const PageTableNode *)node->Entries[(index >> (level * kLevelBits)) & kLevelMask].load(std::memory_order_acquire);
+						if(node == nullptr) {
+							return nullptr;
+						}
+					}
+
+					return (char *)node->Entries[index & kLevelMask].load(std::memory_order_acquire);
+				}
+
+				char *AllocatePage(Address addr);
+				void FreePageTable(PageTableNode *node, unsigned level);
+
+				PageTableNode *page_table_;
 				std::mutex map_lock_;
 
 				uint64_t pages_remaining_;
 
 				SparseMemoryTranslationModel* translation_model;
-				std::map<Address, char*> data_;
 			};
 		}
 	}
@@ -5,6 +5,15 @@
  * Author: s0457958
  *
  * Created on 28 October 2014, 17:01
+ *
+ * Guest physical memory which is mapped directly into the host address space,
+ * from a backing file (or an anonymous memory file if none is given). Guest
+ * physical address X is at offset X in the backing file, and at mem_base + X
+ * in the host.
+ *
+ * If the backing file is mapped privately, guest writes are copy-on-write and
+ * never reach the file. This allows many simulator instances to share one
+ * memory image (for example, a snapshot of an already booted system).
  */
 
 #ifndef MMAPSYSTEMMEMORYMODEL_H
@@ -12,25 +21,16 @@
 
 #include "abi/memory/MemoryModel.h"
 
-class System;
-
-namespace gensim
-{
-	class Processor;
-}
+#include <map>
+#include <string>
 
 namespace archsim
 {
 	namespace abi
 	{
-		namespace devices
-		{
-			class MMU;
-		}
-
 		namespace memory
 		{
-			class MMAPPhysicalMemory : public MemoryModel
+			class MMAPPhysicalMemory : public RegionBasedMemoryModel
 			{
 			public:
 				MMAPPhysicalMemory();
@@ -49,69 +49,60 @@ namespace archsim
 
 				bool ResolveGuestAddress(host_const_addr_t host_addr, guest_addr_t &guest_addr) override;
 
+				bool LockRegion(guest_addr_t guest_addr, guest_size_t guest_size, host_addr_t& host_addr) override;
+				bool LockRegions(guest_addr_t guest_addr, guest_size_t guest_size, LockedMemoryRegion& regions) override;
+				bool UnlockRegion(guest_addr_t guest_addr, guest_size_t guest_size, host_addr_t host_addr) override;
+
+				/**
+				 * Write the contents of every mapped region to the given file, at
+				 * offsets equal to their guest physical addresses. Pages which are
+				 * entirely zero are left as holes. The file can then be used as a
+				 * backing file for later runs. An existing file is replaced, rather
+				 * than overwritten, so it's safe to snapshot to the backing file.
+				 */
+				bool SaveSnapshot(const std::string &filename);
+
 				int GetPhysMemFD() const
 				{
 					return physmem_fd;
 				}
 
-			private:
-				int physmem_fd;
-			};
+				static const uint64_t kPhysicalMemorySize = 0x100000000ULL;
 
-			class MMAPVirtualMemory : public MemoryModel
-			{
-			public:
-				MMAPVirtualMemory(System& system, MMAPPhysicalMemory& physmem);
-				virtual ~MMAPVirtualMemory();
+			protected:
+				bool AllocateVMA(GuestVMA &vma) override;
+				bool DeallocateVMA(GuestVMA &vma) override;
+				bool ResizeVMA(GuestVMA &vma, guest_size_t new_size) override;
+				bool SynchroniseVMAProtection(GuestVMA &vma) override;
 
-				bool Initialise() override;
-				void Destroy() override;
-
-				MemoryTranslationModel &GetTranslationModel() override;
-
-				uint32_t Read(guest_addr_t addr, uint8_t *data, int size) override;
-				uint32_t Fetch(guest_addr_t addr, uint8_t *data, int size) override;
-				uint32_t Write(guest_addr_t addr, uint8_t *data, int size) override;
-				uint32_t Peek(guest_addr_t addr, uint8_t *data, int size) override;
-				uint32_t Poke(guest_addr_t addr, uint8_t *data, int size) override;
-
-				bool ResolveGuestAddress(host_const_addr_t host_addr, guest_addr_t &guest_addr) override;
+			private:
+				bool OpenBacking();
+				bool MapRange(guest_addr_t base, guest_size_t size, RegionFlags prot);
+				void ReleaseRange(guest_addr_t base, guest_size_t size);
 
-				inline void SetCPU(gensim::Processor& cpu)
+				inline bool InRange(guest_addr_t addr, uint64_t size) const
 				{
-					this->cpu = &cpu;
-				}
-				inline gensim::Processor& GetCPU() const
-				{
-					return *cpu;
-				}
-				inline void SetMMU(devices::MMU& mmu)
-				{
-					this->mmu = &mmu;
-				}
-				inline devices::MMU& GetMMU() const
-				{
-					return *mmu;
+					return addr.Get() < kPhysicalMemorySize && size <= kPhysicalMemorySize - addr.Get();
 				}
 
-				inline MMAPPhysicalMemory& GetPhysicalMemory() const
+				inline host_addr_t GuestToHost(guest_addr_t addr) const
 				{
-					return physmem;
+					return (host_addr_t)((uintptr_t)mem_base_ + addr.Get());
 				}
 
-				void FlushCaches();
-				void EvictCacheEntry(virt_addr_t virt_addr);
-
-			private:
-				System& system;
+				MemoryTranslationModel *translation_model;
 
-				gensim::Processor *cpu;
-				devices::MMU *mmu;
+				int physmem_fd;
+				bool private_;
+				bool huge_pages_;
+				uint64_t backing_size_;
 
-				MMAPPhysicalMemory& physmem;
+				// The host reservation which holds guest physical memory
+				void *reservation_;
+				size_t reservation_size_;
+				host_addr_t mem_base_;
 
-				uint8_t *contiguous_base;
-				size_t contiguous_size;
+				std::map<guest_addr_t, GuestVMA *> mapped_vmas_;
 			};
 		}
 	}
@@ -16,6 +16,7 @@
 #include "gensim/gensim_decode.h"
 #include "blockjit/translation-context.h"
 #include "abi/Address.h"
+#include "core/arch/RegisterFileDescriptor.h"
 
 
 namespace gensim
@@ -80,6 +81,7 @@ namespace archsim
 			private:
 				uint8_t itstate_;
 				const archsim::ArchDescriptor &arch_;
+				archsim::RegisterFileEntryHandle<uint8_t> itstate_entry_;
 			};
 
 		}
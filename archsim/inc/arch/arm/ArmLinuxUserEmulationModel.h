@@ -11,6 +11,7 @@
 #define	ARMLINUXUSEREMULATIONMODEL_H
 
 #include "abi/LinuxUserEmulationModel.h"
+#include "core/arch/RegisterFileDescriptor.h"
 
 namespace archsim
 {
@@ -60,6 +61,7 @@ namespace archsim
 				}
 
 				ArmLinuxABIVersion abi_version;
+				archsim::RegisterFileEntryHandle<uint32_t> registers_;
 			};
 		}
 	}
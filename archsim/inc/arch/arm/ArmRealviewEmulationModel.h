@@ -12,6 +12,7 @@
 
 #include "abi/LinuxSystemEmulationModel.h"
 #include "abi/devices/generic/block/FileBackedBlockDevice.h"
+#include "core/arch/ArchDescriptor.h"
 
 namespace archsim
 {
@@ -55,6 +56,13 @@ namespace archsim
 
 				void HandleSemihostingCall();
 
+				// Looked up once the cores have been created, so exceptions
+				// and interrupts don't need any string lookups
+				void ResolveArchHandles(const archsim::ArchDescriptor &arch);
+
+				const archsim::BehaviourDescriptor *take_exception_;
+				const archsim::BehaviourDescriptor *take_interrupt_;
+				archsim::RegisterFileEntryHandle<uint8_t> itstate_entry_;
 			};
 		}
 	}
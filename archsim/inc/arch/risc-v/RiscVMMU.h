@@ -77,6 +77,10 @@ namespace archsim
 
 				MMU::TranslateResult Translate(archsim::core::thread::ThreadInstance* cpu, Address virt_addr, Address& phys_addr, archsim::abi::devices::AccessInfo info) override;
 				const archsim::abi::devices::PageInfo GetInfo(Address virt_addr) override;
+				uint32_t GetASID() override
+				{
+					return asid_;
+				}
 
 				Mode GetMode() const;
 
@@ -84,6 +88,9 @@ namespace archsim
 				void SetSATP(uint64_t new_satp);
 				int GetPTLevels(Mode mode) const;
 
+				void SaveState(archsim::util::CheckpointWriter &writer) override;
+				bool RestoreState(archsim::util::CheckpointReader &reader) override;
+
 			private:
 				using PTEInfo = std::tuple<archsim::Address, archsim::abi::devices::PageInfo>;
 				PTEInfo GetInfoLevel(Address virt_addr, Address table, int level);
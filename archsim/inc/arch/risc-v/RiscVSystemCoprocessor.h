@@ -76,6 +76,12 @@ namespace archsim
 					return IE.MTIE;
 				}
 
+				// The interrupt lines to the hart are driven again once the
+				// pending and enabled interrupts have been restored
+				void SaveState(archsim::util::CheckpointWriter &writer) override;
+				bool RestoreState(archsim::util::CheckpointReader &reader) override;
+				void StateRestored() override;
+
 
 			private:
 				uint64_t MTVEC;
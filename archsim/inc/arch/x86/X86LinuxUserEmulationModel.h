@@ -11,6 +11,7 @@
 #define	ARMLINUXUSEREMULATIONMODEL_H
 
 #include "abi/LinuxUserEmulationModel.h"
+#include "core/arch/RegisterFileDescriptor.h"
 
 namespace archsim
 {
@@ -37,6 +38,7 @@ namespace archsim
 
 			private:
 				Address vdso_ptr_;
+				archsim::RegisterFileEntryHandle<uint64_t> registers_;
 			};
 		}
 	}
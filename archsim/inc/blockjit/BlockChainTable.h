@@ -0,0 +1,95 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * BlockChainTable.h
+ *
+ * Keeps track of direct jumps which have been patched between translated
+ * blocks, so that they can be unlinked again before either end of the chain
+ * is invalidated or freed.
+ *
+ * A chain site is the rel32 field of a 'jmp' instruction emitted by the
+ * DISPATCH lowering. An unlinked site has a displacement of zero, and so
+ * falls through into a stub which reports the site back to the dispatcher.
+ */
+
+#ifndef INC_BLOCKJIT_BLOCKCHAINTABLE_H_
+#define INC_BLOCKJIT_BLOCKCHAINTABLE_H_
+
+#include "blockjit/ir.h"
+#include "abi/Address.h"
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace archsim
+{
+	using captive::shared::block_txln_fn;
+
+	namespace blockjit
+	{
+
+		class BlockChainTable
+		{
+		public:
+			typedef uint8_t *chain_site_t;
+
+			/**
+			 * Patch the given site to jump directly to target. phys_page is the
+			 * physical page containing the target, used for page invalidation.
+			 * Returns false if the site could not be linked (e.g. the target is
+			 * out of range of a rel32 jump).
+			 */
+			bool Link(chain_site_t site, block_txln_fn target, Address phys_page);
+
+			/**
+			 * Called just before the code for fn (of the given size) is freed. Any
+			 * sites within fn are forgotten, and any sites which jump to fn are
+			 * unlinked.
+			 */
+			void Release(block_txln_fn fn, size_t size);
+
+			/**
+			 * Unlink every site which jumps to target, e.g. because a better
+			 * translation of the same block has replaced it. Unlike Release, sites
+			 * within target remain linked.
+			 */
+			void UnlinkTarget(block_txln_fn target);
+
+			/**
+			 * Unlink every site which jumps to a block on the given physical page.
+			 */
+			void UnlinkPage(Address phys_addr);
+
+			/**
+			 * Unlink every site.
+			 */
+			void UnlinkAll();
+
+			size_t GetLinkCount() const
+			{
+				return sites_.size();
+			}
+
+		private:
+			struct ChainLink {
+				block_txln_fn target;
+				Address::underlying_t page;
+			};
+
+			static void patch(chain_site_t site, int32_t displacement);
+			void unlink(chain_site_t site);
+			void unlinkTarget(block_txln_fn target);
+
+			std::mutex lock_;
+
+			std::map<chain_site_t, ChainLink> sites_;
+			std::unordered_map<block_txln_fn, std::vector<chain_site_t>> sites_by_target_;
+			std::unordered_map<Address::underlying_t, std::vector<chain_site_t>> sites_by_page_;
+		};
+
+	}
+}
+
+#endif /* INC_BLOCKJIT_BLOCKCHAINTABLE_H_ */
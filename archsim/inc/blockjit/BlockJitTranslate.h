@@ -60,8 +60,14 @@ namespace gensim
 
 			void setSupportChaining(bool enable);
 			void setSupportProfiling(bool enable);
+			void setBlockCounter(uint64_t *counter);
 			void setTranslationMgr(archsim::translate::TranslationManager *txln_mgr);
 
+			// Returns true if translations made for this thread with the current
+			// options only refer to the host through relocatable helper
+			// addresses, and so could be saved and reused by another run.
+			bool CanPersistTranslations(archsim::core::thread::ThreadInstance *cpu) const;
+
 			void InitialiseFeatures(const archsim::core::thread::ThreadInstance *cpu);
 			void SetFeatureLevel(uint32_t feature, uint32_t level, captive::shared::IRBuilder& builder);
 			uint32_t GetFeatureLevel(uint32_t feature);
@@ -106,12 +112,16 @@ namespace gensim
 			archsim::translate::TranslationManager *_txln_mgr;
 			bool _supportProfiling;
 
+			// Incremented on entry to the next block translated, if set
+			uint64_t *_block_counter;
+
 			bool _should_be_dumped;
 
 			bool compile_block(archsim::core::thread::ThreadInstance *cpu, archsim::Address block_address, captive::arch::jit::TranslationContext &ctx, archsim::blockjit::BlockTranslation &fn, wulib::MemAllocator &allocator);
 
 			bool emit_block(archsim::core::thread::ThreadInstance *cpu, archsim::Address block_address, captive::shared::IRBuilder &ctx, std::unordered_set<archsim::Address> &block_heads);
 			bool emit_chain(archsim::core::thread::ThreadInstance *cpu, archsim::Address block_address, gensim::BaseDecode *insn, captive::shared::IRBuilder &ctx);
+			void emit_instruction_tick(uint32_t count, captive::shared::IRBuilder &ctx);
 
 			bool can_merge_jump(archsim::core::thread::ThreadInstance *cpu, gensim::BaseDecode *decode, archsim::Address pc);
 			archsim::Address get_jump_target(archsim::core::thread::ThreadInstance *cpu, gensim::BaseDecode *decode, archsim::Address pc);
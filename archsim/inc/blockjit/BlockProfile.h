@@ -11,6 +11,7 @@
 #define INC_BLOCKJIT_BLOCKPROFILE_H_
 
 #include "blockjit/ir.h"
+#include "blockjit/BlockChainTable.h"
 #include "abi/Address.h"
 #include "util/MemAllocator.h"
 #include "util/LogContext.h"
@@ -22,6 +23,7 @@
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 UseLogContext(LogBlockProfile);
 
@@ -36,15 +38,19 @@ namespace archsim
 		class BlockTranslation
 		{
 		public:
-			BlockTranslation() : fn_(nullptr), features_required_(nullptr), size_(0) {}
+			BlockTranslation() : fn_(nullptr), features_required_(nullptr), relocations_(nullptr), size_(0) {}
 			BlockTranslation(const BlockTranslation &other) :
 				fn_(other.fn_),
 				features_required_(nullptr),
+				relocations_(nullptr),
 				size_(other.size_)
 			{
 				if(other.features_required_ != nullptr) {
 					features_required_ = new ProcessorFeatureSet(*other.features_required_);
 				}
+				if(other.relocations_ != nullptr) {
+					relocations_ = new std::vector<uint32_t>(*other.relocations_);
+				}
 			}
 
 			~BlockTranslation()
@@ -87,9 +93,13 @@ namespace archsim
 					delete features_required_;
 					features_required_ = nullptr;
 				}
+				if(relocations_) {
+					delete relocations_;
+					relocations_ = nullptr;
+				}
 			}
 
-			archsim::ProcessorFeatureSet GetFeatures()
+			archsim::ProcessorFeatureSet GetFeatures() const
 			{
 				if(features_required_)
 					return *features_required_;
@@ -105,18 +115,32 @@ namespace archsim
 				return size_;
 			}
 
+			// Offsets of the host addresses embedded in this translation's code.
+			// These are only kept for translations which can be saved to a
+			// persistent translation cache.
+			void SetRelocations(const std::vector<uint32_t> &relocations)
+			{
+				if(relocations_) delete relocations_;
+				relocations_ = new std::vector<uint32_t>(relocations);
+			}
+			const std::vector<uint32_t> *GetRelocations() const
+			{
+				return relocations_;
+			}
+
 			void Dump(const std::string &filename);
 
 		private:
 			block_txln_fn fn_;
 			archsim::ProcessorFeatureSet *features_required_;
+			std::vector<uint32_t> *relocations_;
 			size_t size_;
 		};
 
 		class BlockPageProfile
 		{
 		public:
-			BlockPageProfile(wulib::MemAllocator &allocator);
+			BlockPageProfile(wulib::MemAllocator &allocator, BlockChainTable *chains);
 			~BlockPageProfile();
 
 			void Insert(Address address, const BlockTranslation &txln);
@@ -140,6 +164,45 @@ namespace archsim
 				_dirty = true;
 			}
 
+			// The number of bytes of translated code on this page
+			size_t GetCodeSize() const
+			{
+				return _code_size;
+			}
+
+			// Access bits for code cache eviction. A page is marked as
+			// accessed whenever one of its translations is looked up.
+			void MarkAccessed()
+			{
+				_accessed = true;
+			}
+			bool TestAndClearAccessed()
+			{
+				bool accessed = _accessed;
+				_accessed = false;
+				return accessed;
+			}
+
+			// Set on pages whose translations were evicted (rather than
+			// invalidated), so that retranslations can be counted
+			bool IsEvicted() const
+			{
+				return _evicted;
+			}
+			void SetEvicted(bool evicted)
+			{
+				_evicted = evicted;
+			}
+
+			bool IsResident() const
+			{
+				return _resident;
+			}
+			void SetResident(bool resident)
+			{
+				_resident = resident;
+			}
+
 		private:
 			static const uint32_t kPageSize = archsim::translate::profile::RegionArch::PageSize;
 			// XXX ARM HAX
@@ -161,24 +224,41 @@ namespace archsim
 
 			std::array<table_chunk_t*, kMaxBlocksPerPage/kBlocksPerChunk> _table;
 
-			std::unordered_set<block_txln_fn> _txlns;
+			void releaseTxln(block_txln_fn fn, size_t size);
+
+			std::unordered_map<block_txln_fn, size_t> _txlns;
 
 			wulib::MemAllocator &_allocator;
+			BlockChainTable *_chains;
+
+			size_t _code_size;
 
 			bool _dirty:1;
 			bool _valid:1;
+			bool _accessed:1;
+			bool _evicted:1;
+			bool _resident:1;
 		};
 
 
 		class BlockProfile
 		{
 		public:
-			BlockProfile(wulib::MemAllocator &allocator);
+			BlockProfile(wulib::MemAllocator &allocator, BlockChainTable *chains = nullptr);
 
-			void Insert(Address address, const BlockTranslation &txln);
+			// Returns true if the translation replaces one which was evicted
+			bool Insert(Address address, const BlockTranslation &txln);
 			void InvalidatePage(Address address);
 			void Invalidate();
 
+			/*
+			 * Evict whole pages of translations, using the CLOCK algorithm,
+			 * until the total code size is no more than target_size. Pages
+			 * which have been looked up since the last sweep get a second
+			 * chance. Returns the number of pages evicted.
+			 */
+			uint64_t EvictPages(uint64_t target_size);
+
 			uint64_t GetTotalCodeSize()
 			{
 				return code_size_;
@@ -202,12 +282,16 @@ namespace archsim
 
 			BlockTranslation Get(Address address, const archsim::ProcessorFeatureSet &features)
 			{
-				auto txln = getProfile(address).Get(address);
+				auto &profile = getProfile(address);
+				auto txln = profile.Get(address);
 
 				if(txln.IsValid(features)) {
+					profile.MarkAccessed();
 					return txln;
 				} else {
-					getProfile(address).InvalidateTxln(address);
+					size_t old_size = profile.GetCodeSize();
+					profile.InvalidateTxln(address);
+					code_size_ -= old_size - profile.GetCodeSize();
 					return txln;
 				}
 			}
@@ -223,7 +307,7 @@ namespace archsim
 			BlockPageProfile &getProfile(Address address)
 			{
 				if(!hasProfile(address)) {
-					_page_profiles[address.GetPageIndex()] = new BlockPageProfile(_allocator);
+					_page_profiles[address.GetPageIndex()] = new BlockPageProfile(_allocator, _chains);
 				}
 				return *_page_profiles[address.GetPageIndex()];
 			}
@@ -236,10 +320,15 @@ namespace archsim
 
 			std::vector<std::pair<Address, BlockPageProfile *> > _dirty_pages;
 
+			// Pages which (may) hold translations, in CLOCK order
+			std::vector<std::pair<Address, BlockPageProfile *> > _resident_pages;
+			size_t _clock_hand;
+
 			uint64_t code_size_;
 
 			BlockPageProfile *_page_profiles[kProfileCount];
 			wulib::MemAllocator &_allocator;
+			BlockChainTable *_chains;
 		};
 
 	}
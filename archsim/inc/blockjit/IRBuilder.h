@@ -110,6 +110,7 @@ namespace captive
 			INSN4(vsubi, VSUBI);
 			INSN4(vsubf, VSUBF);
 			INSN4(vmulf, VMULF);
+			INSN4(vmuli, VMULI);
 			INSN4(vori, VORI);
 			INSN4(vandi, VANDI);
 			INSN4(vxori, VXORI);
@@ -117,6 +118,18 @@ namespace captive
 			INSN4(vcmpgti, VCMPGTI);
 			INSN4(vcmpgtei, VCMPGTEI);
 			INSN4(vcmp_ltf, VCMPLTF);
+			INSN4(vcmp_eqf, VCMPEQF);
+			INSN4(vcmp_ltef, VCMPLTEF);
+			INSN4(vmini, VMINI);
+			INSN4(vmaxi, VMAXI);
+			INSN4(vminui, VMINUI);
+			INSN4(vmaxui, VMAXUI);
+			INSN4(vminf, VMINF);
+			INSN4(vmaxf, VMAXF);
+			INSN4(vshuffle, VSHUFFLE);
+			INSN3(vsx, VSX);
+			INSN3(vzx, VZX);
+			INSN3(vtrunc, VTRUNC);
 
 			INSN1(fctrl_set_round, FCTRL_SET_ROUND);
 			INSN1(fctrl_get_round, FCTRL_GET_ROUND);
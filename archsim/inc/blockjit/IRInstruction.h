@@ -150,6 +150,12 @@ namespace captive
 				FCTRL_SET_FLUSH_DENORMAL,
 				FCTRL_GET_FLUSH_DENORMAL,
 
+				// Vector operations take the number of lanes as a constant
+				// first operand, and get the element size from the operand
+				// sizes, so VSX/VZX/VTRUNC widen or narrow each lane to fit
+				// the destination. Comparisons give all-ones or all-zeroes
+				// lanes. VSHUFFLE picks bytes of the first source using the
+				// second, giving zero for out of range indices.
 				VADDI,
 				VADDF,
 				VSUBI,
@@ -164,6 +170,21 @@ namespace captive
 				VCMPGTI,
 				VCMPGTEI,
 				VCMPLTF,
+				VCMPEQF,
+				VCMPLTEF,
+
+				VMINI,
+				VMAXI,
+				VMINUI,
+				VMAXUI,
+				VMINF,
+				VMAXF,
+
+				VSHUFFLE,
+
+				VSX,
+				VZX,
+				VTRUNC,
 
 				_END
 			};
@@ -199,10 +220,12 @@ namespace captive
 			{
 				return IRInstruction(RET);
 			}
-			static IRInstruction dispatch(const IROperand &target, const IROperand &fallthrough, const IROperand &target_block, const IROperand &fallthrough_block)
+			// target and fallthrough are the (same page) PCs to emit direct chain sites
+			// for, or zero. The counters are bumped when a chain is taken or missed.
+			static IRInstruction dispatch(const IROperand &target, const IROperand &fallthrough, const IROperand &chained_counter, const IROperand &unchained_counter)
 			{
 				assert(target.is_constant() && fallthrough.is_constant());
-				return IRInstruction(DISPATCH, target, fallthrough, target_block, fallthrough_block);
+				return IRInstruction(DISPATCH, target, fallthrough, chained_counter, unchained_counter);
 			}
 			static IRInstruction trap()
 			{
@@ -0,0 +1,77 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   InvalidationEpochs.h
+ *
+ * Keeps track of when guest code was invalidated, so that work started on
+ * some code before then (e.g. a background translation) can be recognised as
+ * stale. Invalidations are tracked per page, so invalidating one page
+ * doesn't throw away work on the rest of memory.
+ *
+ * This class is not synchronised.
+ */
+
+#ifndef INVALIDATIONEPOCHS_H
+#define INVALIDATIONEPOCHS_H
+
+#include "abi/Address.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace archsim
+{
+	namespace blockjit
+	{
+		class InvalidationEpochs
+		{
+		public:
+			typedef uint64_t epoch_t;
+
+			InvalidationEpochs() : current_(0), flushed_(0) {}
+
+			// The epoch to record when starting work on some code
+			epoch_t Current() const
+			{
+				return current_;
+			}
+
+			void InvalidatePage(Address addr)
+			{
+				pages_[addr.PageBase().Get()] = ++current_;
+			}
+
+			void InvalidateAll()
+			{
+				flushed_ = ++current_;
+				pages_.clear();
+			}
+
+			// Has the code at addr been invalidated since the given epoch?
+			bool IsStale(epoch_t started, Address addr) const
+			{
+				if(started < flushed_) {
+					return true;
+				}
+
+				auto page = pages_.find(addr.PageBase().Get());
+				return page != pages_.end() && started < page->second;
+			}
+
+			// Forget about individual pages. This must only be done when no
+			// work is outstanding which was started before the current epoch.
+			void Prune()
+			{
+				flushed_ = current_;
+				pages_.clear();
+			}
+
+		private:
+			epoch_t current_;
+			epoch_t flushed_;
+			std::unordered_map<Address::underlying_t, epoch_t> pages_;
+		};
+	}
+}
+
+#endif /* INVALIDATIONEPOCHS_H */
@@ -0,0 +1,151 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * PersistentTranslationCache.h
+ *
+ * Keeps BlockJIT translations between simulation runs. Translations are
+ * recorded as they are made, and written to a file when the simulation ends.
+ * The next run maps the file and copies a saved translation into the code
+ * cache (instead of translating the block again) whenever it finds one for
+ * the same virtual PC, ISA mode and page contents.
+ *
+ * Saved code may only refer to the host through helper addresses recorded by
+ * the lowering. These are stored relative to the host image (executable or
+ * shared library) which contains them, and patched when the code is loaded.
+ */
+
+#ifndef INC_BLOCKJIT_PERSISTENTTRANSLATIONCACHE_H_
+#define INC_BLOCKJIT_PERSISTENTTRANSLATIONCACHE_H_
+
+#include "blockjit/BlockProfile.h"
+#include "abi/Address.h"
+#include "util/MemAllocator.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace archsim
+{
+	namespace blockjit
+	{
+
+		class PersistentTranslationCache
+		{
+		public:
+			PersistentTranslationCache();
+			~PersistentTranslationCache();
+
+			/**
+			 * Map a cache file written by a previous run. The file is only used
+			 * if it was saved with the same context, and by the same build of
+			 * the simulator. Returns false if nothing could be loaded.
+			 */
+			bool Load(const std::string &filename, const std::string &context);
+
+			/**
+			 * Write every recorded translation to the given file, replacing it.
+			 */
+			bool Save(const std::string &filename, const std::string &context);
+
+			/**
+			 * Record a translation so that it is included in the next save. The
+			 * translation must carry its host relocations. Returns false if the
+			 * translation can't be saved.
+			 */
+			bool Record(Address virt_pc, uint64_t page_hash, uint32_t isa_mode, const BlockTranslation &txln);
+
+			/**
+			 * Look for a saved translation of the block at virt_pc which is valid
+			 * for the given features. If one is found, it is copied into memory
+			 * from the allocator, relocated, and returned in txln.
+			 */
+			bool Lookup(Address virt_pc, uint64_t page_hash, uint32_t isa_mode, const archsim::ProcessorFeatureSet &features, wulib::MemAllocator &allocator, BlockTranslation &txln);
+
+			bool IsDirty() const
+			{
+				return dirty_;
+			}
+			size_t GetLoadedCount() const
+			{
+				return loaded_count_;
+			}
+			size_t GetRecordedCount() const
+			{
+				return recorded_count_;
+			}
+
+			static uint64_t HashPage(const uint8_t *data, size_t size);
+
+		private:
+			static const uint32_t kVersion = 1;
+			static const char kMagic[8];
+
+			struct Key {
+				uint64_t VirtPC;
+				uint64_t PageHash;
+				uint32_t IsaMode;
+
+				bool operator<(const Key &other) const
+				{
+					if(VirtPC != other.VirtPC) return VirtPC < other.VirtPC;
+					if(PageHash != other.PageHash) return PageHash < other.PageHash;
+					return IsaMode < other.IsaMode;
+				}
+			};
+
+			struct HostRelocation {
+				uint32_t Offset;
+				uint32_t Image;
+				uint64_t ImageOffset;
+			};
+
+			// A host executable or shared library, which saved code may call into
+			struct HostImage {
+				std::string Path;
+				uint64_t FileSize;
+				uint64_t FileMTime;
+				uintptr_t Base;
+				std::vector<std::pair<uintptr_t, uintptr_t>> Segments;
+			};
+
+			struct Entry {
+				std::vector<std::pair<uint32_t, uint32_t>> Features;
+				std::vector<HostRelocation> Relocations;
+
+				// Either points into the mapped file, or at OwnedCode
+				const uint8_t *Code;
+				uint32_t CodeSize;
+				std::vector<uint8_t> OwnedCode;
+			};
+
+			typedef std::map<Key, std::vector<Entry>> entry_map_t;
+
+			void scanImages();
+			bool resolveHostAddress(uintptr_t address, uint32_t &image, uint64_t &image_offset);
+			uint32_t getSelfImage();
+
+			static bool featuresMatch(const Entry &entry, const archsim::ProcessorFeatureSet &features);
+
+			std::mutex lock_;
+
+			std::vector<HostImage> images_;
+
+			// Translations from the mapped file, with their relocations already
+			// converted to refer to images_
+			entry_map_t loaded_;
+			void *mapping_;
+			size_t mapping_size_;
+
+			entry_map_t recorded_;
+
+			size_t loaded_count_;
+			size_t recorded_count_;
+			bool dirty_;
+		};
+
+	}
+}
+
+#endif /* INC_BLOCKJIT_PERSISTENTTRANSLATIONCACHE_H_ */
@@ -17,6 +17,8 @@
 #include "util/MemAllocator.h"
 
 #include <string.h>
+#include <string>
+#include <vector>
 
 namespace captive
 {
@@ -31,14 +33,24 @@ namespace captive
 				class LoweringResult
 				{
 				public:
-					LoweringResult(captive::shared::block_txln_fn fn, size_t size) : Function(fn), Size(size) {}
+					LoweringResult(captive::shared::block_txln_fn fn, size_t size) : Function(fn), Size(size), PositionIndependent(false) {}
 
 					captive::shared::block_txln_fn Function;
 					size_t Size;
+
+					// True if the code can be moved to another address (or process)
+					// by patching the host addresses at the given offsets.
+					bool PositionIndependent;
+					std::vector<uint32_t> HostRelocations;
 				};
 
 				LoweringResult NativeLowering(TranslationContext &ctx, wulib::MemAllocator &allocator, const archsim::ArchDescriptor &arch, const archsim::StateBlockDescriptor &state, const CompileResult &compile_result);
 				bool HasNativeLowering();
+
+				// Describes the host features used by the generated code, so
+				// that code saved on one host isn't reused on a host without
+				// them.
+				std::string GetNativeLoweringFeatures();
 			}
 		}
 	}
@@ -64,6 +64,9 @@ LowerType(WriteUserMemCache)
 LowerTypeTS(ReadMemUser)
 LowerTypeTS(WriteMemUser)
 
+LowerType(ReadMemShadow)
+LowerType(WriteMemShadow)
+
 LowerType(FMul)
 LowerType(FDiv)
 LowerType(FAdd)
@@ -86,9 +89,17 @@ LowerType(FCtrl_GetFlush)
 LowerType(VAddF)
 LowerType(VAddI)
 LowerType(VCmpEQI)
+LowerType(VCmpGTI)
+LowerType(VCmpF)
 LowerType(VSubF)
 LowerType(VSubI)
 LowerType(VMulF)
 LowerType(VMulI)
+LowerType(VBitwise)
+LowerType(VMinMaxI)
+LowerType(VMinMaxF)
+LowerType(VShuffle)
+LowerType(VExtend)
+LowerType(VTrunc)
 
 #endif
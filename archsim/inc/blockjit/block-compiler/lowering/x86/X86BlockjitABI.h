@@ -52,5 +52,7 @@
 #define BLKJIT_FP_0 X86Reg(REG_XMM0)
 #define BLKJIT_FP_1 X86Reg(REG_XMM1)
 #define BLKJIT_FP_2 X86Reg(REG_XMM2)
+#define BLKJIT_FP_3 X86Reg(REG_XMM3)
+#define BLKJIT_FP_4 X86Reg(REG_XMM4)
 
 #endif /* INC_BLOCKJIT_BLOCKJIT_ABI_H_ */
@@ -13,6 +13,7 @@
 #include "define.h"
 #include "util/MemAllocator.h"
 #include <malloc.h>
+#include <vector>
 
 namespace captive
 {
@@ -111,12 +112,54 @@ namespace captive
 						}
 					};
 
+					// Packed operations on xmm registers, emitted through
+					// X86Encoder::vector_op. See the encoding table in
+					// X86Encoder.cpp.
+					enum X86VectorOp {
+						VOP_PADDB, VOP_PADDW, VOP_PADDD, VOP_PADDQ,
+						VOP_PSUBB, VOP_PSUBW, VOP_PSUBD, VOP_PSUBQ,
+						VOP_PMULLW, VOP_PMULLD, VOP_PMULUDQ,
+
+						VOP_PCMPEQB, VOP_PCMPEQW, VOP_PCMPEQD, VOP_PCMPEQQ,
+						VOP_PCMPGTB, VOP_PCMPGTW, VOP_PCMPGTD, VOP_PCMPGTQ,
+
+						VOP_PMINSB, VOP_PMINSW, VOP_PMINSD,
+						VOP_PMINUB, VOP_PMINUW, VOP_PMINUD,
+						VOP_PMAXSB, VOP_PMAXSW, VOP_PMAXSD,
+						VOP_PMAXUB, VOP_PMAXUW, VOP_PMAXUD,
+
+						VOP_PAND, VOP_PANDN, VOP_POR, VOP_PXOR,
+						VOP_PADDUSB,
+						VOP_PACKSSWB, VOP_PACKSSDW,
+						VOP_PSHUFB,
+
+						VOP_ADDPS, VOP_ADDPD, VOP_SUBPS, VOP_SUBPD,
+						VOP_MULPS, VOP_MULPD,
+						VOP_MINPS, VOP_MINPD, VOP_MAXPS, VOP_MAXPD,
+						VOP_CMPPS, VOP_CMPPD,
+
+						// Unary operations
+						VOP_PSHUFD,
+						VOP_PMOVSXBW, VOP_PMOVSXBD, VOP_PMOVSXBQ, VOP_PMOVSXWD, VOP_PMOVSXWQ, VOP_PMOVSXDQ,
+						VOP_PMOVZXBW, VOP_PMOVZXBD, VOP_PMOVZXBQ, VOP_PMOVZXWD, VOP_PMOVZXWQ, VOP_PMOVZXDQ,
+						VOP_PBROADCASTD,
+
+						// Shifts by an immediate
+						VOP_PSLLW, VOP_PSLLD, VOP_PSLLQ,
+						VOP_PSRLW, VOP_PSRLD, VOP_PSRLQ,
+						VOP_PSRAW, VOP_PSRAD,
+					};
+
 					class X86Encoder
 					{
 					public:
 						X86Encoder(wulib::MemAllocator &allocator);
 						X86Encoder(const X86Encoder &other) = delete;
 
+						// Host instruction set support, detected once with cpuid
+						static bool HostSupportsSSE42();
+						static bool HostSupportsAVX2();
+
 						inline uint8_t *get_buffer()
 						{
 							return _buffer;
@@ -144,6 +187,7 @@ namespace captive
 						void wbinvd();
 						void invlpg(const X86Memory& addr);
 						void lea(const X86Memory& addr, const X86Register& dst);
+						void lea_rip(uint32_t target_offset, const X86Register& dst);
 
 						void bswap(const X86Register &dst);
 
@@ -206,6 +250,37 @@ namespace captive
 
 						void pxor(const X86VectorRegister &src, const X86VectorRegister &dest);
 
+						// Whole-register moves. These take the same encoding as
+						// vector_op, so they never mix SSE and AVX forms.
+						void movdqa(const X86VectorRegister &src, const X86VectorRegister &dest);
+						void movdqu(const X86Memory &src, const X86VectorRegister &dest);
+						void movdqu(const X86VectorRegister &src, const X86Memory &dest);
+						void movq(const X86Memory &src, const X86VectorRegister &dest);
+						void movq(const X86VectorRegister &src, const X86Memory &dest);
+						void movd(const X86Memory &src, const X86VectorRegister &dest);
+						void movd(const X86VectorRegister &src, const X86Memory &dest);
+
+						// dest = src1 <op> src2. With AVX this is a single
+						// non-destructive VEX instruction. Otherwise src1 is
+						// first copied into dest, so dest must not also be src2.
+						// A memory src2 needs AVX, since SSE would require it to
+						// be 16 byte aligned.
+						void vector_op(X86VectorOp op, const X86VectorRegister &src2, const X86VectorRegister &src1, const X86VectorRegister &dest, uint8_t imm = 0);
+						void vector_op(X86VectorOp op, const X86Memory &src2, const X86VectorRegister &src1, const X86VectorRegister &dest, uint8_t imm = 0);
+
+						// dest = <op> src, for unary operations and shifts by an
+						// immediate
+						void vector_op(X86VectorOp op, const X86VectorRegister &src, const X86VectorRegister &dest, uint8_t imm = 0);
+
+						void setAVXEnabled(bool enabled)
+						{
+							_use_avx = enabled;
+						}
+						bool isAVXEnabled() const
+						{
+							return _use_avx;
+						}
+
 						void incq(const X86Memory& loc);
 						void incl(const X86Memory& loc);
 
@@ -217,6 +292,12 @@ namespace captive
 						void mov(const X86Register& src, const X86Memory& dst);
 						void mov(uint64_t src, const X86Register& dst);
 
+						// Load the address of something outside of the generated code
+						// (e.g. a helper function). This is always encoded as a full
+						// 64-bit immediate, and its offset is recorded so that the code
+						// can be relocated.
+						void mov_host(const void *target, const X86Register& dst);
+
 						void movfs(uint32_t off, const X86Register& dst);
 
 						void mov8(uint64_t imm, const X86Memory& dst);
@@ -687,6 +768,23 @@ namespace captive
 							_support_relocation = enabled;
 						}
 
+						// Offsets of the 64-bit immediates emitted by mov_host
+						const std::vector<uint32_t> &get_host_relocations() const
+						{
+							return _host_relocations;
+						}
+
+						// Called when the generated code embeds a host address which
+						// cannot be relocated, such as a pointer to a counter.
+						void mark_position_dependent()
+						{
+							_position_independent = false;
+						}
+						bool is_position_independent() const
+						{
+							return _position_independent;
+						}
+
 					private:
 						uint8_t *_buffer;
 						uint32_t _buffer_size;
@@ -695,6 +793,9 @@ namespace captive
 						wulib::MemAllocator &_allocator;
 
 						bool _support_relocation;
+						bool _position_independent;
+						bool _use_avx;
+						std::vector<uint32_t> _host_relocations;
 
 						inline void ensure_buffer(int extra=0)
 						{
@@ -747,6 +848,14 @@ namespace captive
 
 						void encode_rex_prefix(bool b, bool x, bool r, bool w);
 
+						// Emits the prefixes and opcode of a vector instruction,
+						// as VEX if AVX is enabled. Register numbers include the
+						// high bit. vvvv is the extra source register (-1 if there
+						// isn't one), and is ignored by the SSE encoding.
+						void encode_vector_opcode(uint8_t prefix, uint8_t map, uint8_t opcode, bool r, bool x, bool b, int vvvv);
+						void encode_vector(uint8_t prefix, uint8_t map, uint8_t opcode, uint8_t reg, int vvvv, const X86VectorRegister &rm);
+						void encode_vector(uint8_t prefix, uint8_t map, uint8_t opcode, uint8_t reg, int vvvv, const X86Memory &rm);
+
 						void encode_opcode_mod_rm(uint16_t opcode, const X86Register& reg, const X86Memory& rm);
 						void encode_opcode_mod_rm(uint16_t opcode, const X86Register& reg, const X86Register& rm);
 						void encode_opcode_mod_rm(uint16_t opcode, uint8_t oper, const X86Register& rm);
@@ -79,6 +79,17 @@ namespace captive
 						void encode_operand_function_argument(const shared::IROperand *oper, const X86Register& reg, stack_map_t&);
 						void encode_operand_to_reg(const shared::IROperand *operand, const X86Register& reg);
 
+						// Move a (possibly 128 bit) vector operand between its
+						// allocation and an xmm register. Operands narrower
+						// than 16 bytes occupy the low lanes, and the upper
+						// lanes of the xmm register are zeroed on load.
+						void load_vector_operand(const shared::IROperand *operand, const X86VectorRegister& reg);
+						void store_vector_operand(const X86VectorRegister& reg, const shared::IROperand *operand);
+
+						// Lower dest = lhs <op> rhs, with lhs in BLKJIT_FP_0 and rhs
+						// in BLKJIT_FP_1 (or read directly from the stack with AVX)
+						void lower_vector_binary(X86VectorOp op, const shared::IROperand *lhs, const shared::IROperand *rhs, const shared::IROperand *dest, uint8_t imm = 0);
+
 						inline void assign(uint8_t id, const X86Register& r8, const X86Register& r4, const X86Register& r2, const X86Register& r1)
 						{
 							if(register_assignments.size() <= id) register_assignments.resize(id+1);
@@ -117,7 +128,7 @@ namespace captive
 						inline X86Memory stack_from_operand(const captive::shared::IROperand *oper) const
 						{
 							ASSERT(oper->alloc_mode == captive::shared::IROperand::ALLOCATED_STACK);
-							ASSERT(oper->size <= 8);
+							ASSERT(oper->size <= 16);
 
 							return X86Memory(REG_RSP, oper->alloc_data);
 						}
@@ -0,0 +1,6 @@
+#ifndef CMAKE_CONFIG_H
+#define CMAKE_CONFIG_H
+
+#define CONFIGSTRING QUOTEME(Debug)
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef CMAKE_SCM_H
+#define CMAKE_SCM_H
+
+#define SCM_REV 
+
+#endif
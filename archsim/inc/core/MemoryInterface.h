@@ -13,8 +13,10 @@
 
 #include "core/arch/ArchDescriptor.h"
 #include "core/MemoryMonitor.h"
+#include "core/SoftwareTLB.h"
 #include "abi/Address.h"
 #include "abi/memory/MemoryModel.h"
+#include "abi/memory/ShadowPageTable.h"
 #include "abi/devices/MMU.h"
 
 namespace archsim
@@ -72,13 +74,16 @@ namespace archsim
 	class MMUTranslationProvider : public MemoryTranslationProvider
 	{
 	public:
-		MMUTranslationProvider(archsim::abi::devices::MMU *mmu, archsim::core::thread::ThreadInstance *thread) : mmu_(mmu), thread_(thread) {}
+		// Successful translations are cached in the given TLB, which may be
+		// shared by every provider belonging to the thread
+		MMUTranslationProvider(archsim::abi::devices::MMU *mmu, archsim::core::thread::ThreadInstance *thread, SoftwareTLB *tlb = nullptr) : mmu_(mmu), thread_(thread), tlb_(tlb) {}
 		virtual ~MMUTranslationProvider() {}
 
 		TranslationResult Translate(Address virt_addr, Address& phys_addr, bool is_write, bool is_fetch, bool side_effects) override;
 	private:
 		archsim::abi::devices::MMU *mmu_;
 		archsim::core::thread::ThreadInstance *thread_;
+		SoftwareTLB *tlb_;
 	};
 
 	class MemoryDevice
@@ -145,7 +150,12 @@ namespace archsim
 			CacheEntry cache[kCacheSize];
 		};
 
-		CachedLegacyMemoryInterface(int index, archsim::abi::memory::MemoryModel &mem_model, archsim::core::thread::ThreadInstance *thread);
+		/*
+		 * If a shadow page table is given, it is used instead of the cache,
+		 * and a pointer to it is published in the state block (as
+		 * shadow_page_table_N) so that JIT code can look pages up directly.
+		 */
+		CachedLegacyMemoryInterface(int index, archsim::abi::memory::MemoryModel &mem_model, archsim::core::thread::ThreadInstance *thread, archsim::abi::memory::ShadowPageTable *shadow = nullptr);
 
 		MemoryResult Read8(Address address, uint8_t& data) override;
 		MemoryResult Read16(Address address, uint16_t& data) override;
@@ -174,11 +184,12 @@ namespace archsim
 
 	private:
 		void *GetPtr(Address addr);
-		void LoadEntryFor(struct CacheEntry *entry, Address addr);
+		bool LoadEntryFor(struct CacheEntry *entry, Address addr);
 
 		Cache *GetCache();
 
 		archsim::abi::memory::MemoryModel &mem_model_;
+		archsim::abi::memory::ShadowPageTable *shadow_;
 		archsim::core::thread::ThreadInstance *thread_;
 		uint64_t cache_offset_;
 		std::mutex cache_lock_;
@@ -4,6 +4,7 @@
 
 #include "core/thread/ThreadInstance.h"
 
+#include <atomic>
 #include <map>
 #include <mutex>
 
@@ -55,5 +56,82 @@ namespace archsim
 			archsim::core::thread::ThreadInstance *locked_thread_;
 		};
 
+		/*
+		 * A monitor which scales to many guest threads. Each thread has its own
+		 * reservation slot, and addresses are hashed onto a table of stripes.
+		 * Every stripe carries a version number which is bumped whenever its
+		 * memory is written through the monitor, so a reservation is simply a
+		 * (stripe, version) pair and clearing other threads' reservations never
+		 * requires visiting them.
+		 *
+		 * Acquiring a reservation is wait-free. A store-exclusive either fails
+		 * without touching shared state, or claims its stripe with a single
+		 * compare-and-swap. Lock/Unlock (used for atomic read-modify-write
+		 * sequences) still exclude every other thread.
+		 *
+		 * Unrelated addresses which share a stripe may cause a store-exclusive
+		 * to fail spuriously, which both ARM and RISC-V allow.
+		 */
+		class ShardedMemoryMonitor : public MemoryMonitor
+		{
+		public:
+			ShardedMemoryMonitor();
+			~ShardedMemoryMonitor() override;
+
+			ShardedMemoryMonitor(const ShardedMemoryMonitor &) = delete;
+			ShardedMemoryMonitor &operator=(const ShardedMemoryMonitor &) = delete;
+
+			virtual void AcquireMonitor(archsim::core::thread::ThreadInstance *thread, Address addr);
+			virtual bool LockMonitor(archsim::core::thread::ThreadInstance *thread, Address addr);
+			virtual void UnlockMonitor(archsim::core::thread::ThreadInstance *thread, Address addr);
+			virtual void Notify(archsim::core::thread::ThreadInstance *thread, Address addr);
+
+			virtual void Lock(archsim::core::thread::ThreadInstance *thread);
+			virtual void Unlock(archsim::core::thread::ThreadInstance *thread);
+
+			static const unsigned kMaxThreads = 256;
+			static const unsigned kStripeBits = 10;
+			static const unsigned kGranuleBits = 6;
+
+		private:
+			// Stripe words hold the version in the upper bits, and a lock bit
+			// which is set while a store-exclusive to the stripe is in progress
+			struct alignas(64) Stripe {
+				std::atomic<uint64_t> Word;
+			};
+
+			// Only ever written by the owning thread, except for Busy which is
+			// read by threads taking the global lock. Owner is claimed the
+			// first time a thread uses its slot.
+			struct alignas(64) Slot {
+				std::atomic<archsim::core::thread::ThreadInstance *> Owner;
+				bool Valid;
+				Address ReservedAddress;
+				uint64_t Version;
+				int HeldStripe;
+				std::atomic<bool> Busy;
+			};
+
+			static unsigned GetStripeIndex(Address addr)
+			{
+				return (unsigned)(((addr.Get() >> kGranuleBits) * 0x9e3779b97f4a7c15ULL) >> (64 - kStripeBits));
+			}
+
+			Slot &GetSlot(archsim::core::thread::ThreadInstance *thread);
+			void ReleaseStripe(Slot &slot);
+
+			// The stripes and slots are allocated separately, since neither new
+			// nor make_shared respect their alignment before C++17
+			static const unsigned kStripeCount = 1 << kStripeBits;
+			void *storage_;
+			Stripe *stripes_;
+			Slot *slots_;
+			std::atomic<unsigned> slot_count_;
+
+			std::mutex global_lock_;
+			std::atomic<bool> global_active_;
+			std::atomic<archsim::core::thread::ThreadInstance *> global_owner_;
+		};
+
 	}
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   SoftwareTLB.h
+ *
+ * A per-thread, set-associative cache of guest MMU translations, with
+ * separate instruction and data sides. Entries are tagged with the guest
+ * ASID and the execution ring, and each entry records which kinds of access
+ * the MMU has allowed, so a hit never has to check permissions again. Only
+ * successful translations are cached, so faults are always raised by the MMU.
+ *
+ * Invalidation events may be published from any thread, so they are only
+ * recorded when they arrive, and are applied by the owning thread the next
+ * time it looks up a translation.
+ */
+
+#ifndef SOFTWARETLB_H
+#define SOFTWARETLB_H
+
+#include "abi/Address.h"
+#include "util/PubSubSync.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace archsim
+{
+
+	class SoftwareTLB
+	{
+	public:
+		enum AccessKind {
+			AccessFetch,
+			AccessRead,
+			AccessWrite
+		};
+
+		static const uint32_t kSets = 256;
+		static const uint32_t kWays = 4;
+
+		/*
+		 * page_bits gives the size of the smallest region which the guest MMU
+		 * can translate differently from its neighbours.
+		 */
+		SoftwareTLB(util::PubSubContext &pubsub, uint32_t page_bits);
+
+		inline bool Lookup(Address virt_addr, uint32_t asid, uint32_t ring, AccessKind kind, Address &phys_addr)
+		{
+			if(pending_.load(std::memory_order_relaxed)) {
+				ApplyInvalidations();
+			}
+
+			Address::underlying_t page = virt_addr.Get() >> page_bits_;
+			const Entry *set = GetSet(kind, page);
+			uint8_t permission = GetPermission(kind);
+
+			for(uint32_t way = 0; way < kWays; ++way) {
+				const Entry &entry = set[way];
+				if(entry.Page == page && entry.ASID == asid && entry.Ring == ring && (entry.Permissions & permission)) {
+					phys_addr = Address(entry.PhysPage | (virt_addr.Get() & page_mask_));
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// Record that the MMU allowed the given access
+		void Insert(Address virt_addr, uint32_t asid, uint32_t ring, AccessKind kind, Address phys_addr);
+
+		// Drop every entry. Must only be called by the owning thread.
+		void Flush();
+
+	private:
+		static const Address::underlying_t kInvalidPage = ~0ULL;
+
+		struct Entry {
+			Address::underlying_t Page;
+			Address::underlying_t PhysPage;
+			uint16_t ASID;
+			uint8_t Ring;
+			uint8_t Permissions;
+		};
+
+		static inline uint8_t GetPermission(AccessKind kind)
+		{
+			return kind == AccessWrite ? 2 : 1;
+		}
+
+		inline Entry *GetSet(AccessKind kind, Address::underlying_t page)
+		{
+			return (kind == AccessFetch ? itlb_ : dtlb_)[page % kSets];
+		}
+
+		static void InvalidateCallback(PubSubType::PubSubType type, void *ctx, const void *data);
+
+		void ApplyInvalidations();
+		void FlushSide(Entry (&side)[kSets][kWays]);
+		void FlushPage(Entry (&side)[kSets][kWays], Address addr);
+
+		uint32_t page_bits_;
+		Address::underlying_t page_mask_;
+
+		Entry itlb_[kSets][kWays];
+		Entry dtlb_[kSets][kWays];
+		uint8_t ivictim_[kSets];
+		uint8_t dvictim_[kSets];
+
+		std::atomic<bool> pending_;
+		std::mutex pending_lock_;
+		bool pending_iflush_, pending_dflush_;
+		std::vector<Address::underlying_t> pending_ipages_;
+		std::vector<Address::underlying_t> pending_dpages_;
+
+		util::PubSubscriber subscriber_;
+	};
+
+}
+
+#endif /* SOFTWARETLB_H */
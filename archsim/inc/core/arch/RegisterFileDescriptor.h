@@ -95,6 +95,29 @@ namespace archsim
 		uint64_t entry_stride_;
 	};
 
+	// A typed reference to a register file entry. Handles are looked up by
+	// name (or tag) once, e.g. when a thread or device is created, so that
+	// accessing the entry afterwards doesn't need any string lookups.
+	template<typename T> class RegisterFileEntryHandle
+	{
+	public:
+		RegisterFileEntryHandle() : offset_(kInvalidOffset) {}
+		explicit RegisterFileEntryHandle(uint64_t offset) : offset_(offset) {}
+
+		bool IsValid() const
+		{
+			return offset_ != kInvalidOffset;
+		}
+		uint64_t GetOffset() const
+		{
+			return offset_;
+		}
+
+	private:
+		static const uint64_t kInvalidOffset = (uint64_t)-1;
+		uint64_t offset_;
+	};
+
 	class RegisterFileDescriptor
 	{
 	public:
@@ -125,6 +148,35 @@ namespace archsim
 			return tagged_entries_.at(tag);
 		}
 
+		bool HasEntry(const std::string &name) const
+		{
+			return entries_.count(name) != 0;
+		}
+		bool HasTaggedEntry(const std::string &tag) const
+		{
+			return tagged_entries_.count(tag) != 0;
+		}
+
+		// Handles for entries which don't exist in this register file are
+		// invalid, rather than an error, so that architecture specific
+		// entries can be looked up unconditionally.
+		template<typename T> RegisterFileEntryHandle<T> GetEntryHandle(const std::string &name) const
+		{
+			auto entry = entries_.find(name);
+			if(entry == entries_.end()) {
+				return RegisterFileEntryHandle<T>();
+			}
+			return RegisterFileEntryHandle<T>(entry->second.GetOffset());
+		}
+		template<typename T> RegisterFileEntryHandle<T> GetTaggedEntryHandle(const std::string &tag) const
+		{
+			auto entry = tagged_entries_.find(tag);
+			if(entry == tagged_entries_.end()) {
+				return RegisterFileEntryHandle<T>();
+			}
+			return RegisterFileEntryHandle<T>(entry->second.GetOffset());
+		}
+
 		const RegisterFileEntryDescriptor &GetByID(uint32_t id) const
 		{
 			return entries_.at(id_to_names_.at(id));
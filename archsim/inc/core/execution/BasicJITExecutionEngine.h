@@ -12,6 +12,7 @@
 
 #include "ExecutionEngine.h"
 #include "blockjit/BlockCache.h"
+#include "blockjit/BlockChainTable.h"
 #include "blockjit/BlockProfile.h"
 
 namespace archsim
@@ -30,29 +31,44 @@ namespace archsim
 
 				virtual ExecutionEngineThreadContext* GetNewContext(thread::ThreadInstance* thread) = 0;
 
-				void FlushTxlns();
-				void FlushTxlnsFeature();
-				void FlushTxlnCache();
-				void FlushAllTxlns();
-				void InvalidateRegion(Address addr);
+				virtual void FlushTxlns();
+				virtual void FlushTxlnsFeature();
+				virtual void FlushTxlnCache();
+				virtual void FlushAllTxlns();
+				virtual void InvalidateRegion(Address addr);
 
 			protected:
 				virtual bool translateBlock(thread::ThreadInstance *thread, archsim::Address block_pc, bool support_chaining, bool support_profiling) = 0;
 				virtual bool lookupBlock(thread::ThreadInstance *thread, Address addr, captive::shared::block_txln_fn &);
 
 				void checkFlushTxlns();
-				void checkCodeSize();
-				void registerTranslation(Address phys_addr, Address virt_addr, archsim::blockjit::BlockTranslation &txln);
+				// Evict translations if the code cache has grown beyond its limit
+				void checkCodeSize(thread::ThreadInstance *thread);
+				void registerTranslation(thread::ThreadInstance *thread, Address phys_addr, Address virt_addr, archsim::blockjit::BlockTranslation &txln);
+
+				// Called each time the dispatcher returns to the outer loop
+				virtual void checkPendingTranslations(thread::ThreadInstance *thread) {}
 
 				wulib::MemAllocator &GetMemAllocator()
 				{
 					return mem_allocator_;
 				}
+				archsim::blockjit::BlockCache &GetBlockCache()
+				{
+					return virt_block_cache_;
+				}
+				archsim::blockjit::BlockChainTable &GetChainTable()
+				{
+					return chain_table_;
+				}
 
 			private:
 				template<typename PC_t> ExecutionResult ExecuteLoop(ExecutionEngineThreadContext *ctx, PC_t* pc_ptr);
 				template<typename PC_t> void ExecuteInnerLoop(ExecutionEngineThreadContext *ctx, PC_t* pc_ptr);
 
+				void linkChainSite(thread::ThreadInstance *thread, archsim::blockjit::BlockChainTable::chain_site_t site, Address target_pc, captive::shared::block_txln_fn target_fn);
+
+				archsim::blockjit::BlockChainTable chain_table_;
 				archsim::blockjit::BlockProfile phys_block_profile_;
 				archsim::blockjit::BlockCache virt_block_cache_;
 				wulib::SimpleZoneMemAllocator mem_allocator_;
@@ -19,8 +19,13 @@
 #include "blockjit/BlockJitTranslate.h"
 #include "blockjit/BlockProfile.h"
 #include "blockjit/BlockCache.h"
+#include "blockjit/PersistentTranslationCache.h"
 #include "module/ModuleManager.h"
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 namespace archsim
 {
 	namespace core
@@ -40,6 +45,9 @@ namespace archsim
 				}
 
 				ExecutionEngineThreadContext* GetNewContext(thread::ThreadInstance* thread) override;
+				void Join() override;
+
+				void InvalidateRegion(Address addr) override;
 
 				virtual bool translateBlock(thread::ThreadInstance *thread, archsim::Address block_pc, bool support_chaining, bool support_profiling);
 
@@ -51,6 +59,19 @@ namespace archsim
 				gensim::blockjit::BaseBlockJITTranslate *translator_;
 
 				static ExecutionEngine *Factory(const archsim::module::ModuleInfo *module, const std::string &cpu_prefix);
+
+			private:
+				std::string getPersistentContext(thread::ThreadInstance *thread);
+				bool getPageHash(thread::ThreadInstance *thread, Address virt_pc, Address phys_pc, uint64_t &hash);
+
+				// Translations kept between runs (--jit-load-txlns/--jit-save-txlns)
+				archsim::blockjit::PersistentTranslationCache persistent_txlns_;
+				std::once_flag persistent_txlns_init_;
+				std::string persistent_context_;
+
+				// Content hashes of guest code pages, by physical page
+				std::mutex page_hashes_lock_;
+				std::unordered_map<Address::underlying_t, uint64_t> page_hashes_;
 			};
 		}
 	}
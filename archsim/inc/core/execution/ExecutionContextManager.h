@@ -15,6 +15,9 @@
 #include "core/execution/ExecutionState.h"
 #include "core/thread/ThreadInstance.h"
 
+#include <mutex>
+#include <set>
+
 namespace archsim
 {
 	namespace core
@@ -53,6 +56,19 @@ namespace archsim
 				void Halt();
 				void Join();
 
+				// Guest threads report when they start and stop executing, and
+				// when they go idle waiting for an interrupt or an event.
+				void ThreadStarted(thread::ThreadInstance *thread);
+				void ThreadStopped(thread::ThreadInstance *thread);
+
+				// Returns true if every running thread is now idle
+				bool ThreadIdle();
+				void ThreadWoken();
+				uint32_t GetIdleThreadCount();
+
+				// Wake every running thread which is waiting for an event
+				void SignalEvent();
+
 				EngineContainer::iterator begin()
 				{
 					return contexts_.begin();
@@ -66,6 +82,10 @@ namespace archsim
 				EngineContainer contexts_;
 				ExecutionState state_;
 
+				std::mutex threads_lock_;
+				std::set<thread::ThreadInstance*> running_threads_;
+				uint32_t idle_threads_;
+
 				libtrace::TraceSink *trace_sink_;
 			};
 		}
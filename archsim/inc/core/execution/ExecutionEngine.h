@@ -96,7 +96,7 @@ namespace archsim
 				void Start();
 				void Halt();
 				void Suspend();
-				void Join();
+				virtual void Join();
 
 				void SetTraceSink(libtrace::TraceSink *sink)
 				{
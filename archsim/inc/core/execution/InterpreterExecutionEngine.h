@@ -13,6 +13,7 @@
 
 #include "core/execution/ExecutionEngine.h"
 #include "interpret/Interpreter.h"
+#include "interpret/PredecodeCache.h"
 #include "module/Module.h"
 
 namespace archsim
@@ -31,9 +32,14 @@ namespace archsim
 				{
 					return decode_ctx_;
 				}
+				archsim::interpret::PredecodeCache &GetPredecodeCache()
+				{
+					return predecode_cache_;
+				}
 
 			private:
 				gensim::DecodeContext *decode_ctx_;
+				archsim::interpret::PredecodeCache predecode_cache_;
 			};
 
 			class InterpreterExecutionEngine : public ExecutionEngine
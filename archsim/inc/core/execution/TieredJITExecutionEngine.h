@@ -0,0 +1,192 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   TieredJITExecutionEngine.h
+ *
+ * An execution engine which translates every block with the BlockJIT, counts
+ * how often each translation is entered, and recompiles hot blocks with LLVM
+ * on a pool of background threads. Once a recompiled block is ready, it
+ * replaces the BlockJIT translation in the block cache.
+ */
+
+#ifndef TIEREDJITEXECUTIONENGINE_H
+#define TIEREDJITEXECUTIONENGINE_H
+
+#include "core/execution/BlockJITExecutionEngine.h"
+#include "blockjit/InvalidationEpochs.h"
+#include "concurrent/Thread.h"
+#include "translate/adapt/BlockJITToLLVM.h"
+#include "translate/llvm/LLVMCompiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace archsim
+{
+	namespace core
+	{
+		namespace execution
+		{
+			class TieredJITExecutionEngine;
+
+			/**
+			 * A hot block, along with the BlockJIT IR it should be recompiled from.
+			 */
+			class TieredWorkUnit
+			{
+			public:
+				TieredWorkUnit(thread::ThreadInstance *thread, Address phys_pc, Address virt_pc, uint64_t weight, blockjit::InvalidationEpochs::epoch_t epoch) : Thread(thread), PhysPC(phys_pc), VirtPC(virt_pc), Weight(weight), Epoch(epoch) {}
+
+				thread::ThreadInstance *Thread;
+				Address PhysPC;
+				Address VirtPC;
+				uint64_t Weight;
+				blockjit::InvalidationEpochs::epoch_t Epoch;
+
+				captive::arch::jit::TranslationContext IR;
+
+				// Holds the features the block depends on, and (once compiled) the
+				// LLVM translation
+				archsim::blockjit::BlockTranslation Txln;
+			};
+
+			class TieredWorkUnitComparator
+			{
+			public:
+				bool operator()(const TieredWorkUnit *lhs, const TieredWorkUnit *rhs) const
+				{
+					return lhs->Weight < rhs->Weight;
+				}
+			};
+
+			class TieredTranslationWorker : public concurrent::Thread
+			{
+			public:
+				TieredTranslationWorker(TieredJITExecutionEngine &engine, uint8_t id);
+
+				void run() override;
+				void stop();
+
+			private:
+				void Translate(TieredWorkUnit &unit);
+
+				TieredJITExecutionEngine &engine_;
+				uint8_t id_;
+				volatile bool terminate_;
+
+				llvm::orc::ThreadSafeContext llvm_ctx_;
+				archsim::translate::adapt::BlockJITToLLVMAdaptor adaptor_;
+				archsim::translate::translate_llvm::LLVMCompiler compiler_;
+			};
+
+			/**
+			 * Periodically looks for hot blocks. Guest threads running chained
+			 * code never return to the dispatcher by themselves, so they are
+			 * interrupted when there are hot blocks for them to promote.
+			 */
+			class TieredProfileScanner : public concurrent::Thread
+			{
+			public:
+				TieredProfileScanner(TieredJITExecutionEngine &engine);
+
+				void run() override;
+				void stop();
+
+			private:
+				TieredJITExecutionEngine &engine_;
+				bool terminate_;
+				std::mutex lock_;
+				std::condition_variable cond_;
+			};
+
+			class TieredJITExecutionEngine : public BlockJITExecutionEngine
+			{
+			public:
+				friend class TieredTranslationWorker;
+				friend class TieredProfileScanner;
+
+				TieredJITExecutionEngine(gensim::blockjit::BaseBlockJITTranslate *translator);
+				~TieredJITExecutionEngine();
+
+				ExecutionResult Execute(ExecutionEngineThreadContext* thread) override;
+
+				void FlushTxlns() override;
+				void FlushAllTxlns() override;
+				void InvalidateRegion(Address addr) override;
+
+				static ExecutionEngine *Factory(const archsim::module::ModuleInfo *module, const std::string &cpu_prefix);
+
+			protected:
+				bool translateBlock(thread::ThreadInstance *thread, archsim::Address block_pc, bool support_chaining, bool support_profiling) override;
+				bool lookupBlock(thread::ThreadInstance *thread, Address addr, captive::shared::block_txln_fn &fn) override;
+				void checkPendingTranslations(thread::ThreadInstance *thread) override;
+
+			private:
+				enum class TierState {
+					Cold,		// Being profiled
+					Hot,		// Waiting for a guest thread to promote it
+					Promoting	// Queued for a worker, or already promoted
+				};
+
+				// Profiling state for a block translated by the BlockJIT. These are
+				// never freed, since BlockJIT code may still refer to the counter.
+				struct TieredBlock {
+					Address PhysPC;
+					Address VirtPC;
+					uint32_t ModeID;
+					uint64_t Count;
+					captive::shared::block_txln_fn Tier0Fn;
+					TierState State;
+				};
+
+				static const std::chrono::milliseconds kScanInterval;
+
+				TieredBlock &getBlock(Address phys_pc);
+				void makeCold(TieredBlock &block);
+				void resetProfile();
+
+				void scanHotBlocks();
+				void promoteHotBlocks(thread::ThreadInstance *thread);
+				bool promote(thread::ThreadInstance *thread, TieredBlock &block);
+				bool buildIR(thread::ThreadInstance *thread, TieredWorkUnit &unit);
+				void installCompleted(thread::ThreadInstance *thread);
+				bool isStale(const TieredWorkUnit &unit);
+				void retire(TieredWorkUnit *unit);
+
+				std::mutex tier_lock_;
+				std::unordered_map<Address::underlying_t, std::unique_ptr<TieredBlock>> blocks_;
+				std::vector<TieredBlock*> cold_blocks_;
+				std::vector<TieredBlock*> hot_blocks_;
+				std::atomic<bool> has_hot_blocks_;
+				std::map<Address::underlying_t, archsim::blockjit::BlockTranslation> promoted_;
+				std::set<thread::ThreadInstance*> threads_;
+
+				// Work units started before their code was invalidated are
+				// discarded. Protected by tier_lock_, as is the count of work
+				// units which haven't been installed or discarded yet.
+				blockjit::InvalidationEpochs epochs_;
+				uint64_t outstanding_units_;
+
+				TieredProfileScanner scanner_;
+
+				std::mutex work_queue_lock_;
+				std::condition_variable work_queue_cond_;
+				std::priority_queue<TieredWorkUnit*, std::vector<TieredWorkUnit*>, TieredWorkUnitComparator> work_queue_;
+				std::vector<TieredWorkUnit*> completed_;
+
+				std::list<TieredTranslationWorker*> workers_;
+			};
+		}
+	}
+}
+
+#endif /* TIEREDJITEXECUTIONENGINE_H */
@@ -47,6 +47,10 @@ namespace archsim
 			return block_offsets_.count(name);
 		}
 
+		// Describes the name, offset and size of every entry. Generated code
+		// can only be reused with a state block of the same layout.
+		std::string GetLayoutSignature() const;
+
 	private:
 		std::map<std::string, uint64_t> block_offsets_;
 		std::map<std::string, uint64_t> block_sizes_in_bytes_;
@@ -20,15 +20,19 @@
 #include "abi/devices/PeripheralManager.h"
 #include "core/thread/ProcessorFeatures.h"
 #include "core/thread/ThreadMetrics.h"
+#include "util/Checkpoint.h"
 
 #include <libtrace/TraceSource.h>
 
 #include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <queue>
 #include <setjmp.h>
 
-#define CreateThreadExecutionSafepoint(thread) do { setjmp(thread->Safepoint); } while(0)
+#define CreateThreadExecutionSafepoint(thread) do { archsim::core::thread::ThreadInstance::SetCurrentThread(thread); setjmp(thread->Safepoint); } while(0)
 
 UseLogContext(LogCPU);
 
@@ -55,7 +59,9 @@ namespace archsim
 			enum class ThreadMessage {
 				Nop,
 				Interrupt,
-				Halt
+				Halt,
+				WaitForInterrupt,
+				WaitForEvent
 			};
 
 			enum class FlushMode {
@@ -115,11 +121,20 @@ namespace archsim
 				{
 					return data_.data();
 				}
+				size_t GetSize() const
+				{
+					return data_.size();
+				}
 
 				template<typename T> T* GetEntry(const std::string &slotname)
 				{
 					return (T*)&data_[descriptor_.GetEntries().at(slotname).GetOffset()];
 				}
+				template<typename T> T* GetEntry(RegisterFileEntryHandle<T> handle)
+				{
+					assert(handle.IsValid());
+					return (T*)&data_[handle.GetOffset()];
+				}
 
 				template<typename T> T* GetTaggedSlotPointer(const std::string &tag)
 				{
@@ -246,11 +261,22 @@ namespace archsim
 				}
 				Address GetSP()
 				{
-					return GetRegisterFileInterface().GetTaggedSlot("SP");
+					// Not every architecture tags a stack pointer
+					assert(sp_ptr_ != nullptr);
+					if(sp_is_64bit_) {
+						return Address(*(uint64_t*)sp_ptr_);
+					} else {
+						return Address(*(uint32_t*)sp_ptr_);
+					}
 				}
 				void SetSP(Address target)
 				{
-					GetRegisterFileInterface().SetTaggedSlot("SP", target);
+					assert(sp_ptr_ != nullptr);
+					if(sp_is_64bit_) {
+						*(uint64_t*)sp_ptr_ = target.Get();
+					} else {
+						*(uint32_t*)sp_ptr_ = target.Get();
+					}
 				}
 
 				// Functions to do with memory interfaces
@@ -273,6 +299,13 @@ namespace archsim
 					trace_source_ = source;
 				}
 
+				// Functions to do with checkpointing. This covers the registers,
+				// execution mode and ring, feature levels and floating point
+				// modes, but not the thread's peripherals, which are saved
+				// separately. The thread must not be executing.
+				void SaveState(util::CheckpointWriter &writer) const;
+				bool RestoreState(util::CheckpointReader &reader);
+
 				// External functions. I don't like that these are here.
 				void fn_flush_itlb_entry(Address::underlying_t entry)
 				{
@@ -329,10 +362,10 @@ namespace archsim
 					// do it aarch64 style
 
 					// N Z C V
-					uint8_t *N = GetRegisterFileInterface().GetEntry<uint8_t>("N");
-					uint8_t *Z = GetRegisterFileInterface().GetEntry<uint8_t>("Z");
-					uint8_t *C = GetRegisterFileInterface().GetEntry<uint8_t>("C");
-					uint8_t *V = GetRegisterFileInterface().GetEntry<uint8_t>("V");
+					uint8_t *N = GetRegisterFileInterface().GetEntry(flag_n_);
+					uint8_t *Z = GetRegisterFileInterface().GetEntry(flag_z_);
+					uint8_t *C = GetRegisterFileInterface().GetEntry(flag_c_);
+					uint8_t *V = GetRegisterFileInterface().GetEntry(flag_v_);
 
 					uint32_t result = 0;
 
@@ -474,12 +507,32 @@ namespace archsim
 				// Acknowledge an IRQ and take an interrupt
 				void HandleIRQ();
 
+				// Functions to do with idling. These are called by WFI, WFE and
+				// SEV, and the wait happens the next time the thread handles its
+				// messages (i.e. at the end of the current block). While waiting,
+				// the host thread sleeps until an interrupt is pending or another
+				// message arrives.
+				void WaitForInterrupt()
+				{
+					SendMessage(ThreadMessage::WaitForInterrupt);
+				}
+				void WaitForEvent()
+				{
+					SendMessage(ThreadMessage::WaitForEvent);
+				}
+				// Signal an event to every thread in the system
+				void SendEvent();
+				// Signal an event to this thread only
+				void SignalEvent();
+
 				// Functions to do with sending messages to a running thread
 				void SendMessage(ThreadMessage message)
 				{
 					std::unique_lock<std::mutex> lock(message_lock_);
 					message_queue_.push(message);
 					*(uint32_t*)(((char*)GetStateBlock().GetData()) + message_waiting_offset_) = true;
+					MarkAwake();
+					message_cond_.notify_all();
 				}
 
 				bool HasMessage() const
@@ -514,7 +567,34 @@ namespace archsim
 				// we have to use setjmp/longjmp to emulate exceptions.
 				jmp_buf Safepoint;
 				void ReturnToSafepoint();
+
+				// The thread being executed on the calling host thread, as of
+				// the last time it created a safepoint. This is used to work
+				// out which guest thread a host fault belongs to.
+				static ThreadInstance *GetCurrentThread()
+				{
+					return current_thread_;
+				}
+				static void SetCurrentThread(ThreadInstance *thread)
+				{
+					current_thread_ = thread;
+				}
 			private:
+				static thread_local ThreadInstance *current_thread_;
+
+				// WFE is allowed to wake up spuriously, so don't wait for longer
+				// than this in case the event comes from something we don't model
+				// (e.g. a store clearing another thread's exclusive monitor)
+				static constexpr std::chrono::microseconds kEventWaitTimeout {200};
+
+				void Idle(bool wait_for_event);
+				bool IsWakeupPending(bool wait_for_event) const;
+
+				// Stop counting this thread as idle. Called with the message lock
+				// held, by whoever wakes the thread, so that the ECM's idle count
+				// drops before the thread has even been scheduled again.
+				void MarkAwake();
+
 				const ArchDescriptor &descriptor_;
 				memory_interface_collection_t memory_interfaces_;
 				MemoryInterface *fetch_mi_;
@@ -534,10 +614,18 @@ namespace archsim
 
 				void *pc_ptr_;
 				bool pc_is_64bit_;
+				void *sp_ptr_;
+				bool sp_is_64bit_;
+
+				RegisterFileEntryHandle<uint8_t> flag_n_, flag_z_, flag_c_, flag_v_;
 
 				std::mutex message_lock_;
+				std::condition_variable message_cond_;
 				std::queue<ThreadMessage> message_queue_;
 				std::atomic<uint32_t> pending_irqs_;
+				bool event_register_;
+				// Whether this thread is counted as idle by the ECM
+				bool idle_;
 
 				StateBlock state_block_;
 				libtrace::TraceSource *trace_source_;
@@ -15,6 +15,7 @@
 #include "util/Counter.h"
 #include "util/CounterTimer.h"
 #include "util/Histogram.h"
+#include "util/ProfileHistogram.h"
 
 #include <functional>
 #include <ostream>
@@ -33,9 +34,12 @@ namespace archsim
 				archsim::util::CounterTimer SelfRuntime;
 				archsim::util::CounterTimer TotalRuntime;
 
-				archsim::util::Histogram PCHistogram;
-				archsim::util::Histogram OpcodeHistogram;
-				archsim::util::Histogram InstructionIRHistogram;
+				archsim::util::ProfileHistogram PCHistogram;
+				archsim::util::ProfileHistogram OpcodeHistogram;
+				// Consecutive instructions within a block, keyed by
+				// (first opcode << 16) | second opcode
+				archsim::util::ProfileHistogram OpcodePairHistogram;
+				archsim::util::ProfileHistogram InstructionIRHistogram;
 
 				archsim::util::Counter64 ReadHits;
 				archsim::util::Counter64 Reads;
@@ -44,24 +48,54 @@ namespace archsim
 
 				archsim::util::Counter64 JITInstructionCount;
 				archsim::util::CounterTimer JITTime;
+				archsim::util::CounterTimer JITCompileTime;
+				archsim::util::Counter64 JITCodeSize;
 
 				archsim::util::CounterTimer InterpretTime;
 
+				archsim::util::Counter64 IdleWaits;
+				archsim::util::CounterTimer IdleTime;
+
+				// Keyed by guest syscall number. SyscallTime holds the total
+				// time spent handling each syscall, in nanoseconds.
+				archsim::util::Histogram SyscallCounts;
+				archsim::util::Histogram SyscallTime;
+
 				archsim::util::Counter64 JITSuccessfulChains;
 				archsim::util::Counter64 JITFailedChains;
 				archsim::util::Histogram JITExitReasons;
+
+				archsim::util::Counter64 ITLBHits;
+				archsim::util::Counter64 ITLBMisses;
+				archsim::util::Counter64 DTLBHits;
+				archsim::util::Counter64 DTLBMisses;
+
+				archsim::util::Counter64 JITEvictedPages;
+				archsim::util::Counter64 JITEvictedBytes;
+				archsim::util::Counter64 JITCodeFlushes;
+				archsim::util::Counter64 JITRetranslations;
+
+				archsim::util::Counter64 TierUpQueued;
+				archsim::util::Counter64 TierUpInstalled;
+				archsim::util::Counter64 TierUpDiscarded;
 			};
 
 			class ThreadMetricPrinter
 			{
 			public:
 				void PrintStats(const ArchDescriptor &arch, const ThreadMetrics &metrics, std::ostream &str);
+
+				// Write the headline metrics as a single JSON object, for tools
+				void PrintJSON(const ThreadMetrics &metrics, std::ostream &str);
 			};
 
 			class HistogramPrinter
 			{
 			public:
 				void PrintHistogram(const archsim::util::Histogram &hist, std::ostream &str, std::function<std::string(archsim::util::HistogramEntry::histogram_key_t)> key_formatter);
+
+				// Entries are printed in key order
+				void PrintHistogram(const archsim::util::ProfileHistogram &hist, std::ostream &str, std::function<std::string(archsim::util::ProfileHistogram::key_t)> key_formatter);
 			};
 		}
 	}
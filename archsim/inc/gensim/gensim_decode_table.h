@@ -0,0 +1,85 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   gensim_decode_table.h
+ *
+ * Driver for table-driven instruction decoders. The decode tree for an ISA
+ * is flattened by gensim into a set of groups, each of which looks at one
+ * field of the instruction word and selects the next action to take.
+ *
+ * Actions are encoded as follows:
+ *   0               - no match: backtrack to the last untried alternative
+ *   (group << 1)    - look up the field described by the given group
+ *   (leaf << 1) | 1 - the instruction has been identified
+ *
+ * Each group also records an alternative action to take if nothing below
+ * it matches, which mirrors the fall-through behaviour of the switch-based
+ * decoder. This header is deliberately free of archsim dependencies so that
+ * it can be used by standalone decoder benchmarks.
+ */
+
+#ifndef _GENSIM_DECODE_TABLE_H
+#define _GENSIM_DECODE_TABLE_H
+
+#include <stdint.h>
+
+namespace gensim
+{
+	namespace decode_table
+	{
+
+		template<typename Action> struct Group {
+			uint32_t base;   // index of the first entry of this group in the action (and value) tables
+			uint32_t count;  // number of entries, for sparse groups
+			Action next;     // action to take if this group does not match
+			uint8_t shift;   // position of the least significant bit of the field
+			uint8_t width;   // width of the field in bits
+			uint8_t sparse;  // if set, entries are sorted (value, action) pairs rather than a direct table
+		};
+
+		/*
+		 * Decode an instruction word, returning the index of the matching leaf
+		 * or -1 if the instruction is not recognised. MaxDepth must be at least
+		 * the depth of the flattened tree, which gensim emits alongside it.
+		 */
+		template<unsigned MaxDepth, typename Action> inline int32_t Lookup(const Group<Action> *groups, const Action *actions, const uint32_t *values, Action root, uint32_t instr)
+		{
+			Action stack[MaxDepth];
+			unsigned depth = 0;
+			Action action = root;
+
+			while(true) {
+				if(action & 1) {
+					return action >> 1;
+				}
+
+				if(action == 0) {
+					if(depth == 0) return -1;
+					action = stack[--depth];
+					continue;
+				}
+
+				const Group<Action> &group = groups[action >> 1];
+				stack[depth++] = group.next;
+
+				uint32_t field = (uint32_t)(((uint64_t)instr >> group.shift) & ((1ull << group.width) - 1));
+				if(!group.sparse) {
+					action = actions[group.base + field];
+					continue;
+				}
+
+				// Binary search the values of a sparse group
+				uint32_t low = group.base, high = group.base + group.count;
+				while(low < high) {
+					uint32_t mid = (low + high) / 2;
+					if(values[mid] < field) low = mid + 1;
+					else high = mid;
+				}
+				action = (low < group.base + group.count && values[low] == field) ? actions[low] : 0;
+			}
+		}
+
+	}
+}
+
+#endif /* _GENSIM_DECODE_TABLE_H */
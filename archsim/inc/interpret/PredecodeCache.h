@@ -0,0 +1,170 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   PredecodeCache.h
+ *
+ * A per-thread cache of decoded basic blocks for the interpreter. Each block
+ * holds the decoded instructions together with the handler which executes
+ * them, so that a cached block can be run without decoding anything or
+ * taking any locks.
+ *
+ * Blocks are indexed by virtual page, and then by offset within the page.
+ * Invalidation events may be published from any thread, so they are only
+ * recorded when they arrive and are applied by the owning thread the next
+ * time it looks up a block.
+ */
+
+#ifndef PREDECODECACHE_H
+#define PREDECODECACHE_H
+
+#include "abi/Address.h"
+#include "util/PubSubSync.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace gensim
+{
+	class BaseDecode;
+	class DecodeContext;
+}
+
+namespace archsim
+{
+	namespace core
+	{
+		namespace thread
+		{
+			class ThreadInstance;
+		}
+	}
+
+	namespace interpret
+	{
+		struct PredecodedInstruction {
+			gensim::BaseDecode *Decode;
+			void *Handler;
+		};
+
+		class PredecodedBlock
+		{
+		public:
+			PredecodedBlock(Address start, uint32_t mode) : start_(start), mode_(mode) {}
+			~PredecodedBlock();
+
+			Address GetStart() const
+			{
+				return start_;
+			}
+			uint32_t GetMode() const
+			{
+				return mode_;
+			}
+
+			const PredecodedInstruction *begin() const
+			{
+				return instructions_.data();
+			}
+			const PredecodedInstruction *end() const
+			{
+				return instructions_.data() + instructions_.size();
+			}
+			size_t size() const
+			{
+				return instructions_.size();
+			}
+
+			void AddInstruction(gensim::BaseDecode *decode, void *handler)
+			{
+				instructions_.push_back({decode, handler});
+			}
+
+		private:
+			Address start_;
+			uint32_t mode_;
+			std::vector<PredecodedInstruction> instructions_;
+		};
+
+		class PredecodeCache
+		{
+		public:
+			// Returns the handler which executes the given decoded instruction.
+			// The instruction which follows it in the block (or nullptr) is
+			// also given, so that pairs of instructions can share a handler.
+			typedef void *(*resolve_handler_t)(uint32_t mode, const gensim::BaseDecode &decode, const gensim::BaseDecode *next);
+
+			static const uint32_t kMaxBlockInstructions = 64;
+
+			PredecodeCache(util::PubSubContext &pubsub, bool enabled);
+			~PredecodeCache();
+
+			inline PredecodedBlock *Lookup(Address pc, uint32_t mode)
+			{
+				if(pending_.load(std::memory_order_relaxed)) {
+					ApplyInvalidations();
+				}
+
+				Page *page = pages_[pc.GetPageIndex() % kPageSlots];
+				if(page == nullptr || page->Base != pc.GetPageBase()) {
+					return nullptr;
+				}
+
+				PredecodedBlock *block = page->Blocks[BlockSlot(pc)];
+				if(block == nullptr || block->GetStart() != pc || block->GetMode() != mode) {
+					return nullptr;
+				}
+
+				return block;
+			}
+
+			/*
+			 * Decode the block starting at the given PC, and add it to the
+			 * cache. Returns non-zero if the first instruction could not be
+			 * decoded, in which case no block is created. The block remains
+			 * valid until the next lookup.
+			 */
+			uint32_t DecodeBlock(core::thread::ThreadInstance *thread, gensim::DecodeContext &decode_ctx, Address pc, uint32_t mode, resolve_handler_t resolve_handler, PredecodedBlock *&block);
+
+			// Drop every block. Must only be called by the owning thread.
+			void Invalidate();
+
+		private:
+			static const uint32_t kPageSlots = 256;
+			static const uint32_t kBlockSlots = Address::PageSize / 2;
+			static const uint64_t kNoPhysicalPage = ~0ULL;
+
+			struct Page {
+				Address::underlying_t Base;
+				Address::underlying_t PhysicalBase;
+				PredecodedBlock *Blocks[kBlockSlots];
+			};
+
+			static inline uint32_t BlockSlot(Address pc)
+			{
+				return (pc.GetPageOffset() >> 1) % kBlockSlots;
+			}
+
+			static void InvalidateCallback(PubSubType::PubSubType type, void *ctx, const void *data);
+
+			void ApplyInvalidations();
+			void FreePage(uint32_t slot);
+
+			bool enabled_;
+			Page *pages_[kPageSlots];
+
+			// When caching is disabled, the most recently decoded block
+			PredecodedBlock *uncached_block_;
+
+			std::atomic<bool> pending_;
+			std::mutex pending_lock_;
+			bool pending_flush_;
+			std::vector<Address::underlying_t> pending_virtual_pages_;
+			std::vector<Address::underlying_t> pending_physical_pages_;
+
+			util::PubSubscriber subscriber_;
+		};
+	}
+}
+
+#endif /* PREDECODECACHE_H */
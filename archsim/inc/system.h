@@ -23,6 +23,9 @@
 #include "module/ModuleManager.h"
 #include "session.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <set>
 #include <map>
@@ -53,6 +56,7 @@ namespace archsim
 		{
 			namespace timing
 			{
+				class TickConsumer;
 				class TickSource;
 			}
 		}
@@ -91,6 +95,18 @@ public:
 	bool RunSimulation();
 	void HaltSimulation();
 
+	/*
+	 * A checkpoint is a directory containing the state of the emulated
+	 * machine ("state") and a sparse image of guest physical memory
+	 * ("memory"), which is mapped copy-on-write when the checkpoint is
+	 * restored. RequestCheckpoint can be called from any thread: the cores
+	 * are halted, the checkpoint is written to the --checkpoint-save
+	 * directory, and the simulation then continues.
+	 */
+	void RequestCheckpoint();
+	bool SaveCheckpoint(const std::string &directory);
+	bool RestoreCheckpoint(const std::string &directory);
+
 	void EnableVerify();
 	void SetVerifyNext(System *sys);
 	void CheckVerify();
@@ -98,6 +114,8 @@ public:
 	static void InitVerify();
 
 	void PrintStatistics(std::ostream& stream);
+	void WriteMetrics(std::ostream& stream);
+	void WriteProfiles();
 
 	inline archsim::abi::EmulationModel& GetEmulationModel() const
 	{
@@ -114,16 +132,10 @@ public:
 		return breakpoints.count(addr);
 	}
 
-	inline void RegisterSegFaultHandler(uint64_t addr, size_t size, void *ctx, segfault_handler_t handler)
-	{
-		assert((addr & (getpagesize()-1)) == 0);
-		assert(segfault_handlers.find(addr) == segfault_handlers.end());
-		segfault_handler_registration_t& rg = segfault_handlers[addr];
-
-		rg.size = size;
-		rg.handler = handler;
-		rg.ctx = ctx;
-	}
+	// Handlers may be registered and unregistered from any thread, while
+	// faults are being handled
+	void RegisterSegFaultHandler(uint64_t addr, size_t size, void *ctx, segfault_handler_t handler);
+	void UnregisterSegFaultHandler(uint64_t addr);
 
 	inline void AddPerformanceSource(archsim::util::PerformanceSource& source)
 	{
@@ -153,6 +165,10 @@ public:
 		_tick_source = new_source;
 	}
 
+	// Called when every guest thread is idle, to move time straight on to
+	// the next timer deadline. Returns false if time could not be skipped.
+	bool SkipIdleTime();
+
 	inline archsim::Session& GetSession() const
 	{
 		return session;
@@ -218,6 +234,8 @@ private:
 	archsim::core::execution::ExecutionContextManager exec_ctx_mgr_;
 
 	bool _halted;
+	std::atomic<bool> checkpoint_requested_;
+	std::unique_ptr<archsim::abi::devices::timing::TickConsumer> checkpoint_trigger_;
 
 	archsim::util::PubSubContext pubsubctx;
 	archsim::translate::profile::CodeRegionTracker code_region_tracker_;
@@ -235,7 +253,16 @@ private:
 
 	typedef std::map<uint64_t, segfault_handler_registration_t> segfault_handler_map_t;
 
-	segfault_handler_map_t segfault_handlers;
+	// The SIGSEGV handler reads the current map without taking a lock, so
+	// registrations never modify it: they install an updated copy instead.
+	// Replaced maps might still be in use by a fault handler, so they are
+	// only freed along with the system. Registrations are rare, so this
+	// doesn't amount to much.
+	std::atomic<const segfault_handler_map_t *> segfault_handlers;
+	std::vector<std::unique_ptr<const segfault_handler_map_t>> segfault_handler_maps;
+	std::mutex segfault_handler_lock;
+
+	void ReplaceSegFaultHandlers(segfault_handler_map_t *handlers);
 
 	bool Simulate(bool trace);
 
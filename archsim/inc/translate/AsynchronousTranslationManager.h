@@ -11,13 +11,12 @@
 #define	ASYNCHRONOUSTRANSLATIONMANAGER_H
 
 #include "translate/TranslationManager.h"
+#include "translate/TranslationWorkQueue.h"
 #include "blockjit/BlockJitTranslate.h"
 #include "gensim/gensim_translate.h"
 
-#include <condition_variable>
 #include <list>
-#include <mutex>
-#include <queue>
+#include <memory>
 #include <unordered_set>
 
 #include <llvm/IR/LLVMContext.h>
@@ -38,12 +37,6 @@ namespace archsim
 
 		class AsynchronousTranslationWorker;
 
-		class WorkUnitQueueComparator
-		{
-		public:
-			bool operator()(const TranslationWorkUnit* lhs, const TranslationWorkUnit* rhs) const;
-		};
-
 		class AsynchronousTranslationManager : public TranslationManager
 		{
 			friend class AsynchronousTranslationWorker;
@@ -67,14 +60,13 @@ namespace archsim
 			 */
 			std::list<AsynchronousTranslationWorker *> workers;
 
-			/**
-			 * Lock and condition protecting the work unit queue.
-			 */
-			std::mutex work_unit_queue_lock;
-			std::condition_variable work_unit_queue_cond;
 			llvm::LLVMContext ctx_;
 
-			std::vector<TranslationWorkUnit *> work_unit_queue_;
+			/**
+			 * Work units waiting to be translated, created with one shard per
+			 * worker once the number of workers is known.
+			 */
+			std::unique_ptr<TranslationWorkQueue> work_queue_;
 		};
 	}
 }
@@ -0,0 +1,125 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   TranslationWorkQueue.h
+ *
+ * A heat-ordered queue of translation work units, shared between a number of
+ * worker threads. Each worker has its own shard (a max-heap ordered by unit
+ * weight) so that workers rarely contend on the same lock. A worker takes the
+ * hottest unit from whichever shard currently has the hottest head, which is
+ * usually its own, and otherwise steals from another shard.
+ *
+ * Unit weights keep growing while their regions are executed, so each shard
+ * periodically refreshes its weights and re-orders itself. Units whose
+ * regions have been invalidated are cancelled at the same time.
+ */
+
+#ifndef TRANSLATIONWORKQUEUE_H
+#define TRANSLATIONWORKQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace archsim
+{
+	namespace translate
+	{
+		class TranslationWorkUnit;
+
+		class TranslationWorkQueue
+		{
+		public:
+			typedef std::chrono::steady_clock clock_t;
+
+			// Weights are refreshed at most once per refresh interval
+			static const clock_t::duration kDefaultRefreshInterval;
+
+			TranslationWorkQueue(unsigned int shard_count, clock_t::duration refresh_interval = kDefaultRefreshInterval);
+			~TranslationWorkQueue();
+
+			/**
+			 * Add a unit to the queue. The queue takes ownership of the unit.
+			 */
+			void Push(TranslationWorkUnit *unit);
+
+			/**
+			 * Remove the hottest valid unit available to the given worker, or
+			 * return null if the queue is empty. The caller takes ownership of
+			 * the unit.
+			 */
+			TranslationWorkUnit *Pop(unsigned int worker);
+
+			/**
+			 * Block until the queue might be non-empty, or until terminate is set
+			 * and Wake is called.
+			 */
+			void WaitForWork(const volatile bool &terminate);
+			void Wake();
+
+			/**
+			 * Delete every queued unit.
+			 */
+			void Clear();
+
+			size_t Size() const
+			{
+				return size_;
+			}
+
+			void PrintStatistics(std::ostream &stream) const;
+
+		private:
+			struct Entry {
+				TranslationWorkUnit *Unit;
+				uint32_t Weight;
+				clock_t::time_point Enqueued;
+
+				bool operator<(const Entry &other) const
+				{
+					return Weight < other.Weight;
+				}
+			};
+
+			struct Shard {
+				std::mutex Lock;
+				std::vector<Entry> Heap;
+				clock_t::time_point LastRefresh;
+
+				// Weight of the head of the heap (or -1 if empty), so that workers
+				// can choose a shard without taking every lock
+				std::atomic<int64_t> HeadWeight;
+			};
+
+			void refresh(Shard &shard, std::vector<TranslationWorkUnit*> &cancelled);
+			bool popFrom(Shard &shard, Entry &entry, std::vector<TranslationWorkUnit*> &cancelled);
+			void updateHead(Shard &shard);
+
+			const clock_t::duration refresh_interval_;
+
+			std::vector<std::unique_ptr<Shard>> shards_;
+			std::atomic<unsigned int> next_shard_;
+			std::atomic<size_t> size_;
+
+			std::mutex wait_lock_;
+			std::condition_variable wait_cond_;
+
+			// Statistics
+			std::atomic<uint64_t> enqueued_;
+			std::atomic<uint64_t> dequeued_;
+			std::atomic<uint64_t> stolen_;
+			std::atomic<uint64_t> cancelled_;
+			std::atomic<uint64_t> refreshes_;
+			std::atomic<size_t> max_size_;
+			std::atomic<uint64_t> total_wait_us_;
+			std::atomic<uint64_t> max_wait_us_;
+		};
+	}
+}
+
+#endif /* TRANSLATIONWORKQUEUE_H */
@@ -57,6 +57,9 @@ extern "C" {
 
 	void cpuReturnToSafepoint(gensim::Processor *cpu);
 	void cpuPendInterrupt(archsim::core::thread::ThreadInstance *cpu);
+	void cpuWaitForInterrupt(archsim::core::thread::ThreadInstance *cpu);
+	void cpuWaitForEvent(archsim::core::thread::ThreadInstance *cpu);
+	void cpuSendEvent(archsim::core::thread::ThreadInstance *cpu);
 
 	uint32_t cpuTranslate(gensim::Processor *cpu, uint32_t virt_addr, uint32_t *phys_addr);
 	void cpuTrap(archsim::core::thread::ThreadInstance *cpu);
@@ -84,7 +87,7 @@ extern "C" {
 
 	void cpuEnterKernelMode(gensim::Processor *cpu);
 	void cpuEnterUserMode(gensim::Processor *cpu);
-	void cpuInstructionTick(archsim::core::thread::ThreadInstance *cpu);
+	void cpuInstructionTick(archsim::core::thread::ThreadInstance *cpu, uint32_t count);
 
 	void cpuTraceString(gensim::Processor *cpu, const char* str, uint32_t do_emit);
 
@@ -44,6 +44,12 @@ namespace archsim
 
 				LLVMTranslation *GetTranslation(LLVMCompiledModuleHandle &module, TranslationWorkUnit &twu);
 
+				/**
+				 * Look up the address of a compiled function, or return nullptr if
+				 * it could not be found (or compiled).
+				 */
+				void *GetSymbol(LLVMCompiledModuleHandle &module, const std::string &name);
+
 				void GC()
 				{
 					code_pool.GC();
@@ -77,6 +77,7 @@ namespace archsim
 					llvm::Function *cpuWrite8, *cpuWrite16, *cpuWrite32, *cpuWrite64;
 
 					llvm::Function *cpuEnterUser, *cpuEnterKernel, *cpuPendIRQ, *cpuPushInterrupt;
+					llvm::Function *cpuWaitForInterrupt, *cpuWaitForEvent, *cpuSendEvent;
 
 					llvm::Function *cpuTraceInstruction;
 
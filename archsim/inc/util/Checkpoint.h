@@ -0,0 +1,138 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+// =====================================================================
+//
+// Description:
+//
+// Container for the non-memory state of a simulation checkpoint. The
+// state is kept as a set of named sections, each of which is an opaque
+// blob written by one component:
+//
+//   header:  char magic[8] = "ASCKPT\0\0", uint32 version,
+//            uint32 section count
+//   section: uint32 name length, uint32 reserved, uint64 data length,
+//            char name[name length], uint8 data[data length]
+//
+// All fields are little endian. Guest physical memory is not stored here,
+// but in a sparse page image next to the state file (see
+// MMAPPhysicalMemory::SaveSnapshot) so that it can be mapped copy on
+// write when the checkpoint is restored.
+//
+// =====================================================================
+
+#ifndef INC_UTIL_CHECKPOINT_H_
+#define INC_UTIL_CHECKPOINT_H_
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace archsim
+{
+	namespace util
+	{
+		class CheckpointWriter
+		{
+		public:
+			CheckpointWriter(std::vector<uint8_t> &data) : data_(data) { }
+
+			void Write(const void *data, size_t size)
+			{
+				const uint8_t *bytes = (const uint8_t *)data;
+				data_.insert(data_.end(), bytes, bytes + size);
+			}
+
+			template<typename T> void Write(const T &value)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written directly");
+				Write(&value, sizeof(value));
+			}
+
+			void WriteString(const std::string &str)
+			{
+				Write<uint32_t>(str.size());
+				Write(str.data(), str.size());
+			}
+
+		private:
+			std::vector<uint8_t> &data_;
+		};
+
+		class CheckpointReader
+		{
+		public:
+			CheckpointReader(const std::vector<uint8_t> &data) : data_(data), offset_(0) { }
+
+			bool Read(void *data, size_t size)
+			{
+				if(size > data_.size() - offset_) {
+					return false;
+				}
+
+				memcpy(data, data_.data() + offset_, size);
+				offset_ += size;
+				return true;
+			}
+
+			template<typename T> bool Read(T &value)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read directly");
+				return Read(&value, sizeof(value));
+			}
+
+			bool ReadString(std::string &str)
+			{
+				uint32_t size;
+				if(!Read(size) || size > data_.size() - offset_) {
+					return false;
+				}
+
+				str.assign((const char *)data_.data() + offset_, size);
+				offset_ += size;
+				return true;
+			}
+
+			bool AtEnd() const
+			{
+				return offset_ == data_.size();
+			}
+
+		private:
+			const std::vector<uint8_t> &data_;
+			size_t offset_;
+		};
+
+		class Checkpoint
+		{
+		public:
+			// Start a new, empty, section. Each section may only be added once.
+			CheckpointWriter AddSection(const std::string &name);
+
+			bool HasSection(const std::string &name) const
+			{
+				return sections_.count(name) != 0;
+			}
+
+			// Returns a reader for the given section, which must exist.
+			CheckpointReader GetSection(const std::string &name) const;
+
+			const std::map<std::string, std::vector<uint8_t>> &GetSections() const
+			{
+				return sections_;
+			}
+
+			bool Save(std::ostream &stream) const;
+			bool Load(std::istream &stream);
+
+		private:
+			std::map<std::string, std::vector<uint8_t>> sections_;
+		};
+	}
+}  // namespace archsim::util
+
+#endif  // INC_UTIL_CHECKPOINT_H_
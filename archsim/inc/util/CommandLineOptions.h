@@ -18,9 +18,11 @@ DefineFlag(Help, 'h', "help");
 DefineFlag(Quiet, 'q', "quiet");
 DefineFlag(Debug, 'd', "debug");
 DefineFlag(Verbose, 'v', "verbose");
+DefineLongRequiredArgument(std::string, MetricsFile, "metrics-file");
 DefineLongFlag(Profile, "profile");
 DefineLongFlag(ProfilePcFreq, "profile-pc");
 DefineLongFlag(ProfileIrFreq, "profile-ir");
+DefineLongRequiredArgument(std::string, ProfileFile, "profile-file");
 
 DefineLongFlag(EnablePerfMap, "enable-perf-map");
 
@@ -68,6 +70,8 @@ DefineLongFlag(JitDebugAA, "debug-aa");
 DefineLongFlag(JitUseIJ, "jit-use-ij");
 DefineLongRequiredArgument(uint32_t, JitHotspotThreshold, "hotspot-threshold");
 DefineLongRequiredArgument(uint32_t, JitProfilingInterval, "profiling-interval");
+DefineLongRequiredArgument(uint32_t, JitCodeCacheSize, "jit-code-cache-size");
+DefineLongRequiredArgument(uint32_t, JitTierUpThreshold, "tier-up-threshold");
 DefineRequiredArgument(uint32_t, JitOptLevel, 'O', "opt-level");
 
 DefineLongFlag(JitExtraCounters, "extra-counters");
@@ -82,18 +86,32 @@ DefineLongRequiredArgument(std::string, DeviceTreeFile, "device-tree");
 DefineLongRequiredArgument(std::string, RootFS, "root-fs");
 DefineLongRequiredArgument(std::string, BlockDeviceFile, "bdev-file");
 DefineLongFlag(CopyOnWrite, "copy-on-write");
+DefineLongFlag(VirtIOSyncIO, "virtio-sync-io");
 DefineLongRequiredArgument(std::string, KernelArgs, "kernel-args");
 DefineLongRequiredArgument(std::string, Bootloader, "bootloader");
 DefineLongRequiredArgument(std::string, SystemMemoryModel, "sys-model");
+DefineLongRequiredArgument(uint32_t, ShadowPageTableBits, "shadow-bits");
 DefineLongFlag(LazyMemoryModelInvalidation, "lazy-mem-inv");
+DefineLongRequiredArgument(std::string, MemoryBackingFile, "mem-backing");
+DefineLongFlag(MemoryBackingPrivate, "mem-private");
+DefineLongFlag(MemoryHugePages, "mem-huge-pages");
+DefineLongRequiredArgument(std::string, MemorySnapshotFile, "mem-snapshot");
+DefineLongRequiredArgument(std::string, CheckpointSave, "checkpoint-save");
+DefineLongRequiredArgument(uint64_t, CheckpointAt, "checkpoint-at");
+DefineLongFlag(CheckpointExit, "checkpoint-exit");
+DefineLongRequiredArgument(std::string, CheckpointRestore, "checkpoint-restore");
+DefineLongRequiredArgument(std::string, ForkServer, "fork-server");
 DefineLongRequiredArgument(std::string, ScreenManagerType, "screen");
+DefineLongFlag(ScreenNoWriteTracking, "screen-no-write-tracking");
 DefineLongFlag(SerialGrab, "grab-serial");
 
 DefineLongRequiredArgument(std::string, JitTranslationManager, "txln-mgr");
 DefineLongFlag(JitDisableBranchOpt, "disable-branch-opt");
+DefineLongFlag(JitDisableAVX, "jit-no-avx");
 
 DefineLongFlag(JitLoadTranslations, "jit-load-txlns");
 DefineLongFlag(JitSaveTranslations, "jit-save-txlns");
+DefineLongRequiredArgument(std::string, JitTranslationCacheFile, "jit-txln-cache");
 
 // Special Options
 DefineLongFlag(Doom, "doom");
@@ -71,6 +71,7 @@ namespace wulib
 			{
 				_data = (uint8_t*)mmap(NULL, kChunkSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
 				_data_ptr = _data;
+				RegisterChunk(_data);
 
 #ifndef NDEBUG
 #ifdef CONFIG_VALGRIND
@@ -85,6 +86,7 @@ namespace wulib
 				VALGRIND_DESTROY_MEMPOOL(_data);
 #endif
 #endif
+				UnregisterChunk(_data);
 				munmap(_data, kChunkSize);
 			}
 
@@ -204,7 +206,21 @@ namespace wulib
 		void Free(void *buffer) override;
 
 		float Efficiency() const;
+
+		// Is ptr inside a chunk belonging to any zone allocator? This is used
+		// to recognise JIT generated code, and is safe to call from a signal
+		// handler.
+		static bool IsZoneMemory(const void *ptr);
+
+		// The number of bytes mapped for chunks, including unused space
+		size_t GetFootprint() const
+		{
+			return _chunks.size() * Chunk::kChunkSize;
+		}
 	private:
+		static void RegisterChunk(uint8_t *data);
+		static void UnregisterChunk(uint8_t *data);
+
 		typedef Chunk chunk_t;
 		std::list<chunk_t*> _chunks;
 		chunk_t *_active_chunk;
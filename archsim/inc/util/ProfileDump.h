@@ -0,0 +1,71 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+// =====================================================================
+//
+// Description:
+//
+// Streaming binary format for profile histograms. A file is a header
+// followed by any number of sections, one per histogram:
+//
+//   header:  char magic[8] = "ASPROF\0\0", uint32 version, uint32 reserved
+//   section: uint32 name length, uint32 thread id, char name[length]
+//            then chunks of { uint32 count, uint32 reserved,
+//                             count x { uint64 key, uint64 value } }
+//            terminated by a chunk with a count of zero
+//
+// All fields are little endian. Sections are written one chunk at a time,
+// so a histogram never has to be copied or sorted to be dumped. Profiles
+// from several threads or runs are combined with archsim-profile.
+//
+// =====================================================================
+
+#ifndef INC_UTIL_PROFILEDUMP_H_
+#define INC_UTIL_PROFILEDUMP_H_
+
+#include "util/ProfileHistogram.h"
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace archsim
+{
+	namespace util
+	{
+		class ProfileWriter
+		{
+		public:
+			// Thread ID used for sections which combine several threads
+			static const uint32_t kAllThreads = 0xffffffff;
+
+			ProfileWriter(std::ostream &stream);
+
+			bool WriteHeader();
+			bool WriteHistogram(const std::string &name, uint32_t thread_id, const ProfileHistogram &histogram);
+
+		private:
+			std::ostream &stream_;
+		};
+
+		class ProfileReader
+		{
+		public:
+			typedef std::function<void(const std::string &name, uint32_t thread_id, uint64_t key, uint64_t value)> entry_callback_t;
+
+			ProfileReader(std::istream &stream);
+
+			bool ReadHeader();
+
+			// Calls the callback for every entry of every remaining section,
+			// returning false if the stream is malformed.
+			bool ReadAll(const entry_callback_t &callback);
+
+		private:
+			std::istream &stream_;
+		};
+	}
+}  // namespace archsim::util
+
+#endif  // INC_UTIL_PROFILEDUMP_H_
@@ -0,0 +1,153 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+// =====================================================================
+//
+// Description:
+//
+// Compact histogram for high-volume profiling (e.g. of guest PCs). Keys
+// are split into a page number and an offset: each page of keys gets a
+// flat array of counters, and pages are found through an open-addressed
+// directory. Counters never move once they have been allocated, so JIT
+// code can increment them directly, and counting an already seen key
+// never allocates.
+//
+// Pages are only ever added, so other threads can read the counters
+// (e.g. to merge the histograms of all threads when dumping them) without
+// taking any locks.
+//
+// =====================================================================
+
+#ifndef INC_UTIL_PROFILEHISTOGRAM_H_
+#define INC_UTIL_PROFILEHISTOGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace archsim
+{
+	namespace util
+	{
+		class ProfileHistogram
+		{
+		public:
+			typedef uint64_t key_t;
+			typedef uint64_t value_t;
+
+			static const unsigned kDefaultPageBits = 10;
+
+			explicit ProfileHistogram(unsigned page_bits = kDefaultPageBits);
+			~ProfileHistogram();
+
+			ProfileHistogram(const ProfileHistogram &) = delete;
+			ProfileHistogram &operator=(const ProfileHistogram &) = delete;
+
+			// Get pointer to the counter for a key. The page holding the counter
+			// is allocated if this is the first key seen from it.
+			//
+			value_t *get_value_ptr_at_index(key_t key)
+			{
+				value_t *page = lookup_page(key >> page_bits_);
+				if(page == nullptr) {
+					page = allocate_page(key >> page_bits_);
+				}
+				return &page[key & page_mask_];
+			}
+
+			void inc(key_t key)
+			{
+				++*get_value_ptr_at_index(key);
+			}
+			void inc(key_t key, value_t val)
+			{
+				*get_value_ptr_at_index(key) += val;
+			}
+
+			// Get the value of a key, without allocating anything
+			//
+			value_t get_value_at_index(key_t key) const;
+
+			// Sum all counters
+			//
+			value_t get_total() const;
+
+			// Reset all counters to 0, keeping the pages allocated
+			//
+			void clear();
+
+			// Visit every non-zero counter, in no particular order
+			//
+			void for_each(const std::function<void(key_t, value_t)> &fn) const;
+
+			// Add all of the counters from another histogram to this one
+			//
+			void merge(const ProfileHistogram &other);
+
+			unsigned get_page_bits() const
+			{
+				return page_bits_;
+			}
+			size_t get_page_count() const
+			{
+				return page_count_.load(std::memory_order_acquire);
+			}
+
+		private:
+			struct DirectoryEntry {
+				// Page number + 1, so that zero marks an empty slot
+				std::atomic<uint64_t> tag;
+				value_t *page;
+			};
+
+			struct Directory {
+				Directory(size_t capacity);
+				~Directory();
+
+				size_t mask;
+				DirectoryEntry *entries;
+			};
+
+			static size_t hash(uint64_t page_number)
+			{
+				return (page_number * 0x9e3779b97f4a7c15ull) >> 16;
+			}
+
+			value_t *lookup_page(uint64_t page_number) const
+			{
+				const Directory *dir = directory_.load(std::memory_order_acquire);
+				uint64_t tag = page_number + 1;
+
+				for(size_t slot = hash(page_number);; ++slot) {
+					const DirectoryEntry &entry = dir->entries[slot & dir->mask];
+					uint64_t entry_tag = entry.tag.load(std::memory_order_acquire);
+
+					if(entry_tag == tag) return entry.page;
+					if(entry_tag == 0) return nullptr;
+				}
+			}
+
+			value_t *allocate_page(uint64_t page_number);
+			void insert_page(Directory *dir, uint64_t page_number, value_t *page);
+
+			unsigned page_bits_;
+			key_t page_mask_;
+
+			std::atomic<Directory *> directory_;
+			std::atomic<size_t> page_count_;
+
+			// Directories which have been replaced, but which readers may still
+			// be looking at
+			std::vector<Directory *> retired_directories_;
+
+			// Pages are carved out of larger chunks
+			std::vector<value_t *> chunks_;
+			size_t chunk_pages_left_;
+
+			std::mutex allocation_lock_;
+		};
+	}
+}  // namespace archsim::util
+
+#endif  // INC_UTIL_PROFILEHISTOGRAM_H_
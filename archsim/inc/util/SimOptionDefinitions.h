@@ -39,19 +39,21 @@ DefineFlag(General, Verbose, "Enables verbose output reporting", false);
 DefineFlag(General, Verify, "Enables JIT verification", false);
 DefineSetting(General, VerifyMode, "Verification mode", "process");
 DefineFlag(General, VerifyBlocks, "Verification should be done at block granularity", false);
+DefineSetting(General, MetricsFile, "Writes per-thread metrics as JSON to the given file (counts require --verbose)", "");
 DefineFlag(General, LivePerformance, "Enables live performance measurements", false);
 DefineFlag(General, MemEventCounting, "Enables memory event counting", false);
 
 DefineFlag(Profiling, Profile, "Enables profiling", false);
 DefineFlag(Profiling, ProfilePcFreq, "Enables PC frequency profiling", false);
 DefineFlag(Profiling, ProfileIrFreq, "Enables IR frequency profiling", false);
+DefineSetting(Profiling, ProfileFile, "Writes the opcode, PC and IR profiles of each thread to the given file, for use with archsim-profile", "");
 
 DefineFlag(Tracing, Trace, "Enables tracing output", false);
 DefineInt64Setting(Tracing, TraceSkip, "Skip instruction count", 0);
 DefineFlag(Tracing, SimpleTrace, "Simplified tracing", false);
 DefineFlag(Tracing, TraceSymbols, "Enables symbol resolution in tracing output", false);
 DefineFlag(Tracing, SuppressTracing, "Suppress tracing output at system startup", false);
-DefineSetting(Tracing, TraceMode, "Selects tracing output mode", "binary");
+DefineSetting(Tracing, TraceMode, "Selects tracing output mode (binary, or lz4 for compressed traces written in the background)", "binary");
 DefineSetting(Tracing, TraceFile, "Redirects tracing output to a file", "trace.out");
 DefineSetting(Tracing, StdOutFile, "Redirects stdout to a file", "stdout");
 DefineSetting(Tracing, StdErrFile, "Redirects stderr to a file", "stderr");
@@ -62,6 +64,16 @@ DefineSetting(System, ProcessorName, "Selects the name of the processor implemen
 DefineSetting(System, EmulationModel, "Selects the emulation model to use", "");
 DefineSetting(System, MemoryModel, "Selects the memory model to use", "");
 DefineSetting(System, SystemMemoryModel, "Select the model to use for system memory", "base");
+DefineIntSetting(System, ShadowPageTableBits, "Number of bits of guest virtual address space covered by the shadow page table (with the shadow sys-model)", 32);
+DefineSetting(System, MemoryBackingFile, "File which backs guest physical memory in the mmap memory model (an anonymous memory file is used if not given)", "");
+DefineFlag(System, MemoryBackingPrivate, "Map the memory backing file copy-on-write, so that guest writes never reach it", false);
+DefineFlag(System, MemoryHugePages, "Use huge pages for guest physical memory in the mmap memory model", false);
+DefineSetting(System, MemorySnapshotFile, "Write guest physical memory to this file at the end of simulation (mmap memory model only)", "");
+DefineSetting(System, CheckpointSave, "Directory to write checkpoints to, when one is requested (with SIGUSR2 or --checkpoint-at)", "");
+DefineInt64Setting(System, CheckpointAt, "Write a checkpoint when the tick counter reaches this value", 0);
+DefineFlag(System, CheckpointExit, "Exit after writing a checkpoint, rather than continuing the simulation", false);
+DefineSetting(System, CheckpointRestore, "Directory to restore a checkpoint from, instead of booting the guest", "");
+DefineSetting(System, ForkServer, "Restore the checkpoint in a new process for each connection to this unix socket", "");
 DefineFlag(System, LazyMemoryModelInvalidation, "Uses lazy invalidation for the memory model", false);
 DefineFlag(System, MemoryCheckAlignment, "Enforce strict alignment on memory accesses", true);
 DefineFlag(System, EnablePerfMap, "Enable Perf-compatible JIT map", false);
@@ -97,15 +109,19 @@ DefineSetting(JIT, JitOptString, "Selects the optimisation passes to use with LL
 DefineFlag(JIT, JitDisableAA, "Disables custom alias-analysis in the JIT", false);
 DefineIntSetting(JIT, JitHotspotThreshold, "Chooses the number of times a region must be profiled to become hot", 20);
 DefineIntSetting(JIT, JitProfilingInterval, "Chooses the number of basic-blocks to execute before considering regions for compilation", 30000);
+DefineIntSetting(JIT, JitCodeCacheSize, "Chooses the maximum amount of translated code to keep, in MiB (0 for no limit)", 64);
+DefineIntSetting(JIT, JitTierUpThreshold, "Chooses the number of times a block must execute before it is recompiled with LLVM (TieredJIT only)", 10000);
 DefineIntSetting(JIT, TransCacheSize, "Sets the size of the translation cache", 8192);
 DefineIntSetting(JIT, JitOptLevel, "Sets the optimisation level for translation", 3);
 DefineFlag(JIT, JitDisableBranchOpt, "Disable branch optimisations", false);
+DefineFlag(JIT, JitDisableAVX, "Use SSE rather than AVX encodings for vector operations in the BlockJIT", false);
 DefineFlag(JIT, JitExtraCounters, "Enable extra JIT counters", false);
 DefineFlag(JIT, JitDebugAA, "Produce alias-analysis debugging output", false);
 DefineFlag(JIT, JitUseIJ, "Use the instruction JIT to perform non-native execution", false);
 DefineFlag(JIT, JitChecksumPages, "Produce and check checksums of JITed code on generation and execution", false);
-DefineFlag(JIT, JitSaveTranslations, "Keep JIT translations between simulation runs", false);
-DefineFlag(JIT, JitLoadTranslations, "Keep JIT translations between simulation runs", false);
+DefineFlag(JIT, JitSaveTranslations, "Save JIT translations for use by later simulation runs", false);
+DefineFlag(JIT, JitLoadTranslations, "Load JIT translations saved by an earlier simulation run", false);
+DefineSetting(JIT, JitTranslationCacheFile, "Selects the file used to keep JIT translations between simulation runs", "archsim-txlns.cache");
 
 DefineFlag(JIT, AggressiveCodeInvalidation, "Invalidate all code on a cache flush, rather than just detected modifications", false);
 
@@ -117,11 +133,13 @@ DefineIntSetting(System, GuestStackSize, "Chooses the default size for the guest
 
 DefineListSetting(Platform, EnabledDevices, "List of devices to enable for this simulation", new std::list<std::string>());
 DefineSetting(Platform, ScreenManagerType, "Type of screen manager to use", "Null");
+DefineFlag(Platform, ScreenNoWriteTracking, "Compare the whole framebuffer on every frame, rather than write protecting it to find the pages which changed", false);
 DefineSetting(Platform, DeviceTreeFile, "Path to flattened device tree file", "");
 DefineSetting(Platform, KernelArgs, "Arguments to pass into the linux kernel", "");
 DefineSetting(Platform, RootFS, "Path to initrd rootfs", "");
 DefineSetting(Platform, BlockDeviceFile, "Path to block device file", "");
 DefineFlag(Platform, CopyOnWrite, "Copy on write block device", false);
+DefineFlag(Platform, VirtIOSyncIO, "Process virtio requests on the CPU which notifies the device, rather than on an I/O thread", false);
 DefineIntSetting(Platform, RootFSLocation, "Physical memory location to write initrd to", 0x800000);
 DefineSetting(Platform, Bootloader, "Bootloader for ELF system emulation", "");
 DefineFlag(Platform, SerialGrab, "Take control of the terminal for use as a serial port", false);
@@ -48,6 +48,10 @@ namespace archsim
 
 				bool Initialise() override;
 
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+				void StateRestored() override;
+
 				COMPONENT_PARAMETER_ENTRY_HDR(IRQLine, IRQLine, IRQLine);
 				COMPONENT_PARAMETER_ENTRY_HDR(Owner, GIC.GIC, GIC);
 			private:
@@ -78,6 +82,11 @@ namespace archsim
 
 				bool Initialise() override;
 
+				// The per-interrupt state lives in the GIC itself, which is not
+				// a memory component, so it is saved along with the distributor
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+
 				COMPONENT_PARAMETER_ENTRY_HDR(Owner, GIC.GIC, GIC);
 			private:
 				uint32_t ctrl;
@@ -118,6 +127,9 @@ namespace archsim
 				virtual bool RescindLine(uint32_t line_no) override; // captive irq_rescinded
 
 				bool Initialise() override;
+
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
 			private:
 				std::mutex lock;
 
@@ -68,6 +68,10 @@ namespace archsim
 
 				bool Initialise() override;
 
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+				void StateRestored() override;
+
 			private:
 				std::atomic<uint32_t> irq_level;
 				uint32_t soft_level, enable, fiq_select;
@@ -14,6 +14,8 @@
 #include "util/TimerManager.h"
 #include "concurrent/Thread.h"
 
+#include <algorithm>
+
 // ARM Dual Timer Module (SP804)
 // Consists of two 32/16 bit count-down timers which generate interrupts on reaching 0
 
@@ -41,6 +43,10 @@ namespace archsim
 					bool Read(uint32_t offset, uint8_t size, uint64_t& data) override;
 					bool Write(uint32_t offset, uint8_t size, uint64_t data) override;
 
+					void SaveState(util::CheckpointWriter &writer) override;
+					bool RestoreState(util::CheckpointReader &reader) override;
+					void StateRestored() override;
+
 					void Suspend()
 					{
 						suspended = true;
@@ -60,6 +66,9 @@ namespace archsim
 						bool ReadRegister(uint32_t offset, uint64_t& data);
 						bool WriteRegister(uint32_t offset, uint32_t data);
 
+						void SaveState(util::CheckpointWriter &writer) const;
+						bool RestoreState(util::CheckpointReader &reader);
+
 						inline void SetManager(util::timing::TimerManager& mgr)
 						{
 							this->mgr = &mgr;
@@ -86,6 +95,12 @@ namespace archsim
 							return enabled;
 						}
 
+						// The number of Tick(ticks) calls until the counter reaches zero
+						inline uint64_t GetTicksUntilZero(uint32_t ticks) const
+						{
+							return std::max<uint64_t>(((uint64_t)current_value + ticks - 1) / ticks, 1);
+						}
+
 						void GetNextFileTick();
 
 					private:
@@ -120,9 +135,10 @@ namespace archsim
 					};
 
 					void Tick(uint32_t tick_periods) override;
+					uint64_t GetTicksUntilDeadline() override;
 
 				protected:
-					void tick();
+					void tick(uint32_t tick_periods);
 
 				private:
 					void UpdateIRQ();
@@ -32,6 +32,9 @@ namespace archsim
 				bool Read(uint32_t offset, uint8_t size, uint64_t& data) override;
 				bool Write(uint32_t offset, uint8_t size, uint64_t data) override;
 
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+
 				uint64_t hr_begin;
 
 			private:
@@ -36,6 +36,10 @@ namespace archsim
 				uint32_t ReadRegister(MemoryRegister& reg) override;
 				void WriteRegister(MemoryRegister& reg, uint32_t value) override;
 
+				void SaveState(util::CheckpointWriter &writer) override;
+				bool RestoreState(util::CheckpointReader &reader) override;
+				void StateRestored() override;
+
 			private:
 				MemoryRegister SIC_STATUS;
 				MemoryRegister SIC_RAWSTAT;
@@ -43,6 +43,19 @@ namespace archsim
 				return true;
 			}
 
+			void GICDistributorInterface::SaveState(util::CheckpointWriter& writer)
+			{
+				writer.Write(ctrl);
+				writer.Write(cpu_targets);
+				writer.Write(config);
+				GetOwner()->SaveState(writer);
+			}
+
+			bool GICDistributorInterface::RestoreState(util::CheckpointReader& reader)
+			{
+				return reader.Read(ctrl) && reader.Read(cpu_targets) && reader.Read(config) && GetOwner()->RestoreState(reader);
+			}
+
 			bool GICDistributorInterface::Read(uint32_t off, uint8_t len, uint64_t& data)
 			{
 				LC_DEBUG2(LogGIC) << "Distributor read: offset " << off;
@@ -260,6 +273,27 @@ namespace archsim
 				return true;
 			}
 
+			void GICCPUInterface::SaveState(util::CheckpointWriter& writer)
+			{
+				writer.Write(last_active);
+				writer.Write(running_irq);
+				writer.Write(ctrl);
+				writer.Write(prio_mask);
+				writer.Write(binpnt);
+				writer.Write(current_pending);
+				writer.Write(running_priority);
+			}
+
+			bool GICCPUInterface::RestoreState(util::CheckpointReader& reader)
+			{
+				return reader.Read(last_active) && reader.Read(running_irq) && reader.Read(ctrl) && reader.Read(prio_mask) && reader.Read(binpnt) && reader.Read(current_pending) && reader.Read(running_priority);
+			}
+
+			void GICCPUInterface::StateRestored()
+			{
+				update();
+			}
+
 			bool GICCPUInterface::Read(uint32_t off, uint8_t len, uint64_t& data)
 			{
 				LC_DEBUG2(LogGIC) << "CPU Interface read " << std::hex << off;
@@ -453,6 +487,44 @@ namespace archsim
 				return true;
 			}
 
+			void GIC::SaveState(util::CheckpointWriter& writer)
+			{
+				std::lock_guard<std::mutex> l(lock);
+
+				for (const auto &irq : irqs) {
+					writer.Write<uint8_t>(irq.enabled);
+					writer.Write<uint8_t>(irq.pending);
+					writer.Write<uint8_t>(irq.active);
+					writer.Write<uint8_t>(irq.model);
+					writer.Write<uint8_t>(irq.raised);
+					writer.Write<uint8_t>(irq.edge_triggered);
+					writer.Write(irq.priority);
+				}
+
+				SaveLineState(writer);
+			}
+
+			bool GIC::RestoreState(util::CheckpointReader& reader)
+			{
+				std::lock_guard<std::mutex> l(lock);
+
+				for (auto &irq : irqs) {
+					uint8_t flags[6];
+					if (!reader.Read(flags) || !reader.Read(irq.priority)) {
+						return false;
+					}
+
+					irq.enabled = flags[0];
+					irq.pending = flags[1];
+					irq.active = flags[2];
+					irq.model = flags[3];
+					irq.raised = flags[4];
+					irq.edge_triggered = flags[5];
+				}
+
+				return RestoreLineState(reader);
+			}
+
 			bool GIC::AssertLine(uint32_t l)
 			{
 #ifdef DEBUG_IRQ
@@ -105,6 +105,42 @@ namespace archsim
 
 			}
 
+			void PL190::SaveState(util::CheckpointWriter& writer)
+			{
+				writer.Write(irq_level.load());
+				writer.Write(soft_level);
+				writer.Write(enable);
+				writer.Write(fiq_select);
+				writer.Write(priority);
+				writer.Write(prev_priority);
+				writer.Write(vector_ctrls);
+				writer.Write(vector_addrs);
+				writer.Write(default_vector_address);
+
+				inner_controller.SaveLineState(writer);
+			}
+
+			bool PL190::RestoreState(util::CheckpointReader& reader)
+			{
+				uint32_t level;
+				if(!reader.Read(level) || !reader.Read(soft_level) || !reader.Read(enable) || !reader.Read(fiq_select)) {
+					return false;
+				}
+				irq_level = level;
+
+				if(!reader.Read(priority) || !reader.Read(prev_priority) || !reader.Read(vector_ctrls) || !reader.Read(vector_addrs) || !reader.Read(default_vector_address)) {
+					return false;
+				}
+
+				return inner_controller.RestoreLineState(reader);
+			}
+
+			void PL190::StateRestored()
+			{
+				// Recomputes the priority masks, and drives the output lines
+				update_vectors();
+			}
+
 
 			int PL190::GetComponentID()
 			{
@@ -46,6 +46,10 @@ bool SP804::Read(uint32_t offset, uint8_t size, uint64_t& data)
 	LC_DEBUG1(LogSP804) << "["<< std::hex  << GetBaseAddress() << "] Read "<< offset << " = ...";
 
 //	fprintf(stderr, "SP804 Read: offset: %x", offset);
+	if (offset < 0x40) {
+		emu_model.GetSystem().GetTickSource()->Synchronise();
+	}
+
 	if (offset < 0x20) {
 		assert(size == 4);
 		return timers[0].ReadRegister(offset, data);
@@ -61,15 +65,43 @@ bool SP804::Write(uint32_t offset, uint8_t size, uint64_t data)
 {
 //	fprintf(stderr, "SP804 Write offset: %x, size: %x, data: %x\n", offset, size, data);
 	LC_DEBUG1(LogSP804) << "["<< std::hex  << GetBaseAddress() << "] Write "<< offset << " = " << data;
+	if (offset >= 0x40) {
+		return PrimecellRegisterDevice::Write(offset, size, data);
+	}
+
+	// Count down with the old settings up to now, and work out when the
+	// next interrupt is due with the new ones
+	auto tick_source = emu_model.GetSystem().GetTickSource();
+	tick_source->Synchronise();
+
+	assert(size == 4);
+	bool result;
 	if (offset < 0x20) {
-		assert(size == 4);
-		return timers[0].WriteRegister(offset, data);
-	} else if (offset < 0x40) {
-		assert(size == 4);
-		return timers[1].WriteRegister(offset - 0x20, data);
+		result = timers[0].WriteRegister(offset, data);
 	} else {
-		return PrimecellRegisterDevice::Write(offset, size, data);
+		result = timers[1].WriteRegister(offset - 0x20, data);
 	}
+
+	tick_source->Reschedule(*this);
+	return result;
+}
+
+void SP804::SaveState(util::CheckpointWriter& writer)
+{
+	PrimecellRegisterDevice::SaveState(writer);
+	timers[0].SaveState(writer);
+	timers[1].SaveState(writer);
+	writer.Write(suspended);
+}
+
+bool SP804::RestoreState(util::CheckpointReader& reader)
+{
+	return PrimecellRegisterDevice::RestoreState(reader) && timers[0].RestoreState(reader) && timers[1].RestoreState(reader) && reader.Read(suspended);
+}
+
+void SP804::StateRestored()
+{
+	UpdateIRQ();
 }
 
 void SP804::UpdateIRQ()
@@ -87,13 +119,30 @@ void SP804::UpdateIRQ()
 
 void SP804::Tick(uint32_t tick_periods)
 {
-	tick();
+	tick(tick_periods);
+}
+
+uint64_t SP804::GetTicksUntilDeadline()
+{
+	if (suspended) return kNoDeadline;
+
+	uint64_t deadline = kNoDeadline;
+	for (auto &timer : timers) {
+		if (timer.IsEnabled() && timer.IsIRQEnabled()) {
+			deadline = std::min(deadline, timer.GetTicksUntilZero(ticks));
+		}
+	}
+
+	return deadline;
 }
 
-void SP804::tick()
+void SP804::tick(uint32_t tick_periods)
 {
-	if (timers[0].IsEnabled()) timers[0].Tick(ticks);
-	if (timers[1].IsEnabled()) timers[1].Tick(ticks);
+	// Several periods arrive at once when idle time is skipped
+	uint32_t elapsed = std::min<uint64_t>((uint64_t)ticks * tick_periods, UINT32_MAX);
+
+	if (timers[0].IsEnabled()) timers[0].Tick(elapsed);
+	if (timers[1].IsEnabled()) timers[1].Tick(elapsed);
 }
 
 
@@ -162,6 +211,34 @@ bool SP804::InternalTimer::WriteRegister(uint32_t offset, uint32_t data)
 	return false;
 }
 
+void SP804::InternalTimer::SaveState(util::CheckpointWriter& writer) const
+{
+	writer.Write<uint8_t>(enabled);
+	writer.Write(load_value);
+	writer.Write(current_value);
+	writer.Write(internal_prescale);
+	writer.Write(ticker);
+	writer.Write(next_irq);
+	writer.Write<uint32_t>((uint32_t)isr);
+	writer.Write(control_reg.value);
+}
+
+bool SP804::InternalTimer::RestoreState(util::CheckpointReader& reader)
+{
+	uint8_t was_enabled;
+	uint32_t status;
+	if(!reader.Read(was_enabled) || !reader.Read(load_value) || !reader.Read(current_value) || !reader.Read(internal_prescale)) {
+		return false;
+	}
+	if(!reader.Read(ticker) || !reader.Read(next_irq) || !reader.Read(status) || !reader.Read(control_reg.value)) {
+		return false;
+	}
+
+	enabled = was_enabled;
+	isr = status;
+	return true;
+}
+
 /*static void TimerElapsed(archsim::util::timing::TimerCtx timerctx, void *state)
 {
 	auto timer = (SP804::InternalTimer *)state;
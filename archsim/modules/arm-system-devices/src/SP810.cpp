@@ -37,6 +37,21 @@ namespace archsim
 
 			}
 
+			void SP810::SaveState(util::CheckpointWriter& writer)
+			{
+				writer.Write(hr_begin);
+				writer.Write(osc);
+				writer.Write(colour_mode);
+				writer.Write(lockval);
+				writer.Write(leds);
+				writer.Write(flags);
+			}
+
+			bool SP810::RestoreState(util::CheckpointReader& reader)
+			{
+				return reader.Read(hr_begin) && reader.Read(osc) && reader.Read(colour_mode) && reader.Read(lockval) && reader.Read(leds) && reader.Read(flags);
+			}
+
 			bool SP810::Initialise()
 			{
 				return true;
@@ -72,6 +87,7 @@ namespace archsim
 						typedef std::chrono::duration<uint32_t, std::ratio<1, 100> > tick_100Hz_t;
 
 						// default counter tick rate is 1ms
+						parent.GetSystem().GetTickSource()->Synchronise();
 						uint64_t tick_count = parent.GetSystem().GetTickSource()->GetCounter() - hr_begin;
 						std::chrono::milliseconds tick_time (tick_count);
 
@@ -89,6 +105,7 @@ namespace archsim
 						typedef std::chrono::duration<uint32_t, std::ratio<1, 24000000> > tick_24MHz_t;
 
 						// default counter tick rate is 1ms
+						parent.GetSystem().GetTickSource()->Synchronise();
 						uint64_t tick_count = parent.GetSystem().GetTickSource()->GetCounter() - hr_begin;
 						std::chrono::milliseconds tick_time (tick_count);
 
@@ -94,6 +94,26 @@ void VersatileSIC<nr_lines>::WriteRegister(MemoryRegister& reg, uint32_t value)
 }
 
 
+template<int nr_lines>
+void VersatileSIC<nr_lines>::SaveState(util::CheckpointWriter& writer)
+{
+	RegisterBackedMemoryComponent::SaveState(writer);
+	writer.Write(lines);
+	SaveLineState(writer);
+}
+
+template<int nr_lines>
+bool VersatileSIC<nr_lines>::RestoreState(util::CheckpointReader& reader)
+{
+	return RegisterBackedMemoryComponent::RestoreState(reader) && reader.Read(lines) && RestoreLineState(reader);
+}
+
+template<int nr_lines>
+void VersatileSIC<nr_lines>::StateRestored()
+{
+	UpdateParentState();
+}
+
 template<int nr_lines>
 bool VersatileSIC<nr_lines>::AssertLine(uint32_t line)
 {
@@ -45,6 +45,11 @@ ExceptionAction EmulationModel::HandleMemoryFault(archsim::core::thread::ThreadI
 	return ExceptionAction::AbortSimulation;
 }
 
+bool EmulationModel::HandleSegFault(const void *host_addr, const void *host_pc)
+{
+	return false;
+}
+
 EmulationModel::~EmulationModel()
 {
 }
@@ -73,6 +78,18 @@ void EmulationModel::Destroy()
 	delete memory_model;
 }
 
+bool EmulationModel::SaveState(util::Checkpoint& checkpoint)
+{
+	LC_ERROR(LogEmulationModel) << "This emulation model does not support checkpoints";
+	return false;
+}
+
+bool EmulationModel::RestoreState(const util::Checkpoint& checkpoint)
+{
+	LC_ERROR(LogEmulationModel) << "This emulation model does not support checkpoints";
+	return false;
+}
+
 bool EmulationModel::CaptureSignal(int signal, uint32_t pc, void *priv)
 {
 	SignalData *data;
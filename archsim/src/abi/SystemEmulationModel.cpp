@@ -9,6 +9,7 @@
 #include "abi/devices/DeviceManager.h"
 #include "abi/devices/Component.h"
 #include "abi/devices/MMU.h"
+#include "abi/devices/generic/timing/TickSource.h"
 #include "abi/memory/MemoryModel.h"
 
 #include "core/execution/ExecutionEngineFactory.h"
@@ -23,6 +24,10 @@
 #include "util/SimOptions.h"
 #include "util/LogContext.h"
 
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <sstream>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -35,7 +40,7 @@ using namespace archsim::core::thread;
 UseLogContext(LogEmulationModel);
 DeclareChildLogContext(LogSystemEmulationModel, LogEmulationModel, "System");
 
-SystemEmulationModel::SystemEmulationModel(bool is64bit) : is_64bit_(is64bit), monitor_(std::make_shared<archsim::core::BaseMemoryMonitor>())
+SystemEmulationModel::SystemEmulationModel(bool is64bit) : is_64bit_(is64bit), monitor_(std::make_shared<archsim::core::ShardedMemoryMonitor>())
 {
 }
 
@@ -99,13 +104,16 @@ bool SystemEmulationModel::InstantiateThreads(int num_threads)
 		// Obtain the MMU
 		devices::MMU *mmu = (devices::MMU*)thread->GetPeripherals().GetDeviceByName("mmu");
 
+		// All of the thread's memory interfaces share one TLB
+		auto tlb = new archsim::SoftwareTLB(GetSystem().GetPubSub(), mmu->GetPageBits());
+
 		for(auto i : thread->GetMemoryInterfaces()) {
 			if(i == &thread->GetFetchMI()) {
 				i->Connect(*new archsim::LegacyFetchMemoryInterface(*smm));
-				i->ConnectTranslationProvider(*new archsim::MMUTranslationProvider(mmu, thread));
+				i->ConnectTranslationProvider(*new archsim::MMUTranslationProvider(mmu, thread, tlb));
 			} else {
 				i->Connect(*new archsim::LegacyMemoryInterface(*smm));
-				i->ConnectTranslationProvider(*new archsim::MMUTranslationProvider(mmu, thread));
+				i->ConnectTranslationProvider(*new archsim::MMUTranslationProvider(mmu, thread, tlb));
 			}
 
 			i->SetMonitor(monitor_);
@@ -198,6 +206,118 @@ bool SystemEmulationModel::PrepareBoot(System &system)
 	return true;
 }
 
+/*
+ * A checkpoint has a section for each thread, and for each of the thread's
+ * peripherals, named after the thread ("thread0", "thread0/mmu", ...), one
+ * for each memory mapped device, named after the address it is installed at
+ * ("device@10140000"), and one for the tick source ("ticks").
+ */
+static std::string ThreadSectionName(int thread_id)
+{
+	return "thread" + std::to_string(thread_id);
+}
+
+static std::string DeviceSectionName(archsim::Address base_address)
+{
+	std::ostringstream str;
+	str << "device@" << std::hex << base_address.Get();
+	return str.str();
+}
+
+bool SystemEmulationModel::SaveState(util::Checkpoint& checkpoint)
+{
+	for(auto thread : threads_) {
+		auto thread_section = ThreadSectionName(thread->GetThreadID());
+		auto writer = checkpoint.AddSection(thread_section);
+		thread->SaveState(writer);
+
+		for(auto &peripheral : thread->GetPeripherals().Peripherals) {
+			auto peripheral_writer = checkpoint.AddSection(thread_section + "/" + peripheral.first);
+			peripheral.second->SaveState(peripheral_writer);
+		}
+	}
+
+	// Devices installed at several addresses are saved at the first
+	std::set<devices::MemoryComponent*> saved;
+	for(auto &device : base_device_manager.GetDevices()) {
+		if(saved.insert(device.second).second) {
+			auto writer = checkpoint.AddSection(DeviceSectionName(device.first));
+			device.second->SaveState(writer);
+		}
+	}
+
+	auto writer = checkpoint.AddSection("ticks");
+	GetSystem().GetTickSource()->SaveState(writer);
+
+	return true;
+}
+
+// Every section must be present and consumed exactly, otherwise the
+// checkpoint came from a different configuration
+static bool RestoreSection(const archsim::util::Checkpoint &checkpoint, const std::string &name, const std::function<bool(archsim::util::CheckpointReader &)> &restore)
+{
+	if(!checkpoint.HasSection(name)) {
+		LC_ERROR(LogSystemEmulationModel) << "Checkpoint has no state for " << name;
+		return false;
+	}
+
+	auto reader = checkpoint.GetSection(name);
+	if(!restore(reader) || !reader.AtEnd()) {
+		LC_ERROR(LogSystemEmulationModel) << "Could not restore the state of " << name;
+		return false;
+	}
+
+	return true;
+}
+
+bool SystemEmulationModel::RestoreState(const util::Checkpoint& checkpoint)
+{
+	using namespace std::placeholders;
+
+	auto tick_source = GetSystem().GetTickSource();
+	if(!RestoreSection(checkpoint, "ticks", std::bind(&devices::timing::TickSource::RestoreState, tick_source, _1))) {
+		return false;
+	}
+
+	for(auto thread : threads_) {
+		auto thread_section = ThreadSectionName(thread->GetThreadID());
+		if(!RestoreSection(checkpoint, thread_section, std::bind(&ThreadInstance::RestoreState, thread, _1))) {
+			return false;
+		}
+
+		for(auto &peripheral : thread->GetPeripherals().Peripherals) {
+			if(!RestoreSection(checkpoint, thread_section + "/" + peripheral.first, std::bind(&devices::Device::RestoreState, peripheral.second, _1))) {
+				return false;
+			}
+		}
+	}
+
+	std::vector<devices::MemoryComponent*> restored;
+	for(auto &device : base_device_manager.GetDevices()) {
+		if(std::find(restored.begin(), restored.end(), device.second) != restored.end()) {
+			continue;
+		}
+
+		if(!RestoreSection(checkpoint, DeviceSectionName(device.first), std::bind(&devices::MemoryComponent::RestoreState, device.second, _1))) {
+			return false;
+		}
+		restored.push_back(device.second);
+	}
+
+	// Now that all of the state is back, devices can raise their interrupts
+	// and the tick source can work out the consumers' deadlines
+	for(auto thread : threads_) {
+		for(auto &peripheral : thread->GetPeripherals().Peripherals) {
+			peripheral.second->StateRestored();
+		}
+	}
+	for(auto device : restored) {
+		device->StateRestored();
+	}
+	tick_source->StateRestored();
+
+	return true;
+}
 
 bool SystemEmulationModel::RegisterMemoryComponent(abi::devices::MemoryComponent& component)
 {
@@ -8,10 +8,13 @@
 #include "util/CommandLine.h"
 #include "util/ComponentManager.h"
 #include "util/LogContext.h"
+#include "util/MemAllocator.h"
 #include "core/MemoryInterface.h"
 #include "core/execution/ExecutionEngineFactory.h"
 
 #include <sys/param.h>
+#include <pthread.h>
+#include <signal.h>
 
 extern char **environ;
 
@@ -23,7 +26,7 @@ using archsim::Address;
 
 UserEmulationModel::UserEmulationModel(const user::arch_descriptor_t &arch, bool is_64bit_binary, const AuxVectorEntries &auxvs) : syscall_handler_(user::SyscallHandlerProvider::Singleton().Get(arch)), is_64bit_(is_64bit_binary), auxvs_(auxvs)
 {
-	monitor_ = std::make_shared<archsim::core::BaseMemoryMonitor>();
+	monitor_ = std::make_shared<archsim::core::ShardedMemoryMonitor>();
 }
 
 UserEmulationModel::~UserEmulationModel() { }
@@ -51,6 +54,13 @@ bool UserEmulationModel::Initialise(System& system, uarch::uArch& uarch)
 	if (!EmulationModel::Initialise(system, uarch))
 		return false;
 
+	if(archsim::options::SystemMemoryModel == "shadow") {
+		shadow_page_table_.reset(new memory::ShadowPageTable(GetMemoryModel(), archsim::options::ShadowPageTableBits));
+		if(!shadow_page_table_->Initialise()) {
+			return false;
+		}
+	}
+
 	auto module = GetSystem().GetModuleManager().GetModule(archsim::options::ProcessorName);
 
 	execution_engine_ = archsim::core::execution::ExecutionEngineFactory::GetSingleton().Get(module, "");
@@ -75,10 +85,12 @@ archsim::core::thread::ThreadInstance* UserEmulationModel::CreateThread(archsim:
 	}
 	auto arch = archentry->Get();
 
-	auto thread = new archsim::core::thread::ThreadInstance(GetSystem().GetPubSub(), *arch, *this);
+	// Threads need distinct IDs, since the exclusive monitor keeps its
+	// per-thread state by ID
+	auto thread = new archsim::core::thread::ThreadInstance(GetSystem().GetPubSub(), *arch, *this, threads_.size());
 	int idx = 0;
 	for(auto i : thread->GetMemoryInterfaces()) {
-		i->Connect(*new archsim::CachedLegacyMemoryInterface(idx, GetMemoryModel(), thread));
+		i->Connect(*new archsim::CachedLegacyMemoryInterface(idx, GetMemoryModel(), thread, shadow_page_table_.get()));
 		i->ConnectTranslationProvider(*new archsim::IdentityTranslationProvider());
 		i->SetMonitor(monitor_);
 		idx++;
@@ -93,6 +105,43 @@ archsim::core::thread::ThreadInstance* UserEmulationModel::CreateThread(archsim:
 	return thread;
 }
 
+bool UserEmulationModel::HandleSegFault(const void *host_addr, const void *host_pc)
+{
+	// Accesses through the shadow page table go straight to host memory, so
+	// guest accesses to unmapped or protected pages show up as host faults.
+	if(shadow_page_table_ == nullptr) {
+		return false;
+	}
+
+	// Only JIT code accesses guest memory inline. A fault anywhere else is a
+	// simulator bug, even if the address happens to be in guest memory.
+	if(host_pc == nullptr || !wulib::SimpleZoneMemAllocator::IsZoneMemory(host_pc)) {
+		return false;
+	}
+
+	auto thread = archsim::core::thread::ThreadInstance::GetCurrentThread();
+	if(thread == nullptr) {
+		return false;
+	}
+
+	Address guest_addr;
+	if(!GetMemoryModel().ResolveGuestAddress(host_addr, guest_addr)) {
+		return false;
+	}
+
+	LC_DEBUG1(LogEmulationModelUser) << "Host fault at " << host_addr << " is a guest fault at " << guest_addr;
+
+	// The memory exception leaves the signal handler by jumping back to the
+	// thread's safepoint, so make sure further faults can still be delivered.
+	sigset_t segv;
+	sigemptyset(&segv);
+	sigaddset(&segv, SIGSEGV);
+	pthread_sigmask(SIG_UNBLOCK, &segv, nullptr);
+
+	thread->TakeMemoryException(*thread->GetMemoryInterfaces().front(), guest_addr);
+	return true;
+}
+
 void UserEmulationModel::StartThread(archsim::core::thread::ThreadInstance* thread)
 {
 	execution_engine_->AttachThread(thread);
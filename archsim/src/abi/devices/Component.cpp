@@ -174,6 +174,21 @@ namespace archsim
 
 Component::~Component() {}
 
+void Component::SaveState(util::CheckpointWriter& writer)
+{
+
+}
+
+bool Component::RestoreState(util::CheckpointReader& reader)
+{
+	return true;
+}
+
+void Component::StateRestored()
+{
+
+}
+
 // TODO: do this more nicely
 #define CASTTOCOMPONENT(x) static_cast<Component*>(x)
 template<> void Component::SetParameter(const std::string &parameter, archsim::abi::devices::IRQLine *value)
@@ -256,6 +271,38 @@ bool RegisterBackedMemoryComponent::Write(uint32_t offset, uint8_t size, uint64_
 	return true;
 }
 
+void RegisterBackedMemoryComponent::SaveState(util::CheckpointWriter& writer)
+{
+	writer.Write<uint32_t>(registers.size());
+	for(const auto &reg : registers) {
+		writer.Write(reg.first);
+		writer.Write(reg.second->Get());
+	}
+}
+
+bool RegisterBackedMemoryComponent::RestoreState(util::CheckpointReader& reader)
+{
+	uint32_t count;
+	if(!reader.Read(count) || count != registers.size()) {
+		return false;
+	}
+
+	for(uint32_t i = 0; i < count; ++i) {
+		uint32_t offset, value;
+		if(!reader.Read(offset) || !reader.Read(value)) {
+			return false;
+		}
+
+		MemoryRegister *reg = GetRegister(offset);
+		if(reg == nullptr) {
+			return false;
+		}
+		reg->Set(value);
+	}
+
+	return true;
+}
+
 void RegisterBackedMemoryComponent::AddRegister(MemoryRegister& rg)
 {
 	assert(rg.GetOffset() < GetSize());
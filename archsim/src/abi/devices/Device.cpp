@@ -29,6 +29,21 @@ namespace archsim
 			{
 			}
 
+			void Device::SaveState(util::CheckpointWriter& writer)
+			{
+
+			}
+
+			bool Device::RestoreState(util::CheckpointReader& reader)
+			{
+				return true;
+			}
+
+			void Device::StateRestored()
+			{
+
+			}
+
 			bool Device::Read8(uint32_t address, uint8_t& value)
 			{
 				return false;
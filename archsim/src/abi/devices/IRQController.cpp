@@ -151,6 +151,32 @@ namespace archsim
 				return _lines.size();
 			}
 
+			void IRQController::SaveLineState(util::CheckpointWriter& writer) const
+			{
+				writer.Write<uint32_t>(_lines.size());
+				for(auto line : _lines) {
+					writer.Write<uint8_t>(line->IsAsserted());
+				}
+			}
+
+			bool IRQController::RestoreLineState(util::CheckpointReader& reader)
+			{
+				uint32_t count;
+				if(!reader.Read(count) || count != _lines.size()) {
+					return false;
+				}
+
+				for(auto line : _lines) {
+					uint8_t asserted;
+					if(!reader.Read(asserted)) {
+						return false;
+					}
+					line->RestoreLevel(asserted);
+				}
+
+				return true;
+			}
+
 
 
 		}
@@ -40,6 +40,16 @@ void MMU::Evict(Address virt_addr)
 
 }
 
+uint32_t MMU::GetASID()
+{
+	return 0;
+}
+
+uint32_t MMU::GetPageBits() const
+{
+	return 12;
+}
+
 void MMU::set_enabled(bool enabled)
 {
 	if (enabled != should_be_enabled) {
@@ -52,6 +62,27 @@ void MMU::set_enabled(bool enabled)
 	}
 }
 
+void MMU::SaveState(util::CheckpointWriter& writer)
+{
+	writer.Write<uint8_t>(should_be_enabled);
+}
+
+bool MMU::RestoreState(util::CheckpointReader& reader)
+{
+	uint8_t enabled;
+	if (!reader.Read(enabled)) {
+		return false;
+	}
+
+	set_enabled(enabled);
+	return true;
+}
+
+void MMU::StateRestored()
+{
+	FlushCaches();
+}
+
 Address MMU::TranslateUnsafe(archsim::core::thread::ThreadInstance* cpu, Address virt_addr)
 {
 	Address phys_addr;
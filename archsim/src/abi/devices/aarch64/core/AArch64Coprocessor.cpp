@@ -16,6 +16,16 @@ bool AArch64Coprocessor::Initialise()
 	return true;
 }
 
+void AArch64Coprocessor::SaveState(util::CheckpointWriter& writer)
+{
+	writer.Write(tpidr_el0_);
+}
+
+bool AArch64Coprocessor::RestoreState(util::CheckpointReader& reader)
+{
+	return reader.Read(tpidr_el0_);
+}
+
 struct decoded_msr {
 	uint8_t op0, op1, op2, crn, crm;
 };
@@ -274,6 +274,12 @@ public:
 		// TODO
 	}
 
+	uint32_t GetPageBits() const override
+	{
+		// Tiny pages, and the subpages of small pages, are 1KB
+		return 10;
+	}
+
 	void handle_result(TranslateResult result, archsim::core::thread::ThreadInstance *cpu, Address mva, const struct AccessInfo info)
 	{
 		uint32_t new_fsr = 0;
@@ -301,6 +301,11 @@ namespace archsim
 					return true;
 				}
 
+				uint32_t GetASID() override
+				{
+					return cocoprocessor->get_contextidr() & 0xff;
+				}
+
 				const PageInfo GetInfo(Address virt_addr) override
 				{
 					LC_DEBUG1(LogArmMMUInfov6) << "Getting info for MVA " << std::hex << virt_addr;
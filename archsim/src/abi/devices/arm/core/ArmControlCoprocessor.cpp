@@ -37,6 +37,35 @@ ArmControlCoprocessor::ArmControlCoprocessor() :
 
 }
 
+void ArmControlCoprocessor::SaveState(util::CheckpointWriter& writer)
+{
+	uint8_t cp1[] = { cp1_M, cp1_S, cp1_R };
+	uint32_t regs[] = { CACHE_SIZE_SELECTION, ttbr, dacr, fsr, far, ifsr, ifar, dfsr, dfar };
+
+	writer.Write(cp1);
+	writer.Write(regs);
+}
+
+bool ArmControlCoprocessor::RestoreState(util::CheckpointReader& reader)
+{
+	uint8_t cp1[3];
+	uint32_t regs[9];
+	if(!reader.Read(cp1) || !reader.Read(regs)) {
+		return false;
+	}
+
+	cp1_M = cp1[0];
+	cp1_S = cp1[1];
+	cp1_R = cp1[2];
+
+	uint32_t *reg = regs;
+	for(uint32_t *field : { &CACHE_SIZE_SELECTION, &ttbr, &dacr, &fsr, &far, &ifsr, &ifar, &dfsr, &dfar }) {
+		*field = *reg++;
+	}
+
+	return true;
+}
+
 bool ArmControlCoprocessor::access_cp0(bool is_read, uint32_t &data)
 {
 	if (!is_read && rn != 0 && rm != 0 && opc1 != 2 && opc2 != 0) {
@@ -298,9 +327,14 @@ bool ArmControlCoprocessor::access_cp3(bool is_read, uint32_t &data)
 		data = dacr;
 	} else {
 		LC_DEBUG1(LogArmCoprocessorDomain) << "Write of domain access control register";
+
+		// Cached translations depend on the domain permissions
+		if(dacr != data) {
+			Manager->GetEmulationModel()->GetSystem().GetPubSub().Publish(PubSubType::ITlbFullFlush, 0);
+			Manager->GetEmulationModel()->GetSystem().GetPubSub().Publish(PubSubType::DTlbFullFlush, 0);
+		}
+
 		dacr = data;
-		//		get_mmu()->FlushCaches();
-		//		Manager->cpu.memory_model->FlushCaches();
 	}
 	return true;
 }
@@ -360,7 +394,8 @@ bool ArmControlCoprocessor::access_cp7(bool is_read, uint32_t &data)
 	switch (rm) {
 		case 0:
 			if (opc2 == 4) {		//Wait for interrupt
-				LC_DEBUG1(LogArmCoprocessor) << "Attempted WFI via MCR";
+				LC_DEBUG1(LogArmCoprocessor) << "WFI via MCR";
+				Manager->cpu.WaitForInterrupt();
 			} else {
 				LC_WARNING(LogArmCoprocessor) << "Unknown c0 operation";
 				return false;
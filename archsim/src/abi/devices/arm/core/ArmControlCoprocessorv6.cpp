@@ -33,6 +33,45 @@ ArmControlCoprocessorv6::ArmControlCoprocessorv6() : cp1_M(false), cp1_S(false),
 	sctl_word = 0x00c50078;
 }
 
+void ArmControlCoprocessorv6::SaveState(util::CheckpointWriter& writer)
+{
+	uint8_t flags[] = { cp1_M, cp1_S, cp1_R, TRE, AFE };
+	uint32_t regs[] = {
+		CACHE_SIZE_SELECTION, PRIMARY_REGION_REMAP, NORMAL_REGION_REMAP,
+		ttbr0, ttbr1, ttbcr, dacr, tpidrurw, tpidruro, tpidrprw, contextidr,
+		fsr, far, ifsr, ifar, dfsr, dfar, cpacr, actlr, sctl_word
+	};
+
+	writer.Write(flags);
+	writer.Write(regs);
+}
+
+bool ArmControlCoprocessorv6::RestoreState(util::CheckpointReader& reader)
+{
+	uint8_t flags[5];
+	uint32_t regs[20];
+	if(!reader.Read(flags) || !reader.Read(regs)) {
+		return false;
+	}
+
+	cp1_M = flags[0];
+	cp1_S = flags[1];
+	cp1_R = flags[2];
+	TRE = flags[3];
+	AFE = flags[4];
+
+	uint32_t *reg = regs;
+	for(uint32_t *field : {
+	            &CACHE_SIZE_SELECTION, &PRIMARY_REGION_REMAP, &NORMAL_REGION_REMAP,
+	            &ttbr0, &ttbr1, &ttbcr, &dacr, &tpidrurw, &tpidruro, &tpidrprw, &contextidr,
+	            &fsr, &far, &ifsr, &ifar, &dfsr, &dfar, &cpacr, &actlr, &sctl_word
+	        }) {
+		*field = *reg++;
+	}
+
+	return true;
+}
+
 bool ArmControlCoprocessorv6::access_cp0(bool is_read, uint32_t &data)
 {
 	//	fprintf(stderr, "access c0: rm: %x opc1: %x opc2: %x read?: %d\n", rm, opc1, opc2, is_read);
@@ -17,3 +17,31 @@ BlockDevice::~BlockDevice()
 {
 
 }
+
+void BlockDevice::SubmitRequests(BlockRequest* requests, size_t count)
+{
+	for(size_t i = 0; i < count; ++i) {
+		BlockRequest &request = requests[i];
+		uint64_t block_idx = request.block_idx;
+
+		request.success = true;
+		for(const auto &buffer : request.buffers) {
+			uint32_t blocks = buffer.iov_len / GetBlockSize();
+
+			bool ok;
+			if(request.is_write) {
+				ok = WriteBlocks(block_idx, blocks, (const uint8_t *)buffer.iov_base);
+			} else {
+				ok = ReadBlocks(block_idx, blocks, (uint8_t *)buffer.iov_base);
+			}
+
+			if(!ok) {
+				LC_DEBUG1(LogBlockDevice) << "Request failed at block " << block_idx;
+				request.success = false;
+				break;
+			}
+
+			block_idx += blocks;
+		}
+	}
+}
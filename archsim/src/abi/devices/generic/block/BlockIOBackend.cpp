@@ -0,0 +1,359 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "abi/devices/generic/block/BlockIOBackend.h"
+#include "util/LogContext.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef CONFIG_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+UseLogContext(LogBlockDevice);
+DeclareChildLogContext(LogBlockIO, LogBlockDevice, "IO");
+
+using namespace archsim::abi::devices::generic::block;
+
+BlockIOBackend::~BlockIOBackend()
+{
+
+}
+
+BlockIOBackend *BlockIOBackend::Create()
+{
+#ifdef CONFIG_IO_URING
+	UringBlockIOBackend *uring = new UringBlockIOBackend();
+	if(uring->Initialise()) {
+		return uring;
+	}
+
+	LC_DEBUG1(LogBlockIO) << "io_uring is not available, falling back to a thread pool";
+	delete uring;
+#endif
+
+	return new ThreadPoolBlockIOBackend();
+}
+
+bool BlockIOBackend::PerformSync(int fd, uint64_t block_size, const BlockRequest& request, uint64_t done)
+{
+	std::vector<struct iovec> iov (request.buffers);
+	off_t offset = request.block_idx * block_size;
+	size_t first = 0;
+
+	while(done < request.size) {
+		// Skip over whatever has already been transferred
+		uint64_t skip = done;
+		for(first = 0; skip >= request.buffers[first].iov_len; ++first) {
+			skip -= request.buffers[first].iov_len;
+		}
+		iov[first].iov_base = (uint8_t *)request.buffers[first].iov_base + skip;
+		iov[first].iov_len = request.buffers[first].iov_len - skip;
+
+		int iovcnt = std::min<size_t>(iov.size() - first, IOV_MAX);
+
+		ssize_t result;
+		if(request.is_write) {
+			result = pwritev(fd, &iov[first], iovcnt, offset + done);
+		} else {
+			result = preadv(fd, &iov[first], iovcnt, offset + done);
+		}
+
+		if(result < 0) {
+			if(errno == EINTR) continue;
+
+			LC_WARNING(LogBlockIO) << "Block " << (request.is_write ? "write" : "read") << " failed: " << strerror(errno);
+			return false;
+		}
+
+		if(result == 0) {
+			if(request.is_write) {
+				return false;
+			}
+
+			// The final block of the device may run past the end of the
+			// file, in which case the rest of it reads as zero.
+			for(size_t i = first; i < iov.size(); ++i) {
+				bzero(iov[i].iov_base, iov[i].iov_len);
+			}
+			return true;
+		}
+
+		done += result;
+	}
+
+	return true;
+}
+
+ThreadPoolBlockIOBackend::ThreadPoolBlockIOBackend(unsigned int nr_threads) : outstanding_(0), fd_(-1), block_size_(0), terminate_(false)
+{
+	for(unsigned int i = 0; i < nr_threads; ++i) {
+		workers_.emplace_back(&ThreadPoolBlockIOBackend::WorkerProc, this);
+		pthread_setname_np(workers_.back().native_handle(), "block-io");
+	}
+}
+
+ThreadPoolBlockIOBackend::~ThreadPoolBlockIOBackend()
+{
+	{
+		std::lock_guard<std::mutex> l(lock_);
+		terminate_ = true;
+	}
+	work_available_.notify_all();
+
+	for(auto &worker : workers_) {
+		worker.join();
+	}
+}
+
+void ThreadPoolBlockIOBackend::Submit(int fd, uint64_t block_size, BlockRequest* requests, size_t count)
+{
+	std::lock_guard<std::mutex> submit(submit_lock_);
+	std::unique_lock<std::mutex> l(lock_);
+
+	fd_ = fd;
+	block_size_ = block_size;
+	outstanding_ = count;
+
+	for(size_t i = 0; i < count; ++i) {
+		pending_.push_back(&requests[i]);
+	}
+	work_available_.notify_all();
+
+	work_complete_.wait(l, [this] { return outstanding_ == 0; });
+}
+
+void ThreadPoolBlockIOBackend::WorkerProc()
+{
+	std::unique_lock<std::mutex> l(lock_);
+
+	while(true) {
+		work_available_.wait(l, [this] { return terminate_ || !pending_.empty(); });
+		if(terminate_) {
+			return;
+		}
+
+		BlockRequest *request = pending_.front();
+		pending_.pop_front();
+
+		int fd = fd_;
+		uint64_t block_size = block_size_;
+
+		l.unlock();
+		request->success = PerformSync(fd, block_size, *request);
+		l.lock();
+
+		if(--outstanding_ == 0) {
+			work_complete_.notify_one();
+		}
+	}
+}
+
+#ifdef CONFIG_IO_URING
+
+UringBlockIOBackend::UringBlockIOBackend() : ring_fd_(-1), sq_ring_(MAP_FAILED), sq_ring_size_(0), cq_ring_(MAP_FAILED), cq_ring_size_(0), sqes_((struct io_uring_sqe *)MAP_FAILED), sqes_size_(0), sq_entries_(0)
+{
+
+}
+
+UringBlockIOBackend::~UringBlockIOBackend()
+{
+	if(sqes_ != MAP_FAILED) {
+		munmap(sqes_, sqes_size_);
+	}
+	if(cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+		munmap(cq_ring_, cq_ring_size_);
+	}
+	if(sq_ring_ != MAP_FAILED) {
+		munmap(sq_ring_, sq_ring_size_);
+	}
+	if(ring_fd_ >= 0) {
+		close(ring_fd_);
+	}
+}
+
+bool UringBlockIOBackend::Initialise(unsigned int entries)
+{
+	struct io_uring_params params;
+	bzero(&params, sizeof(params));
+
+	ring_fd_ = syscall(__NR_io_uring_setup, entries, &params);
+	if(ring_fd_ < 0) {
+		LC_DEBUG1(LogBlockIO) << "io_uring_setup failed: " << strerror(errno);
+		return false;
+	}
+
+	sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+	// Newer kernels let both rings share one mapping
+	if(params.features & IORING_FEAT_SINGLE_MMAP) {
+		sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+	}
+
+	sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+	if(sq_ring_ == MAP_FAILED) {
+		LC_DEBUG1(LogBlockIO) << "Failed to map io_uring submission ring";
+		return false;
+	}
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP) {
+		cq_ring_ = sq_ring_;
+	} else {
+		cq_ring_ = mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+		if(cq_ring_ == MAP_FAILED) {
+			LC_DEBUG1(LogBlockIO) << "Failed to map io_uring completion ring";
+			return false;
+		}
+	}
+
+	sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+	sqes_ = (struct io_uring_sqe *)mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+	if(sqes_ == MAP_FAILED) {
+		LC_DEBUG1(LogBlockIO) << "Failed to map io_uring submission entries";
+		return false;
+	}
+
+	sq_head_ = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.head);
+	sq_tail_ = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.tail);
+	sq_mask_ = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.ring_mask);
+	sq_array_ = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.array);
+	cq_head_ = (unsigned *)((uint8_t *)cq_ring_ + params.cq_off.head);
+	cq_tail_ = (unsigned *)((uint8_t *)cq_ring_ + params.cq_off.tail);
+	cq_mask_ = (unsigned *)((uint8_t *)cq_ring_ + params.cq_off.ring_mask);
+	cqes_ = (struct io_uring_cqe *)((uint8_t *)cq_ring_ + params.cq_off.cqes);
+	sq_entries_ = params.sq_entries;
+
+	LC_DEBUG1(LogBlockIO) << "Created io_uring with " << sq_entries_ << " entries";
+	return true;
+}
+
+unsigned UringBlockIOBackend::ReapCompletions(int fd, uint64_t block_size, BlockRequest *requests, std::vector<bool> &completed)
+{
+	unsigned reaped = 0;
+
+	unsigned head = *cq_head_;
+	while(head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+		BlockRequest &request = requests[cqe->user_data];
+
+		if(cqe->res < 0) {
+			LC_WARNING(LogBlockIO) << "Block " << (request.is_write ? "write" : "read") << " failed: " << strerror(-cqe->res);
+			request.success = false;
+		} else if((uint64_t)cqe->res < request.size) {
+			// Short transfers (including past the end of the file) are
+			// finished off synchronously
+			request.success = PerformSync(fd, block_size, request, cqe->res);
+		} else {
+			request.success = true;
+		}
+		completed[cqe->user_data] = true;
+
+		head++;
+		reaped++;
+	}
+	__atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+	return reaped;
+}
+
+void UringBlockIOBackend::Submit(int fd, uint64_t block_size, BlockRequest* requests, size_t count)
+{
+	if(fallback_) {
+		fallback_->Submit(fd, block_size, requests, count);
+		return;
+	}
+
+	std::vector<bool> completed (count, false);
+	size_t next = 0;
+
+	while(next < count) {
+		// Fill as much of the submission ring as we can with this batch
+		unsigned batch_start = *sq_tail_;
+		unsigned tail = batch_start;
+		unsigned submitted = 0;
+
+		while(next + submitted < count && submitted < sq_entries_) {
+			BlockRequest &request = requests[next + submitted];
+
+			unsigned index = tail & *sq_mask_;
+			struct io_uring_sqe *sqe = &sqes_[index];
+			bzero(sqe, sizeof(*sqe));
+
+			sqe->opcode = request.is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+			sqe->fd = fd;
+			sqe->off = request.block_idx * block_size;
+			sqe->addr = (uint64_t)request.buffers.data();
+			sqe->len = std::min<size_t>(request.buffers.size(), IOV_MAX);
+			sqe->user_data = next + submitted;
+
+			sq_array_[index] = index;
+			tail++;
+			submitted++;
+		}
+
+		__atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+		// Wait for the whole batch to complete
+		unsigned reaped = 0;
+		unsigned to_submit = submitted;
+		while(reaped < submitted) {
+			int result = syscall(__NR_io_uring_enter, ring_fd_, to_submit, submitted - reaped, IORING_ENTER_GETEVENTS, NULL, 0);
+			if(result < 0) {
+				if(errno == EINTR) continue;
+
+				LC_WARNING(LogBlockIO) << "io_uring_enter failed: " << strerror(errno);
+				Abandon(fd, block_size, requests, count, completed, batch_start, reaped);
+				return;
+			}
+			to_submit -= std::min<unsigned>(to_submit, result);
+
+			reaped += ReapCompletions(fd, block_size, requests, completed);
+		}
+
+		next += submitted;
+	}
+}
+
+void UringBlockIOBackend::Abandon(int fd, uint64_t block_size, BlockRequest *requests, size_t count, std::vector<bool> &completed, unsigned batch_start, unsigned reaped)
+{
+	// Whatever the kernel has already taken from the submission ring may
+	// still be writing to (or reading from) the guest's buffers, so wait for
+	// all of it to complete before anything is handed back. The rest of the
+	// ring is never submitted, since the ring isn't entered again.
+	unsigned consumed = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) - batch_start;
+	while(reaped < consumed) {
+		unsigned more = ReapCompletions(fd, block_size, requests, completed);
+		if(more == 0) {
+			usleep(100);
+		}
+		reaped += more;
+	}
+
+	// Switch to a thread pool for good, and finish off everything which
+	// didn't complete through the ring
+	LC_WARNING(LogBlockIO) << "Falling back to a thread pool for block I/O";
+	fallback_.reset(new ThreadPoolBlockIOBackend());
+
+	std::vector<BlockRequest> remaining;
+	std::vector<size_t> indices;
+	for(size_t i = 0; i < count; ++i) {
+		if(!completed[i]) {
+			remaining.push_back(requests[i]);
+			indices.push_back(i);
+		}
+	}
+
+	fallback_->Submit(fd, block_size, remaining.data(), remaining.size());
+	for(size_t i = 0; i < indices.size(); ++i) {
+		requests[indices[i]].success = remaining[i].success;
+	}
+}
+
+#endif
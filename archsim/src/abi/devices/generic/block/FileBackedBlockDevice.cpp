@@ -62,6 +62,9 @@ bool FileBackedBlockDevice::Open(std::string filename, bool read_only)
 	} else {
 		file_data = NULL;
 		file_descr = fd;
+
+		io_backend.reset(BlockIOBackend::Create());
+		LC_DEBUG1(LogBlockDevice) << "Using " << io_backend->GetName() << " backend for batched requests";
 	}
 
 	block_count = file_size / GetBlockSize();
@@ -86,6 +89,7 @@ void FileBackedBlockDevice::Close()
 		munmap(file_data, file_size);
 		file_data = NULL;
 	} else {
+		io_backend.reset();
 		close(file_descr);
 	}
 }
@@ -218,3 +222,69 @@ bool FileBackedBlockDevice::WriteBlocks(uint64_t block_idx, uint32_t count, cons
 
 	return true;
 }
+
+void FileBackedBlockDevice::SubmitRequests(BlockRequest* requests, size_t count)
+{
+	if (use_mmap) {
+		BlockDevice::SubmitRequests(requests, count);
+		return;
+	}
+
+	// Reject anything which can't be performed before handing the rest of the
+	// batch to the backend.
+	std::vector<BlockRequest *> valid;
+	valid.reserve(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		BlockRequest &request = requests[i];
+		uint64_t blocks = request.size / GetBlockSize();
+
+		if (request.block_idx >= block_count || blocks > block_count - request.block_idx) {
+			LC_WARNING(LogBlockDevice) << "Attempted to " << (request.is_write ? "write" : "read") << " blocks past end of device";
+			request.success = false;
+		} else if (request.is_write && read_only) {
+			LC_WARNING(LogBlockDevice) << "Attempted to write to a read-only device";
+			request.success = false;
+		} else {
+			valid.push_back(&request);
+		}
+	}
+
+	if (valid.size() == count) {
+		io_backend->Submit(file_descr, GetBlockSize(), requests, count);
+	} else {
+		std::vector<BlockRequest> batch;
+		batch.reserve(valid.size());
+		for (auto request : valid) {
+			batch.push_back(std::move(*request));
+		}
+
+		io_backend->Submit(file_descr, GetBlockSize(), batch.data(), batch.size());
+
+		for (size_t i = 0; i < batch.size(); ++i) {
+			*valid[i] = std::move(batch[i]);
+		}
+	}
+
+	// Keep the read cache coherent with the file
+	for (auto request : valid) {
+		uint64_t blocks = request->size / GetBlockSize();
+
+		if (!request->is_write) {
+			reads.inc(blocks);
+			continue;
+		}
+
+		writes.inc(blocks);
+		if (!request->success) {
+			continue;
+		}
+
+		uint64_t block_idx = request->block_idx;
+		for (const auto &buffer : request->buffers) {
+			for (size_t offset = 0; offset < buffer.iov_len; offset += GetBlockSize()) {
+				cache->WriteBlock(block_idx++, (const uint8_t *)buffer.iov_base + offset);
+			}
+		}
+	}
+}
@@ -12,10 +12,13 @@
 #include "util/SimOptions.h"
 
 #include <unistd.h>
+#include <algorithm>
 #include <chrono>
 
 using namespace archsim::abi::devices::timing;
 
+const uint64_t TickConsumer::kNoDeadline;
+
 TickConsumer::~TickConsumer() {}
 
 TickSource::TickSource() : tick_count_(0), microticks_(0), microtick_scale_(1.0f/archsim::options::TickScale), running_(false) {}
@@ -63,6 +66,54 @@ void TickSource::Tick(uint32_t tick_periods)
 	microticks_ -= (int)microticks_;
 }
 
+void TickSource::DeliverTicks(uint32_t ticks)
+{
+	tick_count_ += ticks;
+
+	std::lock_guard<std::mutex>  lock(consumers_lock_);
+	if(running_) {
+		for(auto *consumer : consumers) {
+			consumer->Tick(ticks);
+		}
+	}
+}
+
+bool TickSource::SkipToNextDeadline()
+{
+	std::lock_guard<std::mutex>  lock(consumers_lock_);
+	if(!running_) {
+		return false;
+	}
+
+	uint64_t ticks = TickConsumer::kNoDeadline;
+	for(auto *consumer : consumers) {
+		ticks = std::min(ticks, consumer->GetTicksUntilDeadline());
+	}
+
+	if(ticks == TickConsumer::kNoDeadline) {
+		return false;
+	}
+
+	ticks = std::max<uint64_t>(std::min<uint64_t>(ticks, UINT32_MAX), 1);
+	tick_count_ += ticks;
+	for(auto *consumer : consumers) {
+		consumer->Tick(ticks);
+	}
+
+	return true;
+}
+
+void TickSource::SaveState(util::CheckpointWriter& writer)
+{
+	writer.Write(tick_count_);
+	writer.Write(microticks_);
+}
+
+bool TickSource::RestoreState(util::CheckpointReader& reader)
+{
+	return reader.Read(tick_count_) && reader.Read(microticks_);
+}
+
 MicrosecondTickSource::MicrosecondTickSource(uint32_t tick) : LoopThread("Microsecond Source"), ticks(tick), recalibrate(0), total_overshoot(0), overshoot_samples(0), calibrated_ticks(0)
 {
 	start();
@@ -73,6 +124,11 @@ MicrosecondTickSource::~MicrosecondTickSource()
 	stop();
 }
 
+bool MicrosecondTickSource::SkipToNextDeadline()
+{
+	return false;
+}
+
 void MicrosecondTickSource::tick()
 {
 	Tick(1);
@@ -142,3 +198,146 @@ void SubscriberTickSource::DoTick()
 {
 	Tick(1);
 }
+
+InstructionCountTickSource::InstructionCountTickSource(uint32_t instructions_per_tick) : instructions_per_tick_(std::max<uint32_t>(instructions_per_tick, 1)), instructions_(0), next_deadline_(TimerWheel::kNever)
+{
+
+}
+
+InstructionCountTickSource::~InstructionCountTickSource()
+{
+
+}
+
+void InstructionCountTickSource::AddConsumer(TickConsumer& consumer)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	TickSource::AddConsumer(consumer);
+
+	auto &deadline = deadlines_[&consumer];
+	deadline.reset(new Deadline());
+	deadline->consumer = &consumer;
+	Arm(*deadline);
+
+	next_deadline_ = wheel_.GetNextDeadline();
+}
+
+void InstructionCountTickSource::RemoveConsumer(TickConsumer& consumer)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	TickSource::RemoveConsumer(consumer);
+
+	auto deadline = deadlines_.find(&consumer);
+	if(deadline != deadlines_.end()) {
+		wheel_.Cancel(*deadline->second);
+		deadlines_.erase(deadline);
+	}
+
+	next_deadline_ = wheel_.GetNextDeadline();
+}
+
+void InstructionCountTickSource::Arm(Deadline& deadline)
+{
+	uint64_t ticks = deadline.consumer->GetTicksUntilDeadline();
+	if(ticks == TickConsumer::kNoDeadline) {
+		wheel_.Cancel(deadline);
+	} else {
+		// A deadline is always at least one tick away, so that a consumer
+		// which has not dealt with its deadline yet cannot stop time
+		wheel_.Schedule(deadline, (GetCounter() + std::max<uint64_t>(ticks, 1)) * instructions_per_tick_);
+	}
+}
+
+void InstructionCountTickSource::Synchronise()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	SynchroniseLocked();
+}
+
+void InstructionCountTickSource::SynchroniseLocked()
+{
+	uint64_t now = instructions_.load(std::memory_order_relaxed);
+
+	// Bring every consumer up to date, so that the ones whose deadlines have
+	// passed raise their interrupts, and then work out their next deadlines.
+	// Deadlines are absolute, so the others stay where they are.
+	uint64_t ticks = now / instructions_per_tick_ - GetCounter();
+	while(ticks > 0) {
+		uint32_t batch = std::min<uint64_t>(ticks, UINT32_MAX);
+		DeliverTicks(batch);
+		ticks -= batch;
+	}
+
+	wheel_.Advance(now, [this](TimerWheel::Event &event) {
+		Arm(static_cast<Deadline &>(event));
+	});
+
+	next_deadline_ = wheel_.GetNextDeadline();
+}
+
+void InstructionCountTickSource::Reschedule(TickConsumer& consumer)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+
+	auto deadline = deadlines_.find(&consumer);
+	if(deadline != deadlines_.end()) {
+		Arm(*deadline->second);
+		next_deadline_ = wheel_.GetNextDeadline();
+	}
+}
+
+bool InstructionCountTickSource::SkipToNextDeadline()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+
+	uint64_t next = next_deadline_;
+	if(!IsRunning() || next == TimerWheel::kNever) {
+		return false;
+	}
+
+	// Every thread was idle, but one may have been woken since and be adding
+	// instructions already, so only ever move the count forwards
+	uint64_t current = instructions_.load(std::memory_order_relaxed);
+	while(current < next && !instructions_.compare_exchange_weak(current, next, std::memory_order_relaxed));
+	SynchroniseLocked();
+
+	return true;
+}
+
+void InstructionCountTickSource::SaveState(util::CheckpointWriter& writer)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	TickSource::SaveState(writer);
+	writer.Write(instructions_.load());
+}
+
+bool InstructionCountTickSource::RestoreState(util::CheckpointReader& reader)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+
+	uint64_t instructions;
+	if(!TickSource::RestoreState(reader) || !reader.Read(instructions)) {
+		return false;
+	}
+
+	instructions_ = instructions;
+	return true;
+}
+
+void InstructionCountTickSource::StateRestored()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+
+	// The deadlines were armed against the old time, so take them all out,
+	// move the wheel on to the restored time and arm them again from the
+	// consumers' restored state.
+	for(auto &deadline : deadlines_) {
+		wheel_.Cancel(*deadline.second);
+	}
+	wheel_.Advance(instructions_.load(), [](TimerWheel::Event &) { });
+
+	for(auto &deadline : deadlines_) {
+		Arm(*deadline.second);
+	}
+	next_deadline_ = wheel_.GetNextDeadline();
+}
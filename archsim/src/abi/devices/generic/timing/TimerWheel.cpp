@@ -0,0 +1,161 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * TimerWheel.cpp
+ */
+
+#include "abi/devices/generic/timing/TimerWheel.h"
+
+#include <algorithm>
+
+using namespace archsim::abi::devices::timing;
+
+const uint64_t TimerWheel::kNever;
+
+TimerWheel::TimerWheel() : now_(0), overflow_(nullptr)
+{
+	std::fill(occupied_, occupied_ + kLevels, 0);
+	std::fill(&slots_[0][0], &slots_[0][0] + kLevels * kSlots, nullptr);
+}
+
+void TimerWheel::Schedule(Event& event, uint64_t deadline)
+{
+	if(event.IsScheduled()) {
+		Remove(event);
+	}
+
+	event.deadline_ = deadline;
+	Insert(event);
+}
+
+void TimerWheel::Cancel(Event& event)
+{
+	if(event.IsScheduled()) {
+		Remove(event);
+	}
+}
+
+void TimerWheel::Insert(Event& event)
+{
+	// Deadlines in the past are treated as being due now
+	uint64_t deadline = std::max(event.deadline_, now_);
+
+	// The level is given by the highest bit in which the deadline differs
+	// from the current time
+	uint64_t diff = deadline ^ now_;
+	unsigned level = diff == 0 ? 0 : (63 - __builtin_clzll(diff)) / kSlotBits;
+
+	Event **list;
+	if(level < kLevels) {
+		unsigned slot = SlotIndex(deadline, level);
+		list = &slots_[level][slot];
+		occupied_[level] |= 1ull << slot;
+	} else {
+		list = &overflow_;
+	}
+
+	event.list_ = list;
+	event.prev_ = nullptr;
+	event.next_ = *list;
+	if(*list != nullptr) {
+		(*list)->prev_ = &event;
+	}
+	*list = &event;
+}
+
+void TimerWheel::Remove(Event& event)
+{
+	Event **list = event.list_;
+
+	if(event.prev_ != nullptr) {
+		event.prev_->next_ = event.next_;
+	} else {
+		*list = event.next_;
+	}
+	if(event.next_ != nullptr) {
+		event.next_->prev_ = event.prev_;
+	}
+
+	if(*list == nullptr && list != &overflow_) {
+		size_t index = list - &slots_[0][0];
+		occupied_[index / kSlots] &= ~(1ull << (index % kSlots));
+	}
+
+	event.list_ = nullptr;
+	event.next_ = event.prev_ = nullptr;
+}
+
+void TimerWheel::Cascade(Event*& list)
+{
+	Event *event = list;
+	while(event != nullptr) {
+		Event *next = event->next_;
+		Remove(*event);
+		Insert(*event);
+		event = next;
+	}
+}
+
+uint64_t TimerWheel::GetNextDeadline() const
+{
+	// Every event in a level is later than every event in the levels below
+	// it, and the slots behind the current time are always empty
+	for(unsigned level = 0; level < kLevels; ++level) {
+		if(occupied_[level] == 0) {
+			continue;
+		}
+
+		unsigned slot = __builtin_ctzll(occupied_[level]);
+		if(level == 0) {
+			return (now_ & ~(uint64_t)(kSlots - 1)) | slot;
+		}
+
+		uint64_t deadline = kNever;
+		for(Event *event = slots_[level][slot]; event != nullptr; event = event->next_) {
+			deadline = std::min(deadline, event->deadline_);
+		}
+		return deadline;
+	}
+
+	uint64_t deadline = kNever;
+	for(Event *event = overflow_; event != nullptr; event = event->next_) {
+		deadline = std::min(deadline, event->deadline_);
+	}
+	return deadline;
+}
+
+void TimerWheel::SetTime(uint64_t time)
+{
+	// Nothing is scheduled before the new time, so the only events which
+	// can be in the wrong place are those in the slots which the new time
+	// falls in, which may now belong in a lower level
+	uint64_t old = now_;
+	now_ = time;
+
+	if((old >> (kLevels * kSlotBits)) != (time >> (kLevels * kSlotBits))) {
+		Cascade(overflow_);
+	}
+
+	for(unsigned level = kLevels - 1; level > 0; --level) {
+		Cascade(slots_[level][SlotIndex(time, level)]);
+	}
+}
+
+void TimerWheel::Advance(uint64_t time, const expired_fn_t& expired)
+{
+	uint64_t next;
+	while((next = GetNextDeadline()) <= time) {
+		SetTime(std::max(next, now_));
+
+		Event *&list = slots_[0][SlotIndex(now_, 0)];
+		while(list != nullptr) {
+			Event &event = *list;
+			Remove(event);
+			expired(event);
+		}
+	}
+
+	if(time > now_) {
+		SetTime(time);
+	}
+}
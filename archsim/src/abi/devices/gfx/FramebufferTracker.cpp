@@ -0,0 +1,217 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "abi/devices/gfx/FramebufferTracker.h"
+#include "util/LogContext.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+UseLogContext(LogVirtualScreen);
+DeclareChildLogContext(LogFramebufferTracker, LogVirtualScreen, "Tracker");
+
+using namespace archsim::abi::devices::gfx;
+
+const uint32_t FramebufferTracker::kTileSize;
+
+static inline bool BytesDiffer(const uint8_t *a, const uint8_t *b, size_t size)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	__m128i diff = _mm_setzero_si128();
+	for(; i + 16 <= size; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+		diff = _mm_or_si128(diff, _mm_xor_si128(va, vb));
+	}
+
+	if(_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff) {
+		return true;
+	}
+#endif
+
+	return memcmp(a + i, b + i, size - i) != 0;
+}
+
+FramebufferTracker::FramebufferTracker() : data_(nullptr), width_(0), height_(0), bytes_per_pixel_(0), tiles_x_(0), tiles_y_(0), first_update_(false), system_(nullptr), protected_base_(nullptr), protected_pages_(0)
+{
+
+}
+
+FramebufferTracker::~FramebufferTracker()
+{
+	Detach();
+}
+
+void FramebufferTracker::Attach(const uint8_t* data, uint32_t width, uint32_t height, uint32_t bytes_per_pixel)
+{
+	Detach();
+
+	data_ = data;
+	width_ = width;
+	height_ = height;
+	bytes_per_pixel_ = bytes_per_pixel;
+	tiles_x_ = (width + kTileSize - 1) / kTileSize;
+	tiles_y_ = (height + kTileSize - 1) / kTileSize;
+	first_update_ = true;
+
+	shadow_.assign((size_t)width * height * bytes_per_pixel, 0);
+}
+
+bool FramebufferTracker::EnableWriteProtection(System& system)
+{
+	if(data_ == nullptr || shadow_.empty() || dirty_pages_ != nullptr) {
+		return false;
+	}
+
+	uintptr_t page_size = getpagesize();
+	uintptr_t start = (uintptr_t)data_ & ~(page_size - 1);
+	uintptr_t end = ((uintptr_t)data_ + shadow_.size() + page_size - 1) & ~(page_size - 1);
+
+	protected_base_ = (uint8_t *)start;
+	protected_pages_ = (end - start) / page_size;
+	dirty_pages_.reset(new std::atomic<bool>[protected_pages_]);
+	for(uint32_t page = 0; page < protected_pages_; ++page) {
+		dirty_pages_[page].store(false, std::memory_order_relaxed);
+	}
+
+	system.RegisterSegFaultHandler(start, end - start, this, HandleWriteFault);
+	if(mprotect(protected_base_, end - start, PROT_READ)) {
+		LC_WARNING(LogFramebufferTracker) << "Could not write protect the framebuffer, so every frame will be compared";
+		system.UnregisterSegFaultHandler(start);
+		dirty_pages_.reset();
+		return false;
+	}
+
+	system_ = &system;
+	return true;
+}
+
+void FramebufferTracker::Detach()
+{
+	if(dirty_pages_ != nullptr) {
+		ProtectPages(0, protected_pages_, true);
+		system_->UnregisterSegFaultHandler((uint64_t)protected_base_);
+		dirty_pages_.reset();
+	}
+
+	data_ = nullptr;
+	system_ = nullptr;
+	protected_base_ = nullptr;
+	protected_pages_ = 0;
+	shadow_.clear();
+}
+
+void FramebufferTracker::ProtectPages(uint32_t first, uint32_t count, bool writable)
+{
+	size_t page_size = getpagesize();
+	mprotect(protected_base_ + (size_t)first * page_size, (size_t)count * page_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ);
+}
+
+bool FramebufferTracker::HandleWriteFault(void* ctx, const System::segfault_data& data)
+{
+	FramebufferTracker *tracker = (FramebufferTracker *)ctx;
+
+	// Unprotect the page before marking it dirty. Otherwise an update could
+	// clear the bit and protect the page in between, and we would then leave
+	// the page writable but clean, so later writes would be missed.
+	uint32_t page = (data.addr - (uint64_t)tracker->protected_base_) / getpagesize();
+	tracker->ProtectPages(page, 1, true);
+	tracker->dirty_pages_[page].store(true, std::memory_order_release);
+
+	return true;
+}
+
+bool FramebufferTracker::UpdateTile(uint32_t tile_x, uint32_t tile_y)
+{
+	size_t pitch = (size_t)width_ * bytes_per_pixel_;
+	size_t row_bytes = std::min(kTileSize, width_ - tile_x * kTileSize) * bytes_per_pixel_;
+	uint32_t rows = std::min(kTileSize, height_ - tile_y * kTileSize);
+
+	size_t offset = (size_t)tile_y * kTileSize * pitch + (size_t)tile_x * kTileSize * bytes_per_pixel_;
+
+	bool changed = false;
+	for(uint32_t row = 0; row < rows; ++row, offset += pitch) {
+		if(BytesDiffer(shadow_.data() + offset, data_ + offset, row_bytes)) {
+			memcpy(shadow_.data() + offset, data_ + offset, row_bytes);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+uint32_t FramebufferTracker::Update(const changed_fn_t& changed)
+{
+	if(data_ == nullptr) {
+		return 0;
+	}
+
+	// Work out which rows of tiles need to be compared
+	std::vector<bool> dirty_rows (tiles_y_, first_update_ || dirty_pages_ == nullptr);
+	if(dirty_pages_ != nullptr) {
+		int64_t page_size = getpagesize();
+		int64_t pitch = (int64_t)width_ * bytes_per_pixel_;
+		int64_t base_offset = data_ - protected_base_;
+
+		for(uint32_t page = 0; page < protected_pages_; ++page) {
+			// The page is protected after its bit is cleared, so a write which
+			// races with this is either seen by the comparison below, or
+			// faults again and is picked up by the next update
+			if(!dirty_pages_[page].exchange(false, std::memory_order_acquire)) {
+				continue;
+			}
+			ProtectPages(page, 1, false);
+
+			int64_t start = std::max<int64_t>(page * page_size - base_offset, 0);
+			int64_t end = std::min<int64_t>((page + 1) * page_size - base_offset, shadow_.size());
+			if(start >= end) {
+				continue;
+			}
+
+			for(int64_t row = start / pitch / kTileSize; row <= (end - 1) / pitch / kTileSize; ++row) {
+				dirty_rows[row] = true;
+			}
+		}
+	}
+
+	uint32_t changed_tiles = 0;
+	auto report = [this, &changed](uint32_t first_tile, uint32_t tile_count, uint32_t tile_y) {
+		uint32_t x = first_tile * kTileSize;
+		uint32_t y = tile_y * kTileSize;
+		changed(x, y, std::min(tile_count * kTileSize, width_ - x), std::min(kTileSize, height_ - y));
+	};
+
+	for(uint32_t tile_y = 0; tile_y < tiles_y_; ++tile_y) {
+		if(!dirty_rows[tile_y]) {
+			continue;
+		}
+
+		uint32_t run_start = 0, run_length = 0;
+		for(uint32_t tile_x = 0; tile_x < tiles_x_; ++tile_x) {
+			if(UpdateTile(tile_x, tile_y) || first_update_) {
+				if(run_length == 0) {
+					run_start = tile_x;
+				}
+				run_length++;
+				changed_tiles++;
+			} else if(run_length != 0) {
+				report(run_start, run_length, tile_y);
+				run_length = 0;
+			}
+		}
+
+		if(run_length != 0) {
+			report(run_start, run_length, tile_y);
+		}
+	}
+
+	first_update_ = false;
+	return changed_tiles;
+}
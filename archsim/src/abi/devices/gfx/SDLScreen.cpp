@@ -13,9 +13,11 @@
 #include "concurrent/Thread.h"
 #include "util/ComponentManager.h"
 #include "util/LogContext.h"
+#include "util/SimOptions.h"
 
 #include "system.h"
 
+#include <cstring>
 #include <unistd.h>
 #include <SDL2/SDL.h>
 
@@ -110,7 +112,8 @@ SDLScreen::SDLScreen(std::string id, memory::MemoryModel *mem_model, System *sys
 	  kbd(NULL),
 	  mouse(NULL),
 	  hw_accelerated(false),
-	  system(sys)
+	  system(sys),
+	  needs_present(true)
 {
 }
 
@@ -192,6 +195,7 @@ bool SDLScreen::Reset()
 	}
 
 	terminate();
+	tracker.Detach();
 	if(window_texture) {
 		SDL_DestroyTexture(window_texture);
 		window_texture = NULL;
@@ -274,6 +278,10 @@ void SDLScreen::run()
 						mouse->Move(e.motion.x, -e.motion.y);
 					break;
 
+				case SDL_WINDOWEVENT:
+					needs_present = true;
+					break;
+
 				case SDL_QUIT:
 					system->HaltSimulation();
 					break;
@@ -305,23 +313,41 @@ void SDLScreen::terminate()
 
 void SDLScreen::draw_frame()
 {
-	SDL_RenderClear(renderer);
-
+	bool changed;
 	switch (GetMode()) {
 		case VSM_DoomPalette:
-			draw_doom();
+			changed = draw_doom();
 			break;
 		default:
-			draw_rgb();
+			changed = draw_rgb();
 			break;
 	}
 
+	if(!changed && !needs_present) {
+		return;
+	}
+	needs_present = false;
+
+	SDL_RenderClear(renderer);
+
 	bool success = false;
 	success = SDL_RenderCopy(renderer, window_texture, NULL, NULL);
 	assert(!success);
 	SDL_RenderPresent(renderer);
 }
 
+void SDLScreen::track_framebuffer(host_addr_t fb, uint32_t pixel_size)
+{
+	if(tracker.IsAttached() && tracker.GetData() == (const uint8_t *)fb) {
+		return;
+	}
+
+	tracker.Attach((const uint8_t *)fb, GetWidth(), GetHeight(), pixel_size);
+	if(!archsim::options::ScreenNoWriteTracking) {
+		tracker.EnableWriteProtection(*system);
+	}
+}
+
 bool SDLScreen::draw_rgb()
 {
 	host_addr_t addr;
@@ -345,11 +371,17 @@ bool SDLScreen::draw_rgb()
 		return false;
 	}
 
-	bool success = false;
-	success = SDL_UpdateTexture(window_texture, NULL, (void*)addr, pitch);
-	assert(!success);
+	track_framebuffer(addr, pixel_size);
 
-	return true;
+	uint32_t changed = tracker.Update([this, addr, pitch, pixel_size](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+		SDL_Rect rect = { (int)x, (int)y, (int)width, (int)height };
+
+		bool success = false;
+		success = SDL_UpdateTexture(window_texture, &rect, (uint8_t *)addr + (y * pitch) + (x * pixel_size), pitch);
+		assert(!success);
+	});
+
+	return changed != 0;
 }
 
 bool SDLScreen::draw_doom()
@@ -359,27 +391,49 @@ bool SDLScreen::draw_doom()
 	GetMemory()->LockRegion(Address(fb_ptr), GetWidth() * GetHeight(), fb);
 	GetMemory()->LockRegion(Address(p_ptr), GetWidth() * GetHeight(), palette);
 
-	uint8_t *pixels;
-	int pitch;
-
-	if (SDL_LockTexture(window_texture, NULL, (void**)&(pixels), &pitch)) {
-		LC_ERROR(LogSDLScreen) << "Failed to lock pixels! Terminating.";
-		terminate();
-		return false;
+	// A new palette changes every pixel, so start tracking again from scratch
+	const uint8_t *palette_data = (const uint8_t *)palette;
+	if(doom_palette.size() != 768 || memcmp(doom_palette.data(), palette_data, 768)) {
+		doom_palette.assign(palette_data, palette_data + 768);
+		tracker.Detach();
 	}
 
-	for (uint32_t y = 0; y < GetHeight(); y++) {
-		for (uint32_t x = 0; x < GetWidth(); x++) {
-			uint8_t palette_index = ((uint8_t *)fb)[x + (y * GetWidth())];
+	track_framebuffer(fb, 1);
+
+	bool failed = false;
+	uint32_t changed = tracker.Update([this, fb, palette_data, &failed](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+		SDL_Rect rect = { (int)x, (int)y, (int)width, (int)height };
+		uint8_t *pixels;
+		int pitch;
+
+		if (failed || SDL_LockTexture(window_texture, &rect, (void**)&(pixels), &pitch)) {
+			failed = true;
+			return;
+		}
+
+		for (uint32_t row = 0; row < height; row++) {
+			const uint8_t *src = (const uint8_t *)fb + x + ((y + row) * GetWidth());
+			uint8_t *dest = pixels + (row * pitch);
+
+			for (uint32_t col = 0; col < width; col++) {
+				uint8_t palette_index = src[col];
 
-			pixels[(x * 4) + (y * pitch)] = ((uint8_t *)palette)[(palette_index * 3) + 2];
-			pixels[(x * 4) + (y * pitch) + 1] = ((uint8_t *)palette)[(palette_index * 3) + 1];
-			pixels[(x * 4) + (y * pitch) + 2] = ((uint8_t *)palette)[(palette_index * 3) + 0];
+				dest[(col * 4)] = palette_data[(palette_index * 3) + 2];
+				dest[(col * 4) + 1] = palette_data[(palette_index * 3) + 1];
+				dest[(col * 4) + 2] = palette_data[(palette_index * 3) + 0];
+			}
 		}
+
+		SDL_UnlockTexture(window_texture);
+	});
+
+	if(failed) {
+		LC_ERROR(LogSDLScreen) << "Failed to lock pixels! Terminating.";
+		terminate();
+		return false;
 	}
 
-	SDL_UnlockTexture(window_texture);
-	return true;
+	return changed != 0;
 }
 
 
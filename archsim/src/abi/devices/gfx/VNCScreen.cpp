@@ -6,14 +6,25 @@
 
 #include "abi/devices/generic/Keyboard.h"
 #include "abi/devices/generic/Mouse.h"
+#include "util/SimOptions.h"
+
+#include <chrono>
 
 using namespace archsim::abi::devices::gfx;
 
-VNCScreen::VNCScreen(std::string id, memory::MemoryModel* mem_model, System* sys) : VirtualScreen(id, mem_model)
+// How often the framebuffer is checked for changes
+static const std::chrono::milliseconds kUpdatePeriod (20);
+
+VNCScreen::VNCScreen(std::string id, memory::MemoryModel* mem_model, System* sys) : VirtualScreen(id, mem_model), system_(sys), fb_ptr_(nullptr), vnc_server_(nullptr), vnc_framebuffer_(nullptr), keyboard_(nullptr), mouse_(nullptr), update_thread_(nullptr), terminated_(false)
 {
 
 }
 
+VNCScreen::~VNCScreen()
+{
+	Reset();
+}
+
 libgvnc::FB_PixelFormat Format_16bit (16, 16, 0, 1, 31, 63, 31, 11, 5, 0);
 libgvnc::FB_PixelFormat Format_RGB32 (32, 24, 0, 1, 255, 255, 255, 16, 8, 0);
 libgvnc::FB_PixelFormat Format_RGB24 (24, 24, 0, 1, 255, 255, 255, 16, 8, 0);
@@ -323,11 +334,14 @@ void mouse_callback(generic::Mouse &mouse, const libgvnc::PointerEvent &event)
 
 bool VNCScreen::Configure(uint32_t width, uint32_t height, VirtualScreenMode mode)
 {
+	VirtualScreen::Configure(width, height, mode);
+
 	// figure out pixel format
 	libgvnc::FB_PixelFormat pixelformat = Format_RGB24;
 
 	vnc_framebuffer_ = new libgvnc::Framebuffer(width, height, pixelformat);
 	vnc_framebuffer_ ->SetData(fb_ptr_);
+	vnc_framebuffer_->EnableDamageTracking();
 	vnc_server_ = new libgvnc::Server(vnc_framebuffer_);
 
 	if(keyboard_ != nullptr) {
@@ -353,22 +367,82 @@ bool VNCScreen::Configure(uint32_t width, uint32_t height, VirtualScreenMode mod
 
 bool VNCScreen::Initialise()
 {
+	TrackFramebuffer();
+
+	terminated_ = false;
+	update_thread_ = new std::thread(&VNCScreen::UpdateThread, this);
 	return true;
 }
 
 bool VNCScreen::Reset()
 {
+	if(update_thread_ != nullptr) {
+		terminated_ = true;
+		update_thread_->join();
+		delete update_thread_;
+		update_thread_ = nullptr;
+	}
+
+	std::lock_guard<std::mutex> l(tracker_lock_);
+	tracker_.Detach();
 	return true;
 }
 
 bool VNCScreen::SetFramebufferPointer(Address guest_addr)
 {
+	VirtualScreen::SetFramebufferPointer(guest_addr);
+
+	// The screen may not have been configured yet
+	uint32_t size = GetWidth() * GetHeight() * Format_RGB24.bits_per_pixel / 8;
+
 	host_addr_t addr;
-	GetMemory()->LockRegion(archsim::Address(guest_addr), 4096, addr);
+	GetMemory()->LockRegion(archsim::Address(guest_addr), size ? size : 4096, addr);
 	fb_ptr_ = addr;
+
+	if(vnc_framebuffer_ != nullptr) {
+		vnc_framebuffer_->SetData(fb_ptr_);
+	}
+
+	if(update_thread_ != nullptr) {
+		TrackFramebuffer();
+	}
 	return true;
 }
 
+void VNCScreen::TrackFramebuffer()
+{
+	std::lock_guard<std::mutex> l(tracker_lock_);
+
+	// Nothing to do if the guest just set the same framebuffer again
+	if(tracker_.IsAttached() && tracker_.GetData() == (const uint8_t *)fb_ptr_) {
+		return;
+	}
+
+	tracker_.Detach();
+	if(fb_ptr_ == nullptr || vnc_framebuffer_ == nullptr) {
+		return;
+	}
+
+	tracker_.Attach((const uint8_t *)fb_ptr_, GetWidth(), GetHeight(), vnc_framebuffer_->GetPixelFormat().bits_per_pixel / 8);
+	if(!archsim::options::ScreenNoWriteTracking) {
+		tracker_.EnableWriteProtection(*system_);
+	}
+}
+
+void VNCScreen::UpdateThread()
+{
+	while(!terminated_) {
+		{
+			std::lock_guard<std::mutex> l(tracker_lock_);
+			tracker_.Update([this](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+				vnc_framebuffer_->MarkDamaged(x, y, width, height);
+			});
+		}
+
+		std::this_thread::sleep_for(kUpdatePeriod);
+	}
+}
+
 
 void VNCScreen::SetKeyboard(generic::Keyboard& kbd)
 {
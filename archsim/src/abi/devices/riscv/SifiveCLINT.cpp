@@ -54,6 +54,7 @@ bool SifiveCLINT::Read(uint32_t offset, uint8_t size, uint64_t& data)
 			break;
 
 		case 0xbff8:
+			tick_source_->Synchronise();
 			data = GetTimer();
 			break;
 
@@ -80,11 +81,15 @@ bool SifiveCLINT::Write(uint32_t offset, uint8_t size, uint64_t data)
 
 		case 0x4000:
 			LC_DEBUG1(LogRiscVCLINT) << "Wrote MTIMECMP0 <= " << std::hex << data;
+			tick_source_->Synchronise();
 			GetHartTimer(0)->SetCmp(data);
+			tick_source_->Reschedule(*GetHartTimer(0));
 			break;
 		case 0x4008:
 			LC_DEBUG1(LogRiscVCLINT) << "Wrote MTIMECMP1 <= " << std::hex << data;
+			tick_source_->Synchronise();
 			GetHartTimer(1)->SetCmp(data);
+			tick_source_->Reschedule(*GetHartTimer(1));
 			break;
 		default:
 			UNIMPLEMENTED;
@@ -115,6 +120,32 @@ archsim::arch::riscv::RiscVSystemCoprocessor* SifiveCLINT::GetCoprocessor(int i)
 }
 
 
+void SifiveCLINT::SaveState(util::CheckpointWriter& writer)
+{
+	writer.Write<uint32_t>(timers_.size());
+	for(auto timer : timers_) {
+		writer.Write(timer->GetCmp());
+	}
+}
+
+bool SifiveCLINT::RestoreState(util::CheckpointReader& reader)
+{
+	uint32_t count;
+	if(!reader.Read(count) || count != timers_.size()) {
+		return false;
+	}
+
+	for(auto timer : timers_) {
+		uint64_t cmp;
+		if(!reader.Read(cmp)) {
+			return false;
+		}
+		timer->RestoreCmp(cmp);
+	}
+
+	return true;
+}
+
 void SifiveCLINT::SetMSIP(archsim::core::thread::ThreadInstance* thread, bool P)
 {
 	auto peripheral = thread->GetPeripherals().GetDevice(0);
@@ -170,3 +201,16 @@ void CLINTTimer::Tick(uint32_t tick_periods)
 {
 	CheckTick();
 }
+
+uint64_t CLINTTimer::GetTicksUntilDeadline()
+{
+	// mtime is the tick counter scaled by 1000, and the interrupt is pended
+	// once mtime > mtimecmp
+	uint64_t counter = clint_->GetTimer() / 1000;
+	uint64_t target = cmp_ / 1000 + 1;
+
+	if(cmp_ == (uint64_t)-1 || target <= counter) {
+		return kNoDeadline;
+	}
+	return target - counter;
+}
@@ -30,6 +30,67 @@ bool SifivePLIC::Initialise()
 	return true;
 }
 
+static void SaveWords(archsim::util::CheckpointWriter &writer, const std::vector<uint32_t> &words)
+{
+	writer.Write<uint32_t>(words.size());
+	writer.Write(words.data(), words.size() * sizeof(uint32_t));
+}
+
+static bool RestoreWords(archsim::util::CheckpointReader &reader, std::vector<uint32_t> &words)
+{
+	// The number of words is fixed by the configuration
+	uint32_t count;
+	return reader.Read(count) && count == words.size() && reader.Read(words.data(), words.size() * sizeof(uint32_t));
+}
+
+void SifivePLIC::SaveState(util::CheckpointWriter& writer)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+
+	SaveWords(writer, interrupt_priorities_);
+	SaveWords(writer, interrupt_pending_);
+	SaveWords(writer, interrupt_claimed_);
+
+	writer.Write<uint32_t>(hart_config_.size());
+	for(const auto &context : hart_config_) {
+		writer.Write(context.threshold);
+		SaveWords(writer, context.enable);
+		writer.Write<uint8_t>(context.busy);
+	}
+
+	SaveLineState(writer);
+}
+
+bool SifivePLIC::RestoreState(util::CheckpointReader& reader)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+
+	if(!RestoreWords(reader, interrupt_priorities_) || !RestoreWords(reader, interrupt_pending_) || !RestoreWords(reader, interrupt_claimed_)) {
+		return false;
+	}
+
+	uint32_t contexts;
+	if(!reader.Read(contexts) || contexts != hart_config_.size()) {
+		return false;
+	}
+
+	for(auto &context : hart_config_) {
+		uint8_t busy;
+		if(!reader.Read(context.threshold) || !RestoreWords(reader, context.enable) || !reader.Read(busy)) {
+			return false;
+		}
+		context.busy = busy;
+	}
+
+	return RestoreLineState(reader);
+}
+
+void SifivePLIC::StateRestored()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	UpdateIRQ();
+}
+
 void SifivePLIC::SetupContexts(const std::string& config)
 {
 	hart_config_.clear();
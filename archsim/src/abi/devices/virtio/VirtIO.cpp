@@ -6,7 +6,9 @@
 #include "abi/EmulationModel.h"
 #include "abi/memory/MemoryModel.h"
 #include "util/LogContext.h"
+#include "util/SimOptions.h"
 
+#include <pthread.h>
 #include <string.h>
 
 UseLogContext(LogDevice);
@@ -21,6 +23,10 @@ using archsim::Address;
 VirtIO::VirtIO(EmulationModel& parent_model, IRQLine& irq, Address base_address, uint32_t size, std::string name, uint32_t version, uint32_t device_id, uint8_t nr_queues)
 	: RegisterBackedMemoryComponent(parent_model, base_address, size, name),
 	  irq(irq),
+	  io_thread(nullptr),
+	  io_pending_queues(0),
+	  io_busy(false),
+	  io_terminate(false),
 
 	  MagicValue("magic", 0x00, 32, VIRTIO_MAGIC),
 	  Version("version", 0x04, 32, version),
@@ -80,11 +86,28 @@ bool VirtIO::Initialise()
 
 VirtIO::~VirtIO()
 {
+	StopIOThread();
+
 	for (auto queue : queues) {
 		delete queue;
 	}
 }
 
+void VirtIO::StopIOThread()
+{
+	if (io_thread != nullptr) {
+		{
+			std::lock_guard<std::mutex> l(io_lock);
+			io_terminate = true;
+		}
+		io_work.notify_one();
+
+		io_thread->join();
+		delete io_thread;
+		io_thread = nullptr;
+	}
+}
+
 bool VirtIO::Read(uint32_t offset, uint8_t size, uint64_t& data)
 {
 	LC_DEBUG3(LogVirtIO) << "[" << GetName() << "] Register Read offset=" << std::hex << offset << ", size=" << std::dec << (uint32_t)size;
@@ -133,6 +156,8 @@ void VirtIO::WriteRegister(MemoryRegister& reg, uint32_t value)
 
 	if (reg == Status) {
 		if (value == 0) {
+			WaitForIOIdle();
+
 			HostFeaturesSel.Set(0);
 			GuestFeaturesSel.Set(0);
 			GuestPageSize.Set(0);
@@ -140,6 +165,8 @@ void VirtIO::WriteRegister(MemoryRegister& reg, uint32_t value)
 			ResetDevice();
 		}
 	} else if (reg == QueuePFN) {
+		WaitForIOIdle();
+
 		if (value == 0) {
 			HostFeaturesSel.Set(0);
 			GuestFeaturesSel.Set(0);
@@ -167,9 +194,10 @@ void VirtIO::WriteRegister(MemoryRegister& reg, uint32_t value)
 		LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Setting guest page size=" << std::hex << value << ", shift=" << std::dec << (uint32_t)guest_page_shift;
 	} else if (reg == QueueNotify) {
 		LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Queue Notify " << std::dec << QueueSel.Get();
-		ProcessQueue(GetQueue(value));
+		NotifyQueue(value);
 		LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Queue Notification Complete, ISR=" << std::hex << InterruptStatus.Get();
 	} else if (reg == InterruptACK) {
+		std::lock_guard<std::mutex> l(irq_lock);
 		InterruptStatus.Set(InterruptStatus.Get() & ~value);
 		if (value != 0 && irq.IsAsserted()) {
 			LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Rescinding Interrupt";
@@ -177,20 +205,90 @@ void VirtIO::WriteRegister(MemoryRegister& reg, uint32_t value)
 		}
 	}
 
-	if (InterruptStatus.Get() != 0) {
-		if (!irq.IsAsserted()) {
-			LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Asserting Interrupt";
-			irq.Assert();
+	{
+		std::lock_guard<std::mutex> l(irq_lock);
+		if (InterruptStatus.Get() != 0) {
+			if (!irq.IsAsserted()) {
+				LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Asserting Interrupt";
+				irq.Assert();
+			}
 		}
 	}
 
 	RegisterBackedMemoryComponent::WriteRegister(reg, value);
 }
 
+void VirtIO::NotifyQueue(uint32_t index)
+{
+	if (index >= queues.size()) {
+		LC_WARNING(LogVirtIO) << "[" << GetName() << "] Notification for invalid queue " << std::dec << index;
+		return;
+	}
+
+	if (archsim::options::VirtIOSyncIO) {
+		ProcessQueue(queues[index]);
+		return;
+	}
+
+	std::lock_guard<std::mutex> l(io_lock);
+	io_pending_queues |= 1u << index;
+
+	if (io_thread == nullptr) {
+		io_thread = new std::thread(&VirtIO::IOThreadProc, this);
+	} else {
+		io_work.notify_one();
+	}
+}
+
+void VirtIO::WaitForIOIdle()
+{
+	std::unique_lock<std::mutex> l(io_lock);
+	io_idle.wait(l, [this] { return io_pending_queues == 0 && !io_busy; });
+}
+
+void VirtIO::IOThreadProc()
+{
+	pthread_setname_np(pthread_self(), "virtio-io");
+
+	std::unique_lock<std::mutex> l(io_lock);
+	while (true) {
+		io_work.wait(l, [this] { return io_terminate || io_pending_queues != 0; });
+		if (io_terminate) {
+			break;
+		}
+
+		uint32_t pending = io_pending_queues;
+		io_pending_queues = 0;
+		io_busy = true;
+		l.unlock();
+
+		for (uint32_t index = 0; index < queues.size(); ++index) {
+			if (pending & (1u << index)) {
+				ProcessQueue(queues[index]);
+			}
+		}
+
+		l.lock();
+		io_busy = false;
+		if (io_pending_queues == 0) {
+			io_idle.notify_all();
+		}
+	}
+}
+
+void VirtIO::ProcessEvents(std::vector<VirtIOQueueEvent *> &events)
+{
+	for (auto evt : events) {
+		ProcessEvent(evt);
+	}
+}
+
 void VirtIO::ProcessQueue(VirtQueue *queue)
 {
 	LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Processing Queue";
 
+	std::vector<VirtIOQueueEvent *> events;
+
 	uint16_t head_idx;
 	const VirtRing::VirtRingDesc *descr;
 	while ((descr = queue->PopDescriptorChainHead(head_idx)) != NULL) {
@@ -221,8 +319,11 @@ void VirtIO::ProcessQueue(VirtQueue *queue)
 			}
 		} while (have_next);
 
-		LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Processing event";
-		ProcessEvent(evt);
+		events.push_back(evt);
+	}
 
+	LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Processing " << std::dec << events.size() << " events";
+	if (!events.empty()) {
+		ProcessEvents(events);
 	}
 }
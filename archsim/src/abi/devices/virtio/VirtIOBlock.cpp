@@ -6,6 +6,7 @@
 #include "util/LogContext.h"
 #include "abi/devices/virtio/VirtQueue.h"
 #include "abi/devices/IRQController.h"
+#include <limits.h>
 #include <string.h>
 
 UseLogContext(LogVirtIO);
@@ -32,7 +33,7 @@ VirtIOBlock::VirtIOBlock(EmulationModel& parent_model, IRQLine& irq, Address bas
 
 VirtIOBlock::~VirtIOBlock()
 {
-
+	StopIOThread();
 }
 
 void VirtIOBlock::ResetDevice()
@@ -54,75 +55,130 @@ void VirtIOBlock::WriteRegister(MemoryRegister& reg, uint32_t value)
 }
 
 
-void VirtIOBlock::ProcessEvent(VirtIOQueueEvent* evt_)
+void VirtIOBlock::ProcessEvent(VirtIOQueueEvent* evt)
 {
-	VirtIOQueueEvent &evt = *evt_;
-	LC_DEBUG1(LogBlock) << "Processing Event";
+	std::vector<VirtIOQueueEvent *> events { evt };
+	ProcessEvents(events);
+}
 
-	if (evt.read_buffers.size() == 0 && evt.write_buffers.size() == 0)
-		return;
+void VirtIOBlock::ProcessEvents(std::vector<VirtIOQueueEvent *> &events)
+{
+	LC_DEBUG1(LogBlock) << "Processing " << std::dec << events.size() << " events";
+
+	// Reads and writes are gathered up into vectored requests, merging
+	// requests for adjacent sectors, and the whole batch is handed to the
+	// block device at once. The guest doesn't expect any ordering between
+	// requests which are outstanding at the same time.
+	std::vector<generic::block::BlockRequest> requests;
+	std::vector<std::pair<VirtIOQueueEvent *, size_t>> queued;
+	bool completed = false;
+
+	for (auto evt : events) {
+		if (evt->read_buffers.size() == 0 || evt->write_buffers.size() == 0 || evt->read_buffers.front().size < sizeof(struct virtio_blk_req)) {
+			LC_DEBUG1(LogBlock) << "Discarding event with invalid header";
+			delete evt;
+			continue;
+		}
 
-	assert(evt.read_buffers.size() > 0);
-	assert(evt.write_buffers.size() > 0);
+		struct virtio_blk_req *req = (struct virtio_blk_req *)evt->read_buffers.front().data;
+
+		bool is_write;
+		std::vector<VirtIOQueueEventBuffer>::iterator begin, end;
+		switch (req->type) {
+			case 0: // Read
+				// Everything but the trailing status byte is data
+				is_write = false;
+				begin = evt->write_buffers.begin();
+				end = evt->write_buffers.end() - 1;
+				break;
+
+			case 1: // Write
+				// Everything but the leading header is data
+				is_write = true;
+				begin = evt->read_buffers.begin() + 1;
+				end = evt->read_buffers.end();
+				break;
+
+			case 8: { // Get ID
+				assert(evt->write_buffers.size() == 2);
+
+				char *serial_number = (char *)evt->write_buffers.front().data;
+				strncpy(serial_number, "virtio", evt->write_buffers.front().size);
+
+				evt->response_size = 1 + 7;
+				CompleteEvent(evt, 0);
+				completed = true;
+				continue;
+			}
 
-	if (evt.read_buffers.front().size < sizeof(struct virtio_blk_req)) {
-		LC_DEBUG1(LogBlock) << "Discarding event with invalid header";
-		return;
-	}
+			default:
+				LC_ERROR(LogBlock) << "Rejecting event with unsupported type " << (uint32_t)req->type;
 
-	struct virtio_blk_req *req = (struct virtio_blk_req *)evt.read_buffers.front().data;
+				evt->response_size = 1;
+				CompleteEvent(evt, 2);
+				completed = true;
+				continue;
+		}
 
-	uint8_t *status = (uint8_t *)evt.write_buffers.back().data;
-	switch (req->type) {
-		case 0: // Read
-			assert(evt.write_buffers.size() == 2);
+		uint64_t size = 0;
+		bool valid = begin != end;
+		for (auto buffer = begin; buffer != end; ++buffer) {
+			valid &= (buffer->size % bdev.GetBlockSize()) == 0;
+			size += buffer->size;
+		}
 
-			if (HandleRead(req->sector, (uint8_t *)evt.write_buffers.front().data, evt.write_buffers.front().size)) {
-				*status = 0;
-			} else {
-				*status = 1;
-			}
+		evt->response_size = is_write ? 1 : size + 1;
 
-			evt.response_size = evt.write_buffers.front().size + 1;
-			break;
+		if (!valid) {
+			LC_WARNING(LogBlock) << "Rejecting " << (is_write ? "write" : "read") << " request which isn't a whole number of blocks";
+			CompleteEvent(evt, 1);
+			completed = true;
+			continue;
+		}
 
-		case 1: // Write
-			assert(evt.read_buffers.size() == 2);
+		LC_DEBUG1(LogBlock) << "Queueing " << (is_write ? "write" : "read") << " sector=" << std::hex << req->sector << ", len=" << std::dec << size;
 
-			if (HandleWrite(req->sector, (uint8_t *)evt.read_buffers.back().data, evt.read_buffers.back().size)) {
-				*status = 0;
-			} else {
-				*status = 1;
-			}
+		bool merge = false;
+		if (!requests.empty()) {
+			const auto &last = requests.back();
+			merge = last.is_write == is_write && last.block_idx + (last.size / bdev.GetBlockSize()) == req->sector && last.buffers.size() + (end - begin) <= IOV_MAX;
+		}
 
-			evt.response_size = 1;
-			break;
-		case 8: { // Get ID
-			assert(evt.write_buffers.size() == 2);
+		if (!merge) {
+			requests.emplace_back(is_write, req->sector);
+		}
 
-			char *serial_number = (char *)evt.write_buffers.front().data;
-			strncpy(serial_number, "virtio", evt.write_buffers.front().size);
+		for (auto buffer = begin; buffer != end; ++buffer) {
+			requests.back().AddBuffer(buffer->data, buffer->size);
+		}
+		queued.push_back({evt, requests.size() - 1});
+	}
 
-			evt.response_size = 1 + 7;
-			*status = 0;
+	if (!requests.empty()) {
+		LC_DEBUG1(LogBlock) << "Submitting " << std::dec << requests.size() << " requests for " << queued.size() << " events";
+		bdev.SubmitRequests(requests.data(), requests.size());
+	}
 
-			break;
-		}
-		default:
-			LC_ERROR(LogBlock) << "Rejecting event with unsupported type " << (uint32_t)req->type;
+	for (const auto &entry : queued) {
+		CompleteEvent(entry.first, requests[entry.second].success ? 0 : 1);
+		completed = true;
+	}
 
-			*status = 2;
-			evt.response_size = 1;
-			break;
+	// One interrupt covers the whole batch
+	if (completed) {
+		AssertInterrupt(1);
 	}
+}
 
-	evt.owner.Push(evt.Index(), evt.response_size);
-	LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Pushed a descriptor chain head " << std::dec << evt.Index() << ", length=" << evt.response_size;
+void VirtIOBlock::CompleteEvent(VirtIOQueueEvent* evt, uint8_t status)
+{
+	*(uint8_t *)evt->write_buffers.back().data = status;
 
-	AssertInterrupt(1);
+	evt->owner.Push(evt->Index(), evt->response_size);
+	LC_DEBUG1(LogVirtIO) << "[" << GetName() << "] Pushed a descriptor chain head " << std::dec << evt->Index() << ", length=" << evt->response_size;
 
 	// We're done with the event descriptor so delete it
-	delete evt_;
+	delete evt;
 }
 
 uint8_t *VirtIOBlock::GetConfigArea() const
@@ -134,15 +190,3 @@ uint32_t VirtIOBlock::GetConfigAreaSize() const
 {
 	return sizeof(config);
 }
-
-bool VirtIOBlock::HandleRead(uint64_t sector, uint8_t* buffer, uint32_t len)
-{
-	LC_DEBUG1(LogBlock) << "Handling read sector=" << std::hex << sector << ", len=" << std::dec << len;
-	return bdev.ReadBlocks(sector, len / bdev.GetBlockSize(), buffer);
-}
-
-bool VirtIOBlock::HandleWrite(uint64_t sector, uint8_t* buffer, uint32_t len)
-{
-	LC_DEBUG1(LogBlock) << "Handling write sector=" << std::hex << sector << ", len=" << std::dec << len;
-	return bdev.WriteBlocks(sector, len / bdev.GetBlockSize(), buffer);
-}
@@ -42,7 +42,7 @@ VirtIONet::VirtIONet(EmulationModel& parent_model, IRQLine& irq, Address base_ad
 
 VirtIONet::~VirtIONet()
 {
-
+	StopIOThread();
 }
 
 void VirtIONet::ResetDevice()
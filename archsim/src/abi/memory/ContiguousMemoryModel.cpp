@@ -182,16 +182,11 @@ MemoryTranslationModel &ContiguousMemoryModel::GetTranslationModel()
 
 bool ContiguousMemoryModel::ResolveGuestAddress(host_const_addr_t host_addr, guest_addr_t &guest_addr)
 {
-#ifdef DIRECT
-	guest_addr = (guest_addr_t)(intptr_t)host_addr;
-	return true;
-#else
 	if (host_addr >= (host_const_addr_t)mem_base && host_addr < (host_const_addr_t)((unsigned long)mem_base + CONTIGUOUS_MEMORY_SIZE)) {
 		guest_addr = (guest_addr_t)((unsigned long)host_addr - (unsigned long)mem_base);
 		return true;
 	}
 	return false;
-#endif
 }
 
 uint32_t ContiguousMemoryModel::Read(guest_addr_t addr, uint8_t *data, int size)
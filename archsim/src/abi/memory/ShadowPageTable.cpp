@@ -0,0 +1,79 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "abi/memory/ShadowPageTable.h"
+#include "abi/memory/MemoryModel.h"
+#include "util/LogContext.h"
+
+#include <sys/mman.h>
+
+UseLogContext(LogMemoryModel);
+DeclareChildLogContext(LogShadowPageTable, LogMemoryModel, "ShadowPageTable");
+
+using namespace archsim::abi::memory;
+
+ShadowPageTable::ShadowPageTable(MemoryModel& mem_model, unsigned address_bits) : mem_model_(mem_model), address_bits_(address_bits), entry_count_(0), table_(nullptr)
+{
+
+}
+
+ShadowPageTable::~ShadowPageTable()
+{
+	if(table_ != nullptr) {
+		munmap(table_, entry_count_ * sizeof(void*));
+	}
+}
+
+bool ShadowPageTable::Initialise()
+{
+	// JIT code only ever produces 32 bit guest addresses, so always cover
+	// at least that much of the address space.
+	if(address_bits_ < 32) {
+		address_bits_ = 32;
+	}
+	if(address_bits_ > 48) {
+		LC_ERROR(LogShadowPageTable) << "Cannot shadow a " << address_bits_ << " bit address space";
+		return false;
+	}
+
+	uint64_t entry_count = 1ull << (address_bits_ - 12);
+	void *table = mmap(nullptr, entry_count * sizeof(void*), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(table == MAP_FAILED) {
+		LC_ERROR(LogShadowPageTable) << "Failed to map shadow page table for a " << address_bits_ << " bit address space";
+		return false;
+	}
+
+	table_ = (void**)table;
+	entry_count_ = entry_count;
+
+	LC_DEBUG1(LogShadowPageTable) << "Mapped shadow page table with " << entry_count_ << " entries at " << (void*)table_;
+	return true;
+}
+
+void ShadowPageTable::Clear()
+{
+	std::lock_guard<std::mutex> lock(fill_lock_);
+
+	// Dropping the pages resets the entries to zero, and releases the host
+	// memory backing them.
+	madvise(table_, entry_count_ * sizeof(void*), MADV_DONTNEED);
+}
+
+void *ShadowPageTable::TranslateSlow(Address addr)
+{
+	host_addr_t page;
+	if(!mem_model_.LockRegion(addr.PageBase(), Address::PageSize, page)) {
+		LC_DEBUG1(LogShadowPageTable) << "Could not lock guest page " << addr.PageBase();
+		return nullptr;
+	}
+
+	// Addresses beyond the table are still translated, just never cached.
+	// Threads racing to fill the same entry will always write the same
+	// value, so readers don't need to take the lock.
+	auto index = addr.GetPageIndex();
+	if(index < entry_count_) {
+		std::lock_guard<std::mutex> lock(fill_lock_);
+		table_[index] = page;
+	}
+
+	return (char*)page + addr.GetPageOffset();
+}
@@ -9,7 +9,7 @@
 #include <llvm/IR/Module.h>
 #endif
 
-#include <sys/mman.h>
+#include <algorithm>
 #include <sys/mman.h>
 
 #define ADDRESS_SPACE_SIZE	(0x100000000)
@@ -130,14 +130,40 @@ bool SparseMemoryTranslationModel::EmitMemoryWrite(archsim::internal::translate:
 #endif
 #endif
 
-SparseMemoryModel::SparseMemoryModel() : prev_page_data_(nullptr)
+SparseMemoryModel::PageTableNode::PageTableNode()
+{
+	for(auto &entry : Entries) {
+		entry.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+SparseMemoryModel::SparseMemoryModel() : page_table_(new PageTableNode())
 {
+	static_assert(kLevels * kLevelBits + 12 >= 64, "Page table must cover the whole address space");
 	pages_remaining_ = 1024*1024;
 }
 
 SparseMemoryModel::~SparseMemoryModel()
 {
+	FreePageTable(page_table_, kLevels - 1);
+}
+
+void SparseMemoryModel::FreePageTable(PageTableNode* node, unsigned level)
+{
+	for(auto &entry : node->Entries) {
+		void *ptr = entry.load(std::memory_order_relaxed);
+		if(ptr == nullptr) {
+			continue;
+		}
+
+		if(level == 0) {
+			munmap(ptr, Address::PageSize);
+		} else {
+			FreePageTable((PageTableNode *)ptr, level - 1);
+		}
+	}
 
+	delete node;
 }
 
 bool SparseMemoryModel::SynchroniseVMAProtection(GuestVMA& vma)
@@ -160,9 +186,10 @@ bool SparseMemoryModel::LockRegions(guest_addr_t guest_addr, guest_size_t guest_
 {
 	std::vector<void*> ptrs;
 
-	// lock each page
+	// lock each page, including the last page of an unaligned range
+	Address end = guest_addr + guest_size;
 	guest_addr = guest_addr.PageBase();
-	for(Address addr = guest_addr; addr < (guest_addr + guest_size); addr += Address::PageSize) {
+	for(Address addr = guest_addr; addr < end; addr += Address::PageSize) {
 		void *ptr;
 		if(!LockRegion(addr, Address::PageSize, ptr)) {
 			return false;
@@ -224,79 +251,82 @@ bool SparseMemoryModel::ResizeVMA(GuestVMA &vma, guest_size_t new_size)
 	return true;
 }
 
-char* SparseMemoryModel::GetPageUncached(Address addr)
+char* SparseMemoryModel::AllocatePage(Address addr)
 {
-	char *ptr = nullptr;
-
-	if(!data_.count(addr.PageBase())) {
+	std::lock_guard<std::mutex> lg(map_lock_);
 
-		if(pages_remaining_ == 0) {
-			throw std::bad_alloc();
-		}
-		pages_remaining_--;
-		ptr = (char*)mmap(0, 4096, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-		if(ptr == MAP_FAILED) {
-			throw std::bad_alloc();
-		}
+	uint64_t index = addr.GetPageIndex();
 
-		bzero(ptr, 4096);
+	// Another thread may have filled in part (or all) of the path since we
+	// looked, so walk it again under the lock
+	PageTableNode *node = page_table_;
+	for(unsigned level = kLevels - 1; level > 0; --level) {
+		auto &entry = node->Entries[(index >> (level * kLevelBits)) & kLevelMask];
 
-		data_[addr.PageBase()] = ptr;
-	} else {
-		ptr = data_.at(addr.PageBase());
+		PageTableNode *next = (PageTableNode *)entry.load(std::memory_order_relaxed);
+		if(next == nullptr) {
+			next = new PageTableNode();
+			entry.store(next, std::memory_order_release);
+		}
+		node = next;
 	}
 
-	return ptr;
-}
-
+	auto &entry = node->Entries[index & kLevelMask];
+	char *ptr = (char *)entry.load(std::memory_order_relaxed);
+	if(ptr != nullptr) {
+		return ptr;
+	}
 
-char* SparseMemoryModel::GetPage(Address addr)
-{
-	std::lock_guard<std::mutex> lg(map_lock_);
+	if(pages_remaining_ == 0) {
+		throw std::bad_alloc();
+	}
+	pages_remaining_--;
 
-	char **ptr_ptr;
-	if(cache_.try_cache_fetch(addr.GetPageIndex(), ptr_ptr) == archsim::util::CACHE_MISS) {
-		*ptr_ptr = GetPageUncached(addr.PageBase());
+	// Anonymous mappings are already zeroed
+	ptr = (char*)mmap(0, Address::PageSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if(ptr == MAP_FAILED) {
+		throw std::bad_alloc();
 	}
-	return *ptr_ptr;
+
+	entry.store(ptr, std::memory_order_release);
+	return ptr;
 }
 
+// Accesses are copied a page at a time, so an access which crosses a page
+// boundary takes two copies
 uint32_t SparseMemoryModel::Read(guest_addr_t addr, uint8_t *data, int size)
 {
 //	RaiseEvent(MemoryModel::MemEventRead, addr, size);
-	if((addr + size - 1).PageBase() != addr.PageBase()) {
-		for(int i = 0; i < size; ++i) {
-			auto result = Read(addr + i, data + i, 1);
-			if(result) {
-				return result;
-			}
+	while(size > 0) {
+		RegionFlags flags;
+		if(!GetMappingManager()->GetRegionProtection(addr, flags) || !(flags & RegFlagRead)) {
+			return 1;
 		}
-		return 0;
-	}
 
-	RegionFlags flags;
-	if(GetMappingManager()->GetRegionProtection(addr, flags) && (flags & RegFlagRead)) {
 		auto offset = addr.GetPageOffset();
+		int chunk = std::min<int>(size, Address::PageSize - offset);
+		memcpy(data, GetPage(addr) + offset, chunk);
 
-		memcpy(data, GetPage(addr) + offset, size);
-
-		return 0;
-	} else {
-		return 1;
+		addr += chunk;
+		data += chunk;
+		size -= chunk;
 	}
+
+	return 0;
 }
 
 uint32_t SparseMemoryModel::Fetch(guest_addr_t addr, uint8_t *data, int size)
 {
 //	RaiseEvent(MemoryModel::MemEventFetch, addr, size);
-	if((addr + size).PageBase() != addr.PageBase()) {
-		UNIMPLEMENTED;
-	}
-
-	auto &page = data_[addr.PageBase()];
-	auto offset = addr.GetPageOffset();
+	while(size > 0) {
+		auto offset = addr.GetPageOffset();
+		int chunk = std::min<int>(size, Address::PageSize - offset);
+		memcpy(data, GetPage(addr) + offset, chunk);
 
-	memcpy(data, GetPage(addr) + offset, size);
+		addr += chunk;
+		data += chunk;
+		size -= chunk;
+	}
 
 	return 0;
 }
@@ -304,20 +334,16 @@ uint32_t SparseMemoryModel::Fetch(guest_addr_t addr, uint8_t *data, int size)
 uint32_t SparseMemoryModel::Write(guest_addr_t addr, uint8_t *data, int size)
 {
 //	RaiseEvent(MemoryModel::MemEventWrite, addr, size);
-	if((addr + size - 1).PageBase() != addr.PageBase()) {
-		for(int i = 0; i < size; ++i) {
-			auto result = Write(addr + i, data + i, 1);
-			if(result) {
-				return result;
-			}
-		}
-		return 0;
-	}
+	while(size > 0) {
+		auto offset = addr.GetPageOffset();
+		int chunk = std::min<int>(size, Address::PageSize - offset);
+		memcpy(GetPage(addr) + offset, data, chunk);
 
-	auto page = GetPage(addr);
-	auto offset = addr.GetPageOffset();
+		addr += chunk;
+		data += chunk;
+		size -= chunk;
+	}
 
-	memcpy(page + offset, data, size);
 	return 0;
 }
 
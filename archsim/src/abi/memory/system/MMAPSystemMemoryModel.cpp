@@ -1,17 +1,20 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 
 #include "abi/memory/system/MMAPSystemMemoryModel.h"
-#include "abi/devices/MMU.h"
-#include "system.h"
+#include "abi/memory/MemoryTranslationModel.h"
 #include "util/ComponentManager.h"
 #include "util/LogContext.h"
-#include "gensim/gensim_processor.h"
+#include "util/SimOptions.h"
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 
-#include <stdio.h>
-#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fcntl.h>
+#include <unistd.h>
 
 using namespace archsim::abi::memory;
 
@@ -20,197 +23,365 @@ RegisterComponent(MemoryModel, MMAPPhysicalMemory, "mmap", "");
 UseLogContext(LogMemoryModel);
 DeclareChildLogContext(LogMMAP, LogMemoryModel, "MMAP");
 
-struct {
-	bool state;
-} mmap_mem_state;
+// Guest memory is kept aligned to this in the host, so that transparent huge
+// pages can be used for it
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static int ProtFlags(RegionFlags prot)
+{
+	unsigned int flags = PROT_NONE;
+
+	if ((prot & RegFlagRead) == RegFlagRead) flags |= PROT_READ;
+
+	if ((prot & RegFlagWrite) == RegFlagWrite) flags |= PROT_WRITE;
 
-MMAPPhysicalMemory::MMAPPhysicalMemory()
+	if ((prot & RegFlagExecute) == RegFlagExecute) flags |= PROT_READ;
+
+	return flags;
+}
+
+MMAPPhysicalMemory::MMAPPhysicalMemory() : translation_model(nullptr), physmem_fd(-1), private_(false), huge_pages_(false), backing_size_(0), reservation_(nullptr), reservation_size_(0), mem_base_(nullptr)
 {
+#if CONFIG_LLVM
+	translation_model = new ContiguousMemoryTranslationModel();
+#endif
 }
 
 MMAPPhysicalMemory::~MMAPPhysicalMemory()
 {
+#if CONFIG_LLVM
+	delete translation_model;
+#endif
+}
+
+bool MMAPPhysicalMemory::OpenBacking()
+{
+	if (archsim::options::MemoryBackingFile.IsSpecified()) {
+		const std::string &filename = archsim::options::MemoryBackingFile.GetValue();
+
+		// A private mapping never writes to the file, so it may be read only
+		private_ = archsim::options::MemoryBackingPrivate;
+		physmem_fd = open(filename.c_str(), private_ ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+		if (physmem_fd < 0) {
+			LC_ERROR(LogMMAP) << "Unable to open physical memory backing file " << filename << ": " << strerror(errno);
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(physmem_fd, &st) < 0) {
+			LC_ERROR(LogMMAP) << "Unable to stat physical memory backing file " << filename << ": " << strerror(errno);
+			return false;
+		}
+		backing_size_ = st.st_size;
+
+		LC_INFO(LogMMAP) << "Using " << filename << " (" << backing_size_ << " bytes) as " << (private_ ? "private" : "shared") << " physical memory";
+	} else {
+		// Nobody else can see an anonymous memory file, so there is no point in
+		// mapping it privately
+		private_ = false;
+		physmem_fd = memfd_create("archsim-physmem", MFD_CLOEXEC);
+		if (physmem_fd < 0) {
+			LC_ERROR(LogMMAP) << "Unable to create physical memory file: " << strerror(errno);
+			return false;
+		}
+		backing_size_ = 0;
+	}
 
+	return true;
 }
 
 bool MMAPPhysicalMemory::Initialise()
 {
-	int rc;
+	huge_pages_ = archsim::options::MemoryHugePages;
+
+	if (!OpenBacking()) {
+		return false;
+	}
 
-	physmem_fd = open("/home/spink/physmem", O_RDWR);
-	if (physmem_fd < 0) {
-		LC_ERROR(LogMMAP) << "Unable to open physical memory backing file";
+	// Reserve the whole physical address space, aligned so that guest huge
+	// pages are also host huge pages
+	reservation_size_ = kPhysicalMemorySize + HUGE_PAGE_SIZE;
+	reservation_ = mmap(NULL, reservation_size_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (reservation_ == MAP_FAILED) {
+		LC_ERROR(LogMMAP) << "Unable to reserve physical memory: " << strerror(errno);
+		reservation_ = nullptr;
 		return false;
 	}
 
+	mem_base_ = (host_addr_t)(((uintptr_t)reservation_ + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+
+#if CONFIG_LLVM
+	((ContiguousMemoryTranslationModel*)translation_model)->SetContiguousMemoryBase(mem_base_);
+#endif
+
 	return true;
 }
 
 void MMAPPhysicalMemory::Destroy()
 {
-	close(physmem_fd);
+	if (archsim::options::MemorySnapshotFile.IsSpecified()) {
+		SaveSnapshot(archsim::options::MemorySnapshotFile.GetValue());
+	}
+
+	if (reservation_ != nullptr) {
+		// Make sure that a shared backing file is up to date
+		if (!private_) {
+			for (auto &vma : mapped_vmas_) {
+				msync(GuestToHost(vma.second->base), vma.second->size, MS_SYNC);
+			}
+		}
+
+		munmap(reservation_, reservation_size_);
+		reservation_ = nullptr;
+		mem_base_ = nullptr;
+	}
+	mapped_vmas_.clear();
+
+	if (physmem_fd >= 0) {
+		close(physmem_fd);
+		physmem_fd = -1;
+	}
 }
 
 MemoryTranslationModel &MMAPPhysicalMemory::GetTranslationModel()
 {
-	assert(false);
-	__builtin_unreachable();
+	return *translation_model;
 }
 
-uint32_t MMAPPhysicalMemory::Read(guest_addr_t addr, uint8_t *data, int size)
+bool MMAPPhysicalMemory::MapRange(guest_addr_t base, guest_size_t size, RegionFlags prot)
 {
-	lseek(physmem_fd, addr, SEEK_SET);
-	read(physmem_fd, data, size);
-	return 0;
-}
+	if (!InRange(base, size)) {
+		LC_ERROR(LogMMAP) << "Region " << base << " (" << size << " bytes) is outside of physical memory";
+		return false;
+	}
 
-uint32_t MMAPPhysicalMemory::Fetch(guest_addr_t addr, uint8_t *data, int size)
-{
-	lseek(physmem_fd, addr, SEEK_SET);
-	read(physmem_fd, data, size);
-	return 0;
-}
+	uint64_t end = base.Get() + size;
 
-uint32_t MMAPPhysicalMemory::Write(guest_addr_t addr, uint8_t *data, int size)
-{
-	printf("MMapPhysicalMemory::Write addr: %x, data: %x\n", addr, *data);
-	fflush(stdout);
-	lseek(physmem_fd, addr, SEEK_SET);
-	write(physmem_fd, data, size);
-	fsync(physmem_fd);
-	return 0;
-}
+	// A shared backing file grows to hold everything mapped from it
+	if (!private_ && end > backing_size_) {
+		if (ftruncate(physmem_fd, end) < 0) {
+			LC_ERROR(LogMMAP) << "Unable to extend physical memory backing file: " << strerror(errno);
+			return false;
+		}
+		backing_size_ = end;
+	}
 
-uint32_t MMAPPhysicalMemory::Peek(guest_addr_t addr, uint8_t *data, int size)
-{
-	lseek(physmem_fd, addr, SEEK_SET);
-	read(physmem_fd, data, size);
-	return 0;
+	// Map whatever the backing file covers. Beyond the end of a private
+	// backing file, memory is anonymous (and so starts out as zero).
+	uint64_t file_size = 0;
+	if (backing_size_ > base.Get()) {
+		file_size = std::min<uint64_t>(size, backing_size_ - base.Get());
+		file_size = (file_size + Address::PageSize - 1) & ~(uint64_t)(Address::PageSize - 1);
+
+		void *ptr = mmap(GuestToHost(base), file_size, ProtFlags(prot), MAP_FIXED | (private_ ? MAP_PRIVATE : MAP_SHARED), physmem_fd, base.Get());
+		if (ptr == MAP_FAILED) {
+			LC_ERROR(LogMMAP) << "Unable to map physical memory at " << base << ": " << strerror(errno);
+			return false;
+		}
+	}
+
+	if (file_size < size) {
+		void *ptr = mmap(GuestToHost(base + file_size), size - file_size, ProtFlags(prot), MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (ptr == MAP_FAILED) {
+			LC_ERROR(LogMMAP) << "Unable to map anonymous physical memory at " << (base + file_size) << ": " << strerror(errno);
+			return false;
+		}
+	}
+
+	if (huge_pages_ && madvise(GuestToHost(base), size, MADV_HUGEPAGE) < 0) {
+		LC_WARNING(LogMMAP) << "Unable to use huge pages for physical memory at " << base << ": " << strerror(errno);
+	}
+
+	LC_DEBUG1(LogMMAP) << "Mapped " << base << " (" << size << " bytes, " << file_size << " from backing file)";
+	return true;
 }
 
-uint32_t MMAPPhysicalMemory::Poke(guest_addr_t addr, uint8_t *data, int size)
+void MMAPPhysicalMemory::ReleaseRange(guest_addr_t base, guest_size_t size)
 {
-	lseek(physmem_fd, addr, SEEK_SET);
-	write(physmem_fd, data, size);
-	fsync(physmem_fd);
-	return 0;
+	// Replace the mapping with part of the reservation again. Anything written
+	// to a shared backing file stays there.
+	mmap(GuestToHost(base), size, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
 }
 
-bool MMAPPhysicalMemory::ResolveGuestAddress(host_const_addr_t host_addr, guest_addr_t &guest_addr)
+bool MMAPPhysicalMemory::AllocateVMA(GuestVMA &vma)
 {
-	return false;
+	if (!MapRange(vma.base, vma.size, vma.protection)) {
+		return false;
+	}
+
+	vma.host_base = GuestToHost(vma.base);
+	mapped_vmas_[vma.base] = &vma;
+	return true;
 }
 
-MMAPVirtualMemory::MMAPVirtualMemory(System& system, MMAPPhysicalMemory& physmem) : system(system), physmem(physmem)
+bool MMAPPhysicalMemory::DeallocateVMA(GuestVMA &vma)
 {
+	ReleaseRange(vma.base, vma.size);
+	mapped_vmas_.erase(vma.base);
+	return true;
 }
 
-MMAPVirtualMemory::~MMAPVirtualMemory()
+bool MMAPPhysicalMemory::ResizeVMA(GuestVMA &vma, guest_size_t new_size)
 {
+	if (new_size > vma.size) {
+		if (!MapRange(vma.base + vma.size, new_size - vma.size, vma.protection)) {
+			return false;
+		}
+	} else if (new_size < vma.size) {
+		ReleaseRange(vma.base + new_size, vma.size - new_size);
+	}
 
+	vma.size = new_size;
+	return true;
 }
 
-static bool HandleMMAPSegFault(void *ctx, const System::segfault_data& data)
+bool MMAPPhysicalMemory::SynchroniseVMAProtection(GuestVMA &vma)
 {
-	MMAPVirtualMemory *vmem = (MMAPVirtualMemory *)ctx;
-	guest_addr_t virt_addr;
-	void *r;
+	return mprotect(vma.host_base, vma.size, ProtFlags(vma.protection)) == 0;
+}
 
-	if (!vmem->ResolveGuestAddress((host_const_addr_t)data.addr, virt_addr))
+bool MMAPPhysicalMemory::SaveSnapshot(const std::string &filename)
+{
+	// The snapshot may replace the file which is backing this memory (or an
+	// earlier snapshot which another process has mapped), so it's written
+	// alongside and moved into place rather than truncating the original
+	std::string temp_filename = filename + ".tmp";
+	int fd = open(temp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		LC_ERROR(LogMMAP) << "Unable to open physical memory snapshot " << filename << ": " << strerror(errno);
 		return false;
+	}
 
-	uint64_t host_page_base = ((uint64_t)data.addr) & ~4095ULL;
-	uint32_t virtual_page_base = ((uint32_t)virt_addr) & ~4095;
-	uint32_t phys_page_base;
+	static const uint8_t zero_page[Address::PageSize] = {0};
+
+	uint64_t file_size = 0;
+	bool success = true;
+	for (auto &entry : mapped_vmas_) {
+		GuestVMA &vma = *entry.second;
+
+		// Memory which can't be read by the guest can't be read by us either
+		if (!(ProtFlags(vma.protection) & PROT_READ)) {
+			mprotect(vma.host_base, vma.size, PROT_READ);
+		}
+
+		for (uint64_t offset = 0; offset < vma.size; offset += Address::PageSize) {
+			const uint8_t *page = (const uint8_t *)vma.host_base + offset;
+			size_t size = Address::PageSize;
+			if (offset + size > vma.size) {
+				size = vma.size - offset;
+			}
+
+			if (memcmp(page, zero_page, size) == 0) {
+				continue;
+			}
+
+			if (pwrite(fd, page, size, vma.base.Get() + offset) != (ssize_t)size) {
+				LC_ERROR(LogMMAP) << "Unable to write physical memory snapshot " << filename << ": " << strerror(errno);
+				success = false;
+				break;
+			}
+		}
+
+		SynchroniseVMAProtection(vma);
+		file_size = std::max<uint64_t>(file_size, vma.base.Get() + vma.size);
+
+		if (!success) {
+			break;
+		}
+	}
 
-	if (vmem->GetMMU().Translate(&vmem->GetCPU(), virtual_page_base, phys_page_base, MMUACCESSINFO(vmem->GetCPU().in_kernel_mode(), !mmap_mem_state.state), false)) {
-		mmap_mem_state.state = false;
-		return true;
+	if (success && ftruncate(fd, file_size) < 0) {
+		LC_ERROR(LogMMAP) << "Unable to size physical memory snapshot " << filename << ": " << strerror(errno);
+		success = false;
 	}
 
-	r = mmap((void *)host_page_base, 4096, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, vmem->GetPhysicalMemory().GetPhysMemFD(), phys_page_base);
-	if (r == MAP_FAILED)
-		return false;
+	close(fd);
+
+	if (success && rename(temp_filename.c_str(), filename.c_str()) < 0) {
+		LC_ERROR(LogMMAP) << "Unable to replace physical memory snapshot " << filename << ": " << strerror(errno);
+		success = false;
+	}
 
-	msync((void *)host_page_base, 4096, MS_SYNC | MS_INVALIDATE);
+	if (!success) {
+		unlink(temp_filename.c_str());
+		return false;
+	}
 
-	mmap_mem_state.state = true;
+	LC_INFO(LogMMAP) << "Saved physical memory snapshot to " << filename;
 	return true;
 }
 
-bool MMAPVirtualMemory::Initialise()
+bool MMAPPhysicalMemory::LockRegion(guest_addr_t guest_addr, guest_size_t guest_size, host_addr_t& host_addr)
 {
-	contiguous_size = 0x100000000;
-	contiguous_base = (uint8_t *)mmap(NULL, contiguous_size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
-	if (contiguous_base == MAP_FAILED)
+	if (!InRange(guest_addr, guest_size)) {
 		return false;
+	}
 
-	system.RegisterSegFaultHandler((uint64_t)contiguous_base, contiguous_size, this, HandleMMAPSegFault);
+	host_addr = GuestToHost(guest_addr);
 	return true;
 }
 
-void MMAPVirtualMemory::Destroy()
+bool MMAPPhysicalMemory::LockRegions(guest_addr_t guest_addr, guest_size_t guest_size, LockedMemoryRegion& regions)
 {
+	if (guest_addr.GetPageOffset() != 0 || !InRange(guest_addr, guest_size)) {
+		return false;
+	}
+
+	std::vector<void *> page_ptrs;
+	for (Address a = guest_addr; a < guest_addr + guest_size; a += Address::PageSize) {
+		page_ptrs.push_back(GuestToHost(a));
+	}
+
+	regions = LockedMemoryRegion(guest_addr, page_ptrs);
+	return true;
 }
 
-MemoryTranslationModel& MMAPVirtualMemory::GetTranslationModel()
+bool MMAPPhysicalMemory::UnlockRegion(guest_addr_t guest_addr, guest_size_t guest_size, host_addr_t host_addr)
 {
-	assert(false);
-	__builtin_unreachable();
+	return true;
 }
 
-bool MMAPVirtualMemory::ResolveGuestAddress(host_const_addr_t host_addr, guest_addr_t& guest_addr)
+uint32_t MMAPPhysicalMemory::Read(guest_addr_t addr, uint8_t *data, int size)
 {
-	if ((uint8_t *)host_addr >= contiguous_base && (uint8_t *)host_addr < contiguous_base + contiguous_size) {
-		guest_addr = (guest_addr_t)((uint8_t *)host_addr - contiguous_base);
-		return true;
+	if (!InRange(addr, size)) {
+		return 1;
 	}
 
-	return false;
+	memcpy(data, GuestToHost(addr), size);
+	return 0;
 }
 
-uint32_t MMAPVirtualMemory::Read(guest_addr_t addr, uint8_t* data, int size)
+uint32_t MMAPPhysicalMemory::Fetch(guest_addr_t addr, uint8_t *data, int size)
 {
-	mmap_mem_state.state = true;
-	memcpy(data, contiguous_base + (uint32_t)addr, size);
-	return !mmap_mem_state.state;
+	return Read(addr, data, size);
 }
 
-uint32_t MMAPVirtualMemory::Write(guest_addr_t addr, uint8_t* data, int size)
+uint32_t MMAPPhysicalMemory::Write(guest_addr_t addr, uint8_t *data, int size)
 {
-	mmap_mem_state.state = false;
-	memcpy(contiguous_base + (uint32_t)addr, data, size);
-	return !mmap_mem_state.state;
-}
+	if (!InRange(addr, size)) {
+		return 1;
+	}
 
-uint32_t MMAPVirtualMemory::Fetch(guest_addr_t addr, uint8_t* data, int size)
-{
-	mmap_mem_state.state = true;
-	memcpy(data, contiguous_base + (uint32_t)addr, size);
-	return !mmap_mem_state.state;
+	memcpy(GuestToHost(addr), data, size);
+	return 0;
 }
 
-uint32_t MMAPVirtualMemory::Peek(guest_addr_t addr, uint8_t* data, int size)
+uint32_t MMAPPhysicalMemory::Peek(guest_addr_t addr, uint8_t *data, int size)
 {
-	mmap_mem_state.state = true;
-	memcpy(data, contiguous_base + (uint32_t)addr, size);
-	return !mmap_mem_state.state;
+	return Read(addr, data, size);
 }
 
-uint32_t MMAPVirtualMemory::Poke(guest_addr_t addr, uint8_t* data, int size)
+uint32_t MMAPPhysicalMemory::Poke(guest_addr_t addr, uint8_t *data, int size)
 {
-	mmap_mem_state.state = false;
-	memcpy(contiguous_base + (uint32_t)addr, data, size);
-	return !mmap_mem_state.state;
+	return Write(addr, data, size);
 }
 
-void MMAPVirtualMemory::FlushCaches()
+bool MMAPPhysicalMemory::ResolveGuestAddress(host_const_addr_t host_addr, guest_addr_t &guest_addr)
 {
-	mprotect(contiguous_base, contiguous_size, PROT_NONE);
-	msync(contiguous_base, contiguous_size, MS_SYNC | MS_INVALIDATE);
-}
+	if ((uintptr_t)host_addr >= (uintptr_t)mem_base_ && (uintptr_t)host_addr < (uintptr_t)mem_base_ + kPhysicalMemorySize) {
+		guest_addr = guest_addr_t((uintptr_t)host_addr - (uintptr_t)mem_base_);
+		return true;
+	}
 
-void MMAPVirtualMemory::EvictCacheEntry(virt_addr_t virt_addr)
-{
-	FlushCaches();
+	return false;
 }
@@ -20,6 +20,9 @@
 #include <asm/prctl.h>
 #include <stdio.h>
 #include <sys/uio.h>
+#include <climits>
+#include <algorithm>
+#include <vector>
 #include <sys/stat.h>
 #include <sys/sysinfo.h>
 #include <unistd.h>
@@ -70,6 +73,100 @@ static unsigned int translate_fd(archsim::core::thread::ThreadInstance* cpu, int
 	return -1;
 }
 
+/*
+ * Resolve a guest buffer to host iovecs, so that host syscalls can work on
+ * guest memory directly. Pages which are also adjacent on the host are
+ * merged. Returns false if the memory model can't provide host pointers for
+ * the buffer, or has to observe every access, in which case the caller
+ * falls back to a bounce buffer.
+ */
+static bool lock_guest_buffer(archsim::core::thread::ThreadInstance *cpu, Address addr, size_t len, std::vector<struct iovec> &iov)
+{
+	auto &mem_model = cpu->GetEmulationModel().GetMemoryModel();
+	if(mem_model.HasEventHandlers()) {
+		return false;
+	}
+
+	uint64_t start = addr.Get(), end = start + len;
+	if(len == 0) {
+		return true;
+	}
+	if(end < start) {
+		return false;
+	}
+
+	uint64_t base = start & ~(uint64_t)(Address::PageSize - 1);
+	uint64_t limit = (end + Address::PageSize - 1) & ~(uint64_t)(Address::PageSize - 1);
+
+	archsim::abi::memory::LockedMemoryRegion region;
+	if(!mem_model.LockRegions(Address(base), limit - base, region)) {
+		return false;
+	}
+
+	for(uint64_t page = base; page < end; page += Address::PageSize) {
+		uint64_t chunk_start = std::max(page, start);
+		size_t bytes = std::min(page + Address::PageSize, end) - chunk_start;
+		uint8_t *ptr = (uint8_t *)region.GetPtr(Address(chunk_start), bytes);
+
+		if(!iov.empty() && (uint8_t *)iov.back().iov_base + iov.back().iov_len == ptr) {
+			iov.back().iov_len += bytes;
+		} else {
+			iov.push_back({ ptr, bytes });
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Perform a host readv or writev over any number of iovecs, IOV_MAX at a
+ * time, stopping early on a short transfer. Returns -errno on failure.
+ */
+static long host_transfer(ssize_t (*transfer)(int, const struct iovec *, int), int fd, const std::vector<struct iovec> &iov)
+{
+	if(iov.empty()) {
+		ssize_t res = transfer(fd, nullptr, 0);
+		return res < 0 ? -errno : res;
+	}
+
+	long total = 0;
+	for(size_t first = 0; first < iov.size(); first += IOV_MAX) {
+		int count = std::min<size_t>(iov.size() - first, IOV_MAX);
+
+		ssize_t res = transfer(fd, &iov[first], count);
+		if(res < 0) {
+			return total > 0 ? total : -errno;
+		}
+		total += res;
+
+		size_t expected = 0;
+		for(int i = 0; i < count; ++i) {
+			expected += iov[first + i].iov_len;
+		}
+		if((size_t)res < expected) {
+			break;
+		}
+	}
+
+	return total;
+}
+
+template<typename guest_iovec> static bool read_guest_iovecs(archsim::core::thread::ThreadInstance *cpu, unsigned long iov_addr, int cnt, std::vector<guest_iovec> &guest_vectors)
+{
+	guest_vectors.resize(cnt);
+	return cpu->GetMemoryInterface(0).Read(Address(iov_addr), (uint8_t *)guest_vectors.data(), cnt * sizeof(guest_iovec)) == archsim::MemoryResult::OK;
+}
+
+template<typename guest_iovec> static bool lock_guest_iovecs(archsim::core::thread::ThreadInstance *cpu, const std::vector<guest_iovec> &guest_vectors, std::vector<struct iovec> &iov)
+{
+	for(const auto &vector : guest_vectors) {
+		if(!lock_guest_buffer(cpu, Address(vector.iov_base), vector.iov_len, iov)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 static unsigned int sys_exit(archsim::core::thread::ThreadInstance* cpu, unsigned int exit_code)
 {
 	cpu->SendMessage(archsim::core::thread::ThreadMessage::Halt);
@@ -271,29 +368,76 @@ static unsigned long sys_close(archsim::core::thread::ThreadInstance* cpu, unsig
 template<typename guest_iovec> static unsigned long sys_writev(archsim::core::thread::ThreadInstance* cpu, unsigned int fd, unsigned long iov_addr, int cnt)
 {
 	LC_DEBUG1(LogSyscalls) << "writev " << fd << " " << Address(iov_addr) << " " << cnt;
-	if (cnt < 0) {
-		return -1;
+	if (cnt < 0 || cnt > IOV_MAX) {
+		return -EINVAL;
+	}
+
+	std::vector<guest_iovec> guest_vectors;
+	if (!read_guest_iovecs(cpu, iov_addr, cnt, guest_vectors)) {
+		return -EFAULT;
 	}
 
-	struct iovec host_vectors[cnt];
-	guest_iovec arm_vectors[cnt];
+	fd = translate_fd(cpu, fd);
 
+	std::vector<struct iovec> host_vectors;
+	if (lock_guest_iovecs(cpu, guest_vectors, host_vectors)) {
+		return host_transfer(::writev, fd, host_vectors);
+	}
+
+	// Fall back to copying each vector out of guest memory
 	auto interface = cpu->GetMemoryInterface(0);
-	interface.Read(Address(iov_addr), (uint8_t *)&arm_vectors, cnt * sizeof(guest_iovec));
+	std::vector<std::vector<char>> buffers (cnt);
 
+	host_vectors.resize(cnt);
 	for (int i = 0; i < cnt; i++) {
-		host_vectors[i].iov_base = new char[arm_vectors[i].iov_len];
-		host_vectors[i].iov_len = arm_vectors[i].iov_len;
-		interface.Read(Address(arm_vectors[i].iov_base), (uint8_t *)host_vectors[i].iov_base, arm_vectors[i].iov_len);
+		buffers[i].resize(guest_vectors[i].iov_len);
+		interface.Read(Address(guest_vectors[i].iov_base), (uint8_t *)buffers[i].data(), guest_vectors[i].iov_len);
+
+		host_vectors[i].iov_base = buffers[i].data();
+		host_vectors[i].iov_len = guest_vectors[i].iov_len;
+	}
+
+	return host_transfer(::writev, fd, host_vectors);
+}
+
+template<typename guest_iovec> static unsigned long sys_readv(archsim::core::thread::ThreadInstance* cpu, unsigned int fd, unsigned long iov_addr, int cnt)
+{
+	LC_DEBUG1(LogSyscalls) << "readv " << fd << " " << Address(iov_addr) << " " << cnt;
+	if (cnt < 0 || cnt > IOV_MAX) {
+		return -EINVAL;
+	}
+
+	std::vector<guest_iovec> guest_vectors;
+	if (!read_guest_iovecs(cpu, iov_addr, cnt, guest_vectors)) {
+		return -EFAULT;
+	}
+
+	fd = translate_fd(cpu, fd);
+
+	std::vector<struct iovec> host_vectors;
+	if (lock_guest_iovecs(cpu, guest_vectors, host_vectors)) {
+		return host_transfer(::readv, fd, host_vectors);
 	}
 
-	fd = cpu->GetEmulationModel().GetSystem().GetFD(fd);
-	fsync(fd);  // HACK?
-	unsigned int res = (uint32_t)writev(fd, host_vectors, cnt);
-	fsync(fd);  // HACK?
+	// Fall back to reading into host buffers, and copying as much as was
+	// read into each guest vector
+	auto interface = cpu->GetMemoryInterface(0);
+	std::vector<std::vector<char>> buffers (cnt);
 
+	host_vectors.resize(cnt);
 	for (int i = 0; i < cnt; i++) {
-		delete[](char*)host_vectors[i].iov_base;
+		buffers[i].resize(guest_vectors[i].iov_len);
+		host_vectors[i].iov_base = buffers[i].data();
+		host_vectors[i].iov_len = guest_vectors[i].iov_len;
+	}
+
+	long res = host_transfer(::readv, fd, host_vectors);
+
+	size_t remaining = res > 0 ? res : 0;
+	for (int i = 0; i < cnt && remaining > 0; i++) {
+		size_t bytes = std::min<size_t>(remaining, guest_vectors[i].iov_len);
+		interface.Write(Address(guest_vectors[i].iov_base), (uint8_t *)buffers[i].data(), bytes);
+		remaining -= bytes;
 	}
 
 	return res;
@@ -464,20 +608,22 @@ static unsigned long sys_mprotect(archsim::core::thread::ThreadInstance *cpu, un
 
 static unsigned long sys_read(archsim::core::thread::ThreadInstance* cpu, unsigned int fd, unsigned long addr, unsigned int len)
 {
-	char* rd_buf = new char[len];
-	ssize_t res;
-
 	fd = translate_fd(cpu, fd);
-	res = read(fd, (void*)rd_buf, len);
+
+	std::vector<struct iovec> iov;
+	if (lock_guest_buffer(cpu, Address(addr), len, iov)) {
+		return host_transfer(::readv, fd, iov);
+	}
+
+	std::vector<char> rd_buf (len);
+	ssize_t res = read(fd, (void*)rd_buf.data(), len);
 
 	auto interface = cpu->GetMemoryInterface(0);
 
 	if (res > 0) {
-		interface.Write(Address(addr), (uint8_t *)rd_buf, res);
+		interface.Write(Address(addr), (uint8_t *)rd_buf.data(), res);
 	}
 
-	delete[] rd_buf;
-
 	if (res < 0)
 		return -errno;
 	else
@@ -495,20 +641,21 @@ static unsigned long sys_write(archsim::core::thread::ThreadInstance* cpu, unsig
 		return -EINVAL;
 	}
 
-	char *buffer = (char *)malloc(len);
-	bzero(buffer, len);
+	fd = translate_fd(cpu, fd);
 
-	auto interface = cpu->GetMemoryInterface(0);
-	if (interface.Read(Address(addr), (uint8_t *)buffer, len) != archsim::MemoryResult::OK) {
-		free(buffer);
-		return -EFAULT;
+	std::vector<struct iovec> iov;
+	if (lock_guest_buffer(cpu, Address(addr), len, iov)) {
+		return host_transfer(::writev, fd, iov);
 	}
 
-	fd = translate_fd(cpu, fd);
-	res = write(fd, buffer, len);
-	free(buffer);
+	std::vector<char> buffer (len);
 
+	auto interface = cpu->GetMemoryInterface(0);
+	if (interface.Read(Address(addr), (uint8_t *)buffer.data(), len) != archsim::MemoryResult::OK) {
+		return -EFAULT;
+	}
 
+	res = write(fd, buffer.data(), len);
 
 	if (res < 0) {
 		res = -errno;
@@ -1527,6 +1674,7 @@ DEFINE_SYSCALL(arm, __NR_arm_unlink, sys_unlink, "unlink(path=%p)");
 DEFINE_SYSCALL(arm, __NR_arm_dup, sys_dup, "dup(oldfd=%d)");
 
 DEFINE_SYSCALL(arm, __NR_arm_uname, sys_uname, "uname(addr=%p)");
+DEFINE_SYSCALL(arm, __NR_arm_readv, sys_readv<struct arm_iovec>, "readv()");
 DEFINE_SYSCALL(arm, __NR_arm_writev, sys_writev<struct arm_iovec>, "writev()");
 DEFINE_SYSCALL(arm, __NR_arm_mmap, sys_mmap, "mmap()");
 DEFINE_SYSCALL(arm, __NR_arm_mmap2, sys_mmap2, "mmap2(addr=%p, size=%u, prot=%d, flags=%d, fd=%d, pgoff=%u)");
@@ -1581,6 +1729,7 @@ DEFINE_SYSCALL(x86, 11, syscall_return_zero, "munmap()");
 DEFINE_SYSCALL(x86, 12, sys_brk, "brk()");
 DEFINE_SYSCALL(x86, 13, syscall_return_zero, "rt_sigaction()");
 DEFINE_SYSCALL(x86, 16, sys_ioctl, "ioctl()");
+DEFINE_SYSCALL(x86, 19, sys_readv<struct x86_iovec>, "readv[x86]()");
 DEFINE_SYSCALL(x86, 20, sys_writev<struct x86_iovec>, "writev[x86]()");
 DEFINE_SYSCALL(x86, 21, sys_access, "access()");
 DEFINE_SYSCALL(x86, 25, syscall_return_enosys, "mremap()");
@@ -1622,6 +1771,7 @@ DEFINE_SYSCALL(aarch64, 4, sys_write, "write()");
 DEFINE_SYSCALL(aarch64, 29, sys_ioctl, "ioctl()");
 DEFINE_SYSCALL(aarch64, 56, sys_openat, "openat()");
 DEFINE_SYSCALL(aarch64, 64, sys_write, "write(%u, %lu, %u)");
+DEFINE_SYSCALL(aarch64, 65, sys_readv<struct x86_iovec>, "readv()");
 DEFINE_SYSCALL(aarch64, 66, sys_writev<struct x86_iovec>, "writev()");
 DEFINE_SYSCALL(aarch64, 78, sys_readlinkat, "readlinkat()");
 DEFINE_SYSCALL(aarch64, 80, sys64_fstat, "fstat()");
@@ -1643,6 +1793,7 @@ DEFINE_SYSCALL(riscv, 61, sys_getdents64, "getdents64()");
 DEFINE_SYSCALL(riscv, 62, sys_lseek, "lseek()");
 DEFINE_SYSCALL(riscv, 63, sys_read, "read()");
 DEFINE_SYSCALL(riscv, 64, sys_write, "write(fd=%d, addr=%p, len=%d)");
+DEFINE_SYSCALL(riscv, 65, sys_readv<struct x86_iovec>, "readv");
 DEFINE_SYSCALL(riscv, 66, sys_writev<struct x86_iovec>, "writev");
 DEFINE_SYSCALL(riscv, 78, syscall_return_enosys, "readlinkat(dirfd=%d, pathname=%p, buf=%p, bufsiz=%u)");
 DEFINE_SYSCALL(riscv, 79, sys_newfstatat<riscv32_stat>, "fstatat()");
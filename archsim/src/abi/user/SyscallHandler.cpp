@@ -8,6 +8,8 @@
 
 #include "util/LogContext.h"
 
+#include <chrono>
+
 using namespace archsim::abi::user;
 
 UseLogContext(LogEmulationModelUser);
@@ -74,7 +76,13 @@ bool SyscallHandler::HandleSyscall(SyscallRequest& request, SyscallResponse& res
 		sprintf(buffer, syscall_fn_names.at(request.syscall).c_str(), request.arg0, request.arg1, request.arg2, request.arg3, request.arg4, request.arg5);
 		LC_DEBUG1(LogSyscalls) << "Handling registered syscall " << buffer;
 
+		auto start = std::chrono::steady_clock::now();
 		response.result = (syscall->second)(request.thread, request.arg0, request.arg1, request.arg2, request.arg3, request.arg4, request.arg5);
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+		auto &metrics = request.thread->GetMetrics();
+		metrics.SyscallCounts.inc(request.syscall);
+		metrics.SyscallTime.inc(request.syscall, elapsed.count());
 
 		LC_DEBUG1(LogSyscalls) << "Syscall returned " << format_rval(response.result);
 		return true;
@@ -54,8 +54,7 @@ namespace archsim
 				{
 					if(category == 3) {
 						// emulate system call
-						auto bank = thread->GetRegisterFileInterface().GetEntry<uint64_t>("RBX");
-						uint64_t* registers = (uint64_t*)bank;
+						uint64_t* registers = thread->GetRegisterFileInterface().GetEntry(registers_);
 
 						archsim::abi::SyscallRequest request {0, thread, 0, 0, 0, 0, 0, 0};
 
@@ -91,6 +90,7 @@ namespace archsim
 					}
 
 					GetMainThread()->GetFeatures().SetFeatureLevel("EMULATE_LINUX_ARCHSIM", 1);
+					registers_ = GetMainThread()->GetArch().GetRegisterFileDescriptor().GetEntryHandle<uint64_t>("RBX");
 
 					auto tpid_coprocessor = new archsim::abi::devices::aarch64::core::AArch64Coprocessor();
 					GetMainThread()->GetPeripherals().RegisterDevice("TPID", tpid_coprocessor);
@@ -103,6 +103,9 @@ namespace archsim
 				{
 					UNIMPLEMENTED;
 				}
+
+			private:
+				archsim::RegisterFileEntryHandle<uint64_t> registers_;
 			};
 
 		}
@@ -4,11 +4,12 @@
 #include "blockjit/IRBuilder.h"
 #include "gensim/gensim_decode.h"
 #include "util/ComponentManager.h"
+#include "core/arch/ArchDescriptor.h"
 #include "core/thread/ThreadInstance.h"
 
 using namespace archsim::arch::arm;
 
-ARMDecodeContext::ARMDecodeContext(const archsim::ArchDescriptor &arch) : arch_(arch), itstate_(0)
+ARMDecodeContext::ARMDecodeContext(const archsim::ArchDescriptor &arch) : arch_(arch), itstate_(0), itstate_entry_(arch.GetRegisterFileDescriptor().GetEntryHandle<uint8_t>("ITSTATE"))
 {
 
 }
@@ -20,12 +21,12 @@ ARMDecodeContext::~ARMDecodeContext()
 
 void ARMDecodeContext::Reset(archsim::core::thread::ThreadInstance* thread)
 {
-	itstate_ = *thread->GetRegisterFileInterface().GetEntry<uint8_t>("ITSTATE");
+	itstate_ = *thread->GetRegisterFileInterface().GetEntry(itstate_entry_);
 }
 
 void ARMDecodeContext::WriteBackState(archsim::core::thread::ThreadInstance* thread)
 {
-	*thread->GetRegisterFileInterface().GetEntry<uint8_t>("ITSTATE") = itstate_;
+	*thread->GetRegisterFileInterface().GetEntry(itstate_entry_) = itstate_;
 }
 
 uint32_t ARMDecodeContext::DecodeSync(archsim::MemoryInterface &interface, Address address, uint32_t mode, gensim::BaseDecode *&target)
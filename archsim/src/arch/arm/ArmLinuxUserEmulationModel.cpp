@@ -59,6 +59,8 @@ bool ArmLinuxUserEmulationModel::PrepareBoot(System& system)
 
 	*GetMainThread()->GetRegisterFileInterface().GetEntry<uint32_t>("FPEXC") = 0x40000000;
 
+	registers_ = GetMainThread()->GetArch().GetRegisterFileDescriptor().GetEntryHandle<uint32_t>("RB");
+
 #ifdef CONFIG_GFX
 	if (archsim::options::Doom) {
 		fprintf(stderr, "Installing doomvice\n");
@@ -171,8 +173,7 @@ bool ArmLinuxUserEmulationModel::InstallKernelHelpers()
 archsim::abi::ExceptionAction ArmLinuxUserEmulationModel::HandleException(archsim::core::thread::ThreadInstance* thread, uint64_t category, uint64_t data)
 {
 	if (category == 3) {
-		auto bank = thread->GetRegisterFileInterface().GetEntry<uint32_t>("RB");
-		uint32_t* registers = (uint32_t*)bank;
+		uint32_t* registers = thread->GetRegisterFileInterface().GetEntry(registers_);
 
 		archsim::abi::SyscallRequest request {0, thread, 0, 0, 0, 0, 0, 0};
 		if(IsOABI()) {
@@ -38,7 +38,7 @@ RegisterComponent(EmulationModel, ArmRealviewEmulationModel, "arm-realview", "AR
 UseLogContext(LogSystemEmulationModel);
 DeclareChildLogContext(LogArmSystemEmulationModel, LogSystemEmulationModel, "ARM");
 
-ArmRealviewEmulationModel::ArmRealviewEmulationModel() : LinuxSystemEmulationModel(false), entry_point(0)
+ArmRealviewEmulationModel::ArmRealviewEmulationModel() : LinuxSystemEmulationModel(false), entry_point(0), take_exception_(nullptr), take_interrupt_(nullptr)
 {
 
 }
@@ -56,7 +56,12 @@ bool ArmRealviewEmulationModel::Initialise(System& system, uarch::uArch& uarch)
 	if (GetMemoryModel().GetMappingManager())
 		GetMemoryModel().GetMappingManager()->MapAll((archsim::abi::memory::RegionFlags)7);
 
-	InstantiateThreads(1);
+	if (!InstantiateThreads(1))
+		return false;
+
+	// Every core shares one architecture, so the handles only need to be
+	// resolved once, before any core can run (or be restored from a checkpoint)
+	ResolveArchHandles(GetThread(0).GetArch());
 
 	CreateMemoryDevices();
 
@@ -393,7 +398,7 @@ ExceptionAction ArmRealviewEmulationModel::HandleException(archsim::core::thread
 
 	// update ITSTATE if we have a SWI
 	if(category == 3) {
-		auto *itstate_ptr = cpu->GetRegisterFileInterface().GetEntry<uint8_t>("ITSTATE");
+		auto *itstate_ptr = cpu->GetRegisterFileInterface().GetEntry(itstate_entry_);
 		uint8_t itstate = *itstate_ptr;
 		if(itstate) {
 			uint8_t cond = itstate & 0xe0;
@@ -407,8 +412,7 @@ ExceptionAction ArmRealviewEmulationModel::HandleException(archsim::core::thread
 		}
 	}
 
-	auto &behaviour = cpu->GetArch().GetISA("arm").GetBehaviours().GetBehaviour("take_arm_exception");
-	behaviour.Invoke(cpu, {category, data});
+	take_exception_->Invoke(cpu, {category, data});
 
 	return archsim::abi::AbortInstruction;
 }
@@ -424,8 +428,14 @@ archsim::abi::ExceptionAction ArmRealviewEmulationModel::HandleMemoryFault(archs
 
 void ArmRealviewEmulationModel::HandleInterrupt(archsim::core::thread::ThreadInstance *thread, CPUIRQLine *irq)
 {
-	auto &behaviour = thread->GetArch().GetISA("arm").GetBehaviours().GetBehaviour("take_interrupt");
-	behaviour.Invoke(thread, {irq->Line()});
+	take_interrupt_->Invoke(thread, {irq->Line()});
+}
+
+void ArmRealviewEmulationModel::ResolveArchHandles(const archsim::ArchDescriptor& arch)
+{
+	take_exception_ = &arch.GetISA("arm").GetBehaviours().GetBehaviour("take_arm_exception");
+	take_interrupt_ = &arch.GetISA("arm").GetBehaviours().GetBehaviour("take_interrupt");
+	itstate_entry_ = arch.GetRegisterFileDescriptor().GetEntryHandle<uint8_t>("ITSTATE");
 }
 
 gensim::DecodeContext* ArmRealviewEmulationModel::GetNewDecodeContext(archsim::core::thread::ThreadInstance& cpu)
@@ -132,6 +132,23 @@ void RiscVMMU::SetSATP(uint64_t new_satp)
 }
 
 
+void RiscVMMU::SaveState(archsim::util::CheckpointWriter& writer)
+{
+	MMU::SaveState(writer);
+	writer.Write(GetSATP());
+}
+
+bool RiscVMMU::RestoreState(archsim::util::CheckpointReader& reader)
+{
+	uint64_t satp;
+	if(!MMU::RestoreState(reader) || !reader.Read(satp)) {
+		return false;
+	}
+
+	SetSATP(satp);
+	return true;
+}
+
 int RiscVMMU::GetPTLevels(Mode mode) const
 {
 	switch(mode) {
@@ -47,6 +47,51 @@ bool RiscVSystemCoprocessor::Initialise()
 	return true;
 }
 
+void RiscVSystemCoprocessor::SaveState(archsim::util::CheckpointWriter& writer)
+{
+	BitLockGuard guard(lock_);
+
+	uint64_t csrs[] = {
+		MTVEC, MSCRATCH, MEPC, MCAUSE, MTVAL, MIDELEG, MEDELEG, SIDELEG, SEDELEG,
+		STVEC, SSCRATCH, SEPC, SCAUSE, STVAL, MCOUNTEREN, SCOUNTEREN,
+		STATUS.ReadMSTATUS(), IP.ReadMIP(), IE.ReadMIE()
+	};
+	writer.Write(csrs);
+}
+
+bool RiscVSystemCoprocessor::RestoreState(archsim::util::CheckpointReader& reader)
+{
+	BitLockGuard guard(lock_);
+
+	uint64_t csrs[19];
+	if(!reader.Read(csrs)) {
+		return false;
+	}
+
+	uint64_t *csr = csrs;
+	for(uint64_t *reg : {
+	            &MTVEC, &MSCRATCH, &MEPC, &MCAUSE, &MTVAL, &MIDELEG, &MEDELEG, &SIDELEG, &SEDELEG,
+	            &STVEC, &SSCRATCH, &SEPC, &SCAUSE, &STVAL, &MCOUNTEREN, &SCOUNTEREN
+	        }) {
+		*reg = *csr++;
+	}
+
+	STATUS.WriteMSTATUS(*csr++);
+	IP.Reset();
+	IP.PendMask(*csr++);
+	IE.WriteMIE(*csr++);
+
+	// None of the hart's interrupt lines are asserted yet
+	true_pending_interrupts_ = 0;
+	return true;
+}
+
+void RiscVSystemCoprocessor::StateRestored()
+{
+	BitLockGuard guard(lock_);
+	CheckForInterrupts();
+}
+
 bool RiscVSystemCoprocessor::Read64(uint32_t address, uint64_t& data)
 {
 	LC_DEBUG2(LogRiscVSystem) << "CSR Read 0x" << std::hex << address << "...";
@@ -192,6 +237,7 @@ bool RiscVSystemCoprocessor::Read64(uint32_t address, uint64_t& data)
 
 		case 0xc01:
 			// real time
+			hart_->GetEmulationModel().GetSystem().GetTickSource()->Synchronise();
 			data = hart_->GetEmulationModel().GetSystem().GetTickSource()->GetCounter() * 1000;
 			LC_DEBUG1(LogRiscVSystem) << "Reading TIME register at PC " << hart_->GetPC() << " -> " << data;
 			break;
@@ -567,7 +613,14 @@ void RiscVSystemCoprocessor::STATUS_t::WriteMSTATUS(uint64_t data)
 	MPRV = new_MPRV;
 	XS = UNSIGNED_BITS_64(data, 16,15);
 	FS = UNSIGNED_BITS_64(data, 14,13);
-	MPP = UNSIGNED_BITS_64(data, 12,11);
+
+	// With MPRV set, machine mode loads and stores are translated as if in
+	// the MPP mode
+	uint8_t new_MPP = UNSIGNED_BITS_64(data, 12,11);
+	if(MPRV && new_MPP != MPP) {
+		should_flush_tlb = true;
+	}
+	MPP = new_MPP;
 	SPP = BITSEL(data, 8);
 	MPIE = BITSEL(data, 7);
 	SPIE = BITSEL(data, 5);
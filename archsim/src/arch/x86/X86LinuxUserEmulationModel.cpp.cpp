@@ -58,6 +58,8 @@ bool X86LinuxUserEmulationModel::PrepareBoot(System& system)
 		return false;
 	}
 
+	registers_ = GetMainThread()->GetArch().GetRegisterFileDescriptor().GetEntryHandle<uint64_t>("RQ");
+
 	LC_DEBUG1(LogEmulationModelX86Linux) << "Initialising X86 Kernel Helpers";
 
 	memory::guest_addr_t kernel_helper_region = 0xffff0000_ga;
@@ -102,7 +104,7 @@ archsim::abi::ExceptionAction X86LinuxUserEmulationModel::HandleException(archsi
 		GetSystem().GetPubSub().Publish(PubSubType::L1ICacheFlush, (void*)(uint64_t)0);
 		return archsim::abi::ResumeNext;
 	}
-	uint64_t* registers = (uint64_t*)cpu->GetRegisterFileInterface().GetEntry<uint64_t>("RQ");
+	uint64_t* registers = cpu->GetRegisterFileInterface().GetEntry(registers_);
 
 	if(category == 0) {
 		LC_DEBUG1(LogEmulationModelX86Linux) << "Syscall at " << Address(cpu->GetPC());
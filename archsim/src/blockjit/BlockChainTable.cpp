@@ -0,0 +1,107 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "blockjit/BlockChainTable.h"
+#include "util/LogContext.h"
+
+UseLogContext(LogBlockProfile);
+
+using namespace archsim::blockjit;
+
+void BlockChainTable::patch(chain_site_t site, int32_t displacement)
+{
+	// Sites are emitted 4-byte aligned, so this store cannot be torn by a
+	// concurrently executing thread.
+	__atomic_store_n((int32_t*)site, displacement, __ATOMIC_RELEASE);
+}
+
+bool BlockChainTable::Link(chain_site_t site, block_txln_fn target, Address phys_page)
+{
+	int64_t displacement = (int64_t)target - (int64_t)(site + 4);
+	if(displacement != (int32_t)displacement) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> l(lock_);
+
+	patch(site, displacement);
+
+	sites_[site] = { target, phys_page.GetPageBase() };
+	sites_by_target_[target].push_back(site);
+	sites_by_page_[phys_page.GetPageBase()].push_back(site);
+
+	LC_DEBUG2(LogBlockProfile) << "Linked chain site " << (void*)site << " to " << (void*)target;
+	return true;
+}
+
+void BlockChainTable::unlink(chain_site_t site)
+{
+	patch(site, 0);
+	sites_.erase(site);
+}
+
+void BlockChainTable::unlinkTarget(block_txln_fn target)
+{
+	auto incoming = sites_by_target_.find(target);
+	if(incoming == sites_by_target_.end()) {
+		return;
+	}
+
+	for(auto site : incoming->second) {
+		auto link = sites_.find(site);
+		if(link != sites_.end() && link->second.target == target) {
+			unlink(site);
+		}
+	}
+	sites_by_target_.erase(incoming);
+}
+
+void BlockChainTable::Release(block_txln_fn fn, size_t size)
+{
+	std::lock_guard<std::mutex> l(lock_);
+
+	// The code containing these sites is going away, so there is nothing to
+	// unpatch. Stale entries in the index maps are filtered out when used.
+	auto begin = (chain_site_t)fn;
+	sites_.erase(sites_.lower_bound(begin), sites_.lower_bound(begin + size));
+
+	unlinkTarget(fn);
+}
+
+void BlockChainTable::UnlinkTarget(block_txln_fn target)
+{
+	std::lock_guard<std::mutex> l(lock_);
+	unlinkTarget(target);
+}
+
+void BlockChainTable::UnlinkPage(Address phys_addr)
+{
+	std::lock_guard<std::mutex> l(lock_);
+
+	auto page = sites_by_page_.find(phys_addr.GetPageBase());
+	if(page == sites_by_page_.end()) {
+		return;
+	}
+
+	LC_DEBUG1(LogBlockProfile) << "Unlinking chains into page " << std::hex << phys_addr.GetPageBase();
+
+	for(auto site : page->second) {
+		auto link = sites_.find(site);
+		if(link != sites_.end() && link->second.page == page->first) {
+			unlink(site);
+		}
+	}
+	sites_by_page_.erase(page);
+}
+
+void BlockChainTable::UnlinkAll()
+{
+	std::lock_guard<std::mutex> l(lock_);
+
+	for(auto &link : sites_) {
+		patch(link.first, 0);
+	}
+
+	sites_.clear();
+	sites_by_target_.clear();
+	sites_by_page_.clear();
+}
@@ -40,7 +40,7 @@ using namespace captive::shared;
 
 using archsim::Address;
 
-BaseBlockJITTranslate::BaseBlockJITTranslate() : _supportChaining(!archsim::options::JitDisableBranchOpt), _supportProfiling(false), _txln_mgr(NULL), _jumpinfo(NULL), _decode(NULL), _should_be_dumped(false), decode_txlt_ctx(nullptr)
+BaseBlockJITTranslate::BaseBlockJITTranslate() : _supportChaining(!archsim::options::JitDisableBranchOpt), _supportProfiling(false), _block_counter(nullptr), _txln_mgr(NULL), _jumpinfo(NULL), _decode(NULL), _should_be_dumped(false), decode_txlt_ctx(nullptr)
 {
 
 }
@@ -111,6 +111,22 @@ void BaseBlockJITTranslate::setSupportProfiling(bool enable)
 {
 	_supportProfiling = enable;
 }
+
+void BaseBlockJITTranslate::setBlockCounter(uint64_t *counter)
+{
+	_block_counter = counter;
+}
+bool BaseBlockJITTranslate::CanPersistTranslations(archsim::core::thread::ThreadInstance *cpu) const
+{
+	// Each of these embeds pointers to host data (or instrumentation which
+	// the next run might not want)
+	if(_block_counter != nullptr || cpu->GetTraceSource() != nullptr) {
+		return false;
+	}
+
+	return !archsim::options::Verbose && !archsim::options::InstructionTick && !archsim::options::Profile && !archsim::options::ProfilePcFreq && !archsim::options::ProfileIrFreq;
+}
+
 void BaseBlockJITTranslate::setTranslationMgr(archsim::translate::TranslationManager *txln_mgr)
 {
 	_txln_mgr = txln_mgr;
@@ -203,6 +219,11 @@ bool BaseBlockJITTranslate::build_block(archsim::core::thread::ThreadInstance *p
 	if(!_decode)_decode = processor->GetArch().GetISA(processor->GetModeID()).GetNewDecode();
 	if(!_jumpinfo)_jumpinfo = processor->GetArch().GetISA(processor->GetModeID()).GetNewJumpInfo();
 	std::unordered_set<Address> block_heads;
+
+	if(_block_counter != nullptr) {
+		builder.count(IROperand::const64((uint64_t)_block_counter), IROperand::const64(1));
+	}
+
 	return emit_block(processor, block_address, builder, block_heads);
 }
 
@@ -232,10 +253,6 @@ bool BaseBlockJITTranslate::emit_instruction_decoded(archsim::core::thread::Thre
 		builder.count(IROperand::const64((uint64_t)processor->GetMetrics().JITInstructionCount.get_ptr()), IROperand::const64(1));
 	}
 
-	if(archsim::options::InstructionTick) {
-		builder.call(IROperand::func((void*)cpuInstructionTick), IROperand::const64((uint64_t)(void*)processor));
-	}
-
 	if(archsim::options::Profile) {
 		builder.count(IROperand::const64((uint64_t)processor->GetMetrics().OpcodeHistogram.get_value_ptr_at_index(decode->Instr_Code)), IROperand::const64(1));
 	}
@@ -357,6 +374,7 @@ bool BaseBlockJITTranslate::emit_block(archsim::core::thread::ThreadInstance *pr
 				Address target = get_jump_target(processor, _decode, pc);
 				if(!block_heads.count(target)) {
 					block_heads.insert(target);
+					emit_instruction_tick(count, builder);
 //					if(archsim::options::Verify && archsim::options::VerifyBlocks) builder.verify(IROperand::pc(pc.Get()));
 					return emit_block(processor, target, builder, block_heads);
 				}
@@ -370,81 +388,72 @@ bool BaseBlockJITTranslate::emit_block(archsim::core::thread::ThreadInstance *pr
 
 //	if(archsim::options::Verify && archsim::options::VerifyBlocks) builder.verify(IROperand::pc(pc.Get()));
 
+	emit_instruction_tick(count, builder);
+
 	// attempt to chain (otherwise return)
 	emit_chain(processor, pc, _decode, builder);
 
 	return success;
 }
 
-bool BaseBlockJITTranslate::emit_chain(archsim::core::thread::ThreadInstance *processor, archsim::Address pc, gensim::BaseDecode *decode, captive::shared::IRBuilder &builder)
+void BaseBlockJITTranslate::emit_instruction_tick(uint32_t count, captive::shared::IRBuilder &builder)
 {
-	// If this instruction is an end of block (rather than the start of the next page)
-	// then we might be able to chain
+	// The virtual clock is advanced once per block rather than once per
+	// instruction. It only forces the block to exit (by raising an
+	// interrupt) when a timer deadline has been reached.
+	if(archsim::options::InstructionTick && count > 0) {
+		builder.call(IROperand::const32(0), IROperand::func((void*)cpuInstructionTick), IROperand::const32(count));
+	}
+}
 
+bool BaseBlockJITTranslate::emit_chain(archsim::core::thread::ThreadInstance *processor, archsim::Address pc, gensim::BaseDecode *decode, captive::shared::IRBuilder &builder)
+{
 	// First, figure out if we should try to chain. We should only try to chain
-	// if we are at the end of a block, if chaining is enabled, and if the
-	// context is valid (isa mode and features).)
-	if(decode->GetEndOfBlock() && _supportChaining && _isa_mode_valid && _features_valid) {
-		Address target_pc = 0_ga, fallthrough_pc = 0_ga;
-
-		JumpInfo jump_info;
-		// TODO: change target_pc_naked to actually be an Address instead of a uint32
-		_jumpinfo->GetJumpInfo(decode, pc, jump_info);
-		fallthrough_pc = pc + decode->Instr_Length;
-
-		// Can only chain on a direct jump
-		if(!jump_info.IsIndirect) {
-			auto target_page = jump_info.JumpTarget.GetPageBase();
-			auto fallthrough_page = fallthrough_pc.GetPageBase();
-
-			// Can only chain if the target of the jump is on the same page as the rest of the block
-			if(target_page == pc.GetPageBase()) {
-				// If instruction is not predicated, don't use a fallthrough pc
-				// XXX ARM HAX
-				if(!decode->GetIsPredicated()) {
-					fallthrough_pc = 0_ga;
-				}
-
-				//need to translate target and fallthrough PCs
+	// if chaining is enabled, and if the context is valid (isa mode and
+	// features), since the successor will be looked up without them.
+	if(!_supportChaining || !_isa_mode_valid || !_features_valid) {
+		builder.ret();
+		return true;
+	}
 
-				Address target_ppc(0), fallthrough_ppc(0);
-				if(target_pc != Address::NullPtr) processor->GetFetchMI().PerformTranslation(target_pc, target_ppc, false, true, false);
-				if(fallthrough_pc != Address::NullPtr) processor->GetFetchMI().PerformTranslation(fallthrough_pc, fallthrough_ppc, false, true, false);
+	// Static successors on the same page as this block get a patchable direct
+	// jump. Anything else (indirect jumps, cross page jumps) is resolved at
+	// run time through the block cache.
+	Address target_pc = 0_ga, fallthrough_pc = pc;
 
-				archsim::blockjit::BlockTranslation target_fn;
-				archsim::blockjit::BlockTranslation fallthrough_fn;
+	// If the block ended on a jump, then pc is the address of the jump rather
+	// than of the next instruction.
+	if(decode->GetEndOfBlock()) {
+		fallthrough_pc = pc + decode->Instr_Length;
 
-				block_txln_fn target_fn_ptr = nullptr, fallthrough_fn_ptr = nullptr;
+		JumpInfo jump_info;
+		_jumpinfo->GetJumpInfo(decode, pc, jump_info);
 
-				if(target_ppc.Get() != 0) {
-//					processor->GetTranslatedBlock(target_ppc, GetProcessorFeatures(), target_fn);
-				}
-				if(fallthrough_ppc.Get() != 0) {
-//					processor->GetTranslatedBlock(fallthrough_ppc, GetProcessorFeatures(), fallthrough_fn);
-				}
+		if(jump_info.IsJump && !jump_info.IsIndirect) {
+			target_pc = jump_info.JumpTarget;
+		}
 
-				// actually get functions
-				if(fallthrough_fn.IsValid(GetProcessorFeatures())) {
-					fallthrough_fn_ptr = fallthrough_fn.GetFn();
-				}
+		// If instruction is not predicated, don't use a fallthrough pc
+		// XXX ARM HAX
+		if(!decode->GetIsPredicated() && !jump_info.IsConditional) {
+			fallthrough_pc = 0_ga;
+		}
+	}
 
-				if(target_fn.IsValid(GetProcessorFeatures())) {
-					target_fn_ptr = target_fn.GetFn();
-				}
+	if(target_pc.GetPageBase() != pc.GetPageBase()) {
+		target_pc = 0_ga;
+	}
+	if(fallthrough_pc.GetPageBase() != pc.GetPageBase()) {
+		fallthrough_pc = 0_ga;
+	}
 
-				if(fallthrough_fn_ptr != nullptr || target_fn_ptr != nullptr) {
-					builder.dispatch(IROperand::const32(target_pc.Get()), IROperand::const32(fallthrough_pc.Get()), IROperand::const64((uint64_t)target_fn_ptr), IROperand::const64((uint64_t)fallthrough_fn_ptr));
-					return true;
-				}
-			} else {
-//				fprintf(stderr, "*** Couldn't chain due to cross page jump\n");
-			}
-		} else {
-//			fprintf(stderr, "*** Couldn't chain due to indirect jump\n");
-		}
+	uint64_t chained_counter = 0, unchained_counter = 0;
+	if(archsim::options::Verbose) {
+		chained_counter = (uint64_t)processor->GetMetrics().JITSuccessfulChains.get_ptr();
+		unchained_counter = (uint64_t)processor->GetMetrics().JITFailedChains.get_ptr();
 	}
-	// If we couldn't find any way to chain, then just return
-	builder.ret();
+
+	builder.dispatch(IROperand::const64(target_pc.Get()), IROperand::const64(fallthrough_pc.Get()), IROperand::const64(chained_counter), IROperand::const64(unchained_counter));
 	return true;
 }
 
@@ -487,6 +496,10 @@ bool BaseBlockJITTranslate::compile_block(archsim::core::thread::ThreadInstance
 		pmap.Release();
 	}
 
+	if(archsim::options::JitSaveTranslations && lowering.PositionIndependent && CanPersistTranslations(cpu)) {
+		fn.SetRelocations(lowering.HostRelocations);
+	}
+
 	fn.SetSize(lowering.Size);
 	return lowering.Size != 0;
 }
@@ -39,10 +39,13 @@ void BlockTranslation::Dump(const std::string &filename)
 }
 
 
-BlockPageProfile::BlockPageProfile(wulib::MemAllocator &allocator) : _allocator(allocator)
+BlockPageProfile::BlockPageProfile(wulib::MemAllocator &allocator, BlockChainTable *chains) : _allocator(allocator), _chains(chains), _code_size(0)
 {
 	_valid = false;
 	_dirty = false;
+	_accessed = false;
+	_evicted = false;
+	_resident = false;
 	for(auto &i : _table) i = nullptr;
 }
 
@@ -76,18 +79,29 @@ void BlockPageProfile::Insert(Address address, const BlockTranslation &txln)
 	if(Get(address).GetFn() != nullptr) {
 		InvalidateTxln(address);
 	}
-	_txlns.insert(txln.GetFn());
+	_txlns[txln.GetFn()] = txln.GetSize();
+	_code_size += txln.GetSize();
+	_accessed = true;
 	Get(address) = txln;
 }
 
+void BlockPageProfile::releaseTxln(block_txln_fn fn, size_t size)
+{
+	// Make sure nothing is still chained into (or out of) this code before
+	// it is handed back to the allocator
+	if(_chains) _chains->Release(fn, size);
+	_allocator.Free((void*)fn);
+}
+
 void BlockPageProfile::InvalidateTxln(Address address)
 {
 	auto &txln = Get(address);
 
 	auto fn = txln.GetFn();
 	if(fn) {
-		_allocator.Free((void*)fn);
+		releaseTxln(fn, txln.GetSize());
 		_txlns.erase(fn);
+		_code_size -= txln.GetSize();
 	}
 
 	txln.Invalidate();
@@ -98,8 +112,8 @@ void BlockPageProfile::Invalidate()
 	_valid = false;
 	_dirty = false;
 	for(auto i : _txlns) {
-		assert(i != nullptr);
-		_allocator.Free((void*)i);
+		assert(i.first != nullptr);
+		releaseTxln(i.first, i.second);
 	}
 
 	for(auto &i : _table) {
@@ -107,9 +121,10 @@ void BlockPageProfile::Invalidate()
 		i = nullptr;
 	}
 	_txlns.clear();
+	_code_size = 0;
 }
 
-BlockProfile::BlockProfile(wulib::MemAllocator &allocator) : _allocator(allocator), code_size_(0)
+BlockProfile::BlockProfile(wulib::MemAllocator &allocator, BlockChainTable *chains) : _allocator(allocator), _chains(chains), _clock_hand(0), code_size_(0)
 {
 	_table_pages_dirty.set();
 	for(auto &i : _page_profiles) {
@@ -118,32 +133,54 @@ BlockProfile::BlockProfile(wulib::MemAllocator &allocator) : _allocator(allocato
 	Invalidate();
 }
 
-void BlockProfile::Insert(Address address, const BlockTranslation &txln)
+bool BlockProfile::Insert(Address address, const BlockTranslation &txln)
 {
 	// Get the page index of the address
 	LC_DEBUG2(LogBlockProfile) << "Inserting " << std::hex << address.Get() << " into the block profile";
 
-	code_size_ += txln.GetSize();
+	auto &profile = getProfile(address);
+	bool retranslated = profile.IsEvicted();
+
+	size_t old_size = profile.GetCodeSize();
+	profile.Insert(address, txln);
+	code_size_ += profile.GetCodeSize() - old_size;
+
+	if(!profile.IsResident()) {
+		profile.SetResident(true);
+		_resident_pages.push_back({address.PageBase(), &profile});
+	}
 
-	getProfile(address).Insert(address, txln);
+	return retranslated;
 }
 
 void BlockProfile::Invalidate()
 {
 	LC_DEBUG1(LogBlockProfile) << "Performing a full invalidation";
+	if(_chains) _chains->UnlinkAll();
+
 	for(auto &i : _page_profiles) {
 		if(i != nullptr) {
 			i->Invalidate();
+			i->SetEvicted(false);
+			i->SetResident(false);
 		}
 	}
 
 	code_size_ = 0;
 	_table_pages_dirty.reset();
+
+	_resident_pages.clear();
+	_clock_hand = 0;
 }
 
 void BlockProfile::InvalidatePage(Address address)
 {
-	getProfile(address).Invalidate();
+	if(_chains) _chains->UnlinkPage(address);
+
+	auto &profile = getProfile(address);
+	code_size_ -= profile.GetCodeSize();
+	profile.Invalidate();
+	profile.SetEvicted(false);
 }
 
 void BlockProfile::GarbageCollect()
@@ -152,8 +189,54 @@ void BlockProfile::GarbageCollect()
 		LC_DEBUG1(LogBlockProfile) << "Performing a garbage collection";
 	}
 	for(auto &i : _dirty_pages) {
+		code_size_ -= i.second->GetCodeSize();
 		i.second->Invalidate();
+		i.second->SetEvicted(false);
 	}
 
 	_dirty_pages.clear();
 }
+
+uint64_t BlockProfile::EvictPages(uint64_t target_size)
+{
+	uint64_t evicted = 0;
+
+	// Two full turns of the clock are enough to clear every access bit and
+	// then evict every page
+	size_t steps = _resident_pages.size() * 2;
+	while(code_size_ > target_size && steps-- > 0 && !_resident_pages.empty()) {
+		if(_clock_hand >= _resident_pages.size()) {
+			_clock_hand = 0;
+		}
+
+		auto &entry = _resident_pages[_clock_hand];
+		BlockPageProfile *profile = entry.second;
+
+		// Drop pages which have lost their translations some other way
+		if(profile->GetCodeSize() == 0) {
+			profile->SetResident(false);
+			entry = _resident_pages.back();
+			_resident_pages.pop_back();
+			continue;
+		}
+
+		if(profile->TestAndClearAccessed()) {
+			_clock_hand++;
+			continue;
+		}
+
+		LC_DEBUG1(LogBlockProfile) << "Evicting page " << std::hex << entry.first.Get() << " (" << std::dec << profile->GetCodeSize() << " bytes)";
+
+		if(_chains) _chains->UnlinkPage(entry.first);
+		code_size_ -= profile->GetCodeSize();
+		profile->Invalidate();
+		profile->SetEvicted(true);
+		profile->SetResident(false);
+
+		entry = _resident_pages.back();
+		_resident_pages.pop_back();
+		evicted++;
+	}
+
+	return evicted;
+}
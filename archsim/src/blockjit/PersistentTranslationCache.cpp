@@ -0,0 +1,513 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "blockjit/PersistentTranslationCache.h"
+#include "util/LogContext.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <link.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+UseLogContext(LogBlockProfile);
+
+using namespace archsim::blockjit;
+
+const char PersistentTranslationCache::kMagic[8] = { 'A', 'S', 'T', 'X', 'C', 'A', 'C', 'H' };
+
+namespace
+{
+	// On-disk layout. Every record is padded to a multiple of 8 bytes.
+	struct FileHeader {
+		char Magic[8];
+		uint32_t Version;
+		uint32_t ContextSize;
+		uint32_t ImageCount;
+		uint32_t SelfImage;
+		uint64_t EntryCount;
+	};
+
+	struct FileImage {
+		uint64_t FileSize;
+		uint64_t FileMTime;
+		uint32_t PathSize;
+		uint32_t Padding;
+	};
+
+	struct FileEntry {
+		uint64_t VirtPC;
+		uint64_t PageHash;
+		uint32_t IsaMode;
+		uint32_t FeatureCount;
+		uint32_t RelocationCount;
+		uint32_t CodeSize;
+	};
+
+	struct FileFeature {
+		uint32_t Id;
+		uint32_t Level;
+	};
+
+	struct FileRelocation {
+		uint32_t Offset;
+		uint32_t Image;
+		uint64_t ImageOffset;
+	};
+
+	size_t pad8(size_t size)
+	{
+		return (size + 7) & ~(size_t)7;
+	}
+
+	void write_padding(std::ostream &str, size_t size)
+	{
+		static const char zeroes[8] = {0};
+		str.write(zeroes, pad8(size) - size);
+	}
+
+	// Reads records out of the mapped file, failing (rather than overrunning)
+	// if the file is truncated.
+	class FileReader
+	{
+	public:
+		FileReader(const uint8_t *data, size_t size) : data_(data), size_(size), offset_(0) {}
+
+		template<typename T> const T *Read(size_t count = 1)
+		{
+			return (const T*)ReadBytes(sizeof(T) * count);
+		}
+
+		const uint8_t *ReadBytes(size_t size)
+		{
+			if(pad8(size) > size_ - offset_) {
+				return nullptr;
+			}
+
+			const uint8_t *ptr = data_ + offset_;
+			offset_ += pad8(size);
+			return ptr;
+		}
+
+	private:
+		const uint8_t *data_;
+		size_t size_;
+		size_t offset_;
+	};
+
+	bool stat_image(const std::string &path, uint64_t &size, uint64_t &mtime)
+	{
+		struct stat st;
+		if(stat(path.c_str(), &st) != 0) {
+			return false;
+		}
+
+		size = st.st_size;
+		mtime = st.st_mtime;
+		return true;
+	}
+}
+
+PersistentTranslationCache::PersistentTranslationCache() : mapping_(nullptr), mapping_size_(0), loaded_count_(0), recorded_count_(0), dirty_(false)
+{
+
+}
+
+PersistentTranslationCache::~PersistentTranslationCache()
+{
+	if(mapping_ != nullptr) {
+		munmap(mapping_, mapping_size_);
+	}
+}
+
+uint64_t PersistentTranslationCache::HashPage(const uint8_t *data, size_t size)
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for(size_t i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+void PersistentTranslationCache::scanImages()
+{
+	std::vector<HostImage> images;
+
+	dl_iterate_phdr([](struct dl_phdr_info *info, size_t size, void *data) -> int {
+		auto &images = *(std::vector<HostImage>*)data;
+
+		HostImage image;
+		image.Base = info->dlpi_addr;
+
+		if(info->dlpi_name != nullptr && info->dlpi_name[0] != 0) {
+			image.Path = info->dlpi_name;
+		} else {
+			// The main executable has no name
+			char path[PATH_MAX];
+			ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+			if(length <= 0) {
+				return 0;
+			}
+			image.Path = std::string(path, length);
+		}
+
+		if(!stat_image(image.Path, image.FileSize, image.FileMTime)) {
+			return 0;
+		}
+
+		for(int i = 0; i < info->dlpi_phnum; ++i) {
+			const auto &phdr = info->dlpi_phdr[i];
+			if(phdr.p_type == PT_LOAD) {
+				uintptr_t start = info->dlpi_addr + phdr.p_vaddr;
+				image.Segments.push_back({start, start + phdr.p_memsz});
+			}
+		}
+
+		images.push_back(image);
+		return 0;
+	}, &images);
+
+	// Keep existing indices stable, since recorded relocations refer to them
+	for(const auto &image : images) {
+		bool known = false;
+		for(const auto &existing : images_) {
+			if(existing.Path == image.Path && existing.Base == image.Base) {
+				known = true;
+				break;
+			}
+		}
+
+		if(!known) {
+			images_.push_back(image);
+		}
+	}
+}
+
+bool PersistentTranslationCache::resolveHostAddress(uintptr_t address, uint32_t &image, uint64_t &image_offset)
+{
+	for(int attempt = 0; attempt < 2; ++attempt) {
+		for(uint32_t i = 0; i < images_.size(); ++i) {
+			for(const auto &segment : images_[i].Segments) {
+				if(address >= segment.first && address < segment.second) {
+					image = i;
+					image_offset = address - images_[i].Base;
+					return true;
+				}
+			}
+		}
+
+		// The address might be in a library loaded since we last looked
+		scanImages();
+	}
+
+	return false;
+}
+
+uint32_t PersistentTranslationCache::getSelfImage()
+{
+	uint32_t image;
+	uint64_t offset;
+	if(!resolveHostAddress((uintptr_t)&PersistentTranslationCache::HashPage, image, offset)) {
+		throw std::logic_error("Could not find the image containing the simulator");
+	}
+	return image;
+}
+
+bool PersistentTranslationCache::featuresMatch(const Entry &entry, const archsim::ProcessorFeatureSet &features)
+{
+	for(const auto &feature : entry.Features) {
+		if(features.GetFeatureLevel(feature.first) != feature.second) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PersistentTranslationCache::Load(const std::string &filename, const std::string &context)
+{
+	std::lock_guard<std::mutex> l(lock_);
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0) {
+		LC_DEBUG1(LogBlockProfile) << "No persistent translation cache at " << filename;
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+		close(fd);
+		return false;
+	}
+
+	void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(mapping == MAP_FAILED) {
+		LC_WARNING(LogBlockProfile) << "Could not map persistent translation cache " << filename;
+		return false;
+	}
+
+	FileReader reader ((const uint8_t*)mapping, st.st_size);
+
+	auto header = reader.Read<FileHeader>();
+	if(memcmp(header->Magic, kMagic, sizeof(kMagic)) != 0 || header->Version != kVersion) {
+		LC_WARNING(LogBlockProfile) << "Ignoring persistent translation cache " << filename << ": wrong version";
+		munmap(mapping, st.st_size);
+		return false;
+	}
+
+	auto file_context = (const char*)reader.ReadBytes(header->ContextSize);
+	if(file_context == nullptr || std::string(file_context, header->ContextSize) != context) {
+		LC_WARNING(LogBlockProfile) << "Ignoring persistent translation cache " << filename << ": saved for a different guest configuration";
+		munmap(mapping, st.st_size);
+		return false;
+	}
+
+	// Find each saved image in this process. Translations which refer to an
+	// image which has since changed (or isn't loaded) can't be used.
+	scanImages();
+
+	std::vector<int64_t> image_map;
+	for(uint32_t i = 0; i < header->ImageCount; ++i) {
+		auto file_image = reader.Read<FileImage>();
+		auto path = file_image ? (const char*)reader.ReadBytes(file_image->PathSize) : nullptr;
+		if(path == nullptr) {
+			munmap(mapping, st.st_size);
+			return false;
+		}
+
+		int64_t index = -1;
+		for(uint32_t j = 0; j < images_.size(); ++j) {
+			const auto &image = images_[j];
+			if(image.Path == std::string(path, file_image->PathSize) && image.FileSize == file_image->FileSize && image.FileMTime == file_image->FileMTime) {
+				index = j;
+				break;
+			}
+		}
+		image_map.push_back(index);
+	}
+
+	// Saved code depends on the lowering which produced it
+	if(header->SelfImage >= image_map.size() || image_map[header->SelfImage] != getSelfImage()) {
+		LC_WARNING(LogBlockProfile) << "Ignoring persistent translation cache " << filename << ": saved by a different build";
+		munmap(mapping, st.st_size);
+		return false;
+	}
+
+	size_t usable = 0;
+	for(uint64_t i = 0; i < header->EntryCount; ++i) {
+		auto file_entry = reader.Read<FileEntry>();
+		if(file_entry == nullptr) break;
+
+		auto features = reader.Read<FileFeature>(file_entry->FeatureCount);
+		auto relocations = reader.Read<FileRelocation>(file_entry->RelocationCount);
+		auto code = reader.ReadBytes(file_entry->CodeSize);
+		if(features == nullptr || relocations == nullptr || code == nullptr) break;
+
+		Entry entry;
+		entry.Code = code;
+		entry.CodeSize = file_entry->CodeSize;
+
+		for(uint32_t f = 0; f < file_entry->FeatureCount; ++f) {
+			entry.Features.push_back({features[f].Id, features[f].Level});
+		}
+
+		bool valid = true;
+		for(uint32_t r = 0; r < file_entry->RelocationCount; ++r) {
+			const auto &relocation = relocations[r];
+			if(relocation.Image >= image_map.size() || image_map[relocation.Image] < 0 || (uint64_t)relocation.Offset + 8 > entry.CodeSize) {
+				valid = false;
+				break;
+			}
+			entry.Relocations.push_back({relocation.Offset, (uint32_t)image_map[relocation.Image], relocation.ImageOffset});
+		}
+
+		if(valid) {
+			loaded_[ {file_entry->VirtPC, file_entry->PageHash, file_entry->IsaMode}].push_back(entry);
+			usable++;
+		}
+	}
+
+	if(mapping_ != nullptr) {
+		munmap(mapping_, mapping_size_);
+	}
+	mapping_ = mapping;
+	mapping_size_ = st.st_size;
+
+	LC_INFO(LogBlockProfile) << "Loaded " << usable << " of " << header->EntryCount << " persistent translations from " << filename;
+	return usable != 0;
+}
+
+bool PersistentTranslationCache::Save(const std::string &filename, const std::string &context)
+{
+	std::lock_guard<std::mutex> l(lock_);
+
+	std::string temp_filename = filename + ".tmp";
+	std::ofstream str (temp_filename, std::ios::binary | std::ios::trunc);
+	if(!str.good()) {
+		LC_WARNING(LogBlockProfile) << "Could not write persistent translation cache " << filename;
+		return false;
+	}
+
+	uint64_t entry_count = 0;
+	for(const auto &key : recorded_) {
+		entry_count += key.second.size();
+	}
+
+	FileHeader header;
+	memcpy(header.Magic, kMagic, sizeof(kMagic));
+	header.Version = kVersion;
+	header.ContextSize = context.size();
+	header.SelfImage = getSelfImage();
+	header.ImageCount = images_.size();
+	header.EntryCount = entry_count;
+
+	str.write((const char*)&header, sizeof(header));
+	str.write(context.data(), context.size());
+	write_padding(str, context.size());
+
+	for(const auto &image : images_) {
+		FileImage file_image;
+		file_image.FileSize = image.FileSize;
+		file_image.FileMTime = image.FileMTime;
+		file_image.PathSize = image.Path.size();
+		file_image.Padding = 0;
+
+		str.write((const char*)&file_image, sizeof(file_image));
+		str.write(image.Path.data(), image.Path.size());
+		write_padding(str, image.Path.size());
+	}
+
+	for(const auto &key : recorded_) {
+		for(const auto &entry : key.second) {
+			FileEntry file_entry;
+			file_entry.VirtPC = key.first.VirtPC;
+			file_entry.PageHash = key.first.PageHash;
+			file_entry.IsaMode = key.first.IsaMode;
+			file_entry.FeatureCount = entry.Features.size();
+			file_entry.RelocationCount = entry.Relocations.size();
+			file_entry.CodeSize = entry.CodeSize;
+			str.write((const char*)&file_entry, sizeof(file_entry));
+
+			for(const auto &feature : entry.Features) {
+				FileFeature file_feature { feature.first, feature.second };
+				str.write((const char*)&file_feature, sizeof(file_feature));
+			}
+			write_padding(str, sizeof(FileFeature) * entry.Features.size());
+
+			for(const auto &relocation : entry.Relocations) {
+				FileRelocation file_relocation { relocation.Offset, relocation.Image, relocation.ImageOffset };
+				str.write((const char*)&file_relocation, sizeof(file_relocation));
+			}
+
+			str.write((const char*)entry.Code, entry.CodeSize);
+			write_padding(str, entry.CodeSize);
+		}
+	}
+
+	str.close();
+	if(!str.good() || rename(temp_filename.c_str(), filename.c_str()) != 0) {
+		LC_WARNING(LogBlockProfile) << "Could not write persistent translation cache " << filename;
+		unlink(temp_filename.c_str());
+		return false;
+	}
+
+	dirty_ = false;
+
+	LC_INFO(LogBlockProfile) << "Saved " << entry_count << " persistent translations to " << filename;
+	return true;
+}
+
+bool PersistentTranslationCache::Record(Address virt_pc, uint64_t page_hash, uint32_t isa_mode, const BlockTranslation &txln)
+{
+	auto relocations = txln.GetRelocations();
+	if(relocations == nullptr || txln.GetFn() == nullptr) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> l(lock_);
+
+	Entry entry;
+	entry.OwnedCode.assign((const uint8_t*)txln.GetFn(), (const uint8_t*)txln.GetFn() + txln.GetSize());
+	entry.Code = entry.OwnedCode.data();
+	entry.CodeSize = entry.OwnedCode.size();
+
+	for(auto offset : *relocations) {
+		uintptr_t target = *(const uint64_t*)(entry.Code + offset);
+
+		HostRelocation relocation;
+		relocation.Offset = offset;
+		if(!resolveHostAddress(target, relocation.Image, relocation.ImageOffset)) {
+			LC_DEBUG1(LogBlockProfile) << "Not saving translation of " << virt_pc << ": could not resolve host address " << (void*)target;
+			return false;
+		}
+		entry.Relocations.push_back(relocation);
+	}
+
+	auto features = txln.GetFeatures();
+	for(auto i = features.begin(); i != features.end(); ++i) {
+		entry.Features.push_back(*i);
+	}
+
+	// Replace any translation made for the same features
+	auto &entries = recorded_[ {virt_pc.Get(), page_hash, isa_mode}];
+	for(auto i = entries.begin(); i != entries.end(); ++i) {
+		if(i->Features == entry.Features) {
+			entries.erase(i);
+			recorded_count_--;
+			break;
+		}
+	}
+
+	entries.push_back(std::move(entry));
+	entries.back().Code = entries.back().OwnedCode.data();
+
+	recorded_count_++;
+	dirty_ = true;
+	return true;
+}
+
+bool PersistentTranslationCache::Lookup(Address virt_pc, uint64_t page_hash, uint32_t isa_mode, const archsim::ProcessorFeatureSet &features, wulib::MemAllocator &allocator, BlockTranslation &txln)
+{
+	std::lock_guard<std::mutex> l(lock_);
+
+	auto entries = loaded_.find({virt_pc.Get(), page_hash, isa_mode});
+	if(entries == loaded_.end()) {
+		return false;
+	}
+
+	for(const auto &entry : entries->second) {
+		if(!featuresMatch(entry, features)) {
+			continue;
+		}
+
+		uint8_t *code = (uint8_t*)allocator.Allocate(entry.CodeSize);
+		memcpy(code, entry.Code, entry.CodeSize);
+
+		std::vector<uint32_t> offsets;
+		for(const auto &relocation : entry.Relocations) {
+			*(uint64_t*)(code + relocation.Offset) = images_[relocation.Image].Base + relocation.ImageOffset;
+			offsets.push_back(relocation.Offset);
+		}
+
+		txln.Invalidate();
+		txln.SetFn((block_txln_fn)code);
+		txln.SetSize(entry.CodeSize);
+		txln.SetRelocations(offsets);
+		for(const auto &feature : entry.Features) {
+			txln.AddRequiredFeature(feature.first, feature.second);
+		}
+
+		loaded_count_++;
+		return true;
+	}
+
+	return false;
+}
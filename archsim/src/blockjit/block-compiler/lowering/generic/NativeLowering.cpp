@@ -16,4 +16,9 @@ LoweringResult captive::arch::jit::lowering::NativeLowering(TranslationContext &
 bool captive::arch::jit::lowering::HasNativeLowering()
 {
 	return false;
+}
+
+std::string captive::arch::jit::lowering::GetNativeLoweringFeatures()
+{
+	return "";
 }
\ No newline at end of file
@@ -21,6 +21,8 @@ bool LowerCount::Lower(const captive::shared::IRInstruction *&insn)
 	const IROperand *counter = &insn->operands[0];
 	const IROperand *amount = &insn->operands[1];
 
+	// The counter lives on the host heap, so this code can't be saved
+	Encoder().mark_position_dependent();
 	Encoder().mov(counter->value, BLKJIT_ARG0(8));
 	Encoder().add8(amount->value, X86Memory::get(BLKJIT_ARG0(8)));
 
@@ -12,95 +12,132 @@
 #include "blockjit/block-compiler/block-compiler.h"
 #include "blockjit/translation-context.h"
 #include "blockjit/block-compiler/lowering/x86/X86BlockjitABI.h"
+#include "blockjit/blockcache-defines.h"
 
 using namespace captive::arch::jit::lowering::x86;
 using namespace captive::shared;
 
+static void patch_reloc(X86Encoder &encoder, uint32_t reloc)
+{
+	*(uint32_t*)(encoder.get_buffer() + reloc) = encoder.current_offset() - reloc - 4;
+}
+
+static void increment_counter(X86Encoder &encoder, const IROperand &counter, const X86Register &temp)
+{
+	if(counter.value != 0) {
+		encoder.mark_position_dependent();
+		encoder.mov(counter.value, temp);
+		encoder.add8(1, X86Memory::get(temp));
+	}
+}
+
+// Tear down this block's frame and set up the arguments for the next block,
+// so that it can be jumped to as though it had been called by the dispatcher.
+static void emit_tail_call_setup(X86LoweringContext &ctx)
+{
+	ctx.GetEncoder().mov(BLKJIT_REGSTATE_REG, BLKJIT_ARG0(8));
+	ctx.GetEncoder().mov(BLKJIT_CPUSTATE_REG, BLKJIT_ARG1(8));
+	ctx.EmitEpilogue();
+}
+
 bool LowerDispatch::Lower(const captive::shared::IRInstruction *&insn)
 {
-	UNIMPLEMENTED;
-//	const auto *cpu = GetCompiler().get_cpu();
-//	uint32_t pc_offset = cpu->GetRegisterByTag("PC")->Offset;
-//
-//	// If we shouldn't dispatch, just do a return instead
-//	if(!GetCompiler().emit_chaining_logic) {
-//		LowerRet r;
-//		r.SetContexts(GetLoweringContext(),GetTranslationContext(), GetCompiler());
-//		r.Lower(insn);
-//		// insn incremented by return lowering
-//		return true;
-//	}
-//
-//	// Dispatch instruction can have three general forms:
-//	// 1. All operands populated - instruction is a predicated jump and both target and fallthrough are compiled
-//	// 2. Fallthrough function not populated - instruction is a predicated jump and only the target is compiled
-//	// 3. Fallthrough PC and function not populated - instruction is a non predicated jump
-//
-//	const IROperand &target_pc = insn->operands[0];
-//	const IROperand &fallthrough_pc = insn->operands[1];
-//	const IROperand &target_fn = insn->operands[2];
-//	const IROperand &fallthrough_fn = insn->operands[3];
-//
-//	assert(target_fn.value != 0 || fallthrough_fn.value != 0);
-//
-//	// We need to do some stuff no matter what kind of dispatch we're doing
-//	// 1. fix up stack
-//	// 2. make sure we don't realloc halfway through emitting dispatch code and wreck the offsets
-//	// 3. do an interrupt check
-//
-//	if(GetLoweringContext().GetStackFrameSize()) {
-//		Encoder().add(GetLoweringContext().GetStackFrameSize(), REG_RSP);
-//	}
-//
-////	Encoder().int3();
-//
-//	// Decrement iteration count
-//	Encoder().cmp4(0, X86Memory::get(BLKJIT_CPUSTATE_REG, gensim::CpuStateOffsets::CpuState_pending_actions));
-//
-//	Encoder().ensure_extra_buffer(32);
-//
-//	// If iteration count is nonzero...
-//	uint32_t iteration_count_zero;
-//	Encoder().jne_reloc(iteration_count_zero);
-//
-//	uint32_t pc_not_target = 0;
-//	uint32_t fallthrough_not_target = 0;
-//	if(target_fn.value != 0) {
-//		// compare PC against target PC...
-//		Encoder().cmp4((uint32_t)target_pc.value, X86Memory::get(REG_RBP, pc_offset)); // XXX ARM HACK
-//		Encoder().jne_reloc(pc_not_target);
-//		if(archsim::options::Verbose.GetValue()) {
-//			Encoder().add(1, 8, X86Memory::get(BLKJIT_CPUSTATE_REG, gensim::CpuStateOffsets::CpuState_chained_target));
-//		}
-//		Encoder().jmp((void*)target_fn.value, REG_R15);
-//	}
-//	if(fallthrough_fn.value != 0) {
-//		// compare PC against target PC...
-//		Encoder().cmp4((uint32_t)fallthrough_pc.value, X86Memory::get(REG_RBP, pc_offset)); // XXX ARM HACK
-//		Encoder().jne_reloc(fallthrough_not_target);
-//		if(archsim::options::Verbose.GetValue()) {
-//			Encoder().add(1, 8, X86Memory::get(BLKJIT_CPUSTATE_REG, gensim::CpuStateOffsets::CpuState_chained_fallthrough));
-//		}
-//		Encoder().jmp((void*)fallthrough_fn.value, REG_R15);
-//	}
-//
-//
-//	// fill in jump targets
-//	*(uint32_t*)(Encoder().get_buffer() + iteration_count_zero) = Encoder().current_offset() - iteration_count_zero - 4;
-//	if(fallthrough_not_target != 0) {
-//		*(uint32_t*)(Encoder().get_buffer() + fallthrough_not_target) = Encoder().current_offset() - fallthrough_not_target - 4;
-//	}
-//	if(pc_not_target != 0) {
-//		*(uint32_t*)(Encoder().get_buffer() + pc_not_target) = Encoder().current_offset() - pc_not_target - 4;
-//	}
-//
-//	if(archsim::options::Verbose.GetValue()) {
-//		Encoder().add(1, 8, X86Memory::get(BLKJIT_CPUSTATE_REG, gensim::CpuStateOffsets::CpuState_chained_failed));
-//	}
-//
-//	Encoder().xorr(REG_RAX, REG_RAX);
-//	Encoder().ret();
-//
-//	insn++;
-//	return true;
+	// Dispatch instruction operands:
+	// 1. The PC of a same-page jump target to chain to directly (or zero)
+	// 2. The PC of a same-page fallthrough to chain to directly (or zero)
+	// 3 & 4. Chained and unchained counters (or zero)
+	//
+	// Each direct successor gets a chain site: a patchable jmp which initially
+	// falls through into a stub that hands the site back to the dispatcher. If
+	// neither successor matches, the block cache is probed for the current PC.
+
+	const IROperand &target_pc = insn->operands[0];
+	const IROperand &fallthrough_pc = insn->operands[1];
+	const IROperand &chained_counter = insn->operands[2];
+	const IROperand &unchained_counter = insn->operands[3];
+
+	const auto &pc_desc = GetLoweringContext().GetArchDescriptor().GetRegisterFileDescriptor().GetTaggedEntry("PC");
+	uint32_t pc_offset = pc_desc.GetOffset();
+	uint8_t pc_size = pc_desc.GetEntrySize();
+
+	const auto &sbd = GetLoweringContext().GetStateBlockDescriptor();
+	uint32_t message_offset = sbd.GetBlockOffset("MessageWaiting");
+	uint32_t chain_exit_offset = sbd.GetBlockOffset("ChainExit");
+	uint32_t block_cache_offset = sbd.GetBlockOffset("BlockCache");
+
+	std::vector<uint32_t> exit_relocs;
+	uint32_t reloc;
+
+	// Never chain past a pending message
+	Encoder().cmp4(0, X86Memory::get(BLKJIT_CPUSTATE_REG, message_offset));
+	Encoder().jne_reloc(reloc);
+	exit_relocs.push_back(reloc);
+
+	for(const IROperand *successor : { &target_pc, &fallthrough_pc }) {
+		if(successor->value == 0) {
+			continue;
+		}
+
+		uint32_t not_successor;
+		Encoder().mov(X86Memory::get(BLKJIT_REGSTATE_REG, pc_offset), BLKJIT_TEMPS_0(pc_size));
+		Encoder().mov(successor->value, BLKJIT_TEMPS_1(pc_size));
+		Encoder().cmp(BLKJIT_TEMPS_1(pc_size), BLKJIT_TEMPS_0(pc_size));
+		Encoder().jne_reloc(not_successor);
+
+		increment_counter(Encoder(), chained_counter, BLKJIT_TEMPS_0(8));
+		emit_tail_call_setup(GetLoweringContext());
+
+		// Align the site so that it can be atomically patched
+		while((Encoder().current_offset() + 1) & 3) {
+			Encoder().nop();
+		}
+
+		uint32_t site;
+		Encoder().jmp_reloc(site);
+
+		// Not linked yet: report the site to the dispatcher, and undo the
+		// optimistic chained count
+		Encoder().lea_rip(site, REG_RAX);
+		Encoder().mov(REG_RAX, X86Memory::get(BLKJIT_ARG1(8), chain_exit_offset));
+		if(chained_counter.value != 0) {
+			Encoder().mov(chained_counter.value, REG_RAX);
+			Encoder().sub(1, 8, X86Memory::get(REG_RAX));
+		}
+		increment_counter(Encoder(), unchained_counter, REG_RAX);
+		Encoder().ret();
+
+		patch_reloc(Encoder(), not_successor);
+	}
+
+	// Probe the block cache for the current PC: this is the same lookup that
+	// the dispatcher would perform, so it is valid for exactly as long as the
+	// cache entry is.
+	Encoder().mov(X86Memory::get(BLKJIT_REGSTATE_REG, pc_offset), BLKJIT_TEMPS_0(pc_size));
+	Encoder().mov(BLKJIT_TEMPS_0(8), BLKJIT_TEMPS_1(8));
+	if(BLOCKCACHE_INSTRUCTION_SHIFT) {
+		Encoder().shr(BLOCKCACHE_INSTRUCTION_SHIFT, BLKJIT_TEMPS_1(8));
+	}
+	Encoder().andd(BLOCKCACHE_SIZE - 1, BLKJIT_TEMPS_1(8));
+	Encoder().shl(4, BLKJIT_TEMPS_1(8));
+	Encoder().add(X86Memory::get(BLKJIT_CPUSTATE_REG, block_cache_offset), BLKJIT_TEMPS_1(8));
+	Encoder().cmp(X86Memory::get(BLKJIT_TEMPS_1(8)), BLKJIT_TEMPS_0(8));
+	Encoder().jne_reloc(reloc);
+	exit_relocs.push_back(reloc);
+
+	increment_counter(Encoder(), chained_counter, BLKJIT_TEMPS_0(8));
+	Encoder().mov(X86Memory::get(BLKJIT_TEMPS_1(8), 8), REG_RAX);
+	emit_tail_call_setup(GetLoweringContext());
+	Encoder().jmp(REG_RAX);
+
+	// Couldn't chain, so return to the dispatcher
+	for(auto exit_reloc : exit_relocs) {
+		patch_reloc(Encoder(), exit_reloc);
+	}
+
+	increment_counter(Encoder(), unchained_counter, BLKJIT_TEMPS_0(8));
+	GetLoweringContext().EmitEpilogue();
+	Encoder().ret();
+
+	insn++;
+	return true;
 }
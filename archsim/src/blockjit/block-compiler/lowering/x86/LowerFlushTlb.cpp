@@ -25,7 +25,7 @@ bool LowerFlushTlb::Lower(const captive::shared::IRInstruction *&insn)
 	GetLoweringContext().load_state_field(0, REG_RDI);
 
 	uint64_t fn_ptr = insn->type == IRInstruction::FLUSH_ITLB ? (uint64_t)tmFlushITlb : (uint64_t)tmFlushDTlb;
-	Encoder().mov((uint64_t)fn_ptr, REG_RAX);
+	Encoder().mov_host((void*)fn_ptr, REG_RAX);
 	Encoder().call(REG_RAX);
 
 	GetLoweringContext().emit_restore_reg_state(GetIsStackFixed());
@@ -44,7 +44,7 @@ bool LowerFlushTlbEntry::Lower(const captive::shared::IRInstruction *&insn)
 	GetLoweringContext().load_state_field(0, REG_RDI);
 	GetLoweringContext().encode_operand_function_argument(&insn->operands[0], REG_ESI, GetStackMap());
 
-	Encoder().mov((uint64_t)fn_ptr, REG_RAX);
+	Encoder().mov_host((void*)fn_ptr, REG_RAX);
 	Encoder().call(REG_RAX);
 
 	GetLoweringContext().emit_restore_reg_state(GetIsStackFixed());
@@ -20,6 +20,18 @@ bool LowerMov::Lower(const captive::shared::IRInstruction *&insn)
 	const IROperand *source = &insn->operands[0];
 	const IROperand *dest = &insn->operands[1];
 
+	if (dest->size == 16) {
+		// 128 bit values always live on the stack, so copy them through an
+		// xmm register
+		if (!source->is_alloc_stack() || source->alloc_data != dest->alloc_data) {
+			GetLoweringContext().load_vector_operand(source, BLKJIT_FP_0);
+			GetLoweringContext().store_vector_operand(BLKJIT_FP_0, dest);
+		}
+
+		insn++;
+		return true;
+	}
+
 	if (source->type == IROperand::VREG) {
 		// mov vreg -> vreg
 		if (source->is_alloc_reg()) {
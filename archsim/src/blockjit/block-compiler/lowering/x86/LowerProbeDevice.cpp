@@ -35,7 +35,7 @@ bool LowerProbeDevice::Lower(const captive::shared::IRInstruction *&insn)
 	GetLoweringContext().encode_operand_function_argument(dev, REG_RSI, GetStackMap());
 
 	// Load the address of the target function into a temporary, and perform an indirect call.
-	Encoder().mov((uint64_t)&devProbeDevice, BLKJIT_RETURN(8));
+	Encoder().mov_host((void*)&devProbeDevice, BLKJIT_RETURN(8));
 	Encoder().call(BLKJIT_RETURN(8));
 
 	Encoder().push(REG_RAX);
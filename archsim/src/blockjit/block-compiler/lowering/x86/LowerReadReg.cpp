@@ -224,6 +224,21 @@ bool LowerReadReg::Lower(const captive::shared::IRInstruction *&insn)
 	}
 
 
+	if (target->size == 16) {
+		// 128 bit guest registers are copied through an xmm register
+		if (offset->is_constant()) {
+			Encoder().movdqu(X86Memory::get(BLKJIT_REGSTATE_REG, offset->value), BLKJIT_FP_0);
+		} else if (offset->is_alloc_reg()) {
+			Encoder().movdqu(X86Memory::get(BLKJIT_REGSTATE_REG, GetLoweringContext().register_from_operand(offset), 1), BLKJIT_FP_0);
+		} else {
+			assert(false);
+		}
+
+		GetLoweringContext().store_vector_operand(BLKJIT_FP_0, target);
+		insn++;
+		return true;
+	}
+
 	if (offset->is_constant()) {
 		// Load a constant offset guest register into the storage location
 		if (target->is_alloc_reg()) {
@@ -22,6 +22,22 @@ bool LowerWriteReg::Lower(const captive::shared::IRInstruction *&insn)
 	const IROperand *offset = &insn->operands[1];
 	const IROperand *value = &insn->operands[0];
 
+	if (value->size == 16) {
+		// 128 bit guest registers are copied through an xmm register
+		GetLoweringContext().load_vector_operand(value, BLKJIT_FP_0);
+
+		if (offset->is_constant()) {
+			Encoder().movdqu(BLKJIT_FP_0, X86Memory::get(BLKJIT_REGSTATE_REG, offset->value));
+		} else if (offset->is_alloc_reg()) {
+			Encoder().movdqu(BLKJIT_FP_0, X86Memory::get(BLKJIT_REGSTATE_REG, GetLoweringContext().register_from_operand(offset), 1));
+		} else {
+			CANTLOWER;
+		}
+
+		insn++;
+		return true;
+	}
+
 	if (offset->is_constant()) {
 		if (value->is_constant()) {
 			switch (value->size) {
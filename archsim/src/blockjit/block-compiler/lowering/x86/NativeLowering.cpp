@@ -8,6 +8,7 @@
 #include "blockjit/block-compiler/lowering/x86/X86LoweringContext.h"
 
 #include "util/LogContext.h"
+#include "util/SimOptions.h"
 
 UseLogContext(LogBlockJit);
 
@@ -18,6 +19,8 @@ using namespace captive::shared;
 LoweringResult captive::arch::jit::lowering::NativeLowering(TranslationContext &ctx, wulib::MemAllocator &allocator, const archsim::ArchDescriptor &arch, const archsim::StateBlockDescriptor &state, const CompileResult &compile_result)
 {
 	lowering::x86::X86Encoder encoder(allocator);
+	encoder.setAVXEnabled(lowering::x86::X86Encoder::HostSupportsAVX2() && !archsim::options::JitDisableAVX);
+
 	lowering::x86::X86LoweringContext lowering(compile_result.StackFrameSize, encoder, arch, state, compile_result.UsedPhysRegs);
 	lowering.Prepare(ctx);
 
@@ -28,10 +31,22 @@ LoweringResult captive::arch::jit::lowering::NativeLowering(TranslationContext &
 
 	block_txln_fn fn = (block_txln_fn)encoder.get_buffer();
 	fn = (block_txln_fn)allocator.Reallocate(encoder.get_buffer(), encoder.get_buffer_size());
-	return LoweringResult(fn, encoder.get_buffer_size());
+
+	LoweringResult result (fn, encoder.get_buffer_size());
+	result.PositionIndependent = encoder.is_position_independent();
+	result.HostRelocations = encoder.get_host_relocations();
+	return result;
 }
 
 bool captive::arch::jit::lowering::HasNativeLowering()
 {
 	return true;
 }
+
+std::string captive::arch::jit::lowering::GetNativeLoweringFeatures()
+{
+	if(lowering::x86::X86Encoder::HostSupportsAVX2() && !archsim::options::JitDisableAVX) {
+		return "avx2";
+	}
+	return "sse";
+}
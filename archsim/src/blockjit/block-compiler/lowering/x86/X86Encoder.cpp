@@ -2,6 +2,8 @@
 
 #include "blockjit/block-compiler/lowering/x86/X86Encoder.h"
 
+#include <cpuid.h>
+
 using namespace captive::arch::jit::lowering::x86;
 
 namespace captive
@@ -127,8 +129,51 @@ namespace captive
 #define OPER_SIZE_OVERRIDE 0x66
 #define ADDR_SIZE_OVERRIDE 0x67
 
-X86Encoder::X86Encoder(wulib::MemAllocator &allocator) : _buffer(NULL), _buffer_size(0), _write_offset(0), _allocator(allocator), _support_relocation(false)
+X86Encoder::X86Encoder(wulib::MemAllocator &allocator) : _buffer(NULL), _buffer_size(0), _write_offset(0), _allocator(allocator), _support_relocation(false), _position_independent(true), _use_avx(HostSupportsAVX2())
+{
+}
+
+bool X86Encoder::HostSupportsSSE42()
+{
+	static const bool supported = []() {
+		unsigned int eax, ebx, ecx, edx;
+		if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+			return false;
+		}
+
+		return (ecx & bit_SSSE3) && (ecx & bit_SSE4_1) && (ecx & bit_SSE4_2);
+	}();
+
+	return supported;
+}
+
+bool X86Encoder::HostSupportsAVX2()
 {
+	static const bool supported = []() {
+		unsigned int eax, ebx, ecx, edx;
+		if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+			return false;
+		}
+
+		// The OS also has to be saving the AVX register state
+		if(!(ecx & bit_AVX) || !(ecx & bit_OSXSAVE)) {
+			return false;
+		}
+
+		uint32_t xcr0_lo, xcr0_hi;
+		asm volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+		if((xcr0_lo & 6) != 6) {
+			return false;
+		}
+
+		if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+			return false;
+		}
+
+		return (ebx & bit_AVX2) != 0;
+	}();
+
+	return supported;
 }
 
 void X86Encoder::incq(const X86Memory& loc)
@@ -197,6 +242,20 @@ void X86Encoder::lea(const X86Memory& addr, const X86Register& dst)
 	encode_opcode_mod_rm(0x8d, dst, addr);
 }
 
+// Load the address of a location within this buffer (given as an offset
+// from the start of the buffer), so that the code remains relocatable.
+void X86Encoder::lea_rip(uint32_t target_offset, const X86Register& dst)
+{
+	assert(dst.size == 8);
+
+	emit8(REX_W | (dst.hireg ? REX_R : 0));
+	emit8(0x8d);
+	emit8(((dst.raw_index & 7) << 3) | 0x05);
+
+	int32_t displacement = target_offset - (_write_offset + 4);
+	emit32(displacement);
+}
+
 void X86Encoder::bswap(const X86Register& dst)
 {
 	if(dst.size == 2) {
@@ -289,6 +348,17 @@ void X86Encoder::mov(uint64_t src, const X86Register& dst)
 	}
 }
 
+void X86Encoder::mov_host(const void *target, const X86Register& dst)
+{
+	assert(dst.size == 8);
+
+	emit8(dst.hireg ? (REX_W | REX_B) : REX_W);
+	emit8(0xb8 + dst.raw_index);
+
+	_host_relocations.push_back(_write_offset);
+	emit64((uint64_t)target);
+}
+
 void X86Encoder::mov8(uint64_t src, const X86Memory& dst)
 {
 	assert(false);
@@ -789,6 +859,265 @@ void X86Encoder::pxor(const X86VectorRegister& src, const X86VectorRegister& des
 	encode_mod_reg_rm(dest, src);
 }
 
+namespace
+{
+	// Prefix, opcode map (1 = 0f, 2 = 0f38, 3 = 0f3a), opcode, and for the
+	// shifts by an immediate, the opcode extension in the modrm reg field.
+	struct VectorOpEncoding {
+		uint8_t prefix;
+		uint8_t map;
+		uint8_t opcode;
+		int8_t extension;
+		bool unary;
+		bool has_imm;
+	};
+
+	const VectorOpEncoding vector_op_encodings[] = {
+		{ 0x66, 1, 0xfc, -1, false, false },
+		{ 0x66, 1, 0xfd, -1, false, false },
+		{ 0x66, 1, 0xfe, -1, false, false },
+		{ 0x66, 1, 0xd4, -1, false, false },
+		{ 0x66, 1, 0xf8, -1, false, false },
+		{ 0x66, 1, 0xf9, -1, false, false },
+		{ 0x66, 1, 0xfa, -1, false, false },
+		{ 0x66, 1, 0xfb, -1, false, false },
+		{ 0x66, 1, 0xd5, -1, false, false },
+		{ 0x66, 2, 0x40, -1, false, false },
+		{ 0x66, 1, 0xf4, -1, false, false },
+
+		{ 0x66, 1, 0x74, -1, false, false },
+		{ 0x66, 1, 0x75, -1, false, false },
+		{ 0x66, 1, 0x76, -1, false, false },
+		{ 0x66, 2, 0x29, -1, false, false },
+		{ 0x66, 1, 0x64, -1, false, false },
+		{ 0x66, 1, 0x65, -1, false, false },
+		{ 0x66, 1, 0x66, -1, false, false },
+		{ 0x66, 2, 0x37, -1, false, false },
+
+		{ 0x66, 2, 0x38, -1, false, false },
+		{ 0x66, 1, 0xea, -1, false, false },
+		{ 0x66, 2, 0x39, -1, false, false },
+		{ 0x66, 1, 0xda, -1, false, false },
+		{ 0x66, 2, 0x3a, -1, false, false },
+		{ 0x66, 2, 0x3b, -1, false, false },
+		{ 0x66, 2, 0x3c, -1, false, false },
+		{ 0x66, 1, 0xee, -1, false, false },
+		{ 0x66, 2, 0x3d, -1, false, false },
+		{ 0x66, 1, 0xde, -1, false, false },
+		{ 0x66, 2, 0x3e, -1, false, false },
+		{ 0x66, 2, 0x3f, -1, false, false },
+
+		{ 0x66, 1, 0xdb, -1, false, false },
+		{ 0x66, 1, 0xdf, -1, false, false },
+		{ 0x66, 1, 0xeb, -1, false, false },
+		{ 0x66, 1, 0xef, -1, false, false },
+		{ 0x66, 1, 0xdc, -1, false, false },
+		{ 0x66, 1, 0x63, -1, false, false },
+		{ 0x66, 1, 0x6b, -1, false, false },
+		{ 0x66, 2, 0x00, -1, false, false },
+
+		{ 0x00, 1, 0x58, -1, false, false },
+		{ 0x66, 1, 0x58, -1, false, false },
+		{ 0x00, 1, 0x5c, -1, false, false },
+		{ 0x66, 1, 0x5c, -1, false, false },
+		{ 0x00, 1, 0x59, -1, false, false },
+		{ 0x66, 1, 0x59, -1, false, false },
+		{ 0x00, 1, 0x5d, -1, false, false },
+		{ 0x66, 1, 0x5d, -1, false, false },
+		{ 0x00, 1, 0x5f, -1, false, false },
+		{ 0x66, 1, 0x5f, -1, false, false },
+		{ 0x00, 1, 0xc2, -1, false, true },
+		{ 0x66, 1, 0xc2, -1, false, true },
+
+		{ 0x66, 1, 0x70, -1, true, true },
+		{ 0x66, 2, 0x20, -1, true, false },
+		{ 0x66, 2, 0x21, -1, true, false },
+		{ 0x66, 2, 0x22, -1, true, false },
+		{ 0x66, 2, 0x23, -1, true, false },
+		{ 0x66, 2, 0x24, -1, true, false },
+		{ 0x66, 2, 0x25, -1, true, false },
+		{ 0x66, 2, 0x30, -1, true, false },
+		{ 0x66, 2, 0x31, -1, true, false },
+		{ 0x66, 2, 0x32, -1, true, false },
+		{ 0x66, 2, 0x33, -1, true, false },
+		{ 0x66, 2, 0x34, -1, true, false },
+		{ 0x66, 2, 0x35, -1, true, false },
+		{ 0x66, 2, 0x58, -1, true, false },
+
+		{ 0x66, 1, 0x71, 6, true, true },
+		{ 0x66, 1, 0x72, 6, true, true },
+		{ 0x66, 1, 0x73, 6, true, true },
+		{ 0x66, 1, 0x71, 2, true, true },
+		{ 0x66, 1, 0x72, 2, true, true },
+		{ 0x66, 1, 0x73, 2, true, true },
+		{ 0x66, 1, 0x71, 4, true, true },
+		{ 0x66, 1, 0x72, 4, true, true },
+	};
+	static_assert(sizeof(vector_op_encodings) / sizeof(vector_op_encodings[0]) == VOP_PSRAD + 1, "Missing vector op encodings");
+
+	inline uint8_t vector_reg_number(const X86VectorRegister &reg)
+	{
+		return reg.raw_index | (reg.hireg ? 8 : 0);
+	}
+}
+
+void X86Encoder::encode_vector_opcode(uint8_t prefix, uint8_t map, uint8_t opcode, bool r, bool x, bool b, int vvvv)
+{
+	if(_use_avx) {
+		uint8_t pp = 0;
+		switch(prefix) {
+			case 0x66:
+				pp = 1;
+				break;
+			case 0xf3:
+				pp = 2;
+				break;
+			case 0xf2:
+				pp = 3;
+				break;
+		}
+
+		// VEX stores the inverted register numbers, and 1111 for 'no register'
+		uint8_t v = (~(vvvv < 0 ? 0 : vvvv)) & 0xf;
+
+		if(map == 1 && !x && !b) {
+			emit8(0xc5);
+			emit8((!r) << 7 | v << 3 | pp);
+		} else {
+			emit8(0xc4);
+			emit8((!r) << 7 | (!x) << 6 | (!b) << 5 | map);
+			emit8(v << 3 | pp);
+		}
+	} else {
+		if(prefix) {
+			emit8(prefix);
+		}
+		if(r || x || b) {
+			encode_rex_prefix(b, x, r, false);
+		}
+
+		emit8(0x0f);
+		if(map == 2) {
+			emit8(0x38);
+		} else if(map == 3) {
+			emit8(0x3a);
+		}
+	}
+
+	emit8(opcode);
+}
+
+void X86Encoder::encode_vector(uint8_t prefix, uint8_t map, uint8_t opcode, uint8_t reg, int vvvv, const X86VectorRegister &rm)
+{
+	encode_vector_opcode(prefix, map, opcode, reg & 8, false, rm.hireg, vvvv);
+	encode_mod_reg_rm(reg & 7, rm);
+}
+
+void X86Encoder::encode_vector(uint8_t prefix, uint8_t map, uint8_t opcode, uint8_t reg, int vvvv, const X86Memory &rm)
+{
+	assert(rm.segment == 0);
+	assert(rm.base.size == 8 || rm.base == REG_RIZ);
+
+	encode_vector_opcode(prefix, map, opcode, reg & 8, rm.index.hireg, rm.base.hireg, vvvv);
+	encode_mod_reg_rm(reg & 7, rm);
+}
+
+void X86Encoder::movdqa(const X86VectorRegister& src, const X86VectorRegister& dest)
+{
+	encode_vector(0x66, 1, 0x6f, vector_reg_number(dest), -1, src);
+}
+
+void X86Encoder::movdqu(const X86Memory& src, const X86VectorRegister& dest)
+{
+	encode_vector(0xf3, 1, 0x6f, vector_reg_number(dest), -1, src);
+}
+
+void X86Encoder::movdqu(const X86VectorRegister& src, const X86Memory& dest)
+{
+	encode_vector(0xf3, 1, 0x7f, vector_reg_number(src), -1, dest);
+}
+
+void X86Encoder::movq(const X86Memory& src, const X86VectorRegister& dest)
+{
+	encode_vector(0xf3, 1, 0x7e, vector_reg_number(dest), -1, src);
+}
+
+void X86Encoder::movq(const X86VectorRegister& src, const X86Memory& dest)
+{
+	encode_vector(0x66, 1, 0xd6, vector_reg_number(src), -1, dest);
+}
+
+void X86Encoder::movd(const X86Memory& src, const X86VectorRegister& dest)
+{
+	encode_vector(0x66, 1, 0x6e, vector_reg_number(dest), -1, src);
+}
+
+void X86Encoder::movd(const X86VectorRegister& src, const X86Memory& dest)
+{
+	encode_vector(0x66, 1, 0x7e, vector_reg_number(src), -1, dest);
+}
+
+void X86Encoder::vector_op(X86VectorOp op, const X86VectorRegister& src2, const X86VectorRegister& src1, const X86VectorRegister& dest, uint8_t imm)
+{
+	const auto &encoding = vector_op_encodings[op];
+	assert(!encoding.unary);
+
+	if(_use_avx) {
+		encode_vector(encoding.prefix, encoding.map, encoding.opcode, vector_reg_number(dest), vector_reg_number(src1), src2);
+	} else {
+		if(vector_reg_number(dest) != vector_reg_number(src1)) {
+			assert(vector_reg_number(dest) != vector_reg_number(src2));
+			movdqa(src1, dest);
+		}
+		encode_vector(encoding.prefix, encoding.map, encoding.opcode, vector_reg_number(dest), -1, src2);
+	}
+
+	if(encoding.has_imm) {
+		emit8(imm);
+	}
+}
+
+void X86Encoder::vector_op(X86VectorOp op, const X86Memory& src2, const X86VectorRegister& src1, const X86VectorRegister& dest, uint8_t imm)
+{
+	const auto &encoding = vector_op_encodings[op];
+	assert(!encoding.unary);
+	assert(_use_avx);
+
+	encode_vector(encoding.prefix, encoding.map, encoding.opcode, vector_reg_number(dest), vector_reg_number(src1), src2);
+
+	if(encoding.has_imm) {
+		emit8(imm);
+	}
+}
+
+void X86Encoder::vector_op(X86VectorOp op, const X86VectorRegister& src, const X86VectorRegister& dest, uint8_t imm)
+{
+	const auto &encoding = vector_op_encodings[op];
+	assert(encoding.unary);
+
+	if(encoding.extension >= 0) {
+		// Shifts by an immediate encode the register in the rm field
+		if(_use_avx) {
+			encode_vector(encoding.prefix, encoding.map, encoding.opcode, encoding.extension, vector_reg_number(dest), src);
+		} else {
+			if(vector_reg_number(dest) != vector_reg_number(src)) {
+				movdqa(src, dest);
+			}
+			encode_vector(encoding.prefix, encoding.map, encoding.opcode, encoding.extension, -1, dest);
+		}
+	} else if(op == VOP_PBROADCASTD && !_use_avx) {
+		// vpbroadcastd is AVX2 only
+		vector_op(VOP_PSHUFD, src, dest, 0);
+		return;
+	} else {
+		encode_vector(encoding.prefix, encoding.map, encoding.opcode, vector_reg_number(dest), -1, src);
+	}
+
+	if(encoding.has_imm) {
+		emit8(imm);
+	}
+}
+
 void X86Encoder::movfs(uint32_t off, const X86Register& dst)
 {
 	assert(false);
@@ -1441,9 +1770,10 @@ void X86Encoder::call(void *target, const X86Register &reg)
 
 	int64_t offset = ptr - buffer_ptr;
 	if(!_support_relocation || offset > INT32_MAX || offset < INT32_MIN) {
-		mov((uint64_t)target, reg);
+		mov_host(target, reg);
 		call(reg);
 	} else {
+		mark_position_dependent();
 		emit8(0xe8);
 		emit32(offset);
 	}
@@ -1473,9 +1803,10 @@ void X86Encoder::jmp(void *target, const X86Register &reg)
 
 	int64_t offset = ptr - buffer_ptr;
 	if(!_support_relocation || offset > INT32_MAX || offset < INT32_MIN) {
-		mov((uint64_t)target, reg);
+		mov_host(target, reg);
 		jmp(reg);
 	} else {
+		mark_position_dependent();
 		emit8(0xe9);
 		emit32(offset);
 	}
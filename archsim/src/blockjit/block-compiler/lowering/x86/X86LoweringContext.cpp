@@ -151,12 +151,42 @@ bool X86LoweringContext::Prepare(const TranslationContext &ctx)
 	A(IRInstruction::VMULF, VMulF);
 	A(IRInstruction::VMULI, VMulI);
 
+	// The remaining vector lowerers assume SSE4.2, so on older hosts blocks
+	// using them fail to lower and stay in the interpreter
+	if(X86Encoder::HostSupportsSSE42()) {
+		A(IRInstruction::VANDI, VBitwise);
+		A(IRInstruction::VORI, VBitwise);
+		A(IRInstruction::VXORI, VBitwise);
+
+		A(IRInstruction::VCMPEQI, VCmpEQI);
+		A(IRInstruction::VCMPGTI, VCmpGTI);
+		A(IRInstruction::VCMPGTEI, VCmpGTI);
+		A(IRInstruction::VCMPEQF, VCmpF);
+		A(IRInstruction::VCMPLTF, VCmpF);
+		A(IRInstruction::VCMPLTEF, VCmpF);
+
+		A(IRInstruction::VMINI, VMinMaxI);
+		A(IRInstruction::VMAXI, VMinMaxI);
+		A(IRInstruction::VMINUI, VMinMaxI);
+		A(IRInstruction::VMAXUI, VMinMaxI);
+		A(IRInstruction::VMINF, VMinMaxF);
+		A(IRInstruction::VMAXF, VMinMaxF);
+
+		A(IRInstruction::VSHUFFLE, VShuffle);
+		A(IRInstruction::VSX, VExtend);
+		A(IRInstruction::VZX, VExtend);
+		A(IRInstruction::VTRUNC, VTrunc);
+	}
+
 	if(archsim::options::SystemMemoryModel == "cache") {
 		A(IRInstruction::READ_MEM, ReadMemCache);
 		A(IRInstruction::WRITE_MEM, WriteMemCache);
 	} else if(archsim::options::SystemMemoryModel == "user") {
 		A(IRInstruction::READ_MEM, ReadMemUser);
 		A(IRInstruction::WRITE_MEM, WriteMemUser);
+	} else if(archsim::options::SystemMemoryModel == "shadow") {
+		A(IRInstruction::READ_MEM, ReadMemShadow);
+		A(IRInstruction::WRITE_MEM, WriteMemShadow);
 	} else {
 		A(IRInstruction::READ_MEM, ReadMemGeneric);
 		A(IRInstruction::WRITE_MEM, WriteMemGeneric);
@@ -421,3 +451,83 @@ void X86LoweringContext::encode_operand_to_reg(const shared::IROperand *operand,
 			assert(false);
 	}
 }
+
+void X86LoweringContext::load_vector_operand(const shared::IROperand *operand, const X86VectorRegister& reg)
+{
+	if(operand->is_constant()) {
+		if(operand->value == 0) {
+			GetEncoder().pxor(reg, reg);
+		} else {
+			GetEncoder().mov(operand->value, BLKJIT_TEMPS_0(8));
+			GetEncoder().movq(BLKJIT_TEMPS_0(8), reg);
+		}
+		return;
+	}
+
+	assert(operand->is_vreg());
+
+	if(operand->is_alloc_reg()) {
+		GetEncoder().movq(register_from_operand(operand, 8), reg);
+		return;
+	}
+
+	assert(operand->is_alloc_stack());
+	auto mem = stack_from_operand(operand);
+	switch(operand->size) {
+		case 16:
+			GetEncoder().movdqu(mem, reg);
+			break;
+		case 8:
+			GetEncoder().movq(mem, reg);
+			break;
+		case 4:
+			GetEncoder().movd(mem, reg);
+			break;
+		default:
+			GetEncoder().movzx(operand->size, mem, BLKJIT_TEMPS_0(4));
+			GetEncoder().movq(BLKJIT_TEMPS_0(8), reg);
+			break;
+	}
+}
+
+void X86LoweringContext::store_vector_operand(const X86VectorRegister& reg, const shared::IROperand *operand)
+{
+	assert(operand->is_vreg());
+
+	if(operand->is_alloc_reg()) {
+		GetEncoder().movq(reg, register_from_operand(operand, 8));
+		return;
+	}
+
+	assert(operand->is_alloc_stack());
+	auto mem = stack_from_operand(operand);
+	switch(operand->size) {
+		case 16:
+			GetEncoder().movdqu(reg, mem);
+			break;
+		case 8:
+			GetEncoder().movq(reg, mem);
+			break;
+		case 4:
+			GetEncoder().movd(reg, mem);
+			break;
+		default:
+			GetEncoder().movq(reg, BLKJIT_TEMPS_0(8));
+			GetEncoder().mov(BLKJIT_TEMPS_0(operand->size), mem);
+			break;
+	}
+}
+
+void X86LoweringContext::lower_vector_binary(X86VectorOp op, const shared::IROperand *lhs, const shared::IROperand *rhs, const shared::IROperand *dest, uint8_t imm)
+{
+	load_vector_operand(lhs, BLKJIT_FP_0);
+
+	if(GetEncoder().isAVXEnabled() && rhs->is_alloc_stack() && rhs->size == 16) {
+		GetEncoder().vector_op(op, stack_from_operand(rhs), BLKJIT_FP_0, BLKJIT_FP_0, imm);
+	} else {
+		load_vector_operand(rhs, BLKJIT_FP_1);
+		GetEncoder().vector_op(op, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_0, imm);
+	}
+
+	store_vector_operand(BLKJIT_FP_0, dest);
+}
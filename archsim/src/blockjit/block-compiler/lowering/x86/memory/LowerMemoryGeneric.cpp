@@ -139,16 +139,16 @@ bool LowerWriteMemGeneric::Lower(const captive::shared::IRInstruction *&insn)
 
 	switch(value->size) {
 		case 1:
-			Encoder().mov((uint64_t)cpuWrite8, BLKJIT_RETURN(8));
+			Encoder().mov_host((void*)cpuWrite8, BLKJIT_RETURN(8));
 			break;
 		case 2:
-			Encoder().mov((uint64_t)cpuWrite16, BLKJIT_RETURN(8));
+			Encoder().mov_host((void*)cpuWrite16, BLKJIT_RETURN(8));
 			break;
 		case 4:
-			Encoder().mov((uint64_t)cpuWrite32, BLKJIT_RETURN(8));
+			Encoder().mov_host((void*)cpuWrite32, BLKJIT_RETURN(8));
 			break;
 		case 8:
-			Encoder().mov((uint64_t)cpuWrite64, BLKJIT_RETURN(8));
+			Encoder().mov_host((void*)cpuWrite64, BLKJIT_RETURN(8));
 			break;
 		default:
 			UNEXPECTED;
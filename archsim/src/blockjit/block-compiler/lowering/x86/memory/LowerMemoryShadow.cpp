@@ -0,0 +1,267 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * LowerMemoryShadow.cpp
+ *
+ * Memory accesses through a shadow page table (see
+ * abi/memory/ShadowPageTable.h). The host page for the guest address is
+ * loaded straight out of the table, so there is no tag to check. Pages which
+ * have not been filled in yet, and accesses which cross a page boundary,
+ * take the generic out-of-line path through the memory interface.
+ */
+
+#include "blockjit/block-compiler/lowering/x86/X86LoweringContext.h"
+#include "blockjit/block-compiler/lowering/x86/X86Lowerers.h"
+#include "blockjit/block-compiler/lowering/Finalisation.h"
+#include "blockjit/block-compiler/block-compiler.h"
+#include "blockjit/translation-context.h"
+#include "blockjit/block-compiler/lowering/x86/X86BlockjitABI.h"
+#include "translate/jit_funs.h"
+#include "abi/Address.h"
+
+using namespace captive::arch::jit::lowering::x86;
+using namespace captive::shared;
+
+class LowerMemShadowReadFinaliser : public captive::arch::jit::lowering::X86Finalisation
+{
+public:
+	LowerMemShadowReadFinaliser(uint32_t interface_id, uint32_t miss_in, uint32_t crossing_in, uint32_t return_target, uint32_t access_size, const X86Register &dest_reg, uint32_t live_regs) :
+		interface_id_(interface_id), miss_in_(miss_in), crossing_in_(crossing_in), return_target_(return_target), access_size_(access_size), destination_(dest_reg), live_regs_(live_regs)
+	{
+
+	}
+
+	virtual ~LowerMemShadowReadFinaliser() {}
+
+	bool FinaliseX86(captive::arch::jit::lowering::x86::X86LoweringContext &ctx)
+	{
+		auto &encoder = ctx.GetEncoder();
+
+		*(uint32_t*)(encoder.get_buffer() + miss_in_) = encoder.current_offset() - miss_in_ - 4;
+		if(crossing_in_)
+			*(uint32_t*)(encoder.get_buffer() + crossing_in_) = encoder.current_offset() - crossing_in_ - 4;
+
+		X86LoweringContext::stack_map_t stack_map;
+		bool fix_stack;
+		ctx.emit_save_reg_state(3, stack_map, fix_stack, live_regs_);
+
+		// The guest address is still in ARG1
+		encoder.mov(BLKJIT_CPUSTATE_REG, BLKJIT_ARG0(8));
+		encoder.mov(interface_id_, BLKJIT_ARG2(4));
+
+		switch(access_size_) {
+			case 1:
+				encoder.call((void*)blkRead8, BLKJIT_RETURN(8));
+				break;
+			case 2:
+				encoder.call((void*)blkRead16, BLKJIT_RETURN(8));
+				break;
+			case 4:
+				encoder.call((void*)blkRead32, BLKJIT_RETURN(8));
+				break;
+			case 8:
+				encoder.call((void*)blkRead64, BLKJIT_RETURN(8));
+				break;
+			default:
+				UNEXPECTED;
+		}
+		encoder.mov(REGS_RAX(access_size_), destination_);
+
+		ctx.emit_restore_reg_state(fix_stack, live_regs_);
+
+		encoder.jmp_offset(return_target_ - encoder.current_offset() - 5);
+		return true;
+	}
+
+private:
+	uint32_t interface_id_;
+
+	// The offsets of the relocations for the jumps into this finalisation
+	uint32_t miss_in_;
+	uint32_t crossing_in_;
+
+	// The offset of the instruction to return to once the fallback is complete
+	uint32_t return_target_;
+
+	uint32_t access_size_;
+	const X86Register &destination_;
+	uint32_t live_regs_;
+};
+
+class LowerMemShadowWriteFinaliser : public captive::arch::jit::lowering::X86Finalisation
+{
+public:
+	LowerMemShadowWriteFinaliser(uint32_t interface_id, uint32_t miss_in, uint32_t crossing_in, uint32_t return_target, uint32_t access_size, const X86Register &value_reg) :
+		interface_id_(interface_id), miss_in_(miss_in), crossing_in_(crossing_in), return_target_(return_target), access_size_(access_size), value_(value_reg)
+	{
+
+	}
+
+	virtual ~LowerMemShadowWriteFinaliser() {}
+
+	bool FinaliseX86(captive::arch::jit::lowering::x86::X86LoweringContext &ctx)
+	{
+		auto &encoder = ctx.GetEncoder();
+
+		*(uint32_t*)(encoder.get_buffer() + miss_in_) = encoder.current_offset() - miss_in_ - 4;
+		if(crossing_in_)
+			*(uint32_t*)(encoder.get_buffer() + crossing_in_) = encoder.current_offset() - crossing_in_ - 4;
+
+		X86LoweringContext::stack_map_t stack_map;
+		bool fix_stack;
+		ctx.emit_save_reg_state(4, stack_map, fix_stack);
+
+		// The guest address is still in ARG1, and the value is either in its
+		// allocated register or in a temporary.
+		encoder.mov(BLKJIT_ARG1(8), BLKJIT_ARG2(8));
+		encoder.mov(value_, BLKJIT_ARG3(access_size_ == 8 ? 8 : 4));
+		encoder.mov(interface_id_, BLKJIT_ARG1(4));
+		ctx.load_state_field("thread_ptr", BLKJIT_ARG0(8));
+
+		switch(access_size_) {
+			case 1:
+				encoder.call((void*)cpuWrite8, BLKJIT_RETURN(8));
+				break;
+			case 2:
+				encoder.call((void*)cpuWrite16, BLKJIT_RETURN(8));
+				break;
+			case 4:
+				encoder.call((void*)cpuWrite32, BLKJIT_RETURN(8));
+				break;
+			case 8:
+				encoder.call((void*)cpuWrite64, BLKJIT_RETURN(8));
+				break;
+			default:
+				UNEXPECTED;
+		}
+
+		ctx.emit_restore_reg_state(fix_stack);
+
+		encoder.jmp_offset(return_target_ - encoder.current_offset() - 5);
+		return true;
+	}
+
+private:
+	uint32_t interface_id_;
+
+	// The offsets of the relocations for the jumps into this finalisation
+	uint32_t miss_in_;
+	uint32_t crossing_in_;
+
+	// The offset of the instruction to return to once the fallback is complete
+	uint32_t return_target_;
+
+	uint32_t access_size_;
+	const X86Register &value_;
+};
+
+// Compute the guest address into ARG1, then look up the host page in the
+// shadow page table for the interface, leaving it in RETURN and the page
+// offset in ARG2. Emits the jumps to the out-of-line path.
+static void EmitShadowLookup(X86LoweringContext &ctx, const IROperand *interface, const IROperand *offset, const IROperand *disp, uint32_t access_size, uint32_t &miss_offset, uint32_t &crossing_offset)
+{
+	auto &encoder = ctx.GetEncoder();
+
+	if(offset->is_alloc_reg()) {
+		if(disp->value != 0) {
+			encoder.lea(X86Memory::get(ctx.register_from_operand(offset, 4), disp->value), BLKJIT_ARG1(4));
+		} else {
+			encoder.mov(ctx.register_from_operand(offset, 4), BLKJIT_ARG1(4));
+		}
+	} else if(offset->is_alloc_stack()) {
+		encoder.mov(ctx.stack_from_operand(offset), BLKJIT_ARG1(4));
+		if(disp->value != 0) {
+			encoder.add(disp->value, BLKJIT_ARG1(4));
+		}
+	} else {
+		assert(false);
+	}
+
+	encoder.mov(BLKJIT_ARG1(4), BLKJIT_ARG2(4));
+	encoder.shr(12, BLKJIT_ARG2(4));
+	ctx.load_state_field("shadow_page_table_" + std::to_string(interface->value), BLKJIT_RETURN(8));
+	encoder.mov(X86Memory::get(BLKJIT_RETURN(8), BLKJIT_ARG2(8), 8), BLKJIT_RETURN(8));
+	encoder.test(BLKJIT_RETURN(8), BLKJIT_RETURN(8));
+	encoder.je_reloc(miss_offset);
+
+	encoder.mov(BLKJIT_ARG1(4), BLKJIT_ARG2(4));
+	encoder.andd(archsim::Address::PageMask, BLKJIT_ARG2(4));
+
+	// Host pages aren't necessarily contiguous, so accesses which run off
+	// the end of the page need to be split up by the memory interface.
+	crossing_offset = 0;
+	if(access_size > 1) {
+		encoder.cmp(archsim::Address::PageSize - access_size, BLKJIT_ARG2(4));
+		encoder.ja_reloc(crossing_offset);
+	}
+}
+
+bool LowerReadMemShadow::Lower(const captive::shared::IRInstruction *&insn)
+{
+	const IROperand *interface = &insn->operands[0];
+	const IROperand *offset = &insn->operands[1];
+	const IROperand *disp = &insn->operands[2];
+	const IROperand *dest = &insn->operands[3];
+
+	assert(interface->is_constant());
+	assert(disp->is_constant());
+
+	// liveness is broken in some situations apparently
+	uint32_t live_regs = 0xffffffff;
+	// Don't save/restore the destination reg
+	if(dest->is_alloc_reg()) live_regs &= ~(1 << dest->alloc_data);
+
+	// We can have the situation where dest is not allocated because the intervening register write has been eliminated
+	const auto &dest_reg = dest->is_alloc_reg() ? GetLoweringContext().register_from_operand(dest) : GetLoweringContext().get_temp(0, dest->size);
+
+	uint32_t miss_offset, crossing_offset;
+	EmitShadowLookup(GetLoweringContext(), interface, offset, disp, dest->size, miss_offset, crossing_offset);
+
+	Encoder().mov(X86Memory::get(BLKJIT_RETURN(8), BLKJIT_ARG2(8), 1), dest_reg);
+	GetLoweringContext().RegisterFinalisation(new LowerMemShadowReadFinaliser(interface->value, miss_offset, crossing_offset, Encoder().current_offset(), dest->size, dest_reg, live_regs));
+
+	if(dest->is_alloc_stack()) {
+		Encoder().mov(dest_reg, GetLoweringContext().stack_from_operand(dest));
+	}
+
+	insn++;
+	return true;
+}
+
+bool LowerWriteMemShadow::Lower(const captive::shared::IRInstruction *&insn)
+{
+	const IROperand *interface = &insn->operands[0];
+	const IROperand *value = &insn->operands[1];
+	const IROperand *disp = &insn->operands[2];
+	const IROperand *offset = &insn->operands[3];
+
+	assert(interface->is_constant());
+	assert(disp->is_constant());
+
+	// Values which aren't already in a register are loaded into a temporary
+	// first, since the out-of-line path can't address the stack frame.
+	const X86Register *value_reg;
+	if(value->is_alloc_reg()) {
+		value_reg = &GetLoweringContext().register_from_operand(value);
+	} else if(value->is_alloc_stack()) {
+		value_reg = &GetLoweringContext().get_temp(0, value->size);
+		Encoder().mov(GetLoweringContext().stack_from_operand(value), *value_reg);
+	} else if(value->is_constant()) {
+		value_reg = &GetLoweringContext().get_temp(0, value->size);
+		Encoder().mov(value->value, *value_reg);
+	} else {
+		assert(false);
+		return false;
+	}
+
+	uint32_t miss_offset, crossing_offset;
+	EmitShadowLookup(GetLoweringContext(), interface, offset, disp, value->size, miss_offset, crossing_offset);
+
+	Encoder().mov(*value_reg, X86Memory::get(BLKJIT_RETURN(8), BLKJIT_ARG2(8), 1));
+
+	auto &wide_value_reg = value->is_alloc_reg() ? GetLoweringContext().register_from_operand(value, value->size == 8 ? 8 : 4) : GetLoweringContext().get_temp(0, value->size == 8 ? 8 : 4);
+	GetLoweringContext().RegisterFinalisation(new LowerMemShadowWriteFinaliser(interface->value, miss_offset, crossing_offset, Encoder().current_offset(), value->size, wide_value_reg));
+
+	insn++;
+	return true;
+}
@@ -0,0 +1,42 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+
+#include "blockjit/block-compiler/lowering/x86/X86LoweringContext.h"
+#include "blockjit/block-compiler/lowering/x86/X86Lowerers.h"
+#include "blockjit/block-compiler/block-compiler.h"
+#include "blockjit/translation-context.h"
+#include "blockjit/block-compiler/lowering/x86/X86BlockjitABI.h"
+#include "util/LogContext.h"
+
+UseLogContext(LogBlockJit)
+
+using namespace captive::arch::jit::lowering::x86;
+using namespace captive::shared;
+
+bool LowerVBitwise::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &lhs = insn->operands[1];
+	const IROperand &rhs = insn->operands[2];
+	const IROperand &dest = insn->operands[3];
+
+	// Element size doesn't matter here
+	X86VectorOp op;
+	switch(insn->type) {
+		case IRInstruction::VANDI:
+			op = VOP_PAND;
+			break;
+		case IRInstruction::VORI:
+			op = VOP_POR;
+			break;
+		case IRInstruction::VXORI:
+			op = VOP_PXOR;
+			break;
+		default:
+			CANTLOWER;
+	}
+
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
+
+	insn++;
+	return true;
+}
@@ -20,7 +20,115 @@ bool LowerVCmpEQI::Lower(const captive::shared::IRInstruction*& insn)
 	const IROperand &rhs = insn->operands[2];
 	const IROperand &dest = insn->operands[3];
 
-	UNIMPLEMENTED;
+	X86VectorOp op;
+	switch(lhs.size / width.value) {
+		case 1:
+			op = VOP_PCMPEQB;
+			break;
+		case 2:
+			op = VOP_PCMPEQW;
+			break;
+		case 4:
+			op = VOP_PCMPEQD;
+			break;
+		case 8:
+			op = VOP_PCMPEQQ;
+			break;
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+			return false;
+	}
+
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
+
+	insn++;
+	return true;
+}
+
+bool LowerVCmpGTI::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &lhs = insn->operands[1];
+	const IROperand &rhs = insn->operands[2];
+	const IROperand &dest = insn->operands[3];
+
+	// Signed comparisons
+	X86VectorOp op;
+	switch(lhs.size / width.value) {
+		case 1:
+			op = VOP_PCMPGTB;
+			break;
+		case 2:
+			op = VOP_PCMPGTW;
+			break;
+		case 4:
+			op = VOP_PCMPGTD;
+			break;
+		case 8:
+			op = VOP_PCMPGTQ;
+			break;
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+			return false;
+	}
+
+	if(insn->type == IRInstruction::VCMPGTI) {
+		GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
+	} else {
+		// lhs >= rhs is !(rhs > lhs)
+		GetLoweringContext().load_vector_operand(&rhs, BLKJIT_FP_0);
+		GetLoweringContext().load_vector_operand(&lhs, BLKJIT_FP_1);
+		Encoder().vector_op(op, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_0);
+
+		Encoder().vector_op(VOP_PCMPEQD, BLKJIT_FP_1, BLKJIT_FP_1, BLKJIT_FP_1);
+		Encoder().vector_op(VOP_PXOR, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_0);
+		GetLoweringContext().store_vector_operand(BLKJIT_FP_0, &dest);
+	}
+
+	insn++;
+	return true;
+}
+
+bool LowerVCmpF::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &lhs = insn->operands[1];
+	const IROperand &rhs = insn->operands[2];
+	const IROperand &dest = insn->operands[3];
+
+	X86VectorOp op;
+	switch(lhs.size / width.value) {
+		case 4:
+			op = VOP_CMPPS;
+			break;
+		case 8:
+			op = VOP_CMPPD;
+			break;
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+			return false;
+	}
+
+	// Ordered predicates, so comparisons with NaN are false. EQ is EQ_OQ, but
+	// LT and LE are the signalling LT_OS and LE_OS: the quiet forms need a VEX
+	// encoding, and the SSE and AVX encodings should behave the same. They
+	// only differ in raising the invalid flag for quiet NaNs, which is masked.
+	uint8_t predicate;
+	switch(insn->type) {
+		case IRInstruction::VCMPEQF:
+			predicate = 0; // EQ_OQ
+			break;
+		case IRInstruction::VCMPLTF:
+			predicate = 1; // LT_OS
+			break;
+		case IRInstruction::VCMPLTEF:
+			predicate = 2; // LE_OS
+			break;
+		default:
+			CANTLOWER;
+	}
+
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest, predicate);
 
 	insn++;
 	return true;
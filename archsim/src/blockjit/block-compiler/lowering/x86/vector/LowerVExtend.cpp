@@ -0,0 +1,101 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+
+#include "blockjit/block-compiler/lowering/x86/X86LoweringContext.h"
+#include "blockjit/block-compiler/lowering/x86/X86Lowerers.h"
+#include "blockjit/block-compiler/block-compiler.h"
+#include "blockjit/translation-context.h"
+#include "blockjit/block-compiler/lowering/x86/X86BlockjitABI.h"
+#include "util/LogContext.h"
+
+UseLogContext(LogBlockJit)
+
+using namespace captive::arch::jit::lowering::x86;
+using namespace captive::shared;
+
+bool LowerVExtend::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &src = insn->operands[1];
+	const IROperand &dest = insn->operands[2];
+
+	bool is_signed = insn->type == IRInstruction::VSX;
+	unsigned src_element = src.size / width.value;
+	unsigned dest_element = dest.size / width.value;
+
+	X86VectorOp op;
+	switch((src_element << 4) | dest_element) {
+		case 0x12:
+			op = is_signed ? VOP_PMOVSXBW : VOP_PMOVZXBW;
+			break;
+		case 0x14:
+			op = is_signed ? VOP_PMOVSXBD : VOP_PMOVZXBD;
+			break;
+		case 0x18:
+			op = is_signed ? VOP_PMOVSXBQ : VOP_PMOVZXBQ;
+			break;
+		case 0x24:
+			op = is_signed ? VOP_PMOVSXWD : VOP_PMOVZXWD;
+			break;
+		case 0x28:
+			op = is_signed ? VOP_PMOVSXWQ : VOP_PMOVZXWQ;
+			break;
+		case 0x48:
+			op = is_signed ? VOP_PMOVSXDQ : VOP_PMOVZXDQ;
+			break;
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot extend a vector from size " << (uint32_t)src.size << " to " << (uint32_t)dest.size << " with element count " << (uint32_t)width.value;
+			return false;
+	}
+
+	GetLoweringContext().load_vector_operand(&src, BLKJIT_FP_0);
+	Encoder().vector_op(op, BLKJIT_FP_0, BLKJIT_FP_0);
+	GetLoweringContext().store_vector_operand(BLKJIT_FP_0, &dest);
+
+	insn++;
+	return true;
+}
+
+bool LowerVTrunc::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &src = insn->operands[1];
+	const IROperand &dest = insn->operands[2];
+
+	unsigned src_element = src.size / width.value;
+	unsigned dest_element = dest.size / width.value;
+
+	if(dest_element >= src_element || !dest_element || (dest_element & (dest_element - 1)) || (src_element != 2 && src_element != 4 && src_element != 8)) {
+		LC_ERROR(LogBlockJit) << "Cannot truncate a vector from size " << (uint32_t)src.size << " to " << (uint32_t)dest.size << " with element count " << (uint32_t)width.value;
+		return false;
+	}
+
+	GetLoweringContext().load_vector_operand(&src, BLKJIT_FP_0);
+
+	// Halve the element size until it fits, packing the lanes into the bottom
+	// of the register. The signed packs saturate, so sign extend the part
+	// being kept first.
+	while(src_element > dest_element) {
+		switch(src_element) {
+			case 8:
+				Encoder().vector_op(VOP_PSHUFD, BLKJIT_FP_0, BLKJIT_FP_0, 0x08);
+				break;
+			case 4:
+				Encoder().vector_op(VOP_PSLLD, BLKJIT_FP_0, BLKJIT_FP_0, 16);
+				Encoder().vector_op(VOP_PSRAD, BLKJIT_FP_0, BLKJIT_FP_0, 16);
+				Encoder().vector_op(VOP_PACKSSDW, BLKJIT_FP_0, BLKJIT_FP_0, BLKJIT_FP_0);
+				break;
+			case 2:
+				Encoder().vector_op(VOP_PSLLW, BLKJIT_FP_0, BLKJIT_FP_0, 8);
+				Encoder().vector_op(VOP_PSRAW, BLKJIT_FP_0, BLKJIT_FP_0, 8);
+				Encoder().vector_op(VOP_PACKSSWB, BLKJIT_FP_0, BLKJIT_FP_0, BLKJIT_FP_0);
+				break;
+		}
+		src_element /= 2;
+	}
+
+	GetLoweringContext().store_vector_operand(BLKJIT_FP_0, &dest);
+
+	insn++;
+	return true;
+}
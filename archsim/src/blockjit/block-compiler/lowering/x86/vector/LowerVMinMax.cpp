@@ -0,0 +1,105 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+
+#include "blockjit/block-compiler/lowering/x86/X86LoweringContext.h"
+#include "blockjit/block-compiler/lowering/x86/X86Lowerers.h"
+#include "blockjit/block-compiler/block-compiler.h"
+#include "blockjit/translation-context.h"
+#include "blockjit/block-compiler/lowering/x86/X86BlockjitABI.h"
+#include "util/LogContext.h"
+
+UseLogContext(LogBlockJit)
+
+using namespace captive::arch::jit::lowering::x86;
+using namespace captive::shared;
+
+bool LowerVMinMaxI::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &lhs = insn->operands[1];
+	const IROperand &rhs = insn->operands[2];
+	const IROperand &dest = insn->operands[3];
+
+	bool is_max = insn->type == IRInstruction::VMAXI || insn->type == IRInstruction::VMAXUI;
+	bool is_unsigned = insn->type == IRInstruction::VMINUI || insn->type == IRInstruction::VMAXUI;
+
+	X86VectorOp op;
+	switch(lhs.size / width.value) {
+		case 1:
+			op = is_max ? (is_unsigned ? VOP_PMAXUB : VOP_PMAXSB) : (is_unsigned ? VOP_PMINUB : VOP_PMINSB);
+			break;
+		case 2:
+			op = is_max ? (is_unsigned ? VOP_PMAXUW : VOP_PMAXSW) : (is_unsigned ? VOP_PMINUW : VOP_PMINSW);
+			break;
+		case 4:
+			op = is_max ? (is_unsigned ? VOP_PMAXUD : VOP_PMAXSD) : (is_unsigned ? VOP_PMINUD : VOP_PMINSD);
+			break;
+		case 8: {
+			// No 64 bit min/max until AVX-512, so select with a pcmpgtq mask.
+			// Unsigned comparisons flip the sign bits first.
+			auto &ctx = GetLoweringContext();
+			ctx.load_vector_operand(&lhs, BLKJIT_FP_0);
+			ctx.load_vector_operand(&rhs, BLKJIT_FP_1);
+
+			if(is_unsigned) {
+				Encoder().vector_op(VOP_PCMPEQD, BLKJIT_FP_4, BLKJIT_FP_4, BLKJIT_FP_4);
+				Encoder().vector_op(VOP_PSLLQ, BLKJIT_FP_4, BLKJIT_FP_4, 63);
+				Encoder().vector_op(VOP_PXOR, BLKJIT_FP_4, BLKJIT_FP_0, BLKJIT_FP_2);
+				Encoder().vector_op(VOP_PXOR, BLKJIT_FP_4, BLKJIT_FP_1, BLKJIT_FP_3);
+				Encoder().vector_op(VOP_PCMPGTQ, BLKJIT_FP_3, BLKJIT_FP_2, BLKJIT_FP_2);
+			} else {
+				Encoder().vector_op(VOP_PCMPGTQ, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_2);
+			}
+
+			// FP_2 is set where lhs > rhs
+			const auto &if_set = is_max ? BLKJIT_FP_0 : BLKJIT_FP_1;
+			const auto &if_clear = is_max ? BLKJIT_FP_1 : BLKJIT_FP_0;
+			Encoder().vector_op(VOP_PAND, if_set, BLKJIT_FP_2, BLKJIT_FP_3);
+			Encoder().vector_op(VOP_PANDN, if_clear, BLKJIT_FP_2, BLKJIT_FP_2);
+			Encoder().vector_op(VOP_POR, BLKJIT_FP_3, BLKJIT_FP_2, BLKJIT_FP_0);
+
+			ctx.store_vector_operand(BLKJIT_FP_0, &dest);
+
+			insn++;
+			return true;
+		}
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+			return false;
+	}
+
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
+
+	insn++;
+	return true;
+}
+
+bool LowerVMinMaxF::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &lhs = insn->operands[1];
+	const IROperand &rhs = insn->operands[2];
+	const IROperand &dest = insn->operands[3];
+
+	bool is_max = insn->type == IRInstruction::VMAXF;
+
+	// These follow the x86 rules, so if either lane is a NaN (or both are
+	// zero) the result is the rhs lane.
+	X86VectorOp op;
+	switch(lhs.size / width.value) {
+		case 4:
+			op = is_max ? VOP_MAXPS : VOP_MINPS;
+			break;
+		case 8:
+			op = is_max ? VOP_MAXPD : VOP_MINPD;
+			break;
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+			return false;
+	}
+
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
+
+	insn++;
+	return true;
+}
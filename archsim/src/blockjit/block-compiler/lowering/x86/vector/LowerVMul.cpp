@@ -20,27 +20,81 @@ bool LowerVMulI::Lower(const captive::shared::IRInstruction*& insn)
 	const IROperand &rhs = insn->operands[2];
 	const IROperand &dest = insn->operands[3];
 
-	// No straightforward parallel integer multiply in SSE, so for now just do two dumb multiplies
-	// also assume basic 2x32 multiply for now
-	assert(lhs.size == 8);
-	assert(width.value == 2);
-
-	const auto &lhsr = GetLoweringContext().register_from_operand(&lhs);
-	const auto &rhsr = GetLoweringContext().register_from_operand(&rhs);
-	const auto &destr = GetLoweringContext().register_from_operand(&dest);
-
-	// start with top multiply
-	Encoder().mov(lhsr, BLKJIT_TEMPS_0(8));
-	Encoder().shr(32, BLKJIT_TEMPS_0(8));
-	Encoder().mov(rhsr, destr);
-	Encoder().shr(32, destr);
-	Encoder().imul(BLKJIT_TEMPS_0(8), destr);
-	Encoder().shl(32, destr);
-
-	// now do bottom multiply
-	Encoder().mov(GetLoweringContext().register_from_operand(&rhs, 4), BLKJIT_TEMPS_0(4));
-	Encoder().imul(GetLoweringContext().register_from_operand(&lhs, 4), BLKJIT_TEMPS_0(4));
-	Encoder().orr(BLKJIT_TEMPS_0(8), destr);
+	auto &ctx = GetLoweringContext();
+
+	switch(lhs.size / width.value) {
+		case 2:
+			ctx.lower_vector_binary(VOP_PMULLW, &lhs, &rhs, &dest);
+			break;
+		case 4:
+			if(X86Encoder::HostSupportsSSE42()) {
+				ctx.lower_vector_binary(VOP_PMULLD, &lhs, &rhs, &dest);
+				break;
+			}
+
+			// PMULLD is SSE4.1, so multiply the even and odd lanes as 64-bit
+			// products and merge the low halves
+			ctx.load_vector_operand(&lhs, BLKJIT_FP_0);
+			ctx.load_vector_operand(&rhs, BLKJIT_FP_1);
+
+			Encoder().vector_op(VOP_PMULUDQ, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_2);
+			Encoder().vector_op(VOP_PSRLQ, BLKJIT_FP_0, BLKJIT_FP_0, 32);
+			Encoder().vector_op(VOP_PSRLQ, BLKJIT_FP_1, BLKJIT_FP_1, 32);
+			Encoder().vector_op(VOP_PMULUDQ, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_3);
+			Encoder().vector_op(VOP_PSLLQ, BLKJIT_FP_3, BLKJIT_FP_3, 32);
+
+			// FP_4 = 0x00000000ffffffff in each quadword
+			Encoder().vector_op(VOP_PCMPEQD, BLKJIT_FP_4, BLKJIT_FP_4, BLKJIT_FP_4);
+			Encoder().vector_op(VOP_PSRLQ, BLKJIT_FP_4, BLKJIT_FP_4, 32);
+			Encoder().vector_op(VOP_PAND, BLKJIT_FP_4, BLKJIT_FP_2, BLKJIT_FP_2);
+
+			Encoder().vector_op(VOP_POR, BLKJIT_FP_3, BLKJIT_FP_2, BLKJIT_FP_0);
+			ctx.store_vector_operand(BLKJIT_FP_0, &dest);
+			break;
+		case 1: {
+			// There's no byte multiply, so multiply the even and odd bytes
+			// separately as words and then merge the low byte of each product
+			ctx.load_vector_operand(&lhs, BLKJIT_FP_0);
+			ctx.load_vector_operand(&rhs, BLKJIT_FP_1);
+
+			// FP_4 = 0x00ff in each word
+			Encoder().vector_op(VOP_PCMPEQW, BLKJIT_FP_4, BLKJIT_FP_4, BLKJIT_FP_4);
+			Encoder().vector_op(VOP_PSRLW, BLKJIT_FP_4, BLKJIT_FP_4, 8);
+
+			// Even bytes
+			Encoder().vector_op(VOP_PMULLW, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_2);
+			Encoder().vector_op(VOP_PAND, BLKJIT_FP_4, BLKJIT_FP_2, BLKJIT_FP_2);
+
+			// Odd bytes: (lhs >> 8) * (rhs & 0xff00) leaves the product in the high byte
+			Encoder().vector_op(VOP_PSRLW, BLKJIT_FP_0, BLKJIT_FP_3, 8);
+			Encoder().vector_op(VOP_PANDN, BLKJIT_FP_1, BLKJIT_FP_4, BLKJIT_FP_0);
+			Encoder().vector_op(VOP_PMULLW, BLKJIT_FP_0, BLKJIT_FP_3, BLKJIT_FP_3);
+
+			Encoder().vector_op(VOP_POR, BLKJIT_FP_3, BLKJIT_FP_2, BLKJIT_FP_0);
+			ctx.store_vector_operand(BLKJIT_FP_0, &dest);
+			break;
+		}
+		case 8: {
+			// lo(a)*lo(b) + ((hi(a)*lo(b) + lo(a)*hi(b)) << 32)
+			ctx.load_vector_operand(&lhs, BLKJIT_FP_0);
+			ctx.load_vector_operand(&rhs, BLKJIT_FP_1);
+
+			Encoder().vector_op(VOP_PSRLQ, BLKJIT_FP_0, BLKJIT_FP_2, 32);
+			Encoder().vector_op(VOP_PMULUDQ, BLKJIT_FP_1, BLKJIT_FP_2, BLKJIT_FP_2);
+			Encoder().vector_op(VOP_PSRLQ, BLKJIT_FP_1, BLKJIT_FP_3, 32);
+			Encoder().vector_op(VOP_PMULUDQ, BLKJIT_FP_0, BLKJIT_FP_3, BLKJIT_FP_3);
+			Encoder().vector_op(VOP_PADDQ, BLKJIT_FP_3, BLKJIT_FP_2, BLKJIT_FP_2);
+			Encoder().vector_op(VOP_PSLLQ, BLKJIT_FP_2, BLKJIT_FP_2, 32);
+
+			Encoder().vector_op(VOP_PMULUDQ, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_0);
+			Encoder().vector_op(VOP_PADDQ, BLKJIT_FP_2, BLKJIT_FP_0, BLKJIT_FP_0);
+			ctx.store_vector_operand(BLKJIT_FP_0, &dest);
+			break;
+		}
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+			return false;
+	}
 
 	insn++;
 	return true;
@@ -53,43 +107,21 @@ bool LowerVMulF::Lower(const captive::shared::IRInstruction*& insn)
 	const IROperand &rhs = insn->operands[2];
 	const IROperand &dest = insn->operands[3];
 
-	if(lhs.is_alloc_reg()) {
-		Encoder().movq(GetLoweringContext().register_from_operand(&lhs), BLKJIT_FP_0);
-	} else  if(lhs.is_alloc_stack()) {
-		Encoder().mov(GetLoweringContext().stack_from_operand(&lhs), BLKJIT_TEMPS_0(lhs.size));
-		Encoder().movq(BLKJIT_TEMPS_0(lhs.size), BLKJIT_FP_0);
-	} else {
-		assert(false);
-	}
-
-	if(rhs.is_alloc_reg()) {
-		Encoder().movq(GetLoweringContext().register_from_operand(&rhs), BLKJIT_FP_1);
-	} else  if(rhs.is_alloc_stack()) {
-		Encoder().mov(GetLoweringContext().stack_from_operand(&rhs), BLKJIT_TEMPS_0(rhs.size));
-		Encoder().movq(BLKJIT_TEMPS_0(rhs.size), BLKJIT_FP_1);
-	} else {
-		assert(false);
-	}
-
 	// emit instruction based on ELEMENT size (total vector size / number of elements)
+	X86VectorOp op;
 	switch(lhs.size / width.value) {
 		case 4:
-			Encoder().mulps(BLKJIT_FP_0, BLKJIT_FP_1);
+			op = VOP_MULPS;
 			break;
 		case 8:
-			Encoder().mulpd(BLKJIT_FP_0, BLKJIT_FP_1);
+			op = VOP_MULPD;
 			break;
 		default:
 			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
-			assert(false);
+			return false;
 	}
 
-	if(dest.is_alloc_reg()) {
-		Encoder().movq(BLKJIT_FP_1, GetLoweringContext().register_from_operand(&dest));
-	} else if(dest.is_alloc_stack()) {
-		Encoder().movq(BLKJIT_FP_1, BLKJIT_TEMPS_0(dest.size));
-		Encoder().mov(BLKJIT_TEMPS_0(dest.size), GetLoweringContext().stack_from_operand(&dest));
-	}
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
 
 	insn++;
 	return true;
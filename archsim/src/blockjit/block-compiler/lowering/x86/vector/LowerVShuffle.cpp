@@ -0,0 +1,45 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+
+#include "blockjit/block-compiler/lowering/x86/X86LoweringContext.h"
+#include "blockjit/block-compiler/lowering/x86/X86Lowerers.h"
+#include "blockjit/block-compiler/block-compiler.h"
+#include "blockjit/translation-context.h"
+#include "blockjit/block-compiler/lowering/x86/X86BlockjitABI.h"
+#include "util/LogContext.h"
+
+UseLogContext(LogBlockJit)
+
+using namespace captive::arch::jit::lowering::x86;
+using namespace captive::shared;
+
+bool LowerVShuffle::Lower(const captive::shared::IRInstruction*& insn)
+{
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &lhs = insn->operands[1];
+	const IROperand &rhs = insn->operands[2];
+	const IROperand &dest = insn->operands[3];
+
+	if(lhs.size != width.value || lhs.size > 16) {
+		LC_ERROR(LogBlockJit) << "Cannot lower a shuffle with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+		return false;
+	}
+
+	auto &ctx = GetLoweringContext();
+	ctx.load_vector_operand(&lhs, BLKJIT_FP_0);
+	ctx.load_vector_operand(&rhs, BLKJIT_FP_1);
+
+	// pshufb only zeroes lanes with the top bit of the index set, so bias the
+	// indices so that anything out of range saturates to >= 0x80. Narrower
+	// vectors have zeroes in their upper lanes, so the same bias works.
+	Encoder().mov(0x70707070, BLKJIT_TEMPS_0(4));
+	Encoder().movq(BLKJIT_TEMPS_0(8), BLKJIT_FP_2);
+	Encoder().vector_op(VOP_PBROADCASTD, BLKJIT_FP_2, BLKJIT_FP_2);
+	Encoder().vector_op(VOP_PADDUSB, BLKJIT_FP_2, BLKJIT_FP_1, BLKJIT_FP_1);
+
+	Encoder().vector_op(VOP_PSHUFB, BLKJIT_FP_1, BLKJIT_FP_0, BLKJIT_FP_0);
+	ctx.store_vector_operand(BLKJIT_FP_0, &dest);
+
+	insn++;
+	return true;
+}
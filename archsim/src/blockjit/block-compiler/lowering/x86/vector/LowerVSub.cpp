@@ -20,44 +20,27 @@ bool LowerVSubI::Lower(const captive::shared::IRInstruction*& insn)
 	const IROperand &rhs = insn->operands[2];
 	const IROperand &dest = insn->operands[3];
 
-	// assume 2x32 for now
-	assert(width.value == 2);
-	assert(lhs.size == 8);
-
-	//TODO: make stack based accesses more efficient (movq from memory)
-	if(lhs.is_alloc_reg())
-		Encoder().movq(GetLoweringContext().register_from_operand(&lhs), BLKJIT_FP_1);
-	else {
-		Encoder().mov(GetLoweringContext().stack_from_operand(&lhs), BLKJIT_TEMPS_1(lhs.size));
-		Encoder().movq(BLKJIT_TEMPS_0(lhs.size), BLKJIT_FP_1);
-	}
-
-	if(rhs.is_alloc_reg())
-		Encoder().movq(GetLoweringContext().register_from_operand(&rhs), BLKJIT_FP_0);
-	else {
-		Encoder().mov(GetLoweringContext().stack_from_operand(&rhs), BLKJIT_TEMPS_0(rhs.size));
-		Encoder().movq(BLKJIT_TEMPS_0(lhs.size), BLKJIT_FP_0);
-	}
-
 	// emit instruction based on ELEMENT size (total vector size / number of elements)
+	X86VectorOp op;
 	switch(lhs.size / width.value) {
+		case 1:
+			op = VOP_PSUBB;
+			break;
+		case 2:
+			op = VOP_PSUBW;
+			break;
 		case 4:
-			Encoder().psubd(BLKJIT_FP_0, BLKJIT_FP_1);
+			op = VOP_PSUBD;
 			break;
 		case 8:
-			Encoder().psubq(BLKJIT_FP_0, BLKJIT_FP_1);
+			op = VOP_PSUBQ;
 			break;
 		default:
 			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
-			assert(false);
+			return false;
 	}
 
-	if(dest.is_alloc_reg())
-		Encoder().movq(BLKJIT_FP_1, GetLoweringContext().register_from_operand(&dest));
-	else  {
-		Encoder().movq(BLKJIT_FP_1, BLKJIT_TEMPS_0(dest.size));
-		Encoder().mov(BLKJIT_TEMPS_0(dest.size), GetLoweringContext().stack_from_operand(&dest));
-	}
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
 
 	insn++;
 	return true;
@@ -65,7 +48,27 @@ bool LowerVSubI::Lower(const captive::shared::IRInstruction*& insn)
 
 bool LowerVSubF::Lower(const captive::shared::IRInstruction*& insn)
 {
-	assert(false);
+	const IROperand &width = insn->operands[0]; // VECTOR width, i.e. number of elements
+	const IROperand &lhs = insn->operands[1];
+	const IROperand &rhs = insn->operands[2];
+	const IROperand &dest = insn->operands[3];
+
+	// emit instruction based on ELEMENT size (total vector size / number of elements)
+	X86VectorOp op;
+	switch(lhs.size / width.value) {
+		case 4:
+			op = VOP_SUBPS;
+			break;
+		case 8:
+			op = VOP_SUBPD;
+			break;
+		default:
+			LC_ERROR(LogBlockJit) << "Cannot lower an instruction with vector size " << (uint32_t)lhs.size << " and element count " << (uint32_t)width.value;
+			return false;
+	}
+
+	GetLoweringContext().lower_vector_binary(op, &lhs, &rhs, &dest);
+
 	insn++;
 	return true;
 }
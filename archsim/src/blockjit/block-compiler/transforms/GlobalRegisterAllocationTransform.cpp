@@ -33,7 +33,9 @@ GlobalRegisterAllocationTransform::~GlobalRegisterAllocationTransform()
  * or to the stack if there are none left. This is still not super smart since
  * it means that 'deeply' allocated registers will always go to the stack,
  * ignoring e.g. how frequently they are used. However it is good enough for
- * now.
+ * now. Vregs wider than 64 bits (i.e. 128 bit vectors) can't live in a GPR,
+ * so they have their own pool of virtual registers which always go to 16
+ * byte stack slots.
  *   Finally, go back through the IR and attach the allocations on to each
  * allocated vreg.
  *
@@ -41,6 +43,7 @@ GlobalRegisterAllocationTransform::~GlobalRegisterAllocationTransform()
 bool GlobalRegisterAllocationTransform::Apply(TranslationContext& ctx)
 {
 	std::vector<unsigned> vreg_begins(ctx.reg_count(), 0xffffffff), vreg_ends(ctx.reg_count(), 0);
+	std::vector<bool> vreg_wide(ctx.reg_count(), false);
 
 	for(unsigned insn_idx = 0; insn_idx < ctx.count(); ++insn_idx) {
 		auto insn = ctx.at(insn_idx);
@@ -48,6 +51,9 @@ bool GlobalRegisterAllocationTransform::Apply(TranslationContext& ctx)
 		for(unsigned op_idx = 0; op_idx < insn->operands.size(); op_idx++) {
 			auto &operand = insn->operands.at(op_idx);
 			if(operand.is_vreg()) {
+				if(operand.size > 8) {
+					vreg_wide[operand.get_vreg_idx()] = true;
+				}
 				if(vreg_begins[operand.get_vreg_idx()] > insn_idx) {
 					vreg_begins[operand.get_vreg_idx()] = insn_idx;
 				}
@@ -60,7 +66,8 @@ bool GlobalRegisterAllocationTransform::Apply(TranslationContext& ctx)
 
 	// first, reallocate vregs
 	std::vector<unsigned> allocations(ctx.reg_count(), 0xffffffff);
-	std::vector<unsigned> free_regs;
+	std::vector<unsigned> free_regs, free_wide_regs;
+	std::vector<bool> reg_wide;
 	unsigned next_free_reg = 0;
 	unsigned total_regs = 0;
 
@@ -69,22 +76,26 @@ bool GlobalRegisterAllocationTransform::Apply(TranslationContext& ctx)
 		for(unsigned op_idx = 0; op_idx < insn->operands.size(); op_idx++) {
 			auto &operand = insn->operands.at(op_idx);
 			if(operand.is_vreg()) {
+				bool wide = vreg_wide[operand.get_vreg_idx()];
+				auto &free_list = wide ? free_wide_regs : free_regs;
+
 				if(insn_idx == vreg_begins[operand.get_vreg_idx()]) {
 					// allocate a reg for vreg
 					int reg_id;
 
-					if(free_regs.size()) {
-						reg_id = free_regs.back();
-						free_regs.pop_back();
+					if(free_list.size()) {
+						reg_id = free_list.back();
+						free_list.pop_back();
 					} else {
 						reg_id = next_free_reg++;
+						reg_wide.push_back(wide);
 						total_regs++;
 					}
 
 					allocations[operand.get_vreg_idx()] = reg_id;
 				}
 				if(insn_idx == vreg_ends[operand.get_vreg_idx()]) {
-					free_regs.push_back(allocations[operand.get_vreg_idx()]);
+					free_list.push_back(allocations[operand.get_vreg_idx()]);
 				}
 			}
 		}
@@ -96,6 +107,9 @@ bool GlobalRegisterAllocationTransform::Apply(TranslationContext& ctx)
 	std::vector<std::pair<IROperand::IRAllocationMode, int>> allocation_info(total_regs, std::make_pair(IROperand::NOT_ALLOCATED, 0));
 	for(unsigned reg_idx = 0; reg_idx < total_regs; ++reg_idx) {
 		auto &allocation = allocation_info[reg_idx];
+		if(reg_wide[reg_idx]) {
+			continue;
+		}
 
 		if(regs_left) {
 			allocation = std::make_pair(IROperand::ALLOCATED_REG, num_allocable_registers_-regs_left);
@@ -107,6 +121,16 @@ bool GlobalRegisterAllocationTransform::Apply(TranslationContext& ctx)
 		}
 	}
 
+	// Wide registers go after all of the narrow ones, so that they're 16 byte
+	// aligned within the frame
+	next_stack_frame = (next_stack_frame + 15) & ~15u;
+	for(unsigned reg_idx = 0; reg_idx < total_regs; ++reg_idx) {
+		if(reg_wide[reg_idx]) {
+			allocation_info[reg_idx] = std::make_pair(IROperand::ALLOCATED_STACK, next_stack_frame);
+			next_stack_frame += 16;
+		}
+	}
+
 	for(unsigned insn_idx = 0; insn_idx < ctx.count(); ++insn_idx) {
 		auto insn = ctx.at(insn_idx);
 		for(unsigned op_idx = 0; op_idx < insn->operands.size(); op_idx++) {
@@ -140,6 +140,21 @@ struct captive::shared::insn_descriptor captive::shared::insn_descriptors[] = {
 	{ .mnemonic = "vcmpgtei",	.format = "NIIOXX", .has_side_effects = false },
 
 	{ .mnemonic = "vcmpltf",	.format = "NIIOXX", .has_side_effects = false },
+	{ .mnemonic = "vcmpeqf",	.format = "NIIOXX", .has_side_effects = false },
+	{ .mnemonic = "vcmpltef",	.format = "NIIOXX", .has_side_effects = false },
+
+	{ .mnemonic = "vmini",	.format = "NIIOXX", .has_side_effects = false },
+	{ .mnemonic = "vmaxi",	.format = "NIIOXX", .has_side_effects = false },
+	{ .mnemonic = "vminui",	.format = "NIIOXX", .has_side_effects = false },
+	{ .mnemonic = "vmaxui",	.format = "NIIOXX", .has_side_effects = false },
+	{ .mnemonic = "vminf",	.format = "NIIOXX", .has_side_effects = false },
+	{ .mnemonic = "vmaxf",	.format = "NIIOXX", .has_side_effects = false },
+
+	{ .mnemonic = "vshuffle",	.format = "NIIOXX", .has_side_effects = false },
+
+	{ .mnemonic = "vsx",	.format = "NIOXXX", .has_side_effects = false },
+	{ .mnemonic = "vzx",	.format = "NIOXXX", .has_side_effects = false },
+	{ .mnemonic = "vtrunc",	.format = "NIOXXX", .has_side_effects = false },
 
 };
 
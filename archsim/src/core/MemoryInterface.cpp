@@ -18,9 +18,32 @@ TranslationResult MMUTranslationProvider::Translate(Address virt_addr, Address&
 	info.Write = is_write;
 	info.Ring = thread_->GetExecutionRing();
 
+	SoftwareTLB::AccessKind kind = is_fetch ? SoftwareTLB::AccessFetch : is_write ? SoftwareTLB::AccessWrite : SoftwareTLB::AccessRead;
+	uint32_t asid = 0;
+	if(tlb_ != nullptr) {
+		asid = mmu_->GetASID();
+		if(tlb_->Lookup(virt_addr, asid, info.Ring, kind, phys_addr)) {
+			if(is_fetch) {
+				thread_->GetMetrics().ITLBHits++;
+			} else {
+				thread_->GetMetrics().DTLBHits++;
+			}
+			return TranslationResult::OK;
+		}
+
+		if(is_fetch) {
+			thread_->GetMetrics().ITLBMisses++;
+		} else {
+			thread_->GetMetrics().DTLBMisses++;
+		}
+	}
+
 	auto result = mmu_->Translate(thread_, virt_addr, phys_addr, info);
 	switch(result) {
 		case archsim::abi::devices::MMU::TXLN_OK:
+			if(tlb_ != nullptr) {
+				tlb_->Insert(virt_addr, asid, info.Ring, kind, phys_addr);
+			}
 			return TranslationResult::OK;
 		default:
 			return TranslationResult::NotPresent;
@@ -199,9 +222,13 @@ MemoryResult LegacyFetchMemoryInterface::Write128(Address address, uint128_t dat
 	UNIMPLEMENTED;
 }
 
-CachedLegacyMemoryInterface::CachedLegacyMemoryInterface(int index, archsim::abi::memory::MemoryModel& mem_model, archsim::core::thread::ThreadInstance* thread) : mem_model_(mem_model), thread_(thread)
+CachedLegacyMemoryInterface::CachedLegacyMemoryInterface(int index, archsim::abi::memory::MemoryModel& mem_model, archsim::core::thread::ThreadInstance* thread, archsim::abi::memory::ShadowPageTable *shadow) : mem_model_(mem_model), shadow_(shadow), thread_(thread)
 {
 	cache_offset_ = thread->GetStateBlock().AddBlock("memory_cache_" + std::to_string(index), sizeof (struct Cache));
+	if(shadow_ != nullptr) {
+		thread->GetStateBlock().AddBlock("shadow_page_table_" + std::to_string(index), sizeof(void*));
+		thread->GetStateBlock().SetEntry<void**>("shadow_page_table_" + std::to_string(index), shadow_->GetTable());
+	}
 	Invalidate();
 }
 
@@ -211,6 +238,9 @@ void CachedLegacyMemoryInterface::Invalidate()
 		i.tag = Address(1);
 		i.data = nullptr;
 	}
+	if(shadow_ != nullptr) {
+		shadow_->Clear();
+	}
 }
 
 CachedLegacyMemoryInterface::Cache* CachedLegacyMemoryInterface::GetCache()
@@ -219,21 +249,26 @@ CachedLegacyMemoryInterface::Cache* CachedLegacyMemoryInterface::GetCache()
 }
 
 
-void CachedLegacyMemoryInterface::LoadEntryFor(struct CacheEntry *entry, Address addr)
+bool CachedLegacyMemoryInterface::LoadEntryFor(struct CacheEntry *entry, Address addr)
 {
 	void *ptr;
 
 	bool success = mem_model_.LockRegion(addr.PageBase(), Address::PageSize, ptr);
 	if(!success) {
-		throw std::logic_error("Memory error.");
+		return false;
 	}
 
 	entry->data = ptr;
 	entry->tag = addr.PageBase();
+	return true;
 }
 
 void* CachedLegacyMemoryInterface::GetPtr(Address addr)
 {
+	if(shadow_ != nullptr) {
+		return shadow_->Translate(addr);
+	}
+
 	struct Cache *cache = GetCache();
 
 	// get cache index
@@ -242,7 +277,9 @@ void* CachedLegacyMemoryInterface::GetPtr(Address addr)
 	auto &entry = cache->cache[index];
 	if(entry.tag != addr.PageBase()) {
 //		LC_DEBUG1(LogCacheMemory) << "Cache miss: loading for " << addr;
-		LoadEntryFor(&entry, addr);
+		if(!LoadEntryFor(&entry, addr)) {
+			return nullptr;
+		}
 	}
 
 	auto ptr = (void*)(((char*)entry.data) + addr.GetPageOffset());
@@ -253,7 +290,11 @@ void* CachedLegacyMemoryInterface::GetPtr(Address addr)
 
 MemoryResult CachedLegacyMemoryInterface::Read8(Address address, uint8_t& data)
 {
-	data = *(uint8_t*)GetPtr(address);
+	auto ptr = (uint8_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	data = *ptr;
 	return MemoryResult::OK;
 }
 
@@ -262,7 +303,11 @@ MemoryResult CachedLegacyMemoryInterface::Read16(Address address, uint16_t& data
 	if(address.GetPageIndex() != (address + 1).GetPageIndex()) {
 		return Read(address, (char*)&data, 2);
 	}
-	data = *(uint16_t*)GetPtr(address);
+	auto ptr = (uint16_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	data = *ptr;
 	return MemoryResult::OK;
 }
 
@@ -271,7 +316,11 @@ MemoryResult CachedLegacyMemoryInterface::Read32(Address address, uint32_t& data
 	if(address.GetPageIndex() != (address + 3).GetPageIndex()) {
 		return Read(address, (char*)&data, 4);
 	}
-	data = *(uint32_t*)GetPtr(address);
+	auto ptr = (uint32_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	data = *ptr;
 	return MemoryResult::OK;
 }
 
@@ -280,9 +329,14 @@ MemoryResult CachedLegacyMemoryInterface::Read64(Address address, uint64_t& data
 	if(address.GetPageIndex() != (address + 7).GetPageIndex()) {
 		return Read(address, (char*)&data, 8);
 	}
-	data = *(uint64_t*)GetPtr(address);
+	auto ptr = (uint64_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	data = *ptr;
 	return MemoryResult::OK;
 }
+
 MemoryResult CachedLegacyMemoryInterface::Read128(Address address, uint128_t& data)
 {
 	return Read(address, (char*)&data, 16);
@@ -290,7 +344,11 @@ MemoryResult CachedLegacyMemoryInterface::Read128(Address address, uint128_t& da
 
 MemoryResult CachedLegacyMemoryInterface::Write8(Address address, uint8_t data)
 {
-	*(uint8_t*)GetPtr(address) = data;
+	auto ptr = (uint8_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	*ptr = data;
 	return MemoryResult::OK;
 }
 
@@ -299,7 +357,11 @@ MemoryResult CachedLegacyMemoryInterface::Write16(Address address, uint16_t data
 	if(address.GetPageIndex() != (address + 1).GetPageIndex()) {
 		return Write(address, (char*)&data, 2);
 	}
-	*(uint16_t*)GetPtr(address) = data;
+	auto ptr = (uint16_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	*ptr = data;
 	return MemoryResult::OK;
 }
 
@@ -308,7 +370,11 @@ MemoryResult CachedLegacyMemoryInterface::Write32(Address address, uint32_t data
 	if(address.GetPageIndex() != (address + 3).GetPageIndex()) {
 		return Write(address, (char*)&data, 4);
 	}
-	*(uint32_t*)GetPtr(address) = data;
+	auto ptr = (uint32_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	*ptr = data;
 	return MemoryResult::OK;
 }
 
@@ -317,7 +383,11 @@ MemoryResult CachedLegacyMemoryInterface::Write64(Address address, uint64_t data
 	if(address.GetPageIndex() != (address + 7).GetPageIndex()) {
 		return Write(address, (char*)&data, 8);
 	}
-	*(uint64_t*)GetPtr(address) = data;
+	auto ptr = (uint64_t*)GetPtr(address);
+	if(ptr == nullptr) {
+		return MemoryResult::Error;
+	}
+	*ptr = data;
 	return MemoryResult::OK;
 }
 
@@ -329,7 +399,10 @@ MemoryResult CachedLegacyMemoryInterface::Write128(Address address, uint128_t da
 MemoryResult CachedLegacyMemoryInterface::Read(Address addr, char* data, size_t len)
 {
 	for(int i = 0; i < len; ++i) {
-		Read8(addr + i, *(uint8_t*)(data + i));
+		auto result = Read8(addr + i, *(uint8_t*)(data + i));
+		if(result != MemoryResult::OK) {
+			return result;
+		}
 	}
 	return MemoryResult::OK;
 }
@@ -337,7 +410,10 @@ MemoryResult CachedLegacyMemoryInterface::Read(Address addr, char* data, size_t
 MemoryResult CachedLegacyMemoryInterface::Write(Address addr, const char* data, size_t len)
 {
 	for(int i = 0; i < len; ++i) {
-		Write8(addr + i, *(uint8_t*)(data + i));
+		auto result = Write8(addr + i, *(uint8_t*)(data + i));
+		if(result != MemoryResult::OK) {
+			return result;
+		}
 	}
 	return MemoryResult::OK;
 }
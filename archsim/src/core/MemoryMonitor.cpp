@@ -2,6 +2,10 @@
 
 #include "core/MemoryMonitor.h"
 
+#include <cstdlib>
+#include <new>
+#include <thread>
+
 DeclareLogContext(LogMonitor, "Monitor");
 
 using namespace archsim::core;
@@ -66,11 +70,199 @@ void BaseMemoryMonitor::Notify(archsim::core::thread::ThreadInstance* thread, Ad
 {
 	Lock(thread);
 	LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << " notified " << addr;
-	for(const auto &monitor : monitors_) {
-		if(monitor.first != thread->GetThreadID() && addr == monitor.second) {
-			monitors_.erase(monitor.first);
+	auto monitor = monitors_.begin();
+	while(monitor != monitors_.end()) {
+		if(monitor->first != thread->GetThreadID() && addr == monitor->second) {
+			monitor = monitors_.erase(monitor);
+		} else {
+			++monitor;
 		}
 	}
 
 	Unlock(thread);
 }
+
+const unsigned ShardedMemoryMonitor::kMaxThreads;
+
+ShardedMemoryMonitor::ShardedMemoryMonitor() : slot_count_(0), global_active_(false), global_owner_(nullptr)
+{
+	static_assert(alignof(Stripe) == alignof(Slot) && sizeof(Stripe) % alignof(Slot) == 0, "Slots must follow the stripes without padding");
+
+	if(posix_memalign(&storage_, alignof(Stripe), sizeof(Stripe) * kStripeCount + sizeof(Slot) * kMaxThreads) != 0) {
+		throw std::bad_alloc();
+	}
+	stripes_ = (Stripe *)storage_;
+	slots_ = (Slot *)(stripes_ + kStripeCount);
+
+	for(unsigned i = 0; i < kStripeCount; ++i) {
+		new (&stripes_[i]) Stripe();
+		stripes_[i].Word = 0;
+	}
+
+	for(unsigned i = 0; i < kMaxThreads; ++i) {
+		auto &slot = *new (&slots_[i]) Slot();
+		slot.Owner = nullptr;
+		slot.Valid = false;
+		slot.Version = 0;
+		slot.HeldStripe = -1;
+		slot.Busy = false;
+	}
+}
+
+ShardedMemoryMonitor::~ShardedMemoryMonitor()
+{
+	for(unsigned i = 0; i < kMaxThreads; ++i) {
+		slots_[i].~Slot();
+	}
+	for(unsigned i = 0; i < kStripeCount; ++i) {
+		stripes_[i].~Stripe();
+	}
+	free(storage_);
+}
+
+ShardedMemoryMonitor::Slot &ShardedMemoryMonitor::GetSlot(archsim::core::thread::ThreadInstance* thread)
+{
+	unsigned id = thread->GetThreadID();
+	if(id >= kMaxThreads) {
+		LC_ERROR(LogMonitor) << "Thread " << id << ": too many threads for the monitor (maximum " << kMaxThreads << ")";
+		abort();
+	}
+
+	// Slots are indexed by thread ID, so two threads sharing an ID would
+	// release each other's stripes. Catch that rather than corrupting the
+	// stripe table.
+	auto &slot = slots_[id];
+	if(slot.Owner.load(std::memory_order_relaxed) != thread) {
+		archsim::core::thread::ThreadInstance *expected = nullptr;
+		if(!slot.Owner.compare_exchange_strong(expected, thread)) {
+			LC_ERROR(LogMonitor) << "Thread " << id << ": monitor slot is already owned by another thread with the same ID";
+			abort();
+		}
+
+		// Remember how many slots are in use, so that Lock only has to
+		// wait for those
+		unsigned count = slot_count_.load(std::memory_order_relaxed);
+		while(id >= count && !slot_count_.compare_exchange_weak(count, id + 1));
+	}
+
+	return slot;
+}
+
+void ShardedMemoryMonitor::ReleaseStripe(Slot& slot)
+{
+	// Clearing the lock bit and incrementing the version are the same addition
+	stripes_[slot.HeldStripe].Word.fetch_add(1, std::memory_order_release);
+	slot.HeldStripe = -1;
+	slot.Busy.store(false, std::memory_order_release);
+}
+
+void ShardedMemoryMonitor::Lock(archsim::core::thread::ThreadInstance* thread)
+{
+	if(global_owner_.load() == thread) {
+		LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << ": already had monitor lock";
+		return;
+	}
+
+	global_lock_.lock();
+	global_owner_ = thread;
+	global_active_ = true;
+
+	// Wait for any store-exclusives which started before we took the lock.
+	// Later ones will see global_active_ and back off.
+	unsigned count = slot_count_;
+	for(unsigned i = 0; i < count; ++i) {
+		while(slots_[i].Busy.load()) {
+			std::this_thread::yield();
+		}
+	}
+
+	LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << ": locked monitor";
+}
+
+void ShardedMemoryMonitor::Unlock(archsim::core::thread::ThreadInstance* thread)
+{
+	// We might be unlocking after a fault part way through a store-exclusive
+	auto &slot = GetSlot(thread);
+	if(slot.HeldStripe >= 0) {
+		ReleaseStripe(slot);
+	}
+
+	if(global_owner_.load() == thread) {
+		global_active_ = false;
+		global_owner_ = nullptr;
+		global_lock_.unlock();
+		LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << ": unlocked monitor";
+	}
+}
+
+void ShardedMemoryMonitor::AcquireMonitor(archsim::core::thread::ThreadInstance* thread, Address addr)
+{
+	auto &slot = GetSlot(thread);
+
+	// If a store-exclusive is in progress on this stripe then it will bump the
+	// version when it finishes, so there's no need to wait for it.
+	slot.Version = stripes_[GetStripeIndex(addr)].Word.load(std::memory_order_acquire) >> 1;
+	slot.ReservedAddress = addr;
+	slot.Valid = true;
+
+	LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << " took monitor on " << addr;
+}
+
+bool ShardedMemoryMonitor::LockMonitor(archsim::core::thread::ThreadInstance* thread, Address addr)
+{
+	auto &slot = GetSlot(thread);
+
+	// A store-exclusive always consumes the reservation
+	bool valid = slot.Valid && slot.ReservedAddress == addr;
+	slot.Valid = false;
+
+	if(!valid) {
+		LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << " failed to lock on " << addr << " (no reservation)";
+		return false;
+	}
+
+	slot.Busy = true;
+	while(global_active_.load() && global_owner_.load() != thread) {
+		slot.Busy = false;
+		{
+			std::lock_guard<std::mutex> l(global_lock_);
+		}
+		slot.Busy = true;
+	}
+
+	unsigned index = GetStripeIndex(addr);
+	uint64_t expected = slot.Version << 1;
+	if(!stripes_[index].Word.compare_exchange_strong(expected, expected | 1, std::memory_order_acquire)) {
+		slot.Busy.store(false, std::memory_order_release);
+		LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << " failed to lock on " << addr;
+		return false;
+	}
+
+	slot.HeldStripe = index;
+	LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << " successfully locked on " << addr;
+	return true;
+}
+
+void ShardedMemoryMonitor::UnlockMonitor(archsim::core::thread::ThreadInstance* thread, Address addr)
+{
+	auto &slot = GetSlot(thread);
+	if(slot.HeldStripe >= 0) {
+		ReleaseStripe(slot);
+	}
+
+	LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << " unlocked monitor";
+}
+
+void ShardedMemoryMonitor::Notify(archsim::core::thread::ThreadInstance* thread, Address addr)
+{
+	auto &slot = GetSlot(thread);
+	unsigned index = GetStripeIndex(addr);
+
+	// If we hold the stripe, the version is bumped when we release it.
+	// Otherwise bump it now, leaving the lock bit alone.
+	if(slot.HeldStripe != (int)index) {
+		stripes_[index].Word.fetch_add(2, std::memory_order_release);
+	}
+
+	LC_DEBUG1(LogMonitor) << "Thread " << thread->GetThreadID() << " notified " << addr;
+}
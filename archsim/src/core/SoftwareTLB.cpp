@@ -0,0 +1,132 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "core/SoftwareTLB.h"
+
+#include <cstring>
+
+using namespace archsim;
+
+SoftwareTLB::SoftwareTLB(util::PubSubContext& pubsub, uint32_t page_bits) : page_bits_(page_bits), page_mask_((1ULL << page_bits) - 1), pending_(false), pending_iflush_(false), pending_dflush_(false), subscriber_(pubsub)
+{
+	Flush();
+	memset(ivictim_, 0, sizeof(ivictim_));
+	memset(dvictim_, 0, sizeof(dvictim_));
+
+	subscriber_.Subscribe(PubSubType::ITlbFullFlush, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::ITlbEntryFlush, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::DTlbFullFlush, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::DTlbEntryFlush, InvalidateCallback, this);
+}
+
+void SoftwareTLB::InvalidateCallback(PubSubType::PubSubType type, void* ctx, const void* data)
+{
+	SoftwareTLB *tlb = (SoftwareTLB*)ctx;
+
+	std::lock_guard<std::mutex> l(tlb->pending_lock_);
+	switch(type) {
+		case PubSubType::ITlbFullFlush:
+			tlb->pending_iflush_ = true;
+			break;
+		case PubSubType::ITlbEntryFlush:
+			tlb->pending_ipages_.push_back((uint64_t)data);
+			break;
+		case PubSubType::DTlbFullFlush:
+			tlb->pending_dflush_ = true;
+			break;
+		case PubSubType::DTlbEntryFlush:
+			tlb->pending_dpages_.push_back((uint64_t)data);
+			break;
+		default:
+			break;
+	}
+	tlb->pending_.store(true, std::memory_order_release);
+}
+
+void SoftwareTLB::ApplyInvalidations()
+{
+	std::lock_guard<std::mutex> l(pending_lock_);
+	pending_.store(false, std::memory_order_relaxed);
+
+	if(pending_iflush_) {
+		FlushSide(itlb_);
+	} else {
+		for(auto addr : pending_ipages_) {
+			FlushPage(itlb_, Address(addr));
+		}
+	}
+
+	if(pending_dflush_) {
+		FlushSide(dtlb_);
+	} else {
+		for(auto addr : pending_dpages_) {
+			FlushPage(dtlb_, Address(addr));
+		}
+	}
+
+	pending_iflush_ = pending_dflush_ = false;
+	pending_ipages_.clear();
+	pending_dpages_.clear();
+}
+
+void SoftwareTLB::Flush()
+{
+	FlushSide(itlb_);
+	FlushSide(dtlb_);
+}
+
+void SoftwareTLB::FlushSide(Entry (&side)[kSets][kWays])
+{
+	for(auto &set : side) {
+		for(auto &entry : set) {
+			entry.Page = kInvalidPage;
+			entry.Permissions = 0;
+		}
+	}
+}
+
+void SoftwareTLB::FlushPage(Entry (&side)[kSets][kWays], Address addr)
+{
+	// Guest TLB maintenance works on whole pages, which may be larger than
+	// our entries
+	Address::underlying_t first = addr.GetPageBase() >> page_bits_;
+	Address::underlying_t last = (addr.GetPageBase() + Address::PageSize - 1) >> page_bits_;
+
+	for(Address::underlying_t page = first; page <= last; ++page) {
+		for(auto &entry : side[page % kSets]) {
+			if(entry.Page == page) {
+				entry.Page = kInvalidPage;
+				entry.Permissions = 0;
+			}
+		}
+	}
+}
+
+void SoftwareTLB::Insert(Address virt_addr, uint32_t asid, uint32_t ring, AccessKind kind, Address phys_addr)
+{
+	Address::underlying_t page = virt_addr.Get() >> page_bits_;
+	Address::underlying_t phys_page = phys_addr.Get() & ~page_mask_;
+	Entry *set = GetSet(kind, page);
+
+	// If the page is already present with other permissions, add to them
+	for(uint32_t way = 0; way < kWays; ++way) {
+		Entry &entry = set[way];
+		if(entry.Page == page && entry.ASID == asid && entry.Ring == ring) {
+			if(entry.PhysPage != phys_page) {
+				entry.PhysPage = phys_page;
+				entry.Permissions = 0;
+			}
+			entry.Permissions |= GetPermission(kind);
+			return;
+		}
+	}
+
+	uint8_t &victim = (kind == AccessFetch ? ivictim_ : dvictim_)[page % kSets];
+	Entry &entry = set[victim];
+	victim = (victim + 1) % kWays;
+
+	entry.Page = page;
+	entry.PhysPage = phys_page;
+	entry.ASID = asid;
+	entry.Ring = ring;
+	entry.Permissions = GetPermission(kind);
+}
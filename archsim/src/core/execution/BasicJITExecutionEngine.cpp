@@ -41,7 +41,7 @@ void flush_txlns_callback(PubSubType::PubSubType type, void *context, const void
 	}
 }
 
-BasicJITExecutionEngine::BasicJITExecutionEngine(uint64_t max_code_size) : phys_block_profile_(mem_allocator_), subscribed_(false), flush_txlns_(0), flush_all_txlns_(0), max_code_size_(max_code_size)
+BasicJITExecutionEngine::BasicJITExecutionEngine(uint64_t max_code_size) : phys_block_profile_(mem_allocator_, &chain_table_), subscribed_(false), flush_txlns_(0), flush_all_txlns_(0), max_code_size_(max_code_size)
 {
 
 }
@@ -49,12 +49,14 @@ BasicJITExecutionEngine::BasicJITExecutionEngine(uint64_t max_code_size) : phys_
 
 void BasicJITExecutionEngine::FlushTxlns()
 {
+	chain_table_.UnlinkAll();
 	virt_block_cache_.Invalidate();
 	flush_txlns_ = 1;
 }
 
 void BasicJITExecutionEngine::FlushAllTxlns()
 {
+	chain_table_.UnlinkAll();
 	virt_block_cache_.Invalidate();
 	flush_all_txlns_ = 1;
 	flush_txlns_ = 1;
@@ -67,6 +69,8 @@ void BasicJITExecutionEngine::FlushTxlnCache()
 
 void BasicJITExecutionEngine::FlushTxlnsFeature()
 {
+	// A chained block may depend on features which its predecessor did not
+	chain_table_.UnlinkAll();
 	for(auto i : GetThreads()) {
 		virt_block_cache_.InvalidateFeatures(i->GetFeatures().GetAvailableMask());
 	}
@@ -74,6 +78,9 @@ void BasicJITExecutionEngine::FlushTxlnsFeature()
 
 void BasicJITExecutionEngine::InvalidateRegion(Address addr)
 {
+	// The page's code is not freed until the next garbage collection, but we
+	// must stop chaining into it straight away.
+	chain_table_.UnlinkPage(addr);
 	phys_block_profile_.MarkPageDirty(addr);
 }
 
@@ -88,16 +95,38 @@ void BasicJITExecutionEngine::checkFlushTxlns()
 	}
 }
 
-void BasicJITExecutionEngine::checkCodeSize()
+void BasicJITExecutionEngine::checkCodeSize(thread::ThreadInstance *thread)
 {
 	if(max_code_size_ == 0) {
 		return;
 	}
-	if(phys_block_profile_.GetTotalCodeSize() > max_code_size_) {
+	if(phys_block_profile_.GetTotalCodeSize() <= max_code_size_) {
+		return;
+	}
+
+	// Evict pages which have not been used recently until there is some
+	// headroom, so that we don't end up back here on the next translation.
+	uint64_t old_size = phys_block_profile_.GetTotalCodeSize();
+	uint64_t evicted_pages = phys_block_profile_.EvictPages(max_code_size_ - max_code_size_ / 4);
+
+	// Translations cannot be moved once they have been chained to, so the
+	// allocator can only release a chunk once everything in it has been
+	// evicted. If the surviving translations are spread too thinly over the
+	// chunks, start again from scratch.
+	if(mem_allocator_.GetFootprint() > 2 * max_code_size_) {
+		LC_DEBUG1(LogBasicJIT) << "Code cache is fragmented (" << mem_allocator_.GetFootprint() << " bytes mapped), flushing";
 		phys_block_profile_.Invalidate();
-		virt_block_cache_.Invalidate();
+		thread->GetMetrics().JITCodeFlushes++;
 	}
 
+	// Any of the evicted translations may be in the virtual cache
+	virt_block_cache_.Invalidate();
+
+	uint64_t evicted_bytes = old_size - phys_block_profile_.GetTotalCodeSize();
+	LC_DEBUG1(LogBasicJIT) << "Evicted " << evicted_pages << " pages (" << evicted_bytes << " bytes) from the code cache";
+
+	thread->GetMetrics().JITEvictedPages.inc(evicted_pages);
+	thread->GetMetrics().JITEvictedBytes.inc(evicted_bytes);
 }
 
 
@@ -119,6 +148,7 @@ template<typename PC_t> ExecutionResult BasicJITExecutionEngine::ExecuteLoop(Exe
 		}
 
 		checkFlushTxlns();
+		checkPendingTranslations(thread);
 
 		if(thread->HasMessage()) {
 			auto result = thread->HandleMessage();
@@ -145,7 +175,9 @@ template<typename PC_t> ExecutionResult BasicJITExecutionEngine::ExecuteLoop(Exe
 				thread->GetMetrics().JITTime.Stop();
 			}
 		} else {
-			if(!translateBlock(thread, Address(*pc_ptr), false, false)) {
+			// Chained blocks never return to this loop, so don't chain if we need
+			// to trace between blocks
+			if(!translateBlock(thread, Address(*pc_ptr), thread->GetTraceSource() == nullptr, false)) {
 				// failed to decode a block: abort
 				if(verbose) {
 					thread->GetMetrics().SelfRuntime.Stop();
@@ -170,20 +202,44 @@ template<typename PC_t> void BasicJITExecutionEngine::ExecuteInnerLoop(Execution
 {
 	auto thread = ctx->GetThread();
 	auto regfile = thread->GetRegisterFile();
+	auto state_block = thread->GetStateBlock().GetData();
+
+	// Blocks which leave through an unlinked chain site report the site here
+	auto chain_exit = (archsim::blockjit::BlockChainTable::chain_site_t*)((uint8_t*)state_block + thread->GetStateBlock().GetDescriptor().GetBlockOffset("ChainExit"));
 
 	while(!thread->HasMessage()) {
 		uint64_t pc = *(PC_t*)(pc_ptr);
 
-		uint64_t entry_idx = pc & BLOCKCACHE_MASK;
-		entry_idx >>= BLOCKCACHE_INSTRUCTION_SHIFT;
-
 		const auto & entry  = virt_block_cache_.GetEntry(Address(pc));
 
-		if(entry.virt_tag == pc) {
-			entry.ptr(regfile, thread->GetStateBlock().GetData());
-		} else {
-			return;
+		if(entry.virt_tag != pc) {
+			break;
+		}
+
+		// The chain site must be consumed before we return to the outer loop,
+		// since the code containing it could be freed there.
+		if(*chain_exit != nullptr) {
+			linkChainSite(thread, *chain_exit, Address(pc), entry.ptr);
+			*chain_exit = nullptr;
 		}
+
+		entry.ptr(regfile, state_block);
+	}
+
+	*chain_exit = nullptr;
+}
+
+void BasicJITExecutionEngine::linkChainSite(thread::ThreadInstance* thread, archsim::blockjit::BlockChainTable::chain_site_t site, Address target_pc, block_txln_fn target_fn)
+{
+	// Translate WITHOUT side effects: we only need to know which page the
+	// chain should be dropped with.
+	Address target_phys (0);
+	if(thread->GetFetchMI().PerformTranslation(target_pc, target_phys, false, true, false) != archsim::TranslationResult::OK) {
+		return;
+	}
+
+	if(!chain_table_.Link(site, target_fn, target_phys)) {
+		LC_DEBUG2(LogBasicJIT) << "Could not link chain site " << (void*)site << " to " << target_pc;
 	}
 }
 
@@ -203,6 +259,9 @@ ExecutionResult BasicJITExecutionEngine::Execute(ExecutionEngineThreadContext* c
 	ctx->GetThread()->GetStateBlock().AddBlock("BlockCache", sizeof(void*));
 	ctx->GetThread()->GetStateBlock().SetEntry<archsim::blockjit::BlockCacheEntry*>("BlockCache", virt_block_cache_.GetPtr());
 
+	ctx->GetThread()->GetStateBlock().AddBlock("ChainExit", sizeof(void*));
+	ctx->GetThread()->GetStateBlock().SetEntry<archsim::blockjit::BlockChainTable::chain_site_t>("ChainExit", nullptr);
+
 	std::unique_ptr<util::CounterTimerContext> timer_ctx;
 
 	if(archsim::options::Verbose) {
@@ -258,9 +317,11 @@ bool BasicJITExecutionEngine::lookupBlock(thread::ThreadInstance* thread, Addres
 	}
 }
 
-void BasicJITExecutionEngine::registerTranslation(Address phys_addr, Address virt_addr, archsim::blockjit::BlockTranslation& txln)
+void BasicJITExecutionEngine::registerTranslation(thread::ThreadInstance *thread, Address phys_addr, Address virt_addr, archsim::blockjit::BlockTranslation& txln)
 {
 	LC_DEBUG2(LogBasicJIT) << "Registering translation at " << virt_addr << "(" << phys_addr << ")";
-	phys_block_profile_.Insert(phys_addr, txln);
+	if(phys_block_profile_.Insert(phys_addr, txln)) {
+		thread->GetMetrics().JITRetranslations++;
+	}
 	virt_block_cache_.Insert(virt_addr, txln.GetFn(), txln.GetFeatures());
 }
@@ -16,11 +16,60 @@ using namespace archsim::core::execution;
 using namespace archsim::core::thread;
 
 
-BlockJITExecutionEngine::BlockJITExecutionEngine(gensim::blockjit::BaseBlockJITTranslate *translator) : BasicJITExecutionEngine(64*1024*1024), translator_(translator)
+BlockJITExecutionEngine::BlockJITExecutionEngine(gensim::blockjit::BaseBlockJITTranslate *translator) : BasicJITExecutionEngine((uint64_t)archsim::options::JitCodeCacheSize * 1024 * 1024), translator_(translator)
 {
 
 }
 
+void BlockJITExecutionEngine::Join()
+{
+	BasicJITExecutionEngine::Join();
+
+	// Every thread has stopped, so save the translations they made
+	if(archsim::options::JitSaveTranslations && persistent_txlns_.IsDirty()) {
+		persistent_txlns_.Save(archsim::options::JitTranslationCacheFile.GetValue(), persistent_context_);
+	}
+}
+
+void BlockJITExecutionEngine::InvalidateRegion(Address addr)
+{
+	BasicJITExecutionEngine::InvalidateRegion(addr);
+
+	std::lock_guard<std::mutex> l(page_hashes_lock_);
+	page_hashes_.erase(addr.GetPageBase());
+}
+
+std::string BlockJITExecutionEngine::getPersistentContext(ThreadInstance *thread)
+{
+	// Saved code depends on the layout of the register file (fixed by the
+	// architecture module) and of the state block, and on the host features
+	// used by the lowering
+	return thread->GetArch().GetName() + "/" + thread->GetStateBlock().GetDescriptor().GetLayoutSignature() + "/" + captive::arch::jit::lowering::GetNativeLoweringFeatures();
+}
+
+bool BlockJITExecutionEngine::getPageHash(ThreadInstance *thread, Address virt_pc, Address phys_pc, uint64_t &hash)
+{
+	{
+		std::lock_guard<std::mutex> l(page_hashes_lock_);
+		auto cached = page_hashes_.find(phys_pc.GetPageBase());
+		if(cached != page_hashes_.end()) {
+			hash = cached->second;
+			return true;
+		}
+	}
+
+	uint8_t page[Address::PageSize];
+	if(thread->GetFetchMI().Read(virt_pc.PageBase(), page, sizeof(page)) != archsim::MemoryResult::OK) {
+		return false;
+	}
+
+	hash = archsim::blockjit::PersistentTranslationCache::HashPage(page, sizeof(page));
+
+	std::lock_guard<std::mutex> l(page_hashes_lock_);
+	page_hashes_[phys_pc.GetPageBase()] = hash;
+	return true;
+}
+
 
 ExecutionEngineThreadContext* BlockJITExecutionEngine::GetNewContext(thread::ThreadInstance* thread)
 {
@@ -29,7 +78,7 @@ ExecutionEngineThreadContext* BlockJITExecutionEngine::GetNewContext(thread::Thr
 
 bool BlockJITExecutionEngine::translateBlock(ThreadInstance *thread, archsim::Address block_pc, bool support_chaining, bool support_profiling)
 {
-	checkCodeSize();
+	checkCodeSize(thread);
 
 	captive::shared::block_txln_fn fn;
 	if(lookupBlock(thread, block_pc, fn)) {
@@ -44,6 +93,31 @@ bool BlockJITExecutionEngine::translateBlock(ThreadInstance *thread, archsim::Ad
 	// we couldn't find the block in the physical profile, so create a new translation
 	thread->GetEmulationModel().GetSystem().GetCodeRegions().MarkRegionAsCode(PhysicalAddress(physaddr.PageBase().Get()));
 
+	// A translation saved by an earlier run can be used if it was made from
+	// the same code, and if we would have been able to save this translation.
+	bool persist = (archsim::options::JitLoadTranslations || archsim::options::JitSaveTranslations) && fault == archsim::TranslationResult::OK && translator_->CanPersistTranslations(thread);
+	uint64_t page_hash = 0;
+	if(persist) {
+		persist = getPageHash(thread, block_pc, physaddr, page_hash);
+	}
+
+	if(persist) {
+		std::call_once(persistent_txlns_init_, [this, thread]() {
+			persistent_context_ = getPersistentContext(thread);
+			if(archsim::options::JitLoadTranslations) {
+				persistent_txlns_.Load(archsim::options::JitTranslationCacheFile.GetValue(), persistent_context_);
+			}
+		});
+	}
+
+	if(persist && archsim::options::JitLoadTranslations) {
+		if(persistent_txlns_.Lookup(block_pc, page_hash, thread->GetModeID(), thread->GetFeatures(), GetMemAllocator(), txln)) {
+			LC_DEBUG4(LogBlockJitCpu) << "Loaded saved translation of block " << std::hex << block_pc.Get();
+			registerTranslation(thread, physaddr, block_pc, txln);
+			return true;
+		}
+	}
+
 	LC_DEBUG4(LogBlockJitCpu) << "Translating block " << std::hex << block_pc.Get();
 	auto *translate = translator_;
 	if(!support_chaining) translate->setSupportChaining(false);
@@ -52,12 +126,20 @@ bool BlockJITExecutionEngine::translateBlock(ThreadInstance *thread, archsim::Ad
 		translate->setSupportProfiling(true);
 	}
 
+	thread->GetMetrics().JITCompileTime.Start();
 	bool success = translate->translate_block(thread, block_pc, txln, GetMemAllocator());
+	thread->GetMetrics().JITCompileTime.Stop();
 
 	if(success) {
+		thread->GetMetrics().JITCodeSize.inc(txln.GetSize());
+
 		// we successfully created a translation, so add it to the physical profile
 		// and to the cache, since we'll probably need it again soon
-		registerTranslation(physaddr, block_pc, txln);
+		registerTranslation(thread, physaddr, block_pc, txln);
+
+		if(persist && archsim::options::JitSaveTranslations) {
+			persistent_txlns_.Record(block_pc, page_hash, thread->GetModeID(), txln);
+		}
 	} else {
 		// if we failed to produce a translation, then try and stop the simulation
 		LC_ERROR(LogBlockJitCpu) << "Failed to compile block! Aborting.";
@@ -101,7 +101,7 @@ static bool shunt_builtin_f64_is_qnan(archsim::core::thread::ThreadInstance* thr
 
 bool BlockLLVMExecutionEngine::translateBlock(thread::ThreadInstance* thread, archsim::Address block_pc, bool support_chaining, bool support_profiling)
 {
-	checkCodeSize();
+	checkCodeSize(thread);
 
 	captive::shared::block_txln_fn fn;
 	if(lookupBlock(thread, block_pc, fn)) {
@@ -167,7 +167,7 @@ bool BlockLLVMExecutionEngine::translateBlock(thread::ThreadInstance* thread, ar
 //			txln.Dump("llvm-bin-" + std::to_string(physaddr.Get()));
 //		}
 //
-//		registerTranslation(physaddr, block_pc, txln);
+//		registerTranslation(thread, physaddr, block_pc, txln);
 //
 //		return true;
 //	} else {
@@ -112,7 +112,7 @@ bool BlockToLLVMExecutionEngine::buildBlockJITIR(thread::ThreadInstance* thread,
 
 bool BlockToLLVMExecutionEngine::translateBlock(thread::ThreadInstance* thread, archsim::Address block_pc, bool support_chaining, bool support_profiling)
 {
-	checkCodeSize();
+	checkCodeSize(thread);
 
 	captive::shared::block_txln_fn fn;
 	if(lookupBlock(thread, block_pc, fn)) {
@@ -165,7 +165,7 @@ bool BlockToLLVMExecutionEngine::translateBlock(thread::ThreadInstance* thread,
 //			txln.Dump("llvm-bin-" + std::to_string(physaddr.Get()));
 //		}
 //
-//		registerTranslation(physaddr, block_pc, txln);
+//		registerTranslation(thread, physaddr, block_pc, txln);
 //
 //		return true;
 //	} else {
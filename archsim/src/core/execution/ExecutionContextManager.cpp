@@ -6,7 +6,7 @@ using namespace archsim;
 using namespace archsim::core::execution;
 using namespace archsim::core::thread;
 
-ExecutionContextManager::ExecutionContextManager() : state_(ExecutionState::Ready), trace_sink_(nullptr)
+ExecutionContextManager::ExecutionContextManager() : state_(ExecutionState::Ready), trace_sink_(nullptr), idle_threads_(0)
 {
 
 }
@@ -37,3 +37,49 @@ void ExecutionContextManager::Halt()
 		i->Halt();
 	}
 }
+
+void ExecutionContextManager::ThreadStarted(ThreadInstance* thread)
+{
+	std::lock_guard<std::mutex> lock(threads_lock_);
+	running_threads_.insert(thread);
+}
+
+void ExecutionContextManager::ThreadStopped(ThreadInstance* thread)
+{
+	std::lock_guard<std::mutex> lock(threads_lock_);
+	running_threads_.erase(thread);
+}
+
+bool ExecutionContextManager::ThreadIdle()
+{
+	std::lock_guard<std::mutex> lock(threads_lock_);
+	idle_threads_++;
+	return idle_threads_ >= running_threads_.size();
+}
+
+void ExecutionContextManager::ThreadWoken()
+{
+	std::lock_guard<std::mutex> lock(threads_lock_);
+	idle_threads_--;
+}
+
+uint32_t ExecutionContextManager::GetIdleThreadCount()
+{
+	std::lock_guard<std::mutex> lock(threads_lock_);
+	return idle_threads_;
+}
+
+void ExecutionContextManager::SignalEvent()
+{
+	// Signal the threads without holding the lock, since an idle thread
+	// holds its own lock while it reports itself as idle
+	std::vector<ThreadInstance*> threads;
+	{
+		std::lock_guard<std::mutex> lock(threads_lock_);
+		threads.assign(running_threads_.begin(), running_threads_.end());
+	}
+
+	for(auto thread : threads) {
+		thread->SignalEvent();
+	}
+}
@@ -1,7 +1,9 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 
 #include "core/execution/ExecutionEngine.h"
+#include "core/execution/ExecutionContextManager.h"
 #include "core/thread/ThreadInstance.h"
+#include "system.h"
 
 #include <cassert>
 
@@ -13,7 +15,11 @@ DeclareLogContext(LogExecutionEngine, "ExecutionEngine");
 
 void ExecutionEngineThreadContext::Execute()
 {
+	auto &ecm = thread_->GetEmulationModel().GetSystem().GetECM();
+
+	ecm.ThreadStarted(thread_);
 	engine_->Execute(this);
+	ecm.ThreadStopped(thread_);
 }
 
 void ExecutionEngineThreadContext::Start()
@@ -7,15 +7,9 @@
 
 using namespace archsim::core::execution;
 
-InterpreterExecutionEngineThreadContext::InterpreterExecutionEngineThreadContext(ExecutionEngine* engine, thread::ThreadInstance* thread) : ExecutionEngineThreadContext(engine, thread)
+InterpreterExecutionEngineThreadContext::InterpreterExecutionEngineThreadContext(ExecutionEngine* engine, thread::ThreadInstance* thread) : ExecutionEngineThreadContext(engine, thread), predecode_cache_(thread->GetEmulationModel().GetSystem().GetPubSub(), !archsim::options::AggressiveCodeInvalidation)
 {
-	auto &isa = thread->GetArch().GetISA(0);
 	decode_ctx_ = thread->GetEmulationModel().GetNewDecodeContext(*thread);
-	if(!archsim::options::AggressiveCodeInvalidation) {
-		decode_ctx_ = new gensim::CachedDecodeContext(thread->GetEmulationModel().GetSystem().GetPubSub(), decode_ctx_, [&isa]() {
-			return isa.GetNewDecode();
-		});
-	}
 }
 
 InterpreterExecutionEngineThreadContext::~InterpreterExecutionEngineThreadContext()
@@ -0,0 +1,495 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "blockjit/block-compiler/lowering/NativeLowering.h"
+#include "core/execution/TieredJITExecutionEngine.h"
+#include "core/execution/ExecutionEngineFactory.h"
+#include "core/thread/ThreadInstance.h"
+#include "core/MemoryInterface.h"
+#include "util/LogContext.h"
+#include "util/SimOptions.h"
+#include "system.h"
+
+#include <llvm/IR/Module.h>
+
+UseLogContext(LogBlockJitCpu);
+DeclareChildLogContext(LogTieredJIT, LogBlockJitCpu, "Tiered");
+
+using namespace archsim::core::execution;
+using namespace archsim::core::thread;
+
+const std::chrono::milliseconds TieredJITExecutionEngine::kScanInterval (10);
+
+TieredTranslationWorker::TieredTranslationWorker(TieredJITExecutionEngine &engine, uint8_t id) :
+	Thread("Tiered Txln Worker"),
+	engine_(engine),
+	id_(id),
+	terminate_(false),
+	llvm_ctx_(std::unique_ptr<llvm::LLVMContext>(new llvm::LLVMContext())),
+	adaptor_(*llvm_ctx_.getContext()),
+	compiler_(llvm_ctx_)
+{
+
+}
+
+void TieredTranslationWorker::run()
+{
+	std::unique_lock<std::mutex> queue_lock(engine_.work_queue_lock_, std::defer_lock);
+
+	while(!terminate_) {
+		queue_lock.lock();
+
+		while(engine_.work_queue_.empty() && !terminate_) {
+			engine_.work_queue_cond_.wait(queue_lock);
+		}
+
+		if(terminate_) {
+			queue_lock.unlock();
+			break;
+		}
+
+		// Take the hottest block first
+		TieredWorkUnit *unit = engine_.work_queue_.top();
+		engine_.work_queue_.pop();
+
+		queue_lock.unlock();
+
+		// Don't bother compiling something which has already been invalidated
+		if(!engine_.isStale(*unit)) {
+			Translate(*unit);
+		}
+
+		queue_lock.lock();
+		engine_.completed_.push_back(unit);
+		queue_lock.unlock();
+	}
+}
+
+void TieredTranslationWorker::stop()
+{
+	terminate_ = true;
+
+	engine_.work_queue_lock_.lock();
+	engine_.work_queue_cond_.notify_all();
+	engine_.work_queue_lock_.unlock();
+
+	join();
+}
+
+void TieredTranslationWorker::Translate(TieredWorkUnit &unit)
+{
+	LC_DEBUG2(LogTieredJIT) << "[" << (uint32_t)id_ << "] Compiling " << unit.PhysPC << " (weight " << unit.Weight << ")";
+
+	std::string fn_name = "fn_" + std::to_string(unit.PhysPC.Get());
+	std::unique_ptr<llvm::Module> module (new llvm::Module("tier_" + std::to_string(unit.PhysPC.Get()), *llvm_ctx_.getContext()));
+
+	try {
+		if(adaptor_.AdaptIR(unit.Thread, module.get(), fn_name, unit.IR) == nullptr) {
+			return;
+		}
+
+		// The compiler takes ownership of the module
+		auto handle = compiler_.AddModule(module.release());
+		unit.Txln.SetFn((captive::shared::block_txln_fn)compiler_.GetSymbol(handle, fn_name));
+	} catch(std::logic_error &e) {
+		// The block stays on the BlockJIT
+		LC_WARNING(LogTieredJIT) << "[" << (uint32_t)id_ << "] Failed to compile " << unit.PhysPC << ": " << e.what();
+	}
+}
+
+TieredProfileScanner::TieredProfileScanner(TieredJITExecutionEngine &engine) : Thread("Tiered Profile Scanner"), engine_(engine), terminate_(false)
+{
+
+}
+
+void TieredProfileScanner::run()
+{
+	std::unique_lock<std::mutex> lock(lock_);
+
+	while(!terminate_) {
+		cond_.wait_for(lock, TieredJITExecutionEngine::kScanInterval);
+		if(!terminate_) {
+			engine_.scanHotBlocks();
+		}
+	}
+}
+
+void TieredProfileScanner::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		terminate_ = true;
+		cond_.notify_all();
+	}
+
+	join();
+}
+
+TieredJITExecutionEngine::TieredJITExecutionEngine(gensim::blockjit::BaseBlockJITTranslate *translator) : BlockJITExecutionEngine(translator), has_hot_blocks_(false), outstanding_units_(0), scanner_(*this)
+{
+	for(unsigned int i = 0; i < archsim::options::JitThreads; ++i) {
+		auto worker = new TieredTranslationWorker(*this, i);
+		workers_.push_back(worker);
+		worker->start();
+	}
+
+	scanner_.start();
+}
+
+TieredJITExecutionEngine::~TieredJITExecutionEngine()
+{
+	scanner_.stop();
+
+	for(auto worker : workers_) {
+		worker->stop();
+		delete worker;
+	}
+	workers_.clear();
+
+	while(!work_queue_.empty()) {
+		delete work_queue_.top();
+		work_queue_.pop();
+	}
+	for(auto unit : completed_) {
+		delete unit;
+	}
+}
+
+ExecutionResult TieredJITExecutionEngine::Execute(ExecutionEngineThreadContext* ctx)
+{
+	{
+		std::lock_guard<std::mutex> l(tier_lock_);
+		threads_.insert(ctx->GetThread());
+	}
+
+	auto result = BlockJITExecutionEngine::Execute(ctx);
+
+	{
+		std::lock_guard<std::mutex> l(tier_lock_);
+		threads_.erase(ctx->GetThread());
+	}
+
+	return result;
+}
+
+void TieredJITExecutionEngine::FlushTxlns()
+{
+	BlockJITExecutionEngine::FlushTxlns();
+	resetProfile();
+}
+
+void TieredJITExecutionEngine::FlushAllTxlns()
+{
+	BlockJITExecutionEngine::FlushAllTxlns();
+	resetProfile();
+}
+
+void TieredJITExecutionEngine::InvalidateRegion(Address addr)
+{
+	BlockJITExecutionEngine::InvalidateRegion(addr);
+
+	std::lock_guard<std::mutex> l(tier_lock_);
+	epochs_.InvalidatePage(addr);
+
+	// Chains into the page have already been unlinked, and the block cache is
+	// flushed when the page is garbage collected, so just forget about the
+	// promoted code.
+	auto page = addr.PageBase();
+	promoted_.erase(promoted_.lower_bound(page.Get()), promoted_.lower_bound(page.Get() + Address::PageSize));
+}
+
+void TieredJITExecutionEngine::resetProfile()
+{
+	std::lock_guard<std::mutex> l(tier_lock_);
+	epochs_.InvalidateAll();
+
+	promoted_.clear();
+	hot_blocks_.clear();
+	for(auto &block : blocks_) {
+		makeCold(*block.second);
+	}
+}
+
+bool TieredJITExecutionEngine::isStale(const TieredWorkUnit &unit)
+{
+	std::lock_guard<std::mutex> l(tier_lock_);
+	return epochs_.IsStale(unit.Epoch, unit.PhysPC);
+}
+
+void TieredJITExecutionEngine::retire(TieredWorkUnit *unit)
+{
+	delete unit;
+
+	// Per-page invalidations only matter to work which was started before
+	// them, so they can be forgotten once there is none left.
+	if(--outstanding_units_ == 0) {
+		epochs_.Prune();
+	}
+}
+
+TieredJITExecutionEngine::TieredBlock &TieredJITExecutionEngine::getBlock(Address phys_pc)
+{
+	auto &block = blocks_[phys_pc.Get()];
+	if(block == nullptr) {
+		block = std::unique_ptr<TieredBlock>(new TieredBlock());
+		block->PhysPC = phys_pc;
+		block->State = TierState::Promoting;
+	}
+	return *block;
+}
+
+void TieredJITExecutionEngine::makeCold(TieredBlock &block)
+{
+	block.Count = 0;
+	if(block.State != TierState::Cold) {
+		block.State = TierState::Cold;
+		cold_blocks_.push_back(&block);
+	}
+}
+
+bool TieredJITExecutionEngine::lookupBlock(ThreadInstance *thread, Address addr, captive::shared::block_txln_fn &fn)
+{
+	if((fn = GetBlockCache().Lookup(addr))) {
+		return true;
+	}
+
+	// Prefer a promoted translation over the BlockJIT one
+	Address phys_pc (0);
+	if(thread->GetFetchMI().PerformTranslation(addr, phys_pc, false, true, false) == archsim::TranslationResult::OK) {
+		std::lock_guard<std::mutex> l(tier_lock_);
+
+		auto promoted = promoted_.find(phys_pc.Get());
+		if(promoted != promoted_.end() && promoted->second.FeaturesValid(thread->GetFeatures())) {
+			fn = promoted->second.GetFn();
+			GetBlockCache().Insert(addr, fn, promoted->second.GetFeatures());
+			return true;
+		}
+	}
+
+	return BlockJITExecutionEngine::lookupBlock(thread, addr, fn);
+}
+
+bool TieredJITExecutionEngine::translateBlock(ThreadInstance *thread, archsim::Address block_pc, bool support_chaining, bool support_profiling)
+{
+	captive::shared::block_txln_fn fn;
+	if(lookupBlock(thread, block_pc, fn)) {
+		return true;
+	}
+
+	// If this fails, the BlockJIT will raise the fault
+	Address phys_pc (0);
+	if(thread->GetFetchMI().PerformTranslation(block_pc, phys_pc, false, true, false) != archsim::TranslationResult::OK) {
+		return BlockJITExecutionEngine::translateBlock(thread, block_pc, support_chaining, support_profiling);
+	}
+
+	TieredBlock *block;
+	{
+		std::lock_guard<std::mutex> l(tier_lock_);
+		block = &getBlock(phys_pc);
+		block->VirtPC = block_pc;
+		block->ModeID = thread->GetModeID();
+		makeCold(*block);
+	}
+
+	GetTranslator()->setBlockCounter(&block->Count);
+	bool success = BlockJITExecutionEngine::translateBlock(thread, block_pc, support_chaining, support_profiling);
+	GetTranslator()->setBlockCounter(nullptr);
+
+	if(success) {
+		std::lock_guard<std::mutex> l(tier_lock_);
+		block->Tier0Fn = GetBlockCache().Lookup(block_pc);
+	}
+
+	return success;
+}
+
+void TieredJITExecutionEngine::checkPendingTranslations(ThreadInstance *thread)
+{
+	installCompleted(thread);
+
+	if(has_hot_blocks_) {
+		promoteHotBlocks(thread);
+	}
+}
+
+void TieredJITExecutionEngine::scanHotBlocks()
+{
+	std::lock_guard<std::mutex> l(tier_lock_);
+
+	// The counters are updated by translated code without synchronisation, so
+	// these reads may be slightly stale. That's fine for a heuristic.
+	bool found = false;
+	for(unsigned int i = 0; i < cold_blocks_.size();) {
+		TieredBlock *block = cold_blocks_[i];
+
+		if(block->Count < archsim::options::JitTierUpThreshold) {
+			i++;
+			continue;
+		}
+
+		cold_blocks_[i] = cold_blocks_.back();
+		cold_blocks_.pop_back();
+		block->State = TierState::Hot;
+		hot_blocks_.push_back(block);
+		found = true;
+	}
+
+	if(found) {
+		has_hot_blocks_ = true;
+
+		// Bring the guest threads back to the dispatcher, since a hot loop
+		// may be chained and never get there by itself
+		for(auto thread : threads_) {
+			thread->SendMessage(ThreadMessage::Nop);
+		}
+	}
+}
+
+void TieredJITExecutionEngine::promoteHotBlocks(ThreadInstance *thread)
+{
+	std::lock_guard<std::mutex> l(tier_lock_);
+
+	for(auto block : hot_blocks_) {
+		// The block may have been invalidated since it was found
+		if(block->State != TierState::Hot) {
+			continue;
+		}
+
+		block->State = TierState::Promoting;
+		if(!promote(thread, *block)) {
+			// Profile it again, so that a thread which can promote it gets
+			// another chance to
+			makeCold(*block);
+		}
+	}
+
+	hot_blocks_.clear();
+	has_hot_blocks_ = false;
+}
+
+bool TieredJITExecutionEngine::promote(ThreadInstance *thread, TieredBlock &block)
+{
+	// The IR can only be rebuilt in the context of the current thread, so
+	// make sure that the block still means the same thing to it.
+	if(block.ModeID != thread->GetModeID()) {
+		return false;
+	}
+
+	Address phys_pc (0);
+	if(thread->GetFetchMI().PerformTranslation(block.VirtPC, phys_pc, false, true, false) != archsim::TranslationResult::OK || phys_pc != block.PhysPC) {
+		return false;
+	}
+
+	TieredWorkUnit *unit = new TieredWorkUnit(thread, block.PhysPC, block.VirtPC, block.Count, epochs_.Current());
+	if(!buildIR(thread, *unit)) {
+		delete unit;
+		return false;
+	}
+
+	LC_DEBUG1(LogTieredJIT) << "Promoting " << block.VirtPC << " (" << block.PhysPC << "), count " << block.Count;
+	thread->GetMetrics().TierUpQueued.inc();
+	outstanding_units_++;
+
+	std::lock_guard<std::mutex> l(work_queue_lock_);
+	work_queue_.push(unit);
+	work_queue_cond_.notify_one();
+	return true;
+}
+
+bool TieredJITExecutionEngine::buildIR(ThreadInstance *thread, TieredWorkUnit &unit)
+{
+	auto translator = GetTranslator();
+	translator->InitialiseFeatures(thread);
+	translator->InitialiseIsaMode(thread);
+
+	auto decode_ctx = thread->GetEmulationModel().GetNewDecodeContext(*thread);
+	translator->SetDecodeContext(decode_ctx);
+
+	// LLVM code can't contain chain sites, and doesn't need to be profiled
+	translator->setSupportChaining(false);
+
+	captive::shared::IRBuilder builder;
+	builder.SetContext(&unit.IR);
+	builder.SetBlock(unit.IR.alloc_block());
+
+	bool success = translator->build_block(thread, unit.VirtPC, builder);
+	if(success) {
+		translator->AttachFeaturesTo(unit.Txln);
+	}
+
+	translator->setSupportChaining(!archsim::options::JitDisableBranchOpt);
+	delete decode_ctx;
+
+	return success;
+}
+
+void TieredJITExecutionEngine::installCompleted(ThreadInstance *thread)
+{
+	std::vector<TieredWorkUnit*> completed;
+	{
+		std::lock_guard<std::mutex> l(work_queue_lock_);
+		if(completed_.empty()) {
+			return;
+		}
+		completed.swap(completed_);
+	}
+
+	std::lock_guard<std::mutex> l(tier_lock_);
+
+	for(auto unit : completed) {
+		auto fn = unit->Txln.GetFn();
+
+		if(fn == nullptr || epochs_.IsStale(unit->Epoch, unit->PhysPC)) {
+			LC_DEBUG1(LogTieredJIT) << "Discarding promotion of " << unit->PhysPC;
+			thread->GetMetrics().TierUpDiscarded.inc();
+
+			// A block which was invalidated while it was being compiled is
+			// profiled again, rather than staying on the BlockJIT for good.
+			// Blocks which failed to compile do stay there.
+			auto block = blocks_.find(unit->PhysPC.Get());
+			if(block != blocks_.end() && fn != nullptr) {
+				makeCold(*block->second);
+			}
+
+			retire(unit);
+			continue;
+		}
+
+		LC_DEBUG1(LogTieredJIT) << "Installing promoted " << unit->VirtPC << " (" << unit->PhysPC << ") at " << (void*)fn;
+		thread->GetMetrics().TierUpInstalled.inc();
+
+		promoted_[unit->PhysPC.Get()] = unit->Txln;
+
+		// Anything chained to the BlockJIT translation will be relinked to the
+		// promoted one the next time it is dispatched.
+		auto &block = getBlock(unit->PhysPC);
+		if(block.Tier0Fn != nullptr) {
+			GetChainTable().UnlinkTarget(block.Tier0Fn);
+		}
+
+		if(GetBlockCache().Contains(unit->VirtPC) && unit->Txln.FeaturesValid(thread->GetFeatures())) {
+			GetBlockCache().Insert(unit->VirtPC, fn, unit->Txln.GetFeatures());
+		}
+
+		retire(unit);
+	}
+}
+
+ExecutionEngine *TieredJITExecutionEngine::Factory(const archsim::module::ModuleInfo *module, const std::string &cpu_prefix)
+{
+	std::string entry_name = cpu_prefix + "BlockJITTranslator";
+	if(!module->HasEntry(entry_name)) {
+		LC_ERROR(LogBlockJitCpu) << "Could not find BlockJITTranslator in target module";
+		return nullptr;
+	}
+
+	if(!captive::arch::jit::lowering::HasNativeLowering()) {
+		LC_ERROR(LogBlockJitCpu) << "No native lowering found";
+		return nullptr;
+	}
+
+	auto translator_entry = module->GetEntry<archsim::module::ModuleBlockJITTranslatorEntry>(entry_name)->Get();
+	return new TieredJITExecutionEngine(translator_entry);
+}
+
+// Lower priority than the BlockJIT, so it must be selected explicitly with --mode TieredJIT
+static archsim::core::execution::ExecutionEngineFactoryRegistration registration("TieredJIT", 95, archsim::core::execution::TieredJITExecutionEngine::Factory);
@@ -1,6 +1,7 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 
 #include "core/thread/StateBlock.h"
+#include <sstream>
 #include <stdexcept>
 
 using namespace archsim;
@@ -32,6 +33,15 @@ size_t StateBlockDescriptor::GetBlockSizeInBytes(const std::string& name) const
 	return block_sizes_in_bytes_.at(name);
 }
 
+std::string StateBlockDescriptor::GetLayoutSignature() const
+{
+	std::ostringstream str;
+	for(const auto &entry : block_offsets_) {
+		str << entry.first << ":" << entry.second << ":" << block_sizes_in_bytes_.at(entry.first) << ";";
+	}
+	return str.str();
+}
+
 
 uint32_t StateBlock::AddBlock(const std::string& name, size_t size_in_bytes)
 {
@@ -85,9 +85,29 @@ ThreadInstance::ThreadInstance(util::PubSubContext &pubsub, const ArchDescriptor
 	pc_ptr_ = GetRegisterFileInterface().GetTaggedSlotPointer<void*>("PC");
 	pc_is_64bit_ = GetArch().GetRegisterFileDescriptor().GetTaggedEntry("PC").GetEntrySize() == 8;
 
+	// ... and the SP, which not every architecture tags
+	const auto &register_file = GetArch().GetRegisterFileDescriptor();
+	if(register_file.HasTaggedEntry("SP")) {
+		sp_ptr_ = GetRegisterFileInterface().GetTaggedSlotPointer<void*>("SP");
+		sp_is_64bit_ = register_file.GetTaggedEntry("SP").GetEntrySize() == 8;
+	} else {
+		sp_ptr_ = nullptr;
+		sp_is_64bit_ = false;
+	}
+
+	flag_n_ = register_file.GetEntryHandle<uint8_t>("N");
+	flag_z_ = register_file.GetEntryHandle<uint8_t>("Z");
+	flag_c_ = register_file.GetEntryHandle<uint8_t>("C");
+	flag_v_ = register_file.GetEntryHandle<uint8_t>("V");
+
 	trace_source_ = nullptr;
+	event_register_ = false;
+	idle_ = false;
 }
 
+thread_local ThreadInstance *ThreadInstance::current_thread_ = nullptr;
+constexpr std::chrono::microseconds ThreadInstance::kEventWaitTimeout;
+
 void ThreadInstance::ReturnToSafepoint()
 {
 	longjmp(Safepoint, 1);
@@ -100,6 +120,67 @@ void ThreadInstance::SetExecutionRing(uint32_t new_ring)
 	LC_DEBUG1(LogCPU) << "Now executing in ring " << new_ring;
 }
 
+void ThreadInstance::SaveState(util::CheckpointWriter& writer) const
+{
+	writer.Write<uint64_t>(register_file_.GetSize());
+	writer.Write(register_file_.GetData(), register_file_.GetSize());
+
+	writer.Write(GetModeID());
+	writer.Write(GetExecutionRing());
+	writer.Write<uint8_t>(event_register_);
+
+	writer.Write<uint32_t>(std::distance(features_.begin(), features_.end()));
+	for(const auto &feature : features_) {
+		writer.Write(feature.first);
+		writer.Write(feature.second);
+	}
+
+	writer.Write(fp_state_.GetRoundingMode());
+	writer.Write(fp_state_.GetFlushMode());
+}
+
+bool ThreadInstance::RestoreState(util::CheckpointReader& reader)
+{
+	uint64_t register_file_size;
+	if(!reader.Read(register_file_size) || register_file_size != register_file_.GetSize()) {
+		return false;
+	}
+	if(!reader.Read(register_file_.GetData(), register_file_.GetSize())) {
+		return false;
+	}
+
+	uint32_t mode, ring;
+	uint8_t event_register;
+	if(!reader.Read(mode) || !reader.Read(ring) || !reader.Read(event_register)) {
+		return false;
+	}
+	SetModeID(mode);
+	SetExecutionRing(ring);
+	event_register_ = event_register;
+
+	uint32_t feature_count;
+	if(!reader.Read(feature_count)) {
+		return false;
+	}
+	for(uint32_t i = 0; i < feature_count; ++i) {
+		uint32_t id, level;
+		if(!reader.Read(id) || !reader.Read(level)) {
+			return false;
+		}
+		features_.SetFeatureLevel(id, level);
+	}
+
+	RoundingMode rounding_mode;
+	FlushMode flush_mode;
+	if(!reader.Read(rounding_mode) || !reader.Read(flush_mode)) {
+		return false;
+	}
+	fp_state_.SetRoundingMode(rounding_mode);
+	fp_state_.SetFlushMode(flush_mode);
+
+	return true;
+}
+
 MemoryInterface& ThreadInstance::GetMemoryInterface(const std::string& interface_name)
 {
 	for(auto i : memory_interfaces_) {
@@ -117,7 +198,7 @@ MemoryInterface& ThreadInstance::GetMemoryInterface(uint32_t interface_name)
 
 Address RegisterFileInterface::GetTaggedSlot(const std::string &tag) const
 {
-	auto descriptor = descriptor_.GetTaggedEntry(tag);
+	const auto &descriptor = descriptor_.GetTaggedEntry(tag);
 
 	switch(descriptor.GetEntrySize()) {
 		case 4:
@@ -131,7 +212,7 @@ Address RegisterFileInterface::GetTaggedSlot(const std::string &tag) const
 
 void RegisterFileInterface::SetTaggedSlot(const std::string &tag, Address target)
 {
-	auto descriptor = descriptor_.GetTaggedEntry(tag);
+	const auto &descriptor = descriptor_.GetTaggedEntry(tag);
 
 	switch(descriptor.GetEntrySize()) {
 		case 4:
@@ -202,11 +283,106 @@ archsim::core::execution::ExecutionResult ThreadInstance::HandleMessage()
 		case ThreadMessage::Interrupt:
 			HandleIRQ();
 			return ExecutionResult::Exception;
+		case ThreadMessage::WaitForInterrupt:
+			Idle(false);
+			return ExecutionResult::Continue;
+		case ThreadMessage::WaitForEvent:
+			Idle(true);
+			return ExecutionResult::Continue;
 		default:
 			throw std::logic_error("Unexpected message");
 	}
 }
 
+void ThreadInstance::SendEvent()
+{
+	GetEmulationModel().GetSystem().GetECM().SignalEvent();
+}
+
+void ThreadInstance::SignalEvent()
+{
+	std::unique_lock<std::mutex> lock(message_lock_);
+	event_register_ = true;
+	MarkAwake();
+	message_cond_.notify_all();
+}
+
+bool ThreadInstance::IsWakeupPending(bool wait_for_event) const
+{
+	if(!message_queue_.empty() || (wait_for_event && event_register_)) {
+		return true;
+	}
+
+	// A pending interrupt wakes the thread even if it is masked
+	for(auto irq : irq_lines_) {
+		if(irq && irq->IsAsserted()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadInstance::Idle(bool wait_for_event)
+{
+	auto &system = GetEmulationModel().GetSystem();
+	auto &ecm = system.GetECM();
+
+	std::unique_lock<std::mutex> lock(message_lock_);
+	if(IsWakeupPending(wait_for_event)) {
+		event_register_ = false;
+		return;
+	}
+
+	GetMetrics().IdleWaits++;
+	GetMetrics().IdleTime.Start();
+
+	while(!IsWakeupPending(wait_for_event)) {
+		// If every thread is now idle, nothing can happen until the next
+		// timer deadline, so skip virtual time straight to it. This has to
+		// be done without holding the message lock, since the timer will
+		// probably raise an interrupt on this thread.
+		idle_ = true;
+		if(ecm.ThreadIdle()) {
+			lock.unlock();
+			bool skipped = system.SkipIdleTime();
+			lock.lock();
+
+			if(skipped) {
+				MarkAwake();
+				continue;
+			}
+		}
+
+		// The lock was released while skipping time, so a wakeup may already
+		// have been sent, and its notification missed. Waiting on the
+		// predicate checks for that before going to sleep.
+		auto woken = [&] { return IsWakeupPending(wait_for_event); };
+
+		// Anything which wakes this thread marks it as awake itself, so this
+		// only matters for timeouts
+		if(wait_for_event) {
+			message_cond_.wait_for(lock, kEventWaitTimeout, woken);
+			MarkAwake();
+			break;
+		}
+
+		message_cond_.wait(lock, woken);
+		MarkAwake();
+	}
+
+	event_register_ = false;
+	GetMetrics().IdleTime.Stop();
+}
+
+void ThreadInstance::MarkAwake()
+{
+	if(idle_) {
+		idle_ = false;
+		GetEmulationModel().GetSystem().GetECM().ThreadWoken();
+	}
+}
+
 void ThreadInstance::HandleIRQ()
 {
 	for(auto irq : irq_lines_) {
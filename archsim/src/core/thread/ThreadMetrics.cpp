@@ -4,8 +4,9 @@
 #include "gensim/gensim_disasm.h"
 #include "util/SimOptions.h"
 
-#include <fstream>
+#include <algorithm>
 #include <sstream>
+#include <vector>
 
 using namespace archsim::core::thread;
 
@@ -21,30 +22,25 @@ void ThreadMetricPrinter::PrintStats(const ArchDescriptor &arch, const ThreadMet
 
 		auto disasm = arch.GetISA(0).GetDisasm();
 		if(disasm != nullptr) {
-			hp.PrintHistogram(metrics.OpcodeHistogram, str, [disasm](uint32_t i) {
+			hp.PrintHistogram(metrics.OpcodeHistogram, str, [disasm](uint64_t i) {
 				return disasm->GetInstrName(i);
 			});
 		} else {
 			str << "(No instruction disassembly available)" << std::endl;
-			hp.PrintHistogram(metrics.OpcodeHistogram, str, [disasm](uint32_t i) {
+			hp.PrintHistogram(metrics.OpcodeHistogram, str, [disasm](uint64_t i) {
 				return std::to_string(i);
 			});
 		}
-	}
-	if(archsim::options::ProfileIrFreq) {
-		std::ofstream ir_str ("ir_freq.out");
-		hp.PrintHistogram(metrics.InstructionIRHistogram, ir_str, [](uint32_t i) {
-			std::stringstream str;
-			str << std::hex << i;
-			return str.str();
-		});
-	}
-	if(archsim::options::ProfilePcFreq) {
-		std::ofstream pc_str("pc_freq.out");
-		hp.PrintHistogram(metrics.PCHistogram, pc_str, [](uint32_t i) {
-			std::stringstream str;
-			str << std::hex << i;
-			return str.str();
+
+		// Printed as "first second", which is the format read by the
+		// interpreter generator's Superinstructions option
+		str << "Instruction Pair Profile" << std::endl;
+		hp.PrintHistogram(metrics.OpcodePairHistogram, str, [disasm](uint64_t i) {
+			uint32_t first = i >> 16, second = i & 0xffff;
+			if(disasm != nullptr) {
+				return disasm->GetInstrName(first) + " " + disasm->GetInstrName(second);
+			}
+			return std::to_string(first) + " " + std::to_string(second);
 		});
 	}
 
@@ -71,18 +67,86 @@ void ThreadMetricPrinter::PrintStats(const ArchDescriptor &arch, const ThreadMet
 		str << "Interpreter Rate: " << ((metrics.InstructionCount.get_value() - metrics.JITInstructionCount.get_value()) / 1000000.0) / (metrics.InterpretTime.GetElapsedS()) << " MIPS" << std::endl;
 	}
 
+	if(metrics.JITCodeSize.get_value() != 0) {
+		str << "JIT Compile Time: " << metrics.JITCompileTime.GetElapsedS() << " seconds" << std::endl;
+		str << "JIT Code Size: " << metrics.JITCodeSize.get_value() << " bytes" << std::endl;
+	}
+
+	if(metrics.IdleWaits.get_value() != 0) {
+		str << "Idle waits: " << metrics.IdleWaits.get_value() << std::endl;
+		str << "Idle time: " << metrics.IdleTime.GetElapsedS() << " seconds" << std::endl;
+	}
+
+	if(!metrics.SyscallCounts.get_value_map().empty()) {
+		str << "Syscalls (number, count, total us, mean us): " << std::endl;
+		for(auto i : metrics.SyscallCounts.get_value_map()) {
+			auto time = metrics.SyscallTime.get_value_map().find(i.first);
+			uint64_t total_ns = time != metrics.SyscallTime.get_value_map().end() ? *time->second : 0;
+
+			str << i.first << "\t" << *i.second << "\t" << total_ns / 1000.0 << "\t" << (total_ns / 1000.0) / *i.second << std::endl;
+		}
+	}
+
 	str << "Successful chains: " << metrics.JITSuccessfulChains.get_value() << std::endl;
 	str << "Failed chains: " << metrics.JITFailedChains.get_value() << std::endl;
 
+	if(metrics.ITLBMisses.get_value() != 0 || metrics.DTLBMisses.get_value() != 0) {
+		str << "ITLB hits: " << metrics.ITLBHits.get_value() << ", misses: " << metrics.ITLBMisses.get_value() << std::endl;
+		str << "DTLB hits: " << metrics.DTLBHits.get_value() << ", misses: " << metrics.DTLBMisses.get_value() << std::endl;
+	}
+
+	if(metrics.JITEvictedPages.get_value() != 0 || metrics.JITCodeFlushes.get_value() != 0) {
+		str << "Code cache evicted pages: " << metrics.JITEvictedPages.get_value() << std::endl;
+		str << "Code cache evicted bytes: " << metrics.JITEvictedBytes.get_value() << std::endl;
+		str << "Code cache flushes: " << metrics.JITCodeFlushes.get_value() << std::endl;
+		str << "Retranslations: " << metrics.JITRetranslations.get_value() << std::endl;
+	}
+
+	if(metrics.TierUpQueued.get_value() != 0) {
+		str << "Tier-up queued: " << metrics.TierUpQueued.get_value() << std::endl;
+		str << "Tier-up installed: " << metrics.TierUpInstalled.get_value() << std::endl;
+		str << "Tier-up discarded: " << metrics.TierUpDiscarded.get_value() << std::endl;
+	}
+
 	str << "JIT Exit reasons: " << std::endl;
 	hp.PrintHistogram(metrics.JITExitReasons, str, [](uint32_t i) {
 		return std::to_string(i);
 	});
 }
 
+void ThreadMetricPrinter::PrintJSON(const ThreadMetrics& metrics, std::ostream& str)
+{
+	double runtime = metrics.SelfRuntime.GetElapsedS();
+	double mips = runtime != 0 ? (metrics.InstructionCount.get_value() / 1000000.0) / runtime : 0;
+
+	str << "{";
+	str << "\"instructions\":" << metrics.InstructionCount.get_value() << ",";
+	str << "\"jit_instructions\":" << metrics.JITInstructionCount.get_value() << ",";
+	str << "\"self_runtime\":" << runtime << ",";
+	str << "\"mips\":" << mips << ",";
+	str << "\"jit_compile_time\":" << metrics.JITCompileTime.GetElapsedS() << ",";
+	str << "\"jit_code_size\":" << metrics.JITCodeSize.get_value() << ",";
+	str << "\"jit_evicted_pages\":" << metrics.JITEvictedPages.get_value() << ",";
+	str << "\"jit_code_flushes\":" << metrics.JITCodeFlushes.get_value();
+	str << "}";
+}
+
 void HistogramPrinter::PrintHistogram(const archsim::util::Histogram& hist, std::ostream& str, std::function<std::string(archsim::util::HistogramEntry::histogram_key_t) > key_formatter)
 {
 	for(auto i : hist.get_value_map()) {
 		str << key_formatter(i.first) << "\t" << *i.second << std::endl;
 	}
 }
+
+void HistogramPrinter::PrintHistogram(const archsim::util::ProfileHistogram& hist, std::ostream& str, std::function<std::string(archsim::util::ProfileHistogram::key_t) > key_formatter)
+{
+	std::vector<std::pair<archsim::util::ProfileHistogram::key_t, archsim::util::ProfileHistogram::value_t>> entries;
+	hist.for_each([&entries](archsim::util::ProfileHistogram::key_t key, archsim::util::ProfileHistogram::value_t value) {
+		entries.push_back({key, value});
+	});
+	std::sort(entries.begin(), entries.end());
+
+	for(auto i : entries) {
+		str << key_formatter(i.first) << "\t" << i.second << std::endl;
+	}
+}
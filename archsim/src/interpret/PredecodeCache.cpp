@@ -0,0 +1,196 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "interpret/PredecodeCache.h"
+#include "abi/EmulationModel.h"
+#include "core/MemoryInterface.h"
+#include "core/thread/ThreadInstance.h"
+#include "gensim/gensim_decode.h"
+#include "gensim/gensim_decode_context.h"
+#include "system.h"
+
+#include <cstring>
+
+using namespace archsim::interpret;
+
+PredecodedBlock::~PredecodedBlock()
+{
+	for(auto &insn : instructions_) {
+		insn.Decode->Release();
+	}
+}
+
+PredecodeCache::PredecodeCache(util::PubSubContext& pubsub, bool enabled) : enabled_(enabled), uncached_block_(nullptr), pending_(false), pending_flush_(false), subscriber_(pubsub)
+{
+	memset(pages_, 0, sizeof(pages_));
+
+	subscriber_.Subscribe(PubSubType::FlushTranslations, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::FlushAllTranslations, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::ITlbFullFlush, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::ITlbEntryFlush, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::L1ICacheFlush, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::FeatureChange, InvalidateCallback, this);
+	subscriber_.Subscribe(PubSubType::RegionInvalidatePhysical, InvalidateCallback, this);
+}
+
+PredecodeCache::~PredecodeCache()
+{
+	Invalidate();
+}
+
+void PredecodeCache::InvalidateCallback(PubSubType::PubSubType type, void* ctx, const void* data)
+{
+	PredecodeCache *cache = (PredecodeCache*)ctx;
+
+	// This may be called from any thread, and possibly while a block is
+	// being executed, so just record what needs to be dropped
+	std::lock_guard<std::mutex> l(cache->pending_lock_);
+	switch(type) {
+		case PubSubType::ITlbEntryFlush:
+			cache->pending_virtual_pages_.push_back(Address((uint64_t)data).GetPageBase());
+			break;
+		case PubSubType::RegionInvalidatePhysical:
+			cache->pending_physical_pages_.push_back(Address((uint64_t)data).GetPageBase());
+			break;
+		default:
+			cache->pending_flush_ = true;
+			break;
+	}
+	cache->pending_.store(true, std::memory_order_release);
+}
+
+void PredecodeCache::ApplyInvalidations()
+{
+	std::lock_guard<std::mutex> l(pending_lock_);
+	pending_.store(false, std::memory_order_relaxed);
+
+	if(pending_flush_) {
+		Invalidate();
+	} else {
+		for(auto base : pending_virtual_pages_) {
+			uint32_t slot = Address(base).GetPageIndex() % kPageSlots;
+			if(pages_[slot] != nullptr && pages_[slot]->Base == base) {
+				FreePage(slot);
+			}
+		}
+
+		if(!pending_physical_pages_.empty()) {
+			for(uint32_t slot = 0; slot < kPageSlots; ++slot) {
+				if(pages_[slot] == nullptr) {
+					continue;
+				}
+
+				for(auto base : pending_physical_pages_) {
+					if(pages_[slot]->PhysicalBase == base) {
+						FreePage(slot);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	pending_flush_ = false;
+	pending_virtual_pages_.clear();
+	pending_physical_pages_.clear();
+}
+
+void PredecodeCache::FreePage(uint32_t slot)
+{
+	Page *page = pages_[slot];
+	for(auto block : page->Blocks) {
+		delete block;
+	}
+
+	delete page;
+	pages_[slot] = nullptr;
+}
+
+void PredecodeCache::Invalidate()
+{
+	for(uint32_t slot = 0; slot < kPageSlots; ++slot) {
+		if(pages_[slot] != nullptr) {
+			FreePage(slot);
+		}
+	}
+
+	delete uncached_block_;
+	uncached_block_ = nullptr;
+}
+
+uint32_t PredecodeCache::DecodeBlock(core::thread::ThreadInstance* thread, gensim::DecodeContext& decode_ctx, Address pc, uint32_t mode, resolve_handler_t resolve_handler, PredecodedBlock*& block)
+{
+	std::vector<gensim::BaseDecode *> decodes;
+
+	Address insn_pc = pc;
+	while(decodes.size() < kMaxBlockInstructions) {
+		gensim::BaseDecode *decode = nullptr;
+		uint32_t fault = decode_ctx.DecodeSync(thread->GetFetchMI(), insn_pc, mode, decode);
+
+		if(fault) {
+			if(decode != nullptr) {
+				decode->Release();
+			}
+
+			// Faults on later instructions are taken when they become the
+			// start of a block
+			if(decodes.empty()) {
+				return fault;
+			}
+			break;
+		}
+
+		decodes.push_back(decode);
+		insn_pc += decode->Instr_Length;
+
+		if(decode->GetEndOfBlock() || insn_pc.GetPageBase() != pc.GetPageBase()) {
+			break;
+		}
+	}
+
+	// Handlers are resolved once the whole block is known, since they may
+	// depend on the following instruction
+	block = new PredecodedBlock(pc, mode);
+	for(size_t i = 0; i < decodes.size(); ++i) {
+		const gensim::BaseDecode *next = i + 1 < decodes.size() ? decodes[i + 1] : nullptr;
+		block->AddInstruction(decodes[i], resolve_handler(mode, *decodes[i], next));
+	}
+
+	if(!enabled_) {
+		delete uncached_block_;
+		uncached_block_ = block;
+		return 0;
+	}
+
+	uint32_t page_slot = pc.GetPageIndex() % kPageSlots;
+	Page *page = pages_[page_slot];
+	if(page != nullptr && page->Base != pc.GetPageBase()) {
+		FreePage(page_slot);
+		page = nullptr;
+	}
+
+	if(page == nullptr) {
+		page = new Page();
+		page->Base = pc.GetPageBase();
+		page->PhysicalBase = kNoPhysicalPage;
+
+		// Make sure that writes to this page are noticed, so that the blocks
+		// on it are dropped if the code is modified
+		Address phys_pc;
+		if(thread->GetFetchMI().PerformTranslation(pc, phys_pc, false, true, false) == archsim::TranslationResult::OK) {
+			page->PhysicalBase = phys_pc.GetPageBase();
+
+			auto &code_regions = thread->GetEmulationModel().GetSystem().GetCodeRegions();
+			if(!code_regions.IsRegionCode(PhysicalAddress(page->PhysicalBase))) {
+				code_regions.MarkRegionAsCode(PhysicalAddress(page->PhysicalBase));
+			}
+		}
+
+		pages_[page_slot] = page;
+	}
+
+	PredecodedBlock *&slot = page->Blocks[BlockSlot(pc)];
+	delete slot;
+	slot = block;
+
+	return 0;
+}
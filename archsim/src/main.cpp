@@ -1,15 +1,23 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 
 
+#include <cerrno>
 #include <climits>
 #include <csignal>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <fstream>
 #include <iostream>
 #include <thread>
 
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "session.h"
@@ -54,10 +62,18 @@ static int run_simple_simulation(archsim::Session& session)
 #ifdef CONFIG_MEMTRACE
 	mtrace();
 #endif
+	// Guest memory is mapped straight from the checkpoint's image, privately
+	// so that the checkpoint is left untouched and can be restored again
+	if(archsim::options::CheckpointRestore.IsSpecified()) {
+		archsim::options::MemoryBackingFile.SetValue(archsim::options::CheckpointRestore.GetValue() + "/memory");
+		archsim::options::MemoryBackingFile.SetIsSpecified();
+		archsim::options::MemoryBackingPrivate.SetValue(true);
+	}
+
 	System *simsys = new System(session);
 
 	if(archsim::options::InstructionTick) {
-		simsys->SetTickSource(new archsim::abi::devices::timing::SubscriberTickSource(simsys->GetPubSub(), PubSubType::InstructionExecute, 1));
+		simsys->SetTickSource(new archsim::abi::devices::timing::InstructionCountTickSource(archsim::options::TickScale));
 	} else {
 		simsys->SetTickSource(new archsim::abi::devices::timing::MicrosecondTickSource(1000));
 	}
@@ -97,6 +113,15 @@ static int run_simple_simulation(archsim::Session& session)
 		simsys->PrintStatistics(std::cout);
 	}
 
+	if (archsim::options::MetricsFile.IsSpecified()) {
+		std::ofstream metrics_file(archsim::options::MetricsFile.GetValue());
+		simsys->WriteMetrics(metrics_file);
+	}
+
+	if (archsim::options::ProfilePcFreq || archsim::options::ProfileIrFreq || archsim::options::ProfileFile.IsSpecified()) {
+		simsys->WriteProfiles();
+	}
+
 	simsys->GetTickSource()->Stop();
 	// Destroy System after simulation to clean up resources
 	simsys->Destroy();
@@ -111,6 +136,115 @@ static void run_system(System *sys)
 	sys->RunSimulation();
 }
 
+// Reap any forked simulations which have finished
+static void reap_simulations()
+{
+	pid_t child;
+	int status;
+	while((child = waitpid(-1, &status, WNOHANG)) > 0) {
+		LC_INFO(LogInfrastructure) << "Simulation " << child << " exited with status " << WEXITSTATUS(status);
+	}
+}
+
+/**
+ * Restores the checkpoint in a new child process for every connection to a
+ * unix socket. The child's standard streams are the connection. Forking
+ * happens before the system is created, since it starts helper threads
+ * which would not survive the fork, so each child still loads the
+ * checkpoint, but the memory image is only mapped (not read) and stays in
+ * the page cache between children.
+ */
+static int run_fork_server(archsim::Session& session)
+{
+	const std::string &path = archsim::options::ForkServer.GetValue();
+
+	if(!archsim::options::CheckpointRestore.IsSpecified()) {
+		LC_ERROR(LogInfrastructure) << "A checkpoint to restore must be specified when running as a fork server";
+		return -1;
+	}
+
+	int image_fd = open((archsim::options::CheckpointRestore.GetValue() + "/memory").c_str(), O_RDONLY);
+	if(image_fd >= 0) {
+		posix_fadvise(image_fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(image_fd);
+	}
+
+	struct sockaddr_un addr;
+	if(path.size() >= sizeof(addr.sun_path)) {
+		LC_ERROR(LogInfrastructure) << "Fork server socket path is too long: " << path;
+		return -1;
+	}
+
+	bzero(&addr, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	int server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	unlink(path.c_str());
+	if(server_fd < 0 || bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server_fd, 16) < 0) {
+		LC_ERROR(LogInfrastructure) << "Unable to listen on fork server socket " << path << ": " << strerror(errno);
+		return -1;
+	}
+
+	LC_INFO(LogInfrastructure) << "Fork server listening on " << path;
+
+	// How often to reap finished simulations while no connections arrive
+	const int reap_interval_ms = 1000;
+
+	int rc = 0;
+	while(true) {
+		// There is no system to halt, so a captured signal (e.g. SIGINT)
+		// shuts the server down
+		struct pollfd pfd = { server_fd, POLLIN, 0 };
+		int ready = poll(&pfd, 1, reap_interval_ms);
+		if(ready < 0) {
+			if(errno != EINTR) {
+				LC_ERROR(LogInfrastructure) << "Unable to wait for fork server connection: " << strerror(errno);
+				rc = -1;
+			}
+			break;
+		}
+
+		reap_simulations();
+		if(ready == 0) {
+			continue;
+		}
+
+		int conn_fd = accept4(server_fd, NULL, NULL, SOCK_CLOEXEC);
+		if(conn_fd < 0) {
+			if(errno != EINTR) {
+				LC_ERROR(LogInfrastructure) << "Unable to accept fork server connection: " << strerror(errno);
+				rc = -1;
+			}
+			break;
+		}
+
+		pid_t child = fork();
+		if(child == 0) {
+			close(server_fd);
+			dup2(conn_fd, STDIN_FILENO);
+			dup2(conn_fd, STDOUT_FILENO);
+			dup2(conn_fd, STDERR_FILENO);
+
+			int rc = run_simple_simulation(session);
+			fflush(stdout);
+			fflush(stderr);
+			_exit(rc);
+		}
+
+		if(child < 0) {
+			LC_ERROR(LogInfrastructure) << "Unable to fork simulation: " << strerror(errno);
+		} else {
+			LC_INFO(LogInfrastructure) << "Started simulation " << child;
+		}
+		close(conn_fd);
+	}
+
+	close(server_fd);
+	unlink(path.c_str());
+	return rc;
+}
+
 /**
  * Application entry point
  * @param argc Number of command-line arguments (including program name)
@@ -215,7 +349,11 @@ int main(int argc, char *argv[])
 		std::cout << "Initialisation Time: " << init_timer.GetElapsedS() << std::endl;
 	}
 
-	rc = run_simple_simulation(session);
+	if (archsim::options::ForkServer.IsSpecified()) {
+		rc = run_fork_server(session);
+	} else {
+		rc = run_simple_simulation(session);
+	}
 
 out:
 	return rc;
@@ -16,6 +16,8 @@
 
 #include <libtrace/TraceSource.h>
 
+#include <ucontext.h>
+
 UseLogContext(LogInfrastructure);
 DeclareChildLogContext(LogSignals, LogInfrastructure, "Signals");
 DeclareChildLogContext(LogSegFault, LogSignals, "SegFault");
@@ -23,7 +25,7 @@ DeclareChildLogContext(LogSegFault, LogSignals, "SegFault");
 static std::vector<System *> sim_ctxs;
 
 static void sigint_handler(siginfo_t *si, void *unused);
-static void sigsegv_handler(siginfo_t *si, void *unused);
+static void sigsegv_handler(siginfo_t *si, void *context);
 static void sigtrap_handler(siginfo_t *si, void *unused);
 static void sigusr1_handler(siginfo_t *si, void *unused);
 static void sigusr2_handler(siginfo_t *si, void *unused);
@@ -114,7 +116,7 @@ static void sigusr1_handler(siginfo_t *si, void *unused)
 static void sigusr2_handler(siginfo_t *si, void *unused)
 {
 	for(auto sim_ctx : sim_ctxs) {
-		UNIMPLEMENTED;
+		sim_ctx->RequestCheckpoint();
 	}
 }
 
@@ -134,7 +136,17 @@ static void sigtrap_handler(siginfo_t *si, void *unused)
 	exit(-1);
 }
 
-static void sigsegv_handler(siginfo_t *si, void *unused)
+// The host instruction which caused a signal, if we know how to find it
+static const void *get_host_pc(void *context)
+{
+#if ARCHSIM_SIMULATION_HOST_IS_x86_64
+	return (const void *)((ucontext_t *)context)->uc_mcontext.gregs[REG_RIP];
+#else
+	return nullptr;
+#endif
+}
+
+static void sigsegv_handler(siginfo_t *si, void *context)
 {
 	// Make sure we've got a simulation context at this point.
 	if(sim_ctxs.size()) {
@@ -143,10 +155,17 @@ static void sigsegv_handler(siginfo_t *si, void *unused)
 			if(sim_ctx->GetEmulationModel().GetMemoryModel().HandleSegFault((archsim::abi::memory::host_const_addr_t)si->si_addr)) return;
 		}
 
+		// Handlers registered with the system (e.g. framebuffer write
+		// tracking) cover memory which the guest can also access, so they
+		// have to be tried before the fault becomes a guest exception
 		for(auto sim_ctx : sim_ctxs) {
 			if(sim_ctx->HandleSegFault((uint64_t)si->si_addr)) return;
 		}
 
+		for(auto sim_ctx : sim_ctxs) {
+			if(sim_ctx->GetEmulationModel().HandleSegFault(si->si_addr, get_host_pc(context))) return;
+		}
+
 		//None of our simulation contexts could handle the segfault, so abort.
 		for(auto sim_ctx : sim_ctxs) {
 
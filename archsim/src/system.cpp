@@ -7,6 +7,8 @@
 
 #include "abi/EmulationModel.h"
 #include "abi/memory/MemoryCounterEventHandler.h"
+#include "abi/memory/system/MMAPSystemMemoryModel.h"
+#include "abi/devices/generic/timing/TickConsumer.h"
 #include "abi/devices/generic/timing/TickSource.h"
 
 #include "core/thread/ThreadInstance.h"
@@ -14,14 +16,25 @@
 
 #include "translate/TranslationManager.h"
 
+#include "util/Checkpoint.h"
 #include "util/ComponentManager.h"
 #include "util/LogContext.h"
 #include "util/SimOptions.h"
 #include "util/LivePerformanceMeter.h"
+#include "util/ProfileDump.h"
 
 #include "uarch/uArch.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <libtrace/TraceSink.h>
 
 DeclareLogContext(LogSystem, "System");
@@ -33,8 +46,10 @@ System::System(archsim::Session& session) :
 	uarch(NULL),
 	emulation_model(NULL),
 	_halted(false),
+	checkpoint_requested_(false),
 	_tick_source(NULL),
-	code_region_tracker_(pubsubctx)
+	code_region_tracker_(pubsubctx),
+	segfault_handlers(nullptr)
 {
 	max_fd = 0;
 	OpenFD(STDIN_FILENO);
@@ -64,6 +79,13 @@ bool System::Initialise()
 
 			sink = new libtrace::BinaryFileTraceSink(archsim::options::TraceFile.GetValue());
 
+		} else if(archsim::options::TraceMode == "lz4") {
+			if(!archsim::options::TraceFile.IsSpecified()) {
+				UNIMPLEMENTED;
+			}
+
+			sink = new libtrace::CompressedFileTraceSink(archsim::options::TraceFile.GetValue());
+
 		} else {
 			UNIMPLEMENTED;
 		}
@@ -144,12 +166,233 @@ void System::PrintStatistics(std::ostream& stream)
 	stream << std::endl;
 }
 
+void System::WriteMetrics(std::ostream& stream)
+{
+	archsim::core::thread::ThreadMetricPrinter printer;
+
+	stream << "{\"exit_code\":" << exit_code << ",\"threads\":[";
+	bool first = true;
+	for(auto context : GetECM()) {
+		for(auto thread : context->GetThreads()) {
+			if(!first) stream << ",";
+			first = false;
+			printer.PrintJSON(thread->GetMetrics(), stream);
+		}
+	}
+	stream << "]}" << std::endl;
+}
+
+void System::WriteProfiles()
+{
+	std::vector<archsim::core::thread::ThreadInstance *> threads;
+	for(auto context : GetECM()) {
+		for(auto thread : context->GetThreads()) {
+			threads.push_back(thread);
+		}
+	}
+
+	// The text profiles combine all of the threads. The histograms can be
+	// read without stopping their threads, so this doesn't need any locking.
+	archsim::core::thread::HistogramPrinter hp;
+	auto hex_key = [](uint64_t i) {
+		std::stringstream str;
+		str << std::hex << i;
+		return str.str();
+	};
+
+	if(archsim::options::ProfileIrFreq) {
+		archsim::util::ProfileHistogram merged;
+		for(auto thread : threads) {
+			merged.merge(thread->GetMetrics().InstructionIRHistogram);
+		}
+
+		std::ofstream ir_str ("ir_freq.out");
+		hp.PrintHistogram(merged, ir_str, hex_key);
+	}
+	if(archsim::options::ProfilePcFreq) {
+		archsim::util::ProfileHistogram merged;
+		for(auto thread : threads) {
+			merged.merge(thread->GetMetrics().PCHistogram);
+		}
+
+		std::ofstream pc_str("pc_freq.out");
+		hp.PrintHistogram(merged, pc_str, hex_key);
+	}
+
+	// The binary profile keeps each thread separate, so that they can be
+	// compared with archsim-profile
+	if(archsim::options::ProfileFile.IsSpecified()) {
+		std::ofstream profile_file(archsim::options::ProfileFile.GetValue(), std::ios::binary);
+		archsim::util::ProfileWriter writer(profile_file);
+
+		bool ok = writer.WriteHeader();
+		for(auto thread : threads) {
+			auto &metrics = thread->GetMetrics();
+			if(archsim::options::Profile) {
+				ok &= writer.WriteHistogram("opcode", thread->GetThreadID(), metrics.OpcodeHistogram);
+				ok &= writer.WriteHistogram("opcode-pair", thread->GetThreadID(), metrics.OpcodePairHistogram);
+			}
+			if(archsim::options::ProfilePcFreq) {
+				ok &= writer.WriteHistogram("pc", thread->GetThreadID(), metrics.PCHistogram);
+			}
+			if(archsim::options::ProfileIrFreq) {
+				ok &= writer.WriteHistogram("ir", thread->GetThreadID(), metrics.InstructionIRHistogram);
+			}
+		}
+
+		if(!ok) {
+			LC_ERROR(LogSystem) << "Failed to write profile to " << archsim::options::ProfileFile.GetValue();
+		}
+	}
+}
+
+/*
+ * Requests a checkpoint once the tick counter reaches a given value
+ */
+class CheckpointTrigger : public archsim::abi::devices::timing::TickConsumer
+{
+public:
+	CheckpointTrigger(System &system, uint64_t ticks) : system_(system), remaining_(ticks) {}
+
+	void Tick(uint32_t tick_periods) override
+	{
+		if(remaining_ == 0) {
+			return;
+		}
+
+		remaining_ -= std::min<uint64_t>(remaining_, tick_periods);
+		if(remaining_ == 0) {
+			system_.RequestCheckpoint();
+		}
+	}
+
+	uint64_t GetTicksUntilDeadline() override
+	{
+		return remaining_ == 0 ? kNoDeadline : remaining_;
+	}
+
+private:
+	System &system_;
+	uint64_t remaining_;
+};
+
 bool System::RunSimulation()
 {
-	if (!emulation_model->PrepareBoot(*this)) return false;
-	GetECM().Start();
-	GetECM().Join();
+	if(archsim::options::CheckpointRestore.IsSpecified()) {
+		if(!RestoreCheckpoint(archsim::options::CheckpointRestore)) {
+			return false;
+		}
+	} else if (!emulation_model->PrepareBoot(*this)) {
+		return false;
+	}
+
+	if(archsim::options::CheckpointAt.IsSpecified() && archsim::options::CheckpointAt > GetTickSource()->GetCounter()) {
+		checkpoint_trigger_.reset(new CheckpointTrigger(*this, archsim::options::CheckpointAt - GetTickSource()->GetCounter()));
+		GetTickSource()->AddConsumer(*checkpoint_trigger_);
+	}
+
+	while(true) {
+		GetECM().Start();
+		GetECM().Join();
+
+		// The cores stop between blocks when a checkpoint is requested, so
+		// their state is consistent and they can carry on afterwards
+		if(!checkpoint_requested_.exchange(false)) {
+			break;
+		}
+
+		if(!SaveCheckpoint(archsim::options::CheckpointSave)) {
+			return false;
+		}
+
+		if(_halted || archsim::options::CheckpointExit) {
+			break;
+		}
+	}
+
+	if(checkpoint_trigger_ != nullptr) {
+		GetTickSource()->RemoveConsumer(*checkpoint_trigger_);
+	}
+
+	return true;
+}
+
+void System::RequestCheckpoint()
+{
+	if(!archsim::options::CheckpointSave.IsSpecified()) {
+		LC_WARNING(LogSystem) << "Ignoring checkpoint request, since no checkpoint directory was given";
+		return;
+	}
+
+	if(!checkpoint_requested_.exchange(true)) {
+		emulation_model->HaltCores();
+	}
+}
+
+// Write a file alongside its final location and then move it into place,
+// so that an existing checkpoint (whose memory image may be mapped by this
+// process) is never modified
+static bool ReplaceFile(const std::string &filename, const std::function<bool(const std::string &)> &write)
+{
+	std::string temp_filename = filename + ".tmp";
+	if(!write(temp_filename)) {
+		unlink(temp_filename.c_str());
+		return false;
+	}
+
+	return rename(temp_filename.c_str(), filename.c_str()) == 0;
+}
+
+bool System::SaveCheckpoint(const std::string& directory)
+{
+	auto memory = dynamic_cast<archsim::abi::memory::MMAPPhysicalMemory *>(&emulation_model->GetMemoryModel());
+	if(memory == nullptr) {
+		LC_ERROR(LogSystem) << "Checkpoints can only be taken with the mmap memory model";
+		return false;
+	}
+
+	if(mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+		LC_ERROR(LogSystem) << "Unable to create checkpoint directory " << directory << ": " << strerror(errno);
+		return false;
+	}
+
+	archsim::util::Checkpoint checkpoint;
+	if(!emulation_model->SaveState(checkpoint)) {
+		return false;
+	}
+
+	bool saved = ReplaceFile(directory + "/state", [&checkpoint](const std::string &filename) {
+		std::ofstream file (filename, std::ios::binary);
+		return checkpoint.Save(file);
+	});
+	// The memory snapshot replaces an existing one itself
+	saved = saved && memory->SaveSnapshot(directory + "/memory");
+
+	if(!saved) {
+		LC_ERROR(LogSystem) << "Unable to write checkpoint to " << directory;
+		return false;
+	}
 
+	LC_INFO(LogSystem) << "Saved checkpoint to " << directory << " at tick " << GetTickSource()->GetCounter();
+	return true;
+}
+
+bool System::RestoreCheckpoint(const std::string& directory)
+{
+	// Guest memory has already been mapped from the image (see main), so
+	// only the machine state needs to be loaded
+	archsim::util::Checkpoint checkpoint;
+	std::ifstream file (directory + "/state", std::ios::binary);
+	if(!file || !checkpoint.Load(file)) {
+		LC_ERROR(LogSystem) << "Unable to read checkpoint from " << directory;
+		return false;
+	}
+
+	if(!emulation_model->RestoreState(checkpoint)) {
+		return false;
+	}
+
+	LC_INFO(LogSystem) << "Restored checkpoint from " << directory << " at tick " << GetTickSource()->GetCounter();
 	return true;
 }
 
@@ -160,12 +403,63 @@ void System::HaltSimulation()
 
 }
 
+bool System::SkipIdleTime()
+{
+	if(_tick_source == nullptr) {
+		return false;
+	}
+
+	return _tick_source->SkipToNextDeadline();
+}
+
+void System::ReplaceSegFaultHandlers(segfault_handler_map_t *handlers)
+{
+	segfault_handler_maps.emplace_back(handlers);
+	segfault_handlers.store(handlers, std::memory_order_release);
+}
+
+void System::RegisterSegFaultHandler(uint64_t addr, size_t size, void *ctx, segfault_handler_t handler)
+{
+	assert((addr & (getpagesize()-1)) == 0);
+
+	std::lock_guard<std::mutex> l(segfault_handler_lock);
+
+	auto current = segfault_handlers.load(std::memory_order_relaxed);
+	auto handlers = current ? new segfault_handler_map_t(*current) : new segfault_handler_map_t();
+	assert(handlers->find(addr) == handlers->end());
+
+	segfault_handler_registration_t& rg = (*handlers)[addr];
+	rg.size = size;
+	rg.handler = handler;
+	rg.ctx = ctx;
+
+	ReplaceSegFaultHandlers(handlers);
+}
+
+void System::UnregisterSegFaultHandler(uint64_t addr)
+{
+	std::lock_guard<std::mutex> l(segfault_handler_lock);
+
+	auto current = segfault_handlers.load(std::memory_order_relaxed);
+	if(current == nullptr || current->count(addr) == 0) {
+		return;
+	}
+
+	auto handlers = new segfault_handler_map_t(*current);
+	handlers->erase(addr);
+
+	ReplaceSegFaultHandlers(handlers);
+}
+
 bool System::HandleSegFault(uint64_t addr)
 {
-	if (segfault_handlers.size() == 0)
+	auto handlers = segfault_handlers.load(std::memory_order_acquire);
+	if (handlers == nullptr || handlers->size() == 0)
 		return false;
 
-	segfault_handler_map_t::const_iterator iter = segfault_handlers.upper_bound(addr);
+	segfault_handler_map_t::const_iterator iter = handlers->upper_bound(addr);
+	if (iter == handlers->begin())
+		return false;
 	iter--;
 
 	if (addr >= iter->first && (addr < iter->first + iter->second.size)) {
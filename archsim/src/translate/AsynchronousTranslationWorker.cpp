@@ -48,76 +48,29 @@ AsynchronousTranslationWorker::AsynchronousTranslationWorker(AsynchronousTransla
  */
 void AsynchronousTranslationWorker::run()
 {
-
-	// Instantiate the unique lock for the work unit queue.
-	std::unique_lock<std::mutex> queue_lock(mgr.work_unit_queue_lock, std::defer_lock);
+	auto &queue = *mgr.work_queue_;
 
 	// Loop until told to terminate.
 	while (!terminate) {
-		// Acquire the work unit queue lock.
-		queue_lock.lock();
+		// Dequeue the hottest translation work unit. Units whose regions have
+		// become invalid are cancelled by the queue.
+		TranslationWorkUnit *unit = queue.Pop(id);
 
-		// Loop until work becomes available, or we're asked to terminate.
-		while (mgr.work_unit_queue_.empty() && !terminate) {
+		if (!unit) {
 			// first do a bit of busy work
 			compiler_.GC();
 
-			// Wait on the work unit queue signal.
-			mgr.work_unit_queue_cond.wait(queue_lock);
+			// Wait for work to become available, or to be asked to terminate.
+			queue.WaitForWork(terminate);
+			continue;
 		}
 
-		// If we woke up because we were asked to terminate, then release the
-		// work unit queue lock and exit the loop.
 		if (terminate) {
-			queue_lock.unlock();
+			delete unit;
 			break;
 		}
 
-		// Dequeue the translation work unit.
-		TranslationWorkUnit *unit;
-
-		// Skip over work units that are invalid.
-		do {
-			// Detect the case when we've cleared the work unit queue of valid translations.
-			if (mgr.work_unit_queue_.empty()) {
-				unit = NULL;
-				break;
-			}
-
-
-			auto best_it = mgr.work_unit_queue_.begin();
-			uint64_t max_heat = (*best_it)->GetWeight();
-			auto it = mgr.work_unit_queue_.begin();
-			while(it != mgr.work_unit_queue_.end()) {
-				auto this_heat = (*it)->GetWeight();
-				if(this_heat > max_heat) {
-					max_heat = this_heat;
-					best_it = it;
-				}
-				it++;
-			}
-			unit = *best_it;
-			mgr.work_unit_queue_.erase(best_it);
-
-			if (!unit->GetRegion().IsValid()) {
-				LC_DEBUG1(LogWorkQueue) << "[DEQUEUE] Skipping " << *unit;
-				delete unit;
-
-				//Setting unit to null here will cause us to break out of this do, while loop,
-				//and then hit the continue a little later on in the main while loop. This
-				//entire loop is somewhat too complicated and should be broken up.
-				unit = NULL;
-				break;
-			}
-		} while (!terminate && !unit->GetRegion().IsValid());
-
-		// Release the queue lock.
-		queue_lock.unlock();
-
-		if (terminate || !unit)
-			continue;
-
-		LC_DEBUG1(LogWorkQueue) << "[DEQUEUE] Dequeueing " << *unit << ", queue length " << mgr.work_unit_queue_.size() << ", @ " << (uint32_t)id;
+		LC_DEBUG1(LogWorkQueue) << "[DEQUEUE] Dequeueing " << *unit << ", queue length " << queue.Size() << ", @ " << (uint32_t)id;
 
 		// Perform the translation, and destroy the translation work unit.
 		Translate(*unit);
@@ -134,10 +87,8 @@ void AsynchronousTranslationWorker::stop()
 	// Set the termination flag.
 	terminate = true;
 
-	// Signal the thread to wake-up, if it's waiting on the work unit queue lock.
-	mgr.work_unit_queue_lock.lock();
-	mgr.work_unit_queue_cond.notify_all();
-	mgr.work_unit_queue_lock.unlock();
+	// Signal the thread to wake-up, if it's waiting for work.
+	mgr.work_queue_->Wake();
 
 	// Wait for the thread to terminate.
 	join();
@@ -0,0 +1,208 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "translate/TranslationWorkQueue.h"
+#include "translate/TranslationWorkUnit.h"
+#include "translate/profile/Region.h"
+#include "util/LogContext.h"
+
+#include <algorithm>
+#include <iomanip>
+
+UseLogContext(LogTranslate);
+DeclareChildLogContext(LogWorkQueue, LogTranslate, "WorkQueue");
+
+using namespace archsim::translate;
+
+const TranslationWorkQueue::clock_t::duration TranslationWorkQueue::kDefaultRefreshInterval = std::chrono::milliseconds(1);
+
+template<typename T> static void atomic_max(std::atomic<T> &value, T candidate)
+{
+	T current = value.load(std::memory_order_relaxed);
+	while(candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed));
+}
+
+TranslationWorkQueue::TranslationWorkQueue(unsigned int shard_count, clock_t::duration refresh_interval) : refresh_interval_(refresh_interval), next_shard_(0), size_(0), enqueued_(0), dequeued_(0), stolen_(0), cancelled_(0), refreshes_(0), max_size_(0), total_wait_us_(0), max_wait_us_(0)
+{
+	if(shard_count == 0) {
+		shard_count = 1;
+	}
+
+	for(unsigned int i = 0; i < shard_count; ++i) {
+		auto shard = new Shard();
+		shard->LastRefresh = clock_t::now();
+		shard->HeadWeight = -1;
+		shards_.push_back(std::unique_ptr<Shard>(shard));
+	}
+}
+
+TranslationWorkQueue::~TranslationWorkQueue()
+{
+	Clear();
+}
+
+void TranslationWorkQueue::updateHead(Shard &shard)
+{
+	shard.HeadWeight = shard.Heap.empty() ? -1 : (int64_t)shard.Heap.front().Weight;
+}
+
+void TranslationWorkQueue::Push(TranslationWorkUnit *unit)
+{
+	Entry entry;
+	entry.Unit = unit;
+	entry.Weight = unit->GetWeight();
+	entry.Enqueued = clock_t::now();
+
+	auto &shard = *shards_[next_shard_++ % shards_.size()];
+	{
+		std::lock_guard<std::mutex> l(shard.Lock);
+		shard.Heap.push_back(entry);
+		std::push_heap(shard.Heap.begin(), shard.Heap.end());
+		updateHead(shard);
+	}
+
+	auto size = ++size_;
+	enqueued_++;
+	atomic_max(max_size_, size);
+
+	{
+		std::lock_guard<std::mutex> l(wait_lock_);
+	}
+	wait_cond_.notify_one();
+}
+
+void TranslationWorkQueue::refresh(Shard &shard, std::vector<TranslationWorkUnit*> &cancelled)
+{
+	// Regions keep getting hotter while they wait, so re-weigh everything
+	auto i = shard.Heap.begin();
+	while(i != shard.Heap.end()) {
+		if(!i->Unit->GetRegion().IsValid()) {
+			cancelled.push_back(i->Unit);
+			i = shard.Heap.erase(i);
+		} else {
+			i->Weight = i->Unit->GetWeight();
+			++i;
+		}
+	}
+
+	std::make_heap(shard.Heap.begin(), shard.Heap.end());
+	shard.LastRefresh = clock_t::now();
+	refreshes_++;
+}
+
+bool TranslationWorkQueue::popFrom(Shard &shard, Entry &entry, std::vector<TranslationWorkUnit*> &cancelled)
+{
+	std::lock_guard<std::mutex> l(shard.Lock);
+
+	size_t cancelled_before = cancelled.size();
+	if(!shard.Heap.empty() && clock_t::now() - shard.LastRefresh >= refresh_interval_) {
+		refresh(shard, cancelled);
+	}
+
+	bool found = false;
+	while(!shard.Heap.empty()) {
+		std::pop_heap(shard.Heap.begin(), shard.Heap.end());
+		entry = shard.Heap.back();
+		shard.Heap.pop_back();
+
+		if(entry.Unit->GetRegion().IsValid()) {
+			found = true;
+			break;
+		}
+
+		cancelled.push_back(entry.Unit);
+	}
+
+	updateHead(shard);
+
+	size_t removed = (cancelled.size() - cancelled_before) + (found ? 1 : 0);
+	size_ -= removed;
+	cancelled_ += cancelled.size() - cancelled_before;
+
+	return found;
+}
+
+TranslationWorkUnit *TranslationWorkQueue::Pop(unsigned int worker)
+{
+	std::vector<TranslationWorkUnit*> cancelled;
+
+	unsigned int own = worker % shards_.size();
+	Entry entry;
+	bool found = false;
+
+	while(size_ > 0) {
+		// Find the shard with the hottest head, preferring our own
+		unsigned int best = own;
+		int64_t best_weight = shards_[own]->HeadWeight;
+		for(unsigned int i = 0; i < shards_.size(); ++i) {
+			int64_t weight = shards_[i]->HeadWeight;
+			if(weight > best_weight) {
+				best = i;
+				best_weight = weight;
+			}
+		}
+
+		if(best_weight < 0) {
+			break;
+		}
+
+		if(popFrom(*shards_[best], entry, cancelled)) {
+			found = true;
+			if(best != own) {
+				stolen_++;
+			}
+			break;
+		}
+	}
+
+	for(auto unit : cancelled) {
+		LC_DEBUG1(LogWorkQueue) << "[DEQUEUE] Cancelling " << *unit;
+		delete unit;
+	}
+
+	if(!found) {
+		return nullptr;
+	}
+
+	uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(clock_t::now() - entry.Enqueued).count();
+	dequeued_++;
+	total_wait_us_ += wait_us;
+	atomic_max(max_wait_us_, wait_us);
+
+	return entry.Unit;
+}
+
+void TranslationWorkQueue::WaitForWork(const volatile bool &terminate)
+{
+	std::unique_lock<std::mutex> l(wait_lock_);
+	wait_cond_.wait(l, [&] { return size_ > 0 || terminate; });
+}
+
+void TranslationWorkQueue::Wake()
+{
+	std::lock_guard<std::mutex> l(wait_lock_);
+	wait_cond_.notify_all();
+}
+
+void TranslationWorkQueue::Clear()
+{
+	for(auto &shard : shards_) {
+		std::lock_guard<std::mutex> l(shard->Lock);
+
+		for(auto &entry : shard->Heap) {
+			delete entry.Unit;
+		}
+		size_ -= shard->Heap.size();
+		shard->Heap.clear();
+		updateHead(*shard);
+	}
+}
+
+void TranslationWorkQueue::PrintStatistics(std::ostream &stream) const
+{
+	uint64_t dequeued = dequeued_;
+
+	stream << "Work Queue Size: " << size_ << " (max " << max_size_ << ")" << std::endl;
+	stream << "Work Queue Units: " << enqueued_ << " enqueued, " << dequeued << " dequeued, " << stolen_ << " stolen, " << cancelled_ << " cancelled" << std::endl;
+	stream << "Work Queue Wait: " << std::fixed << std::setprecision(2) << (dequeued ? (double)total_wait_us_ / dequeued / 1000.0 : 0.0) << " ms average, " << (double)max_wait_us_ / 1000.0 << " ms max";
+	stream << " (" << refreshes_ << " refreshes)" << std::endl;
+}
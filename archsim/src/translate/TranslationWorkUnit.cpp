@@ -11,6 +11,7 @@
 
 #include "util/LogContext.h"
 
+#include <algorithm>
 #include <stdio.h>
 
 UseLogContext(LogTranslate);
@@ -33,7 +34,13 @@ TranslationWorkUnit::~TranslationWorkUnit()
 
 uint32_t TranslationWorkUnit::GetWeight() const
 {
-	return GetRegion().GetTotalInterpCount() - dispatch_heat_;
+	// The region's heat is reset once it has been dispatched for translation,
+	// so the unit gets hotter as the region continues to be interpreted.
+	uint64_t heat = GetRegion().GetTotalInterpCount();
+	if(heat >= dispatch_heat_) {
+		heat -= dispatch_heat_;
+	}
+	return std::min<uint64_t>(weight + heat, UINT32_MAX);
 }
 
 
@@ -4,6 +4,7 @@
 #include "define.h"
 
 #include "abi/devices/MMU.h"
+#include "abi/devices/generic/timing/TickSource.h"
 #include "abi/memory/MemoryModel.h"
 
 #include "core/MemoryInterface.h"
@@ -222,6 +223,21 @@ extern "C" {
 		cpu->PendIRQ();
 	}
 
+	void cpuWaitForInterrupt(archsim::core::thread::ThreadInstance *cpu)
+	{
+		cpu->WaitForInterrupt();
+	}
+
+	void cpuWaitForEvent(archsim::core::thread::ThreadInstance *cpu)
+	{
+		cpu->WaitForEvent();
+	}
+
+	void cpuSendEvent(archsim::core::thread::ThreadInstance *cpu)
+	{
+		cpu->SendEvent();
+	}
+
 	uint32_t cpuTranslate(gensim::Processor *cpu, uint32_t virt_addr, uint32_t *phys_addr)
 	{
 		UNIMPLEMENTED;
@@ -401,9 +417,11 @@ extern "C" {
 //		cpu->enter_user_mode();
 	}
 
-	void cpuInstructionTick(archsim::core::thread::ThreadInstance *cpu)
+	void cpuInstructionTick(archsim::core::thread::ThreadInstance *cpu, uint32_t count)
 	{
-		cpu->GetEmulationModel().GetSystem().GetPubSub().Publish(PubSubType::InstructionExecute, NULL);
+		// Only emitted with --instruction-tick, which installs an instruction count tick source
+		auto tick_source = static_cast<archsim::abi::devices::timing::InstructionCountTickSource *>(cpu->GetEmulationModel().GetSystem().GetTickSource());
+		tick_source->AddInstructions(count);
 	}
 
 	/*
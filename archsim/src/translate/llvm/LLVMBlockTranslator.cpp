@@ -81,10 +81,6 @@ llvm::BasicBlock *LLVMBlockTranslator::TranslateBlock(Address block_base, Transl
 	for(auto insn : block.GetInstructions()) {
 		auto insn_pc = block_base + insn->GetOffset();
 
-		if(archsim::options::InstructionTick) {
-			builder.CreateCall(ctx_.Functions.InstructionTick, {ctx_.GetThreadPtr(builder)});
-		}
-
 		if(insn->GetDecode().GetIsPredicated()) {
 			TranslateInstructionPredicated(builder, ctx_, txlt_, ctx_.GetThread(), &insn->GetDecode(), insn_pc, target_fn_);
 		} else {
@@ -127,6 +123,12 @@ llvm::BasicBlock *LLVMBlockTranslator::TranslateBlock(Address block_base, Transl
 
 	}
 
+	// The virtual clock is advanced when the end of the block is reached, as
+	// in the BlockJIT and the interpreter
+	if(archsim::options::InstructionTick) {
+		builder.CreateCall(ctx_.Functions.InstructionTick, {ctx_.GetThreadPtr(builder), llvm::ConstantInt::get(ctx_.Types.i32, block.GetInstructions().size())});
+	}
+
 	delete ji;
 	return builder.GetInsertBlock();
 }
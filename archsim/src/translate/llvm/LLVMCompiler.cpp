@@ -196,15 +196,20 @@ LLVMCompiledModuleHandle LLVMCompiler::AddModule(llvm::Module* module)
 	return LLVMCompiledModuleHandle(&dylib, vmodule);
 }
 
-LLVMTranslation * LLVMCompiler::GetTranslation(LLVMCompiledModuleHandle& handle, TranslationWorkUnit &twu)
+void *LLVMCompiler::GetSymbol(LLVMCompiledModuleHandle& handle, const std::string &name)
 {
-	auto symbol = session_.lookup({handle.Lib}, llvm::StringRef("fn_" + std::to_string(twu.GetRegion().GetPhysicalBaseAddress().Get())));
+	auto symbol = session_.lookup({handle.Lib}, llvm::StringRef(name));
 	if(!symbol) {
 		auto error (std::move(symbol.takeError()));
 		return nullptr;
 	}
 
-	auto address = symbol->getAddress();
+	return (void*)symbol->getAddress();
+}
+
+LLVMTranslation * LLVMCompiler::GetTranslation(LLVMCompiledModuleHandle& handle, TranslationWorkUnit &twu)
+{
+	auto address = GetSymbol(handle, "fn_" + std::to_string(twu.GetRegion().GetPhysicalBaseAddress().Get()));
 	if(!address) {
 		return nullptr;
 	}
@@ -325,8 +325,11 @@ LLVMTranslationContext::LLVMTranslationContext(llvm::LLVMContext &ctx, llvm::Fun
 	Functions.cpuEnterKernel = (llvm::Function*)Module->getOrInsertFunction("cpuEnterKernelMode", Types.vtype, Types.i8Ptr);
 	Functions.cpuPendIRQ = (llvm::Function*)Module->getOrInsertFunction("cpuPendInterrupt", Types.vtype, Types.i8Ptr);
 	Functions.cpuPushInterrupt = (llvm::Function*)Module->getOrInsertFunction("cpuPushInterrupt", Types.vtype, Types.i8Ptr, Types.i32);
+	Functions.cpuWaitForInterrupt = (llvm::Function*)Module->getOrInsertFunction("cpuWaitForInterrupt", Types.vtype, Types.i8Ptr);
+	Functions.cpuWaitForEvent = (llvm::Function*)Module->getOrInsertFunction("cpuWaitForEvent", Types.vtype, Types.i8Ptr);
+	Functions.cpuSendEvent = (llvm::Function*)Module->getOrInsertFunction("cpuSendEvent", Types.vtype, Types.i8Ptr);
 
-	Functions.InstructionTick = (llvm::Function*)Module->getOrInsertFunction("cpuInstructionTick", Types.vtype, Types.i8Ptr);
+	Functions.InstructionTick = (llvm::Function*)Module->getOrInsertFunction("cpuInstructionTick", Types.vtype, Types.i8Ptr, Types.i32);
 
 	guest_reg_emitter_ = std::unique_ptr<LLVMGuestRegisterAccessEmitter>(new GEPLLVMGuestRegisterAccessEmitter(*this));
 	memory_access_emitter_ = std::unique_ptr<LLVMMemoryAccessEmitter>(new BaseLLVMMemoryAccessEmitter(*this));
@@ -0,0 +1,104 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "util/Checkpoint.h"
+
+#include <stdexcept>
+
+using namespace archsim::util;
+
+static const char kCheckpointMagic[8] = { 'A', 'S', 'C', 'K', 'P', 'T', 0, 0 };
+static const uint32_t kCheckpointVersion = 1;
+
+// Sanity limit on section sizes when loading, so a corrupt file fails
+// cleanly rather than trying to allocate an enormous buffer
+static const uint64_t kMaxSectionSize = 1ull << 32;
+
+struct CheckpointFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t section_count;
+};
+
+struct CheckpointSectionHeader {
+	uint32_t name_length;
+	uint32_t reserved;
+	uint64_t data_length;
+};
+
+CheckpointWriter Checkpoint::AddSection(const std::string& name)
+{
+	auto result = sections_.insert({name, std::vector<uint8_t>()});
+	if(!result.second) {
+		throw std::logic_error("Checkpoint section added twice: " + name);
+	}
+
+	return CheckpointWriter(result.first->second);
+}
+
+CheckpointReader Checkpoint::GetSection(const std::string& name) const
+{
+	return CheckpointReader(sections_.at(name));
+}
+
+bool Checkpoint::Save(std::ostream& stream) const
+{
+	CheckpointFileHeader header;
+	memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+	header.version = kCheckpointVersion;
+	header.section_count = sections_.size();
+	stream.write((const char *)&header, sizeof(header));
+
+	for(const auto &section : sections_) {
+		CheckpointSectionHeader section_header;
+		section_header.name_length = section.first.size();
+		section_header.reserved = 0;
+		section_header.data_length = section.second.size();
+
+		stream.write((const char *)&section_header, sizeof(section_header));
+		stream.write(section.first.data(), section.first.size());
+		stream.write((const char *)section.second.data(), section.second.size());
+	}
+
+	return stream.good();
+}
+
+bool Checkpoint::Load(std::istream& stream)
+{
+	sections_.clear();
+
+	CheckpointFileHeader header;
+	if(!stream.read((char *)&header, sizeof(header))) {
+		return false;
+	}
+
+	if(memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) || header.version != kCheckpointVersion) {
+		return false;
+	}
+
+	for(uint32_t i = 0; i < header.section_count; ++i) {
+		CheckpointSectionHeader section_header;
+		if(!stream.read((char *)&section_header, sizeof(section_header))) {
+			return false;
+		}
+
+		if(section_header.data_length > kMaxSectionSize) {
+			return false;
+		}
+
+		std::string name (section_header.name_length, '\0');
+		if(!stream.read(&name[0], name.size())) {
+			return false;
+		}
+
+		std::vector<uint8_t> data (section_header.data_length);
+		if(!stream.read((char *)data.data(), data.size())) {
+			return false;
+		}
+
+		if(!sections_.insert({name, std::move(data)}).second) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -174,6 +174,44 @@ void SimpleZoneMemAllocator::Free(void *buffer)
 	if(buffer == _last_buffer) _last_buffer = NULL;
 }
 
+// Every live chunk is recorded here so that IsZoneMemory can be answered
+// without taking a lock. Chunks beyond the limit are simply not recorded.
+static const size_t kMaxRegisteredChunks = 4096;
+static std::atomic<uint8_t *> registered_chunks[kMaxRegisteredChunks];
+
+void SimpleZoneMemAllocator::RegisterChunk(uint8_t *data)
+{
+	for(auto &slot : registered_chunks) {
+		uint8_t *expected = nullptr;
+		if(slot.compare_exchange_strong(expected, data)) {
+			return;
+		}
+	}
+}
+
+void SimpleZoneMemAllocator::UnregisterChunk(uint8_t *data)
+{
+	for(auto &slot : registered_chunks) {
+		uint8_t *expected = data;
+		if(slot.compare_exchange_strong(expected, nullptr)) {
+			return;
+		}
+	}
+}
+
+bool SimpleZoneMemAllocator::IsZoneMemory(const void *ptr)
+{
+	auto cptr = (const uint8_t*)ptr;
+	for(auto &slot : registered_chunks) {
+		const uint8_t *data = slot.load(std::memory_order_acquire);
+		if(data != nullptr && cptr >= data && cptr < data + Chunk::kChunkSize) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 float SimpleZoneMemAllocator::Efficiency() const
 {
 	size_t total_space = 0;
@@ -0,0 +1,148 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "util/ProfileDump.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace archsim::util;
+
+static const char kProfileMagic[8] = { 'A', 'S', 'P', 'R', 'O', 'F', 0, 0 };
+static const uint32_t kProfileVersion = 1;
+
+// Entries are buffered up and written out in chunks of this size
+static const uint32_t kChunkEntries = 4096;
+
+struct ProfileFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+struct ProfileSectionHeader {
+	uint32_t name_length;
+	uint32_t thread_id;
+};
+
+struct ProfileChunkHeader {
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct ProfileEntry {
+	uint64_t key;
+	uint64_t value;
+};
+
+const uint32_t ProfileWriter::kAllThreads;
+
+ProfileWriter::ProfileWriter(std::ostream& stream) : stream_(stream)
+{
+
+}
+
+bool ProfileWriter::WriteHeader()
+{
+	ProfileFileHeader header;
+	memcpy(header.magic, kProfileMagic, sizeof(header.magic));
+	header.version = kProfileVersion;
+	header.reserved = 0;
+
+	stream_.write((const char *)&header, sizeof(header));
+	return stream_.good();
+}
+
+bool ProfileWriter::WriteHistogram(const std::string& name, uint32_t thread_id, const ProfileHistogram& histogram)
+{
+	ProfileSectionHeader section;
+	section.name_length = name.size();
+	section.thread_id = thread_id;
+
+	stream_.write((const char *)&section, sizeof(section));
+	stream_.write(name.data(), name.size());
+
+	std::vector<ProfileEntry> chunk;
+	chunk.reserve(kChunkEntries);
+
+	auto flush = [this, &chunk]() {
+		ProfileChunkHeader header;
+		header.count = chunk.size();
+		header.reserved = 0;
+
+		stream_.write((const char *)&header, sizeof(header));
+		stream_.write((const char *)chunk.data(), chunk.size() * sizeof(ProfileEntry));
+		chunk.clear();
+	};
+
+	histogram.for_each([&chunk, &flush](ProfileHistogram::key_t key, ProfileHistogram::value_t value) {
+		chunk.push_back({key, value});
+		if(chunk.size() == kChunkEntries) {
+			flush();
+		}
+	});
+
+	if(!chunk.empty()) {
+		flush();
+	}
+
+	// Terminating empty chunk
+	flush();
+
+	return stream_.good();
+}
+
+ProfileReader::ProfileReader(std::istream& stream) : stream_(stream)
+{
+
+}
+
+bool ProfileReader::ReadHeader()
+{
+	ProfileFileHeader header;
+	stream_.read((char *)&header, sizeof(header));
+	if(!stream_.good()) {
+		return false;
+	}
+
+	return memcmp(header.magic, kProfileMagic, sizeof(header.magic)) == 0 && header.version == kProfileVersion;
+}
+
+bool ProfileReader::ReadAll(const entry_callback_t& callback)
+{
+	std::vector<ProfileEntry> chunk;
+
+	while(true) {
+		ProfileSectionHeader section;
+		stream_.read((char *)&section, sizeof(section));
+		if(stream_.eof() && stream_.gcount() == 0) {
+			return true;
+		}
+		if(!stream_.good()) {
+			return false;
+		}
+
+		std::string name (section.name_length, '\0');
+		stream_.read(&name[0], section.name_length);
+
+		while(true) {
+			ProfileChunkHeader header;
+			stream_.read((char *)&header, sizeof(header));
+			if(!stream_.good()) {
+				return false;
+			}
+			if(header.count == 0) {
+				break;
+			}
+
+			chunk.resize(header.count);
+			stream_.read((char *)chunk.data(), header.count * sizeof(ProfileEntry));
+			if(!stream_.good()) {
+				return false;
+			}
+
+			for(const auto &entry : chunk) {
+				callback(name, section.thread_id, entry.key, entry.value);
+			}
+		}
+	}
+}
@@ -0,0 +1,164 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "util/ProfileHistogram.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace archsim::util;
+
+static const size_t kInitialDirectorySize = 64;
+static const size_t kMaxChunkPages = 64;
+
+ProfileHistogram::Directory::Directory(size_t capacity) : mask(capacity - 1)
+{
+	assert((capacity & (capacity - 1)) == 0);
+
+	entries = new DirectoryEntry[capacity];
+	for(size_t i = 0; i < capacity; ++i) {
+		entries[i].tag.store(0, std::memory_order_relaxed);
+		entries[i].page = nullptr;
+	}
+}
+
+ProfileHistogram::Directory::~Directory()
+{
+	delete [] entries;
+}
+
+ProfileHistogram::ProfileHistogram(unsigned page_bits) : page_bits_(page_bits), page_mask_((1ull << page_bits) - 1), directory_(new Directory(kInitialDirectorySize)), page_count_(0), chunk_pages_left_(0)
+{
+
+}
+
+ProfileHistogram::~ProfileHistogram()
+{
+	delete directory_.load();
+	for(auto dir : retired_directories_) {
+		delete dir;
+	}
+	for(auto chunk : chunks_) {
+		free(chunk);
+	}
+}
+
+void ProfileHistogram::insert_page(Directory* dir, uint64_t page_number, value_t* page)
+{
+	for(size_t slot = hash(page_number);; ++slot) {
+		DirectoryEntry &entry = dir->entries[slot & dir->mask];
+		if(entry.tag.load(std::memory_order_relaxed) == 0) {
+			// Publish the page before the tag, so that lock-free readers never
+			// see a tag without its page
+			entry.page = page;
+			entry.tag.store(page_number + 1, std::memory_order_release);
+			return;
+		}
+	}
+}
+
+ProfileHistogram::value_t* ProfileHistogram::allocate_page(uint64_t page_number)
+{
+	std::lock_guard<std::mutex> lock(allocation_lock_);
+
+	// Someone else may have got here first
+	value_t *page = lookup_page(page_number);
+	if(page != nullptr) {
+		return page;
+	}
+
+	size_t page_size = (page_mask_ + 1) * sizeof(value_t);
+	if(chunk_pages_left_ == 0) {
+		// Chunks start small, since most histograms only use a handful of pages
+		size_t chunk_pages = std::min(kMaxChunkPages, chunks_.size() + 1);
+		value_t *chunk = (value_t *)calloc(chunk_pages, page_size);
+		if(chunk == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		chunks_.push_back(chunk);
+		chunk_pages_left_ = chunk_pages;
+	}
+
+	size_t chunk_pages = std::min(kMaxChunkPages, chunks_.size());
+	page = chunks_.back() + (chunk_pages - chunk_pages_left_) * (page_mask_ + 1);
+	chunk_pages_left_--;
+
+	// Keep the directory at most half full
+	Directory *dir = directory_.load(std::memory_order_relaxed);
+	size_t count = page_count_.load(std::memory_order_relaxed) + 1;
+	if(count * 2 > dir->mask + 1) {
+		Directory *new_dir = new Directory((dir->mask + 1) * 2);
+		for(size_t i = 0; i <= dir->mask; ++i) {
+			uint64_t tag = dir->entries[i].tag.load(std::memory_order_relaxed);
+			if(tag != 0) {
+				insert_page(new_dir, tag - 1, dir->entries[i].page);
+			}
+		}
+
+		directory_.store(new_dir, std::memory_order_release);
+		retired_directories_.push_back(dir);
+		dir = new_dir;
+	}
+
+	insert_page(dir, page_number, page);
+	page_count_.store(count, std::memory_order_release);
+
+	return page;
+}
+
+ProfileHistogram::value_t ProfileHistogram::get_value_at_index(key_t key) const
+{
+	value_t *page = lookup_page(key >> page_bits_);
+	if(page == nullptr) {
+		return 0;
+	}
+	return page[key & page_mask_];
+}
+
+ProfileHistogram::value_t ProfileHistogram::get_total() const
+{
+	value_t total = 0;
+	for_each([&total](key_t key, value_t value) {
+		total += value;
+	});
+	return total;
+}
+
+void ProfileHistogram::clear()
+{
+	const Directory *dir = directory_.load(std::memory_order_acquire);
+	for(size_t i = 0; i <= dir->mask; ++i) {
+		if(dir->entries[i].tag.load(std::memory_order_acquire) != 0) {
+			bzero(dir->entries[i].page, (page_mask_ + 1) * sizeof(value_t));
+		}
+	}
+}
+
+void ProfileHistogram::for_each(const std::function<void(key_t, value_t)>& fn) const
+{
+	const Directory *dir = directory_.load(std::memory_order_acquire);
+	for(size_t i = 0; i <= dir->mask; ++i) {
+		uint64_t tag = dir->entries[i].tag.load(std::memory_order_acquire);
+		if(tag == 0) {
+			continue;
+		}
+
+		key_t base = (tag - 1) << page_bits_;
+		const value_t *page = dir->entries[i].page;
+		for(key_t offset = 0; offset <= page_mask_; ++offset) {
+			if(page[offset] != 0) {
+				fn(base | offset, page[offset]);
+			}
+		}
+	}
+}
+
+void ProfileHistogram::merge(const ProfileHistogram& other)
+{
+	other.for_each([this](key_t key, value_t value) {
+		inc(key, value);
+	});
+}
@@ -0,0 +1,106 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * Compares the memory monitors with guest threads incrementing one shared
+ * counter, and incrementing a counter each.
+ *
+ * Usage: bench-monitor [increments per thread]
+ */
+
+#include "TestThreadModel.h"
+#include "util/PubSubSync.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using archsim::core::MemoryMonitor;
+using archsim::core::thread::ThreadInstance;
+
+static const unsigned kMaxThreads = 64;
+
+// Returns the average time per increment in nanoseconds, or a negative value
+// if the counters are wrong at the end
+static double RunBenchmark(MemoryMonitor &monitor, std::vector<std::unique_ptr<ThreadInstance>> &guest_threads, unsigned thread_count, unsigned increments, bool shared)
+{
+	// Keep private counters in different reservation granules
+	std::vector<uint64_t> counters (thread_count * 8, 0);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for(unsigned i = 0; i < thread_count; ++i) {
+		uint64_t *counter = shared ? &counters[0] : &counters[i * 8];
+		ThreadInstance *thread = guest_threads[i].get();
+		threads.emplace_back([&monitor, thread, counter, increments] {
+			for(unsigned n = 0; n < increments; ++n) {
+				MonitorIncrement(monitor, thread, counter);
+			}
+		});
+	}
+	for(auto &thread : threads) {
+		thread.join();
+	}
+	auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	if(shared) {
+		if(counters[0] != thread_count * increments) {
+			return -1;
+		}
+	} else {
+		for(unsigned i = 0; i < thread_count; ++i) {
+			if(counters[i * 8] != increments) {
+				return -1;
+			}
+		}
+	}
+
+	return (double)duration / (thread_count * increments);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned increments = 4000;
+	if(argc > 1) {
+		increments = strtoul(argv[1], nullptr, 0);
+	}
+
+	const unsigned thread_counts[] = {1, 4, 16, kMaxThreads};
+
+	auto arch = GetTestThreadArch();
+	archsim::util::PubSubContext pubsub;
+	std::vector<std::unique_ptr<ThreadInstance>> guest_threads;
+	for(unsigned i = 0; i < kMaxThreads; ++i) {
+		guest_threads.push_back(std::unique_ptr<ThreadInstance>(new ThreadInstance(pubsub, arch, GetTestThreadEmulationModel(), i)));
+	}
+
+	std::cout << std::setw(10) << "monitor" << std::setw(10) << "threads" << std::setw(16) << "shared ns/op" << std::setw(16) << "private ns/op" << std::endl;
+
+	for(int sharded = 0; sharded < 2; ++sharded) {
+		for(unsigned thread_count : thread_counts) {
+			double results[2];
+
+			for(int shared = 1; shared >= 0; --shared) {
+				std::unique_ptr<MemoryMonitor> monitor;
+				if(sharded) {
+					monitor.reset(new archsim::core::ShardedMemoryMonitor());
+				} else {
+					monitor.reset(new archsim::core::BaseMemoryMonitor());
+				}
+
+				results[shared] = RunBenchmark(*monitor, guest_threads, thread_count, increments, shared);
+				if(results[shared] < 0) {
+					std::cerr << "Counter mismatch with " << thread_count << " threads" << std::endl;
+					return 1;
+				}
+			}
+
+			std::cout << std::setw(10) << (sharded ? "sharded" : "base") << std::setw(10) << thread_count << std::fixed << std::setprecision(1) << std::setw(16) << results[1] << std::setw(16) << results[0] << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,304 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "ArchSimBlockJITTest.h"
+
+#include "blockjit/BlockCache.h"
+#include "blockjit/BlockChainTable.h"
+#include "blockjit/BlockProfile.h"
+
+#include <memory>
+
+using namespace captive::shared;
+using archsim::Address;
+using archsim::blockjit::BlockChainTable;
+using archsim::blockjit::BlockProfile;
+using archsim::blockjit::BlockTranslation;
+using captive::shared::block_txln_fn;
+
+// A fake code buffer: two 'blocks', each containing one chain site
+struct alignas(16) FakeCode {
+	uint8_t block_a[64];
+	uint8_t block_b[64];
+};
+
+static int32_t SiteValue(uint8_t *site)
+{
+	return *(int32_t*)site;
+}
+
+TEST(BlockChainTable, LinkPatchesDisplacement)
+{
+	FakeCode code {};
+	BlockChainTable table;
+
+	uint8_t *site = code.block_a + 4;
+	ASSERT_TRUE(table.Link(site, (block_txln_fn)code.block_b, Address(0x1000)));
+
+	ASSERT_EQ(code.block_b, site + 4 + SiteValue(site));
+	ASSERT_EQ(1u, table.GetLinkCount());
+}
+
+TEST(BlockChainTable, ReleaseTargetUnlinks)
+{
+	FakeCode code {};
+	BlockChainTable table;
+
+	uint8_t *site = code.block_a + 4;
+	table.Link(site, (block_txln_fn)code.block_b, Address(0x1000));
+	table.Release((block_txln_fn)code.block_b, sizeof(code.block_b));
+
+	ASSERT_EQ(0, SiteValue(site));
+	ASSERT_EQ(0u, table.GetLinkCount());
+}
+
+TEST(BlockChainTable, ReleaseSourceForgetsSite)
+{
+	FakeCode code {};
+	BlockChainTable table;
+
+	uint8_t *site = code.block_a + 4;
+	table.Link(site, (block_txln_fn)code.block_b, Address(0x1000));
+	table.Release((block_txln_fn)code.block_a, sizeof(code.block_a));
+
+	ASSERT_EQ(0u, table.GetLinkCount());
+
+	// The source has gone, so releasing the target must not touch the site
+	code.block_a[4] = 0xaa;
+	table.Release((block_txln_fn)code.block_b, sizeof(code.block_b));
+	ASSERT_EQ(0xaa, code.block_a[4]);
+}
+
+TEST(BlockChainTable, UnlinkTargetKeepsOutgoing)
+{
+	FakeCode code {};
+	BlockChainTable table;
+
+	uint8_t *site_a = code.block_a + 4, *site_b = code.block_b + 4;
+	table.Link(site_a, (block_txln_fn)code.block_b, Address(0x1000));
+	table.Link(site_b, (block_txln_fn)code.block_a, Address(0x2000));
+
+	table.UnlinkTarget((block_txln_fn)code.block_b);
+
+	ASSERT_EQ(0, SiteValue(site_a));
+	ASSERT_NE(0, SiteValue(site_b));
+	ASSERT_EQ(1u, table.GetLinkCount());
+}
+
+TEST(BlockChainTable, UnlinkPage)
+{
+	FakeCode code {};
+	BlockChainTable table;
+
+	uint8_t *site_a = code.block_a + 4, *site_b = code.block_b + 4;
+	table.Link(site_a, (block_txln_fn)code.block_b, Address(0x1000));
+	table.Link(site_b, (block_txln_fn)code.block_a, Address(0x2000));
+
+	table.UnlinkPage(Address(0x1234));
+
+	ASSERT_EQ(0, SiteValue(site_a));
+	ASSERT_NE(0, SiteValue(site_b));
+	ASSERT_EQ(1u, table.GetLinkCount());
+
+	table.UnlinkAll();
+	ASSERT_EQ(0, SiteValue(site_b));
+	ASSERT_EQ(0u, table.GetLinkCount());
+}
+
+static BlockTranslation AllocateTranslation(wulib::MemAllocator &allocator, size_t size)
+{
+	BlockTranslation txln;
+	txln.SetFn((block_txln_fn)allocator.Allocate(size));
+	txln.SetSize(size);
+	return txln;
+}
+
+TEST(BlockProfile, CodeSizeFollowsInvalidation)
+{
+	wulib::SimpleZoneMemAllocator allocator;
+	BlockChainTable chains;
+	std::unique_ptr<BlockProfile> profile (new BlockProfile(allocator, &chains));
+
+	profile->Insert(Address(0x1000), AllocateTranslation(allocator, 256));
+	profile->Insert(Address(0x1100), AllocateTranslation(allocator, 256));
+	profile->Insert(Address(0x2000), AllocateTranslation(allocator, 256));
+	ASSERT_EQ(768u, profile->GetTotalCodeSize());
+
+	profile->InvalidatePage(Address(0x1000));
+	ASSERT_EQ(256u, profile->GetTotalCodeSize());
+
+	profile->MarkPageDirty(Address(0x2000));
+	profile->GarbageCollect();
+	ASSERT_EQ(0u, profile->GetTotalCodeSize());
+}
+
+TEST(BlockProfile, EvictPagesSkipsAccessedPages)
+{
+	wulib::SimpleZoneMemAllocator allocator;
+	BlockChainTable chains;
+	std::unique_ptr<BlockProfile> profile (new BlockProfile(allocator, &chains));
+	archsim::ProcessorFeatureSet features;
+
+	profile->Insert(Address(0x1000), AllocateTranslation(allocator, 256));
+	profile->Insert(Address(0x2000), AllocateTranslation(allocator, 256));
+	profile->Insert(Address(0x3000), AllocateTranslation(allocator, 256));
+
+	// Every page was accessed when it was inserted, so the first sweep
+	// clears the access bits and then evicts the oldest page
+	ASSERT_EQ(1u, profile->EvictPages(512));
+	ASSERT_EQ(512u, profile->GetTotalCodeSize());
+	ASSERT_EQ(nullptr, profile->Get(Address(0x1000), features).GetFn());
+
+	ASSERT_NE(nullptr, profile->Get(Address(0x3000), features).GetFn());
+	ASSERT_EQ(1u, profile->EvictPages(256));
+	ASSERT_EQ(nullptr, profile->Get(Address(0x2000), features).GetFn());
+	ASSERT_NE(nullptr, profile->Get(Address(0x3000), features).GetFn());
+}
+
+TEST(BlockProfile, EvictedPagesCountRetranslations)
+{
+	wulib::SimpleZoneMemAllocator allocator;
+	BlockChainTable chains;
+	std::unique_ptr<BlockProfile> profile (new BlockProfile(allocator, &chains));
+
+	ASSERT_FALSE(profile->Insert(Address(0x1000), AllocateTranslation(allocator, 256)));
+	ASSERT_EQ(1u, profile->EvictPages(0));
+	ASSERT_EQ(0u, allocator.GetFootprint());
+
+	ASSERT_TRUE(profile->Insert(Address(0x1000), AllocateTranslation(allocator, 256)));
+
+	// Code which was modified is not a retranslation
+	profile->InvalidatePage(Address(0x1000));
+	ASSERT_FALSE(profile->Insert(Address(0x1000), AllocateTranslation(allocator, 256)));
+}
+
+class ArchSimBlockJITChainTest : public ArchSimBlockJITTest
+{
+public:
+	static const uint32_t kPCOffset = 64;
+	static const uint32_t kTargetPC = 0x1040;
+
+	void SetUp() override
+	{
+		ArchSimBlockJITTest::SetUp();
+
+		StateBlockDescriptor.AddBlock("MessageWaiting", sizeof(uint32_t));
+		StateBlockDescriptor.AddBlock("BlockCache", sizeof(void*));
+		size_t size = StateBlockDescriptor.AddBlock("ChainExit", sizeof(void*));
+
+		message_offset_ = StateBlockDescriptor.GetBlockOffset("MessageWaiting");
+		cache_offset_ = StateBlockDescriptor.GetBlockOffset("BlockCache");
+		chain_exit_offset_ = StateBlockDescriptor.GetBlockOffset("ChainExit");
+
+		state_block_.resize(size, 0);
+		regfile_.resize(128, 0);
+		cache_.Invalidate();
+		*(archsim::blockjit::BlockCacheEntry**)(state_block_.data() + cache_offset_) = cache_.GetPtr();
+	}
+
+	// A block which marks the register file, so we can tell it was chained to
+	captive::shared::block_txln_fn CompileTargetBlock()
+	{
+		Builder().streg(IROperand::const32(0x1234), IROperand::const32(0));
+		Builder().ret();
+		auto fn = CompileAndLower();
+
+		ArchSimBlockJITTest::SetUp();
+		return fn;
+	}
+
+	captive::shared::block_txln_fn CompileDispatchBlock(uint64_t target, uint64_t fallthrough)
+	{
+		Builder().streg(IROperand::const32(kTargetPC), IROperand::const32(kPCOffset));
+		Builder().dispatch(IROperand::const64(target), IROperand::const64(fallthrough), IROperand::const64(0), IROperand::const64(0));
+		return CompileAndLower();
+	}
+
+	void Run(captive::shared::block_txln_fn fn)
+	{
+		*(uint32_t*)regfile_.data() = 0;
+		ChainExit() = nullptr;
+		fn(regfile_.data(), state_block_.data());
+	}
+
+	uint32_t Mark()
+	{
+		return *(uint32_t*)regfile_.data();
+	}
+	uint8_t *&ChainExit()
+	{
+		return *(uint8_t**)(state_block_.data() + chain_exit_offset_);
+	}
+	uint32_t &MessageWaiting()
+	{
+		return *(uint32_t*)(state_block_.data() + message_offset_);
+	}
+
+	archsim::blockjit::BlockCache cache_;
+	std::vector<char> regfile_;
+	std::vector<uint8_t> state_block_;
+
+	size_t message_offset_, cache_offset_, chain_exit_offset_;
+};
+
+TEST_F(ArchSimBlockJITChainTest, ChainSite)
+{
+	auto target = CompileTargetBlock();
+	auto fn = CompileDispatchBlock(kTargetPC, 0);
+	ASSERT_NE(nullptr, fn);
+
+	// Unlinked: the site should be reported back to the dispatcher
+	Run(fn);
+	ASSERT_EQ(0u, Mark());
+	uint8_t *site = ChainExit();
+	ASSERT_NE(nullptr, site);
+
+	BlockChainTable table;
+	ASSERT_TRUE(table.Link(site, target, Address(kTargetPC)));
+
+	Run(fn);
+	ASSERT_EQ(0x1234u, Mark());
+	ASSERT_EQ(nullptr, ChainExit());
+
+	table.UnlinkAll();
+
+	Run(fn);
+	ASSERT_EQ(0u, Mark());
+	ASSERT_EQ(site, ChainExit());
+}
+
+TEST_F(ArchSimBlockJITChainTest, ChainSitePendingMessage)
+{
+	auto target = CompileTargetBlock();
+	auto fn = CompileDispatchBlock(kTargetPC, 0);
+
+	Run(fn);
+	BlockChainTable table;
+	table.Link(ChainExit(), target, Address(kTargetPC));
+
+	MessageWaiting() = 1;
+	Run(fn);
+	ASSERT_EQ(0u, Mark());
+	ASSERT_EQ(nullptr, ChainExit());
+}
+
+TEST_F(ArchSimBlockJITChainTest, BlockCacheProbe)
+{
+	auto target = CompileTargetBlock();
+	auto fn = CompileDispatchBlock(0, 0);
+
+	Run(fn);
+	ASSERT_EQ(0u, Mark());
+	ASSERT_EQ(nullptr, ChainExit());
+
+	cache_.Insert(Address(kTargetPC), target, archsim::ProcessorFeatureSet());
+
+	Run(fn);
+	ASSERT_EQ(0x1234u, Mark());
+
+	cache_.Invalidate();
+
+	Run(fn);
+	ASSERT_EQ(0u, Mark());
+}
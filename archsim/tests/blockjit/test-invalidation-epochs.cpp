@@ -0,0 +1,53 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "blockjit/InvalidationEpochs.h"
+
+using archsim::Address;
+using archsim::blockjit::InvalidationEpochs;
+
+TEST(InvalidationEpochs, PageInvalidation)
+{
+	InvalidationEpochs epochs;
+
+	auto started = epochs.Current();
+	ASSERT_FALSE(epochs.IsStale(started, Address(0x1234)));
+
+	epochs.InvalidatePage(Address(0x1000));
+
+	// Only work on the invalidated page is stale
+	ASSERT_TRUE(epochs.IsStale(started, Address(0x1234)));
+	ASSERT_FALSE(epochs.IsStale(started, Address(0x2234)));
+
+	// Work started afterwards is fine
+	ASSERT_FALSE(epochs.IsStale(epochs.Current(), Address(0x1234)));
+}
+
+TEST(InvalidationEpochs, InvalidateAll)
+{
+	InvalidationEpochs epochs;
+
+	auto started = epochs.Current();
+	epochs.InvalidateAll();
+
+	ASSERT_TRUE(epochs.IsStale(started, Address(0x1234)));
+	ASSERT_TRUE(epochs.IsStale(started, Address(0x2234)));
+	ASSERT_FALSE(epochs.IsStale(epochs.Current(), Address(0x1234)));
+}
+
+TEST(InvalidationEpochs, Prune)
+{
+	InvalidationEpochs epochs;
+
+	epochs.InvalidatePage(Address(0x1000));
+	auto started = epochs.Current();
+	epochs.Prune();
+
+	// Work started after the last invalidation is still current
+	ASSERT_FALSE(epochs.IsStale(started, Address(0x1234)));
+
+	epochs.InvalidatePage(Address(0x1000));
+	ASSERT_TRUE(epochs.IsStale(started, Address(0x1234)));
+	ASSERT_FALSE(epochs.IsStale(started, Address(0x2234)));
+}
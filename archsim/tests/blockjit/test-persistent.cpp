@@ -0,0 +1,150 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "blockjit/PersistentTranslationCache.h"
+
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+
+using archsim::Address;
+using archsim::blockjit::BlockTranslation;
+using archsim::blockjit::PersistentTranslationCache;
+using captive::shared::block_txln_fn;
+
+static const char *kContext = "test/layout";
+
+extern "C" void persistent_test_helper()
+{
+
+}
+
+// Some fake code, with a host function address at offset 2 (as in
+// 'movabs $helper, %rax')
+struct FakeCode {
+	FakeCode()
+	{
+		memset(bytes, 0x90, sizeof(bytes));
+		bytes[0] = 0x48;
+		bytes[1] = 0xb8;
+		SetHostAddress((void*)persistent_test_helper);
+	}
+
+	void SetHostAddress(void *address)
+	{
+		uint64_t value = (uint64_t)address;
+		memcpy(bytes + 2, &value, sizeof(value));
+	}
+
+	uint8_t bytes[32];
+};
+
+static BlockTranslation MakeTranslation(FakeCode &code)
+{
+	BlockTranslation txln;
+	txln.SetFn((block_txln_fn)code.bytes);
+	txln.SetSize(sizeof(code.bytes));
+	txln.SetRelocations({2});
+	txln.AddRequiredFeature(1, 2);
+	return txln;
+}
+
+static std::string CacheFilename(const std::string &name)
+{
+	return testing::TempDir() + "archsim-" + name + ".cache";
+}
+
+TEST(PersistentTranslationCache, SaveLoadRelocates)
+{
+	FakeCode code;
+	std::string filename = CacheFilename("relocates");
+
+	{
+		PersistentTranslationCache cache;
+		ASSERT_TRUE(cache.Record(Address(0x1000), 0x1234, 0, MakeTranslation(code)));
+		ASSERT_TRUE(cache.IsDirty());
+		ASSERT_TRUE(cache.Save(filename, kContext));
+		ASSERT_FALSE(cache.IsDirty());
+	}
+
+	PersistentTranslationCache cache;
+	ASSERT_TRUE(cache.Load(filename, kContext));
+
+	archsim::ProcessorFeatureSet features;
+	features.AddFeature(1);
+	features.SetFeatureLevel(1, 2);
+
+	wulib::StandardMemAllocator allocator;
+	BlockTranslation txln;
+	ASSERT_TRUE(cache.Lookup(Address(0x1000), 0x1234, 0, features, allocator, txln));
+	ASSERT_EQ(sizeof(code.bytes), txln.GetSize());
+	ASSERT_EQ(0, memcmp(code.bytes, (void*)txln.GetFn(), sizeof(code.bytes)));
+	ASSERT_NE(nullptr, txln.GetRelocations());
+	ASSERT_TRUE(txln.FeaturesValid(features));
+	ASSERT_EQ(1u, cache.GetLoadedCount());
+
+	allocator.Free((void*)txln.GetFn());
+	unlink(filename.c_str());
+}
+
+TEST(PersistentTranslationCache, LookupChecksKey)
+{
+	FakeCode code;
+	std::string filename = CacheFilename("key");
+
+	{
+		PersistentTranslationCache cache;
+		cache.Record(Address(0x1000), 0x1234, 0, MakeTranslation(code));
+		ASSERT_TRUE(cache.Save(filename, kContext));
+	}
+
+	PersistentTranslationCache cache;
+	ASSERT_TRUE(cache.Load(filename, kContext));
+
+	archsim::ProcessorFeatureSet features;
+	features.AddFeature(1);
+	features.SetFeatureLevel(1, 2);
+
+	wulib::StandardMemAllocator allocator;
+	BlockTranslation txln;
+
+	// Different page contents, ISA mode and block
+	ASSERT_FALSE(cache.Lookup(Address(0x1000), 0x4321, 0, features, allocator, txln));
+	ASSERT_FALSE(cache.Lookup(Address(0x1000), 0x1234, 1, features, allocator, txln));
+	ASSERT_FALSE(cache.Lookup(Address(0x1004), 0x1234, 0, features, allocator, txln));
+
+	// Different features
+	features.SetFeatureLevel(1, 3);
+	ASSERT_FALSE(cache.Lookup(Address(0x1000), 0x1234, 0, features, allocator, txln));
+
+	unlink(filename.c_str());
+}
+
+TEST(PersistentTranslationCache, LoadChecksContext)
+{
+	FakeCode code;
+	std::string filename = CacheFilename("context");
+
+	{
+		PersistentTranslationCache cache;
+		cache.Record(Address(0x1000), 0x1234, 0, MakeTranslation(code));
+		ASSERT_TRUE(cache.Save(filename, kContext));
+	}
+
+	PersistentTranslationCache cache;
+	ASSERT_FALSE(cache.Load(filename, "other/layout"));
+
+	unlink(filename.c_str());
+}
+
+TEST(PersistentTranslationCache, HeapAddressNotRecorded)
+{
+	FakeCode code;
+	std::unique_ptr<uint64_t> counter (new uint64_t(0));
+	code.SetHostAddress(counter.get());
+
+	PersistentTranslationCache cache;
+	ASSERT_FALSE(cache.Record(Address(0x1000), 0x1234, 0, MakeTranslation(code)));
+	ASSERT_FALSE(cache.IsDirty());
+}
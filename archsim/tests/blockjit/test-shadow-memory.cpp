@@ -0,0 +1,304 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "ArchSimBlockJITTest.h"
+#include "TestThreadModel.h"
+#include "core/MemoryInterface.h"
+#include "util/PubSubSync.h"
+#include "util/SimOptions.h"
+
+#include <map>
+
+using namespace captive::shared;
+using namespace captive::arch::jit;
+
+// Guest memory for the out-of-line path. Each byte reads as the low byte of
+// its address until it is written.
+class ShadowTestMemory : public archsim::MemoryDevice
+{
+public:
+	ShadowTestMemory() : Accesses(0) {}
+
+	archsim::MemoryResult Read8(archsim::Address address, uint8_t &data) override
+	{
+		return Read(address, data);
+	}
+	archsim::MemoryResult Read16(archsim::Address address, uint16_t &data) override
+	{
+		return Read(address, data);
+	}
+	archsim::MemoryResult Read32(archsim::Address address, uint32_t &data) override
+	{
+		return Read(address, data);
+	}
+	archsim::MemoryResult Read64(archsim::Address address, uint64_t &data) override
+	{
+		return Read(address, data);
+	}
+	archsim::MemoryResult Read128(archsim::Address address, uint128_t &data) override
+	{
+		return archsim::MemoryResult::Error;
+	}
+
+	archsim::MemoryResult Write8(archsim::Address address, uint8_t data) override
+	{
+		return Write(address, data);
+	}
+	archsim::MemoryResult Write16(archsim::Address address, uint16_t data) override
+	{
+		return Write(address, data);
+	}
+	archsim::MemoryResult Write32(archsim::Address address, uint32_t data) override
+	{
+		return Write(address, data);
+	}
+	archsim::MemoryResult Write64(archsim::Address address, uint64_t data) override
+	{
+		return Write(address, data);
+	}
+	archsim::MemoryResult Write128(archsim::Address address, uint128_t data) override
+	{
+		return archsim::MemoryResult::Error;
+	}
+
+	void Lock() override {}
+	void Unlock() override {}
+
+	uint8_t GetByte(uint64_t address)
+	{
+		auto byte = Bytes.find(address);
+		return byte == Bytes.end() ? (uint8_t)address : byte->second;
+	}
+
+	std::map<uint64_t, uint8_t> Bytes;
+	unsigned Accesses;
+
+private:
+	template<typename T> archsim::MemoryResult Read(archsim::Address address, T &data)
+	{
+		Accesses++;
+		data = 0;
+		for(unsigned i = 0; i < sizeof(T); ++i) {
+			data |= (T)GetByte(address.Get() + i) << (i * 8);
+		}
+		return archsim::MemoryResult::OK;
+	}
+	template<typename T> archsim::MemoryResult Write(archsim::Address address, T data)
+	{
+		Accesses++;
+		for(unsigned i = 0; i < sizeof(T); ++i) {
+			Bytes[address.Get() + i] = data >> (i * 8);
+		}
+		return archsim::MemoryResult::OK;
+	}
+};
+
+// Memory accesses through a shadow page table take the inline path for
+// filled pages, and the out-of-line path through the thread's memory
+// interface for unfilled pages and accesses which cross a page boundary.
+class ArchSimBlockJITShadowMemoryTest : public ArchSimBlockJITTest
+{
+public:
+	ArchSimBlockJITShadowMemoryTest() : ThreadArch(GetTestThreadArch()), Thread(PubSub, ThreadArch, GetTestThreadEmulationModel()) {}
+
+	void SetUp() override
+	{
+		ArchSimBlockJITTest::SetUp();
+
+		Thread.GetMemoryInterface(0).Connect(Memory);
+
+		previous_model_ = archsim::options::SystemMemoryModel.GetValue();
+		archsim::options::SystemMemoryModel.SetValue("shadow");
+
+		memset(page_a_, 0, sizeof(page_a_));
+		memset(page_b_, 0, sizeof(page_b_));
+
+		table_.assign(16, nullptr);
+		table_[1] = page_a_;
+		table_[5] = page_b_;
+
+		// The out-of-line path needs the thread pointer, which reads expect
+		// to find at the start of the state block
+		StateBlockDescriptor.AddBlock("thread_ptr", sizeof(void*));
+		StateBlockDescriptor.AddBlock("shadow_page_table_0", sizeof(void*));
+		ASSERT_EQ(0, StateBlockDescriptor.GetBlockOffset("thread_ptr"));
+		auto offset = StateBlockDescriptor.GetBlockOffset("shadow_page_table_0");
+		state_.assign(offset + sizeof(void*), 0);
+		*(archsim::core::thread::ThreadInstance**)state_.data() = &Thread;
+		*(void***)(state_.data() + offset) = table_.data();
+	}
+
+	void TearDown() override
+	{
+		archsim::options::SystemMemoryModel.SetValue(previous_model_);
+	}
+
+	void Run()
+	{
+		transforms::AllocationWriterTransform awt(allocations_);
+		awt.Apply(tc_);
+
+		CompileResult cr (true, stack_frame_, wutils::vbitset<>(8, 0xff));
+
+		auto fn = Lower(cr);
+		ASSERT_NE(nullptr, fn);
+
+		regfile_.assign(128, 0);
+		fn(regfile_.data(), state_.data());
+	}
+
+	archsim::ArchDescriptor ThreadArch;
+	archsim::util::PubSubContext PubSub;
+	archsim::core::thread::ThreadInstance Thread;
+	ShadowTestMemory Memory;
+
+	uint8_t page_a_[4096];
+	uint8_t page_b_[4096];
+	std::vector<void*> table_;
+	std::vector<char> state_;
+	std::vector<char> regfile_;
+
+private:
+	std::string previous_model_;
+};
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, Read32)
+{
+	*(uint32_t*)(page_a_ + 0x10) = 0x12345678;
+
+	IRRegId address = RegValue(0x100c, 4, 0);
+	IRRegId value = AllocateReg(4);
+
+	Builder().ldmem(IROperand::const32(0), IROperand::vreg(address, 4), IROperand::const32(4), IROperand::vreg(value, 4));
+	Builder().streg(IROperand::vreg(value, 4), IROperand::const32(0));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(0x12345678, *(uint32_t*)regfile_.data());
+}
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, Read8FromStackAddress)
+{
+	page_b_[0xfff] = 0xa5;
+
+	IRRegId address = StackValue(0x5fff, 4);
+	IRRegId value = AllocateReg(1);
+
+	Builder().ldmem(IROperand::const32(0), IROperand::vreg(address, 4), IROperand::const32(0), IROperand::vreg(value, 1));
+	Builder().streg(IROperand::vreg(value, 1), IROperand::const32(0));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(0xa5, (uint8_t)regfile_[0]);
+}
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, Read64IntoStack)
+{
+	*(uint64_t*)(page_b_ + 0xff8) = 0x0123456789abcdefull;
+
+	IRRegId address = RegValue(0x5ff8, 4, 0);
+	IRRegId value = AllocateStack(8);
+
+	Builder().ldmem(IROperand::const32(0), IROperand::vreg(address, 4), IROperand::const32(0), IROperand::vreg(value, 8));
+	Builder().streg(IROperand::vreg(value, 8), IROperand::const32(0));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(0x0123456789abcdefull, *(uint64_t*)regfile_.data());
+	ASSERT_EQ(0, Memory.Accesses);
+}
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, WriteRegister)
+{
+	IRRegId address = RegValue(0x1000, 4, 0);
+	IRRegId value = RegValue(0xdeadbeef, 4, 1);
+
+	Builder().stmem(IROperand::const32(0), IROperand::vreg(value, 4), IROperand::const32(0x20), IROperand::vreg(address, 4));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(0xdeadbeef, *(uint32_t*)(page_a_ + 0x20));
+	ASSERT_EQ(0, *(uint32_t*)(page_b_ + 0x20));
+}
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, WriteStackAndConstant)
+{
+	IRRegId address = RegValue(0x5000, 4, 0);
+	IRRegId value = StackValue(0xbeef, 2);
+
+	Builder().stmem(IROperand::const32(0), IROperand::vreg(value, 2), IROperand::const32(0x100), IROperand::vreg(address, 4));
+	Builder().stmem(IROperand::const32(0), IROperand::const8(0x5a), IROperand::const32(0x102), IROperand::vreg(address, 4));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(0xbeef, *(uint16_t*)(page_b_ + 0x100));
+	ASSERT_EQ(0x5a, page_b_[0x102]);
+}
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, ReadUnfilledPage)
+{
+	IRRegId address = RegValue(0x3010, 4, 0);
+	IRRegId value = AllocateReg(4);
+
+	Builder().ldmem(IROperand::const32(0), IROperand::vreg(address, 4), IROperand::const32(0), IROperand::vreg(value, 4));
+	Builder().streg(IROperand::vreg(value, 4), IROperand::const32(0));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(0x13121110, *(uint32_t*)regfile_.data());
+	ASSERT_EQ(1, Memory.Accesses);
+}
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, ReadCrossingPage)
+{
+	// Even though the page is filled, the access runs off the end of it
+	IRRegId address = RegValue(0x1ffe, 4, 0);
+	IRRegId value = AllocateStack(4);
+
+	Builder().ldmem(IROperand::const32(0), IROperand::vreg(address, 4), IROperand::const32(0), IROperand::vreg(value, 4));
+	Builder().streg(IROperand::vreg(value, 4), IROperand::const32(0));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(0x0100fffe, *(uint32_t*)regfile_.data());
+	ASSERT_EQ(1, Memory.Accesses);
+}
+
+TEST_F(ArchSimBlockJITShadowMemoryTest, WriteUnfilledPage)
+{
+	IRRegId address = RegValue(0x3000, 4, 0);
+	IRRegId value = RegValue(0xcafef00d, 4, 1);
+
+	Builder().stmem(IROperand::const32(0), IROperand::vreg(value, 4), IROperand::const32(0x20), IROperand::vreg(address, 4));
+	Builder().ret();
+
+	Run();
+
+	ASSERT_EQ(1, Memory.Accesses);
+	ASSERT_EQ(0x0d, Memory.GetByte(0x3020));
+	ASSERT_EQ(0xf0, Memory.GetByte(0x3021));
+	ASSERT_EQ(0xfe, Memory.GetByte(0x3022));
+	ASSERT_EQ(0xca, Memory.GetByte(0x3023));
+}
+
+TEST(ShadowMemoryFault, JITCodeIsRecognised)
+{
+	// Faults are only treated as guest memory faults if they come from code
+	// allocated by a zone allocator, as JIT code is
+	wulib::SimpleZoneMemAllocator allocator;
+	auto code = (uint8_t*)allocator.Allocate(64);
+
+	ASSERT_TRUE(wulib::SimpleZoneMemAllocator::IsZoneMemory(code));
+	ASSERT_TRUE(wulib::SimpleZoneMemAllocator::IsZoneMemory(code + 63));
+	ASSERT_FALSE(wulib::SimpleZoneMemAllocator::IsZoneMemory((void*)&wulib::SimpleZoneMemAllocator::IsZoneMemory));
+
+	// Freeing the only allocation releases the chunk
+	allocator.Free(code);
+	ASSERT_FALSE(wulib::SimpleZoneMemAllocator::IsZoneMemory(code));
+}
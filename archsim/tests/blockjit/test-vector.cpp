@@ -0,0 +1,429 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "ArchSimBlockJITTest.h"
+
+#include "blockjit/block-compiler/lowering/x86/X86Encoder.h"
+#include "util/SimOptions.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+
+using namespace captive::shared;
+using namespace captive::arch::jit;
+using captive::arch::jit::lowering::x86::X86Encoder;
+
+// Each test is run with both the SSE and the AVX encodings
+class ArchSimBlockJITVectorTest : public ArchSimBlockJITTest, public ::testing::WithParamInterface<bool>
+{
+public:
+	typedef void (IRBuilder::*binary_op_t)(const IROperand &, const IROperand &, const IROperand &, const IROperand &);
+	typedef void (IRBuilder::*unary_op_t)(const IROperand &, const IROperand &, const IROperand &);
+
+	void SetUp() override
+	{
+		ArchSimBlockJITTest::SetUp();
+
+		old_disable_avx_ = archsim::options::JitDisableAVX.GetValue();
+		archsim::options::JitDisableAVX.SetValue(!GetParam());
+
+		if(!HostSupported()) {
+			GTEST_SKIP() << "Host does not support the " << (GetParam() ? "AVX2" : "SSE4.2") << " encodings";
+		}
+	}
+
+	void TearDown() override
+	{
+		archsim::options::JitDisableAVX.SetValue(old_disable_avx_);
+	}
+
+	// Start a new block, for tests which compile several
+	void Reset()
+	{
+		ArchSimBlockJITTest::SetUp();
+	}
+
+	bool HostSupported()
+	{
+		if(!X86Encoder::HostSupportsSSE42()) {
+			return false;
+		}
+		return !GetParam() || X86Encoder::HostSupportsAVX2();
+	}
+
+	// Vectors of up to 8 bytes are kept in GPRs, and wider ones on the stack
+	IRRegId AllocateVector(uint8_t size)
+	{
+		return size > 8 ? AllocateStack(size) : AllocateReg(size);
+	}
+
+	// lhs and rhs are read from guest registers at offsets 0 and 16, and the
+	// result is written to offset 32
+	template<typename T, size_t N, typename R = T> std::array<R, N> RunBinary(binary_op_t op, const std::array<T, N> &lhs, const std::array<T, N> &rhs)
+	{
+		const uint8_t size = sizeof(T) * N;
+		const uint8_t dest_size = sizeof(R) * N;
+
+		IRRegId a = AllocateVector(size);
+		IRRegId b = AllocateVector(size);
+		IRRegId result = AllocateVector(dest_size);
+
+		Builder().ldreg(IROperand::const32(0), IROperand::vreg(a, size));
+		Builder().ldreg(IROperand::const32(16), IROperand::vreg(b, size));
+		(Builder().*op)(IROperand::const8(N), IROperand::vreg(a, size), IROperand::vreg(b, size), IROperand::vreg(result, dest_size));
+		Builder().streg(IROperand::vreg(result, dest_size), IROperand::const32(32));
+		Builder().ret();
+
+		std::vector<char> regfile (128, 0);
+		memcpy(regfile.data(), lhs.data(), size);
+		memcpy(regfile.data() + 16, rhs.data(), size);
+		Run(regfile);
+
+		std::array<R, N> output;
+		memcpy(output.data(), regfile.data() + 32, dest_size);
+		return output;
+	}
+
+	template<typename T, typename R, size_t N> std::array<R, N> RunUnary(unary_op_t op, const std::array<T, N> &src)
+	{
+		const uint8_t size = sizeof(T) * N;
+		const uint8_t dest_size = sizeof(R) * N;
+
+		IRRegId a = AllocateVector(size);
+		IRRegId result = AllocateVector(dest_size);
+
+		Builder().ldreg(IROperand::const32(0), IROperand::vreg(a, size));
+		(Builder().*op)(IROperand::const8(N), IROperand::vreg(a, size), IROperand::vreg(result, dest_size));
+		Builder().streg(IROperand::vreg(result, dest_size), IROperand::const32(32));
+		Builder().ret();
+
+		std::vector<char> regfile (128, 0);
+		memcpy(regfile.data(), src.data(), size);
+		Run(regfile);
+
+		std::array<R, N> output;
+		memcpy(output.data(), regfile.data() + 32, dest_size);
+		return output;
+	}
+
+	void Run(std::vector<char> &regfile)
+	{
+		transforms::AllocationWriterTransform awt(allocations_);
+		awt.Apply(tc_);
+
+		CompileResult cr (true, stack_frame_, wutils::vbitset<>(8, 0xff));
+		auto fn = Lower(cr);
+		ASSERT_NE(nullptr, fn);
+
+		fn(regfile.data(), nullptr);
+	}
+
+private:
+	bool old_disable_avx_;
+};
+
+INSTANTIATE_TEST_CASE_P(Encodings, ArchSimBlockJITVectorTest, ::testing::Values(false, true));
+
+TEST_P(ArchSimBlockJITVectorTest, AddI8x16)
+{
+	std::array<uint8_t, 16> a, b, expected;
+	for(int i = 0; i < 16; ++i) {
+		a[i] = i * 17;
+		b[i] = 200 + i;
+		expected[i] = a[i] + b[i];
+	}
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vaddi, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, AddI32x2)
+{
+	std::array<uint32_t, 2> a {{ 0xffffffff, 10 }}, b {{ 2, 20 }};
+	std::array<uint32_t, 2> expected {{ 1, 30 }};
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vaddi, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, SubI64x2)
+{
+	std::array<uint64_t, 2> a {{ 0, 0x100000000ull }}, b {{ 1, 1 }};
+	std::array<uint64_t, 2> expected {{ 0xffffffffffffffffull, 0xffffffffull }};
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vsubi, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MulI8x16)
+{
+	std::array<uint8_t, 16> a, b, expected;
+	for(int i = 0; i < 16; ++i) {
+		a[i] = 3 + i * 13;
+		b[i] = 250 - i * 7;
+		expected[i] = (uint8_t)(a[i] * b[i]);
+	}
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vmuli, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MulI16x8)
+{
+	std::array<uint16_t, 8> a, b, expected;
+	for(int i = 0; i < 8; ++i) {
+		a[i] = 1000 + i * 4567;
+		b[i] = 3 + i * 999;
+		expected[i] = (uint16_t)(a[i] * b[i]);
+	}
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vmuli, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MulI32x4)
+{
+	std::array<uint32_t, 4> a {{ 1, 0x10000, 0xffffffff, 12345 }}, b {{ 7, 0x10000, 2, 54321 }};
+	std::array<uint32_t, 4> expected {{ 7, 0, 0xfffffffe, 12345u * 54321u }};
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vmuli, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MulI64x2)
+{
+	std::array<uint64_t, 2> a {{ 0x123456789abcdefull, 0xffffffffffffffffull }}, b {{ 0xfedcba987654321ull, 3 }};
+	std::array<uint64_t, 2> expected {{ a[0] * b[0], a[1] * b[1] }};
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vmuli, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, AddF32x4)
+{
+	std::array<float, 4> a {{ 1.5f, -2.0f, 1e10f, 0.0f }}, b {{ 2.25f, 2.0f, 1.0f, -0.0f }};
+	std::array<float, 4> expected {{ 3.75f, 0.0f, 1e10f, 0.0f }};
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vaddf, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, SubMulF64x2)
+{
+	std::array<double, 2> a {{ 10.0, -3.5 }}, b {{ 0.25, 2.0 }};
+
+	std::array<double, 2> sub_expected {{ 9.75, -5.5 }};
+	ASSERT_EQ(sub_expected, RunBinary(&IRBuilder::vsubf, a, b));
+
+	Reset();
+	std::array<double, 2> mul_expected {{ 2.5, -7.0 }};
+	ASSERT_EQ(mul_expected, RunBinary(&IRBuilder::vmulf, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, CompareI16x8)
+{
+	std::array<int16_t, 8> a {{ 0, 1, -1, 5, -32768, 32767, 7, 7 }}, b {{ 0, 0, 0, 6, 32767, -32768, 7, 8 }};
+
+	std::array<int16_t, 8> eq, gt, gte;
+	for(int i = 0; i < 8; ++i) {
+		eq[i] = a[i] == b[i] ? -1 : 0;
+		gt[i] = a[i] > b[i] ? -1 : 0;
+		gte[i] = a[i] >= b[i] ? -1 : 0;
+	}
+
+	ASSERT_EQ(eq, RunBinary(&IRBuilder::vcmpeqi, a, b));
+	Reset();
+	ASSERT_EQ(gt, RunBinary(&IRBuilder::vcmpgti, a, b));
+	Reset();
+	ASSERT_EQ(gte, RunBinary(&IRBuilder::vcmpgtei, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, CompareI64x2)
+{
+	std::array<int64_t, 2> a {{ -1, 5 }}, b {{ 1, 5 }};
+
+	std::array<int64_t, 2> gt {{ 0, 0 }}, gte {{ 0, -1 }};
+	ASSERT_EQ(gt, RunBinary(&IRBuilder::vcmpgti, a, b));
+	Reset();
+	ASSERT_EQ(gte, RunBinary(&IRBuilder::vcmpgtei, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, CompareF32x4)
+{
+	std::array<float, 4> a {{ 1.0f, 2.0f, 3.0f, NAN }}, b {{ 2.0f, 2.0f, 1.0f, 1.0f }};
+
+	std::array<uint32_t, 4> lt {{ 0xffffffff, 0, 0, 0 }};
+	std::array<uint32_t, 4> lte {{ 0xffffffff, 0xffffffff, 0, 0 }};
+	std::array<uint32_t, 4> eq {{ 0, 0xffffffff, 0, 0 }};
+
+	ASSERT_EQ(lt, (RunBinary<float, 4, uint32_t>(&IRBuilder::vcmp_ltf, a, b)));
+	Reset();
+	ASSERT_EQ(lte, (RunBinary<float, 4, uint32_t>(&IRBuilder::vcmp_ltef, a, b)));
+	Reset();
+	ASSERT_EQ(eq, (RunBinary<float, 4, uint32_t>(&IRBuilder::vcmp_eqf, a, b)));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MinMaxI8x16)
+{
+	std::array<int8_t, 16> a, b, min, max;
+	for(int i = 0; i < 16; ++i) {
+		a[i] = i * 37 - 100;
+		b[i] = 60 - i * 11;
+		min[i] = std::min(a[i], b[i]);
+		max[i] = std::max(a[i], b[i]);
+	}
+
+	ASSERT_EQ(min, RunBinary(&IRBuilder::vmini, a, b));
+	Reset();
+	ASSERT_EQ(max, RunBinary(&IRBuilder::vmaxi, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MinMaxU32x4)
+{
+	std::array<uint32_t, 4> a {{ 0, 0xffffffff, 0x80000000, 5 }}, b {{ 1, 0, 0x7fffffff, 5 }};
+	std::array<uint32_t, 4> min {{ 0, 0, 0x7fffffff, 5 }}, max {{ 1, 0xffffffff, 0x80000000, 5 }};
+
+	ASSERT_EQ(min, RunBinary(&IRBuilder::vminui, a, b));
+	Reset();
+	ASSERT_EQ(max, RunBinary(&IRBuilder::vmaxui, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MinMaxI64x2)
+{
+	std::array<uint64_t, 2> a {{ 0xffffffffffffffffull, 3 }}, b {{ 1, 0x8000000000000000ull }};
+
+	std::array<uint64_t, 2> smin {{ a[0], b[1] }}, smax {{ b[0], a[1] }};
+	std::array<uint64_t, 2> umin {{ b[0], a[1] }}, umax {{ a[0], b[1] }};
+
+	ASSERT_EQ(smin, RunBinary(&IRBuilder::vmini, a, b));
+	Reset();
+	ASSERT_EQ(smax, RunBinary(&IRBuilder::vmaxi, a, b));
+	Reset();
+	ASSERT_EQ(umin, RunBinary(&IRBuilder::vminui, a, b));
+	Reset();
+	ASSERT_EQ(umax, RunBinary(&IRBuilder::vmaxui, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, MinMaxF64x2)
+{
+	std::array<double, 2> a {{ 1.0, -4.0 }}, b {{ 2.0, -8.0 }};
+	std::array<double, 2> min {{ 1.0, -8.0 }}, max {{ 2.0, -4.0 }};
+
+	ASSERT_EQ(min, RunBinary(&IRBuilder::vminf, a, b));
+	Reset();
+	ASSERT_EQ(max, RunBinary(&IRBuilder::vmaxf, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, Bitwise)
+{
+	std::array<uint32_t, 4> a {{ 0xff00ff00, 0x12345678, 0, 0xffffffff }}, b {{ 0x0ff00ff0, 0xffff0000, 0xffffffff, 0xffffffff }};
+
+	std::array<uint32_t, 4> and_expected, or_expected, xor_expected;
+	for(int i = 0; i < 4; ++i) {
+		and_expected[i] = a[i] & b[i];
+		or_expected[i] = a[i] | b[i];
+		xor_expected[i] = a[i] ^ b[i];
+	}
+
+	ASSERT_EQ(and_expected, RunBinary(&IRBuilder::vandi, a, b));
+	Reset();
+	ASSERT_EQ(or_expected, RunBinary(&IRBuilder::vori, a, b));
+	Reset();
+	ASSERT_EQ(xor_expected, RunBinary(&IRBuilder::vxori, a, b));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, Shuffle8x16)
+{
+	std::array<uint8_t, 16> a, indices, expected;
+	for(int i = 0; i < 16; ++i) {
+		a[i] = 0x80 + i;
+		indices[i] = 15 - i;
+	}
+	// Out of range indices give zero
+	indices[3] = 16;
+	indices[4] = 0x80;
+	indices[5] = 0xff;
+
+	for(int i = 0; i < 16; ++i) {
+		expected[i] = indices[i] < 16 ? a[indices[i]] : 0;
+	}
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vshuffle, a, indices));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, Shuffle8x8)
+{
+	std::array<uint8_t, 8> a {{ 10, 11, 12, 13, 14, 15, 16, 17 }}, indices {{ 7, 0, 8, 3, 3, 12, 1, 2 }};
+	std::array<uint8_t, 8> expected {{ 17, 10, 0, 13, 13, 0, 11, 12 }};
+
+	ASSERT_EQ(expected, RunBinary(&IRBuilder::vshuffle, a, indices));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, Extend)
+{
+	std::array<int8_t, 8> bytes {{ -1, 2, -128, 127, 0, 5, -6, 7 }};
+
+	std::array<int16_t, 8> sx;
+	std::array<uint16_t, 8> zx;
+	for(int i = 0; i < 8; ++i) {
+		sx[i] = bytes[i];
+		zx[i] = (uint8_t)bytes[i];
+	}
+
+	ASSERT_EQ(sx, (RunUnary<int8_t, int16_t>(&IRBuilder::vsx, bytes)));
+	Reset();
+	ASSERT_EQ(zx, (RunUnary<int8_t, uint16_t>(&IRBuilder::vzx, bytes)));
+
+	Reset();
+	std::array<int32_t, 2> words {{ -3, 0x7fffffff }};
+	std::array<int64_t, 2> words_sx {{ -3, 0x7fffffff }};
+	ASSERT_EQ(words_sx, (RunUnary<int32_t, int64_t>(&IRBuilder::vsx, words)));
+}
+
+TEST_P(ArchSimBlockJITVectorTest, Truncate)
+{
+	std::array<uint16_t, 8> halves {{ 0x1234, 0xff80, 0x00ff, 0x8001, 1, 2, 3, 0xfffe }};
+	std::array<uint8_t, 8> halves_trunc;
+	for(int i = 0; i < 8; ++i) {
+		halves_trunc[i] = (uint8_t)halves[i];
+	}
+	ASSERT_EQ(halves_trunc, (RunUnary<uint16_t, uint8_t>(&IRBuilder::vtrunc, halves)));
+
+	Reset();
+	std::array<uint64_t, 2> quads {{ 0x123456789abcdef0ull, 0xffffffff00000001ull }};
+	std::array<uint32_t, 2> quads_trunc {{ 0x9abcdef0, 1 }};
+	ASSERT_EQ(quads_trunc, (RunUnary<uint64_t, uint32_t>(&IRBuilder::vtrunc, quads)));
+
+	Reset();
+	std::array<uint32_t, 4> words {{ 0x12345678, 0xdeadbeef, 0x80, 0xffff }};
+	std::array<uint8_t, 4> words_trunc {{ 0x78, 0xef, 0x80, 0xff }};
+	ASSERT_EQ(words_trunc, (RunUnary<uint32_t, uint8_t>(&IRBuilder::vtrunc, words)));
+}
+
+// The whole pipeline, so that 128 bit vregs go through the register allocator
+TEST_P(ArchSimBlockJITVectorTest, CompileAddI32x4)
+{
+	IROperand a = IROperand::vreg(tc_.alloc_reg(16), 16);
+	IROperand b = IROperand::vreg(tc_.alloc_reg(16), 16);
+	IROperand sum = IROperand::vreg(tc_.alloc_reg(16), 16);
+	IROperand scalar = IROperand::vreg(tc_.alloc_reg(4), 4);
+
+	Builder().ldreg(IROperand::const32(0), a);
+	Builder().ldreg(IROperand::const32(16), b);
+	Builder().ldreg(IROperand::const32(48), scalar);
+	Builder().vaddi(IROperand::const8(4), a, b, sum);
+	Builder().add(IROperand::const32(1), scalar);
+	Builder().streg(sum, IROperand::const32(32));
+	Builder().streg(scalar, IROperand::const32(52));
+	Builder().ret();
+
+	auto fn = CompileAndLower();
+	ASSERT_NE(nullptr, fn);
+
+	std::vector<char> regfile (128, 0);
+	uint32_t *words = (uint32_t *)regfile.data();
+	for(int i = 0; i < 4; ++i) {
+		words[i] = 100 * i;
+		words[4 + i] = i + 1;
+	}
+	words[12] = 41;
+
+	fn(regfile.data(), nullptr);
+
+	for(int i = 0; i < 4; ++i) {
+		ASSERT_EQ(101 * i + 1, words[8 + i]);
+	}
+	ASSERT_EQ(42, words[13]);
+}
@@ -0,0 +1,148 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "abi/devices/generic/block/BlockIOBackend.h"
+#include "abi/devices/generic/block/FileBackedBlockDevice.h"
+
+#include <memory>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace archsim::abi::devices::generic::block;
+
+class BlockIOTest : public ::testing::Test
+{
+public:
+	static const uint64_t kBlockSize = 512;
+
+	void SetUp() override
+	{
+		char name[] = "/tmp/archsim-block-io-XXXXXX";
+		fd_ = mkstemp(name);
+		ASSERT_LE(0, fd_);
+		filename_ = name;
+
+		// Each byte of the file holds the index of its block
+		std::vector<uint8_t> data (kBlockSize * 64);
+		for(size_t i = 0; i < data.size(); ++i) {
+			data[i] = i / kBlockSize;
+		}
+		ASSERT_EQ((ssize_t)data.size(), write(fd_, data.data(), data.size()));
+	}
+
+	void TearDown() override
+	{
+		close(fd_);
+		unlink(filename_.c_str());
+	}
+
+	void CheckBackend(BlockIOBackend &backend)
+	{
+		uint8_t write_a[kBlockSize], write_b[kBlockSize * 2];
+		memset(write_a, 0xaa, sizeof(write_a));
+		memset(write_b, 0xbb, sizeof(write_b));
+
+		uint8_t read_a[kBlockSize * 2], read_b[kBlockSize];
+
+		std::vector<BlockRequest> requests;
+		requests.emplace_back(true, 4);
+		requests.back().AddBuffer(write_a, sizeof(write_a));
+		requests.back().AddBuffer(write_b, sizeof(write_b));
+		requests.emplace_back(false, 10);
+		requests.back().AddBuffer(read_a, sizeof(read_a));
+		requests.emplace_back(false, 63);
+		requests.back().AddBuffer(read_b, sizeof(read_b));
+
+		backend.Submit(fd_, kBlockSize, requests.data(), requests.size());
+
+		for(const auto &request : requests) {
+			ASSERT_TRUE(request.success);
+		}
+		ASSERT_EQ(10, read_a[0]);
+		ASSERT_EQ(11, read_a[kBlockSize]);
+		ASSERT_EQ(63, read_b[kBlockSize - 1]);
+
+		// Read back what was written, scattered over three buffers
+		uint8_t check[kBlockSize * 5];
+		requests.clear();
+		requests.emplace_back(false, 3);
+		requests.back().AddBuffer(check, kBlockSize);
+		requests.back().AddBuffer(check + kBlockSize, kBlockSize * 2);
+		requests.back().AddBuffer(check + kBlockSize * 3, kBlockSize * 2);
+
+		backend.Submit(fd_, kBlockSize, requests.data(), requests.size());
+
+		ASSERT_TRUE(requests[0].success);
+		ASSERT_EQ(3, check[0]);
+		ASSERT_EQ(0xaa, check[kBlockSize]);
+		ASSERT_EQ(0xbb, check[kBlockSize * 2]);
+		ASSERT_EQ(0xbb, check[kBlockSize * 4 - 1]);
+		ASSERT_EQ(7, check[kBlockSize * 4]);
+	}
+
+	int fd_;
+	std::string filename_;
+};
+
+TEST_F(BlockIOTest, ThreadPoolBackend)
+{
+	ThreadPoolBlockIOBackend backend (2);
+	CheckBackend(backend);
+}
+
+TEST_F(BlockIOTest, DefaultBackend)
+{
+	std::unique_ptr<BlockIOBackend> backend (BlockIOBackend::Create());
+	CheckBackend(*backend);
+}
+
+TEST_F(BlockIOTest, ReadPastEndOfFileIsZero)
+{
+	ASSERT_EQ(0, ftruncate(fd_, kBlockSize + 100));
+
+	std::unique_ptr<BlockIOBackend> backend (BlockIOBackend::Create());
+
+	uint8_t data[kBlockSize];
+	memset(data, 0xff, sizeof(data));
+
+	BlockRequest request (false, 1);
+	request.AddBuffer(data, sizeof(data));
+	backend->Submit(fd_, kBlockSize, &request, 1);
+
+	ASSERT_TRUE(request.success);
+	ASSERT_EQ(1, data[99]);
+	ASSERT_EQ(0, data[100]);
+	ASSERT_EQ(0, data[kBlockSize - 1]);
+}
+
+TEST_F(BlockIOTest, FileBackedDeviceBatches)
+{
+	FileBackedBlockDevice bdev;
+	ASSERT_TRUE(bdev.Open(filename_));
+
+	// Pull a block into the read cache, so that the write below has to keep
+	// it up to date
+	uint8_t block[kBlockSize];
+	ASSERT_TRUE(bdev.ReadBlocks(20, 1, block));
+	ASSERT_EQ(20, block[0]);
+
+	uint8_t data[kBlockSize];
+	memset(data, 0x5a, sizeof(data));
+
+	std::vector<BlockRequest> requests;
+	requests.emplace_back(true, 20);
+	requests.back().AddBuffer(data, sizeof(data));
+	requests.emplace_back(false, 64);
+	requests.back().AddBuffer(block, sizeof(block));
+
+	bdev.SubmitRequests(requests.data(), requests.size());
+
+	ASSERT_TRUE(requests[0].success);
+	ASSERT_FALSE(requests[1].success);
+
+	ASSERT_TRUE(bdev.ReadBlocks(20, 1, block));
+	ASSERT_EQ(0x5a, block[0]);
+
+	bdev.Close();
+}
@@ -0,0 +1,287 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "TestThreadModel.h"
+#include "abi/devices/Component.h"
+#include "abi/devices/generic/timing/TickConsumer.h"
+#include "abi/devices/generic/timing/TickSource.h"
+#include "util/Checkpoint.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+using namespace archsim::util;
+using namespace archsim::abi::devices::timing;
+using archsim::abi::devices::Component;
+using archsim::abi::devices::ComponentDescriptor;
+using archsim::abi::devices::MemoryRegister;
+using archsim::abi::devices::RegisterBackedMemoryComponent;
+using archsim::core::thread::FlushMode;
+using archsim::core::thread::RoundingMode;
+using archsim::core::thread::ThreadInstance;
+
+TEST(Checkpoint, SectionRoundTrip)
+{
+	Checkpoint checkpoint;
+
+	auto writer = checkpoint.AddSection("device@10000000");
+	writer.Write<uint32_t>(0x12345678);
+	writer.Write<uint64_t>(0xfedcba9876543210ull);
+	writer.WriteString("hello");
+
+	ASSERT_TRUE(checkpoint.HasSection("device@10000000"));
+	ASSERT_FALSE(checkpoint.HasSection("thread0"));
+
+	auto reader = checkpoint.GetSection("device@10000000");
+	uint32_t a;
+	uint64_t b;
+	std::string str;
+	ASSERT_TRUE(reader.Read(a));
+	ASSERT_TRUE(reader.Read(b));
+	ASSERT_TRUE(reader.ReadString(str));
+	ASSERT_TRUE(reader.AtEnd());
+
+	ASSERT_EQ(0x12345678, a);
+	ASSERT_EQ(0xfedcba9876543210ull, b);
+	ASSERT_EQ("hello", str);
+
+	// Reading past the end of the section fails
+	ASSERT_FALSE(reader.Read(a));
+}
+
+TEST(Checkpoint, DuplicateSection)
+{
+	Checkpoint checkpoint;
+	checkpoint.AddSection("thread0");
+	ASSERT_THROW(checkpoint.AddSection("thread0"), std::logic_error);
+}
+
+TEST(Checkpoint, SaveAndLoad)
+{
+	Checkpoint saved;
+	saved.AddSection("ticks").Write<uint64_t>(1000);
+	saved.AddSection("empty");
+	auto writer = saved.AddSection("thread0");
+	for(uint32_t i = 0; i < 100; ++i) {
+		writer.Write(i);
+	}
+
+	std::stringstream stream;
+	ASSERT_TRUE(saved.Save(stream));
+
+	Checkpoint loaded;
+	ASSERT_TRUE(loaded.Load(stream));
+	ASSERT_EQ(saved.GetSections(), loaded.GetSections());
+}
+
+TEST(Checkpoint, LoadRejectsBadFiles)
+{
+	Checkpoint saved;
+	saved.AddSection("ticks").Write<uint64_t>(1000);
+
+	std::stringstream stream;
+	ASSERT_TRUE(saved.Save(stream));
+	std::string data = stream.str();
+
+	// Truncated in the middle of a section
+	std::stringstream truncated (data.substr(0, data.size() - 4));
+	Checkpoint loaded;
+	ASSERT_FALSE(loaded.Load(truncated));
+
+	// Not a checkpoint at all
+	data[0] = 'X';
+	std::stringstream bad_magic (data);
+	ASSERT_FALSE(loaded.Load(bad_magic));
+}
+
+class CountdownConsumer : public TickConsumer
+{
+public:
+	CountdownConsumer(uint64_t remaining) : Remaining(remaining), Ticks(0) {}
+
+	void Tick(uint32_t tick_periods) override
+	{
+		Ticks += tick_periods;
+		Remaining -= std::min<uint64_t>(Remaining, tick_periods);
+	}
+
+	uint64_t GetTicksUntilDeadline() override
+	{
+		return Remaining == 0 ? kNoDeadline : Remaining;
+	}
+
+	uint64_t Remaining;
+	uint64_t Ticks;
+};
+
+TEST(Checkpoint, InstructionCountTickSourceRestore)
+{
+	Checkpoint checkpoint;
+
+	{
+		InstructionCountTickSource source (10);
+		CountdownConsumer consumer (100);
+		source.AddConsumer(consumer);
+		source.Start();
+
+		source.AddInstructions(500);
+		source.Synchronise();
+		ASSERT_EQ(50, source.GetCounter());
+		ASSERT_EQ(50, consumer.Remaining);
+
+		auto writer = checkpoint.AddSection("ticks");
+		source.SaveState(writer);
+	}
+
+	// A fresh source, whose consumer was added before the time was restored
+	InstructionCountTickSource source (10);
+	CountdownConsumer consumer (50);
+	source.AddConsumer(consumer);
+	source.Start();
+
+	auto reader = checkpoint.GetSection("ticks");
+	ASSERT_TRUE(source.RestoreState(reader));
+	source.StateRestored();
+	ASSERT_EQ(50, source.GetCounter());
+	ASSERT_EQ(500, source.GetInstructionCount());
+
+	// The deadline is re-armed relative to the restored time
+	source.AddInstructions(499);
+	ASSERT_EQ(0, consumer.Ticks);
+	source.AddInstructions(1);
+	ASSERT_EQ(50, consumer.Ticks);
+	ASSERT_EQ(0, consumer.Remaining);
+}
+
+TEST(Checkpoint, ThreadRoundTrip)
+{
+	auto arch = GetTestThreadArch();
+	archsim::util::PubSubContext pubsub;
+	Checkpoint checkpoint;
+
+	std::vector<uint8_t> registers;
+	{
+		ThreadInstance thread (pubsub, arch, GetTestSystemEmulationModel(), 0);
+		uint8_t *data = (uint8_t *)thread.GetRegisterFile();
+		for(size_t i = 0; i < thread.GetRegisterFileInterface().GetSize(); ++i) {
+			data[i] = i * 3 + 1;
+		}
+		registers.assign(data, data + thread.GetRegisterFileInterface().GetSize());
+
+		thread.SetModeID(1);
+		thread.SetExecutionRing(2);
+		thread.GetFPState().SetRoundingMode(RoundingMode::RoundTowardZero);
+		thread.GetFPState().SetFlushMode(FlushMode::FlushToZero);
+
+		auto writer = checkpoint.AddSection("thread0");
+		thread.SaveState(writer);
+	}
+
+	ThreadInstance thread (pubsub, arch, GetTestSystemEmulationModel(), 0);
+	auto reader = checkpoint.GetSection("thread0");
+	ASSERT_TRUE(thread.RestoreState(reader));
+	ASSERT_TRUE(reader.AtEnd());
+
+	ASSERT_EQ(0, memcmp(registers.data(), thread.GetRegisterFile(), registers.size()));
+	ASSERT_EQ(1, thread.GetModeID());
+	ASSERT_EQ(2, thread.GetExecutionRing());
+	ASSERT_EQ(RoundingMode::RoundTowardZero, thread.GetFPState().GetRoundingMode());
+	ASSERT_EQ(FlushMode::FlushToZero, thread.GetFPState().GetFlushMode());
+
+	// A truncated section is rejected
+	const auto &data = checkpoint.GetSections().at("thread0");
+	Checkpoint truncated;
+	truncated.AddSection("thread0").Write(data.data(), data.size() / 2);
+	auto truncated_reader = truncated.GetSection("thread0");
+	ASSERT_FALSE(thread.RestoreState(truncated_reader));
+}
+
+static ComponentDescriptor test_device_descriptor ("TestDevice");
+
+// A device with state in its registers and elsewhere, which is saved through
+// the component hooks
+class TestDevice : public RegisterBackedMemoryComponent
+{
+public:
+	TestDevice(archsim::abi::EmulationModel &model, bool with_status = true)
+		: RegisterBackedMemoryComponent(model, archsim::Address(0x10000000), 0x1000, "test"),
+		  Component(test_device_descriptor),
+		  Control("CONTROL", 0x00, 32, 0),
+		  Data("DATA", 0x04, 32, 0x1234),
+		  Status("STATUS", 0x08, 8, 0),
+		  Counter(0),
+		  Restored(false)
+	{
+		AddRegister(Control);
+		AddRegister(Data);
+		if(with_status) {
+			AddRegister(Status);
+		}
+	}
+
+	bool Initialise() override
+	{
+		return true;
+	}
+
+	void SaveState(CheckpointWriter &writer) override
+	{
+		RegisterBackedMemoryComponent::SaveState(writer);
+		writer.Write(Counter);
+	}
+
+	bool RestoreState(CheckpointReader &reader) override
+	{
+		return RegisterBackedMemoryComponent::RestoreState(reader) && reader.Read(Counter);
+	}
+
+	void StateRestored() override
+	{
+		Restored = true;
+	}
+
+	MemoryRegister Control, Data, Status;
+	uint64_t Counter;
+	bool Restored;
+};
+
+TEST(Checkpoint, DeviceRoundTrip)
+{
+	Checkpoint checkpoint;
+
+	{
+		TestDevice device (GetTestThreadEmulationModel());
+		ASSERT_TRUE(device.Write(0x00, 4, 0xdeadbeef));
+		ASSERT_TRUE(device.Write(0x08, 4, 0x1ff));
+		device.Counter = 0x123456789ull;
+
+		auto writer = checkpoint.AddSection("device@10000000");
+		device.SaveState(writer);
+	}
+
+	TestDevice device (GetTestThreadEmulationModel());
+	auto reader = checkpoint.GetSection("device@10000000");
+	ASSERT_TRUE(device.RestoreState(reader));
+	ASSERT_TRUE(reader.AtEnd());
+
+	// Restoring has no side effects until every device has been restored
+	ASSERT_FALSE(device.Restored);
+	device.StateRestored();
+	ASSERT_TRUE(device.Restored);
+
+	uint64_t value;
+	ASSERT_TRUE(device.Read(0x00, 4, value));
+	ASSERT_EQ(0xdeadbeef, value);
+	ASSERT_TRUE(device.Read(0x04, 4, value));
+	ASSERT_EQ(0x1234, value);
+	ASSERT_TRUE(device.Read(0x08, 4, value));
+	ASSERT_EQ(0xff, value);
+	ASSERT_EQ(0x123456789ull, device.Counter);
+
+	// A device with different registers can't restore the state
+	TestDevice other (GetTestThreadEmulationModel(), false);
+	auto other_reader = checkpoint.GetSection("device@10000000");
+	ASSERT_FALSE(other.RestoreState(other_reader));
+}
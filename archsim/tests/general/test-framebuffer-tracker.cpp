@@ -0,0 +1,119 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "abi/devices/gfx/FramebufferTracker.h"
+#include "session.h"
+#include "system.h"
+
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <tuple>
+#include <vector>
+
+using namespace archsim::abi::devices::gfx;
+
+typedef std::tuple<uint32_t, uint32_t, uint32_t, uint32_t> rect_t;
+
+static std::vector<rect_t> Update(FramebufferTracker &tracker)
+{
+	std::vector<rect_t> rects;
+	tracker.Update([&rects](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+		rects.push_back(rect_t(x, y, width, height));
+	});
+	return rects;
+}
+
+TEST(FramebufferTracker, FirstUpdateIsComplete)
+{
+	// Not a whole number of tiles in either direction
+	std::vector<uint16_t> fb (40 * 20, 0);
+
+	FramebufferTracker tracker;
+	tracker.Attach((const uint8_t *)fb.data(), 40, 20, 2);
+
+	std::vector<rect_t> expected { rect_t(0, 0, 40, 16), rect_t(0, 16, 40, 4) };
+	ASSERT_EQ(expected, Update(tracker));
+	ASSERT_TRUE(Update(tracker).empty());
+}
+
+TEST(FramebufferTracker, ReportsChangedTiles)
+{
+	std::vector<uint32_t> fb (100 * 50, 0x00ff00ff);
+
+	FramebufferTracker tracker;
+	tracker.Attach((const uint8_t *)fb.data(), 100, 50, 4);
+	Update(tracker);
+
+	// Two adjacent tiles, a tile on its own, and a partial tile at the edge
+	fb[20 * 100 + 17] = 1;
+	fb[21 * 100 + 40] = 2;
+	fb[22 * 100 + 70] = 3;
+	fb[49 * 100 + 99] = 4;
+
+	std::vector<rect_t> expected { rect_t(16, 16, 32, 16), rect_t(64, 16, 16, 16), rect_t(96, 48, 4, 2) };
+	ASSERT_EQ(expected, Update(tracker));
+	ASSERT_TRUE(Update(tracker).empty());
+
+	// Writing the same value again is not a change
+	fb[20 * 100 + 17] = 1;
+	ASSERT_TRUE(Update(tracker).empty());
+}
+
+static System *fault_system;
+
+static void ForwardSegFault(int signo, siginfo_t *si, void *)
+{
+	if(!fault_system->HandleSegFault((uint64_t)si->si_addr)) {
+		abort();
+	}
+}
+
+TEST(FramebufferTracker, WriteProtection)
+{
+	archsim::Session session;
+	System system (session);
+	fault_system = &system;
+
+	struct sigaction sa, old_sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = ForwardSegFault;
+	sa.sa_flags = SA_SIGINFO;
+	sigaction(SIGSEGV, &sa, &old_sa);
+
+	// 64 rows of 1024 bytes, so four rows of tiles to a page
+	const uint32_t width = 256, height = 64;
+	uint32_t *fb = (uint32_t *)mmap(nullptr, width * height * 4, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ASSERT_NE(MAP_FAILED, (void *)fb);
+
+	{
+		FramebufferTracker tracker;
+		tracker.Attach((const uint8_t *)fb, width, height, 4);
+		ASSERT_TRUE(tracker.EnableWriteProtection(system));
+
+		ASSERT_EQ(4, Update(tracker).size());
+		ASSERT_TRUE(Update(tracker).empty());
+
+		// The first write to a page faults and marks it as dirty
+		fb[40 * width + 100] = 1;
+		fb[41 * width + 101] = 2;
+
+		std::vector<rect_t> expected { rect_t(96, 32, 16, 16) };
+		ASSERT_EQ(expected, Update(tracker));
+
+		// The page is protected again once it has been compared
+		fb[40 * width + 200] = 3;
+
+		expected = { rect_t(192, 32, 16, 16) };
+		ASSERT_EQ(expected, Update(tracker));
+		ASSERT_TRUE(Update(tracker).empty());
+	}
+
+	// Detaching leaves the framebuffer writable
+	fb[0] = 4;
+
+	munmap(fb, width * height * 4);
+	sigaction(SIGSEGV, &old_sa, nullptr);
+}
@@ -0,0 +1,143 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "TestThreadModel.h"
+#include "util/PubSubSync.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using archsim::Address;
+using archsim::core::MemoryMonitor;
+using archsim::core::thread::ThreadInstance;
+
+class MemoryMonitorTest : public ::testing::Test
+{
+public:
+	MemoryMonitorTest() : Arch(GetTestThreadArch()), EmulationModel(GetTestThreadEmulationModel()) {}
+
+	void CreateThreads(unsigned count)
+	{
+		while(Threads.size() < count) {
+			Threads.push_back(std::unique_ptr<ThreadInstance>(new ThreadInstance(PubSub, Arch, EmulationModel, Threads.size())));
+		}
+	}
+
+	archsim::ArchDescriptor Arch;
+	archsim::util::PubSubContext PubSub;
+	archsim::abi::EmulationModel &EmulationModel;
+	std::vector<std::unique_ptr<ThreadInstance>> Threads;
+};
+
+TEST_F(MemoryMonitorTest, StoreExclusiveNeedsReservation)
+{
+	CreateThreads(1);
+	archsim::core::ShardedMemoryMonitor monitor;
+
+	ASSERT_FALSE(monitor.LockMonitor(Threads[0].get(), Address(0x1000)));
+
+	monitor.AcquireMonitor(Threads[0].get(), Address(0x1000));
+	ASSERT_FALSE(monitor.LockMonitor(Threads[0].get(), Address(0x1008)));
+}
+
+TEST_F(MemoryMonitorTest, StoreExclusiveConsumesReservation)
+{
+	CreateThreads(1);
+	archsim::core::ShardedMemoryMonitor monitor;
+
+	monitor.AcquireMonitor(Threads[0].get(), Address(0x1000));
+	ASSERT_TRUE(monitor.LockMonitor(Threads[0].get(), Address(0x1000)));
+	monitor.Notify(Threads[0].get(), Address(0x1000));
+	monitor.UnlockMonitor(Threads[0].get(), Address(0x1000));
+
+	ASSERT_FALSE(monitor.LockMonitor(Threads[0].get(), Address(0x1000)));
+}
+
+TEST_F(MemoryMonitorTest, WriteClearsOtherReservations)
+{
+	CreateThreads(2);
+	archsim::core::ShardedMemoryMonitor monitor;
+
+	monitor.AcquireMonitor(Threads[0].get(), Address(0x1000));
+	monitor.AcquireMonitor(Threads[1].get(), Address(0x1000));
+
+	ASSERT_TRUE(monitor.LockMonitor(Threads[1].get(), Address(0x1000)));
+	monitor.Notify(Threads[1].get(), Address(0x1000));
+	monitor.UnlockMonitor(Threads[1].get(), Address(0x1000));
+
+	ASSERT_FALSE(monitor.LockMonitor(Threads[0].get(), Address(0x1000)));
+
+	// A notification on its own also clears the reservation
+	monitor.AcquireMonitor(Threads[0].get(), Address(0x1000));
+	monitor.Notify(Threads[1].get(), Address(0x1000));
+	ASSERT_FALSE(monitor.LockMonitor(Threads[0].get(), Address(0x1000)));
+}
+
+TEST_F(MemoryMonitorTest, UnlockAfterFaultReleasesStripe)
+{
+	CreateThreads(2);
+	archsim::core::ShardedMemoryMonitor monitor;
+
+	monitor.AcquireMonitor(Threads[0].get(), Address(0x1000));
+	ASSERT_TRUE(monitor.LockMonitor(Threads[0].get(), Address(0x1000)));
+	monitor.Unlock(Threads[0].get());
+
+	monitor.AcquireMonitor(Threads[1].get(), Address(0x1000));
+	ASSERT_TRUE(monitor.LockMonitor(Threads[1].get(), Address(0x1000)));
+	monitor.UnlockMonitor(Threads[1].get(), Address(0x1000));
+}
+
+TEST_F(MemoryMonitorTest, LockExcludesStoreExclusive)
+{
+	CreateThreads(2);
+	archsim::core::ShardedMemoryMonitor monitor;
+
+	monitor.Lock(Threads[0].get());
+	monitor.Lock(Threads[0].get());
+
+	bool stored = false;
+	std::thread other([&] {
+		monitor.AcquireMonitor(Threads[1].get(), Address(0x1000));
+		if(monitor.LockMonitor(Threads[1].get(), Address(0x1000))) {
+			stored = true;
+			monitor.UnlockMonitor(Threads[1].get(), Address(0x1000));
+		}
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	ASSERT_FALSE(stored);
+
+	monitor.Unlock(Threads[0].get());
+	other.join();
+	ASSERT_TRUE(stored);
+}
+
+TEST_F(MemoryMonitorTest, UnlockByOtherThreadKeepsStripe)
+{
+	CreateThreads(2);
+	archsim::core::ShardedMemoryMonitor monitor;
+
+	monitor.AcquireMonitor(Threads[0].get(), Address(0x1000));
+	ASSERT_TRUE(monitor.LockMonitor(Threads[0].get(), Address(0x1000)));
+
+	// Thread 1 holds nothing, so this mustn't release thread 0's stripe
+	monitor.Unlock(Threads[1].get());
+	monitor.UnlockMonitor(Threads[0].get(), Address(0x1000));
+
+	monitor.AcquireMonitor(Threads[1].get(), Address(0x1000));
+	ASSERT_TRUE(monitor.LockMonitor(Threads[1].get(), Address(0x1000)));
+	monitor.UnlockMonitor(Threads[1].get(), Address(0x1000));
+}
+
+TEST_F(MemoryMonitorTest, SharedThreadIDIsFatal)
+{
+	CreateThreads(1);
+	ThreadInstance duplicate (PubSub, Arch, EmulationModel, 0);
+	archsim::core::ShardedMemoryMonitor monitor;
+
+	monitor.AcquireMonitor(Threads[0].get(), Address(0x1000));
+	ASSERT_DEATH(monitor.AcquireMonitor(&duplicate, Address(0x1000)), "");
+}
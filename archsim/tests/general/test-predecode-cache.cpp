@@ -0,0 +1,134 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "TestThreadModel.h"
+#include "gensim/gensim_decode.h"
+#include "gensim/gensim_decode_context.h"
+#include "interpret/PredecodeCache.h"
+#include "util/PubSubSync.h"
+
+#include <utility>
+#include <vector>
+
+using archsim::Address;
+using archsim::core::thread::ThreadInstance;
+using archsim::interpret::PredecodeCache;
+using archsim::interpret::PredecodedBlock;
+
+// Decodes 4-byte instructions whose opcode is the word index of their
+// address. Instructions at end_of_block end the block, and decoding fails
+// at fault_address.
+class TestDecodeContext : public gensim::DecodeContext
+{
+public:
+	TestDecodeContext(Address end_of_block, Address fault_address) : end_of_block_(end_of_block), fault_address_(fault_address) {}
+
+	uint32_t DecodeSync(archsim::MemoryInterface &mem_interface, Address address, uint32_t mode, gensim::BaseDecode *&target) override
+	{
+		if(address == fault_address_) {
+			return 1;
+		}
+
+		target = new gensim::BaseDecode();
+		target->Instr_Code = address.Get() >> 2;
+		target->Instr_Length = 4;
+		if(address == end_of_block_) {
+			target->SetEndOfBlock();
+		} else {
+			target->ClearEndOfBlock();
+		}
+		return 0;
+	}
+
+private:
+	Address end_of_block_;
+	Address fault_address_;
+};
+
+// The (instruction, next instruction) opcode pairs seen by ResolveHandler. A
+// missing next instruction is recorded as 0.
+static std::vector<std::pair<uint16_t, uint16_t>> resolved_pairs;
+
+// Gives each pair its own handler, in the same way as the interpreter's
+// superinstructions
+static void *ResolveHandler(uint32_t mode, const gensim::BaseDecode &decode, const gensim::BaseDecode *next)
+{
+	uint16_t next_code = next != nullptr ? next->Instr_Code : 0;
+	resolved_pairs.push_back({decode.Instr_Code, next_code});
+	return (void *)(((uintptr_t)decode.Instr_Code << 16) | next_code);
+}
+
+class PredecodeCacheTest : public ::testing::Test
+{
+public:
+	PredecodeCacheTest() : arch_(GetTestThreadArch()), thread_(pubsub_, arch_, GetTestThreadEmulationModel()), cache_(pubsub_, false) {}
+
+	void SetUp() override
+	{
+		resolved_pairs.clear();
+	}
+
+	archsim::util::PubSubContext pubsub_;
+	archsim::ArchDescriptor arch_;
+	ThreadInstance thread_;
+	PredecodeCache cache_;
+};
+
+TEST_F(PredecodeCacheTest, HandlersSeeNextInstruction)
+{
+	TestDecodeContext decode_ctx (Address(0x1010), Address(0));
+
+	PredecodedBlock *block = nullptr;
+	ASSERT_EQ(0, cache_.DecodeBlock(&thread_, decode_ctx, Address(0x1000), 0, ResolveHandler, block));
+	ASSERT_NE(nullptr, block);
+	ASSERT_EQ(5, block->size());
+
+	// Each instruction is paired with the one after it, and the last one in
+	// the block with nothing
+	std::vector<std::pair<uint16_t, uint16_t>> expected { {0x400, 0x401}, {0x401, 0x402}, {0x402, 0x403}, {0x403, 0x404}, {0x404, 0} };
+	ASSERT_EQ(expected, resolved_pairs);
+
+	size_t i = 0;
+	for(auto &insn : *block) {
+		ASSERT_EQ(expected[i].first, insn.Decode->Instr_Code);
+		ASSERT_EQ((void *)(((uintptr_t)expected[i].first << 16) | expected[i].second), insn.Handler);
+		i++;
+	}
+}
+
+TEST_F(PredecodeCacheTest, DecodeFaultEndsBlock)
+{
+	TestDecodeContext decode_ctx (Address(0), Address(0x1008));
+
+	// A fault after the first instruction just ends the block, so the last
+	// instruction before it has no successor to fuse with
+	PredecodedBlock *block = nullptr;
+	ASSERT_EQ(0, cache_.DecodeBlock(&thread_, decode_ctx, Address(0x1000), 0, ResolveHandler, block));
+	ASSERT_EQ(2, block->size());
+
+	std::vector<std::pair<uint16_t, uint16_t>> expected { {0x400, 0x401}, {0x401, 0} };
+	ASSERT_EQ(expected, resolved_pairs);
+
+	// A fault on the first instruction is returned, and no handlers are
+	// resolved
+	resolved_pairs.clear();
+	block = nullptr;
+	ASSERT_NE(0, cache_.DecodeBlock(&thread_, decode_ctx, Address(0x1008), 0, ResolveHandler, block));
+	ASSERT_EQ(nullptr, block);
+	ASSERT_TRUE(resolved_pairs.empty());
+}
+
+TEST_F(PredecodeCacheTest, BlocksStopAtPageEnd)
+{
+	TestDecodeContext decode_ctx (Address(0), Address(0));
+
+	PredecodedBlock *block = nullptr;
+	ASSERT_EQ(0, cache_.DecodeBlock(&thread_, decode_ctx, Address(0x1ff8), 0, ResolveHandler, block));
+	ASSERT_EQ(2, block->size());
+
+	// The last instruction on the page isn't fused with the first one on the
+	// next page
+	std::vector<std::pair<uint16_t, uint16_t>> expected { {0x7fe, 0x7ff}, {0x7ff, 0} };
+	ASSERT_EQ(expected, resolved_pairs);
+}
@@ -0,0 +1,151 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "TestThreadModel.h"
+#include "core/thread/ThreadMetrics.h"
+#include "util/ProfileDump.h"
+#include "util/ProfileHistogram.h"
+#include "util/SimOptions.h"
+
+#include <map>
+#include <sstream>
+
+using namespace archsim::util;
+
+TEST(ProfileHistogram, CountsKeys)
+{
+	ProfileHistogram hist (4);
+
+	hist.inc(0x1000);
+	hist.inc(0x1000);
+	hist.inc(0x1004, 10);
+	hist.inc(0xffffffff00000000ull);
+
+	ASSERT_EQ(2, hist.get_value_at_index(0x1000));
+	ASSERT_EQ(10, hist.get_value_at_index(0x1004));
+	ASSERT_EQ(1, hist.get_value_at_index(0xffffffff00000000ull));
+	ASSERT_EQ(0, hist.get_value_at_index(0x2000));
+	ASSERT_EQ(13, hist.get_total());
+
+	// Looking up an unseen key doesn't allocate anything
+	ASSERT_EQ(2, hist.get_page_count());
+
+	hist.clear();
+	ASSERT_EQ(0, hist.get_total());
+	ASSERT_EQ(2, hist.get_page_count());
+}
+
+TEST(ProfileHistogram, PointersAreStable)
+{
+	ProfileHistogram hist (4);
+
+	// Enough pages to grow the directory several times
+	std::vector<ProfileHistogram::value_t *> ptrs;
+	for(uint64_t page = 0; page < 1000; ++page) {
+		ptrs.push_back(hist.get_value_ptr_at_index(page * 0x1230));
+	}
+
+	for(uint64_t page = 0; page < 1000; ++page) {
+		ASSERT_EQ(ptrs[page], hist.get_value_ptr_at_index(page * 0x1230));
+		*ptrs[page] += page + 1;
+	}
+
+	for(uint64_t page = 0; page < 1000; ++page) {
+		ASSERT_EQ(page + 1, hist.get_value_at_index(page * 0x1230));
+	}
+}
+
+TEST(ProfileHistogram, Merge)
+{
+	ProfileHistogram a, b;
+	a.inc(1, 5);
+	a.inc(100000, 1);
+	b.inc(1, 2);
+	b.inc(7, 3);
+
+	a.merge(b);
+
+	std::map<uint64_t, uint64_t> entries;
+	a.for_each([&entries](uint64_t key, uint64_t value) {
+		entries[key] = value;
+	});
+
+	std::map<uint64_t, uint64_t> expected { {1, 7}, {7, 3}, {100000, 1} };
+	ASSERT_EQ(expected, entries);
+}
+
+TEST(ProfileHistogram, DumpRoundTrip)
+{
+	ProfileHistogram pc, ir;
+	for(uint64_t i = 0; i < 10000; ++i) {
+		pc.inc(0x8000 + i * 4, i + 1);
+	}
+	ir.inc(3, 42);
+
+	std::stringstream stream;
+	ProfileWriter writer (stream);
+	ASSERT_TRUE(writer.WriteHeader());
+	ASSERT_TRUE(writer.WriteHistogram("pc", 0, pc));
+	ASSERT_TRUE(writer.WriteHistogram("ir", 1, ir));
+
+	ProfileReader reader (stream);
+	ASSERT_TRUE(reader.ReadHeader());
+
+	ProfileHistogram read_pc;
+	uint64_t ir_value = 0;
+	ASSERT_TRUE(reader.ReadAll([&](const std::string &name, uint32_t thread_id, uint64_t key, uint64_t value) {
+		if(name == "pc") {
+			ASSERT_EQ(0, thread_id);
+			read_pc.inc(key, value);
+		} else {
+			ASSERT_EQ("ir", name);
+			ASSERT_EQ(1, thread_id);
+			ASSERT_EQ(3, key);
+			ir_value += value;
+		}
+	}));
+
+	ASSERT_EQ(42, ir_value);
+	ASSERT_EQ(pc.get_total(), read_pc.get_total());
+	ASSERT_EQ(5000, read_pc.get_value_at_index(0x8000 + 4999 * 4));
+}
+
+TEST(ProfileHistogram, TruncatedDumpIsRejected)
+{
+	ProfileHistogram hist;
+	hist.inc(1);
+
+	std::stringstream stream;
+	ProfileWriter writer (stream);
+	writer.WriteHeader();
+	writer.WriteHistogram("pc", 0, hist);
+
+	std::string data = stream.str();
+	std::stringstream truncated (data.substr(0, data.size() - 4));
+
+	ProfileReader reader (truncated);
+	ASSERT_TRUE(reader.ReadHeader());
+	ASSERT_FALSE(reader.ReadAll([](const std::string &, uint32_t, uint64_t, uint64_t) {}));
+}
+
+TEST(ProfileHistogram, PairProfileOutput)
+{
+	auto arch = GetTestThreadArch();
+	archsim::core::thread::ThreadMetrics metrics;
+	metrics.OpcodePairHistogram.inc((3 << 16) | 7, 2);
+	metrics.OpcodePairHistogram.inc((12 << 16) | 3, 5);
+
+	bool old_profile = archsim::options::Profile.GetValue();
+	archsim::options::Profile.SetValue(true);
+
+	std::stringstream stream;
+	archsim::core::thread::ThreadMetricPrinter().PrintStats(arch, metrics, stream);
+
+	archsim::options::Profile.SetValue(old_profile);
+
+	// Without a disassembler, pairs are printed as opcodes, in the
+	// "first second" format read by the Superinstructions option
+	std::string output = stream.str();
+	ASSERT_NE(std::string::npos, output.find("Instruction Pair Profile\n3 7\t2\n12 3\t5\n"));
+}
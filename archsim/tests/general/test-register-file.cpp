@@ -0,0 +1,60 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "TestThreadModel.h"
+#include "util/PubSubSync.h"
+
+using archsim::Address;
+using archsim::RegisterFileDescriptor;
+using archsim::RegisterFileEntryDescriptor;
+using archsim::RegisterFileEntryHandle;
+using archsim::core::thread::ThreadInstance;
+
+TEST(RegisterFile, EntryHandles)
+{
+	RegisterFileDescriptor rf(128, {
+		RegisterFileEntryDescriptor("RB", 0, 0, 1, 64, 16, 4, 4),
+		RegisterFileEntryDescriptor("PC", 1, 64, 1, 4, 1, 4, 4, "PC"),
+		RegisterFileEntryDescriptor("FLAG", 2, 72, 1, 1, 1, 1, 1)
+	});
+
+	auto rb = rf.GetEntryHandle<uint32_t>("RB");
+	ASSERT_TRUE(rb.IsValid());
+	ASSERT_EQ(0, rb.GetOffset());
+
+	auto flag = rf.GetEntryHandle<uint8_t>("FLAG");
+	ASSERT_TRUE(flag.IsValid());
+	ASSERT_EQ(72, flag.GetOffset());
+
+	// Tagged entries resolve to the same offset as their name
+	auto pc = rf.GetTaggedEntryHandle<uint32_t>("PC");
+	ASSERT_TRUE(pc.IsValid());
+	ASSERT_EQ(64, pc.GetOffset());
+	ASSERT_EQ(pc.GetOffset(), rf.GetEntryHandle<uint32_t>("PC").GetOffset());
+
+	// Missing entries give invalid handles rather than throwing
+	ASSERT_FALSE(rf.GetEntryHandle<uint8_t>("ITSTATE").IsValid());
+	ASSERT_FALSE(rf.GetTaggedEntryHandle<uint32_t>("SP").IsValid());
+	ASSERT_FALSE(RegisterFileEntryHandle<uint32_t>().IsValid());
+}
+
+TEST(RegisterFile, ThreadEntryAccess)
+{
+	auto arch = GetTestThreadArch();
+	archsim::util::PubSubContext pubsub;
+	ThreadInstance thread (pubsub, arch, GetTestThreadEmulationModel());
+
+	auto pc = arch.GetRegisterFileDescriptor().GetEntryHandle<uint32_t>("PC");
+	ASSERT_TRUE(pc.IsValid());
+
+	// Handles and names give the same storage
+	auto &regs = thread.GetRegisterFileInterface();
+	ASSERT_EQ(regs.GetEntry<uint32_t>("PC"), regs.GetEntry(pc));
+
+	*regs.GetEntry(pc) = 0x1234;
+	ASSERT_EQ(Address(0x1234), thread.GetPC());
+
+	thread.SetPC(Address(0x5678));
+	ASSERT_EQ(0x5678, *regs.GetEntry(pc));
+}
@@ -0,0 +1,189 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "TestThreadModel.h"
+#include "abi/devices/generic/timing/TickSource.h"
+#include "core/execution/ExecutionContextManager.h"
+#include "system.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+using archsim::abi::devices::timing::TickSource;
+using archsim::core::execution::ExecutionContextManager;
+using archsim::core::thread::ThreadInstance;
+using archsim::core::thread::ThreadMessage;
+
+TEST(ExecutionContextManager, IdleAccounting)
+{
+	auto arch = GetTestThreadArch();
+	archsim::util::PubSubContext pubsub;
+	ThreadInstance a (pubsub, arch, GetTestThreadEmulationModel(), 0);
+	ThreadInstance b (pubsub, arch, GetTestThreadEmulationModel(), 1);
+
+	ExecutionContextManager ecm;
+	ecm.ThreadStarted(&a);
+	ecm.ThreadStarted(&b);
+
+	ASSERT_FALSE(ecm.ThreadIdle());
+	ASSERT_EQ(1, ecm.GetIdleThreadCount());
+	ASSERT_TRUE(ecm.ThreadIdle());
+	ASSERT_EQ(2, ecm.GetIdleThreadCount());
+
+	ecm.ThreadWoken();
+	ASSERT_EQ(1, ecm.GetIdleThreadCount());
+
+	// A stopped thread no longer has to be idle for the system to be idle
+	ecm.ThreadStopped(&b);
+	ecm.ThreadWoken();
+	ASSERT_TRUE(ecm.ThreadIdle());
+}
+
+// A tick source which can't skip time, like the real time one, but which can
+// run a hook while an idle thread is trying to
+class TestIdleTickSource : public TickSource
+{
+public:
+	bool SkipToNextDeadline() override
+	{
+		if(on_skip) {
+			auto hook = on_skip;
+			on_skip = nullptr;
+			hook();
+		}
+		return false;
+	}
+
+	std::function<void()> on_skip;
+};
+
+// Idle needs an emulation model which is attached to a system, for the ECM
+class ThreadIdleTest : public ::testing::Test
+{
+public:
+	ThreadIdleTest() : arch_(GetTestThreadArch()), thread_(pubsub_, arch_, GetTestSystemEmulationModel(), 0), other_thread_(pubsub_, arch_, GetTestSystemEmulationModel(), 1) {}
+
+	void SetUp() override
+	{
+		GetECM().ThreadStarted(&thread_);
+	}
+
+	void TearDown() override
+	{
+		GetECM().ThreadStopped(&thread_);
+		GetECM().ThreadStopped(&other_thread_);
+		ASSERT_EQ(0, GetECM().GetIdleThreadCount());
+	}
+
+	ExecutionContextManager &GetECM()
+	{
+		return GetTestSystemEmulationModel().GetSystem().GetECM();
+	}
+
+	// The shared system keeps its tick source, so install one on first use
+	TestIdleTickSource &GetTickSource()
+	{
+		static auto source = [] {
+			auto source = new TestIdleTickSource();
+			GetTestSystemEmulationModel().GetSystem().SetTickSource(source);
+			return source;
+		}();
+		return *source;
+	}
+
+	// Wait for the guest thread to report itself as idle
+	void WaitForIdle()
+	{
+		while(GetECM().GetIdleThreadCount() == 0) {
+			std::this_thread::yield();
+		}
+	}
+
+	archsim::util::PubSubContext pubsub_;
+	archsim::ArchDescriptor arch_;
+	ThreadInstance thread_;
+	ThreadInstance other_thread_;
+};
+
+TEST_F(ThreadIdleTest, MessageWakesThread)
+{
+	// Keep another thread running, so that the idle thread just waits
+	GetECM().ThreadStarted(&other_thread_);
+
+	std::thread guest ([this] {
+		thread_.WaitForInterrupt();
+		thread_.HandleMessage();
+	});
+
+	WaitForIdle();
+	ASSERT_EQ(1, GetECM().GetIdleThreadCount());
+
+	// The thread stops counting as idle as soon as it's woken, rather than
+	// when it next gets to run
+	thread_.SendMessage(ThreadMessage::Nop);
+	ASSERT_EQ(0, GetECM().GetIdleThreadCount());
+
+	guest.join();
+	ASSERT_EQ(1, thread_.GetMetrics().IdleWaits.get_value());
+}
+
+TEST_F(ThreadIdleTest, PendingEventSkipsWait)
+{
+	thread_.SignalEvent();
+	thread_.WaitForEvent();
+	thread_.HandleMessage();
+
+	// The event is consumed without the thread ever going idle
+	ASSERT_EQ(0, thread_.GetMetrics().IdleWaits.get_value());
+
+	// An event doesn't wake a thread which is only waiting for an interrupt
+	thread_.SignalEvent();
+	std::thread guest ([this] {
+		thread_.WaitForInterrupt();
+		thread_.HandleMessage();
+	});
+
+	// With every running thread idle and no tick source, the thread just
+	// waits
+	WaitForIdle();
+	thread_.SendMessage(ThreadMessage::Nop);
+	guest.join();
+
+	ASSERT_EQ(1, thread_.GetMetrics().IdleWaits.get_value());
+}
+
+TEST_F(ThreadIdleTest, MessageWhileSkippingTime)
+{
+	// The only running thread skips time as it goes idle, which happens
+	// without the message lock held. A message sent then has to be noticed
+	// before the thread waits.
+	GetTickSource().on_skip = [this] {
+		thread_.SendMessage(ThreadMessage::Nop);
+	};
+
+	std::atomic<bool> done (false);
+	std::thread guest ([this, &done] {
+		thread_.WaitForInterrupt();
+		thread_.HandleMessage();
+		done = true;
+	});
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while(!done && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+
+	// Don't leave the thread asleep if the message was lost
+	bool woken = done;
+	if(!woken) {
+		thread_.SendMessage(ThreadMessage::Nop);
+	}
+	guest.join();
+
+	ASSERT_TRUE(woken);
+	ASSERT_FALSE(GetTickSource().on_skip);
+	ASSERT_EQ(1, thread_.GetMetrics().IdleWaits.get_value());
+}
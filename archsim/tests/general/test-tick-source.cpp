@@ -0,0 +1,179 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "abi/devices/generic/timing/TickConsumer.h"
+#include "abi/devices/generic/timing/TickSource.h"
+#include "abi/devices/generic/timing/TimerWheel.h"
+
+#include <vector>
+
+using namespace archsim::abi::devices::timing;
+
+class DeadlineConsumer : public TickConsumer
+{
+public:
+	DeadlineConsumer(uint64_t deadline) : Deadline(deadline), Ticks(0) {}
+
+	void Tick(uint32_t tick_periods) override
+	{
+		Ticks += tick_periods;
+		if(Deadline != kNoDeadline) {
+			Deadline -= std::min<uint64_t>(Deadline, tick_periods);
+		}
+	}
+
+	// Like a one-shot timer, there is no deadline once it has been reached
+	uint64_t GetTicksUntilDeadline() override
+	{
+		return Deadline == 0 ? kNoDeadline : Deadline;
+	}
+
+	uint64_t Deadline;
+	uint64_t Ticks;
+};
+
+TEST(TickSource, SkipToEarliestDeadline)
+{
+	CallbackTickSource source (1);
+	DeadlineConsumer early (100), late (250);
+	source.AddConsumer(early);
+	source.AddConsumer(late);
+	source.Start();
+
+	ASSERT_TRUE(source.SkipToNextDeadline());
+	ASSERT_EQ(100, source.GetCounter());
+	ASSERT_EQ(100, early.Ticks);
+	ASSERT_EQ(100, late.Ticks);
+	ASSERT_EQ(150, late.Deadline);
+}
+
+TEST(TickSource, NoSkipWithoutDeadline)
+{
+	CallbackTickSource source (1);
+	DeadlineConsumer consumer (TickConsumer::kNoDeadline);
+	source.AddConsumer(consumer);
+	source.Start();
+
+	ASSERT_FALSE(source.SkipToNextDeadline());
+	ASSERT_EQ(0, source.GetCounter());
+	ASSERT_EQ(0, consumer.Ticks);
+}
+
+TEST(TickSource, NoSkipWhenStopped)
+{
+	CallbackTickSource source (1);
+	DeadlineConsumer consumer (10);
+	source.AddConsumer(consumer);
+
+	ASSERT_FALSE(source.SkipToNextDeadline());
+	ASSERT_EQ(0, consumer.Ticks);
+}
+
+TEST(TimerWheel, ExpiresInDeadlineOrder)
+{
+	TimerWheel wheel;
+	TimerWheel::Event events[5];
+
+	// Spread across the levels of the wheel, and the overflow list
+	uint64_t deadlines[] = { 1ull << 40, 70, 5, 1ull << 20, 4096 };
+	for(int i = 0; i < 5; ++i) {
+		wheel.Schedule(events[i], deadlines[i]);
+	}
+
+	ASSERT_EQ(5, wheel.GetNextDeadline());
+
+	std::vector<uint64_t> expired;
+	auto record = [&expired](TimerWheel::Event &event) {
+		expired.push_back(event.GetDeadline());
+	};
+
+	wheel.Advance(4, record);
+	ASSERT_TRUE(expired.empty());
+
+	wheel.Advance(5000, record);
+	ASSERT_EQ((std::vector<uint64_t> { 5, 70, 4096 }), expired);
+	ASSERT_EQ(1ull << 20, wheel.GetNextDeadline());
+	ASSERT_FALSE(events[2].IsScheduled());
+
+	wheel.Advance(1ull << 41, record);
+	ASSERT_EQ((std::vector<uint64_t> { 5, 70, 4096, 1ull << 20, 1ull << 40 }), expired);
+	ASSERT_EQ(TimerWheel::kNever, wheel.GetNextDeadline());
+}
+
+TEST(TimerWheel, Cancel)
+{
+	TimerWheel wheel;
+	TimerWheel::Event first, second;
+	wheel.Schedule(first, 10);
+	wheel.Schedule(second, 20);
+	wheel.Cancel(first);
+
+	ASSERT_FALSE(first.IsScheduled());
+	ASSERT_EQ(20, wheel.GetNextDeadline());
+
+	unsigned count = 0;
+	wheel.Advance(100, [&count](TimerWheel::Event &event) {
+		count++;
+	});
+	ASSERT_EQ(1, count);
+}
+
+TEST(TimerWheel, RescheduleFromExpiry)
+{
+	TimerWheel wheel;
+	TimerWheel::Event periodic;
+	wheel.Schedule(periodic, 100);
+
+	unsigned count = 0;
+	wheel.Advance(1000, [&](TimerWheel::Event &event) {
+		count++;
+		wheel.Schedule(event, event.GetDeadline() + 100);
+	});
+
+	ASSERT_EQ(10, count);
+	ASSERT_EQ(1100, wheel.GetNextDeadline());
+}
+
+TEST(InstructionCountTickSource, TicksOnlyAtDeadlines)
+{
+	InstructionCountTickSource source (10);
+	DeadlineConsumer consumer (100);
+	source.AddConsumer(consumer);
+	source.Start();
+
+	// 50 ticks' worth of instructions isn't enough to reach the deadline
+	source.AddInstructions(500);
+	ASSERT_EQ(0, consumer.Ticks);
+	ASSERT_EQ(0, source.GetCounter());
+
+	source.AddInstructions(505);
+	ASSERT_EQ(100, consumer.Ticks);
+	ASSERT_EQ(100, source.GetCounter());
+
+	// Devices bring themselves up to date when they are accessed
+	consumer.Deadline = 20;
+	source.Reschedule(consumer);
+	source.AddInstructions(100);
+	source.Synchronise();
+	ASSERT_EQ(110, consumer.Ticks);
+
+	source.AddInstructions(100);
+	ASSERT_EQ(120, consumer.Ticks);
+	source.RemoveConsumer(consumer);
+}
+
+TEST(InstructionCountTickSource, SkipToNextDeadline)
+{
+	InstructionCountTickSource source (10);
+	DeadlineConsumer consumer (25);
+	source.AddConsumer(consumer);
+	source.Start();
+
+	ASSERT_TRUE(source.SkipToNextDeadline());
+	ASSERT_EQ(250, source.GetInstructionCount());
+	ASSERT_EQ(25, consumer.Ticks);
+
+	ASSERT_FALSE(source.SkipToNextDeadline());
+	source.RemoveConsumer(consumer);
+}
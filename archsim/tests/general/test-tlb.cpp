@@ -0,0 +1,101 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "core/SoftwareTLB.h"
+#include "util/PubSubSync.h"
+
+#include <memory>
+
+using archsim::Address;
+using archsim::SoftwareTLB;
+
+class SoftwareTLBTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		tlb_.reset(new SoftwareTLB(pubsub_, 12));
+	}
+
+	bool Lookup(uint64_t virt_addr, SoftwareTLB::AccessKind kind, uint64_t &phys_addr, uint32_t asid = 0, uint32_t ring = 1)
+	{
+		Address phys;
+		bool hit = tlb_->Lookup(Address(virt_addr), asid, ring, kind, phys);
+		phys_addr = phys.Get();
+		return hit;
+	}
+
+	archsim::util::PubSubContext pubsub_;
+	std::unique_ptr<SoftwareTLB> tlb_;
+};
+
+TEST_F(SoftwareTLBTest, HitKeepsPageOffset)
+{
+	uint64_t phys;
+	ASSERT_FALSE(Lookup(0x8000123, SoftwareTLB::AccessRead, phys));
+
+	tlb_->Insert(Address(0x8000123), 0, 1, SoftwareTLB::AccessRead, Address(0x40123));
+	ASSERT_TRUE(Lookup(0x8000ffc, SoftwareTLB::AccessRead, phys));
+	ASSERT_EQ(0x40ffcu, phys);
+}
+
+TEST_F(SoftwareTLBTest, PermissionsAreSeparate)
+{
+	uint64_t phys;
+	tlb_->Insert(Address(0x8000000), 0, 1, SoftwareTLB::AccessRead, Address(0x40000));
+
+	// A page which has only been read must go back to the MMU for a write,
+	// and the instruction side is separate
+	ASSERT_FALSE(Lookup(0x8000000, SoftwareTLB::AccessWrite, phys));
+	ASSERT_FALSE(Lookup(0x8000000, SoftwareTLB::AccessFetch, phys));
+
+	tlb_->Insert(Address(0x8000000), 0, 1, SoftwareTLB::AccessWrite, Address(0x40000));
+	ASSERT_TRUE(Lookup(0x8000000, SoftwareTLB::AccessWrite, phys));
+	ASSERT_TRUE(Lookup(0x8000000, SoftwareTLB::AccessRead, phys));
+}
+
+TEST_F(SoftwareTLBTest, TaggedWithASIDAndRing)
+{
+	uint64_t phys;
+	tlb_->Insert(Address(0x8000000), 1, 0, SoftwareTLB::AccessRead, Address(0x40000));
+	tlb_->Insert(Address(0x8000000), 2, 0, SoftwareTLB::AccessRead, Address(0x50000));
+
+	ASSERT_TRUE(Lookup(0x8000000, SoftwareTLB::AccessRead, phys, 1, 0));
+	ASSERT_EQ(0x40000u, phys);
+	ASSERT_TRUE(Lookup(0x8000000, SoftwareTLB::AccessRead, phys, 2, 0));
+	ASSERT_EQ(0x50000u, phys);
+	ASSERT_FALSE(Lookup(0x8000000, SoftwareTLB::AccessRead, phys, 1, 1));
+}
+
+TEST_F(SoftwareTLBTest, EntryFlushIsPrecise)
+{
+	uint64_t phys;
+	tlb_->Insert(Address(0x8000000), 0, 1, SoftwareTLB::AccessRead, Address(0x40000));
+	tlb_->Insert(Address(0x8001000), 0, 1, SoftwareTLB::AccessRead, Address(0x41000));
+	tlb_->Insert(Address(0x8000000), 0, 1, SoftwareTLB::AccessFetch, Address(0x40000));
+
+	pubsub_.Publish(PubSubType::DTlbEntryFlush, (void*)0x8000004);
+
+	ASSERT_FALSE(Lookup(0x8000000, SoftwareTLB::AccessRead, phys));
+	ASSERT_TRUE(Lookup(0x8001000, SoftwareTLB::AccessRead, phys));
+	ASSERT_TRUE(Lookup(0x8000000, SoftwareTLB::AccessFetch, phys));
+
+	pubsub_.Publish(PubSubType::ITlbFullFlush, nullptr);
+	ASSERT_FALSE(Lookup(0x8000000, SoftwareTLB::AccessFetch, phys));
+	ASSERT_TRUE(Lookup(0x8001000, SoftwareTLB::AccessRead, phys));
+}
+
+TEST_F(SoftwareTLBTest, EntryFlushCoversSmallPages)
+{
+	uint64_t phys;
+	tlb_.reset(new SoftwareTLB(pubsub_, 10));
+
+	tlb_->Insert(Address(0x8000000), 0, 1, SoftwareTLB::AccessRead, Address(0x40000));
+	tlb_->Insert(Address(0x8000c00), 0, 1, SoftwareTLB::AccessRead, Address(0x90c00));
+	ASSERT_FALSE(Lookup(0x8000400, SoftwareTLB::AccessRead, phys));
+
+	pubsub_.Publish(PubSubType::DTlbEntryFlush, (void*)0x8000000);
+	ASSERT_FALSE(Lookup(0x8000000, SoftwareTLB::AccessRead, phys));
+	ASSERT_FALSE(Lookup(0x8000c00, SoftwareTLB::AccessRead, phys));
+}
@@ -0,0 +1,193 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "libtrace/RecordFile.h"
+#include "libtrace/RecordStream.h"
+#include "libtrace/TraceRecordStream.h"
+#include "libtrace/TraceSink.h"
+
+#include <fstream>
+#include <thread>
+#include <memory>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace libtrace;
+
+class TraceFileTest : public ::testing::Test
+{
+public:
+	void SetUp() override
+	{
+		char name[] = "/tmp/archsim-trace-XXXXXX";
+		ASSERT_NE(nullptr, mkdtemp(name));
+		dir_ = name;
+
+		// Enough records to fill several blocks, and to wrap the compressed
+		// sink's ring
+		for(uint32_t i = 0; i < 600000; ++i) {
+			records_.push_back(TraceRecord(InstructionHeader, i & 0xffff, i * 4, 0));
+		}
+	}
+
+	void TearDown() override
+	{
+		for(int id = 0; id < kMaxStreams; ++id) {
+			unlink(GetFilename(id).c_str());
+		}
+		rmdir(dir_.c_str());
+	}
+
+	std::string GetPattern() const
+	{
+		return dir_ + "/trace";
+	}
+	std::string GetFilename(int id = 0) const
+	{
+		return GetPattern() + std::to_string(id);
+	}
+
+	static const int kMaxStreams = 4;
+
+	// Sink the records in uneven chunks, so that they straddle blocks
+	void WriteTrace(TraceSink &sink)
+	{
+		int id = sink.Open();
+		for(size_t i = 0; i < records_.size(); i += 4093) {
+			size_t end = std::min(records_.size(), i + 4093);
+			sink.SinkPackets(id, records_.data() + i, records_.data() + end);
+		}
+		sink.Flush();
+	}
+
+	void CheckRecordFile()
+	{
+		FILE *f = fopen(GetFilename().c_str(), "rb");
+		ASSERT_NE(nullptr, f);
+
+		RecordFile file (f);
+		ASSERT_EQ(records_.size(), file.Size());
+
+		// Random access, backwards across blocks
+		for(size_t n = 0; n < records_.size(); n += 7919) {
+			size_t i = records_.size() - 1 - n;
+
+			Record r;
+			ASSERT_TRUE(file.Get(i, r));
+			ASSERT_EQ(records_[i].GetHeader(), r.GetHeader());
+			ASSERT_EQ(records_[i].GetData(), r.GetData());
+		}
+
+		fclose(f);
+	}
+
+	void CheckRecordStream()
+	{
+		FILE *f = fopen(GetFilename().c_str(), "rb");
+		ASSERT_NE(nullptr, f);
+
+		RecordStream stream (f);
+		for(const auto &record : records_) {
+			const Record &r = stream.next();
+			ASSERT_TRUE(stream.good());
+			ASSERT_EQ(record.GetHeader(), r.GetHeader());
+			ASSERT_EQ(record.GetData(), r.GetData());
+		}
+
+		fclose(f);
+	}
+
+	void CheckRecordFileInputStream()
+	{
+		std::ifstream str (GetFilename(), std::ios::binary);
+		ASSERT_TRUE(str.good());
+
+		RecordFileInputStream stream (str);
+		for(const auto &record : records_) {
+			ASSERT_TRUE(stream.Good());
+			auto r = stream.Get();
+			ASSERT_EQ(record.GetHeader(), r.GetHeader());
+			ASSERT_EQ(record.GetData(), r.GetData());
+		}
+	}
+
+	std::string dir_;
+	std::vector<TraceRecord> records_;
+};
+
+TEST_F(TraceFileTest, CompressedRoundTrip)
+{
+	{
+		CompressedFileTraceSink sink (GetPattern());
+		WriteTrace(sink);
+	}
+
+	CheckRecordFile();
+	CheckRecordStream();
+	CheckRecordFileInputStream();
+}
+
+TEST_F(TraceFileTest, UncompressedRoundTrip)
+{
+	{
+		BinaryFileTraceSink sink (GetPattern());
+		WriteTrace(sink);
+	}
+
+	CheckRecordFile();
+	CheckRecordStream();
+}
+
+TEST_F(TraceFileTest, FlushWhileOtherStreamsWrite)
+{
+	static const uint32_t kRecords = 200000;
+
+	// Each source flushes its own stream as it goes, like a thread which
+	// takes an exception, while the others keep writing
+	{
+		CompressedFileTraceSink sink (GetPattern());
+
+		std::vector<std::thread> threads;
+		for(int t = 0; t < kMaxStreams; ++t) {
+			int id = sink.Open();
+			threads.emplace_back([&sink, id] {
+				std::vector<TraceRecord> chunk;
+				for(uint32_t i = 0; i < kRecords; i += chunk.size()) {
+					chunk.clear();
+					for(uint32_t n = i; n < std::min(kRecords, i + 4093); ++n) {
+						chunk.push_back(TraceRecord(InstructionHeader, id, n, 0));
+					}
+					sink.SinkPackets(id, chunk.data(), chunk.data() + chunk.size());
+
+					if((i / 4093) % 7 == 0) {
+						sink.Flush(id);
+					}
+				}
+			});
+		}
+		for(auto &thread : threads) {
+			thread.join();
+		}
+	}
+
+	for(int id = 0; id < kMaxStreams; ++id) {
+		FILE *f = fopen(GetFilename(id).c_str(), "rb");
+		ASSERT_NE(nullptr, f);
+
+		RecordFile file (f);
+		ASSERT_EQ(kRecords, file.Size());
+
+		for(uint32_t i = 0; i < kRecords; i += 997) {
+			Record r;
+			ASSERT_TRUE(file.Get(i, r));
+			TraceRecord expected (InstructionHeader, id, i, 0);
+			ASSERT_EQ(expected.GetHeader(), r.GetHeader());
+			ASSERT_EQ(expected.GetData(), r.GetData());
+		}
+
+		fclose(f);
+	}
+}
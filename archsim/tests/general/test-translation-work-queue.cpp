@@ -0,0 +1,249 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "TestThreadModel.h"
+#include "translate/TranslationManager.h"
+#include "translate/TranslationWorkQueue.h"
+#include "translate/TranslationWorkUnit.h"
+#include "translate/profile/Region.h"
+#include "util/PubSubSync.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using archsim::Address;
+using archsim::core::thread::ThreadInstance;
+using archsim::translate::TranslationManager;
+using archsim::translate::TranslationWorkQueue;
+using archsim::translate::TranslationWorkUnit;
+using archsim::translate::profile::Region;
+
+// Long enough that weights are never refreshed during a test
+static const auto kNoRefresh = std::chrono::hours(1);
+
+class TranslationWorkQueueTest : public ::testing::Test
+{
+public:
+	TranslationWorkQueueTest() : arch_(GetTestThreadArch()), thread_(pubsub_, arch_, GetTestThreadEmulationModel()), mgr_(pubsub_) {}
+
+	void TearDown() override
+	{
+		for(auto region : regions_) {
+			region->Release();
+		}
+	}
+
+	// Each unit gets its own region, so that it can be heated or invalidated
+	// on its own
+	TranslationWorkUnit *NewUnit(uint32_t weight)
+	{
+		auto region = new Region(mgr_, Address(0x1000 * (regions_.size() + 1)));
+		regions_.push_back(region);
+		return new TranslationWorkUnit(&thread_, *region, 0, weight);
+	}
+
+	// Interpret the region some more, which makes its unit heavier
+	void Heat(TranslationWorkUnit *unit, unsigned int count)
+	{
+		auto &region = unit->GetRegion();
+		for(unsigned int i = 0; i < count; ++i) {
+			region.TraceBlock(&thread_, region.GetPhysicalBaseAddress());
+		}
+	}
+
+	// Pop a unit, returning its weight (or -1 if the queue was empty)
+	int64_t PopWeight(TranslationWorkQueue &queue, unsigned int worker)
+	{
+		auto unit = queue.Pop(worker);
+		if(unit == nullptr) {
+			return -1;
+		}
+		int64_t weight = unit->GetWeight();
+		delete unit;
+		return weight;
+	}
+
+	std::string GetStatistics(const TranslationWorkQueue &queue)
+	{
+		std::ostringstream str;
+		queue.PrintStatistics(str);
+		return str.str();
+	}
+
+	archsim::util::PubSubContext pubsub_;
+	archsim::ArchDescriptor arch_;
+	ThreadInstance thread_;
+	TranslationManager mgr_;
+	std::vector<Region*> regions_;
+};
+
+TEST_F(TranslationWorkQueueTest, HeaviestFirstAcrossShards)
+{
+	TranslationWorkQueue queue (3, kNoRefresh);
+
+	// Units are spread across the shards in turn
+	for(uint32_t weight : {3, 9, 1, 7, 5, 8}) {
+		queue.Push(NewUnit(weight));
+	}
+	ASSERT_EQ(6, queue.Size());
+
+	for(int64_t expected : {9, 8, 7, 5, 3, 1}) {
+		ASSERT_EQ(expected, PopWeight(queue, 0));
+	}
+	ASSERT_EQ(-1, PopWeight(queue, 0));
+	ASSERT_EQ(0, queue.Size());
+}
+
+TEST_F(TranslationWorkQueueTest, StealsFromOtherShards)
+{
+	TranslationWorkQueue queue (2, kNoRefresh);
+
+	// Shard 0 gets the light unit, and shard 1 the heavy one
+	queue.Push(NewUnit(1));
+	queue.Push(NewUnit(10));
+
+	// Worker 0 takes the heavier unit from shard 1, then its own
+	ASSERT_EQ(10, PopWeight(queue, 0));
+	ASSERT_EQ(1, PopWeight(queue, 0));
+
+	// An empty shard steals whatever is left
+	queue.Push(NewUnit(4));
+	ASSERT_EQ(4, PopWeight(queue, 1));
+
+	ASSERT_NE(std::string::npos, GetStatistics(queue).find("3 enqueued, 3 dequeued, 2 stolen, 0 cancelled"));
+}
+
+TEST_F(TranslationWorkQueueTest, CancelsInvalidatedHead)
+{
+	TranslationWorkQueue queue (1, kNoRefresh);
+
+	auto heavy = NewUnit(10);
+	queue.Push(heavy);
+	queue.Push(NewUnit(5));
+	queue.Push(NewUnit(1));
+
+	// The head is skipped, and deleted, rather than returned
+	auto &region = heavy->GetRegion();
+	region.Invalidate();
+	ASSERT_EQ(2, region.References());
+
+	ASSERT_EQ(5, PopWeight(queue, 0));
+	ASSERT_EQ(1, region.References());
+	ASSERT_EQ(1, queue.Size());
+
+	ASSERT_NE(std::string::npos, GetStatistics(queue).find("1 dequeued, 0 stolen, 1 cancelled"));
+}
+
+TEST_F(TranslationWorkQueueTest, CancelsInvalidatedUnitsWhenReweighing)
+{
+	// Refresh on every pop
+	TranslationWorkQueue queue (1, TranslationWorkQueue::clock_t::duration::zero());
+
+	queue.Push(NewUnit(10));
+	auto buried = NewUnit(5);
+	queue.Push(buried);
+	queue.Push(NewUnit(1));
+
+	// A unit which isn't at the head is dropped by the re-weigh
+	auto &region = buried->GetRegion();
+	region.Invalidate();
+
+	ASSERT_EQ(10, PopWeight(queue, 0));
+	ASSERT_EQ(1, region.References());
+	ASSERT_EQ(1, queue.Size());
+
+	ASSERT_EQ(1, PopWeight(queue, 0));
+	ASSERT_EQ(-1, PopWeight(queue, 0));
+
+	ASSERT_NE(std::string::npos, GetStatistics(queue).find("2 dequeued, 0 stolen, 1 cancelled"));
+}
+
+TEST_F(TranslationWorkQueueTest, ReweighsAfterInterval)
+{
+	// Without a refresh, the queue keeps the weights units were pushed with
+	{
+		TranslationWorkQueue queue (1, kNoRefresh);
+
+		queue.Push(NewUnit(10));
+		auto cold = NewUnit(5);
+		queue.Push(cold);
+		Heat(cold, 20);
+
+		ASSERT_EQ(10, PopWeight(queue, 0));
+		ASSERT_EQ(25, PopWeight(queue, 0));
+		ASSERT_NE(std::string::npos, GetStatistics(queue).find("(0 refreshes)"));
+	}
+
+	// Once the interval has passed, a unit which has got hotter while
+	// waiting moves to the front
+	{
+		auto interval = std::chrono::milliseconds(10);
+		TranslationWorkQueue queue (1, interval);
+
+		queue.Push(NewUnit(10));
+		auto cold = NewUnit(5);
+		queue.Push(cold);
+		Heat(cold, 20);
+
+		std::this_thread::sleep_for(interval * 2);
+		ASSERT_EQ(25, PopWeight(queue, 0));
+		ASSERT_EQ(10, PopWeight(queue, 0));
+	}
+}
+
+TEST_F(TranslationWorkQueueTest, ConcurrentPushPop)
+{
+	const unsigned int kThreads = 4;
+	const unsigned int kUnitsPerThread = 1000;
+	const unsigned int kTotal = kThreads * kUnitsPerThread;
+
+	// Refresh often, so that re-weighs race with pushes and steals
+	TranslationWorkQueue queue (kThreads, std::chrono::microseconds(50));
+
+	// Every unit shares one region, and is identified by its weight
+	auto region = new Region(mgr_, Address(0x1000));
+	regions_.push_back(region);
+
+	std::vector<std::atomic<unsigned int>> seen (kTotal);
+	for(auto &count : seen) {
+		count = 0;
+	}
+	std::atomic<unsigned int> popped (0);
+
+	std::vector<std::thread> threads;
+	for(unsigned int t = 0; t < kThreads; ++t) {
+		threads.emplace_back([&, t] {
+			for(unsigned int i = 0; i < kUnitsPerThread; ++i) {
+				queue.Push(new TranslationWorkUnit(&thread_, *region, 0, t * kUnitsPerThread + i));
+			}
+		});
+		threads.emplace_back([&, t] {
+			while(popped < kTotal) {
+				auto unit = queue.Pop(t);
+				if(unit == nullptr) {
+					std::this_thread::yield();
+					continue;
+				}
+				seen.at(unit->GetWeight())++;
+				popped++;
+				delete unit;
+			}
+		});
+	}
+	for(auto &thread : threads) {
+		thread.join();
+	}
+
+	ASSERT_EQ(kTotal, popped.load());
+	ASSERT_EQ(0, queue.Size());
+	for(unsigned int i = 0; i < kTotal; ++i) {
+		ASSERT_EQ(1, seen[i].load()) << "unit " << i;
+	}
+
+	// Every unit has released the region
+	ASSERT_EQ(1, region->References());
+}
@@ -33,7 +33,7 @@ static archsim::ArchDescriptor GetArch()
 	}, nullptr, []()->gensim::BaseDecode* { UNIMPLEMENTED; }, []()->gensim::BaseJumpInfoProvider* { UNIMPLEMENTED; }, []()->gensim::DecodeTranslateContext* { UNIMPLEMENTED; }, behaviours);
 	archsim::FeaturesDescriptor f({});
 	archsim::MemoryInterfacesDescriptor mem({}, "");
-	archsim::RegisterFileDescriptor rf(128, {});
+	archsim::RegisterFileDescriptor rf(128, {archsim::RegisterFileEntryDescriptor("PC", 0, 64, 1, 4, 1, 4, 4, "PC")});
 	archsim::ArchDescriptor arch ("test_arch", rf, mem, f, {isa});
 
 	return arch;
@@ -93,9 +93,13 @@ public:
 
 	captive::shared::IRRegId AllocateStack(uint32_t size)
 	{
+		// Vector values get 16 byte slots
+		uint32_t slot_size = size > 8 ? 16 : 8;
+		stack_frame_ = (stack_frame_ + slot_size - 1) & ~(slot_size - 1);
+
 		captive::shared::IRRegId reg = tc_.alloc_reg(size);
 		allocations_[reg] = std::make_pair(captive::shared::IROperand::ALLOCATED_STACK, stack_frame_);
-		stack_frame_ += 8;
+		stack_frame_ += slot_size;
 		return reg;
 	}
 
@@ -0,0 +1,106 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   TestThreadModel.h
+ *
+ * A minimal architecture (with one memory interface) and emulation model, for
+ * tests which need real ThreadInstances.
+ */
+
+#ifndef TESTTHREADMODEL_H
+#define TESTTHREADMODEL_H
+
+#include "abi/EmulationModel.h"
+#include "core/MemoryMonitor.h"
+#include "core/arch/ArchDescriptor.h"
+#include "core/thread/ThreadInstance.h"
+#include "session.h"
+#include "system.h"
+#include "uarch/uArch.h"
+#include "util/SimOptions.h"
+
+#include <cassert>
+
+class TestThreadEmulationModel : public archsim::abi::EmulationModel
+{
+public:
+	void HaltCores() override {}
+	gensim::DecodeContext *GetNewDecodeContext(archsim::core::thread::ThreadInstance &cpu) override
+	{
+		return nullptr;
+	}
+	bool PrepareBoot(System &system) override
+	{
+		return true;
+	}
+	archsim::abi::ExceptionAction HandleException(archsim::core::thread::ThreadInstance *thread, uint64_t category, uint64_t data) override
+	{
+		return archsim::abi::AbortSimulation;
+	}
+	void PrintStatistics(std::ostream &stream) override {}
+};
+
+static inline archsim::ArchDescriptor GetTestThreadArch()
+{
+	archsim::ISABehavioursDescriptor behaviours({});
+	archsim::ISADescriptor isa("isa", 0, [](archsim::Address addr, archsim::MemoryInterface *, gensim::BaseDecode&) {
+		UNIMPLEMENTED;
+		return 0u;
+	}, nullptr, []()->gensim::BaseDecode* { UNIMPLEMENTED; }, []()->gensim::BaseJumpInfoProvider* { UNIMPLEMENTED; }, []()->gensim::DecodeTranslateContext* { UNIMPLEMENTED; }, behaviours);
+	archsim::FeaturesDescriptor f({});
+	archsim::MemoryInterfacesDescriptor mem({archsim::MemoryInterfaceDescriptor("Mem", 8, 8, false, 0)}, "Mem");
+	archsim::RegisterFileDescriptor rf(128, {archsim::RegisterFileEntryDescriptor("PC", 0, 64, 1, 4, 1, 4, 4, "PC")});
+	archsim::ArchDescriptor arch ("test_arch", rf, mem, f, {isa});
+
+	return arch;
+}
+
+// The emulation model's timer manager can't be destroyed unless it has been
+// started, so share one which is never destroyed
+static inline archsim::abi::EmulationModel &GetTestThreadEmulationModel()
+{
+	static auto model = new TestThreadEmulationModel();
+	return *model;
+}
+
+// The same, but attached to a system, for tests which need the ECM or the
+// system's pubsub context. The system is never destroyed either.
+static inline archsim::abi::EmulationModel &GetTestSystemEmulationModel()
+{
+	static auto model = [] {
+		auto session = new archsim::Session();
+		auto system = new System(*session);
+		auto model = new TestThreadEmulationModel();
+		static archsim::uarch::uArch uarch;
+
+		std::string old_memory_model = archsim::options::MemoryModel.GetValue();
+		archsim::options::MemoryModel.SetValue("sparse");
+		bool ok = model->Initialise(*system, uarch);
+		archsim::options::MemoryModel.SetValue(old_memory_model);
+
+		assert(ok);
+		(void)ok;
+		return model;
+	}();
+	return *model;
+}
+
+// A guest-style atomic increment for exercising the memory monitors:
+// load-exclusive, then store-exclusive until it succeeds
+static inline void MonitorIncrement(archsim::core::MemoryMonitor &monitor, archsim::core::thread::ThreadInstance *thread, uint64_t *counter)
+{
+	archsim::Address addr ((archsim::Address::underlying_t)counter);
+	while(true) {
+		monitor.AcquireMonitor(thread, addr);
+		uint64_t value = __atomic_load_n(counter, __ATOMIC_RELAXED);
+
+		if(monitor.LockMonitor(thread, addr)) {
+			__atomic_store_n(counter, value + 1, __ATOMIC_RELAXED);
+			monitor.Notify(thread, addr);
+			monitor.UnlockMonitor(thread, addr);
+			return;
+		}
+	}
+}
+
+#endif /* TESTTHREADMODEL_H */
@@ -0,0 +1,201 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+// =====================================================================
+//
+// Description:
+//
+// archsim-profile: combines and summarises the binary profiles written by
+// archsim --profile-file.
+//
+//   archsim-profile merge [-t] -o <output> <input>...
+//     Sums the histograms of every input into a single profile. Threads
+//     are combined too, unless -t is given.
+//
+//   archsim-profile top [-n <count>] [-H <histogram>] <input>...
+//     Prints the largest entries of each histogram, combining all threads
+//     and inputs. Entries of the opcode-pair histogram are printed as the
+//     two instruction codes.
+//
+// =====================================================================
+
+#include "util/ProfileDump.h"
+#include "util/ProfileHistogram.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using archsim::util::ProfileHistogram;
+using archsim::util::ProfileReader;
+using archsim::util::ProfileWriter;
+
+typedef std::map<std::pair<std::string, uint32_t>, std::unique_ptr<ProfileHistogram>> profile_t;
+
+static void usage()
+{
+	fprintf(stderr, "usage: archsim-profile merge [-t] -o <output> <input>...\n");
+	fprintf(stderr, "       archsim-profile top [-n <count>] [-H <histogram>] <input>...\n");
+}
+
+static bool load(const std::vector<std::string> &inputs, bool keep_threads, profile_t &profile)
+{
+	for(const auto &input : inputs) {
+		std::ifstream stream(input, std::ios::binary);
+		if(!stream) {
+			fprintf(stderr, "Could not open %s\n", input.c_str());
+			return false;
+		}
+
+		ProfileReader reader(stream);
+		if(!reader.ReadHeader()) {
+			fprintf(stderr, "%s is not an archsim profile\n", input.c_str());
+			return false;
+		}
+
+		// Cache the histogram for the current section, since entries arrive in
+		// long runs for the same one
+		std::pair<std::string, uint32_t> current_key;
+		ProfileHistogram *current = nullptr;
+
+		bool ok = reader.ReadAll([&](const std::string &name, uint32_t thread_id, uint64_t key, uint64_t value) {
+			std::pair<std::string, uint32_t> section(name, keep_threads ? thread_id : ProfileWriter::kAllThreads);
+			if(current == nullptr || section != current_key) {
+				auto &histogram = profile[section];
+				if(!histogram) {
+					histogram.reset(new ProfileHistogram());
+				}
+
+				current = histogram.get();
+				current_key = section;
+			}
+
+			current->inc(key, value);
+		});
+
+		if(!ok) {
+			fprintf(stderr, "%s is truncated or corrupt\n", input.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int merge(int argc, char **argv)
+{
+	bool keep_threads = false;
+	std::string output;
+	std::vector<std::string> inputs;
+
+	for(int i = 0; i < argc; ++i) {
+		if(!strcmp(argv[i], "-t")) {
+			keep_threads = true;
+		} else if(!strcmp(argv[i], "-o") && i + 1 < argc) {
+			output = argv[++i];
+		} else {
+			inputs.push_back(argv[i]);
+		}
+	}
+
+	if(output.empty() || inputs.empty()) {
+		usage();
+		return 1;
+	}
+
+	profile_t profile;
+	if(!load(inputs, keep_threads, profile)) {
+		return 1;
+	}
+
+	std::ofstream stream(output, std::ios::binary);
+	ProfileWriter writer(stream);
+
+	bool ok = writer.WriteHeader();
+	for(const auto &section : profile) {
+		ok &= writer.WriteHistogram(section.first.first, section.first.second, *section.second);
+	}
+
+	if(!ok) {
+		fprintf(stderr, "Failed to write %s\n", output.c_str());
+		return 1;
+	}
+
+	return 0;
+}
+
+static int top(int argc, char **argv)
+{
+	size_t count = 20;
+	std::string only;
+	std::vector<std::string> inputs;
+
+	for(int i = 0; i < argc; ++i) {
+		if(!strcmp(argv[i], "-n") && i + 1 < argc) {
+			count = strtoull(argv[++i], nullptr, 0);
+		} else if(!strcmp(argv[i], "-H") && i + 1 < argc) {
+			only = argv[++i];
+		} else {
+			inputs.push_back(argv[i]);
+		}
+	}
+
+	if(inputs.empty()) {
+		usage();
+		return 1;
+	}
+
+	profile_t profile;
+	if(!load(inputs, false, profile)) {
+		return 1;
+	}
+
+	for(const auto &section : profile) {
+		const std::string &name = section.first.first;
+		if(!only.empty() && name != only) {
+			continue;
+		}
+
+		std::vector<std::pair<uint64_t, uint64_t>> entries;
+		section.second->for_each([&entries](uint64_t key, uint64_t value) {
+			entries.push_back({value, key});
+		});
+
+		size_t shown = std::min(count, entries.size());
+		std::partial_sort(entries.begin(), entries.begin() + shown, entries.end(), std::greater<std::pair<uint64_t, uint64_t>>());
+
+		uint64_t total = section.second->get_total();
+		printf("%s: %zu entries, total %lu\n", name.c_str(), entries.size(), total);
+		for(size_t i = 0; i < shown; ++i) {
+			if(name == "opcode-pair") {
+				printf("  %7lu %8lu %16lu %6.2f%%\n", entries[i].second >> 16, entries[i].second & 0xffff, entries[i].first, 100.0 * entries[i].first / total);
+			} else {
+				printf("  %16lx %16lu %6.2f%%\n", entries[i].second, entries[i].first, 100.0 * entries[i].first / total);
+			}
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 2) {
+		usage();
+		return 1;
+	}
+
+	if(!strcmp(argv[1], "merge")) {
+		return merge(argc - 2, argv + 2);
+	} else if(!strcmp(argv[1], "top")) {
+		return top(argc - 2, argv + 2);
+	}
+
+	usage();
+	return 1;
+}
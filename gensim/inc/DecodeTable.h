@@ -0,0 +1,119 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   DecodeTable.h
+ *
+ * Flattens a decode tree into the lookup tables used by table-driven
+ * decoders (see gensim/gensim_decode_table.h in archsim for the driver and
+ * the encoding of actions).
+ */
+
+#ifndef _DECODETABLE_H
+#define _DECODETABLE_H
+
+#include "DecodeTree.h"
+#include "Util.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gensim
+{
+	namespace generator
+	{
+
+		class DecodeTable
+		{
+		public:
+			struct Group {
+				uint8_t shift;
+				uint8_t width;
+				bool sparse;
+				uint32_t base;
+				uint32_t count;
+				uint32_t next;
+			};
+
+			/*
+			 * Fields of up to max_direct_bits bits are decoded with a direct
+			 * lookup table, unless the table would be mostly empty, in which
+			 * case the field's values are binary searched instead.
+			 */
+			DecodeTable(const DecodeNode &root, uint32_t instruction_bits, unsigned max_direct_bits);
+
+			const std::vector<Group> &GetGroups() const
+			{
+				return groups_;
+			}
+			const std::vector<uint32_t> &GetActions() const
+			{
+				return actions_;
+			}
+			const std::vector<uint32_t> &GetValues() const
+			{
+				return values_;
+			}
+			const std::vector<const isa::InstructionDescription *> &GetLeaves() const
+			{
+				return leaves_;
+			}
+			uint32_t GetRoot() const
+			{
+				return root_;
+			}
+			unsigned GetMaxDepth() const
+			{
+				return max_depth_;
+			}
+
+			// The index of the leaf for the given instruction, or -1 if it is unreachable
+			int32_t GetLeafIndex(const isa::InstructionDescription *insn) const
+			{
+				auto leaf = leaf_indices_.find(insn);
+				return leaf == leaf_indices_.end() ? -1 : leaf->second;
+			}
+
+			// The smallest unsigned type which can hold every action in the table
+			std::string GetActionType() const;
+
+			// The size of the emitted tables, in bytes
+			size_t GetSize() const;
+
+			// Emit the tables as static arrays named prefix_groups, prefix_actions and prefix_values
+			void EmitTables(util::cppformatstream &str, const std::string &prefix) const;
+
+			// Emit a call to the decode driver, which evaluates to the matching leaf index (or -1)
+			std::string EmitLookup(const std::string &prefix, const std::string &instr) const;
+
+			// Decode an instruction with the flattened tables, in the same way as the driver
+			int32_t Lookup(uint32_t instr) const;
+
+		private:
+			struct PendingGroup {
+				Group group;
+				std::vector<std::pair<uint32_t, uint32_t>> entries;
+			};
+
+			uint32_t Build(const DecodeNode &node);
+			unsigned ComputeDepth(uint32_t action, std::map<uint32_t, unsigned> &depths) const;
+
+			uint32_t instruction_bits_;
+			unsigned max_direct_bits_;
+
+			std::map<const DecodeNode *, uint32_t> node_actions_;
+			std::map<const isa::InstructionDescription *, uint32_t> leaf_indices_;
+			std::vector<PendingGroup> pending_;
+
+			std::vector<Group> groups_;
+			std::vector<uint32_t> actions_;
+			std::vector<uint32_t> values_;
+			std::vector<const isa::InstructionDescription *> leaves_;
+			uint32_t root_;
+			unsigned max_depth_;
+		};
+
+	}  // namespace generator
+}  // namespace gensim
+
+#endif /* _DECODETABLE_H */
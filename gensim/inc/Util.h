@@ -96,6 +96,9 @@ namespace gensim
 			static uint8_t Verbose_Level;
 			static std::set<std::string> GenC_Options;
 
+			// The number of threads to use for optimisation and generation
+			static unsigned Jobs;
+
 			static uint32_t parse_binary(std::string str);
 			static std::string FormatBinary(uint32_t x, int width);
 			static std::string StrDup(std::string todup, uint32_t n);
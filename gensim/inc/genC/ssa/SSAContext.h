@@ -95,6 +95,9 @@ namespace gensim
 
 				SSAValueNamespace &GetValueNamespace()
 				{
+					if(action_vns_ != nullptr) {
+						return *action_vns_;
+					}
 					return vns_;
 				}
 
@@ -123,10 +126,27 @@ namespace gensim
 					test_optimise_ = o;
 				}
 
+				unsigned GetOptimiseThreads() const
+				{
+					return optimise_threads_;
+				}
+
+				void SetOptimiseThreads(unsigned threads)
+				{
+					optimise_threads_ = threads;
+				}
+
 
 				void Optimise();
 			private:
 				void Optimise(SSAFormAction* action);
+				struct OptimiseSchedule;
+				void OptimiseWorker(OptimiseSchedule &schedule);
+
+				// While an action is being optimised, new values are named from
+				// a namespace belonging to that action, so that names do not
+				// depend on the order in which actions are optimised
+				static thread_local SSAValueNamespace *action_vns_;
 
 				const gensim::arch::ArchDescription& arch_;
 				const gensim::isa::ISADescription& isa_;
@@ -136,6 +156,7 @@ namespace gensim
 				std::shared_ptr<SSATypeManager> type_manager_;
 				bool parallel_optimise_;
 				bool test_optimise_;
+				unsigned optimise_threads_;
 			};
 		}
 	}
@@ -13,6 +13,7 @@
 #include <vector>
 #include <set>
 #include <functional>
+#include <mutex>
 
 namespace gensim
 {
@@ -60,9 +61,17 @@ namespace gensim
 				}
 
 				virtual void Destroy();
+
+				// Call sites in other actions may be created and removed while
+				// those actions are optimised in parallel, so uses of an action
+				// are tracked under a lock
+				void AddUse(SSAValue *user) override;
+				void RemoveUse(SSAValue *user) override;
+
 			private:
 				SSAActionPrototype prototype_;
 				const SSAType _type;
+				std::mutex uses_lock_;
 			};
 
 			/**
@@ -153,6 +162,13 @@ namespace gensim
 				// Check that all paths through this action have a return statement
 				bool DoCheckReturn() const;
 
+				/**
+				 * Computes any values which statements and blocks in this action
+				 * would otherwise calculate lazily, so that the action can then be
+				 * read from several threads at once.
+				 */
+				void CacheDerivedState() const;
+
 				std::string ToString() const override;
 
 			private:
@@ -44,8 +44,8 @@ namespace gensim
 				}
 
 				const use_list_t &GetUses() const;
-				void AddUse(SSAValue *user);
-				void RemoveUse(SSAValue *user);
+				virtual void AddUse(SSAValue *user);
+				virtual void RemoveUse(SSAValue *user);
 				bool HasDynamicUses() const;
 
 				/**
@@ -15,7 +15,7 @@ namespace gensim
 			public:
 				typedef uint64_t value_name_t;
 
-				SSAValueNamespace() : _next_name(0) {}
+				SSAValueNamespace(value_name_t first_name = 0) : _next_name(first_name) {}
 
 				value_name_t GetName()
 				{
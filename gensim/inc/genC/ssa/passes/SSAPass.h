@@ -12,6 +12,9 @@
 
 #include "ComponentManager.h"
 
+#include <atomic>
+#include <mutex>
+#include <ostream>
 #include <vector>
 
 namespace gensim
@@ -24,6 +27,19 @@ namespace gensim
 			class SSAFormAction;
 			class SSAPass;
 
+			/**
+			 * Cumulative statistics for one pass, across all actions and all
+			 * threads. Times include any passes run by the pass itself.
+			 */
+			struct SSAPassStatistics {
+				SSAPassStatistics(const std::string &name) : Name(name), Runs(0), Changes(0), Nanoseconds(0) {}
+
+				const std::string Name;
+				std::atomic<uint64_t> Runs;
+				std::atomic<uint64_t> Changes;
+				std::atomic<uint64_t> Nanoseconds;
+			};
+
 			class SSAPassManager
 			{
 			public:
@@ -45,8 +61,10 @@ namespace gensim
 
 			private:
 				void RunDebugPasses(SSAFormAction &action);
+				bool RunPass(size_t index, SSAFormAction &action);
 
 				std::vector<const SSAPass*> passes_;
+				std::vector<SSAPassStatistics*> pass_statistics_;
 				std::vector<const SSAPass*> debug_passes_;
 
 				bool multirun_each_;
@@ -67,13 +85,19 @@ namespace gensim
 			public:
 				static const SSAPass *Get(const std::string &passname);
 
+				// Returns null if the pass was not created by the pass DB
+				static SSAPassStatistics *GetStatistics(const SSAPass *pass);
+				static void PrintStatistics(std::ostream &str);
+
 			private:
 				static SSAPassDB &GetSingleton();
 
 				SSAPass *GetPass(const std::string &passname);
 				std::map<std::string, SSAPass*> passes_;
+				std::map<const SSAPass*, SSAPassStatistics*> statistics_;
 
 				static SSAPassDB *singleton_;
+				static std::mutex lock_;
 			};
 		}
 	}
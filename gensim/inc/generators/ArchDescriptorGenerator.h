@@ -17,6 +17,10 @@ namespace gensim
 			ArchDescriptorGenerator(GenerationManager &manager);
 
 			bool Generate() const override;
+			bool CanGenerateConcurrently() const override
+			{
+				return true;
+			}
 			std::string GetFunction() const override;
 			const std::vector<std::string> GetSources() const override;
 
@@ -33,6 +33,10 @@ namespace gensim
 			JitGenerator(GenerationManager &man);
 
 			bool Generate() const override;
+			bool CanGenerateConcurrently() const override
+			{
+				return true;
+			}
 			const std::vector<std::string> GetSources() const override
 			{
 				return sources;
@@ -40,6 +40,10 @@ namespace gensim
 			}
 			virtual void Setup(GenerationSetupManager &Setup);
 			bool Generate() const;
+			bool CanGenerateConcurrently() const override
+			{
+				return true;
+			}
 
 			std::map<const isa::ISADescription *, DecodeNode *> decode_trees;
 
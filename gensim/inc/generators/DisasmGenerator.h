@@ -39,6 +39,10 @@ namespace gensim
 				return GenerationManager::FnDisasm;
 			}
 			bool Generate() const;
+			bool CanGenerateConcurrently() const override
+			{
+				return true;
+			}
 
 			const std::vector<std::string> GetSources() const;
 
@@ -16,6 +16,10 @@ namespace gensim
 			EEGenerator(GenerationManager &manager, const std::string &name) : GenerationComponent(manager, "ExecutionEngine"), name_(name) {}
 
 			bool Generate() const override;
+			bool CanGenerateConcurrently() const override
+			{
+				return true;
+			}
 			std::string GetFunction() const override;
 			const virtual std::vector<std::string> GetSources() const override;
 
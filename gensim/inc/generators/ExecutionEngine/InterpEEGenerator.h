@@ -6,6 +6,8 @@
 #include "genC/ssa/SSAFormAction.h"
 #include "generators/ExecutionEngine/EEGenerator.h"
 
+#include <vector>
+
 namespace gensim
 {
 	namespace generator
@@ -26,12 +28,24 @@ namespace gensim
 
 			~InterpEEGenerator();
 		private:
+			// An entry in the threaded interpreter's table of handlers. Handlers
+			// with a Second instruction are superinstructions, which execute
+			// both instructions of a frequent pair in one dispatch.
+			struct ThreadedHandler {
+				const isa::InstructionDescription *First;
+				const isa::InstructionDescription *Second;
+			};
+			typedef std::vector<ThreadedHandler> handler_table_t;
+
+			handler_table_t BuildHandlerTable() const;
+
 			bool GenerateBlockExecutor(util::cppformatstream &str) const;
+			bool GenerateThreadedExecutor(util::cppformatstream &str, const handler_table_t &handlers) const;
+			bool GenerateResolveHandler(util::cppformatstream &str, const handler_table_t &handlers) const;
 
-			bool GenerateDecodeInstruction(util::cppformatstream &str) const;
 			bool GenerateHelperFunctions(util::cppformatstream &str) const;
 			bool GenerateHelperFunction(util::cppformatstream &str, const isa::ISADescription &isa, const gensim::genc::ssa::SSAFormAction*) const;
-			bool GenerateStepInstruction(util::cppformatstream &str) const;
+			bool GenerateStepInstruction(util::cppformatstream &str, const handler_table_t &handlers) const;
 			bool GenerateStepInstructionISA(util::cppformatstream &str, isa::ISADescription &isa) const;
 			bool RegisterStepInstruction(isa::InstructionDescription &insn) const;
 
@@ -4,7 +4,9 @@
 #define _FUNCTIONALDECODEGENERATOR_H
 
 #include "DecodeGenerator.h"
+#include "DecodeTable.h"
 
+#include <functional>
 #include <vector>
 
 namespace gensim
@@ -17,14 +19,24 @@ namespace gensim
 		public:
 			FunctionalDecodeGenerator(GenerationManager &man);
 
+			bool Generate() const override;
+
 		private:
 			FunctionalDecodeGenerator(const FunctionalDecodeGenerator &orig);
 
+			typedef std::function<bool(const isa::InstructionDescription &insn, util::cppformatstream &stream)> LeafEmitter;
+
+			bool UseDecodeTable(const isa::ISADescription &isa) const;
+			DecodeTable BuildDecodeTable(const isa::ISADescription &isa) const;
+			bool EmitDecodeSwitch(const DecodeNode &tree, util::cppformatstream &stream, const LeafEmitter &emit_leaf) const;
+			bool GenerateDecodeBenchmark(util::cppformatstream &stream) const;
+
 			virtual bool GenerateDecodeHeader(util::cppformatstream &str) const;
 			virtual bool GenerateDecodeSource(util::cppformatstream &str) const;
 			virtual bool GenerateDecodeTree(const isa::ISADescription &isa, DecodeNode &tree, util::cppformatstream &stream, int &i) const;
 
 			virtual bool GenerateDecodeLeaf(const isa::ISADescription &isa, const isa::InstructionDescription &insn, util::cppformatstream &stream) const;
+			virtual bool GenerateDecodeTable(const isa::ISADescription &isa, const DecodeTable &table, util::cppformatstream &stream) const;
 			virtual bool GenerateFormatDecoder(const isa::ISADescription &isa, const isa::InstructionFormatDescription &format, util::cppformatstream &stream) const;
 
 			virtual bool EmitExtraClassMembers(util::cppformatstream &stream) const;
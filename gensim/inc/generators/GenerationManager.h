@@ -10,6 +10,7 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <mutex>
 
 #include "Util.h"
 
@@ -172,10 +173,12 @@ namespace gensim
 
 			void AddModuleEntry(const ModuleEntry &entry)
 			{
+				std::lock_guard<std::mutex> lock(entries_lock_);
 				module_entries_.push_back(entry);
 			}
 			void AddFunctionEntry(const FunctionEntry &entry)
 			{
+				std::lock_guard<std::mutex> lock(entries_lock_);
 				if(function_entries_.count(entry.FormatPrototype())) {
 					return;
 				}
@@ -214,6 +217,9 @@ namespace gensim
 			arch::ArchDescription &arch;
 			std::string target;
 
+			bool GenerateConcurrently(const std::vector<GenerationComponent *> &components);
+
+			std::mutex entries_lock_;
 			std::vector<ModuleEntry> module_entries_;
 			std::map<std::string, FunctionEntry> function_entries_;
 
@@ -265,6 +271,16 @@ namespace gensim
 			friend class GenerationManager;
 			virtual bool Generate() const = 0;
 
+			/*
+			 * Returns true if this component only reads the architecture and
+			 * the properties of other components while generating, so that it
+			 * can be run at the same time as other such components.
+			 */
+			virtual bool CanGenerateConcurrently() const
+			{
+				return false;
+			}
+
 			virtual void Reset() {}
 
 			virtual void Setup(GenerationSetupManager &Setup) {}
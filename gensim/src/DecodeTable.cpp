@@ -0,0 +1,206 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "DecodeTable.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace gensim
+{
+	namespace generator
+	{
+
+		DecodeTable::DecodeTable(const DecodeNode &root, uint32_t instruction_bits, unsigned max_direct_bits) : instruction_bits_(instruction_bits), max_direct_bits_(max_direct_bits), root_(0), max_depth_(0)
+		{
+			// Group 0 is never referenced, since action 0 means 'no match'
+			pending_.push_back(PendingGroup());
+			pending_.front().group = Group { 0, 0, false, 0, 0, 0 };
+
+			root_ = Build(root);
+
+			// Lay out the sparse groups first, so that their entries line up
+			// with the value table, and then the direct tables after them.
+			for(auto &pending : pending_) {
+				if(!pending.group.sparse) continue;
+
+				pending.group.base = actions_.size();
+				pending.group.count = pending.entries.size();
+				for(const auto &entry : pending.entries) {
+					values_.push_back(entry.first);
+					actions_.push_back(entry.second);
+				}
+			}
+
+			for(auto &pending : pending_) {
+				if(pending.group.sparse || &pending == &pending_.front()) continue;
+
+				pending.group.base = actions_.size();
+				pending.group.count = 1u << pending.group.width;
+				actions_.resize(actions_.size() + pending.group.count, 0);
+				for(const auto &entry : pending.entries) {
+					actions_[pending.group.base + entry.first] = entry.second;
+				}
+			}
+
+			for(const auto &pending : pending_) {
+				groups_.push_back(pending.group);
+			}
+			pending_.clear();
+			node_actions_.clear();
+
+			std::map<uint32_t, unsigned> depths;
+			max_depth_ = std::max(1u, ComputeDepth(root_, depths));
+		}
+
+		uint32_t DecodeTable::Build(const DecodeNode &node)
+		{
+			auto existing = node_actions_.find(&node);
+			if(existing != node_actions_.end()) return existing->second;
+
+			uint32_t action = 0;
+			if(node.target) {
+				auto leaf = leaf_indices_.find(node.target);
+				if(leaf == leaf_indices_.end()) {
+					leaf = leaf_indices_.insert({node.target, leaves_.size()}).first;
+					leaves_.push_back(node.target);
+				}
+				action = (leaf->second << 1) | 1;
+			} else {
+				// The switch-based decoder tries transitions longest first, and
+				// then the unconstrained transition. Build the chain backwards so
+				// that each group falls through to the next one to try.
+				std::map<uint8_t, std::vector<const DecodeTransition *>> transitions_by_length;
+				for(const auto &transition : node.transitions) {
+					transitions_by_length[transition.first].push_back(&transition.second);
+				}
+
+				if(node.unconstrained_transition) {
+					action = Build(*node.unconstrained_transition->target);
+				}
+
+				for(const auto &length : transitions_by_length) {
+					PendingGroup pending;
+					pending.group.width = length.first;
+					pending.group.shift = instruction_bits_ - node.start_ptr - length.first;
+					pending.group.next = action;
+					pending.group.base = 0;
+					pending.group.count = 0;
+
+					for(auto transition : length.second) {
+						pending.entries.push_back({transition->value, Build(*transition->target)});
+					}
+					std::sort(pending.entries.begin(), pending.entries.end());
+
+					// Don't build direct tables which would be mostly empty
+					uint64_t table_size = 1ull << pending.group.width;
+					pending.group.sparse = pending.group.width > max_direct_bits_ || table_size > std::max<uint64_t>(16, 4 * pending.entries.size());
+
+					pending_.push_back(pending);
+					action = (pending_.size() - 1) << 1;
+				}
+			}
+
+			node_actions_[&node] = action;
+			return action;
+		}
+
+		unsigned DecodeTable::ComputeDepth(uint32_t action, std::map<uint32_t, unsigned> &depths) const
+		{
+			if(action == 0 || (action & 1)) return 0;
+
+			auto existing = depths.find(action);
+			if(existing != depths.end()) return existing->second;
+
+			// A group stays on the stack while its entries are being tried, but
+			// has been popped by the time its alternative is taken.
+			const Group &group = groups_.at(action >> 1);
+			unsigned depth = 1;
+			for(uint32_t i = 0; i < group.count; ++i) {
+				depth = std::max(depth, 1 + ComputeDepth(actions_.at(group.base + i), depths));
+			}
+			depth = std::max(depth, ComputeDepth(group.next, depths));
+
+			depths[action] = depth;
+			return depth;
+		}
+
+		std::string DecodeTable::GetActionType() const
+		{
+			uint32_t max_action = std::max<uint32_t>(groups_.size() << 1, (leaves_.size() << 1) | 1);
+			return max_action <= 0xffff ? "uint16_t" : "uint32_t";
+		}
+
+		size_t DecodeTable::GetSize() const
+		{
+			size_t action_size = GetActionType() == "uint16_t" ? 2 : 4;
+			size_t group_size = (8 + action_size + 3 + 3) & ~(size_t)3;
+			return groups_.size() * group_size + actions_.size() * action_size + values_.size() * 4;
+		}
+
+		void DecodeTable::EmitTables(util::cppformatstream &str, const std::string &prefix) const
+		{
+			std::string type = GetActionType();
+
+			str << "static const gensim::decode_table::Group<" << type << "> " << prefix << "_groups[] = {\n";
+			for(const auto &group : groups_) {
+				str << "{ " << group.base << ", " << group.count << ", " << group.next << ", " << (uint32_t)group.shift << ", " << (uint32_t)group.width << ", " << group.sparse << " },\n";
+			}
+			str << "};\n";
+
+			// Avoid emitting zero-length arrays for trivial trees
+			str << "static const " << type << " " << prefix << "_actions[] = {";
+			for(size_t i = 0; i < actions_.size(); ++i) {
+				if(i % 16 == 0) str << "\n";
+				str << actions_[i] << ", ";
+			}
+			if(actions_.empty()) str << "0";
+			str << "\n};\n";
+
+			str << "static const uint32_t " << prefix << "_values[] = {";
+			for(size_t i = 0; i < values_.size(); ++i) {
+				if(i % 8 == 0) str << "\n";
+				str << values_[i] << "u, ";
+			}
+			if(values_.empty()) str << "0";
+			str << "\n};\n";
+		}
+
+		std::string DecodeTable::EmitLookup(const std::string &prefix, const std::string &instr) const
+		{
+			std::stringstream str;
+			str << "gensim::decode_table::Lookup<" << max_depth_ << ">(" << prefix << "_groups, " << prefix << "_actions, " << prefix << "_values, (" << GetActionType() << ")" << root_ << ", " << instr << ")";
+			return str.str();
+		}
+
+		int32_t DecodeTable::Lookup(uint32_t instr) const
+		{
+			std::vector<uint32_t> stack;
+			uint32_t action = root_;
+
+			while(true) {
+				if(action & 1) return action >> 1;
+
+				if(action == 0) {
+					if(stack.empty()) return -1;
+					action = stack.back();
+					stack.pop_back();
+					continue;
+				}
+
+				const Group &group = groups_.at(action >> 1);
+				stack.push_back(group.next);
+				uint32_t field = (uint32_t)(((uint64_t)instr >> group.shift) & ((1ull << group.width) - 1));
+
+				if(!group.sparse) {
+					action = actions_.at(group.base + field);
+					continue;
+				}
+
+				auto begin = values_.begin() + group.base, end = begin + group.count;
+				auto value = std::lower_bound(begin, end, field);
+				action = (value != end && *value == field) ? actions_.at(value - values_.begin()) : 0;
+			}
+		}
+
+	}  // namespace generator
+}  // namespace gensim
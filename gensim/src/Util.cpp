@@ -18,6 +18,7 @@ namespace gensim
 
 		uint8_t Util::Verbose_Level = 0;
 		std::set<std::string> Util::GenC_Options;
+		unsigned Util::Jobs = 1;
 
 		const expression *expression::Parse(void *ptree)
 		{
@@ -1,8 +1,10 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 
 #include "arch/ArchDescription.h"
+#include "genC/ssa/SSABlock.h"
 #include "genC/ssa/SSAContext.h"
 #include "genC/ssa/SSAFormAction.h"
+#include "genC/ssa/statement/SSACallStatement.h"
 #include "genC/ssa/statement/SSAStatement.h"
 #include "genC/ssa/passes/SSAPass.h"
 
@@ -12,8 +14,12 @@
 #include "genC/ssa/printers/SSAActionPrinter.h"
 #include "genC/ir/IRAttributes.h"
 
-#include "util/WorkQueue.h"
-#include "util/ParallelWorker.h"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #include <stdio.h>
 
@@ -31,7 +37,7 @@ SSAContext::SSAContext(const gensim::isa::ISADescription& isa, const gensim::arc
  * Constructs a new SSAContext, and associates it with the given architecture description.
  * @param arch The architecture description to associate the SSA context with.
  */
-SSAContext::SSAContext(const gensim::isa::ISADescription& isa, const gensim::arch::ArchDescription& arch, std::shared_ptr<SSATypeManager> type_manager) : arch_(arch), isa_(isa), parallel_optimise_(false), test_optimise_(false), type_manager_(type_manager)
+SSAContext::SSAContext(const gensim::isa::ISADescription& isa, const gensim::arch::ArchDescription& arch, std::shared_ptr<SSATypeManager> type_manager) : arch_(arch), isa_(isa), parallel_optimise_(false), test_optimise_(false), type_manager_(type_manager), optimise_threads_(std::max(1u, std::thread::hardware_concurrency()))
 {
 #ifdef MULTITHREAD
 	SetParallelOptimise(true);
@@ -111,12 +117,171 @@ static bool OptimiseAndTestAction(SSAFormAction *action, SSAPass *pass)
 	return changed;
 }
 
+thread_local SSAValueNamespace *SSAContext::action_vns_ = nullptr;
+
+// Each action names the values it creates from its own range, which is large
+// enough that it cannot be exhausted
+static const SSAValueNamespace::value_name_t kActionNamespaceSize = 1ULL << 32;
+
+/*
+ * Actions are optimised callees first, so that each call site is inlined from
+ * an already optimised body. An action is only read by its callers once its
+ * own optimisation has finished, so independent actions can be optimised on
+ * different threads, and the result does not depend on the number of threads.
+ */
+struct SSAContext::OptimiseSchedule {
+	std::vector<SSAFormAction *> actions;
+	std::vector<SSAValueNamespace> namespaces;
+
+	// For each action, the actions which call it and the number of its
+	// callees which are still to be optimised
+	std::vector<std::vector<size_t>> callers;
+	std::vector<size_t> pending_callees;
+
+	std::vector<size_t> ready;
+	size_t remaining;
+
+	std::mutex lock;
+	std::condition_variable cond;
+	std::exception_ptr error;
+};
+
 void SSAContext::Optimise()
 {
+	OptimiseSchedule schedule;
+
+	std::map<const SSAActionBase *, size_t> indices;
 	for(auto action : Actions()) {
-		if(dynamic_cast<SSAFormAction*>(action.second)) {
-			Optimise((SSAFormAction*)action.second);
+		if(SSAFormAction *form_action = dynamic_cast<SSAFormAction*>(action.second)) {
+			indices[form_action] = schedule.actions.size();
+			schedule.actions.push_back(form_action);
+		}
+	}
+
+	size_t count = schedule.actions.size();
+	schedule.callers.resize(count);
+	schedule.pending_callees.resize(count);
+	schedule.remaining = count;
+
+	for(size_t i = 0; i < count; ++i) {
+		std::set<size_t> callees;
+		for(auto block : schedule.actions[i]->GetBlocks()) {
+			for(auto stmt : block->GetStatements()) {
+				auto call = dynamic_cast<SSACallStatement*>(stmt);
+				if(call == nullptr || call->Target() == nullptr || call->Target()->HasAttribute(ActionAttribute::NoInline)) {
+					continue;
+				}
+
+				auto callee = indices.find(call->Target());
+				if(callee != indices.end() && callee->second != i) {
+					callees.insert(callee->second);
+				}
+			}
+		}
+
+		for(auto callee : callees) {
+			schedule.callers[callee].push_back(i);
+		}
+		schedule.pending_callees[i] = callees.size();
+	}
+
+	// Check that the call graph can actually be scheduled. Recursive helpers
+	// cannot be inlined anyway, but fall back to optimising everything in
+	// order rather than deadlocking.
+	std::vector<size_t> pending = schedule.pending_callees;
+	std::vector<size_t> order;
+	for(size_t i = 0; i < count; ++i) {
+		if(pending[i] == 0) {
+			order.push_back(i);
+		}
+	}
+	for(size_t i = 0; i < order.size(); ++i) {
+		for(auto caller : schedule.callers[order[i]]) {
+			if(--pending[caller] == 0) {
+				order.push_back(caller);
+			}
+		}
+	}
+
+	unsigned threads = ShouldParallelOptimise() ? optimise_threads_ : 1;
+	if(order.size() != count) {
+		fprintf(stderr, "[SSA] Recursive calls between actions, optimising sequentially\n");
+		for(size_t i = 0; i < count; ++i) {
+			schedule.callers[i].clear();
+			schedule.pending_callees[i] = 0;
+		}
+		threads = 1;
+	}
+
+	for(size_t i = count; i > 0; --i) {
+		if(schedule.pending_callees[i - 1] == 0) {
+			schedule.ready.push_back(i - 1);
+		}
+	}
+
+	SSAValueNamespace::value_name_t base = vns_.GetName();
+	for(size_t i = 0; i < count; ++i) {
+		schedule.namespaces.push_back(SSAValueNamespace(base + (i + 1) * kActionNamespaceSize));
+	}
+
+	threads = std::min<size_t>(threads, count);
+	if(threads <= 1) {
+		OptimiseWorker(schedule);
+	} else {
+		std::vector<std::thread> workers;
+		for(unsigned i = 0; i < threads; ++i) {
+			workers.push_back(std::thread(&SSAContext::OptimiseWorker, this, std::ref(schedule)));
+		}
+		for(auto &worker : workers) {
+			worker.join();
+		}
+	}
+
+	vns_ = SSAValueNamespace(base + (count + 1) * kActionNamespaceSize);
+
+	if(schedule.error) {
+		std::rethrow_exception(schedule.error);
+	}
+}
+
+void SSAContext::OptimiseWorker(OptimiseSchedule& schedule)
+{
+	std::unique_lock<std::mutex> lock(schedule.lock);
+
+	while(true) {
+		schedule.cond.wait(lock, [&schedule]() {
+			return !schedule.ready.empty() || schedule.remaining == 0 || schedule.error;
+		});
+		if(schedule.ready.empty() || schedule.error) {
+			return;
+		}
+
+		size_t index = schedule.ready.back();
+		schedule.ready.pop_back();
+		lock.unlock();
+
+		SSAFormAction *action = schedule.actions[index];
+		try {
+			action_vns_ = &schedule.namespaces[index];
+			Optimise(action);
+			action->CacheDerivedState();
+			action_vns_ = nullptr;
+		} catch(...) {
+			action_vns_ = nullptr;
+			lock.lock();
+			schedule.error = std::current_exception();
+			schedule.cond.notify_all();
+			return;
+		}
+
+		lock.lock();
+		schedule.remaining--;
+		for(auto caller : schedule.callers[index]) {
+			if(--schedule.pending_callees[caller] == 0) {
+				schedule.ready.push_back(caller);
+			}
 		}
+		schedule.cond.notify_all();
 	}
 }
 
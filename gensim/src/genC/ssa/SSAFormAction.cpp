@@ -45,6 +45,18 @@ void SSAActionBase::Destroy()
 
 }
 
+void SSAActionBase::AddUse(SSAValue* user)
+{
+	std::lock_guard<std::mutex> lock(uses_lock_);
+	SSAValue::AddUse(user);
+}
+
+void SSAActionBase::RemoveUse(SSAValue* user)
+{
+	std::lock_guard<std::mutex> lock(uses_lock_);
+	SSAValue::RemoveUse(user);
+}
+
 
 SSAFormAction::SSAFormAction(SSAContext& context, const SSAActionPrototype &prototype)
 	: SSAActionBase(context, prototype),
@@ -426,6 +438,19 @@ bool SSAFormAction::DoCheckReturn() const
 	return true;
 }
 
+void SSAFormAction::CacheDerivedState() const
+{
+	for (const auto block : GetBlocks()) {
+		block->GetID();
+
+		for (const auto stmt : block->GetStatements()) {
+			if (const SSACastStatement *cast = dynamic_cast<const SSACastStatement *>(stmt)) {
+				cast->GetCastType();
+			}
+		}
+	}
+}
+
 std::string SSAFormAction::ToString() const
 {
 	printers::SSAActionPrinter action_printer(*this);
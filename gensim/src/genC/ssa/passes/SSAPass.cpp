@@ -5,6 +5,10 @@
 #include "genC/ssa/passes/SSAPass.h"
 #include "ComponentManager.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
 using namespace gensim::genc::ssa;
 
 SSAPassManager::SSAPassManager() : multirun_all_(true), multirun_each_(true)
@@ -16,6 +20,7 @@ SSAPassManager::SSAPassManager() : multirun_all_(true), multirun_each_(true)
 void SSAPassManager::AddPass(const SSAPass* pass)
 {
 	passes_.push_back(pass);
+	pass_statistics_.push_back(SSAPassDB::GetStatistics(pass));
 }
 
 bool SSAPassManager::Run(SSAContext& ctx)
@@ -36,15 +41,15 @@ bool SSAPassManager::Run(SSAFormAction &action)
 	bool anychanged = false;
 	do {
 		changed = false;
-		for(auto i : passes_) {
+		for(size_t i = 0; i < passes_.size(); ++i) {
 			RunDebugPasses(action);
 			if(multirun_each_) {
-				while(i->Run(action)) {
+				while(RunPass(i, action)) {
 					changed = true;
 					RunDebugPasses(action);
 				}
 			} else {
-				changed |= i->Run(action);
+				changed |= RunPass(i, action);
 				RunDebugPasses(action);
 			}
 		}
@@ -53,6 +58,26 @@ bool SSAPassManager::Run(SSAFormAction &action)
 	return anychanged;
 }
 
+bool SSAPassManager::RunPass(size_t index, SSAFormAction& action)
+{
+	SSAPassStatistics *stats = pass_statistics_.at(index);
+	if(stats == nullptr) {
+		return passes_.at(index)->Run(action);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	bool changed = passes_.at(index)->Run(action);
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	stats->Runs++;
+	if(changed) {
+		stats->Changes++;
+	}
+	stats->Nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+	return changed;
+}
+
 void SSAPassManager::RunDebugPasses(SSAFormAction& action)
 {
 	for(auto i : debug_passes_) {
@@ -71,12 +96,47 @@ SSAPass::~SSAPass()
 }
 
 SSAPassDB *SSAPassDB::singleton_ = nullptr;
+std::mutex SSAPassDB::lock_;
 
 const SSAPass* SSAPassDB::Get(const std::string& passname)
 {
+	std::lock_guard<std::mutex> lock(lock_);
 	return GetSingleton().GetPass(passname);
 }
 
+SSAPassStatistics* SSAPassDB::GetStatistics(const SSAPass* pass)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	auto &statistics = GetSingleton().statistics_;
+
+	auto it = statistics.find(pass);
+	if(it == statistics.end()) {
+		return nullptr;
+	}
+	return it->second;
+}
+
+void SSAPassDB::PrintStatistics(std::ostream& str)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+
+	std::vector<const SSAPassStatistics*> sorted;
+	for(auto i : GetSingleton().statistics_) {
+		if(i.second->Runs != 0) {
+			sorted.push_back(i.second);
+		}
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const SSAPassStatistics *a, const SSAPassStatistics *b) {
+		return a->Nanoseconds > b->Nanoseconds;
+	});
+
+	str << "SSA pass statistics (times include nested passes):" << std::endl;
+	str << std::left << std::setw(32) << "  Pass" << std::right << std::setw(12) << "Runs" << std::setw(12) << "Changes" << std::setw(12) << "Time (ms)" << std::endl;
+	for(auto stats : sorted) {
+		str << "  " << std::left << std::setw(30) << stats->Name << std::right << std::setw(12) << stats->Runs << std::setw(12) << stats->Changes << std::setw(12) << std::fixed << std::setprecision(1) << (stats->Nanoseconds / 1000000.0) << std::endl;
+	}
+}
+
 
 SSAPassDB& SSAPassDB::GetSingleton()
 {
@@ -89,7 +149,9 @@ SSAPassDB& SSAPassDB::GetSingleton()
 SSAPass* SSAPassDB::GetPass(const std::string& passname)
 {
 	if(passes_.count(passname) == 0) {
-		passes_[passname] = GetComponent<SSAPass>(passname);
+		SSAPass *pass = GetComponent<SSAPass>(passname);
+		passes_[passname] = pass;
+		statistics_[pass] = new SSAPassStatistics(passname);
 	}
 	return passes_.at(passname);
 }
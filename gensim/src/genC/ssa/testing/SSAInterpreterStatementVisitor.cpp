@@ -490,6 +490,11 @@ void SSAInterpreterStatementVisitor::VisitIntrinsicStatement(SSAIntrinsicStateme
 		case IntrinsicID::HaltCpu:
 			_vmstate.SetResult(Interpret_Halt);
 			break;
+		case IntrinsicID::WaitForInterrupt:
+		case IntrinsicID::WaitForEvent:
+		case IntrinsicID::SendEvent:
+			// Only hints, and there is nothing to wait for here
+			break;
 		default: {
 			std::ostringstream intrinsic;
 			stmt.PrettyPrint(intrinsic);
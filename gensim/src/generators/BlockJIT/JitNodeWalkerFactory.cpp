@@ -1039,6 +1039,15 @@ namespace gensim
 							// XXX TODO FIXME
 							output << "builder.trap();";
 							break;
+						case IntrinsicID::WaitForInterrupt:
+							output << "builder.call(IROperand::const32(0), IROperand::func((void*)cpuWaitForInterrupt));";
+							break;
+						case IntrinsicID::WaitForEvent:
+							output << "builder.call(IROperand::const32(0), IROperand::func((void*)cpuWaitForEvent));";
+							break;
+						case IntrinsicID::SendEvent:
+							output << "builder.call(IROperand::const32(0), IROperand::func((void*)cpuSendEvent));";
+							break;
 						case IntrinsicID::ProbeDevice:
 							output << "IRRegId " << Statement.GetName() << " = builder.alloc_reg(" << Statement.GetType().SizeInBytes() << ");\n";
 							output << "builder.probe_device(" << operand_for_node(*arg0) << ", IROperand::vreg(" << Statement.GetName() << "));";
@@ -745,6 +745,11 @@ namespace gensim
 						case IntrinsicID::HaltCpu:
 							output << "emitter.raise(emitter.const_u8(0));";
 							break;
+						case IntrinsicID::WaitForInterrupt:
+						case IntrinsicID::WaitForEvent:
+						case IntrinsicID::SendEvent:
+							// These are only hints, so it is always safe to ignore them
+							break;
 
 						case IntrinsicID::WriteDevice32:
 						case IntrinsicID::WriteDevice64:
@@ -625,6 +625,11 @@ namespace gensim
 						case IntrinsicID::HaltCpu:
 							output << "raise(constant_u8(0));";
 							break;
+						case IntrinsicID::WaitForInterrupt:
+						case IntrinsicID::WaitForEvent:
+						case IntrinsicID::SendEvent:
+							// These are only hints, so it is always safe to ignore them
+							break;
 						case IntrinsicID::WriteDevice32:
 						case IntrinsicID::WriteDevice64:
 							output << "if (emit_trace_calls_) {";
@@ -8,6 +8,13 @@
 #include "genC/ssa/SSASymbol.h"
 #include "genC/ssa/SSATypeFormatter.h"
 
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+COMPONENT_OPTION(ee_interp, Superinstructions, "", "File listing pairs of instructions (one 'first second' pair per line) to fuse into superinstructions, such as the Instruction Pair Profile printed by archsim --profile")
+
 using namespace gensim::generator;
 
 void InterpEEGenerator::Setup(GenerationSetupManager& Setup)
@@ -45,10 +52,10 @@ bool InterpEEGenerator::GenerateHeader(util::cppformatstream &str) const
 	    "public:"
 	    "   virtual archsim::core::execution::ExecutionResult StepBlock(archsim::core::execution::InterpreterExecutionEngineThreadContext *thread);"
 	    "	using decode_t = gensim::" << Manager.GetArch().Name << "::Decode;"
+	    "	using handler_t = archsim::core::execution::ExecutionResult (*)(archsim::core::thread::ThreadInstance *thread, decode_t &inst);"
 	    "private:"
 	    "	gensim::DecodeContext *decode_context_;"
-	    "  uint32_t DecodeInstruction(archsim::core::execution::InterpreterExecutionEngineThreadContext *thread_ctx, decode_t *&inst);"
-	    "  archsim::core::execution::ExecutionResult StepInstruction(archsim::core::thread::ThreadInstance *thread, decode_t &inst);"
+	    "  static void *ResolveHandler(uint32_t mode, const gensim::BaseDecode &inst, const gensim::BaseDecode *next);"
 
 	    "};"
 	    ""
@@ -75,21 +82,20 @@ bool InterpEEGenerator::GenerateSource(util::cppformatstream &str) const
 	    "#include <gensim/gensim_processor_api.h>\n"
 	    "#include <abi/devices/Device.h>\n"
 	    "#include <gensim/gensim_decode_context.h>\n"
+	    "#include <interpret/PredecodeCache.h>\n"
 	    "#include <cmath>\n"
 	    ;
 
 	str << "using namespace gensim::" << Manager.GetArch().Name << ";";
 
-	GenerateDecodeInstruction(str);
+	GenerateHelperFunctions(str);
+	GenerateStepInstruction(str, BuildHandlerTable());
 
 	str << "archsim::core::execution::ExecutionResult Interpreter::StepBlock(archsim::core::execution::InterpreterExecutionEngineThreadContext *thread_ctx) { ";
 	str << "auto thread = thread_ctx->GetThread();";
 	GenerateBlockExecutor(str);
 	str << "}";
 
-	GenerateHelperFunctions(str);
-	GenerateStepInstruction(str);
-
 	GenerateBehavioursDescriptors(str);
 
 	return true;
@@ -147,58 +153,219 @@ bool InterpEEGenerator::GenerateHelperFunction(util::cppformatstream& str, const
 	return true;
 }
 
-bool InterpEEGenerator::GenerateDecodeInstruction(util::cppformatstream& str) const
+bool InterpEEGenerator::GenerateBlockExecutor(util::cppformatstream& str) const
 {
-	str << "uint32_t Interpreter::DecodeInstruction(archsim::core::execution::InterpreterExecutionEngineThreadContext *thread_ctx, Interpreter::decode_t *&inst) {";
-	str << "  auto thread = thread_ctx->GetThread();";
-	str << "  gensim::" << Manager.GetArch().Name << "::ArchInterface interface(thread);";
-	str << "  gensim::BaseDecode *instr;";
-	str << "  auto result = thread_ctx->GetDC()->DecodeSync(thread->GetFetchMI(), archsim::Address(interface.read_pc()), thread->GetModeID(), instr);";
-	str << "  inst = (Interpreter::decode_t*)instr;";
-	str << "  return result;";
-	str << "}";
+	// Blocks are decoded once and then executed straight out of the
+	// predecode cache. Messages are only checked between blocks, by the
+	// execution engine.
+	str <<
+	    "gensim::" << Manager.GetArch().Name << "::ArchInterface interface(thread);"
+	    "archsim::Address pc (interface.read_pc());"
+	    "uint32_t mode = thread->GetModeID();"
+
+	    "auto &cache = thread_ctx->GetPredecodeCache();"
+	    "archsim::interpret::PredecodedBlock *block = cache.Lookup(pc, mode);"
+	    "if(block == nullptr) {"
+	    "  uint32_t dcode_exception = cache.DecodeBlock(thread, *thread_ctx->GetDC(), pc, mode, ResolveHandler, block);"
+	    "  if(dcode_exception) { thread->TakeMemoryException(thread->GetFetchMI(), thread->GetPC()); return archsim::core::execution::ExecutionResult::Exception; }"
+	    "}"
+
+	    "return SelectBlockExecutor()(thread, block, nullptr);";
 
 	return true;
 }
 
+InterpEEGenerator::handler_table_t InterpEEGenerator::BuildHandlerTable() const
+{
+	// The first handler is for unknown instructions
+	handler_table_t handlers { { nullptr, nullptr } };
 
-bool InterpEEGenerator::GenerateBlockExecutor(util::cppformatstream& str) const
+	for(auto isa : Manager.GetArch().ISAs) {
+		for(auto insn : isa->Instructions) {
+			handlers.push_back({ insn.second, nullptr });
+		}
+	}
+
+	std::string filename = GetProperty("Superinstructions");
+	if(filename.empty()) {
+		return handlers;
+	}
+
+	std::ifstream file (filename);
+	if(!file) {
+		throw std::logic_error("Could not open superinstruction list " + filename);
+	}
+
+	std::set<std::pair<const isa::InstructionDescription *, const isa::InstructionDescription *>> seen;
+	std::string line;
+	while(std::getline(file, line)) {
+		std::istringstream line_str (line);
+		std::string first, second;
+		if(!(line_str >> first >> second) || first[0] == '#') {
+			continue;
+		}
+
+		// Instruction names are only unique within an ISA, so fuse the pair
+		// in every ISA which has both
+		for(auto isa : Manager.GetArch().ISAs) {
+			if(!isa->Instructions.count(first) || !isa->Instructions.count(second)) {
+				continue;
+			}
+
+			auto pair = std::make_pair(isa->Instructions.at(first), isa->Instructions.at(second));
+			if(seen.insert(pair).second) {
+				handlers.push_back({ pair.first, pair.second });
+			}
+		}
+	}
+
+	return handlers;
+}
+
+static std::string HandlerLabel(const gensim::isa::InstructionDescription *insn)
+{
+	return "L_" + insn->ISA.ISAName + "_" + insn->Name;
+}
+
+static void GenerateThreadedStep(gensim::util::cppformatstream &str, const gensim::isa::InstructionDescription &insn)
 {
 	str <<
-	    "while(true) {"
+	    "inst = (Interpreter::decode_t*)insn->Decode;"
+	    "if(profile) {"
+	    "  if(archsim::options::ProfilePcFreq) { thread->GetMetrics().PCHistogram.inc(thread->GetPC().Get()); }"
+	    "  if(archsim::options::Profile) {"
+	    "    thread->GetMetrics().OpcodeHistogram.inc(inst->Instr_Code);"
+	    "    if(insn != block->begin()) { thread->GetMetrics().OpcodePairHistogram.inc(((uint64_t)insn[-1].Decode->Instr_Code << 16) | inst->Instr_Code); }"
+	    "  }"
+	    "  if(archsim::options::ProfileIrFreq) { thread->GetMetrics().InstructionIRHistogram.inc(inst->ir); }"
+	    "  thread->GetMetrics().InstructionCount++;"
+	    "}"
+
+	    "result = StepInstruction_" << insn.ISA.ISAName << "<trace, StepInstruction_" << insn.ISA.ISAName << "_" << insn.Name << "<trace>>(thread, *inst);"
+	    "if(inst->GetEndOfBlock()) { goto L_block_end; }"
+	    "if(result != archsim::core::execution::ExecutionResult::Continue) { return result; }"
+
+	    // Exceptions and mode changes can leave the block early
+	    "pc += inst->Instr_Length;"
+	    "if(interface.read_pc() != pc.Get() || thread->GetModeID() != mode) { return archsim::core::execution::ExecutionResult::Continue; }"
+	    "if(++insn == end) { goto L_block_end; }";
+}
 
-	    "  decode_t *inst_;"
-	    "  uint32_t dcode_exception = DecodeInstruction(static_cast<archsim::core::execution::InterpreterExecutionEngineThreadContext*>(thread_ctx), inst_);"
-	    "  if(thread->HasMessage()) { return thread->HandleMessage(); }"
-	    "  if(dcode_exception) { thread->TakeMemoryException(thread->GetFetchMI(), thread->GetPC()); return archsim::core::execution::ExecutionResult::Exception; }"
-	    "  if(archsim::options::InstructionTick) { thread->GetPubsub().Publish(PubSubType::InstructionExecute, nullptr); } "
-	    "  auto result = StepInstruction(thread, *inst_);"
-	    "  if(inst_->GetEndOfBlock()) { inst_->Release(); return archsim::core::execution::ExecutionResult::Continue; }"
-	    "  inst_->Release();"
-	    "  if(result != archsim::core::execution::ExecutionResult::Continue) { return result; }"
+bool InterpEEGenerator::GenerateThreadedExecutor(util::cppformatstream& str, const handler_table_t &handlers) const
+{
+	// Each handler is a label within a single function, and the handler
+	// stored with each predecoded instruction is the address of its label,
+	// so every instruction jumps directly to the next one. The options are
+	// template parameters, so that nothing is checked for them unless they
+	// are enabled. Passing a null block retrieves the label table instead.
+	str << "template<bool trace, bool profile, bool tick> static archsim::core::execution::ExecutionResult ExecuteBlock(archsim::core::thread::ThreadInstance *thread, const archsim::interpret::PredecodedBlock *block, void *const **labels_out) {";
+
+	str << "static void *const labels[] = { &&L_unknown";
+	for(size_t slot = 1; slot < handlers.size(); ++slot) {
+		if(handlers[slot].Second == nullptr) {
+			str << ", &&" << HandlerLabel(handlers[slot].First);
+		} else {
+			str << ", &&S_" << slot;
+		}
+	}
+	str << " };";
+
+	str <<
+	    "if(block == nullptr) { *labels_out = labels; return archsim::core::execution::ExecutionResult::Continue; }"
+
+	    "gensim::" << Manager.GetArch().Name << "::ArchInterface interface(thread);"
+	    "archsim::Address pc (interface.read_pc());"
+	    "uint32_t mode = thread->GetModeID();"
+	    "const archsim::interpret::PredecodedInstruction *insn = block->begin(), *end = block->end();"
+	    "Interpreter::decode_t *inst;"
+	    "archsim::core::execution::ExecutionResult result;"
+	    "goto *insn->Handler;"
+
+	    // The virtual clock advances a block at a time, when the end of the
+	    // block is reached, in the same way as in JIT code
+	    "L_block_end:"
+	    "if(tick) { cpuInstructionTick(thread, block->size()); }"
+	    "return archsim::core::execution::ExecutionResult::Continue;"
+
+	    "L_unknown: return UnknownInstruction(thread, *(Interpreter::decode_t*)insn->Decode);";
+
+	for(size_t slot = 1; slot < handlers.size(); ++slot) {
+		const auto &handler = handlers[slot];
+		if(handler.Second == nullptr) {
+			str << HandlerLabel(handler.First) << ": {";
+			GenerateThreadedStep(str, *handler.First);
+		} else {
+			// The second instruction is always in the same block, since
+			// superinstructions are only chosen when it has been decoded
+			str << "S_" << slot << ": {";
+			GenerateThreadedStep(str, *handler.First);
+			GenerateThreadedStep(str, *handler.Second);
+		}
+		str << "goto *insn->Handler; }";
+	}
+
+	str << "}";
+
+	str <<
+	    "typedef archsim::core::execution::ExecutionResult (*block_executor_t)(archsim::core::thread::ThreadInstance *, const archsim::interpret::PredecodedBlock *, void *const **);"
+	    "static block_executor_t SelectBlockExecutor() {"
+	    "  static const block_executor_t executors[] = {"
+	    "    ExecuteBlock<false, false, false>, ExecuteBlock<false, false, true>, ExecuteBlock<false, true, false>, ExecuteBlock<false, true, true>,"
+	    "    ExecuteBlock<true, false, false>, ExecuteBlock<true, false, true>, ExecuteBlock<true, true, false>, ExecuteBlock<true, true, true>"
+	    "  };"
+	    "  return executors[(archsim::options::Trace ? 4 : 0) | (archsim::options::Verbose ? 2 : 0) | (archsim::options::InstructionTick ? 1 : 0)];"
 	    "}";
 
 	return true;
 }
 
-bool InterpEEGenerator::GenerateStepInstruction(util::cppformatstream& str) const
+bool InterpEEGenerator::GenerateResolveHandler(util::cppformatstream& str, const handler_table_t &handlers) const
 {
-	for(auto i : Manager.GetArch().ISAs) {
-		GenerateStepInstructionISA(str, *i);
+	for(auto isa : Manager.GetArch().ISAs) {
+		str << "static uint32_t ResolveSlot_" << isa->ISAName << "(const Interpreter::decode_t &decode, const Interpreter::decode_t *next) {";
+		str << "using namespace gensim::" << Manager.GetArch().Name << ";";
+
+		// Superinstructions, grouped by their first instruction
+		std::map<const isa::InstructionDescription *, std::vector<size_t>> fused;
+		for(size_t slot = 1; slot < handlers.size(); ++slot) {
+			if(handlers[slot].Second != nullptr && &handlers[slot].First->ISA == isa) {
+				fused[handlers[slot].First].push_back(slot);
+			}
+		}
+
+		if(!fused.empty()) {
+			str << "if(next != nullptr && !decode.GetEndOfBlock()) {";
+			str << "switch(decode.Instr_Code) {";
+			for(const auto &first : fused) {
+				str << "case INST_" << isa->ISAName << "_" << first.first->Name << ": switch(next->Instr_Code) {";
+				for(auto slot : first.second) {
+					str << "case INST_" << isa->ISAName << "_" << handlers[slot].Second->Name << ": return " << slot << ";";
+				}
+				str << "default: break; } break;";
+			}
+			str << "default: break;";
+			str << "}";
+			str << "}";
+		}
+
+		str << "switch(decode.Instr_Code) {";
+		for(size_t slot = 1; slot < handlers.size(); ++slot) {
+			if(handlers[slot].Second == nullptr && &handlers[slot].First->ISA == isa) {
+				str << "case INST_" << isa->ISAName << "_" << handlers[slot].First->Name << ": return " << slot << ";";
+			}
+		}
+		str << "default: return 0;";
+		str << "}";
+		str << "}";
 	}
 
-	str <<
-	    "archsim::core::execution::ExecutionResult Interpreter::StepInstruction(archsim::core::thread::ThreadInstance *thread, Interpreter::decode_t &inst) {";
-	str << "if(archsim::options::Verbose) {";
-	str << "if(archsim::options::ProfilePcFreq) {thread->GetMetrics().PCHistogram.inc(thread->GetPC().Get());}";
-	str << "if(archsim::options::Profile) {thread->GetMetrics().OpcodeHistogram.inc(inst.Instr_Code);}";
-	str << "if(archsim::options::ProfileIrFreq) {thread->GetMetrics().InstructionIRHistogram.inc(inst.ir);}";
-	str << "thread->GetMetrics().InstructionCount++;";
-	str << "}";
-	str << "switch(thread->GetModeID()) {";
+	str << "void *Interpreter::ResolveHandler(uint32_t mode, const gensim::BaseDecode &inst, const gensim::BaseDecode *next) {";
+	str << "void *const *labels;";
+	str << "SelectBlockExecutor()(nullptr, nullptr, &labels);";
+	str << "switch(mode) {";
 
 	for(auto i : Manager.GetArch().ISAs) {
-		str << "case " << i->isa_mode_id << ": if(archsim::options::Trace) { return StepInstruction_" << i->ISAName << "<true>(thread, inst); } else { return StepInstruction_" << i->ISAName << "<false>(thread, inst); }";
+		str << "case " << i->isa_mode_id << ": return labels[ResolveSlot_" << i->ISAName << "((const decode_t&)inst, (const decode_t*)next)];";
 	}
 
 	str <<
@@ -207,12 +374,29 @@ bool InterpEEGenerator::GenerateStepInstruction(util::cppformatstream& str) cons
 	    "  }";
 
 	str <<
-	    "  return archsim::core::execution::ExecutionResult::Abort; "
+	    "  return labels[0]; "
 	    "}";
 
 	return true;
 }
 
+bool InterpEEGenerator::GenerateStepInstruction(util::cppformatstream& str, const handler_table_t &handlers) const
+{
+	str << "static archsim::core::execution::ExecutionResult UnknownInstruction(archsim::core::thread::ThreadInstance *thread, Interpreter::decode_t &inst) {";
+	str << "  LC_ERROR(LogInterpreter) << \"Unknown instruction at PC \" << std::hex << thread->GetPC();";
+	str << "  return archsim::core::execution::ExecutionResult::Abort;";
+	str << "}";
+
+	for(auto i : Manager.GetArch().ISAs) {
+		GenerateStepInstructionISA(str, *i);
+	}
+
+	GenerateThreadedExecutor(str, handlers);
+	GenerateResolveHandler(str, handlers);
+
+	return true;
+}
+
 bool InterpEEGenerator::RegisterStepInstruction(isa::InstructionDescription& insn) const
 {
 	std::stringstream prototype_str;
@@ -259,7 +443,7 @@ bool InterpEEGenerator::GenerateStepInstructionISA(util::cppformatstream& str, i
 	}
 
 
-	str << "template<bool trace=false> archsim::core::execution::ExecutionResult StepInstruction_" << isa.ISAName << "(archsim::core::thread::ThreadInstance *thread, Interpreter::decode_t &decode) {";
+	str << "template<bool trace, Interpreter::handler_t behaviour> archsim::core::execution::ExecutionResult StepInstruction_" << isa.ISAName << "(archsim::core::thread::ThreadInstance *thread, Interpreter::decode_t &decode) {";
 	str << "gensim::" << Manager.GetArch().Name << "::ArchInterface interface(thread);";
 	str << "archsim::core::execution::ExecutionResult interp_result = archsim::core::execution::ExecutionResult::Continue;";
 	str << "bool should_execute = true;";
@@ -271,16 +455,7 @@ bool InterpEEGenerator::GenerateStepInstructionISA(util::cppformatstream& str, i
 		str << "should_execute =  !" << isa.ISAName << "_is_predicated(thread, decode) || " << isa.ISAName << "_check_predicate(thread, decode);";
 	}
 	str << "if(should_execute) {";
-	str << " switch(decode.Instr_Code) {";
-	str << " using namespace gensim::" << Manager.GetArch().Name << ";";
-
-	for(auto i : isa.Instructions) {
-		str << "case INST_" << isa.ISAName << "_" << i.second->Name << ": interp_result = StepInstruction_" << isa.ISAName << "_" << i.first << "<trace>(thread, decode); break;";
-	}
-
-	str << " default: LC_ERROR(LogInterpreter) << \"Unknown instruction at PC \" << std::hex << thread->GetPC(); return archsim::core::execution::ExecutionResult::Abort;";
-
-	str << "}";
+	str << " interp_result = behaviour(thread, decode);";
 	str << "}";
 
 	str << "if(!decode.GetEndOfBlock() || !should_execute) {";
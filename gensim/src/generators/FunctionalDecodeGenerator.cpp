@@ -8,6 +8,9 @@
 
 DEFINE_COMPONENT(gensim::generator::FunctionalDecodeGenerator, decode)
 COMPONENT_INHERITS(decode, base_decode);
+COMPONENT_OPTION(decode, TableDecodeISAs, "", "Colon separated list of ISAs to decode using lookup tables rather than nested switch statements ('*' for all ISAs)")
+COMPONENT_OPTION(decode, TableMaxDirectBits, "8", "The widest field which table-driven decoders will index directly, rather than binary search")
+COMPONENT_OPTION(decode, GenerateBenchmark, "0", "Generate decode_bench.cpp, a standalone benchmark comparing the switch and table-driven decoders")
 
 namespace gensim
 {
@@ -16,6 +19,34 @@ namespace gensim
 
 		FunctionalDecodeGenerator::FunctionalDecodeGenerator(GenerationManager &man) : DecodeGenerator(man, "decode") {}
 
+		bool FunctionalDecodeGenerator::Generate() const
+		{
+			bool success = DecodeGenerator::Generate();
+
+			if (success && GetProperty("GenerateBenchmark") == "1") {
+				util::cppformatstream bench_str;
+				success &= GenerateDecodeBenchmark(bench_str);
+				if (success) WriteOutputFile("decode_bench.cpp", bench_str);
+			}
+
+			return success;
+		}
+
+		bool FunctionalDecodeGenerator::UseDecodeTable(const isa::ISADescription &isa) const
+		{
+			for (const auto &name : util::Util::Tokenize(GetProperty("TableDecodeISAs"), ":", false)) {
+				if (name == "*" || name == isa.ISAName) return true;
+			}
+			return false;
+		}
+
+		DecodeTable FunctionalDecodeGenerator::BuildDecodeTable(const isa::ISADescription &isa) const
+		{
+			DecodeTable table (*decode_trees.at(&isa), Manager.GetArch().GetMaxInstructionSize(), atoi(GetProperty("TableMaxDirectBits").c_str()));
+			fprintf(stderr, "[DECODE] Flattened decode tree for ISA %s into %zu groups - %zu bytes\n", isa.ISAName.c_str(), table.GetGroups().size() - 1, table.GetSize());
+			return table;
+		}
+
 		bool FunctionalDecodeGenerator::EmitExtraClassMembers(util::cppformatstream &stream) const
 		{
 			return true;
@@ -312,8 +343,32 @@ namespace gensim
 			source_str << "#include <gensim/gensim_processor_api.h>\n";
 			source_str << "#undef INTERP\n";
 
+			std::map<const isa::ISADescription *, DecodeTable> decode_tables;
+			for (const auto &tree : decode_trees) {
+				if (UseDecodeTable(*tree.first)) decode_tables.insert({tree.first, BuildDecodeTable(*tree.first)});
+			}
+			if (!decode_tables.empty()) source_str << "#include <gensim/gensim_decode_table.h>\n";
+
 			source_str << "namespace gensim { \n namespace " << Architecture.Name << "{ \n";
 
+			if (!decode_tables.empty()) {
+				source_str << "struct DecodeTableLeaf { uint16_t code; uint8_t length; void (" << GetProperty("class") << "::*format)(uint32_t); };\n";
+
+				for (const auto &table : decode_tables) {
+					const isa::ISADescription &isa = *table.first;
+					std::string prefix = "decode_table_" + isa.ISAName;
+
+					table.second.EmitTables(source_str, prefix);
+
+					source_str << "static const DecodeTableLeaf " << prefix << "_leaves[] = {\n";
+					for (auto insn : table.second.GetLeaves()) {
+						source_str << "{ INST_" << isa.ISAName << "_" << insn->Name << ", " << insn->Format->GetLength() / 8 << ", &" << GetProperty("class") << "::Decode_Format_" << isa.ISAName << "_" << insn->Format->GetName() << " },\n";
+					}
+					if (table.second.GetLeaves().empty()) source_str << "{ 0, 0, nullptr }\n";
+					source_str << "};\n";
+				}
+			}
+
 			// End of preamble, here comes the good stuff
 
 			// If for each ISA, if instructions are statically predicated, emit an 'is_predicated' function for that isa
@@ -416,7 +471,10 @@ namespace gensim
 			source_str << "switch (_isa_mode) {\n";
 			for (std::map<const isa::ISADescription *, DecodeNode *>::const_iterator DI = decode_trees.begin(), DE = decode_trees.end(); DI != DE; ++DI) {
 				source_str << "case ISA_MODE_" << DI->first->ISAName << ": {\n";
-				success &= GenerateDecodeTree(*DI->first, *DI->second, source_str, n);
+				if (decode_tables.count(DI->first))
+					success &= GenerateDecodeTable(*DI->first, decode_tables.at(DI->first), source_str);
+				else
+					success &= GenerateDecodeTree(*DI->first, *DI->second, source_str, n);
 				source_str << "} break;\n";
 			}
 
@@ -483,6 +541,13 @@ namespace gensim
 		}
 
 		bool FunctionalDecodeGenerator::GenerateDecodeTree(const isa::ISADescription &isa, DecodeNode &tree, util::cppformatstream &stream, int &i) const
+		{
+			return EmitDecodeSwitch(tree, stream, [this, &isa](const isa::InstructionDescription &insn, util::cppformatstream &leaf_stream) {
+				return GenerateDecodeLeaf(isa, insn, leaf_stream);
+			});
+		}
+
+		bool FunctionalDecodeGenerator::EmitDecodeSwitch(const DecodeNode &tree, util::cppformatstream &stream, const LeafEmitter &emit_leaf) const
 		{
 			bool success = true;
 			const arch::ArchDescription &Architecture = Manager.GetArch();
@@ -496,11 +561,11 @@ namespace gensim
 
 			// if this is a leaf node
 			if (tree.target) {
-				GenerateDecodeLeaf(isa, *tree.target, stream);
+				success &= emit_leaf(*tree.target, stream);
 			} else {
 				// otherwise look at the transitions from this node and sort them by their length
 				std::map<uint8_t, std::list<DecodeTransition> > sorted_transitions;
-				for (std::multimap<uint8_t, DecodeTransition>::iterator trans = tree.transitions.begin(); trans != tree.transitions.end(); ++trans) {
+				for (std::multimap<uint8_t, DecodeTransition>::const_iterator trans = tree.transitions.begin(); trans != tree.transitions.end(); ++trans) {
 					if (sorted_transitions.find(trans->first) == sorted_transitions.end()) sorted_transitions.insert(std::pair<uint8_t, std::list<DecodeTransition> >(trans->first, std::list<DecodeTransition>()));
 					sorted_transitions.at(trans->first).push_back(trans->second);
 				}
@@ -526,7 +591,7 @@ namespace gensim
 					for (std::list<DecodeTransition>::iterator trans = list.begin(); trans != list.end(); ++trans) {
 						stream << "case " << (trans->value) << ": { \n";
 
-						success &= GenerateDecodeTree(isa, *(trans->target), stream, i);
+						success &= EmitDecodeSwitch(*(trans->target), stream, emit_leaf);
 
 						stream << "\nbreak; }\n";
 					}
@@ -537,12 +602,157 @@ namespace gensim
 				if (tree.unconstrained_transition) {
 					if (seen_transitions) stream << "{\n";
 					// emit an 'anything' subtree
-					success &= GenerateDecodeTree(isa, *(tree.unconstrained_transition->target), stream, i);
+					success &= EmitDecodeSwitch(*(tree.unconstrained_transition->target), stream, emit_leaf);
 					if (seen_transitions) stream << "}\n";
 					seen_transitions = true;
 				}
 			}
 			return success;
 		}
+
+		bool FunctionalDecodeGenerator::GenerateDecodeTable(const isa::ISADescription &isa, const DecodeTable &table, util::cppformatstream &stream) const
+		{
+			std::string prefix = "decode_table_" + isa.ISAName;
+
+			stream << "int32_t leaf = " << table.EmitLookup(prefix, "instr") << ";\n";
+			stream << "if (leaf < 0) break;\n";
+
+			if (GetProperty("Debug") == "1") stream << "printf(\"Leaf %d\\n\", leaf);\n";
+
+			stream << "const DecodeTableLeaf &entry = " << prefix << "_leaves[leaf];\n";
+			stream << "Instr_Code = entry.code;\n";
+			stream << "isa_mode = " << isa.isa_mode_id << ";\n";
+			stream << "(this->*entry.format)(instr);\n";
+			stream << "Instr_Length = entry.length;\n";
+			stream << "return;\n";
+
+			return true;
+		}
+
+		bool FunctionalDecodeGenerator::GenerateDecodeBenchmark(util::cppformatstream &stream) const
+		{
+			bool success = true;
+			const arch::ArchDescription &Architecture = Manager.GetArch();
+			uint32_t max_bits = Architecture.GetMaxInstructionSize();
+
+			// The benchmark is standalone, so that it can be built without
+			// archsim: both decoders just identify the instruction, using the
+			// leaf numbering of the decode table.
+			stream << "/* Auto generated decoder benchmark for Arch " << Architecture.Name << " */\n";
+			stream << "/* Build with: c++ -O2 -std=c++11 -I<archsim>/inc decode_bench.cpp -o decode_bench */\n";
+			stream << "/* Usage: decode_bench [-n count] [isa=file ...] */\n";
+			stream << "#include <gensim/gensim_decode_table.h>\n";
+			stream << "#include <chrono>\n";
+			stream << "#include <cstdio>\n";
+			stream << "#include <cstdlib>\n";
+			stream << "#include <cstring>\n";
+			stream << "#include <fstream>\n";
+			stream << "#include <iterator>\n";
+			stream << "#include <string>\n";
+			stream << "#include <vector>\n";
+			stream << "#define UNSIGNED_BITS(v, u, l) (((uint32_t)(v) << (31 - (u))) >> (31 - (u) + (l)))\n";
+			stream << "#define BIT_LSB(i) (1 << (i))\n";
+
+			std::map<const isa::ISADescription *, DecodeTable> tables;
+			for (const auto &tree : decode_trees) {
+				const isa::ISADescription &isa = *tree.first;
+				const DecodeTable &table = tables.insert({&isa, BuildDecodeTable(isa)}).first->second;
+				std::string prefix = "bench_" + isa.ISAName;
+
+				table.EmitTables(stream, prefix);
+
+				stream << "static int32_t switch_decode_" << isa.ISAName << "(uint32_t instr) {\n";
+				success &= EmitDecodeSwitch(*tree.second, stream, [&table](const isa::InstructionDescription &insn, util::cppformatstream &leaf_stream) {
+					leaf_stream << "return " << table.GetLeafIndex(&insn) << ";\n";
+					return true;
+				});
+				stream << "return -1;\n}\n";
+
+				stream << "static int32_t table_decode_" << isa.ISAName << "(uint32_t instr) { return " << table.EmitLookup(prefix, "instr") << "; }\n";
+			}
+
+			stream <<
+			       "static std::vector<uint32_t> random_stream(size_t count, unsigned insn_bits) {\n"
+			       "  std::vector<uint32_t> words;\n"
+			       "  uint64_t state = 0x9e3779b97f4a7c15ull;\n"
+			       "  for (size_t i = 0; i < count; ++i) {\n"
+			       "    state ^= state << 13; state ^= state >> 7; state ^= state << 17;\n"
+			       "    uint32_t word = insn_bits < 32 ? (uint32_t)state & ((1u << insn_bits) - 1) : (uint32_t)state;\n"
+			       "    words.push_back(word << (" << max_bits << " - insn_bits));\n"
+			       "  }\n"
+			       "  return words;\n"
+			       "}\n"
+			       "\n"
+			       "// Assemble instruction words from a raw binary in the same way as the decoder fetches them\n"
+			       "static std::vector<uint32_t> file_stream(const char *filename, unsigned fetch_bits, unsigned insn_bits) {\n"
+			       "  std::ifstream file (filename, std::ios::binary);\n"
+			       "  std::vector<unsigned char> bytes ((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());\n"
+			       "  std::vector<uint32_t> words;\n"
+			       "  unsigned fetch_bytes = fetch_bits / 8, insn_bytes = (insn_bits + fetch_bits - 1) / fetch_bits * fetch_bytes;\n"
+			       "  for (size_t offset = 0; offset + insn_bytes <= bytes.size(); offset += fetch_bytes) {\n"
+			       "    uint32_t word = 0;\n"
+			       "    for (unsigned chunk = 0; chunk < insn_bytes; chunk += fetch_bytes) {\n"
+			       "      uint32_t value = 0;\n"
+			       "      for (unsigned byte = 0; byte < fetch_bytes; ++byte) value |= (uint32_t)bytes[offset + chunk + byte] << (8 * byte);\n"
+			       "      word = fetch_bits < 32 ? (word << fetch_bits) | value : value;\n"
+			       "    }\n"
+			       "    words.push_back(word << (" << max_bits << " - insn_bytes * 8));\n"
+			       "  }\n"
+			       "  return words;\n"
+			       "}\n"
+			       "\n"
+			       "template<int32_t (*Decode)(uint32_t)> static double time_decoder(const std::vector<uint32_t> &words, int64_t &checksum) {\n"
+			       "  unsigned repeats = 0;\n"
+			       "  auto start = std::chrono::steady_clock::now();\n"
+			       "  std::chrono::duration<double> elapsed;\n"
+			       "  do {\n"
+			       "    for (uint32_t word : words) checksum += Decode(word);\n"
+			       "    repeats++;\n"
+			       "    elapsed = std::chrono::steady_clock::now() - start;\n"
+			       "  } while (elapsed.count() < 0.5);\n"
+			       "  return elapsed.count() * 1e9 / ((double)words.size() * repeats);\n"
+			       "}\n"
+			       "\n"
+			       "template<int32_t (*Switch)(uint32_t), int32_t (*Table)(uint32_t)> static bool bench(const char *isa, const char *stream, const std::vector<uint32_t> &words) {\n"
+			       "  if (words.empty()) { fprintf(stderr, \"%s: no instructions in %s stream\\n\", isa, stream); return false; }\n"
+			       "  size_t mismatches = 0;\n"
+			       "  for (uint32_t word : words) {\n"
+			       "    if (Switch(word) != Table(word)) {\n"
+			       "      if (mismatches++ < 10) fprintf(stderr, \"%s: decoders disagree on %08x (switch %d, table %d)\\n\", isa, word, Switch(word), Table(word));\n"
+			       "    }\n"
+			       "  }\n"
+			       "  int64_t checksum = 0;\n"
+			       "  double switch_ns = time_decoder<Switch>(words, checksum);\n"
+			       "  double table_ns = time_decoder<Table>(words, checksum);\n"
+			       "  printf(\"%-12s %-8s %10zu insns  switch %7.2f ns/insn  table %7.2f ns/insn  speedup %5.2fx  (%lld)\\n\", isa, stream, words.size(), switch_ns, table_ns, switch_ns / table_ns, (long long)(checksum & 1));\n"
+			       "  return mismatches == 0;\n"
+			       "}\n"
+			       "\n"
+			       "int main(int argc, char **argv) {\n"
+			       "  size_t count = 1 << 20;\n"
+			       "  std::vector<std::pair<std::string, std::string>> files;\n"
+			       "  for (int i = 1; i < argc; ++i) {\n"
+			       "    if (!strcmp(argv[i], \"-n\") && i + 1 < argc) { count = strtoull(argv[++i], nullptr, 0); continue; }\n"
+			       "    const char *eq = strchr(argv[i], '=');\n"
+			       "    if (!eq) { fprintf(stderr, \"usage: %s [-n count] [isa=file ...]\\n\", argv[0]); return 2; }\n"
+			       "    files.push_back({std::string(argv[i], eq - argv[i]), eq + 1});\n"
+			       "  }\n"
+			       "  bool success = true;\n";
+
+			for (const auto &table : tables) {
+				const isa::ISADescription &isa = *table.first;
+				std::string decoders = "switch_decode_" + isa.ISAName + ", table_decode_" + isa.ISAName;
+
+				stream << "success &= bench<" << decoders << ">(\"" << isa.ISAName << "\", \"random\", random_stream(count, " << isa.GetMaxInstructionLength() << "));\n";
+				stream << "for (const auto &file : files) {\n"
+				       "  if (file.first == \"" << isa.ISAName << "\") success &= bench<" << decoders << ">(\"" << isa.ISAName << "\", \"file\", file_stream(file.second.c_str(), " << (uint32_t)isa.GetFetchLength() << ", " << isa.GetMaxInstructionLength() << "));\n"
+				       "}\n";
+			}
+
+			stream << "  return success ? 0 : 1;\n"
+			       "}\n";
+
+			return success;
+		}
 	}  // namespace generator
 }  // namespace gensim
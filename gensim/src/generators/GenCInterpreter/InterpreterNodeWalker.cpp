@@ -404,6 +404,15 @@ namespace gensim
 					case IntrinsicID::HaltCpu:
 						output << "UNIMPLEMENTED; // haltcpu\n";
 						break;
+					case IntrinsicID::WaitForInterrupt:
+						output << "thread->WaitForInterrupt();";
+						break;
+					case IntrinsicID::WaitForEvent:
+						output << "thread->WaitForEvent();";
+						break;
+					case IntrinsicID::SendEvent:
+						output << "thread->SendEvent();";
+						break;
 					case IntrinsicID::PopCount32:
 						output << stmt.GetType().GetCType() << " " << stmt.GetName() << " = __builtin_popcount(" << Factory.GetOrCreate(stmt.Args(0))->GetFixedValue() << ");";
 						break;
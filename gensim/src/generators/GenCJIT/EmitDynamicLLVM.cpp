@@ -952,6 +952,15 @@ namespace gensim
 						case IntrinsicID::HaltCpu:
 							output << "__irBuilder.CreateCall(ctx.Functions.cpu_halt, ctx.GetThreadPtr(__irBuilder));";
 							break;
+						case IntrinsicID::WaitForInterrupt:
+							output << "__irBuilder.CreateCall(ctx.Functions.cpuWaitForInterrupt, ctx.GetThreadPtr(__irBuilder));";
+							break;
+						case IntrinsicID::WaitForEvent:
+							output << "__irBuilder.CreateCall(ctx.Functions.cpuWaitForEvent, ctx.GetThreadPtr(__irBuilder));";
+							break;
+						case IntrinsicID::SendEvent:
+							output << "__irBuilder.CreateCall(ctx.Functions.cpuSendEvent, ctx.GetThreadPtr(__irBuilder));";
+							break;
 						case IntrinsicID::SetExecutionRing:
 							output << "__irBuilder.CreateCall(ctx.Functions.cpuSetRing, {ctx.GetThreadPtr(__irBuilder), " << arg0->GetDynamicValue() << "});";
 							break;
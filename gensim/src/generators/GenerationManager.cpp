@@ -4,7 +4,14 @@
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include <atomic>
+#include <thread>
+
 #include "generators/GenerationManager.h"
+#include "arch/ArchDescription.h"
+#include "isa/ISADescription.h"
+#include "genC/ssa/SSAContext.h"
+#include "genC/ssa/SSAFormAction.h"
 #include "Util.h"
 
 namespace gensim
@@ -147,17 +154,79 @@ namespace gensim
 				(*i)->Setup(gsm);
 			}
 
+			// Components which can generate concurrently are batched together,
+			// but any other component acts as a barrier so that the components
+			// still see each other's output in command line order.
+			std::vector<GenerationComponent*> batch;
 			for (std::vector<GenerationComponent*>::iterator i = _components.begin(); i != _components.end(); ++i) {
+				if(util::Util::Jobs > 1 && (*i)->CanGenerateConcurrently()) {
+					batch.push_back(*i);
+					continue;
+				}
+
+				success &= GenerateConcurrently(batch);
+				batch.clear();
+
 				bool component_success = (*i)->Generate();
 				success &= component_success;
 				if(!component_success) {
 					fprintf(stderr, "Generation failure in component %s!\n", (*i)->name.c_str());
 				}
 			}
+			success &= GenerateConcurrently(batch);
 
 			return success;
 		}
 
+		bool GenerationManager::GenerateConcurrently(const std::vector<GenerationComponent *> &components)
+		{
+			if(components.empty()) return true;
+
+			// Fill in any lazily computed state in the architecture before
+			// starting, so that the generators only ever read it.
+			for(auto isa : arch.ISAs) {
+				isa->Get_Decode_Fields();
+				isa->Get_Disasm_Fields();
+				for(auto insn : isa->Instructions) {
+					insn.second->GetBitString();
+				}
+				for(auto action : isa->GetSSAContext().Actions()) {
+					if(auto fn = dynamic_cast<const genc::ssa::SSAFormAction *>(action.second)) {
+						fn->CacheDerivedState();
+					}
+				}
+			}
+
+			std::vector<char> results (components.size(), false);
+			std::atomic<unsigned> next (0);
+			auto worker = [&]() {
+				unsigned index;
+				while((index = next++) < components.size()) {
+					results[index] = components[index]->Generate();
+				}
+			};
+
+			unsigned thread_count = std::min<unsigned>(util::Util::Jobs, components.size());
+			std::vector<std::thread> threads;
+			for(unsigned i = 1; i < thread_count; ++i) {
+				threads.emplace_back(worker);
+			}
+			worker();
+			for(auto &thread : threads) {
+				thread.join();
+			}
+
+			// Report failures in order so that the output doesn't depend on scheduling
+			bool success = true;
+			for(unsigned i = 0; i < components.size(); ++i) {
+				if(!results[i]) {
+					fprintf(stderr, "Generation failure in component %s!\n", components[i]->name.c_str());
+					success = false;
+				}
+			}
+			return success;
+		}
+
 		std::list<std::string> GenerationComponent::GetPropertyList() const
 		{
 			std::list<std::string> rVal;
@@ -171,13 +240,16 @@ namespace gensim
 		{
 			if (Properties.find(key) != Properties.end()) return Properties.at(key);
 
+			// Only use lookups which don't modify the option maps here, since
+			// components may be generating concurrently.
 			std::string component = name;
-			auto &options = Options[component];
-			if (options.count(key)) return options.at(key)->DefaultValue;
+			while (true) {
+				auto options = Options.find(component);
+				if (options != Options.end() && options->second.count(key)) return options->second.at(key)->DefaultValue;
 
-			while (Inheritance.find(component) != Inheritance.end()) {
-				component = Inheritance[component];
-				if (Options[component].find(key) != Options[component].end()) return Options[component][key]->DefaultValue;
+				auto super = Inheritance.find(component);
+				if (super == Inheritance.end()) break;
+				component = super->second;
 			}
 
 			throw std::logic_error("Undefined Property: " + key);
@@ -188,14 +260,13 @@ namespace gensim
 			if (Properties.find(key) != Properties.end()) return true;
 
 			std::string component = name;
-			auto &options = Options[component];
-			if (options.count(key)) {
-				return true;
-			}
+			while (true) {
+				auto options = Options.find(component);
+				if (options != Options.end() && options->second.count(key)) return true;
 
-			while (Inheritance.find(component) != Inheritance.end()) {
-				component = Inheritance[component];
-				if (Options[component].find(key) != Options[component].end()) return true;
+				auto super = Inheritance.find(component);
+				if (super == Inheritance.end()) break;
+				component = super->second;
 			}
 
 			return false;
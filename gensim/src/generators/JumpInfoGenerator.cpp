@@ -15,6 +15,10 @@ public:
 	virtual ~JumpInfoGenerator() {}
 
 	bool Generate() const override;
+	bool CanGenerateConcurrently() const override
+	{
+		return true;
+	}
 	std::string GetFunction() const override
 	{
 		return GenerationManager::FnJumpInfo;
@@ -0,0 +1,114 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include <gtest/gtest.h>
+
+#include "DecodeTable.h"
+#include "DecodeTree.h"
+#include "isa/ISADescription.h"
+
+using namespace gensim;
+using namespace gensim::generator;
+
+// Walk a decode tree in the same way as the switch-based decoder: longest
+// transitions first, falling through to shorter ones and then to the
+// unconstrained transition if nothing below a transition matches.
+static const isa::InstructionDescription *SwitchDecode(const DecodeNode &node, uint32_t instr, uint32_t bits)
+{
+	if(node.target) return node.target;
+
+	for(auto group = node.transitions.rbegin(); group != node.transitions.rend(); ++group) {
+		uint32_t low_bit = bits - node.start_ptr - group->first;
+		uint32_t field = (instr >> low_bit) & ((1u << group->first) - 1);
+		if(field == group->second.value) {
+			auto result = SwitchDecode(*group->second.target, instr, bits);
+			if(result) return result;
+		}
+	}
+
+	if(node.unconstrained_transition) return SwitchDecode(*node.unconstrained_transition->target, instr, bits);
+	return nullptr;
+}
+
+static DecodeNode *Leaf(const isa::InstructionDescription &insn, uint8_t start)
+{
+	DecodeNode *node = new DecodeNode(nullptr, start);
+	node->target = &insn;
+	return node;
+}
+
+class DecodeTableTest : public ::testing::Test
+{
+public:
+	DecodeTableTest() : isa(0), a(isa), b(isa), c(isa), d(isa), root(nullptr, 0)
+	{
+		// 8 bit instructions:
+		//   1010xxxx -> a
+		//   10000011 -> b
+		//   10xxxxxx -> c (if b doesn't match)
+		//   01xxxxx1 -> d
+		DecodeNode *prefix = new DecodeNode(nullptr, 2);
+		prefix->transitions.insert({6, DecodeTransition(6, 0x03, Leaf(b, 8))});
+		prefix->unconstrained_transition = new DecodeTransition(6, 0, Leaf(c, 8));
+
+		DecodeNode *odd = new DecodeNode(nullptr, 7);
+		odd->transitions.insert({1, DecodeTransition(1, 1, Leaf(d, 8))});
+		DecodeNode *middle = new DecodeNode(nullptr, 2);
+		middle->unconstrained_transition = new DecodeTransition(5, 0, odd);
+
+		root.transitions.insert({4, DecodeTransition(4, 0xa, Leaf(a, 4))});
+		root.transitions.insert({2, DecodeTransition(2, 0x2, prefix)});
+		root.transitions.insert({2, DecodeTransition(2, 0x1, middle)});
+	}
+
+	void CheckAllInstructions(const DecodeTable &table)
+	{
+		for(uint32_t instr = 0; instr < 256; ++instr) {
+			auto expected = SwitchDecode(root, instr, 8);
+			int32_t leaf = table.Lookup(instr);
+
+			if(expected == nullptr) {
+				ASSERT_EQ(-1, leaf) << "instruction " << instr;
+			} else {
+				ASSERT_NE(-1, leaf) << "instruction " << instr;
+				ASSERT_EQ(expected, table.GetLeaves().at(leaf)) << "instruction " << instr;
+			}
+		}
+	}
+
+	isa::ISADescription isa;
+	isa::InstructionDescription a, b, c, d;
+	DecodeNode root;
+};
+
+TEST_F(DecodeTableTest, DirectTablesMatchSwitchDecoder)
+{
+	DecodeTable table (root, 8, 8);
+	CheckAllInstructions(table);
+
+	ASSERT_EQ(&a, table.GetLeaves().at(table.Lookup(0xa5)));
+	ASSERT_EQ(&b, table.GetLeaves().at(table.Lookup(0x83)));
+	ASSERT_EQ(&c, table.GetLeaves().at(table.Lookup(0x84)));
+	ASSERT_EQ(&d, table.GetLeaves().at(table.Lookup(0x43)));
+	ASSERT_EQ(-1, table.Lookup(0x42));
+	ASSERT_EQ(-1, table.Lookup(0x00));
+}
+
+TEST_F(DecodeTableTest, SparseGroupsMatchSwitchDecoder)
+{
+	// Force every group to be binary searched
+	DecodeTable table (root, 8, 0);
+	CheckAllInstructions(table);
+
+	for(const auto &group : table.GetGroups()) {
+		ASSERT_TRUE(group.sparse || group.width == 0);
+	}
+}
+
+TEST_F(DecodeTableTest, LeavesAreShared)
+{
+	DecodeTable table (root, 8, 8);
+
+	ASSERT_EQ(4, table.GetLeaves().size());
+	ASSERT_EQ(-1, table.GetLeafIndex(nullptr));
+	ASSERT_LE(2, table.GetMaxDepth());
+}
@@ -0,0 +1,116 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+#include <gtest/gtest.h>
+
+#include "DiagnosticContext.h"
+#include "genC/testing/TestContext.h"
+#include "genC/ssa/SSAContext.h"
+#include "genC/ssa/SSABlock.h"
+#include "genC/ssa/SSAFormAction.h"
+#include "genC/ssa/statement/SSACallStatement.h"
+
+#include <sstream>
+
+using namespace gensim::genc::ssa;
+
+static const std::string sourcecode = R"||(
+execute(test_instruction){}
+helper uint32 add_one(uint32 x)
+{
+	return x + 1;
+}
+helper uint32 add_two(uint32 x)
+{
+	return add_one(add_one(x));
+}
+helper uint32 select_value(uint32 a, uint32 b)
+{
+	if(a == 0) {
+		return add_two(b);
+	}
+	return add_one(a);
+}
+helper void testfn()
+{
+	uint32 a = read_register_bank(RB, 0);
+	uint32 b = read_register_bank(RB, 1);
+	write_register_bank(RB, 2, select_value(a, b));
+	write_register_bank(RB, 3, add_two(a));
+}
+helper void testfn2()
+{
+	uint32 a = read_register_bank(RB, 4);
+	write_register_bank(RB, 5, select_value(add_one(a), a));
+}
+    )||";
+
+static std::string PrintActions(SSAContext *ctx)
+{
+	std::ostringstream str;
+	for(auto action : ctx->Actions()) {
+		auto form_action = dynamic_cast<SSAFormAction*>(action.second);
+		if(form_action == nullptr) {
+			continue;
+		}
+
+		str << action.first << std::endl;
+		for(auto block : form_action->GetBlocks()) {
+			str << block->GetName() << std::endl;
+			for(auto stmt : block->GetStatements()) {
+				str << stmt->ToString() << std::endl;
+			}
+		}
+	}
+	return str.str();
+}
+
+static SSAContext *CompileAndOptimise(gensim::DiagnosticContext &root_context, bool parallel)
+{
+	auto gencctx = gensim::genc::testing::TestContext::GetTestContext(false, root_context);
+	auto ctx = gensim::genc::testing::TestContext::CompileSource(gencctx, sourcecode);
+	if(ctx == nullptr) {
+		return nullptr;
+	}
+
+	ctx->SetParallelOptimise(parallel);
+	ctx->SetOptimiseThreads(4);
+	ctx->Optimise();
+
+	return ctx;
+}
+
+TEST(SSAOptimise, ParallelMatchesSequential)
+{
+	gensim::DiagnosticSource root_source("GenSim");
+	gensim::DiagnosticContext root_context(root_source);
+
+	auto sequential = CompileAndOptimise(root_context, false);
+	auto parallel = CompileAndOptimise(root_context, true);
+
+	if(sequential == nullptr || parallel == nullptr) {
+		std::cout << root_context;
+	}
+	ASSERT_NE(nullptr, sequential);
+	ASSERT_NE(nullptr, parallel);
+
+	ASSERT_EQ(PrintActions(sequential), PrintActions(parallel));
+}
+
+TEST(SSAOptimise, CalleesInlinedBeforeCallers)
+{
+	gensim::DiagnosticSource root_source("GenSim");
+	gensim::DiagnosticContext root_context(root_source);
+
+	auto ctx = CompileAndOptimise(root_context, true);
+	ASSERT_NE(nullptr, ctx);
+
+	for(auto name : {
+	            "add_two", "select_value", "testfn", "testfn2"
+	        }) {
+		auto action = (SSAFormAction*)ctx->GetAction(name);
+		for(auto block : action->GetBlocks()) {
+			for(auto stmt : block->GetStatements()) {
+				ASSERT_EQ(nullptr, dynamic_cast<SSACallStatement*>(stmt)) << "Call remaining in " << name;
+			}
+		}
+	}
+}
@@ -12,10 +12,13 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <thread>
 
 #include "arch/ArchDescription.h"
 #include "arch/ArchDescriptionParser.h"
 #include "genC/ssa/SSAContext.h"
+#include "genC/ssa/passes/SSAPass.h"
 #include "DiagnosticContext.h"
 
 #include "Util.h"
@@ -141,6 +144,7 @@ static struct option long_options[] = {
 	{"arch", required_argument, 0, 'a'},
 	{"ssa_opt", required_argument, 0, 'f'},
 	{"help", no_argument, 0, 'h'},
+	{"jobs", required_argument, 0, 'j'},
 	{"stage_opt", required_argument, 0, 'o'},
 	{"verbose", optional_argument, 0, 'v'},
 	{"add_stage", required_argument, 0, 's'},
@@ -160,6 +164,8 @@ void print_usage()
 	          "Options:\n"
 	          "  --arch, -a:      Specify the architecture file to generate from.\n"
 	          "  --help, -h:      Show this usage infomation\n"
+	          "  --jobs, -j:      Number of threads to optimise and generate with\n"
+	          "                   (default: one per core)\n"
 	          "  --stage_opt, -o: Specify an option for a generation stage in the format \n"
 	          "                   [stage].[option]=[value]\n"
 	          "  --verbose, -v:   Run the generation in a more verbose mode\n"
@@ -221,9 +227,11 @@ int main(int argc, char **argv)
 
 	bool success = true;
 
+	Util::Jobs = std::max(1u, std::thread::hardware_concurrency());
+
 	while (1) {
 		int option_index = 0;
-		int c = getopt_long(argc, argv, "a:f:ho:s:t:v:", long_options, &option_index);
+		int c = getopt_long(argc, argv, "a:f:hj:o:s:t:v:", long_options, &option_index);
 		if (c == -1) break;
 
 		switch (c) {
@@ -233,6 +241,9 @@ int main(int argc, char **argv)
 			case 'h':
 				print_usage();
 				return 0;
+			case 'j':
+				Util::Jobs = std::max(1, atoi(optarg));
+				break;
 			case 'v':
 				if (optarg) {
 					Util::Verbose_Level = atoi(optarg);
@@ -322,6 +333,8 @@ int main(int argc, char **argv)
 			success = false;
 			printf("Errors in arch description for ISA %s.\n", isa->ISAName.c_str());
 		} else {
+			isa->GetSSAContext().SetParallelOptimise(Util::Jobs > 1);
+			isa->GetSSAContext().SetOptimiseThreads(Util::Jobs);
 			isa->GetSSAContext().Optimise();
 			isa->GetSSAContext().Resolve(root_context);
 		}
@@ -332,6 +345,10 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
+	if (Util::Verbose_Level >= 1) {
+		genc::ssa::SSAPassDB::PrintStatistics(std::cout);
+	}
+
 #ifdef TEST_PARSER
 	std::ostringstream errors;
 	genc::GenCContext *root_context = genc::GenCContext::Parse("test_file", errors, description);
@@ -109,6 +109,9 @@ namespace libgvnc
 		int subversion_;
 		Server *server_;
 
+		// The damage serial of the last update sent to this client
+		uint64_t update_serial_;
+
 		std::vector<char> buffer_;
 	};
 }
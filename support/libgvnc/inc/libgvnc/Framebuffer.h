@@ -1,7 +1,10 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -85,7 +88,26 @@ namespace libgvnc
 			return data_;
 		}
 
-		std::vector<Rectangle> ServeRequest(const struct fb_update_request &request, const struct FB_PixelFormat &target_format);
+		/*
+		 * Serve an update request. Serial is the damage serial of the client's
+		 * previous update, and is updated to the current one. Incremental
+		 * requests are only served the tiles damaged since then.
+		 */
+		std::vector<Rectangle> ServeRequest(const struct fb_update_request &request, const struct FB_PixelFormat &target_format, uint64_t &serial);
+
+		/*
+		 * Damage tracking: once enabled, only the tiles passed to MarkDamaged
+		 * are sent in response to incremental update requests. Otherwise,
+		 * every request is served the whole of the requested area.
+		 */
+		static const uint16_t kTileSize = 16;
+
+		void EnableDamageTracking();
+		void MarkDamaged(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+		// Wait until something has been damaged since the given serial, or
+		// the timeout expires. Returns true if there is something to send.
+		bool WaitForDamage(uint64_t serial, std::chrono::milliseconds timeout);
 		void FillRectangle(Rectangle &rect, const struct FB_PixelFormat &target_format, EncodingType encoding);
 
 		uint32_t GetPixel(uint32_t x, uint32_t y) const;
@@ -96,5 +118,12 @@ namespace libgvnc
 		struct FB_PixelFormat pixel_format_;
 
 		void *data_;
+
+		std::mutex damage_lock_;
+		std::condition_variable damage_cv_;
+		bool damage_tracking_;
+		uint64_t damage_serial_;
+		uint16_t tiles_x_, tiles_y_;
+		std::vector<uint64_t> tile_serials_;
 	};
 }
@@ -8,7 +8,11 @@
 using namespace libgvnc;
 using namespace libgvnc::net;
 
-ClientConnection::ClientConnection(Server *server, Socket *client_socket) : client_socket_(client_socket), state_(State::Invalid), server_(server)
+// How long an incremental update request may wait for something to change
+// before it is answered with an empty update
+static const std::chrono::milliseconds kIncrementalUpdateTimeout (50);
+
+ClientConnection::ClientConnection(Server *server, Socket *client_socket) : client_socket_(client_socket), state_(State::Invalid), server_(server), update_serial_(0)
 {
 }
 
@@ -265,7 +269,11 @@ void ClientConnection::UpdateFB(const struct fb_update_request& request)
 	// Padding
 	Buffer((uint8_t)0);
 
-	auto result = GetServer()->GetFB()->ServeRequest(request, pixel_format_);
+	if(request.incremental) {
+		GetServer()->GetFB()->WaitForDamage(update_serial_, kIncrementalUpdateTimeout);
+	}
+
+	auto result = GetServer()->GetFB()->ServeRequest(request, pixel_format_, update_serial_);
 	Buffer((uint16_t)htons(result.size()));
 	// result is a vector of rectangles
 	for(auto &rectangle : result) {
@@ -3,34 +3,121 @@
 #include "libgvnc/Encoder.h"
 #include "libgvnc/ClientConnection.h"
 
+#include <algorithm>
 #include <functional>
 #include <map>
 #include <cmath>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace libgvnc;
 
-Framebuffer::Framebuffer(uint16_t width, uint16_t height, FB_PixelFormat format) : width_(width), height_(height), pixel_format_(format)
+const uint16_t Framebuffer::kTileSize;
+
+Framebuffer::Framebuffer(uint16_t width, uint16_t height, FB_PixelFormat format) : width_(width), height_(height), pixel_format_(format), data_(nullptr), damage_tracking_(false), damage_serial_(0)
+{
+	tiles_x_ = (width + kTileSize - 1) / kTileSize;
+	tiles_y_ = (height + kTileSize - 1) / kTileSize;
+}
+
+std::vector<Rectangle> Framebuffer::ServeRequest(const struct fb_update_request& request, const struct FB_PixelFormat& target_format, uint64_t &serial)
 {
+	std::vector<RectangleShape> shapes;
 
+	{
+		std::lock_guard<std::mutex> l(damage_lock_);
+		uint64_t last_serial = serial;
+		serial = damage_serial_;
+
+		if(!request.incremental || !damage_tracking_) {
+			shapes.push_back({request.x_pos, request.y_pos, request.width, request.height});
+		} else {
+			// One rectangle for each run of damaged tiles in a row, clipped to
+			// the requested area
+			uint32_t request_right = std::min<uint32_t>(request.x_pos + request.width, width_);
+			uint32_t request_bottom = std::min<uint32_t>(request.y_pos + request.height, height_);
+
+			auto add_run = [&](uint32_t first_tile, uint32_t end_tile, uint32_t tile_y) {
+				uint32_t left = std::max<uint32_t>(first_tile * kTileSize, request.x_pos);
+				uint32_t right = std::min<uint32_t>(end_tile * kTileSize, request_right);
+				uint32_t top = std::max<uint32_t>(tile_y * kTileSize, request.y_pos);
+				uint32_t bottom = std::min<uint32_t>((tile_y + 1) * kTileSize, request_bottom);
+				if(left < right && top < bottom) {
+					shapes.push_back({(uint16_t)left, (uint16_t)top, (uint16_t)(right - left), (uint16_t)(bottom - top)});
+				}
+			};
+
+			for(uint32_t tile_y = request.y_pos / kTileSize; tile_y * kTileSize < request_bottom; ++tile_y) {
+				uint32_t run_start = 0;
+				bool in_run = false;
+				for(uint32_t tile_x = request.x_pos / kTileSize; tile_x * kTileSize < request_right; ++tile_x) {
+					bool damaged = tile_serials_[tile_y * tiles_x_ + tile_x] > last_serial;
+					if(damaged && !in_run) {
+						run_start = tile_x;
+						in_run = true;
+					} else if(!damaged && in_run) {
+						add_run(run_start, tile_x, tile_y);
+						in_run = false;
+					}
+				}
+				if(in_run) {
+					add_run(run_start, tiles_x_, tile_y);
+				}
+			}
+		}
+	}
+
+	std::vector<Rectangle> results (shapes.size());
+	for(size_t i = 0; i < shapes.size(); ++i) {
+		results[i].Shape = shapes[i];
+		results[i].Encoding = EncodingType::Raw;
+		FillRectangle(results[i], target_format, EncodingType::Raw);
+	}
+
+	return results;
 }
 
-std::vector<Rectangle> Framebuffer::ServeRequest(const struct fb_update_request& request, const struct FB_PixelFormat& target_format)
+void Framebuffer::EnableDamageTracking()
 {
-	std::vector<Rectangle> results;
+	std::lock_guard<std::mutex> l(damage_lock_);
+	if(!damage_tracking_) {
+		damage_tracking_ = true;
+		tile_serials_.assign(tiles_x_ * tiles_y_, 0);
+	}
+}
 
-	// For now, just create one big rectangle to return
-	Rectangle output;
-	output.Shape.X = request.x_pos;
-	output.Shape.Y = request.y_pos;
-	output.Shape.Width = request.width;
-	output.Shape.Height = request.height;
-	output.Encoding = EncodingType::Raw;
+void Framebuffer::MarkDamaged(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+	std::lock_guard<std::mutex> l(damage_lock_);
+	if(!damage_tracking_ || width == 0 || height == 0) {
+		return;
+	}
 
-	FillRectangle(output, target_format, EncodingType::Raw);
+	damage_serial_++;
 
-	results.push_back(output);
+	uint32_t right = std::min<uint32_t>(x + width, width_);
+	uint32_t bottom = std::min<uint32_t>(y + height, height_);
+	for(uint32_t tile_y = y / kTileSize; tile_y * kTileSize < bottom; ++tile_y) {
+		for(uint32_t tile_x = x / kTileSize; tile_x * kTileSize < right; ++tile_x) {
+			tile_serials_[tile_y * tiles_x_ + tile_x] = damage_serial_;
+		}
+	}
 
-	return results;
+	damage_cv_.notify_all();
+}
+
+bool Framebuffer::WaitForDamage(uint64_t serial, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> l(damage_lock_);
+	if(!damage_tracking_) {
+		return true;
+	}
+
+	return damage_cv_.wait_for(l, timeout, [this, serial]() {
+		return damage_serial_ > serial;
+	});
 }
 
 using encoder_factory_t = Encoder*(const FB_PixelFormat& format, const RectangleShape& shape);
@@ -70,14 +157,47 @@ public:
 
 	uint32_t Convert(uint32_t data)
 	{
-		uint64_t true_red = ((data >> start_.red_shift) & start_.red_max) << red_shift_;
-		uint64_t true_green = ((data >> start_.green_shift) & start_.green_max) << green_shift_;
-		uint64_t true_blue = ((data >> start_.blue_shift) & start_.blue_max) << blue_shift_;
+		uint32_t true_red = Shift((data >> start_.red_shift) & start_.red_max, red_shift_);
+		uint32_t true_green = Shift((data >> start_.green_shift) & start_.green_max, green_shift_);
+		uint32_t true_blue = Shift((data >> start_.blue_shift) & start_.blue_max, blue_shift_);
 
 		return(true_red) | (true_green) | (true_blue);
 	}
 
+	void ConvertAll(std::vector<uint32_t> &pixels)
+	{
+		size_t i = 0;
+
+#ifdef __SSE2__
+		// Four pixels at a time
+		for(; i + 4 <= pixels.size(); i += 4) {
+			__m128i data = _mm_loadu_si128((const __m128i *)&pixels[i]);
+			__m128i result = _mm_or_si128(ConvertChannel(data, start_.red_shift, start_.red_max, red_shift_),
+			                              _mm_or_si128(ConvertChannel(data, start_.green_shift, start_.green_max, green_shift_),
+			                                      ConvertChannel(data, start_.blue_shift, start_.blue_max, blue_shift_)));
+			_mm_storeu_si128((__m128i *)&pixels[i], result);
+		}
+#endif
+
+		for(; i < pixels.size(); ++i) {
+			pixels[i] = Convert(pixels[i]);
+		}
+	}
+
 private:
+	static uint32_t Shift(uint32_t value, int shift)
+	{
+		return shift >= 0 ? value << shift : value >> -shift;
+	}
+
+#ifdef __SSE2__
+	static __m128i ConvertChannel(__m128i data, int start_shift, uint32_t max, int shift)
+	{
+		__m128i value = _mm_and_si128(_mm_srl_epi32(data, _mm_cvtsi32_si128(start_shift)), _mm_set1_epi32(max));
+		return shift >= 0 ? _mm_sll_epi32(value, _mm_cvtsi32_si128(shift)) : _mm_srl_epi32(value, _mm_cvtsi32_si128(-shift));
+	}
+#endif
+
 	FB_PixelFormat start_, end_;
 	int red_shift_, green_shift_, blue_shift_;
 };
@@ -98,14 +218,12 @@ void Framebuffer::FillRectangle(Rectangle& rect, const FB_PixelFormat& target_fo
 
 	for (int y = 0; y < rect.Shape.Height; ++y) {
 		for (int x = 0; x < rect.Shape.Width; ++x) {
-			uint32_t pixeldata = GetPixel(x, y);
+			uint32_t pixeldata = GetPixel(rect.Shape.X + x, rect.Shape.Y + y);
 			pixels.push_back(pixeldata);
 		}
 	}
 
-	for (auto &pxl : pixels) {
-		pxl = converter.Convert(pxl);
-	}
+	converter.ConvertAll(pixels);
 
 	rect.Data = encoder->Encode(pixels);
 
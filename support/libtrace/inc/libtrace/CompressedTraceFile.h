@@ -0,0 +1,156 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   CompressedTraceFile.h
+ *
+ * Compressed trace files hold the same records as raw binary traces, but in
+ * LZ4-compressed blocks:
+ *
+ *   FileHeader
+ *   BlockHeader, compressed records
+ *   BlockHeader, compressed records
+ *   ...
+ *   IndexEntry * block count
+ *   IndexTrailer
+ *
+ * The index at the end of the file allows any record to be found without
+ * decompressing the blocks before it. If a trace was not closed properly and
+ * has no index, the blocks are scanned instead.
+ */
+
+#ifndef COMPRESSEDTRACEFILE_H
+#define COMPRESSEDTRACEFILE_H
+
+#include "RecordTypes.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <istream>
+#include <vector>
+
+namespace libtrace
+{
+
+	class CompressedTraceFormat
+	{
+	public:
+		static const char kMagic[8];
+		static const char kIndexMagic[8];
+		static const uint32_t kBlockMagic = 0x4b4c4254; // 'TBLK'
+		static const uint32_t kVersion = 1;
+
+		struct FileHeader {
+			char Magic[8];
+			uint32_t Version;
+			uint32_t RecordSize;
+		};
+
+		struct BlockHeader {
+			uint32_t Magic;
+			uint32_t RecordCount;
+			uint32_t CompressedSize;
+			uint32_t Reserved;
+		};
+
+		struct IndexEntry {
+			uint64_t Offset;
+			uint64_t FirstRecord;
+			uint32_t RecordCount;
+			uint32_t CompressedSize;
+		};
+
+		struct IndexTrailer {
+			uint64_t IndexOffset;
+			uint64_t BlockCount;
+			uint64_t RecordCount;
+			char Magic[8];
+		};
+	};
+
+	class CompressedTraceWriter
+	{
+	public:
+		// Takes ownership of the file, and writes the file header to it
+		CompressedTraceWriter(FILE *file);
+		~CompressedTraceWriter();
+
+		bool WriteBlock(const Record *records, uint32_t count);
+
+		/*
+		 * Write the index after the blocks written so far. Blocks written
+		 * afterwards replace it, so this can be called as often as needed to
+		 * keep the file readable.
+		 */
+		bool WriteIndex();
+
+		uint64_t GetRecordCount() const
+		{
+			return record_count_;
+		}
+		uint64_t GetCompressedSize() const
+		{
+			return data_end_;
+		}
+
+	private:
+		FILE *file_;
+		uint64_t data_end_;
+		uint64_t record_count_;
+		std::vector<CompressedTraceFormat::IndexEntry> index_;
+
+		std::vector<char> buffer_;
+		void *lz4_ctx_;
+	};
+
+	class CompressedTraceReader
+	{
+	public:
+		// Read size bytes at the given offset of the underlying file
+		typedef std::function<bool(uint64_t offset, void *data, size_t size)> read_fn_t;
+
+		static read_fn_t FileReader(FILE *file);
+		static read_fn_t StreamReader(std::istream &stream);
+
+		static bool IsCompressed(const read_fn_t &read);
+		static uint64_t GetFileSize(FILE *file);
+		static uint64_t GetFileSize(std::istream &stream);
+
+		CompressedTraceReader(const read_fn_t &read, uint64_t file_size);
+
+		bool Good() const
+		{
+			return good_;
+		}
+		uint64_t GetRecordCount() const
+		{
+			return record_count_;
+		}
+		size_t GetBlockCount() const
+		{
+			return index_.size();
+		}
+		uint64_t GetBlockStart(size_t block) const
+		{
+			return index_.at(block).FirstRecord;
+		}
+
+		// Find the block which contains the given record
+		size_t FindBlock(uint64_t record) const;
+
+		bool ReadBlock(size_t block, std::vector<Record> &records);
+
+	private:
+		bool loadIndex(uint64_t file_size);
+		void scanBlocks(uint64_t file_size);
+
+		read_fn_t read_;
+		bool good_;
+		uint64_t record_count_;
+		std::vector<CompressedTraceFormat::IndexEntry> index_;
+		std::vector<char> buffer_;
+	};
+
+}
+
+#endif /* COMPRESSEDTRACEFILE_H */
@@ -5,10 +5,13 @@
 #include "RecordTypes.h"
 #include "RecordIterator.h"
 #include "TraceRecordStream.h"
+#include "CompressedTraceFile.h"
 
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
+#include <vector>
 
 namespace libtrace
 {
@@ -18,11 +21,20 @@ namespace libtrace
 	public:
 		RecordFile(FILE *f) : _file(f), _buffer(nullptr)
 		{
+			if(f && CompressedTraceReader::IsCompressed(CompressedTraceReader::FileReader(f))) {
+				_compressed.reset(new CompressedTraceReader(CompressedTraceReader::FileReader(f), CompressedTraceReader::GetFileSize(f)));
+				_count = _compressed->GetRecordCount();
+				return;
+			}
+
 			if(f) fseek(f, 0, SEEK_END);
 			uint64_t size = ftell(f);
 			_count = size / sizeof(Record);
 		}
-		virtual ~RecordFile() {}
+		virtual ~RecordFile()
+		{
+			free(_buffer);
+		}
 
 		RecordIterator begin();
 		RecordIterator end();
@@ -31,6 +43,12 @@ namespace libtrace
 		{
 			if(i >= _count) return false;
 
+			if(_compressed) {
+				if(_block_records.empty() || i < _block_start || i >= _block_start + _block_records.size()) loadBlock(i);
+				r = _block_records[i - _block_start];
+				return true;
+			}
+
 			if(!_buffer || _buffer_page != BufferPage(i)) loadBuffer(i);
 			r = _buffer[BufferOffset(i)];
 			return true;
@@ -74,8 +92,22 @@ namespace libtrace
 			}
 		}
 
+		void loadBlock(uint64_t idx)
+		{
+			size_t block = _compressed->FindBlock(idx);
+			if(!_compressed->ReadBlock(block, _block_records)) {
+				fprintf(stderr, "Corrupt compressed trace block %zu\n", block);
+				abort();
+			}
+			_block_start = _compressed->GetBlockStart(block);
+		}
+
 		uint64_t _buffer_page;
 		Record *_buffer;
+
+		std::unique_ptr<CompressedTraceReader> _compressed;
+		std::vector<Record> _block_records;
+		uint64_t _block_start;
 	};
 
 }
@@ -4,10 +4,13 @@
 
 #include "RecordTypes.h"
 #include "RecordIterator.h"
+#include "CompressedTraceFile.h"
 
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
+#include <vector>
 
 namespace libtrace
 {
@@ -18,7 +21,20 @@ namespace libtrace
 		RecordStream(FILE *f) : _file(f), _buffer(0), _buffer_ptr(0), _good(true)
 		{
 			_buffer = new Record[kBufferEntries];
-			_buffer_ptr = _buffer+kBufferEntries;
+			_buffer_end = _buffer+kBufferEntries;
+			_buffer_ptr = _buffer_end;
+
+			if(f && CompressedTraceReader::IsCompressed(CompressedTraceReader::FileReader(f))) {
+				_compressed.reset(new CompressedTraceReader(CompressedTraceReader::FileReader(f), CompressedTraceReader::GetFileSize(f)));
+				_next_block = 0;
+			} else if(f) {
+				// Checking for a compressed header moved the file position
+				fseek(f, 0, SEEK_SET);
+			}
+		}
+		~RecordStream()
+		{
+			delete [] _buffer;
 		}
 
 		const Record &next()
@@ -44,14 +60,28 @@ namespace libtrace
 
 		Record *_buffer;
 		Record *_buffer_ptr;
+		Record *_buffer_end;
 		bool _good;
 
+		std::unique_ptr<CompressedTraceReader> _compressed;
+		std::vector<Record> _block_records;
+		size_t _next_block;
+
 		bool buffer_empty()
 		{
-			return (_buffer_ptr == (_buffer+kBufferEntries));
+			return (_buffer_ptr == _buffer_end);
 		}
 		void refill_buffer()
 		{
+			if(_compressed) {
+				// Records are read straight out of each decompressed block
+				_good = _next_block < _compressed->GetBlockCount() && _compressed->ReadBlock(_next_block++, _block_records);
+				if(!_good) _block_records.assign(1, Record());
+				_buffer_ptr = _block_records.data();
+				_buffer_end = _buffer_ptr + _block_records.size();
+				return;
+			}
+
 			_good = (!feof(_file) && (fread(_buffer, sizeof(Record), kBufferEntries, _file) >= 0));
 			_buffer_ptr = _buffer;
 		}
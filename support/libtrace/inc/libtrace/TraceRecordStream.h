@@ -16,9 +16,11 @@
 #include <cstring>
 #include <deque>
 #include <fstream>
+#include <memory>
 
 namespace libtrace
 {
+	class CompressedTraceReader;
 
 	// Interface for interacting with buffers containing trace records
 	class RecordBufferInterface
@@ -48,6 +50,7 @@ namespace libtrace
 	{
 	public:
 		RecordFileInputStream(std::ifstream& str);
+		~RecordFileInputStream();
 
 		libtrace::Record Get() override;
 		bool Good() override;
@@ -63,6 +66,12 @@ namespace libtrace
 
 		std::vector<Record> record_buffer_;
 		uint32_t record_buffer_pointer_;
+
+		// Set if the file is compressed, in which case record_buffer_ holds
+		// the current block
+		std::unique_ptr<CompressedTraceReader> compressed_;
+		uint64_t compressed_position_;
+		uint64_t compressed_block_start_;
 	};
 
 	class PacketStreamInterface
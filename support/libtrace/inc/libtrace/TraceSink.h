@@ -10,8 +10,12 @@
 #define TRACEMANAGER_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdio>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <fstream>
 
@@ -32,7 +36,13 @@ namespace libtrace
 
 		virtual int Open() = 0;
 		virtual void SinkPackets(int id, const TraceRecord *start, const TraceRecord *end) = 0;
+
+		// Flush every stream. Nothing may be sinking packets at the time.
 		virtual void Flush() = 0;
+
+		// Flush one stream, from the thread which sinks its packets, while
+		// other streams carry on
+		virtual void Flush(int id) = 0;
 	};
 
 	class BinaryFileTraceSink : public TraceSink
@@ -44,12 +54,85 @@ namespace libtrace
 		int Open() override;
 		void SinkPackets(int id, const TraceRecord* start, const TraceRecord* end) override;
 		void Flush() override;
+		void Flush(int id) override;
 
 	private:
 		std::vector<FILE*> files_;
 		std::string pattern_;
 	};
 
+	class CompressedTraceWriter;
+
+	/*
+	 * Writes LZ4-compressed trace files (see CompressedTraceFile.h) from a
+	 * background thread. Each source copies its records into fixed-size
+	 * blocks, which are handed to the writer thread through a lock-free
+	 * single-producer single-consumer ring, so the simulation thread never
+	 * compresses or writes anything itself. A source only blocks if the
+	 * writer falls a whole ring behind.
+	 *
+	 * Each stream must only be written by one thread at a time. That thread
+	 * may flush its own stream at any time, but flushing every stream must
+	 * not run concurrently with SinkPackets.
+	 */
+	class CompressedFileTraceSink : public TraceSink
+	{
+	public:
+		CompressedFileTraceSink(const std::string &pattern);
+		~CompressedFileTraceSink();
+
+		int Open() override;
+		void SinkPackets(int id, const TraceRecord* start, const TraceRecord* end) override;
+		void Flush() override;
+		void Flush(int id) override;
+
+		// The number of times a source had to wait for the writer thread
+		uint64_t GetStallCount() const
+		{
+			return stalls_;
+		}
+
+	private:
+		static const uint32_t kMaxStreams = 256;
+		static const uint32_t kRingSize = 8;
+		static const uint32_t kBlockRecords = 1 << 16;
+
+		struct Block {
+			Record *Records;
+			uint32_t Count;
+		};
+
+		struct Stream {
+			CompressedTraceWriter *Writer;
+
+			// The producer fills Ring[Head], and the writer drains Ring[Tail]
+			Block Ring[kRingSize];
+			std::atomic<uint32_t> Head;
+			std::atomic<uint32_t> Tail;
+		};
+
+		void Publish(Stream &stream);
+		uint32_t PublishPartial(Stream &stream);
+		void WaitForWriter(Stream &stream, uint32_t tail);
+		bool Drain();
+		void WriterLoop();
+
+		std::string pattern_;
+
+		Stream *streams_[kMaxStreams];
+		std::atomic<uint32_t> stream_count_;
+		std::mutex open_lock_;
+
+		std::thread writer_;
+		std::mutex writer_lock_;
+		std::condition_variable writer_cond_;
+		std::condition_variable drained_cond_;
+		std::mutex file_lock_;
+		std::atomic<bool> terminate_;
+
+		std::atomic<uint64_t> stalls_;
+	};
+
 }
 
 
@@ -0,0 +1,225 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "libtrace/CompressedTraceFile.h"
+#include "lz4/lz4.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace libtrace;
+
+const char CompressedTraceFormat::kMagic[8] = {'L', 'T', 'R', 'C', 'L', 'Z', '4', 0};
+const char CompressedTraceFormat::kIndexMagic[8] = {'L', 'T', 'R', 'C', 'I', 'D', 'X', 0};
+
+// The hash table used by LZ4_compressCtx is only needed for inputs larger than this
+#define LZ4_64K_LIMIT ((1 << 16) + 11)
+
+CompressedTraceWriter::CompressedTraceWriter(FILE *file) : file_(file), data_end_(0), record_count_(0), lz4_ctx_(nullptr)
+{
+	CompressedTraceFormat::FileHeader header;
+	memcpy(header.Magic, CompressedTraceFormat::kMagic, sizeof(header.Magic));
+	header.Version = CompressedTraceFormat::kVersion;
+	header.RecordSize = sizeof(Record);
+
+	fwrite(&header, sizeof(header), 1, file_);
+	data_end_ = sizeof(header);
+}
+
+CompressedTraceWriter::~CompressedTraceWriter()
+{
+	fclose(file_);
+	free(lz4_ctx_);
+}
+
+bool CompressedTraceWriter::WriteBlock(const Record *records, uint32_t count)
+{
+	if(count == 0) {
+		return true;
+	}
+
+	int size = count * sizeof(Record);
+	buffer_.resize(sizeof(CompressedTraceFormat::BlockHeader) + LZ4_compressBound(size));
+
+	char *data = buffer_.data() + sizeof(CompressedTraceFormat::BlockHeader);
+	int compressed_size;
+	if(size < LZ4_64K_LIMIT) {
+		compressed_size = LZ4_compress64kCtx(&lz4_ctx_, (const char *)records, data, size);
+	} else {
+		compressed_size = LZ4_compressCtx(&lz4_ctx_, (const char *)records, data, size);
+	}
+
+	auto header = (CompressedTraceFormat::BlockHeader *)buffer_.data();
+	header->Magic = CompressedTraceFormat::kBlockMagic;
+	header->RecordCount = count;
+	header->CompressedSize = compressed_size;
+	header->Reserved = 0;
+
+	size_t total_size = sizeof(*header) + compressed_size;
+	if(fseeko(file_, data_end_, SEEK_SET) != 0 || fwrite(buffer_.data(), total_size, 1, file_) != 1) {
+		return false;
+	}
+
+	CompressedTraceFormat::IndexEntry entry;
+	entry.Offset = data_end_;
+	entry.FirstRecord = record_count_;
+	entry.RecordCount = count;
+	entry.CompressedSize = compressed_size;
+	index_.push_back(entry);
+
+	data_end_ += total_size;
+	record_count_ += count;
+	return true;
+}
+
+bool CompressedTraceWriter::WriteIndex()
+{
+	CompressedTraceFormat::IndexTrailer trailer;
+	trailer.IndexOffset = data_end_;
+	trailer.BlockCount = index_.size();
+	trailer.RecordCount = record_count_;
+	memcpy(trailer.Magic, CompressedTraceFormat::kIndexMagic, sizeof(trailer.Magic));
+
+	if(fseeko(file_, data_end_, SEEK_SET) != 0) {
+		return false;
+	}
+	if(!index_.empty() && fwrite(index_.data(), sizeof(index_[0]), index_.size(), file_) != index_.size()) {
+		return false;
+	}
+	if(fwrite(&trailer, sizeof(trailer), 1, file_) != 1) {
+		return false;
+	}
+
+	return fflush(file_) == 0;
+}
+
+CompressedTraceReader::read_fn_t CompressedTraceReader::FileReader(FILE *file)
+{
+	return [file](uint64_t offset, void *data, size_t size) {
+		return fseeko(file, offset, SEEK_SET) == 0 && fread(data, size, 1, file) == 1;
+	};
+}
+
+CompressedTraceReader::read_fn_t CompressedTraceReader::StreamReader(std::istream &stream)
+{
+	return [&stream](uint64_t offset, void *data, size_t size) {
+		stream.clear();
+		stream.seekg(offset);
+		stream.read((char *)data, size);
+		return stream.gcount() == (std::streamsize)size;
+	};
+}
+
+uint64_t CompressedTraceReader::GetFileSize(FILE *file)
+{
+	fseeko(file, 0, SEEK_END);
+	return ftello(file);
+}
+
+uint64_t CompressedTraceReader::GetFileSize(std::istream &stream)
+{
+	stream.clear();
+	stream.seekg(0, std::ios::end);
+	return stream.tellg();
+}
+
+bool CompressedTraceReader::IsCompressed(const read_fn_t &read)
+{
+	CompressedTraceFormat::FileHeader header;
+	if(!read(0, &header, sizeof(header))) {
+		return false;
+	}
+
+	return memcmp(header.Magic, CompressedTraceFormat::kMagic, sizeof(header.Magic)) == 0;
+}
+
+CompressedTraceReader::CompressedTraceReader(const read_fn_t &read, uint64_t file_size) : read_(read), good_(false), record_count_(0)
+{
+	CompressedTraceFormat::FileHeader header;
+	if(!read_(0, &header, sizeof(header))) {
+		return;
+	}
+	if(memcmp(header.Magic, CompressedTraceFormat::kMagic, sizeof(header.Magic)) != 0 || header.Version != CompressedTraceFormat::kVersion || header.RecordSize != sizeof(Record)) {
+		return;
+	}
+
+	if(!loadIndex(file_size)) {
+		scanBlocks(file_size);
+	}
+
+	good_ = true;
+}
+
+bool CompressedTraceReader::loadIndex(uint64_t file_size)
+{
+	CompressedTraceFormat::IndexTrailer trailer;
+	if(file_size < sizeof(CompressedTraceFormat::FileHeader) + sizeof(trailer)) {
+		return false;
+	}
+	if(!read_(file_size - sizeof(trailer), &trailer, sizeof(trailer))) {
+		return false;
+	}
+	if(memcmp(trailer.Magic, CompressedTraceFormat::kIndexMagic, sizeof(trailer.Magic)) != 0) {
+		return false;
+	}
+	if(trailer.IndexOffset + trailer.BlockCount * sizeof(CompressedTraceFormat::IndexEntry) + sizeof(trailer) != file_size) {
+		return false;
+	}
+
+	index_.resize(trailer.BlockCount);
+	if(!index_.empty() && !read_(trailer.IndexOffset, index_.data(), index_.size() * sizeof(index_[0]))) {
+		index_.clear();
+		return false;
+	}
+
+	record_count_ = trailer.RecordCount;
+	return true;
+}
+
+void CompressedTraceReader::scanBlocks(uint64_t file_size)
+{
+	uint64_t offset = sizeof(CompressedTraceFormat::FileHeader);
+
+	while(offset + sizeof(CompressedTraceFormat::BlockHeader) <= file_size) {
+		CompressedTraceFormat::BlockHeader header;
+		if(!read_(offset, &header, sizeof(header)) || header.Magic != CompressedTraceFormat::kBlockMagic) {
+			break;
+		}
+		if(offset + sizeof(header) + header.CompressedSize > file_size) {
+			break;
+		}
+
+		CompressedTraceFormat::IndexEntry entry;
+		entry.Offset = offset;
+		entry.FirstRecord = record_count_;
+		entry.RecordCount = header.RecordCount;
+		entry.CompressedSize = header.CompressedSize;
+		index_.push_back(entry);
+
+		record_count_ += header.RecordCount;
+		offset += sizeof(header) + header.CompressedSize;
+	}
+}
+
+size_t CompressedTraceReader::FindBlock(uint64_t record) const
+{
+	auto i = std::upper_bound(index_.begin(), index_.end(), record, [](uint64_t record, const CompressedTraceFormat::IndexEntry &entry) {
+		return record < entry.FirstRecord;
+	});
+
+	return (i - index_.begin()) - 1;
+}
+
+bool CompressedTraceReader::ReadBlock(size_t block, std::vector<Record> &records)
+{
+	const auto &entry = index_.at(block);
+
+	buffer_.resize(entry.CompressedSize);
+	if(!read_(entry.Offset + sizeof(CompressedTraceFormat::BlockHeader), buffer_.data(), buffer_.size())) {
+		return false;
+	}
+
+	int size = entry.RecordCount * sizeof(Record);
+	records.resize(entry.RecordCount);
+	return LZ4_uncompress_unknownOutputSize(buffer_.data(), (char *)records.data(), buffer_.size(), size) == size;
+}
@@ -1,6 +1,7 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 
 #include "libtrace/TraceRecordStream.h"
+#include "libtrace/CompressedTraceFile.h"
 
 #include <cassert>
 #include <cstdlib>
@@ -111,7 +112,17 @@ bool TracePacketStreamAdaptor::PreparePacket()
 	return true;
 }
 
-libtrace::RecordFileInputStream::RecordFileInputStream(std::ifstream& str) : stream_(str), is_ready_record_(false), record_buffer_pointer_(0)
+libtrace::RecordFileInputStream::RecordFileInputStream(std::ifstream& str) : stream_(str), is_ready_record_(false), record_buffer_pointer_(0), compressed_position_(0), compressed_block_start_(0)
+{
+	if(CompressedTraceReader::IsCompressed(CompressedTraceReader::StreamReader(stream_))) {
+		compressed_.reset(new CompressedTraceReader(CompressedTraceReader::StreamReader(stream_), CompressedTraceReader::GetFileSize(stream_)));
+	} else {
+		stream_.clear();
+		stream_.seekg(0);
+	}
+}
+
+libtrace::RecordFileInputStream::~RecordFileInputStream()
 {
 }
 
@@ -127,6 +138,10 @@ libtrace::Record libtrace::RecordFileInputStream::Get()
 
 bool libtrace::RecordFileInputStream::Good()
 {
+	if(compressed_) {
+		return compressed_->Good() && (is_ready_record_ || compressed_position_ < compressed_->GetRecordCount());
+	}
+
 	return stream_.good();
 }
 
@@ -142,11 +157,38 @@ libtrace::Record libtrace::RecordFileInputStream::Peek()
 void libtrace::RecordFileInputStream::Skip(size_t i)
 {
 	is_ready_record_ = false;
+
+	if(compressed_) {
+		compressed_position_ += i;
+		return;
+	}
+
 	stream_.ignore(i * sizeof(libtrace::Record));
 }
 
 void libtrace::RecordFileInputStream::makeReadyRecord()
 {
+	if(compressed_) {
+		if(compressed_position_ >= compressed_->GetRecordCount()) {
+			return;
+		}
+
+		if(compressed_position_ < compressed_block_start_ || compressed_position_ >= compressed_block_start_ + record_buffer_.size()) {
+			size_t block = compressed_->FindBlock(compressed_position_);
+			if(!compressed_->ReadBlock(block, record_buffer_)) {
+				record_buffer_.clear();
+				compressed_position_ = compressed_->GetRecordCount();
+				return;
+			}
+			compressed_block_start_ = compressed_->GetBlockStart(block);
+		}
+
+		ready_record_ = record_buffer_[compressed_position_ - compressed_block_start_];
+		compressed_position_++;
+		is_ready_record_ = true;
+		return;
+	}
+
 	if(record_buffer_pointer_ == record_buffer_.size()) {
 		record_buffer_.resize(1024 * 1024);
 		stream_.read((char*)&record_buffer_.at(0), record_buffer_.size() * sizeof(Record));
@@ -1,10 +1,12 @@
 /* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
 #include "libtrace/ArchInterface.h"
+#include "libtrace/CompressedTraceFile.h"
 #include "libtrace/TraceSink.h"
 #include "libtrace/TraceSource.h"
 #include "libtrace/TraceRecordStream.h"
 #include "libtrace/TraceRecordPacketVisitor.h"
 
+#include <chrono>
 #include <sstream>
 #include <string>
 #include <string.h>
@@ -51,3 +53,202 @@ void BinaryFileTraceSink::Flush()
 	// nothing to do
 }
 
+void BinaryFileTraceSink::Flush(int id)
+{
+	// nothing to do
+}
+
+
+CompressedFileTraceSink::CompressedFileTraceSink(const std::string &pattern) : TraceSink(), pattern_(pattern), stream_count_(0), terminate_(false), stalls_(0)
+{
+	writer_ = std::thread([this]() {
+		WriterLoop();
+	});
+}
+
+CompressedFileTraceSink::~CompressedFileTraceSink()
+{
+	Flush();
+
+	terminate_ = true;
+	{
+		std::lock_guard<std::mutex> l(writer_lock_);
+	}
+	writer_cond_.notify_one();
+	writer_.join();
+
+	for(uint32_t i = 0; i < stream_count_; ++i) {
+		Stream *stream = streams_[i];
+
+		delete stream->Writer;
+		for(auto &block : stream->Ring) {
+			free(block.Records);
+		}
+		delete stream;
+	}
+}
+
+int CompressedFileTraceSink::Open()
+{
+	std::lock_guard<std::mutex> l(open_lock_);
+
+	uint32_t new_id = stream_count_;
+	if(new_id == kMaxStreams) {
+		fprintf(stderr, "Too many trace streams\n");
+		abort();
+	}
+
+	std::stringstream str;
+	str << pattern_ << new_id;
+	FILE *f = fopen(str.str().c_str(), "wb");
+	if(!f) {
+		perror(str.str().c_str());
+		abort();
+	}
+
+	Stream *stream = new Stream();
+	stream->Writer = new CompressedTraceWriter(f);
+	for(auto &block : stream->Ring) {
+		block.Records = (Record*)malloc(kBlockRecords * sizeof(Record));
+		block.Count = 0;
+	}
+	stream->Head = 0;
+	stream->Tail = 0;
+
+	// The writer thread only looks at streams below the count
+	streams_[new_id] = stream;
+	stream_count_.store(new_id + 1, std::memory_order_release);
+
+	return new_id;
+}
+
+void CompressedFileTraceSink::Publish(Stream &stream)
+{
+	stream.Head.store(stream.Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	writer_cond_.notify_one();
+}
+
+// Block until the writer has consumed the stream up to the given tail
+void CompressedFileTraceSink::WaitForWriter(Stream &stream, uint32_t tail)
+{
+	std::unique_lock<std::mutex> l(writer_lock_);
+	writer_cond_.notify_one();
+	drained_cond_.wait(l, [&stream, tail]() {
+		return (int32_t)(stream.Tail.load(std::memory_order_acquire) - tail) >= 0;
+	});
+}
+
+void CompressedFileTraceSink::SinkPackets(int id, const TraceRecord* start, const TraceRecord* end)
+{
+	Stream &stream = *streams_[id];
+
+	while(start != end) {
+		uint32_t head = stream.Head.load(std::memory_order_relaxed);
+
+		// Wait for the writer to free up the next block
+		if(head - stream.Tail.load(std::memory_order_acquire) == kRingSize) {
+			stalls_++;
+			WaitForWriter(stream, head - kRingSize + 1);
+		}
+
+		Block &block = stream.Ring[head % kRingSize];
+		uint32_t count = std::min<uint64_t>(end - start, kBlockRecords - block.Count);
+
+		std::copy(start, start + count, block.Records + block.Count);
+		block.Count += count;
+		start += count;
+
+		if(block.Count == kBlockRecords) {
+			Publish(stream);
+		}
+	}
+}
+
+bool CompressedFileTraceSink::Drain()
+{
+	std::lock_guard<std::mutex> l(file_lock_);
+
+	bool drained = false;
+	uint32_t count = stream_count_.load(std::memory_order_acquire);
+	for(uint32_t i = 0; i < count; ++i) {
+		Stream &stream = *streams_[i];
+
+		uint32_t tail = stream.Tail.load(std::memory_order_relaxed);
+		while(tail != stream.Head.load(std::memory_order_acquire)) {
+			Block &block = stream.Ring[tail % kRingSize];
+			stream.Writer->WriteBlock(block.Records, block.Count);
+			block.Count = 0;
+
+			stream.Tail.store(++tail, std::memory_order_release);
+			drained = true;
+		}
+	}
+
+	// Wake any sources waiting for space. Taking the lock means a source
+	// can't miss this between checking the tail and going to sleep.
+	if(drained) {
+		{
+			std::lock_guard<std::mutex> l(writer_lock_);
+		}
+		drained_cond_.notify_all();
+	}
+
+	return drained;
+}
+
+void CompressedFileTraceSink::WriterLoop()
+{
+	while(!terminate_) {
+		if(Drain()) {
+			continue;
+		}
+
+		// Publishing a block does not take the lock, so also poll occasionally
+		std::unique_lock<std::mutex> l(writer_lock_);
+		writer_cond_.wait_for(l, std::chrono::milliseconds(10));
+	}
+
+	Drain();
+}
+
+// Hand over the stream's partially filled block, if it has one. Only the
+// stream's producer (or anyone, once it has stopped) may do this. Returns
+// the head which the writer has to reach for the stream to be flushed.
+uint32_t CompressedFileTraceSink::PublishPartial(Stream &stream)
+{
+	uint32_t head = stream.Head.load(std::memory_order_relaxed);
+	if(head - stream.Tail.load(std::memory_order_acquire) != kRingSize && stream.Ring[head % kRingSize].Count) {
+		Publish(stream);
+	}
+	return stream.Head.load(std::memory_order_relaxed);
+}
+
+void CompressedFileTraceSink::Flush()
+{
+	uint32_t count = stream_count_.load(std::memory_order_acquire);
+	std::vector<uint32_t> heads(count);
+
+	for(uint32_t i = 0; i < count; ++i) {
+		heads[i] = PublishPartial(*streams_[i]);
+	}
+
+	// Wait for the writer to catch up, and then bring the indices up to date
+	for(uint32_t i = 0; i < count; ++i) {
+		WaitForWriter(*streams_[i], heads[i]);
+	}
+
+	std::lock_guard<std::mutex> l(file_lock_);
+	for(uint32_t i = 0; i < count; ++i) {
+		streams_[i]->Writer->WriteIndex();
+	}
+}
+
+void CompressedFileTraceSink::Flush(int id)
+{
+	Stream &stream = *streams_[id];
+
+	WaitForWriter(stream, PublishPartial(stream));
+
+	std::lock_guard<std::mutex> l(file_lock_);
+	stream.Writer->WriteIndex();
+}
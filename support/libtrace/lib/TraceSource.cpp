@@ -68,6 +68,7 @@ void TraceSource::Terminate()
 
 void TraceSource::Flush()
 {
+	// Other sources may still be running, so only flush this one's stream
 	EmitPackets();
-	sink_->Flush();
+	sink_->Flush(id_);
 }
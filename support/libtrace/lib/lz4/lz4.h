@@ -0,0 +1,42 @@
+/*
+   LZ4 - Fast LZ compression algorithm
+   Header File
+   Copyright (C) 2011-2012, Yann Collet.
+   BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+   See lz4.c for the full license text.
+*/
+#ifndef LZ4_H
+#define LZ4_H
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+// Maximum size of the output of compressing isize bytes
+int LZ4_compressBound(int isize);
+
+// Compress isize bytes from source into dest, which must be at least
+// LZ4_compressBound(isize) bytes. Returns the number of bytes written.
+int LZ4_compress(const char* source, char* dest, int isize);
+
+// As LZ4_compress, but keep the (large) hash table in *ctx between calls.
+// *ctx must be NULL initially, and released with free(). Use the 64k
+// variant for inputs smaller than 64KB.
+int LZ4_compressCtx(void** ctx, const char* source, char* dest, int isize);
+int LZ4_compress64kCtx(void** ctx, const char* source, char* dest, int isize);
+
+// Decompress exactly osize bytes. Returns the number of input bytes read,
+// or a negative number if the input is malformed.
+int LZ4_uncompress(const char* source, char* dest, int osize);
+
+// Decompress isize bytes of input into at most maxOutputSize bytes. Returns
+// the number of bytes written, or a negative number if the input is
+// malformed.
+int LZ4_uncompress_unknownOutputSize(const char* source, char* dest, int isize, int maxOutputSize);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * Floating point and SIMD: single precision saxpy and dot product loops,
+ * which the compiler vectorises with NEON or SSE, followed by a scalar
+ * double precision recurrence.
+ */
+
+#include "runtime.h"
+
+#define ELEMENTS 4096
+#define ITERATIONS (10000u * BENCH_SCALE)
+
+static float xs[ELEMENTS], ys[ELEMENTS];
+
+int bench_main(void)
+{
+	for(uint32_t i = 0; i < ELEMENTS; ++i) {
+		xs[i] = (float)(i & 255) * 0.25f;
+		ys[i] = 1.0f;
+	}
+
+	float dot = 0;
+	for(uint32_t iteration = 0; iteration < ITERATIONS; ++iteration) {
+		float a = (iteration & 1) ? 0.5f : -0.5f;
+		for(uint32_t i = 0; i < ELEMENTS; ++i) {
+			ys[i] = a * xs[i] + ys[i];
+		}
+
+		dot = 0;
+		for(uint32_t i = 0; i < ELEMENTS; ++i) {
+			dot += xs[i] * ys[i];
+		}
+	}
+
+	double z = 0.5;
+	for(uint32_t i = 0; i < ITERATIONS * 100; ++i) {
+		z = 3.7 * z * (1.0 - z);
+	}
+
+	// The saxpy steps cancel out in pairs, leaving ys at 1
+	return !(dot > 0 && z > 0 && z < 1 && ys[0] == 1.0f);
+}
@@ -0,0 +1,28 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * Integer arithmetic and branches: an LCG mixed with xorshift, with a
+ * data-dependent branch in the loop.
+ */
+
+#include "runtime.h"
+
+#define ITERATIONS (50000000u * BENCH_SCALE)
+
+int bench_main(void)
+{
+	uint32_t x = 1, y = 0x12345678, odd = 0;
+
+	for(uint32_t i = 0; i < ITERATIONS; ++i) {
+		x = x * 1664525u + 1013904223u;
+		y ^= y << 13;
+		y ^= y >> 17;
+		y ^= y << 5;
+		if((x ^ y) & 1) {
+			odd++;
+		}
+	}
+
+	// Roughly half of the values should be odd
+	return !(odd > ITERATIONS / 4 && odd < ITERATIONS / 4 * 3);
+}
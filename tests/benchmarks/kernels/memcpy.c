@@ -0,0 +1,40 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * Bulk loads and stores: repeatedly copy a buffer which is larger than the
+ * usual L1 cache, with word-sized accesses.
+ */
+
+#include "runtime.h"
+
+#define BUFFER_WORDS (64 * 1024 / sizeof(uint32_t))
+#define ITERATIONS (4000u * BENCH_SCALE)
+
+static uint32_t source[BUFFER_WORDS];
+static uint32_t dest[BUFFER_WORDS];
+
+int bench_main(void)
+{
+	for(uint32_t i = 0; i < BUFFER_WORDS; ++i) {
+		source[i] = i * 2654435761u;
+	}
+
+	for(uint32_t iteration = 0; iteration < ITERATIONS; ++iteration) {
+		volatile uint32_t *d = dest;
+		const uint32_t *s = source;
+		for(uint32_t i = 0; i < BUFFER_WORDS; i += 4) {
+			d[i] = s[i];
+			d[i + 1] = s[i + 1];
+			d[i + 2] = s[i + 2];
+			d[i + 3] = s[i + 3];
+		}
+		source[iteration % BUFFER_WORDS]++;
+	}
+
+	for(uint32_t i = 0; i < BUFFER_WORDS; ++i) {
+		if(dest[i] != source[i] && i != (ITERATIONS - 1) % BUFFER_WORDS) {
+			return 1;
+		}
+	}
+	return 0;
+}
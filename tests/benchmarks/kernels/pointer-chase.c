@@ -0,0 +1,46 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * Dependent loads: follow a random cycle through a 4MB array, so that every
+ * load misses in the guest TLB and the host caches as often as possible.
+ */
+
+#include "runtime.h"
+
+#define NODES (1024 * 1024)
+#define STEPS (4000000u * BENCH_SCALE)
+
+static uint32_t next[NODES];
+
+int bench_main(void)
+{
+	// Sattolo's algorithm gives a single cycle through every node
+	for(uint32_t i = 0; i < NODES; ++i) {
+		next[i] = i;
+	}
+
+	uint32_t seed = 42;
+	for(uint32_t i = NODES - 1; i > 0; --i) {
+		seed = seed * 1103515245u + 12345u;
+		uint32_t j = (seed >> 8) % i;
+
+		uint32_t tmp = next[i];
+		next[i] = next[j];
+		next[j] = tmp;
+	}
+
+	uint32_t node = 0;
+	for(uint32_t i = 0; i < STEPS; ++i) {
+		node = next[node];
+	}
+
+	// Walking the whole cycle must return to the start
+	uint32_t start = node;
+	uint32_t length = 0;
+	do {
+		node = next[node];
+		length++;
+	} while(node != start && length <= NODES);
+
+	return length != NODES;
+}
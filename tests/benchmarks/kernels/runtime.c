@@ -0,0 +1,114 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+#include "runtime.h"
+
+#if defined(__x86_64__)
+
+#define NR_write 1
+#define NR_getpid 39
+#define NR_exit_group 231
+
+__asm__(
+    ".text\n"
+    ".global _start\n"
+    "_start:\n"
+    "  xor %rbp, %rbp\n"
+    "  and $-16, %rsp\n"
+    "  call bench_start\n"
+    "  hlt\n"
+);
+
+static long syscall3(long nr, long a0, long a1, long a2)
+{
+	long result;
+	__asm__ volatile("syscall" : "=a"(result) : "a"(nr), "D"(a0), "S"(a1), "d"(a2) : "rcx", "r11", "memory");
+	return result;
+}
+
+void bench_flush_icache(void *start, void *end)
+{
+	// x86 keeps instruction fetch coherent with stores
+	(void)start;
+	(void)end;
+}
+
+#elif defined(__arm__)
+
+#define NR_write 4
+#define NR_getpid 20
+#define NR_exit_group 248
+#define NR_cacheflush 0xf0002
+
+__asm__(
+    ".text\n"
+    ".global _start\n"
+    "_start:\n"
+    "  mov fp, #0\n"
+    "  bic sp, sp, #7\n"
+    "  bl bench_start\n"
+    "  b .\n"
+);
+
+static long syscall3(long nr, long a0, long a1, long a2)
+{
+	register long r0 __asm__("r0") = a0;
+	register long r1 __asm__("r1") = a1;
+	register long r2 __asm__("r2") = a2;
+	register long r7 __asm__("r7") = nr;
+	__asm__ volatile("svc #0" : "+r"(r0) : "r"(r1), "r"(r2), "r"(r7) : "memory");
+	return r0;
+}
+
+void bench_flush_icache(void *start, void *end)
+{
+	syscall3(NR_cacheflush, (long)start, (long)end, 0);
+}
+
+#else
+#error "Unsupported benchmark guest"
+#endif
+
+void bench_start(void)
+{
+	bench_exit(bench_main());
+}
+
+void bench_exit(int code)
+{
+	for(;;) {
+		syscall3(NR_exit_group, code, 0, 0);
+	}
+}
+
+long bench_getpid(void)
+{
+	return syscall3(NR_getpid, 0, 0, 0);
+}
+
+void bench_write(const char *str)
+{
+	size_t length = 0;
+	while(str[length]) {
+		length++;
+	}
+	syscall3(NR_write, 1, (long)str, length);
+}
+
+void *memcpy(void *dest, const void *src, size_t n)
+{
+	uint8_t *d = (uint8_t *)dest;
+	const uint8_t *s = (const uint8_t *)src;
+	while(n--) {
+		*d++ = *s++;
+	}
+	return dest;
+}
+
+void *memset(void *dest, int c, size_t n)
+{
+	uint8_t *d = (uint8_t *)dest;
+	while(n--) {
+		*d++ = c;
+	}
+	return dest;
+}
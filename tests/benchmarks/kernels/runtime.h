@@ -0,0 +1,33 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * File:   runtime.h
+ *
+ * A tiny freestanding runtime for the benchmark kernels, so that they can be
+ * built without a C library for any guest. Each kernel defines bench_main,
+ * which returns 0 if the kernel computed the expected result.
+ */
+
+#ifndef BENCHMARK_RUNTIME_H
+#define BENCHMARK_RUNTIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef BENCH_SCALE
+#define BENCH_SCALE 1
+#endif
+
+int bench_main(void);
+
+void bench_exit(int code) __attribute__((noreturn));
+long bench_getpid(void);
+void bench_write(const char *str);
+
+// Make freshly written instructions visible to instruction fetch
+void bench_flush_icache(void *start, void *end);
+
+void *memcpy(void *dest, const void *src, size_t n);
+void *memset(void *dest, int c, size_t n);
+
+#endif /* BENCHMARK_RUNTIME_H */
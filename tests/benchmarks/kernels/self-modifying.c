@@ -0,0 +1,47 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * Self-modifying code: rewrite the immediate of a tiny function before each
+ * call, so that every call has to invalidate and retranslate the code.
+ */
+
+#include "runtime.h"
+
+#define ITERATIONS (20000u * BENCH_SCALE)
+
+typedef uint32_t (*code_fn_t)(void);
+
+static uint8_t code[4096] __attribute__((aligned(4096)));
+
+static void emit(uint32_t value)
+{
+#if defined(__x86_64__)
+	// mov $value, %eax; ret
+	code[0] = 0xb8;
+	memcpy(&code[1], &value, 4);
+	code[5] = 0xc3;
+	bench_flush_icache(code, code + 6);
+#elif defined(__arm__)
+	// movw r0, #value; bx lr
+	uint32_t insns[2];
+	insns[0] = 0xe3000000 | ((value & 0xf000) << 4) | (value & 0xfff);
+	insns[1] = 0xe12fff1e;
+	memcpy(code, insns, sizeof(insns));
+	bench_flush_icache(code, code + sizeof(insns));
+#endif
+}
+
+int bench_main(void)
+{
+	uint32_t sum = 0, expected = 0;
+
+	for(uint32_t i = 0; i < ITERATIONS; ++i) {
+		uint32_t value = i & 0xffff;
+		emit(value);
+
+		sum += ((code_fn_t)(void *)code)();
+		expected += value;
+	}
+
+	return sum != expected;
+}
@@ -0,0 +1,22 @@
+/* This file is Copyright University of Edinburgh 2018. For license details, see LICENSE. */
+
+/*
+ * System call overhead: a cheap system call in a tight loop.
+ */
+
+#include "runtime.h"
+
+#define ITERATIONS (2000000u * BENCH_SCALE)
+
+int bench_main(void)
+{
+	long pid = bench_getpid();
+
+	for(uint32_t i = 0; i < ITERATIONS; ++i) {
+		if(bench_getpid() != pid) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+from argparse import ArgumentParser
+import json
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+import time
+
+# Run a single kernel under a single engine, and collect its metrics.
+def run_kernel(archsim, engine, binary, flags, timeout):
+	metrics_fd, metrics_path = tempfile.mkstemp(suffix=".json")
+	os.close(metrics_fd)
+
+	command = [archsim] + shlex.split(flags) + ["--mode", engine, "-q", "-v", "--metrics-file", metrics_path, "-e", binary]
+
+	result = {"status": "ok"}
+	start = time.time()
+	process = subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+	# Poll rather than block so that runaway kernels can be killed. wait4
+	# gives us the child's peak RSS.
+	while True:
+		pid, status, rusage = os.wait4(process.pid, os.WNOHANG)
+		if pid != 0:
+			break
+		if time.time() - start > timeout:
+			process.kill()
+			pid, status, rusage = os.wait4(process.pid, 0)
+			result["status"] = "timeout"
+			break
+		time.sleep(0.01)
+
+	# We have reaped the child ourselves, so stop Popen from waiting on it
+	process.returncode = status
+	result["wall_time"] = time.time() - start
+	result["peak_rss_kb"] = rusage.ru_maxrss
+
+	if result["status"] == "ok":
+		if not os.WIFEXITED(status):
+			result["status"] = "crashed"
+		elif os.WEXITSTATUS(status) != 0:
+			result["status"] = "failed"
+			result["exit_code"] = os.WEXITSTATUS(status)
+
+	try:
+		with open(metrics_path) as metrics_file:
+			metrics = json.load(metrics_file)
+	except (IOError, ValueError):
+		metrics = None
+	os.unlink(metrics_path)
+
+	if metrics is None:
+		if result["status"] == "ok":
+			result["status"] = "no-metrics"
+		return result
+
+	threads = metrics["threads"]
+	result["instructions"] = sum(t["instructions"] for t in threads)
+	result["jit_compile_time"] = sum(t["jit_compile_time"] for t in threads)
+	result["jit_code_size"] = sum(t["jit_code_size"] for t in threads)
+
+	runtime = sum(t["self_runtime"] for t in threads)
+	result["mips"] = (result["instructions"] / 1000000.0) / runtime if runtime else 0
+
+	return result
+
+# Compare results against the baseline. Returns a list of regressions.
+def compare(results, baseline, args):
+	regressions = []
+
+	for name, result in sorted(results.items()):
+		if name not in baseline:
+			print("  %-40s (not in baseline)" % name)
+			continue
+
+		base = baseline[name]
+		if base["status"] == "ok" and result["status"] != "ok":
+			regressions.append("%s: status %s (baseline ok)" % (name, result["status"]))
+			continue
+		if result["status"] != "ok" or base["status"] != "ok":
+			continue
+
+		if base["mips"] and result["mips"] < base["mips"] * (1 - args.mips_tolerance):
+			regressions.append("%s: %.2f MIPS (baseline %.2f)" % (name, result["mips"], base["mips"]))
+		if base["jit_compile_time"] and result["jit_compile_time"] > base["jit_compile_time"] * (1 + args.compile_tolerance):
+			regressions.append("%s: %.3fs JIT compile time (baseline %.3fs)" % (name, result["jit_compile_time"], base["jit_compile_time"]))
+		if base["jit_code_size"] and result["jit_code_size"] > base["jit_code_size"] * (1 + args.code_size_tolerance):
+			regressions.append("%s: %d bytes of JIT code (baseline %d)" % (name, result["jit_code_size"], base["jit_code_size"]))
+		if base["peak_rss_kb"] and result["peak_rss_kb"] > base["peak_rss_kb"] * (1 + args.rss_tolerance):
+			regressions.append("%s: %d KB peak RSS (baseline %d KB)" % (name, result["peak_rss_kb"], base["peak_rss_kb"]))
+
+	return regressions
+
+def main():
+	parser = ArgumentParser()
+	parser.add_argument("--archsim", dest="archsim", required=True)
+	parser.add_argument("--engines", dest="engines", default="Interpreter,BlockJIT")
+	parser.add_argument("--run", dest="runs", action="append", default=[], help="name=binary=archsim flags")
+	parser.add_argument("--baseline", dest="baseline")
+	parser.add_argument("--output", dest="output")
+	parser.add_argument("--update-baseline", dest="update_baseline", action="store_true")
+	parser.add_argument("--timeout", dest="timeout", type=float, default=600)
+	parser.add_argument("--mips-tolerance", dest="mips_tolerance", type=float, default=0.10)
+	parser.add_argument("--compile-tolerance", dest="compile_tolerance", type=float, default=0.25)
+	parser.add_argument("--code-size-tolerance", dest="code_size_tolerance", type=float, default=0.05)
+	parser.add_argument("--rss-tolerance", dest="rss_tolerance", type=float, default=0.10)
+	args = parser.parse_args()
+
+	if len(args.runs) == 0:
+		print("No benchmark kernels were built")
+		return 1
+
+	results = {}
+	for run in args.runs:
+		kernel, binary, flags = run.split("=", 2)
+		for engine in args.engines.split(","):
+			name = kernel + "/" + engine
+			result = run_kernel(args.archsim, engine, binary, flags, args.timeout)
+			results[name] = result
+
+			if result["status"] == "ok":
+				print("  %-40s %8.2f MIPS %8.3fs compile %10d bytes %8d KB" % (name, result["mips"], result["jit_compile_time"], result["jit_code_size"], result["peak_rss_kb"]))
+			else:
+				print("  %-40s %s" % (name, result["status"]))
+			sys.stdout.flush()
+
+	if args.output:
+		with open(args.output, "w") as output:
+			json.dump(results, output, indent=1, sort_keys=True)
+
+	if args.update_baseline:
+		with open(args.baseline, "w") as baseline_file:
+			json.dump(results, baseline_file, indent=1, sort_keys=True)
+		print("Updated baseline " + args.baseline)
+		return 0
+
+	if args.baseline is None or not os.path.exists(args.baseline):
+		print("No baseline to compare against (use the benchmark-update-baseline target to create one)")
+		return 0
+
+	with open(args.baseline) as baseline_file:
+		baseline = json.load(baseline_file)
+
+	regressions = compare(results, baseline, args)
+	if len(regressions) != 0:
+		print("Regressions against " + args.baseline + ":")
+		for regression in regressions:
+			print("  " + regression)
+		return 1
+
+	print("No regressions against " + args.baseline)
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())